@@ -0,0 +1,663 @@
+#include "asm_backend.h"
+#include <elf.h> // For the R_X86_64_* relocation types
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // For memcpy, strlen, strchr
+#include "elf_writer.h"
+#include "toolchain.h"
+#include "x86.h"
+
+#define ASM_BUFFER_BYTES (1u << 20)
+#define FRAME_BYTES      (BC_REGISTERS * 8) // The bytecode registers, at 8 * r(%rsp)
+
+#define STR(x)  #x
+#define XSTR(x) STR(x)
+
+// --- Writer ---
+//
+// Assembly is written through one large buffer with its own formatting, so
+// emitting a line costs a few copies rather than a stdio call per field.
+
+typedef struct {
+    FILE* file;
+    char* buffer;
+    size_t used;
+    size_t bytes; // Written in total
+    bool failed;
+} AsmWriter;
+
+static void w_flush(AsmWriter* w) {
+    if (w->used > 0 && !w->failed && fwrite(w->buffer, 1, w->used, w->file) != w->used) w->failed = true;
+    w->bytes += w->used;
+    w->used = 0;
+}
+
+static void w_bytes(AsmWriter* w, const char* bytes, size_t length) {
+    if (length > ASM_BUFFER_BYTES - w->used) {
+        w_flush(w);
+        if (length > ASM_BUFFER_BYTES) {
+            if (!w->failed && fwrite(bytes, 1, length, w->file) != length) w->failed = true;
+            w->bytes += length;
+            return;
+        }
+    }
+    memcpy(w->buffer + w->used, bytes, length);
+    w->used += length;
+}
+
+static void w_str(AsmWriter* w, const char* text) {
+    w_bytes(w, text, strlen(text));
+}
+
+static void w_int(AsmWriter* w, int64_t value) {
+    char digits[24];
+    size_t n = sizeof(digits);
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    do {
+        digits[--n] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) digits[--n] = '-';
+    w_bytes(w, digits + n, sizeof(digits) - n);
+}
+
+// printf-like: %d takes an int64_t, %s a string, %% is a '%'.
+static void w_format(AsmWriter* w, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    const char* p = format;
+    for (;;) {
+        const char* percent = strchr(p, '%');
+        if (!percent) {
+            w_str(w, p);
+            break;
+        }
+        w_bytes(w, p, (size_t)(percent - p));
+        switch (percent[1]) {
+            case 'd': w_int(w, va_arg(args, int64_t)); break;
+            case 's': w_str(w, va_arg(args, const char*)); break;
+            default: w_bytes(w, "%", 1); break;
+        }
+        p = percent + 2;
+    }
+    va_end(args);
+}
+
+// A .string directive for `text`, `length` bytes.
+static void w_string(AsmWriter* w, const char* text, size_t length) {
+    w_str(w, "\t.string\t\"");
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            char escaped[2] = {'\\', (char)c};
+            w_bytes(w, escaped, 2);
+        } else if (c >= 0x20 && c < 0x7f) {
+            w_bytes(w, (const char*)&c, 1);
+        } else {
+            char octal[4] = {'\\', (char)('0' + (c >> 6)), (char)('0' + ((c >> 3) & 7)), (char)('0' + (c & 7))};
+            w_bytes(w, octal, 4);
+        }
+    }
+    w_str(w, "\"\n");
+}
+
+// --- Instruction selection ---
+
+static int64_t reg(uint32_t r) {
+    return (int64_t)r * 8;
+}
+
+static bool fits_imm32(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+// Marks the code indices jumps go to, which get a label.
+static bool* find_targets(const BcProgram* program) {
+    bool* target = (bool*)calloc((size_t)program->code_count + 2, sizeof(bool));
+    if (!target) return NULL;
+    for (uint32_t pc = 0; pc < program->code_count; pc += bc_instr_words(program, pc)) {
+        BcInstr i = program->code[pc];
+        if (BC_OP(i) == BC_JMP) {
+            target[pc + 1 + BC_SJ(i)] = true;
+        } else if (BC_OP(i) == BC_TEST) {
+            target[pc + 2] = true;
+        } else if (BC_OP(i) == BC_SWITCH) {
+            const BcSwitch* table = &program->switches[BC_BX(i)];
+            for (uint32_t t = 0; t < table->count; ++t) target[program->targets[table->first + t]] = true;
+            target[program->targets[table->fallback]] = true;
+        }
+    }
+    return target;
+}
+
+static void emit_instr(AsmWriter* w, const BcProgram* program, uint32_t pc) {
+    BcInstr i = program->code[pc];
+    int64_t a = reg(BC_A(i)), b = reg(BC_B(i));
+    switch (BC_OP(i)) {
+        case BC_MOVE:
+            w_format(w, "\tmovq\t%d(%%rsp), %%rax\n\tmovq\t%%rax, %d(%%rsp)\n", b, a);
+            break;
+        case BC_LOADK: {
+            int64_t k = (int64_t)program->constants[BC_BX(i)];
+            if (fits_imm32(k)) w_format(w, "\tmovq\t$%d, %d(%%rsp)\n", k, a);
+            else w_format(w, "\tmovabsq\t$%d, %%rax\n\tmovq\t%%rax, %d(%%rsp)\n", k, a);
+            break;
+        }
+        case BC_CONSTRUCT: {
+            const BcVariant* variant = &program->variants[BC_BX(i)];
+            w_format(w, "\tmovl\t$%d, %%edi\n\tcall\tmylang_alloc\n\tmovl\t$%d, (%%rax)\n\tmovl\t$%d, 4(%%rax)\n",
+                     (int64_t)(sizeof(VmObject) + variant->field_count * sizeof(Value)), (int64_t)variant->tag,
+                     (int64_t)BC_BX(i));
+            for (uint32_t f = 0; f < variant->field_count; ++f) {
+                uint32_t field = (program->code[pc + 1 + f / 4] >> (8 * (f % 4))) & 0xff;
+                w_format(w, "\tmovq\t%d(%%rsp), %%rcx\n\tmovq\t%%rcx, %d(%%rax)\n", reg(field),
+                         (int64_t)(sizeof(VmObject) + f * sizeof(Value)));
+            }
+            w_format(w, "\tmovq\t%%rax, %d(%%rsp)\n", a);
+            break;
+        }
+        case BC_CONSTRUCT_SMALL: {
+            // The payload's kind goes to bits 3..5, its value stays in 32..63.
+            int64_t low = program->code[pc + 1];
+            w_format(w, "\tmovq\t%d(%%rsp), %%rax\n\tmovl\t%%eax, %%ecx\n\tandl\t$7, %%ecx\n\tshll\t$3, %%ecx\n"
+                        "\tshrq\t$32, %%rax\n\tshlq\t$32, %%rax\n\torq\t%%rcx, %%rax\n", b);
+            if (low <= INT32_MAX) w_format(w, "\torq\t$%d, %%rax\n", low);
+            else w_format(w, "\tmovl\t$%d, %%ecx\n\torq\t%%rcx, %%rax\n", low);
+            w_format(w, "\tmovq\t%%rax, %d(%%rsp)\n", a);
+            break;
+        }
+        case BC_PROJECT:
+            // A small value's payload, or else the object's field
+            w_format(w, "\tmovq\t%d(%%rsp), %%rax\n\tmovl\t%%eax, %%ecx\n\tandl\t$7, %%ecx\n\tcmpl\t$"
+                        XSTR(VALUE_SMALL) ", %%ecx\n\tjne\t1f\n\tmovl\t%%eax, %%ecx\n\tshrl\t$3, %%ecx\n"
+                        "\tandl\t$7, %%ecx\n\tshrq\t$32, %%rax\n\tshlq\t$32, %%rax\n\torq\t%%rcx, %%rax\n\tjmp\t2f\n"
+                        "1:\tmovq\t%d(%%rax), %%rax\n2:\tmovq\t%%rax, %d(%%rsp)\n",
+                     b, (int64_t)(sizeof(VmObject) + BC_C(i) * sizeof(Value)), a);
+            break;
+        case BC_TAG:
+            w_format(w, "\tmovq\t%d(%%rsp), %%rax\n\tmovl\t%%eax, %%ecx\n\tandl\t$7, %%ecx\n\tcmpl\t$"
+                        XSTR(VALUE_SMALL) ", %%ecx\n\tjne\t1f\n\tshrq\t$8, %%rax\n\tmovzbl\t%%al, %%eax\n\tjmp\t2f\n"
+                        "1:\tmovl\t(%%rax), %%eax\n2:\tshlq\t$32, %%rax\n\torq\t$" XSTR(VALUE_INT) ", %%rax\n"
+                        "\tmovq\t%%rax, %d(%%rsp)\n",
+                     b, a);
+            break;
+        case BC_EQ:
+            w_format(w, "\tmovq\t%d(%%rsp), %%rax\n\txorl\t%%ecx, %%ecx\n\tcmpq\t%d(%%rsp), %%rax\n\tsete\t%%cl\n"
+                        "\tshlq\t$32, %%rcx\n\torq\t$" XSTR(VALUE_BOOL) ", %%rcx\n\tmovq\t%%rcx, %d(%%rsp)\n",
+                     b, reg(BC_C(i)), a);
+            break;
+        case BC_BORROW:
+            w_format(w, "\tmovl\t$8, %%edi\n\tcall\tmylang_alloc\n\tmovq\t%d(%%rsp), %%rcx\n\tmovq\t%%rcx, (%%rax)\n"
+                        "\torq\t$" XSTR(VALUE_REF) ", %%rax\n\tmovq\t%%rax, %d(%%rsp)\n",
+                     b, a);
+            break;
+        case BC_SETGLOBAL:
+            w_format(w, "\tmovq\t%d(%%rsp), %%rax\n\tmovq\t%%rax, mylang_globals+%d(%%rip)\n", a, reg(BC_BX(i)));
+            break;
+        case BC_SPILL:
+            w_format(w, "\tmovq\t%d(%%rsp), %%rax\n\tmovq\t%%rax, mylang_spills+%d(%%rip)\n", a, reg(BC_BX(i)));
+            break;
+        case BC_RELOAD:
+            w_format(w, "\tmovq\tmylang_spills+%d(%%rip), %%rax\n\tmovq\t%%rax, %d(%%rsp)\n", reg(BC_BX(i)), a);
+            break;
+        case BC_JMP:
+            w_format(w, "\tjmp\t.L%d\n", (int64_t)pc + 1 + BC_SJ(i));
+            break;
+        case BC_TEST:
+            w_format(w, "\tcmpl\t$0, %d(%%rsp)\n\tje\t.L%d\n", a + 4, (int64_t)pc + 2);
+            break;
+        case BC_SWITCH: {
+            // Jump table of offsets from the table itself, right after the jump
+            const BcSwitch* table = &program->switches[BC_BX(i)];
+            w_format(w, "\tmovslq\t%d(%%rsp), %%rax\n", a + 4);
+            if (fits_imm32(table->low)) w_format(w, "\tsubq\t$%d, %%rax\n", table->low);
+            else w_format(w, "\tmovabsq\t$%d, %%rcx\n\tsubq\t%%rcx, %%rax\n", table->low);
+            w_format(w, "\tmovl\t$%d, %%ecx\n\tcmpq\t%%rcx, %%rax\n\tjae\t.L%d\n\tleaq\t.S%d(%%rip), %%rcx\n"
+                        "\tmovslq\t(%%rcx,%%rax,4), %%rdx\n\taddq\t%%rcx, %%rdx\n\tjmp\t*%%rdx\n\t.p2align 2\n.S%d:\n",
+                     (int64_t)table->count, (int64_t)program->targets[table->fallback], (int64_t)pc, (int64_t)pc);
+            for (uint32_t t = 0; t < table->count; ++t) {
+                w_format(w, "\t.long\t.L%d-.S%d\n", (int64_t)program->targets[table->first + t], (int64_t)pc);
+            }
+            break;
+        }
+        case BC_HALT:
+            w_str(w, "\tleave\n\tret\n");
+            break;
+        default:
+            w_str(w, "\tcall\tmylang_unreachable\n");
+            break;
+    }
+}
+
+// mylang_program, then the tables the runtime reads.
+static void emit_program(AsmWriter* w, const BcProgram* program, const bool* target) {
+    w_str(w, "\t.text\n\t.globl\tmylang_program\n\t.type\tmylang_program, @function\nmylang_program:\n"
+             "\tpushq\t%rbp\n\tmovq\t%rsp, %rbp\n\tsubq\t$" XSTR(FRAME_BYTES) ", %rsp\n");
+    for (uint32_t pc = 0; pc < program->code_count; pc += bc_instr_words(program, pc)) {
+        if (target[pc]) w_format(w, ".L%d:\n", (int64_t)pc);
+        emit_instr(w, program, pc);
+    }
+    if (target[program->code_count]) w_format(w, ".L%d:\n", (int64_t)program->code_count);
+    w_str(w, "\tleave\n\tret\n\t.size\tmylang_program, .-mylang_program\n\n");
+
+    w_format(w, "\t.data\n\t.globl\tmylang_globals\n\t.p2align 3\nmylang_globals:\n\t.fill\t%d, 8, " XSTR(VALUE_UNDEF)
+                "\n\t.bss\n\t.p2align 3\nmylang_spills:\n\t.zero\t%d\n\n",
+             (int64_t)program->global_count + 1, reg(program->spill_count + 1));
+
+    w_str(w, "\t.section\t.rodata\n\t.globl\tmylang_global_count\n\t.p2align 3\nmylang_global_count:\n");
+    w_format(w, "\t.quad\t%d\n", (int64_t)program->global_count);
+    for (uint32_t g = 0; g < program->global_count; ++g) {
+        w_format(w, ".N%d:\n", (int64_t)g);
+        w_string(w, program->globals[g].name.lexeme, (size_t)program->globals[g].name.length);
+    }
+    for (uint32_t s = 0; s < program->string_count; ++s) {
+        w_format(w, ".T%d:\n", (int64_t)s);
+        w_string(w, program->strings[s], strlen(program->strings[s]));
+    }
+    for (uint32_t v = 0; v < program->variant_count; ++v) {
+        w_format(w, ".V%d:\n", (int64_t)v);
+        w_string(w, program->variants[v].name.lexeme, (size_t)program->variants[v].name.length);
+    }
+
+    w_str(w, "\n\t.section\t.data.rel.ro, \"aw\"\n\t.p2align 3\n\t.globl\tmylang_global_names\nmylang_global_names:\n");
+    for (uint32_t g = 0; g < program->global_count; ++g) w_format(w, "\t.quad\t.N%d\n", (int64_t)g);
+    w_str(w, "\t.quad\t0\n\t.globl\tmylang_strings\nmylang_strings:\n");
+    for (uint32_t s = 0; s < program->string_count; ++s) w_format(w, "\t.quad\t.T%d\n", (int64_t)s);
+    w_str(w, "\t.quad\t0\n\t.globl\tmylang_variants\nmylang_variants:\n");
+    for (uint32_t v = 0; v < program->variant_count; ++v) {
+        w_format(w, "\t.quad\t.V%d, %d\n", (int64_t)v, (int64_t)program->variants[v].field_count);
+    }
+    w_str(w, "\t.quad\t0, 0\n\t.section\t.note.GNU-stack, \"\", @progbits\n");
+}
+
+// --- Object ---
+//
+// The same program encoded directly: instructions that only move values are
+// x86.h's snippets, which address the registers through rbx rather than rsp,
+// and the ones that allocate or leave the program are the snippets below.
+// Holes are marked as in x86.c.
+
+// push rbx, r13, r14; sub rsp, FRAME_BYTES; mov rbx, rsp;
+// lea r13, [rip + mylang_spills]; lea r14, [rip + mylang_globals]
+static const uint8_t PROLOGUE[] = {0x53, 0x41, 0x55, 0x41, 0x56, 0x48, 0x81, 0xEC, 0, 0, 0, 0, 0x48, 0x89, 0xE3,
+                                   0x4C, 0x8D, 0x2D, 0, 0, 0, 0, 0x4C, 0x8D, 0x35, 0, 0, 0, 0};
+#define PROLOGUE_FRAME_AT   8
+#define PROLOGUE_SPILLS_AT  18
+#define PROLOGUE_GLOBALS_AT 25
+
+// add rsp, FRAME_BYTES; pop r14, r13, rbx; ret
+static const uint8_t EPILOGUE[] = {0x48, 0x81, 0xC4, 0, 0, 0, 0, 0x41, 0x5E, 0x41, 0x5D, 0x5B, 0xC3};
+#define EPILOGUE_FRAME_AT 3
+
+// call function
+static const uint8_t CALL[] = {0xE8, 0, 0, 0, 0};
+#define CALL_AT 1
+
+// mov edi, size
+static const uint8_t ALLOC_SIZE[] = {0xBF, 0, 0, 0, 0};
+#define ALLOC_SIZE_AT 1
+
+// mov dword [rax], tag; mov dword [rax + 4], variant
+static const uint8_t HEADER[] = {0xC7, 0x00, 0, 0, 0, 0, 0xC7, 0x40, 0x04, 0, 0, 0, 0};
+#define HEADER_TAG_AT     2
+#define HEADER_VARIANT_AT 9
+
+// mov rcx, [rbx + B]; mov [rax + field], rcx
+static const uint8_t FIELD[] = {0x48, 0x8B, 0x8B, 0, 0, 0, 0, 0x48, 0x89, 0x88, 0, 0, 0, 0};
+#define FIELD_B_AT     3
+#define FIELD_FIELD_AT 10
+
+// mov rcx, [rbx + B]; mov [rax], rcx; or rax, VALUE_REF
+static const uint8_t REF[] = {0x48, 0x8B, 0x8B, 0, 0, 0, 0, 0x48, 0x89, 0x08, 0x48, 0x83, 0xC8, VALUE_REF};
+#define REF_B_AT 3
+
+// mov [rbx + A], rax
+static const uint8_t STORE[] = {0x48, 0x89, 0x83, 0, 0, 0, 0};
+#define STORE_A_AT 3
+
+// The runtime functions the code calls, as symbol indices.
+typedef struct {
+    uint32_t alloc;
+    uint32_t unreachable;
+} ObjectRuntime;
+
+static void put_call(X86Buffer* code, ElfWriter* elf, uint32_t function) {
+    size_t at = x86_put(code, CALL, sizeof(CALL));
+    elf_relocate(elf, ELF_TEXT, at + CALL_AT, function, R_X86_64_PLT32, -4);
+}
+
+static void put_alloc(X86Buffer* code, ElfWriter* elf, const ObjectRuntime* runtime, size_t bytes) {
+    size_t at = x86_put(code, ALLOC_SIZE, sizeof(ALLOC_SIZE));
+    x86_patch32(code, at + ALLOC_SIZE_AT, (uint32_t)bytes);
+    put_call(code, elf, runtime->alloc);
+}
+
+static void put_store(X86Buffer* code, uint32_t a) {
+    size_t at = x86_put(code, STORE, sizeof(STORE));
+    x86_patch32(code, at + STORE_A_AT, x86_slot(a));
+}
+
+static void put_object_instr(X86Buffer* code, ElfWriter* elf, const ObjectRuntime* runtime, const BcProgram* program,
+                             uint32_t pc) {
+    if (x86_put_instr(code, program, pc)) return;
+    BcInstr i = program->code[pc];
+    size_t at;
+    switch (BC_OP(i)) {
+        case BC_CONSTRUCT: {
+            const BcVariant* variant = &program->variants[BC_BX(i)];
+            put_alloc(code, elf, runtime, sizeof(VmObject) + variant->field_count * sizeof(Value));
+            at = x86_put(code, HEADER, sizeof(HEADER));
+            x86_patch32(code, at + HEADER_TAG_AT, variant->tag);
+            x86_patch32(code, at + HEADER_VARIANT_AT, BC_BX(i));
+            for (uint32_t f = 0; f < variant->field_count; ++f) {
+                at = x86_put(code, FIELD, sizeof(FIELD));
+                x86_patch32(code, at + FIELD_B_AT, x86_slot((program->code[pc + 1 + f / 4] >> (8 * (f % 4))) & 0xff));
+                x86_patch32(code, at + FIELD_FIELD_AT, (uint32_t)(sizeof(VmObject) + f * sizeof(Value)));
+            }
+            put_store(code, BC_A(i));
+            break;
+        }
+        case BC_BORROW:
+            put_alloc(code, elf, runtime, sizeof(Value));
+            at = x86_put(code, REF, sizeof(REF));
+            x86_patch32(code, at + REF_B_AT, x86_slot(BC_B(i)));
+            put_store(code, BC_A(i));
+            break;
+        case BC_HALT:
+            at = x86_put(code, EPILOGUE, sizeof(EPILOGUE));
+            x86_patch32(code, at + EPILOGUE_FRAME_AT, FRAME_BYTES);
+            break;
+        default:
+            put_call(code, elf, runtime->unreachable);
+            break;
+    }
+}
+
+// A NUL-terminated string in .rodata; returns its offset.
+static size_t put_rodata_string(ElfWriter* elf, const char* text, size_t length) {
+    size_t at = elf_append(elf, ELF_RODATA, text, length);
+    elf_append(elf, ELF_RODATA, "", 1);
+    return at;
+}
+
+// A pointer to offset `at` of .rodata in .data.rel.ro.
+static void put_rodata_pointer(ElfWriter* elf, size_t at) {
+    size_t field = elf_append64(elf, ELF_DATA_REL_RO, 0);
+    elf_relocate(elf, ELF_DATA_REL_RO, field, elf_section_symbol(ELF_RODATA), R_X86_64_64, (int64_t)at);
+}
+
+// Everything emit_program writes, as sections of `elf`. Returns false if a
+// jump lands inside an instruction, which the bytecode never does.
+static bool encode_program(ElfWriter* elf, const BcProgram* program, X86Buffer* code, uint32_t* native) {
+    ObjectRuntime runtime = {elf_symbol(elf, "mylang_alloc", ELF_UNDEFINED, 0, 0, false),
+                             elf_symbol(elf, "mylang_unreachable", ELF_UNDEFINED, 0, 0, false)};
+
+    elf_align(elf, ELF_DATA, 8);
+    size_t globals_at = elf->sections[ELF_DATA].count;
+    for (uint32_t g = 0; g <= program->global_count; ++g) elf_append64(elf, ELF_DATA, VALUE_UNDEF);
+    uint32_t globals = elf_symbol(elf, "mylang_globals", ELF_DATA, globals_at, x86_slot(program->global_count + 1),
+                                  false);
+    elf_align(elf, ELF_BSS, 8);
+    size_t spills_at = elf_append(elf, ELF_BSS, NULL, x86_slot(program->spill_count + 1));
+
+    // Relocations refer to `code` offsets, as .text holds nothing else.
+    size_t at = x86_put(code, PROLOGUE, sizeof(PROLOGUE));
+    x86_patch32(code, at + PROLOGUE_FRAME_AT, FRAME_BYTES);
+    elf_relocate(elf, ELF_TEXT, at + PROLOGUE_SPILLS_AT, elf_section_symbol(ELF_BSS), R_X86_64_PC32,
+                 (int64_t)spills_at - 4);
+    elf_relocate(elf, ELF_TEXT, at + PROLOGUE_GLOBALS_AT, globals, R_X86_64_PC32, -4);
+    for (uint32_t pc = 0; pc < program->code_count && !code->failed; ++pc) {
+        native[pc] = (uint32_t)code->count;
+        put_object_instr(code, elf, &runtime, program, pc);
+        for (uint32_t w = bc_instr_words(program, pc); w > 1 && pc + 1 < program->code_count; --w) {
+            native[++pc] = UINT32_MAX;
+        }
+    }
+    native[program->code_count] = (uint32_t)code->count;
+    at = x86_put(code, EPILOGUE, sizeof(EPILOGUE));
+    x86_patch32(code, at + EPILOGUE_FRAME_AT, FRAME_BYTES);
+    if (!x86_resolve(code, native, program->code_count + 1)) return false;
+    elf_append(elf, ELF_TEXT, code->bytes, code->count);
+    elf_symbol(elf, "mylang_program", ELF_TEXT, 0, code->count, true);
+
+    elf_align(elf, ELF_RODATA, 8);
+    size_t count_at = elf_append64(elf, ELF_RODATA, program->global_count);
+    elf_symbol(elf, "mylang_global_count", ELF_RODATA, count_at, sizeof(uint64_t), false);
+    elf_align(elf, ELF_DATA_REL_RO, 8);
+    size_t table_at = elf->sections[ELF_DATA_REL_RO].count;
+    for (uint32_t g = 0; g < program->global_count; ++g) {
+        const Token* name = &program->globals[g].name;
+        put_rodata_pointer(elf, put_rodata_string(elf, name->lexeme, (size_t)name->length));
+    }
+    elf_append64(elf, ELF_DATA_REL_RO, 0);
+    elf_symbol(elf, "mylang_global_names", ELF_DATA_REL_RO, table_at, 0, false);
+    table_at = elf->sections[ELF_DATA_REL_RO].count;
+    for (uint32_t s = 0; s < program->string_count; ++s) {
+        put_rodata_pointer(elf, put_rodata_string(elf, program->strings[s], strlen(program->strings[s])));
+    }
+    elf_append64(elf, ELF_DATA_REL_RO, 0);
+    elf_symbol(elf, "mylang_strings", ELF_DATA_REL_RO, table_at, 0, false);
+    table_at = elf->sections[ELF_DATA_REL_RO].count;
+    for (uint32_t v = 0; v < program->variant_count; ++v) {
+        const BcVariant* variant = &program->variants[v];
+        put_rodata_pointer(elf, put_rodata_string(elf, variant->name.lexeme, (size_t)variant->name.length));
+        elf_append64(elf, ELF_DATA_REL_RO, variant->field_count);
+    }
+    elf_append64(elf, ELF_DATA_REL_RO, 0);
+    elf_append64(elf, ELF_DATA_REL_RO, 0);
+    elf_symbol(elf, "mylang_variants", ELF_DATA_REL_RO, table_at, 0, false);
+    return true;
+}
+
+// --- Runtime ---
+
+static const char RUNTIME[] =
+    "// Run-time support for programs built by mylangc's native backend.\n"
+    "#include <stdint.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "\n"
+    "typedef uint64_t Value;\n"
+    "typedef struct { uint32_t tag; uint32_t variant; Value fields[]; } Object;\n"
+    "typedef struct { const char* name; uint64_t field_count; } Variant;\n"
+    "\n"
+    "extern const uint64_t mylang_global_count;\n"
+    "extern const Value mylang_globals[];\n"
+    "extern const char* const mylang_global_names[];\n"
+    "extern const char* const mylang_strings[];\n"
+    "extern const Variant mylang_variants[];\n"
+    "void mylang_program(void);\n"
+    "\n"
+    "static char* arena_next;\n"
+    "static char* arena_end;\n"
+    "\n"
+    "void* mylang_alloc(uint64_t bytes) {\n"
+    "    if ((uint64_t)(arena_end - arena_next) < bytes) {\n"
+    "        uint64_t size = bytes > (1u << 20) ? bytes : (1u << 20);\n"
+    "        arena_next = (char*)malloc(size);\n"
+    "        if (!arena_next) {\n"
+    "            fputs(\"Run-time error: out of memory.\\n\", stderr);\n"
+    "            exit(1);\n"
+    "        }\n"
+    "        arena_end = arena_next + size;\n"
+    "    }\n"
+    "    void* memory = arena_next;\n"
+    "    arena_next += bytes;\n"
+    "    return memory;\n"
+    "}\n"
+    "\n"
+    "void mylang_unreachable(void) {\n"
+    "    fputs(\"Run-time error: no arm of a match applied.\\n\", stderr);\n"
+    "    exit(1);\n"
+    "}\n"
+    "\n"
+    "static void print_value(Value value) {\n"
+    "    switch (value & 7) {\n"
+    "    case " XSTR(VALUE_INT) ":\n"
+    "        printf(\"%d\", (int)(int32_t)(uint32_t)(value >> 32));\n"
+    "        break;\n"
+    "    case " XSTR(VALUE_BOOL) ":\n"
+    "        fputs(value >> 32 ? \"true\" : \"false\", stdout);\n"
+    "        break;\n"
+    "    case " XSTR(VALUE_STRING) ":\n"
+    "        printf(\"\\\"%s\\\"\", mylang_strings[value >> 32]);\n"
+    "        break;\n"
+    "    case " XSTR(VALUE_SMALL) ": {\n"
+    "        Value payload = (value & 0xffffffff00000000u) | ((value >> 3) & 7);\n"
+    "        fputs(mylang_variants[(value >> 16) & 0xffff].name, stdout);\n"
+    "        if ((payload & 7) != " XSTR(VALUE_UNDEF) ") {\n"
+    "            putchar('(');\n"
+    "            print_value(payload);\n"
+    "            putchar(')');\n"
+    "        }\n"
+    "        break;\n"
+    "    }\n"
+    "    case " XSTR(VALUE_OBJECT) ": {\n"
+    "        const Object* object = (const Object*)(uintptr_t)value;\n"
+    "        const Variant* variant = &mylang_variants[object->variant];\n"
+    "        fputs(variant->name, stdout);\n"
+    "        for (uint64_t f = 0; f < variant->field_count; ++f) {\n"
+    "            fputs(f == 0 ? \"(\" : \", \", stdout);\n"
+    "            print_value(object->fields[f]);\n"
+    "        }\n"
+    "        if (variant->field_count > 0) putchar(')');\n"
+    "        break;\n"
+    "    }\n"
+    "    case " XSTR(VALUE_REF) ":\n"
+    "        putchar('&');\n"
+    "        print_value(*(const Value*)(uintptr_t)(value & ~(Value)7));\n"
+    "        break;\n"
+    "    default:\n"
+    "        putchar('?');\n"
+    "        break;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "int main(void) {\n"
+    "    mylang_program();\n"
+    "    for (uint64_t g = 0; g < mylang_global_count; ++g) {\n"
+    "        printf(\"%s = \", mylang_global_names[g]);\n"
+    "        print_value(mylang_globals[g]);\n"
+    "        putchar('\\n');\n"
+    "    }\n"
+    "    return 0;\n"
+    "}\n";
+
+// Writes the runtime's source unless it is there already. *changed says
+// whether its object must be rebuilt.
+static bool write_runtime(const char* path, const char* object, bool* changed) {
+    *changed = true;
+    FILE* file = fopen(path, "rb");
+    if (file) {
+        char existing[sizeof(RUNTIME)];
+        size_t length = fread(existing, 1, sizeof(existing), file);
+        fclose(file);
+        FILE* built = fopen(object, "rb");
+        if (built) fclose(built);
+        if (built && length == sizeof(RUNTIME) - 1 && memcmp(existing, RUNTIME, length) == 0) {
+            *changed = false;
+            return true;
+        }
+    }
+    file = fopen(path, "wb");
+    bool ok = file && fwrite(RUNTIME, 1, sizeof(RUNTIME) - 1, file) == sizeof(RUNTIME) - 1;
+    if (file && fclose(file) != 0) ok = false;
+    if (!ok) fprintf(stderr, "Error: could not write '%s'.\n", path);
+    return ok;
+}
+
+// --- Build ---
+
+static char* path_in(const char* dir, const char* name) {
+    size_t length = strlen(dir) + strlen(name) + 2;
+    char* path = (char*)malloc(length);
+    if (path) snprintf(path, length, "%s/%s", dir, name);
+    return path;
+}
+
+static bool write_assembly(const BcProgram* program, const char* path, AsmBackendStats* stats) {
+    bool* target = find_targets(program);
+    AsmWriter w = {0};
+    w.buffer = (char*)malloc(ASM_BUFFER_BYTES);
+    if (!target || !w.buffer) {
+        fprintf(stderr, "Error: out of memory while generating assembly.\n");
+        free(target);
+        free(w.buffer);
+        return false;
+    }
+    w.file = fopen(path, "wb");
+    bool ok = w.file != NULL;
+    if (ok) {
+        emit_program(&w, program, target);
+        w_flush(&w);
+        ok = !w.failed;
+        if (fclose(w.file) != 0) ok = false;
+    }
+    if (!ok) fprintf(stderr, "Error: could not write '%s'.\n", path);
+    stats->bytes = w.bytes;
+    free(target);
+    free(w.buffer);
+    return ok;
+}
+
+static bool write_object(const BcProgram* program, const char* path, AsmBackendStats* stats) {
+    ElfWriter elf;
+    elf_writer_init(&elf);
+    X86Buffer code = {0};
+    uint32_t* native = (uint32_t*)malloc(((size_t)program->code_count + 1) * sizeof(uint32_t));
+    bool encoded = native && encode_program(&elf, program, &code, native);
+    bool ok = encoded && !code.failed && !elf.failed;
+    if (native && !encoded && !code.failed) {
+        fprintf(stderr, "Error: a jump in the bytecode lands inside an instruction.\n");
+    } else if (!ok) {
+        fprintf(stderr, "Error: out of memory while generating code.\n");
+    }
+    ok = ok && elf_write(&elf, path, &stats->bytes);
+    free(native);
+    x86_buffer_free(&code);
+    elf_writer_free(&elf);
+    return ok;
+}
+
+bool asm_backend_build(const BcProgram* program, const AsmBackendOptions* options, AsmBackendStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    double start = toolchain_now();
+    if (!toolchain_make_dir(options->work_dir)) return false;
+    char* source = path_in(options->work_dir, "mylang.s");
+    char* object = path_in(options->work_dir, "mylang.o");
+    char* runtime_source = path_in(options->work_dir, "mylang_rt.c");
+    char* runtime_object = path_in(options->work_dir, "mylang_rt.o");
+    bool ok = source && object && runtime_source && runtime_object;
+    if (!ok) fprintf(stderr, "Error: out of memory while generating assembly.\n");
+    bool runtime_changed = false;
+    ok = ok && (options->write_object ? write_object(program, object, stats) : write_assembly(program, source, stats)) &&
+         write_runtime(runtime_source, runtime_object, &runtime_changed);
+    stats->emit_seconds = toolchain_now() - start;
+
+    if (ok && !options->emit_only) {
+        const char* as = options->as ? options->as : "as";
+        const char* cc = options->cc ? options->cc : "gcc";
+        char* assemble[] = {(char*)as, "--64", "-o", object, source, NULL};
+        char* compile[] = {(char*)cc, "-O2", "-c", runtime_source, "-o", runtime_object, NULL};
+        char** commands[] = {assemble, compile};
+        // The runtime is compiled alongside the assembler when it changed.
+        char** const* run = options->write_object ? commands + 1 : commands;
+        size_t count = (options->write_object ? 0 : 1) + (runtime_changed ? 1 : 0);
+        start = toolchain_now();
+        ok = toolchain_run_all(run, count, 2);
+        stats->assemble_seconds = toolchain_now() - start;
+        stats->runtime_compiled = runtime_changed;
+        if (ok) {
+            char* link[] = {(char*)cc, object, runtime_object, "-o", (char*)options->output, NULL};
+            start = toolchain_now();
+            ok = toolchain_run(link);
+            stats->link_seconds = toolchain_now() - start;
+        }
+    }
+    free(source);
+    free(object);
+    free(runtime_source);
+    free(runtime_object);
+    return ok;
+}
@@ -0,0 +1,47 @@
+#ifndef ASM_BACKEND_H
+#define ASM_BACKEND_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include "bytecode.h"
+
+// Native code without C: writes a bytecode program (bytecode.h) as x86-64
+// assembly for the GNU assembler, assembles it and links an executable with a
+// small C runtime. With `write_object`, the object is instead encoded in
+// process (x86.h) and written as ELF (elf_writer.h), without the assembler.
+//
+// The bytecode is already register-allocated, with its switches lowered, so
+// each instruction maps to a short x86-64 sequence. The program is one
+// System V function, mylang_program, whose frame holds the bytecode
+// registers; spill slots and each `let` are globals. Values are the VM's
+// tagged words (value.h). Objects come from the runtime's mylang_alloc, and
+// a `match` no arm applies to calls mylang_unreachable. The runtime's main
+// calls mylang_program, then prints every `let` from tables the assembly
+// defines, the way the VM does.
+//
+// Generated files, in `work_dir`: mylang.s (unless `write_object`) and
+// mylang.o, and mylang_rt.c and its object. The runtime object is reused while
+// its source is unchanged.
+
+typedef struct {
+    const char* output;   // Executable to link
+    const char* work_dir; // Created if missing
+    const char* as;       // Assembler; NULL for "as"
+    const char* cc;       // C compiler, for the runtime and linking; NULL for "gcc"
+    bool write_object;    // Encode mylang.o directly rather than running the assembler
+    bool emit_only;       // Write the sources (and with write_object, mylang.o) without building
+} AsmBackendOptions;
+
+typedef struct {
+    double emit_seconds;     // Writing the assembly, or the object
+    double assemble_seconds; // Wall-clock time of the assembler, and of the C compiler if it rebuilt the runtime
+    double link_seconds;
+    size_t bytes;            // Size of the assembly, or the object
+    bool runtime_compiled;   // False if the runtime's object was up to date
+} AsmBackendStats;
+
+// Returns false, after reporting on stderr, if writing the files or running
+// the tools failed.
+bool asm_backend_build(const BcProgram* program, const AsmBackendOptions* options, AsmBackendStats* stats);
+
+#endif // ASM_BACKEND_H
@@ -0,0 +1,728 @@
+#include "bytecode.h"
+#include "../core/symbol_table.h"
+#include "../util/array.h"
+#include "../util/hash.h"
+#include <stdlib.h>
+#include <string.h> // For memcpy, memset, strlen
+
+#define NO_REGISTER UINT32_MAX
+
+// Open-addressed map from a 64-bit key to an index, for deduplicating
+// constants and numbering the variants of each ADT once.
+typedef struct {
+    uint64_t* keys;
+    uint32_t* values; // Index + 1; 0 = empty
+    uint32_t capacity; // Power of two
+    uint32_t count;
+} IndexMap;
+
+// A jump whose target block's code index is not known yet: BC_JMP at code
+// index `at`, or jump table entry `at`.
+typedef struct {
+    uint32_t at;
+    uint32_t block;
+    bool table;
+} Fixup;
+
+typedef struct {
+    uint32_t start;
+    IrValue value;
+} Interval;
+
+typedef struct {
+    const IrProgram* ir;
+    BcProgram* out;
+    bool failed; // Reported already
+
+    uint32_t* order; // Reachable blocks in reverse postorder
+    uint32_t order_count;
+
+    // Per value: live range in positions (see number_positions), and where it lives
+    uint32_t* start;
+    uint32_t* end;
+    uint32_t* reg;  // NO_REGISTER if spilled, or a constant
+    uint32_t* slot; // Spill slot
+
+    uint32_t* def_position;  // Per value
+    uint32_t* term_position; // Per block
+    uint32_t* block_pc;      // Per block: where its code starts
+    Fixup* fixups;
+    uint32_t fixup_count, fixup_capacity;
+
+    IndexMap constant_map; // Value -> constant index
+    IndexMap variant_map;  // ADT symbol -> index of its first variant
+    uint32_t scratch;      // Next free scratch register for the current instruction
+} BcGen;
+
+// --- Storage ---
+
+static void fail(BcGen* gen, const char* message) {
+    if (!gen->failed) fprintf(stderr, "Error: %s.\n", message);
+    gen->failed = true;
+}
+
+// Makes room for `needed` entries in one of the output tables, failing the
+// compilation if memory runs out.
+static bool reserve(BcGen* gen, void** items, uint32_t* capacity, size_t needed, size_t size) {
+    if (gen->failed) return false;
+    if (array_reserve_u32(items, capacity, needed, size)) return true;
+    fail(gen, "out of memory while compiling to bytecode");
+    return false;
+}
+
+static uint32_t emit(BcGen* gen, BcInstr instr) {
+    BcProgram* out = gen->out;
+    if (!reserve(gen, (void**)&out->code, &out->code_capacity, out->code_count + 1, sizeof(BcInstr))) return 0;
+    out->code[out->code_count] = instr;
+    return out->code_count++;
+}
+
+static uint32_t map_slot(const IndexMap* map, uint64_t key) {
+    uint32_t mask = map->capacity - 1;
+    uint32_t i = hash_combine(0, key) & mask;
+    while (map->values[i] && map->keys[i] != key) i = (i + 1) & mask;
+    return i;
+}
+
+// The index stored for `key`, or UINT32_MAX.
+static uint32_t map_get(const IndexMap* map, uint64_t key) {
+    if (map->capacity == 0) return UINT32_MAX;
+    uint32_t i = map_slot(map, key);
+    return map->values[i] ? map->values[i] - 1 : UINT32_MAX;
+}
+
+static bool map_put(BcGen* gen, IndexMap* map, uint64_t key, uint32_t index) {
+    if ((map->count + 1) * 2 > map->capacity) {
+        IndexMap grown = {0};
+        grown.capacity = map->capacity ? map->capacity * 2 : 64;
+        grown.keys = (uint64_t*)malloc(grown.capacity * sizeof(uint64_t));
+        grown.values = (uint32_t*)calloc(grown.capacity, sizeof(uint32_t));
+        if (!grown.keys || !grown.values) {
+            free(grown.keys);
+            free(grown.values);
+            fail(gen, "out of memory while compiling to bytecode");
+            return false;
+        }
+        for (uint32_t i = 0; i < map->capacity; ++i) {
+            if (!map->values[i]) continue;
+            uint32_t slot = map_slot(&grown, map->keys[i]);
+            grown.keys[slot] = map->keys[i];
+            grown.values[slot] = map->values[i];
+        }
+        grown.count = map->count;
+        free(map->keys);
+        free(map->values);
+        *map = grown;
+    }
+    uint32_t slot = map_slot(map, key);
+    if (!map->values[slot]) map->count++;
+    map->keys[slot] = key;
+    map->values[slot] = index + 1;
+    return true;
+}
+
+static uint32_t constant(BcGen* gen, Value value) {
+    uint32_t index = map_get(&gen->constant_map, value);
+    if (index != UINT32_MAX) return index;
+    BcProgram* out = gen->out;
+    if (out->constant_count > BC_MAX_BX) {
+        fail(gen, "too many constants for the bytecode");
+        return 0;
+    }
+    if (!reserve(gen, (void**)&out->constants, &out->constant_capacity, out->constant_count + 1, sizeof(Value)) ||
+        !map_put(gen, &gen->constant_map, value, out->constant_count)) {
+        return 0;
+    }
+    out->constants[out->constant_count] = value;
+    return out->constant_count++;
+}
+
+// Index of variant `tag` of the ADT `type`; the ADT's variants are numbered
+// together on first use.
+static uint32_t variant_index(BcGen* gen, Type* type, uint32_t tag) {
+    if (type->kind != TYPE_ADT) {
+        fail(gen, "constructor without an ADT type in the IR");
+        return 0;
+    }
+    struct Symbol* symbol = ((TypeADT*)type)->adt_symbol;
+    uint32_t first = map_get(&gen->variant_map, (uint64_t)(uintptr_t)symbol);
+    if (first == UINT32_MAX) {
+        BcProgram* out = gen->out;
+        DynamicArray* variants = symbol->data.adt_def->variants;
+        first = out->variant_count;
+        for (size_t v = 0; v < da_count(variants); ++v) {
+            ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(variants, v);
+            if (!reserve(gen, (void**)&out->variants, &out->variant_capacity, out->variant_count + 1, sizeof(BcVariant))) {
+                return 0;
+            }
+            out->variants[out->variant_count++] = (BcVariant){variant->name, (uint32_t)v, (uint32_t)da_count(variant->fields)};
+        }
+        if (!map_put(gen, &gen->variant_map, (uint64_t)(uintptr_t)symbol, first)) return 0;
+    }
+    return first + tag;
+}
+
+// --- Register allocation ---
+
+static bool is_constant(const IrInstr* instr) {
+    return instr->op == IR_CONST_INT || instr->op == IR_CONST_BOOL || instr->op == IR_CONST_STRING;
+}
+
+// Defines a value in a register or a spill slot.
+static bool has_location(const IrInstr* instr) {
+    return instr->op != IR_NOP && instr->op != IR_EXPORT && !is_constant(instr);
+}
+
+static void extend(BcGen* gen, IrValue value, uint32_t position) {
+    if (position < gen->start[value]) gen->start[value] = position;
+    if (position > gen->end[value]) gen->end[value] = position;
+}
+
+// Numbers the blocks' instructions and terminators in order. Since the order
+// is topological, every path from a value's definition to a use stays within
+// the positions in between, so [start, end] is the value's live range. A block
+// parameter is defined on each edge into its block.
+static void number_positions(BcGen* gen) {
+    const IrProgram* ir = gen->ir;
+    uint32_t position = 0;
+    for (uint32_t p = 0; p < gen->order_count; ++p) {
+        const IrBlock* block = &ir->blocks[gen->order[p]];
+        for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+            gen->def_position[i] = position++;
+        }
+        gen->term_position[gen->order[p]] = position++;
+    }
+    for (uint32_t p = 0; p < gen->order_count; ++p) {
+        uint32_t b = gen->order[p];
+        const IrBlock* block = &ir->blocks[b];
+        for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+            const IrInstr* instr = &ir->instrs[i];
+            if (has_location(instr)) extend(gen, i, gen->def_position[i]);
+            const IrValue* operands = ir_operands(ir, instr);
+            for (uint32_t o = 0; o < instr->operand_count; ++o) extend(gen, operands[o], gen->def_position[i]);
+        }
+        uint32_t term = gen->term_position[b];
+        if (block->cond != IR_NO_VALUE) extend(gen, block->cond, term);
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+            const IrEdge* edge = &ir->edges[e];
+            const IrBlock* target = &ir->blocks[edge->target];
+            for (uint32_t a = 0; a < edge->arg_count; ++a) {
+                extend(gen, ir->operands[edge->first_arg + a], term);
+                extend(gen, ir->operands[target->first_param + a], term);
+            }
+        }
+    }
+}
+
+static int compare_intervals(const void* a, const void* b) {
+    uint32_t x = ((const Interval*)a)->start, y = ((const Interval*)b)->start;
+    return x < y ? -1 : x > y;
+}
+
+static void spill(BcGen* gen, IrValue value) {
+    gen->reg[value] = NO_REGISTER;
+    if (gen->out->spill_count > BC_MAX_BX) fail(gen, "too many spilled values for the bytecode");
+    gen->slot[value] = gen->out->spill_count++;
+}
+
+// Linear scan (Poletto and Sarkar): visits the live ranges by start, handing
+// out free registers; when none is free, the range that ends last is spilled.
+static bool allocate_registers(BcGen* gen) {
+    const IrProgram* ir = gen->ir;
+    Interval* intervals = (Interval*)malloc(((size_t)ir->instr_count + 1) * sizeof(Interval));
+    if (!intervals) {
+        fail(gen, "out of memory while compiling to bytecode");
+        return false;
+    }
+    uint32_t count = 0;
+    for (IrValue v = 0; v < ir->instr_count; ++v) {
+        gen->reg[v] = NO_REGISTER;
+        if (gen->start[v] != UINT32_MAX && has_location(&ir->instrs[v])) intervals[count++] = (Interval){gen->start[v], v};
+    }
+    qsort(intervals, count, sizeof(Interval), compare_intervals);
+
+    IrValue active[BC_ALLOC_REGISTERS]; // By increasing end
+    uint32_t active_count = 0, free_count = 0;
+    uint32_t free_registers[BC_ALLOC_REGISTERS];
+    for (uint32_t r = BC_ALLOC_REGISTERS; r-- > 0;) free_registers[free_count++] = r;
+    for (uint32_t i = 0; i < count; ++i) {
+        IrValue value = intervals[i].value;
+        uint32_t expired = 0;
+        while (expired < active_count && gen->end[active[expired]] < gen->start[value]) {
+            free_registers[free_count++] = gen->reg[active[expired++]];
+        }
+        memmove(active, active + expired, (active_count - expired) * sizeof(IrValue));
+        active_count -= expired;
+        if (free_count == 0) {
+            IrValue last = active[active_count - 1];
+            if (gen->end[last] <= gen->end[value]) {
+                spill(gen, value);
+                continue;
+            }
+            free_registers[free_count++] = gen->reg[last];
+            spill(gen, last);
+            active_count--;
+        }
+        gen->reg[value] = free_registers[--free_count];
+        uint32_t at = active_count;
+        while (at > 0 && gen->end[active[at - 1]] > gen->end[value]) {
+            active[at] = active[at - 1];
+            at--;
+        }
+        active[at] = value;
+        active_count++;
+    }
+    free(intervals);
+    return !gen->failed;
+}
+
+// --- Emission ---
+
+static uint32_t take_scratch(BcGen* gen) {
+    if (gen->scratch >= BC_REGISTERS) {
+        fail(gen, "an instruction has too many spilled or constant operands for the bytecode");
+        return BC_ALLOC_REGISTERS;
+    }
+    return gen->scratch++;
+}
+
+static Value constant_value(const IrInstr* instr) {
+    if (instr->op == IR_CONST_BOOL) return value_bool(instr->imm != 0);
+    if (instr->op == IR_CONST_STRING) return value_string((uint32_t)instr->imm);
+    return value_int((int32_t)instr->imm);
+}
+
+// Loads `value` into `target`, or into a scratch register if `target` is
+// NO_REGISTER and the value is not in a register already. Returns the register.
+static uint32_t load(BcGen* gen, IrValue value, uint32_t target) {
+    const IrInstr* instr = &gen->ir->instrs[value];
+    if (gen->reg[value] != NO_REGISTER && !is_constant(instr)) {
+        if (target != NO_REGISTER && target != gen->reg[value]) emit(gen, BC_ABC(BC_MOVE, target, gen->reg[value], 0));
+        return target != NO_REGISTER ? target : gen->reg[value];
+    }
+    uint32_t r = target != NO_REGISTER ? target : take_scratch(gen);
+    if (is_constant(instr)) emit(gen, BC_ABX(BC_LOADK, r, constant(gen, constant_value(instr))));
+    else emit(gen, BC_ABX(BC_RELOAD, r, gen->slot[value]));
+    return r;
+}
+
+static uint32_t use(BcGen* gen, IrValue value) {
+    return load(gen, value, NO_REGISTER);
+}
+
+// The register to compute `value` into; finish_def stores it if spilled.
+static uint32_t def(BcGen* gen, IrValue value) {
+    return gen->reg[value] != NO_REGISTER ? gen->reg[value] : take_scratch(gen);
+}
+
+static void finish_def(BcGen* gen, IrValue value, uint32_t r) {
+    if (gen->reg[value] == NO_REGISTER) emit(gen, BC_ABX(BC_SPILL, r, gen->slot[value]));
+}
+
+static bool is_payload_type(Type* type) {
+    return type == type_i32_instance || type == type_bool_instance || type == type_string_instance;
+}
+
+static void emit_construct(BcGen* gen, IrValue value) {
+    const IrInstr* instr = &gen->ir->instrs[value];
+    const IrValue* operands = ir_operands(gen->ir, instr);
+    uint32_t variant = variant_index(gen, instr->type, instr->tag);
+    bool small = instr->tag <= VALUE_SMALL_MAX_TAG && variant <= VALUE_SMALL_MAX_VARIANT &&
+                 (instr->operand_count == 0 ||
+                  (instr->operand_count == 1 && is_payload_type(gen->ir->instrs[operands[0]].type)));
+    if (small && instr->operand_count == 0) {
+        uint32_t k = constant(gen, value_small(instr->tag, variant, VALUE_UNDEF));
+        uint32_t r = def(gen, value);
+        emit(gen, BC_ABX(BC_LOADK, r, k));
+        finish_def(gen, value, r);
+        return;
+    }
+    if (small) {
+        uint32_t payload = use(gen, operands[0]);
+        uint32_t r = def(gen, value);
+        emit(gen, BC_ABC(BC_CONSTRUCT_SMALL, r, payload, 0));
+        emit(gen, (BcInstr)value_small(instr->tag, variant, 0));
+        finish_def(gen, value, r);
+        return;
+    }
+    if (variant > BC_MAX_BX) fail(gen, "too many variants for the bytecode");
+    uint32_t fields[BC_REGISTERS];
+    if (instr->operand_count > BC_REGISTERS) {
+        fail(gen, "a constructor has too many fields for the bytecode");
+        return;
+    }
+    for (uint32_t o = 0; o < instr->operand_count; ++o) fields[o] = use(gen, operands[o]);
+    uint32_t r = def(gen, value);
+    emit(gen, BC_ABX(BC_CONSTRUCT, r, variant));
+    for (uint32_t o = 0; o < instr->operand_count; o += 4) {
+        BcInstr word = 0;
+        for (uint32_t k = 0; k < 4 && o + k < instr->operand_count; ++k) word |= fields[o + k] << (8 * k);
+        emit(gen, word);
+    }
+    finish_def(gen, value, r);
+}
+
+static void emit_instr(BcGen* gen, IrValue value) {
+    const IrInstr* instr = &gen->ir->instrs[value];
+    const IrValue* operands = ir_operands(gen->ir, instr);
+    gen->scratch = BC_ALLOC_REGISTERS;
+    if (!has_location(instr) && instr->op != IR_EXPORT) return;
+    switch ((IrOp)instr->op) {
+        case IR_EXPORT:
+            if (instr->imm > BC_MAX_BX) fail(gen, "too many globals for the bytecode");
+            emit(gen, BC_ABX(BC_SETGLOBAL, use(gen, operands[0]), (uint32_t)instr->imm));
+            return;
+        case IR_CONSTRUCT:
+            emit_construct(gen, value);
+            return;
+        case IR_UNDEF: {
+            uint32_t r = def(gen, value);
+            emit(gen, BC_ABX(BC_LOADK, r, constant(gen, VALUE_UNDEF)));
+            finish_def(gen, value, r);
+            return;
+        }
+        default:
+            break;
+    }
+    uint32_t b = use(gen, operands[0]);
+    uint32_t c = instr->op == IR_EQ ? use(gen, operands[1]) : 0;
+    uint32_t r = def(gen, value);
+    switch ((IrOp)instr->op) {
+        case IR_PROJECT:
+            if (instr->imm > 0xff) fail(gen, "a constructor has too many fields for the bytecode");
+            emit(gen, BC_ABC(BC_PROJECT, r, b, (uint32_t)instr->imm));
+            break;
+        case IR_TAG: emit(gen, BC_ABC(BC_TAG, r, b, 0)); break;
+        case IR_EQ: emit(gen, BC_ABC(BC_EQ, r, b, c)); break;
+        case IR_BORROW: emit(gen, BC_ABC(BC_BORROW, r, b, 0)); break;
+        default: fail(gen, "unexpected instruction in the IR"); break;
+    }
+    finish_def(gen, value, r);
+}
+
+// Assigns the edge's arguments to its target's parameters. The parameters are
+// live on the edge with the arguments, so no register is both, and the moves
+// can go in any order.
+static void emit_edge_moves(BcGen* gen, const IrEdge* edge) {
+    const IrProgram* ir = gen->ir;
+    const IrBlock* target = &ir->blocks[edge->target];
+    for (uint32_t a = 0; a < edge->arg_count; ++a) {
+        IrValue param = ir->operands[target->first_param + a];
+        IrValue arg = ir->operands[edge->first_arg + a];
+        gen->scratch = BC_ALLOC_REGISTERS;
+        if (gen->reg[param] != NO_REGISTER) {
+            load(gen, arg, gen->reg[param]);
+        } else {
+            emit(gen, BC_ABX(BC_SPILL, use(gen, arg), gen->slot[param]));
+        }
+    }
+}
+
+static void emit_jump_to_block(BcGen* gen, uint32_t block) {
+    uint32_t at = emit(gen, BC_SJX(BC_JMP, 0));
+    if (!reserve(gen, (void**)&gen->fixups, &gen->fixup_capacity, gen->fixup_count + 1, sizeof(Fixup))) return;
+    gen->fixups[gen->fixup_count++] = (Fixup){at, block, false};
+}
+
+static void patch_jump(BcGen* gen, uint32_t at, uint32_t target) {
+    int64_t offset = (int64_t)target - (int64_t)(at + 1);
+    if (offset > BC_MAX_SJ || offset < -BC_MAX_SJ) fail(gen, "a jump is too far for the bytecode");
+    if (!gen->failed) gen->out->code[at] = BC_SJX(BC_JMP, (uint32_t)offset & 0xffffff);
+}
+
+// Takes an edge, falling through when its target comes next.
+static void emit_edge(BcGen* gen, const IrEdge* edge, uint32_t next_block) {
+    emit_edge_moves(gen, edge);
+    if (edge->target != next_block) emit_jump_to_block(gen, edge->target);
+}
+
+// Points the jump at code index `at` (or jump table entry `at`) at `edge`:
+// at its target block if there is nothing to move, else at a stub emitted
+// here that moves the arguments and jumps on.
+static void emit_stub(BcGen* gen, const IrEdge* edge, uint32_t at, bool table) {
+    if (edge->arg_count == 0) {
+        if (!reserve(gen, (void**)&gen->fixups, &gen->fixup_capacity, gen->fixup_count + 1, sizeof(Fixup))) return;
+        gen->fixups[gen->fixup_count++] = (Fixup){at, edge->target, table};
+        return;
+    }
+    uint32_t pc = gen->out->code_count;
+    if (table) gen->out->targets[at] = pc;
+    else patch_jump(gen, at, pc);
+    emit_edge(gen, edge, UINT32_MAX);
+}
+
+static void emit_switch(BcGen* gen, const IrBlock* block, uint32_t next_block) {
+    const IrProgram* ir = gen->ir;
+    const IrEdge* edges = ir->edges + block->first_edge;
+    uint32_t cases = block->edge_count - 1;
+    int64_t low = INT64_MAX, high = INT64_MIN;
+    for (uint32_t e = 0; e < cases; ++e) {
+        if (edges[e].case_value < low) low = edges[e].case_value;
+        if (edges[e].case_value > high) high = edges[e].case_value;
+    }
+    gen->scratch = BC_ALLOC_REGISTERS;
+    uint32_t cond = use(gen, block->cond);
+    if (cases == 0 || high - low >= 4 * (int64_t)cases + 16) {
+        // Sparse cases: compare one by one.
+        uint32_t* jumps = (uint32_t*)malloc(((size_t)cases + 1) * sizeof(uint32_t));
+        if (!jumps) {
+            fail(gen, "out of memory while compiling to bytecode");
+            return;
+        }
+        for (uint32_t e = 0; e < cases; ++e) {
+            gen->scratch = cond + 1 > BC_ALLOC_REGISTERS ? cond + 1 : BC_ALLOC_REGISTERS;
+            uint32_t k = take_scratch(gen), test = take_scratch(gen);
+            emit(gen, BC_ABX(BC_LOADK, k, constant(gen, value_int((int32_t)edges[e].case_value))));
+            emit(gen, BC_ABC(BC_EQ, test, cond, k));
+            emit(gen, BC_ABC(BC_TEST, test, 0, 0));
+            jumps[e] = emit(gen, BC_SJX(BC_JMP, 0));
+        }
+        emit_edge(gen, &edges[cases], next_block);
+        for (uint32_t e = 0; e < cases; ++e) emit_stub(gen, &edges[e], jumps[e], false);
+        free(jumps);
+        return;
+    }
+    BcProgram* out = gen->out;
+    uint32_t count = (uint32_t)(high - low + 1);
+    if (out->switch_count > BC_MAX_BX) fail(gen, "too many switches for the bytecode");
+    if (!reserve(gen, (void**)&out->switches, &out->switch_capacity, out->switch_count + 1, sizeof(BcSwitch))) return;
+    if (!reserve(gen, (void**)&out->targets, &out->target_capacity, (size_t)out->target_count + count + 1,
+                 sizeof(uint32_t))) {
+        return;
+    }
+    uint32_t first = out->target_count, fallback = first + count;
+    out->target_count += count + 1;
+    out->switches[out->switch_count] = (BcSwitch){low, count, first, fallback};
+    emit(gen, BC_ABX(BC_SWITCH, cond, out->switch_count++));
+    // Case entries may only get their targets from resolve_fixups, so mark
+    // them first to tell them from the entries left to the default.
+    for (uint32_t t = 0; t < count; ++t) out->targets[first + t] = UINT32_MAX;
+    for (uint32_t e = 0; e < cases; ++e) out->targets[first + (uint32_t)(edges[e].case_value - low)] = 0;
+    for (uint32_t e = 0; e < cases; ++e) emit_stub(gen, &edges[e], first + (uint32_t)(edges[e].case_value - low), true);
+    // Entries no case took go to the default, like values out of range.
+    emit_stub(gen, &edges[cases], fallback, true);
+    for (uint32_t t = 0; t < count; ++t) {
+        if (out->targets[first + t] != UINT32_MAX) continue;
+        if (edges[cases].arg_count > 0) {
+            out->targets[first + t] = out->targets[fallback];
+        } else if (reserve(gen, (void**)&gen->fixups, &gen->fixup_capacity, gen->fixup_count + 1, sizeof(Fixup))) {
+            gen->fixups[gen->fixup_count++] = (Fixup){first + t, edges[cases].target, true};
+        }
+    }
+}
+
+static void emit_terminator(BcGen* gen, const IrBlock* block, uint32_t next_block) {
+    const IrEdge* edges = gen->ir->edges + block->first_edge;
+    switch ((IrTermKind)block->term) {
+        case IR_TERM_JUMP:
+            emit_edge(gen, &edges[0], next_block);
+            break;
+        case IR_TERM_BRANCH: {
+            gen->scratch = BC_ALLOC_REGISTERS;
+            emit(gen, BC_ABC(BC_TEST, use(gen, block->cond), 0, 0));
+            uint32_t jump = emit(gen, BC_SJX(BC_JMP, 0));
+            emit_edge(gen, &edges[1], next_block);
+            emit_stub(gen, &edges[0], jump, false);
+            break;
+        }
+        case IR_TERM_SWITCH:
+            emit_switch(gen, block, next_block);
+            break;
+        case IR_TERM_RETURN:
+            emit(gen, BC_ABC(BC_HALT, 0, 0, 0));
+            break;
+        default:
+            emit(gen, BC_ABC(BC_UNREACHABLE, 0, 0, 0));
+            break;
+    }
+}
+
+static void resolve_fixups(BcGen* gen) {
+    for (uint32_t f = 0; f < gen->fixup_count && !gen->failed; ++f) {
+        const Fixup* fixup = &gen->fixups[f];
+        uint32_t pc = gen->block_pc[fixup->block];
+        if (fixup->table) gen->out->targets[fixup->at] = pc;
+        else patch_jump(gen, fixup->at, pc);
+    }
+}
+
+static bool copy_tables(BcGen* gen) {
+    const IrProgram* ir = gen->ir;
+    BcProgram* out = gen->out;
+    out->strings = (char**)calloc((size_t)ir->string_count + 1, sizeof(char*));
+    out->globals = (IrGlobal*)malloc(((size_t)ir->global_count + 1) * sizeof(IrGlobal));
+    if (!out->strings || !out->globals) return false;
+    for (uint32_t s = 0; s < ir->string_count; ++s) {
+        size_t length = strlen(ir->strings[s]);
+        out->strings[s] = (char*)malloc(length + 1);
+        if (!out->strings[s]) return false;
+        memcpy(out->strings[s], ir->strings[s], length + 1);
+        out->string_count++;
+    }
+    if (ir->global_count > 0) memcpy(out->globals, ir->globals, ir->global_count * sizeof(IrGlobal));
+    out->global_count = ir->global_count;
+    return true;
+}
+
+BcProgram* bc_compile(const IrProgram* ir) {
+    BcGen gen = {0};
+    gen.ir = ir;
+    gen.out = (BcProgram*)calloc(1, sizeof(BcProgram));
+    size_t values = (size_t)ir->instr_count + 1, blocks = (size_t)ir->block_count + 1;
+    gen.order = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    gen.start = (uint32_t*)malloc(values * sizeof(uint32_t));
+    gen.end = (uint32_t*)calloc(values, sizeof(uint32_t));
+    gen.reg = (uint32_t*)malloc(values * sizeof(uint32_t));
+    gen.slot = (uint32_t*)malloc(values * sizeof(uint32_t));
+    gen.def_position = (uint32_t*)malloc(values * sizeof(uint32_t));
+    gen.term_position = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    gen.block_pc = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    if (!gen.out || !gen.order || !gen.start || !gen.end || !gen.reg || !gen.slot || !gen.def_position ||
+        !gen.term_position || !gen.block_pc || !copy_tables(&gen) ||
+        (gen.order_count = ir_reverse_postorder(ir, gen.order)) == UINT32_MAX) {
+        fail(&gen, "out of memory while compiling to bytecode");
+    }
+    if (!gen.failed) {
+        for (IrValue v = 0; v < ir->instr_count; ++v) gen.start[v] = UINT32_MAX;
+        number_positions(&gen);
+        allocate_registers(&gen);
+    }
+    for (uint32_t p = 0; p < gen.order_count && !gen.failed; ++p) {
+        uint32_t b = gen.order[p];
+        const IrBlock* block = &ir->blocks[b];
+        gen.block_pc[b] = gen.out->code_count;
+        for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) emit_instr(&gen, i);
+        emit_terminator(&gen, block, p + 1 < gen.order_count ? gen.order[p + 1] : UINT32_MAX);
+    }
+    if (gen.order_count == 0 && !gen.failed) emit(&gen, BC_ABC(BC_HALT, 0, 0, 0));
+    resolve_fixups(&gen);
+
+    free(gen.order);
+    free(gen.start);
+    free(gen.end);
+    free(gen.reg);
+    free(gen.slot);
+    free(gen.def_position);
+    free(gen.term_position);
+    free(gen.block_pc);
+    free(gen.fixups);
+    free(gen.constant_map.keys);
+    free(gen.constant_map.values);
+    free(gen.variant_map.keys);
+    free(gen.variant_map.values);
+    if (gen.failed) {
+        bc_program_destroy(gen.out);
+        return NULL;
+    }
+    return gen.out;
+}
+
+void bc_program_destroy(BcProgram* program) {
+    if (!program) return;
+    for (uint32_t s = 0; s < program->string_count; ++s) free(program->strings[s]);
+    free(program->strings);
+    free(program->code);
+    free(program->constants);
+    free(program->variants);
+    free(program->switches);
+    free(program->targets);
+    free(program->globals);
+    free(program);
+}
+
+// --- Printing ---
+
+const char* bc_opcode_name(BcOpcode op) {
+    static const char* const names[] = {
+#define BC_NAME(name, operands) #name,
+        BC_OPCODES(BC_NAME)
+#undef BC_NAME
+    };
+    return op < BC_OPCODE_COUNT ? names[op] : "?";
+}
+
+static void print_constant(const BcProgram* program, Value value, FILE* out) {
+    switch (value_kind(value)) {
+        case VALUE_INT: fprintf(out, "%d", value_as_int(value)); break;
+        case VALUE_BOOL: fputs(value >> 32 ? "true" : "false", out); break;
+        case VALUE_STRING: fprintf(out, "\"%s\"", program->strings[value >> 32]); break;
+        case VALUE_SMALL: {
+            const BcVariant* variant = &program->variants[value_small_variant(value)];
+            fprintf(out, "%.*s", (int)variant->name.length, variant->name.lexeme);
+            break;
+        }
+        default: fputs("undef", out); break;
+    }
+}
+
+uint32_t bc_instr_words(const BcProgram* program, uint32_t pc) {
+    BcInstr i = program->code[pc];
+    switch (BC_OP(i)) {
+        case BC_CONSTRUCT: return 1 + (program->variants[BC_BX(i)].field_count + 3) / 4;
+        case BC_CONSTRUCT_SMALL: return 2;
+        default: return 1;
+    }
+}
+
+void bc_print(const BcProgram* program, FILE* out) {
+    for (uint32_t pc = 0; pc < program->code_count; ++pc) {
+        BcInstr i = program->code[pc];
+        BcOpcode op = BC_OP(i);
+        fprintf(out, "%6u  %-16s", pc, bc_opcode_name(op));
+        switch (op) {
+            case BC_MOVE: case BC_TAG: case BC_BORROW:
+                fprintf(out, "r%u r%u", BC_A(i), BC_B(i));
+                break;
+            case BC_PROJECT:
+                fprintf(out, "r%u r%u %u", BC_A(i), BC_B(i), BC_C(i));
+                break;
+            case BC_EQ:
+                fprintf(out, "r%u r%u r%u", BC_A(i), BC_B(i), BC_C(i));
+                break;
+            case BC_LOADK:
+                fprintf(out, "r%u k%u ; ", BC_A(i), BC_BX(i));
+                print_constant(program, program->constants[BC_BX(i)], out);
+                break;
+            case BC_CONSTRUCT: {
+                const BcVariant* variant = &program->variants[BC_BX(i)];
+                fprintf(out, "r%u %.*s", BC_A(i), (int)variant->name.length, variant->name.lexeme);
+                for (uint32_t f = 0; f < variant->field_count; ++f) {
+                    fprintf(out, " r%u", (program->code[pc + 1 + f / 4] >> (8 * (f % 4))) & 0xff);
+                }
+                break;
+            }
+            case BC_CONSTRUCT_SMALL: {
+                const BcVariant* variant = &program->variants[value_small_variant(program->code[pc + 1])];
+                fprintf(out, "r%u %.*s r%u", BC_A(i), (int)variant->name.length, variant->name.lexeme, BC_B(i));
+                break;
+            }
+            case BC_SETGLOBAL: {
+                const IrGlobal* global = &program->globals[BC_BX(i)];
+                fprintf(out, "r%u g%u ; %.*s", BC_A(i), BC_BX(i), (int)global->name.length, global->name.lexeme);
+                break;
+            }
+            case BC_SPILL: case BC_RELOAD:
+                fprintf(out, "r%u s%u", BC_A(i), BC_BX(i));
+                break;
+            case BC_JMP:
+                fprintf(out, "-> %d", (int)pc + 1 + BC_SJ(i));
+                break;
+            case BC_TEST:
+                fprintf(out, "r%u", BC_A(i));
+                break;
+            case BC_SWITCH: {
+                const BcSwitch* table = &program->switches[BC_BX(i)];
+                fprintf(out, "r%u", BC_A(i));
+                for (uint32_t t = 0; t < table->count; ++t) {
+                    fprintf(out, " %lld->%u", (long long)(table->low + t), program->targets[table->first + t]);
+                }
+                fprintf(out, " else->%u", program->targets[table->fallback]);
+                break;
+            }
+            default:
+                break;
+        }
+        fputc('\n', out);
+        pc += bc_instr_words(program, pc) - 1;
+    }
+}
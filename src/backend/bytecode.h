@@ -0,0 +1,117 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h> // For FILE*
+#include "../core/ir.h"
+#include "value.h"
+
+// Register-based bytecode for the VM (vm.h), compiled from the optimized IR.
+//
+// Instructions are 32-bit words: the opcode in bits 0..7 and register A in
+// 8..15, then either registers B (16..23) and C (24..31), an unsigned Bx
+// (16..31), or, for BC_JMP, a signed offset sJ in 8..31 taking the place of A.
+// Some instructions are followed by extra words, listed with each opcode.
+//
+// Each IR value gets one of BC_ALLOC_REGISTERS registers by linear scan over
+// its live range in block order, or else a spill slot. Constants are loaded
+// where they are used. The registers from BC_ALLOC_REGISTERS up are scratch
+// space for reloaded spills and constants within one instruction. Block
+// parameters are assigned by moves on the edge leading to the block.
+
+typedef uint32_t BcInstr;
+
+#define BC_REGISTERS       256
+#define BC_ALLOC_REGISTERS 192
+
+// X(name, operands)
+#define BC_OPCODES(X)                                                                                     \
+    X(MOVE, "A B: R[A] = R[B]")                                                                           \
+    X(LOADK, "A Bx: R[A] = K[Bx]")                                                                        \
+    X(CONSTRUCT, "A Bx: R[A] = new object of variant Bx; then one word per 4 fields, a register per byte") \
+    X(CONSTRUCT_SMALL, "A B: R[A] = VALUE_SMALL with payload R[B]; bits 0..31 in the next word")            \
+    X(PROJECT, "A B C: R[A] = field C of R[B]")                                                           \
+    X(TAG, "A B: R[A] = variant tag of R[B]")                                                             \
+    X(EQ, "A B C: R[A] = R[B] == R[C]")                                                                   \
+    X(BORROW, "A B: R[A] = reference to a copy of R[B]")                                                  \
+    X(SETGLOBAL, "A Bx: G[Bx] = R[A]")                                                                    \
+    X(SPILL, "A Bx: S[Bx] = R[A]")                                                                        \
+    X(RELOAD, "A Bx: R[A] = S[Bx]")                                                                       \
+    X(JMP, "sJ: pc += sJ")                                                                                \
+    X(TEST, "A: if R[A] is false, skip the next instruction")                                             \
+    X(SWITCH, "A Bx: jump through table Bx on R[A]")                                                      \
+    X(HALT, "end of the program")                                                                         \
+    X(UNREACHABLE, "error: no arm of a match applied")
+
+typedef enum {
+#define BC_ENUM(name, operands) BC_##name,
+    BC_OPCODES(BC_ENUM)
+#undef BC_ENUM
+    BC_OPCODE_COUNT
+} BcOpcode;
+
+#define BC_OP(i) ((BcOpcode)((i) & 0xff))
+#define BC_A(i)  (((i) >> 8) & 0xff)
+#define BC_B(i)  (((i) >> 16) & 0xff)
+#define BC_C(i)  ((i) >> 24)
+#define BC_BX(i) ((i) >> 16)
+#define BC_SJ(i) ((int32_t)(i) >> 8)
+
+#define BC_ABC(op, a, b, c) ((BcInstr)(op) | ((BcInstr)(a) << 8) | ((BcInstr)(b) << 16) | ((BcInstr)(c) << 24))
+#define BC_ABX(op, a, bx)   ((BcInstr)(op) | ((BcInstr)(a) << 8) | ((BcInstr)(bx) << 16))
+#define BC_SJX(op, sj)      ((BcInstr)(op) | ((BcInstr)(sj) << 8))
+
+#define BC_MAX_BX 0xffffu
+#define BC_MAX_SJ 0x7fffff
+
+// A variant of an ADT, as objects and small values refer to it.
+typedef struct {
+    Token name;
+    uint32_t tag;
+    uint32_t field_count;
+} BcVariant;
+
+// Dense jump table: R[A] - low selects targets[first + ...], anything outside
+// [low, low + count) goes to `fallback`. Targets are code indices.
+typedef struct {
+    int64_t low;
+    uint32_t count;
+    uint32_t first;
+    uint32_t fallback;
+} BcSwitch;
+
+typedef struct {
+    BcInstr* code;
+    uint32_t code_count, code_capacity;
+    Value* constants;
+    uint32_t constant_count, constant_capacity;
+    BcVariant* variants;
+    uint32_t variant_count, variant_capacity;
+    BcSwitch* switches;
+    uint32_t switch_count, switch_capacity;
+    uint32_t* targets; // Jump table entries
+    uint32_t target_count, target_capacity;
+    char** strings;    // VALUE_STRING indices; owned
+    uint32_t string_count;
+    IrGlobal* globals; // Each `let`, by SETGLOBAL index
+    uint32_t global_count;
+    uint32_t spill_count;
+} BcProgram;
+
+// Compiles an optimized IrProgram (see ir_opt.h). Returns NULL, after
+// reporting on stderr, if out of memory or the program exceeds a limit of the
+// encoding (65536 constants, variants, spill slots or globals; more spilled or
+// constant operands in one instruction than scratch registers).
+BcProgram* bc_compile(const IrProgram* program);
+void bc_program_destroy(BcProgram* program);
+
+const char* bc_opcode_name(BcOpcode op);
+
+// Words the instruction at `pc` takes, counting the ones that follow it.
+uint32_t bc_instr_words(const BcProgram* program, uint32_t pc);
+
+// Writes a readable listing, one instruction per line.
+void bc_print(const BcProgram* program, FILE* out);
+
+#endif // BYTECODE_H
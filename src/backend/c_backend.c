@@ -0,0 +1,1058 @@
+#include "c_backend.h"
+#include "toolchain.h"
+#include "../util/string_builder.h"
+#include "../util/task_graph.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // For memset, strlen
+
+// A new function starts at the first cut after this many statements, which
+// keeps the C compiler's per-function passes from going superlinear.
+#define FUNCTION_TARGET_INSTRS 256
+
+typedef enum { TYPE_UNSEEN, TYPE_SEEN, TYPE_DEFINED } TypeState;
+
+// A run of at most FUNCTION_TARGET_INSTRS instructions of one block. Control
+// runs straight through a block, so a function may end between two pieces of it.
+typedef struct {
+    uint32_t block;
+    uint32_t first_instr;
+    uint32_t instr_count;
+    bool first;           // Starts the block: has its label and parameters
+    bool last;            // Ends the block: has its terminator
+} Piece;
+
+typedef struct {
+    const IrProgram* program;
+    ADTInstanceCache* instances;
+    const CBackendOptions* options;
+
+    // Types of values and globals, without generic parameters or inference
+    // variables (see ground)
+    Type** value_types;
+    Type** global_types;
+    Type** grounded;        // Memo of ground, indexed by the original Type.id
+    uint32_t ground_capacity;
+
+    // Types, indexed by Type.id
+    char** ctype;           // C spelling of every type in use
+    uint8_t* type_state;    // TypeState
+    bool* boxed;            // Stored behind a pointer somewhere: needs a mylang_box helper
+    uint32_t type_capacity;
+    Type** adts;            // ADT types, each after the ones its fields hold by value
+    size_t adt_count;
+    Type** casts;           // Pairs of types: casts[2 * i] is converted to casts[2 * i + 1] (see add_cast)
+    size_t cast_count, cast_capacity;
+
+    // Placement of the code
+    uint32_t* order;           // Reachable blocks in reverse postorder
+    uint32_t order_count;
+    Piece* pieces;             // The blocks of `order`, cut into pieces
+    uint32_t piece_count;
+    uint32_t* function_of;     // Per block: the function of its first piece
+    uint32_t* function_first;  // Function f is pieces[function_first[f], function_first[f + 1])
+    uint32_t function_count;
+    uint32_t* shard_first;     // Shard s runs functions [shard_first[s], shard_first[s + 1])
+    uint32_t shard_count;
+    bool* shared;              // Per value: a C global rather than a local
+    uint32_t* value_function;  // Per value: the function defining it
+} CGen;
+
+typedef struct {
+    CGen* gen;
+    const char* dir;
+    size_t* bytes; // Per file
+    bool* failed;  // Per file
+} EmitTask;
+
+// --- Types ---
+
+static bool is_concrete(Type* type) {
+    return !(type->flags & (TYPE_HAS_PARAMS | TYPE_HAS_VARS));
+}
+
+// Replaces the generic parameters and inference variables left in `type` by
+// i32. No value of such a type exists at run time (`let n = Nil;` has type
+// List<'a> but holds no element), so any inhabited type gives the same layout,
+// and equal shapes get one C type: two `None`s with distinct variables are
+// both Option<i32>. Returns NULL if out of memory.
+static Type* ground(CGen* gen, Type* type) {
+    if (!type || is_concrete(type)) return type;
+    if (type->id < gen->ground_capacity && gen->grounded[type->id]) return gen->grounded[type->id];
+    Type* result = type;
+    switch (type->kind) {
+        case TYPE_GENERIC_PARAM:
+        case TYPE_VAR:
+            result = type_i32_instance;
+            break;
+        case TYPE_REFERENCE: {
+            TypeReference* reference = (TypeReference*)type;
+            Type* referent = ground(gen, reference->referent);
+            result = referent ? type_intern_reference(referent, reference->is_mutable) : NULL;
+            break;
+        }
+        case TYPE_ADT: {
+            TypeADT* adt = (TypeADT*)type;
+            Type** args = (Type**)malloc((adt->type_arg_count + 1) * sizeof(Type*));
+            bool ok = args != NULL;
+            for (size_t i = 0; ok && i < adt->type_arg_count; ++i) ok = (args[i] = ground(gen, adt->type_args[i])) != NULL;
+            result = ok ? type_intern_adt(adt->adt_symbol, args, adt->type_arg_count) : NULL;
+            free(args);
+            break;
+        }
+        default:
+            break;
+    }
+    if (result && type->id < gen->ground_capacity) gen->grounded[type->id] = result;
+    return result;
+}
+
+static char* copy_string(const char* text) {
+    size_t length = strlen(text);
+    char* copy = (char*)malloc(length + 1);
+    if (copy) memcpy(copy, text, length + 1);
+    return copy;
+}
+
+static const char* ctype_of(const CGen* gen, Type* type) {
+    return type && type->id < gen->type_capacity && gen->ctype[type->id] ? gen->ctype[type->id] : "mylang_unit";
+}
+
+static const ADTInstance* instance_of(const CGen* gen, Type* type) {
+    return type->kind == TYPE_ADT && is_concrete(type) ? adt_instance_get(gen->instances, type) : NULL;
+}
+
+static bool field_is_boxed(const ADTInstanceVariant* variant, size_t field) {
+    return ((ADTFieldSymbol*)da_get(variant->variant->fields, field))->boxed;
+}
+
+// Names `type` and, first, every type its values contain by value.
+static bool collect_type(CGen* gen, Type* type) {
+    if (!type || type->id >= gen->type_capacity || gen->type_state[type->id] != TYPE_UNSEEN) return true;
+    gen->type_state[type->id] = TYPE_SEEN;
+    char name[64];
+    const char* spelling = "mylang_unit";
+    switch (type->kind) {
+        case TYPE_PRIMITIVE:
+            if (type == type_i32_instance) spelling = "int32_t";
+            else if (type == type_bool_instance) spelling = "bool";
+            else if (type == type_string_instance) spelling = "const char*";
+            break;
+        case TYPE_REFERENCE: {
+            Type* referent = ((TypeReference*)type)->referent;
+            if (!collect_type(gen, referent)) return false;
+            snprintf(name, sizeof(name), "%.60s*", ctype_of(gen, referent));
+            spelling = name;
+            break;
+        }
+        case TYPE_ADT:
+            snprintf(name, sizeof(name), "mylang_t%u", type->id);
+            spelling = name;
+            break;
+        default:
+            break;
+    }
+    gen->ctype[type->id] = copy_string(spelling);
+    if (!gen->ctype[type->id]) return false;
+    if (type->kind != TYPE_ADT) {
+        gen->type_state[type->id] = TYPE_DEFINED;
+        return true;
+    }
+    const ADTInstance* instance = instance_of(gen, type);
+    for (size_t v = 0; instance && v < instance->variant_count; ++v) {
+        const ADTInstanceVariant* variant = &instance->variants[v];
+        for (size_t f = 0; f < variant->field_count; ++f) {
+            Type* field = variant->field_types[f];
+            if (!collect_type(gen, field)) return false;
+            if (field_is_boxed(variant, f) && field->id < gen->type_capacity) gen->boxed[field->id] = true;
+        }
+    }
+    gen->type_state[type->id] = TYPE_DEFINED;
+    gen->adts[gen->adt_count++] = type;
+    return true;
+}
+
+// A value keeps the type it was defined at, which for a generic `let` is not
+// the type it is used at: `let a = Nil;` is a List<'a>, grounded to List<i32>,
+// and `Cons(Some(1), a)` stores it as a List<Option<i32>>. These are distinct
+// C types, so such a use goes through mylang_cast<from>_<to>, which rebuilds
+// the value at the other type, field by field. Where the two types disagree
+// the source holds a generic parameter, so no value is ever found there.
+static bool add_cast(CGen* gen, Type* from, Type* to) {
+    if (!from || !to || from == to) return true;
+    for (size_t i = 0; i < gen->cast_count; ++i) {
+        if (gen->casts[2 * i] == from && gen->casts[2 * i + 1] == to) return true;
+    }
+    if (gen->cast_count == gen->cast_capacity) {
+        size_t capacity = gen->cast_capacity ? gen->cast_capacity * 2 : 8;
+        Type** casts = (Type**)realloc(gen->casts, 2 * capacity * sizeof(Type*));
+        if (!casts) return false;
+        gen->casts = casts;
+        gen->cast_capacity = capacity;
+    }
+    gen->casts[2 * gen->cast_count] = from;
+    gen->casts[2 * gen->cast_count + 1] = to;
+    gen->cast_count++;
+    if (from->kind == TYPE_REFERENCE && to->kind == TYPE_REFERENCE) {
+        return add_cast(gen, ((TypeReference*)from)->referent, ((TypeReference*)to)->referent);
+    }
+    const ADTInstance* source = instance_of(gen, from);
+    const ADTInstance* target = instance_of(gen, to);
+    if (!source || !target || ((TypeADT*)from)->adt_symbol != ((TypeADT*)to)->adt_symbol) return true;
+    for (size_t v = 0; v < source->variant_count && v < target->variant_count; ++v) {
+        const ADTInstanceVariant* a = &source->variants[v];
+        const ADTInstanceVariant* b = &target->variants[v];
+        for (size_t f = 0; f < a->field_count && f < b->field_count; ++f) {
+            if (!add_cast(gen, a->field_types[f], b->field_types[f])) return false;
+        }
+    }
+    return true;
+}
+
+static Type* field_type(const CGen* gen, Type* adt, uint32_t tag, size_t field) {
+    const ADTInstance* instance = instance_of(gen, adt);
+    if (!instance || tag >= instance->variant_count || field >= instance->variants[tag].field_count) return NULL;
+    return instance->variants[tag].field_types[field];
+}
+
+// Finds the uses of values at a type other than their own: fields of a
+// construction, projections, exports and edge arguments.
+static bool find_casts(CGen* gen) {
+    const IrProgram* program = gen->program;
+    for (IrValue v = 0; v < program->instr_count; ++v) {
+        const IrInstr* instr = &program->instrs[v];
+        const IrValue* operands = ir_operands(program, instr);
+        bool ok = true;
+        if (instr->op == IR_CONSTRUCT) {
+            for (uint32_t o = 0; o < instr->operand_count && ok; ++o) {
+                ok = add_cast(gen, gen->value_types[operands[o]], field_type(gen, gen->value_types[v], instr->tag, o));
+            }
+        } else if (instr->op == IR_PROJECT) {
+            ok = add_cast(gen, field_type(gen, gen->value_types[operands[0]], instr->tag, (size_t)instr->imm),
+                          gen->value_types[v]);
+        } else if (instr->op == IR_EXPORT) {
+            ok = add_cast(gen, gen->value_types[operands[0]], gen->global_types[instr->imm]);
+        }
+        if (!ok) return false;
+    }
+    for (uint32_t e = 0; e < program->edge_count; ++e) {
+        const IrEdge* edge = &program->edges[e];
+        const IrBlock* target = &program->blocks[edge->target];
+        for (uint32_t a = 0; a < edge->arg_count; ++a) {
+            if (!add_cast(gen, gen->value_types[program->operands[edge->first_arg + a]],
+                          gen->value_types[program->operands[target->first_param + a]])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool has_data(const ADTInstance* instance) {
+    for (size_t v = 0; instance && v < instance->variant_count; ++v) {
+        if (instance->variants[v].field_count > 0) return true;
+    }
+    return false;
+}
+
+// --- Placement ---
+
+// Reverse postorder of the reachable blocks, with positions.
+static bool order_blocks(CGen* gen, uint32_t* position) {
+    gen->order_count = ir_reverse_postorder(gen->program, gen->order);
+    if (gen->order_count == UINT32_MAX) return false;
+    for (uint32_t i = 0; i < gen->order_count; ++i) position[gen->order[i]] = i;
+    return true;
+}
+
+static bool is_constant(const IrInstr* instr) {
+    return instr->op == IR_CONST_INT || instr->op == IR_CONST_BOOL || instr->op == IR_CONST_STRING;
+}
+
+// Constants are written as literals where they are used, unless borrowed.
+// ir_compact gathers them in the entry block, so as variables they would be
+// globals read all over the program.
+static bool is_inlined(const CGen* gen, IrValue value) {
+    return value < gen->program->instr_count && is_constant(&gen->program->instrs[value]) && !gen->shared[value];
+}
+
+// Statements the piece becomes.
+static uint32_t piece_size(const CGen* gen, const Piece* piece) {
+    const IrBlock* block = &gen->program->blocks[piece->block];
+    uint32_t size = (piece->first ? block->param_count : 0) + (piece->last ? 1 : 0);
+    for (uint32_t i = piece->first_instr; i < piece->first_instr + piece->instr_count; ++i) {
+        if (!is_inlined(gen, i)) size++;
+    }
+    return size;
+}
+
+// Cuts the blocks, in order, into pieces; `position` becomes the index of
+// each block's first piece. Returns false if out of memory.
+static bool cut_pieces(CGen* gen, uint32_t* position) {
+    const IrProgram* program = gen->program;
+    size_t count = 0;
+    for (uint32_t p = 0; p < gen->order_count; ++p) {
+        count += program->blocks[gen->order[p]].instr_count / FUNCTION_TARGET_INSTRS + 1;
+    }
+    gen->pieces = (Piece*)malloc(count * sizeof(Piece));
+    if (!gen->pieces) return false;
+    gen->piece_count = 0;
+    for (uint32_t p = 0; p < gen->order_count; ++p) {
+        uint32_t b = gen->order[p];
+        const IrBlock* block = &program->blocks[b];
+        position[b] = gen->piece_count;
+        uint32_t done = 0;
+        do {
+            uint32_t size = block->instr_count - done;
+            if (size > FUNCTION_TARGET_INSTRS) size = FUNCTION_TARGET_INSTRS;
+            gen->pieces[gen->piece_count++] =
+                (Piece){b, block->first_instr + done, size, done == 0, done + size == block->instr_count};
+            done += size;
+        } while (done < block->instr_count);
+    }
+    return true;
+}
+
+// Splits the pieces into functions at cuts, the points every path passes
+// through: in order, a piece is a cut if no edge from an earlier piece jumps
+// past it, which always holds within a block. Control then enters a function
+// only at its first piece and leaves only to the next function's first piece.
+static void place_functions(CGen* gen, const uint32_t* position) {
+    const IrProgram* program = gen->program;
+    uint32_t farthest = 0, size = 0;
+    gen->function_count = 0;
+    for (uint32_t p = 0; p < gen->piece_count; ++p) {
+        const Piece* piece = &gen->pieces[p];
+        if (p == 0 || (farthest <= p && size >= FUNCTION_TARGET_INSTRS)) {
+            gen->function_first[gen->function_count++] = p;
+            size = 0;
+        }
+        if (piece->first) gen->function_of[piece->block] = gen->function_count - 1;
+        size += piece_size(gen, piece);
+        if (!piece->last) continue;
+        const IrBlock* block = &program->blocks[piece->block];
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+            uint32_t target = position[program->edges[e].target];
+            if (target > farthest) farthest = target;
+        }
+    }
+    gen->function_first[gen->function_count] = gen->piece_count;
+}
+
+// The function piece `p` is in.
+static uint32_t function_of_piece(const CGen* gen, uint32_t p) {
+    uint32_t low = 0, high = gen->function_count;
+    while (high - low > 1) {
+        uint32_t mid = low + (high - low) / 2;
+        if (gen->function_first[mid] <= p) low = mid;
+        else high = mid;
+    }
+    return low;
+}
+
+// Groups consecutive functions into shards of about equal size.
+static void place_shards(CGen* gen) {
+    size_t wanted = gen->options->shards;
+    if (wanted == 0) wanted = gen->options->jobs ? gen->options->jobs : task_graph_default_workers();
+    uint64_t total = 0;
+    for (uint32_t p = 0; p < gen->piece_count; ++p) total += piece_size(gen, &gen->pieces[p]);
+    uint64_t before = 0;
+    uint32_t last = UINT32_MAX;
+    gen->shard_count = 0;
+    for (uint32_t f = 0; f < gen->function_count; ++f) {
+        uint32_t shard = (uint32_t)(before * wanted / (total ? total : 1));
+        if (shard != last) {
+            gen->shard_first[gen->shard_count++] = f;
+            last = shard;
+        }
+        for (uint32_t p = gen->function_first[f]; p < gen->function_first[f + 1]; ++p) {
+            before += piece_size(gen, &gen->pieces[p]);
+        }
+    }
+    gen->shard_first[gen->shard_count] = gen->function_count;
+}
+
+// Borrowed values must live in memory, constants included.
+static void find_borrowed_values(CGen* gen) {
+    const IrProgram* program = gen->program;
+    for (IrValue v = 0; v < program->instr_count; ++v) {
+        const IrInstr* instr = &program->instrs[v];
+        if (instr->op == IR_BORROW) gen->shared[ir_operands(program, instr)[0]] = true;
+    }
+}
+
+static void use_value(CGen* gen, IrValue value, uint32_t function) {
+    if (!is_inlined(gen, value) && gen->value_function[value] != function) gen->shared[value] = true;
+}
+
+// Decides which values must be C globals: those used by another function, and
+// borrowed ones (see find_borrowed_values), whose address outlives the function.
+static void find_shared_values(CGen* gen) {
+    const IrProgram* program = gen->program;
+    for (uint32_t p = 0; p < gen->piece_count; ++p) {
+        const Piece* piece = &gen->pieces[p];
+        const IrBlock* block = &program->blocks[piece->block];
+        uint32_t function = function_of_piece(gen, p);
+        for (uint32_t i = 0; piece->first && i < block->param_count; ++i) {
+            gen->value_function[program->operands[block->first_param + i]] = function;
+        }
+        for (uint32_t i = piece->first_instr; i < piece->first_instr + piece->instr_count; ++i) {
+            gen->value_function[i] = function;
+        }
+    }
+    for (uint32_t p = 0; p < gen->piece_count; ++p) {
+        const Piece* piece = &gen->pieces[p];
+        const IrBlock* block = &program->blocks[piece->block];
+        uint32_t function = function_of_piece(gen, p);
+        for (uint32_t i = piece->first_instr; i < piece->first_instr + piece->instr_count; ++i) {
+            const IrInstr* instr = &program->instrs[i];
+            const IrValue* operands = ir_operands(program, instr);
+            for (uint32_t o = 0; o < instr->operand_count; ++o) use_value(gen, operands[o], function);
+        }
+        if (!piece->last) continue;
+        if (block->cond != IR_NO_VALUE) use_value(gen, block->cond, function);
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+            const IrEdge* edge = &program->edges[e];
+            const IrBlock* target = &program->blocks[edge->target];
+            for (uint32_t a = 0; a < edge->arg_count; ++a) {
+                use_value(gen, program->operands[edge->first_arg + a], function);
+                // The parameter is assigned here, in the predecessor's function.
+                use_value(gen, program->operands[target->first_param + a], function);
+            }
+        }
+    }
+}
+
+// --- Emission ---
+
+static void append_string_literal(StringBuilder* out, const char* text) {
+    sb_append_char(out, '"');
+    for (const unsigned char* c = (const unsigned char*)text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            sb_append_char(out, '\\');
+            sb_append_char(out, (char)*c);
+        } else if (*c >= 0x20 && *c < 0x7f && *c != '?') { // '?' could start a trigraph
+            sb_append_char(out, (char)*c);
+        } else {
+            sb_appendf(out, "\\%03o", *c);
+        }
+    }
+    sb_append_char(out, '"');
+}
+
+static void append_constant(StringBuilder* out, const CGen* gen, const IrInstr* instr) {
+    if (instr->op == IR_CONST_STRING) append_string_literal(out, gen->program->strings[instr->imm]);
+    else if (instr->op == IR_CONST_BOOL) sb_append_str(out, instr->imm ? "true" : "false");
+    else if (instr->imm == INT32_MIN) sb_append_str(out, "INT32_MIN");
+    else sb_appendf(out, "%lld", (long long)instr->imm);
+}
+
+static void append_value(StringBuilder* out, const CGen* gen, IrValue value) {
+    if (is_inlined(gen, value)) append_constant(out, gen, &gen->program->instrs[value]);
+    else sb_appendf(out, gen->shared[value] ? "mylang_v%u" : "v%u", value);
+}
+
+// Writes `value` converted to `type` (see add_cast).
+static void append_value_as(StringBuilder* out, const CGen* gen, IrValue value, Type* type) {
+    Type* from = gen->value_types[value];
+    bool cast = from && type && from != type;
+    if (cast) sb_appendf(out, "mylang_cast%u_%u(", from->id, type->id);
+    append_value(out, gen, value);
+    if (cast) sb_append_char(out, ')');
+}
+
+static void emit_instr(StringBuilder* out, const CGen* gen, IrValue value) {
+    const IrProgram* program = gen->program;
+    const IrInstr* instr = &program->instrs[value];
+    const IrValue* operands = ir_operands(program, instr);
+    if (instr->op == IR_NOP || is_inlined(gen, value)) return;
+    if (instr->op == IR_EXPORT) {
+        sb_appendf(out, "    mylang_g%u = ", (unsigned)instr->imm);
+        append_value_as(out, gen, operands[0], gen->global_types[instr->imm]);
+        sb_append_str(out, ";\n");
+        return;
+    }
+    sb_append_str(out, "    ");
+    append_value(out, gen, value);
+    sb_append_str(out, " = ");
+    switch ((IrOp)instr->op) {
+        case IR_CONST_INT:
+        case IR_CONST_BOOL:
+        case IR_CONST_STRING:
+            append_constant(out, gen, instr);
+            break;
+        case IR_CONSTRUCT: {
+            const ADTInstance* instance = instance_of(gen, gen->value_types[value]);
+            sb_appendf(out, "(%s){.tag = %u", ctype_of(gen, gen->value_types[value]), instr->tag);
+            if (instance && instr->tag < instance->variant_count && instr->operand_count > 0) {
+                const ADTInstanceVariant* variant = &instance->variants[instr->tag];
+                sb_appendf(out, ", .u.v%u = {", instr->tag);
+                for (uint32_t o = 0; o < instr->operand_count && o < variant->field_count; ++o) {
+                    if (o) sb_append_str(out, ", ");
+                    if (field_is_boxed(variant, o)) sb_appendf(out, "mylang_box%u(", variant->field_types[o]->id);
+                    append_value_as(out, gen, operands[o], variant->field_types[o]);
+                    if (field_is_boxed(variant, o)) sb_append_char(out, ')');
+                }
+                sb_append_char(out, '}');
+            }
+            sb_append_char(out, '}');
+            break;
+        }
+        case IR_PROJECT: {
+            Type* adt = gen->value_types[operands[0]];
+            const ADTInstance* instance = instance_of(gen, adt);
+            if (!instance || instr->tag >= instance->variant_count ||
+                (size_t)instr->imm >= instance->variants[instr->tag].field_count) {
+                sb_appendf(out, "(%s){0}", ctype_of(gen, gen->value_types[value]));
+                break;
+            }
+            Type* field = instance->variants[instr->tag].field_types[instr->imm];
+            bool cast = field != gen->value_types[value];
+            if (cast) sb_appendf(out, "mylang_cast%u_%u(", field->id, gen->value_types[value]->id);
+            if (field_is_boxed(&instance->variants[instr->tag], (size_t)instr->imm)) sb_append_char(out, '*');
+            append_value(out, gen, operands[0]);
+            sb_appendf(out, ".u.v%u.f%u", instr->tag, (unsigned)instr->imm);
+            if (cast) sb_append_char(out, ')');
+            break;
+        }
+        case IR_TAG:
+            sb_append_str(out, "(int32_t)");
+            append_value(out, gen, operands[0]);
+            sb_append_str(out, ".tag");
+            break;
+        case IR_EQ: {
+            bool strings = gen->value_types[operands[0]] == type_string_instance;
+            if (strings) sb_append_str(out, "strcmp(");
+            append_value(out, gen, operands[0]);
+            sb_append_str(out, strings ? ", " : " == ");
+            append_value(out, gen, operands[1]);
+            if (strings) sb_append_str(out, ") == 0");
+            break;
+        }
+        case IR_BORROW:
+            sb_append_char(out, '&');
+            append_value(out, gen, operands[0]);
+            break;
+        default: // IR_UNDEF
+            sb_appendf(out, "(%s){0}", ctype_of(gen, gen->value_types[value]));
+            break;
+    }
+    sb_append_str(out, ";\n");
+}
+
+// Passes the edge's arguments, then continues at its target: a jump within the
+// function, or a return to the caller, which runs the target's function next.
+static void emit_edge(StringBuilder* out, const CGen* gen, const IrEdge* edge, uint32_t function, const char* indent) {
+    const IrProgram* program = gen->program;
+    const IrBlock* target = &program->blocks[edge->target];
+    for (uint32_t a = 0; a < edge->arg_count; ++a) {
+        sb_append_str(out, indent);
+        IrValue param = program->operands[target->first_param + a];
+        append_value(out, gen, param);
+        sb_append_str(out, " = ");
+        append_value_as(out, gen, program->operands[edge->first_arg + a], gen->value_types[param]);
+        sb_append_str(out, ";\n");
+    }
+    if (gen->function_of[edge->target] == function) sb_appendf(out, "%sgoto b%u;\n", indent, edge->target);
+    else sb_appendf(out, "%sreturn;\n", indent);
+}
+
+static void emit_terminator(StringBuilder* out, const CGen* gen, const IrBlock* block, uint32_t function) {
+    const IrEdge* edges = gen->program->edges + block->first_edge;
+    switch ((IrTermKind)block->term) {
+        case IR_TERM_JUMP:
+            emit_edge(out, gen, &edges[0], function, "    ");
+            break;
+        case IR_TERM_BRANCH:
+            sb_append_str(out, "    if (");
+            append_value(out, gen, block->cond);
+            sb_append_str(out, ") {\n");
+            emit_edge(out, gen, &edges[0], function, "        ");
+            sb_append_str(out, "    }\n");
+            emit_edge(out, gen, &edges[1], function, "    ");
+            break;
+        case IR_TERM_SWITCH:
+            sb_append_str(out, "    switch (");
+            append_value(out, gen, block->cond);
+            sb_append_str(out, ") {\n");
+            for (uint32_t e = 0; e < block->edge_count; ++e) {
+                if (e + 1 < block->edge_count) sb_appendf(out, "    case %lld:\n", (long long)edges[e].case_value);
+                else sb_append_str(out, "    default:\n");
+                emit_edge(out, gen, &edges[e], function, "        ");
+            }
+            sb_append_str(out, "    }\n");
+            break;
+        case IR_TERM_RETURN:
+            sb_append_str(out, "    return;\n");
+            break;
+        default: // The match was exhaustive; getting here means a compiler bug.
+            sb_append_str(out, "    abort();\n");
+            break;
+    }
+}
+
+static void declare_local(StringBuilder* out, const CGen* gen, IrValue value) {
+    if (gen->shared[value] || is_inlined(gen, value)) return;
+    sb_appendf(out, "    %s v%u;\n", ctype_of(gen, gen->value_types[value]), value);
+}
+
+static void emit_function(StringBuilder* out, const CGen* gen, uint32_t function) {
+    const IrProgram* program = gen->program;
+    uint32_t first = gen->function_first[function], end = gen->function_first[function + 1];
+    // Inlined into the shard's entry point, the functions would make up one
+    // function as large as the shard again.
+    sb_appendf(out, "static __attribute__((noinline)) void mylang_f%u(void) {\n", function);
+    for (uint32_t p = first; p < end; ++p) {
+        const Piece* piece = &gen->pieces[p];
+        const IrBlock* block = &program->blocks[piece->block];
+        for (uint32_t i = 0; piece->first && i < block->param_count; ++i) {
+            declare_local(out, gen, program->operands[block->first_param + i]);
+        }
+        for (uint32_t i = piece->first_instr; i < piece->first_instr + piece->instr_count; ++i) {
+            IrOp op = (IrOp)program->instrs[i].op;
+            if (op != IR_NOP && op != IR_EXPORT) declare_local(out, gen, i);
+        }
+    }
+    // A piece that does not end its block falls through to the next one, or,
+    // last in the function, returns to the caller, which runs the rest.
+    for (uint32_t p = first; p < end; ++p) {
+        const Piece* piece = &gen->pieces[p];
+        if (piece->first) sb_appendf(out, "b%u:;\n", piece->block);
+        for (uint32_t i = piece->first_instr; i < piece->first_instr + piece->instr_count; ++i) emit_instr(out, gen, i);
+        if (piece->last) emit_terminator(out, gen, &program->blocks[piece->block], function);
+    }
+    sb_append_str(out, "}\n\n");
+}
+
+static void emit_shard(StringBuilder* out, const CGen* gen, uint32_t shard) {
+    const IrProgram* program = gen->program;
+    sb_append_str(out, "#include \"mylang.h\"\n\n");
+    uint32_t first = gen->shard_first[shard], end = gen->shard_first[shard + 1];
+    // Definitions of the globals this shard's functions define.
+    for (uint32_t p = gen->function_first[first]; p < gen->function_first[end]; ++p) {
+        const Piece* piece = &gen->pieces[p];
+        const IrBlock* block = &program->blocks[piece->block];
+        for (uint32_t i = 0; piece->first && i < block->param_count; ++i) {
+            IrValue param = program->operands[block->first_param + i];
+            if (gen->shared[param]) sb_appendf(out, "%s mylang_v%u;\n", ctype_of(gen, gen->value_types[param]), param);
+        }
+        for (uint32_t i = piece->first_instr; i < piece->first_instr + piece->instr_count; ++i) {
+            if (gen->shared[i]) sb_appendf(out, "%s mylang_v%u;\n", ctype_of(gen, gen->value_types[i]), i);
+        }
+    }
+    sb_append_char(out, '\n');
+    for (uint32_t f = first; f < end; ++f) emit_function(out, gen, f);
+    sb_appendf(out, "void mylang_shard%u(void) {\n", shard);
+    for (uint32_t f = first; f < end; ++f) sb_appendf(out, "    mylang_f%u();\n", f);
+    sb_append_str(out, "}\n");
+}
+
+// Writes the prototype of mylang_cast<from>_<to>, or its definition (see add_cast).
+static void emit_cast(StringBuilder* out, const CGen* gen, Type* from, Type* to, bool prototype) {
+    const char* target = ctype_of(gen, to);
+    sb_appendf(out, "static inline %s mylang_cast%u_%u(%s value)", target, from->id, to->id, ctype_of(gen, from));
+    if (prototype) {
+        sb_append_str(out, ";\n");
+        return;
+    }
+    sb_append_str(out, " {\n");
+    if (from->kind == TYPE_REFERENCE && to->kind == TYPE_REFERENCE) {
+        Type* a = ((TypeReference*)from)->referent;
+        Type* b = ((TypeReference*)to)->referent;
+        sb_appendf(out,
+                   "    %s copy = (%s)malloc(sizeof(*copy));\n"
+                   "    if (!copy) abort();\n"
+                   "    *copy = mylang_cast%u_%u(*value);\n"
+                   "    return copy;\n}\n",
+                   target, target, a->id, b->id);
+        return;
+    }
+    const ADTInstance* source = instance_of(gen, from);
+    const ADTInstance* instance = instance_of(gen, to);
+    if (!source || !instance || ((TypeADT*)from)->adt_symbol != ((TypeADT*)to)->adt_symbol) {
+        sb_appendf(out, "    (void)value;\n    return (%s){0};\n}\n", target);
+        return;
+    }
+    sb_appendf(out, "    %s result = {.tag = value.tag};\n", target);
+    if (has_data(instance)) {
+        sb_append_str(out, "    switch (value.tag) {\n");
+        for (size_t v = 0; v < instance->variant_count && v < source->variant_count; ++v) {
+            const ADTInstanceVariant* variant = &instance->variants[v];
+            if (variant->field_count == 0) continue;
+            sb_appendf(out, "    case %zu:\n", v);
+            for (size_t f = 0; f < variant->field_count && f < source->variants[v].field_count; ++f) {
+                Type* a = source->variants[v].field_types[f];
+                Type* b = variant->field_types[f];
+                sb_appendf(out, "        result.u.v%zu.f%zu = ", v, f);
+                if (a == b) sb_appendf(out, "value.u.v%zu.f%zu;\n", v, f);
+                else if (field_is_boxed(variant, f)) {
+                    sb_appendf(out, "mylang_box%u(mylang_cast%u_%u(*value.u.v%zu.f%zu));\n", b->id, a->id, b->id, v, f);
+                } else {
+                    sb_appendf(out, "mylang_cast%u_%u(value.u.v%zu.f%zu);\n", a->id, b->id, v, f);
+                }
+            }
+            sb_append_str(out, "        break;\n");
+        }
+        sb_append_str(out, "    }\n");
+    }
+    sb_append_str(out, "    return result;\n}\n");
+}
+
+static void emit_header(StringBuilder* out, const CGen* gen) {
+    const IrProgram* program = gen->program;
+    sb_append_str(out,
+                  "// Generated by mylangc.\n"
+                  "#ifndef MYLANG_H\n#define MYLANG_H\n\n"
+                  "#include <stdbool.h>\n#include <stdint.h>\n#include <stdio.h>\n#include <stdlib.h>\n"
+                  "#include <string.h>\n\n"
+                  "typedef struct { char unused; } mylang_unit; // Types with no values at run time\n\n");
+    for (size_t i = 0; i < gen->adt_count; ++i) {
+        char* name = type_to_string(gen->adts[i]);
+        sb_appendf(out, "typedef struct %s %s; // %s\n", ctype_of(gen, gen->adts[i]), ctype_of(gen, gen->adts[i]),
+                   name ? name : "?");
+        free(name);
+    }
+    sb_append_char(out, '\n');
+    for (size_t i = 0; i < gen->adt_count; ++i) {
+        Type* type = gen->adts[i];
+        const ADTInstance* instance = instance_of(gen, type);
+        sb_appendf(out, "struct %s {\n    uint32_t tag;\n", ctype_of(gen, type));
+        if (has_data(instance)) {
+            sb_append_str(out, "    union {\n");
+            for (size_t v = 0; v < instance->variant_count; ++v) {
+                const ADTInstanceVariant* variant = &instance->variants[v];
+                if (variant->field_count == 0) continue;
+                sb_append_str(out, "        struct {");
+                for (size_t f = 0; f < variant->field_count; ++f) {
+                    sb_appendf(out, " %s%s f%zu;", ctype_of(gen, variant->field_types[f]),
+                               field_is_boxed(variant, f) ? "*" : "", f);
+                }
+                sb_appendf(out, " } v%zu; // %.*s\n", v, (int)variant->variant->name.length,
+                           variant->variant->name.lexeme);
+            }
+            sb_append_str(out, "    } u;\n");
+        }
+        sb_append_str(out, "};\n");
+    }
+    sb_append_char(out, '\n');
+    for (uint32_t t = 0; t < gen->type_capacity; ++t) {
+        if (!gen->boxed[t] || !gen->ctype[t]) continue;
+        const char* ctype = gen->ctype[t];
+        sb_appendf(out,
+                   "static inline %s* mylang_box%u(%s value) {\n"
+                   "    %s* box = (%s*)malloc(sizeof(*box));\n"
+                   "    if (!box) abort();\n"
+                   "    *box = value;\n"
+                   "    return box;\n"
+                   "}\n",
+                   ctype, t, ctype, ctype, ctype);
+    }
+    sb_append_char(out, '\n');
+    for (size_t i = 0; i < gen->cast_count; ++i) emit_cast(out, gen, gen->casts[2 * i], gen->casts[2 * i + 1], true);
+    for (size_t i = 0; i < gen->cast_count; ++i) emit_cast(out, gen, gen->casts[2 * i], gen->casts[2 * i + 1], false);
+    if (gen->cast_count > 0) sb_append_char(out, '\n');
+    for (uint32_t g = 0; g < program->global_count; ++g) {
+        sb_appendf(out, "extern %s mylang_g%u; // %.*s\n", ctype_of(gen, gen->global_types[g]), g,
+                   (int)program->globals[g].name.length, program->globals[g].name.lexeme);
+    }
+    for (IrValue v = 0; v < program->instr_count; ++v) {
+        if (gen->shared[v]) sb_appendf(out, "extern %s mylang_v%u;\n", ctype_of(gen, gen->value_types[v]), v);
+    }
+    for (uint32_t s = 0; s < gen->shard_count; ++s) sb_appendf(out, "void mylang_shard%u(void);\n", s);
+    sb_append_str(out, "\n#endif\n");
+}
+
+// Prints the value `pointer` points to.
+static void emit_print(StringBuilder* out, const CGen* gen, Type* type, const char* pointer, const char* indent) {
+    if (type == type_i32_instance) {
+        sb_appendf(out, "%sprintf(\"%%d\", (int)*(%s));\n", indent, pointer);
+    } else if (type == type_bool_instance) {
+        sb_appendf(out, "%sfputs(*(%s) ? \"true\" : \"false\", stdout);\n", indent, pointer);
+    } else if (type == type_string_instance) {
+        sb_appendf(out, "%sprintf(\"\\\"%%s\\\"\", *(%s));\n", indent, pointer);
+    } else if (type && type->kind == TYPE_REFERENCE) {
+        char referent[256];
+        snprintf(referent, sizeof(referent), "*(%s)", pointer);
+        sb_appendf(out, "%sputchar('&');\n", indent);
+        emit_print(out, gen, ((TypeReference*)type)->referent, referent, indent);
+    } else if (type && type->kind == TYPE_ADT) {
+        sb_appendf(out, "%smylang_print%u(%s);\n", indent, type->id, pointer);
+    } else {
+        sb_appendf(out, "%sfputs(\"?\", stdout);\n", indent);
+    }
+}
+
+static void emit_printer(StringBuilder* out, const CGen* gen, Type* type) {
+    const ADTInstance* instance = instance_of(gen, type);
+    sb_appendf(out, "static void mylang_print%u(const %s* value) {\n    switch (value->tag) {\n", type->id,
+               ctype_of(gen, type));
+    for (size_t v = 0; instance && v < instance->variant_count; ++v) {
+        const ADTInstanceVariant* variant = &instance->variants[v];
+        Token name = variant->variant->name;
+        sb_appendf(out, "    case %zu:\n        fputs(\"%.*s\", stdout);\n", v, (int)name.length, name.lexeme);
+        if (variant->field_count > 0) {
+            sb_append_str(out, "        putchar('(');\n");
+            for (size_t f = 0; f < variant->field_count; ++f) {
+                char field[64];
+                snprintf(field, sizeof(field), "%svalue->u.v%zu.f%zu", field_is_boxed(variant, f) ? "" : "&", v, f);
+                if (f) sb_append_str(out, "        fputs(\", \", stdout);\n");
+                emit_print(out, gen, variant->field_types[f], field, "        ");
+            }
+            sb_append_str(out, "        putchar(')');\n");
+        }
+        sb_append_str(out, "        break;\n");
+    }
+    sb_append_str(out, "    }\n}\n\n");
+}
+
+static void emit_main(StringBuilder* out, const CGen* gen) {
+    const IrProgram* program = gen->program;
+    sb_append_str(out, "#include \"mylang.h\"\n\n");
+    for (uint32_t g = 0; g < program->global_count; ++g) {
+        sb_appendf(out, "%s mylang_g%u;\n", ctype_of(gen, gen->global_types[g]), g);
+    }
+    sb_append_char(out, '\n');
+    for (size_t i = 0; i < gen->adt_count; ++i) {
+        sb_appendf(out, "static void mylang_print%u(const %s* value);\n", gen->adts[i]->id, ctype_of(gen, gen->adts[i]));
+    }
+    sb_append_char(out, '\n');
+    for (size_t i = 0; i < gen->adt_count; ++i) emit_printer(out, gen, gen->adts[i]);
+    // main prints the `let`s from a table, through one function per type, so
+    // its size does not grow with the program.
+    uint32_t shown_capacity = gen->type_capacity + 1; // The last slot for types not known
+    bool* shown = (bool*)calloc(shown_capacity, sizeof(bool));
+    for (uint32_t g = 0; shown && g < program->global_count; ++g) {
+        Type* type = gen->global_types[g];
+        uint32_t id = type && type->id < gen->type_capacity ? type->id : gen->type_capacity;
+        if (shown[id]) continue;
+        shown[id] = true;
+        char pointer[96];
+        snprintf(pointer, sizeof(pointer), "(const %.64s*)value", ctype_of(gen, type));
+        sb_appendf(out, "static void mylang_show%u(const void* value) {\n", id);
+        emit_print(out, gen, id < gen->type_capacity ? type : NULL, pointer, "    ");
+        sb_append_str(out, "}\n\n");
+    }
+    if (program->global_count > 0) {
+        sb_append_str(out, "static const struct {\n    const char* name;\n    const void* value;\n"
+                           "    void (*show)(const void* value);\n} mylang_lets[] = {\n");
+        for (uint32_t g = 0; g < program->global_count; ++g) {
+            Type* type = gen->global_types[g];
+            const IrGlobal* global = &program->globals[g];
+            sb_appendf(out, "    {\"%.*s\", &mylang_g%u, mylang_show%u},\n", (int)global->name.length,
+                       global->name.lexeme, g, type && type->id < gen->type_capacity ? type->id : gen->type_capacity);
+        }
+        sb_append_str(out, "};\n\n");
+    }
+    free(shown);
+    sb_append_str(out, "int main(void) {\n");
+    for (uint32_t s = 0; s < gen->shard_count; ++s) sb_appendf(out, "    mylang_shard%u();\n", s);
+    if (program->global_count > 0) {
+        sb_append_str(out, "    for (size_t i = 0; i < sizeof(mylang_lets) / sizeof(mylang_lets[0]); ++i) {\n"
+                           "        printf(\"%s = \", mylang_lets[i].name);\n"
+                           "        mylang_lets[i].show(mylang_lets[i].value);\n"
+                           "        putchar('\\n');\n"
+                           "    }\n");
+    }
+    sb_append_str(out, "    return 0;\n}\n");
+}
+
+static char* path_in(const char* dir, const char* name) {
+    size_t length = strlen(dir) + strlen(name) + 2;
+    char* path = (char*)malloc(length);
+    if (path) snprintf(path, length, "%s/%s", dir, name);
+    return path;
+}
+
+// File `index`: 0 is the header, 1 the main translation unit, 2 + s shard s.
+static char* file_name(size_t index, const char* extension) {
+    char name[64];
+    if (index == 0) snprintf(name, sizeof(name), "mylang.h");
+    else if (index == 1) snprintf(name, sizeof(name), "mylang_main.%s", extension);
+    else snprintf(name, sizeof(name), "mylang_%zu.%s", index - 2, extension);
+    return copy_string(name);
+}
+
+static void emit_file(size_t index, size_t worker, void* ctx) {
+    (void)worker;
+    EmitTask* task = (EmitTask*)ctx;
+    StringBuilder* out = sb_create(1 << 16);
+    char* name = file_name(index, "c");
+    char* path = name ? path_in(task->dir, name) : NULL;
+    bool ok = out && path;
+    if (ok) {
+        if (index == 0) emit_header(out, task->gen);
+        else if (index == 1) emit_main(out, task->gen);
+        else emit_shard(out, task->gen, (uint32_t)(index - 2));
+        FILE* file = fopen(path, "wb");
+        ok = file && fwrite(sb_get_str(out), 1, sb_get_length(out), file) == sb_get_length(out);
+        if (file && fclose(file) != 0) ok = false;
+        if (!ok) fprintf(stderr, "Error: could not write '%s'.\n", path);
+        task->bytes[index] = sb_get_length(out);
+    }
+    task->failed[index] = !ok;
+    sb_destroy(out);
+    free(name);
+    free(path);
+}
+
+static bool plan(CGen* gen) {
+    const IrProgram* program = gen->program;
+    size_t blocks = (size_t)program->block_count + 1, values = (size_t)program->instr_count + 1;
+    gen->ground_capacity = (uint32_t)type_count();
+    gen->grounded = (Type**)calloc((size_t)gen->ground_capacity + 1, sizeof(Type*));
+    gen->value_types = (Type**)calloc(values, sizeof(Type*));
+    gen->global_types = (Type**)calloc((size_t)program->global_count + 1, sizeof(Type*));
+    if (!gen->grounded || !gen->value_types || !gen->global_types) return false;
+    for (IrValue v = 0; v < program->instr_count; ++v) {
+        Type* type = program->instrs[v].type;
+        if (type && !(gen->value_types[v] = ground(gen, type))) return false;
+    }
+    for (uint32_t g = 0; g < program->global_count; ++g) {
+        Type* type = program->globals[g].type;
+        if (type && !(gen->global_types[g] = ground(gen, type))) return false;
+    }
+    // A borrow points at its operand, at the operand's type.
+    for (IrValue v = 0; v < program->instr_count; ++v) {
+        const IrInstr* instr = &program->instrs[v];
+        if (instr->op != IR_BORROW) continue;
+        Type* referent = gen->value_types[ir_operands(program, instr)[0]];
+        if (referent && !(gen->value_types[v] = type_intern_reference(referent, instr->imm != 0))) return false;
+    }
+    // Grounding may have interned new types.
+    gen->type_capacity = (uint32_t)type_count();
+    gen->ctype = (char**)calloc((size_t)gen->type_capacity + 1, sizeof(char*));
+    gen->type_state = (uint8_t*)calloc((size_t)gen->type_capacity + 1, 1);
+    gen->boxed = (bool*)calloc((size_t)gen->type_capacity + 1, sizeof(bool));
+    gen->adts = (Type**)malloc(((size_t)gen->type_capacity + 1) * sizeof(Type*));
+    gen->order = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    gen->function_of = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    gen->shared = (bool*)calloc(values, sizeof(bool));
+    gen->value_function = (uint32_t*)malloc(values * sizeof(uint32_t));
+    uint32_t* position = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    bool ok = gen->ctype && gen->type_state && gen->boxed && gen->adts && gen->order && gen->function_of &&
+              gen->shared && gen->value_function && position && program->block_count > 0 &&
+              order_blocks(gen, position) && cut_pieces(gen, position);
+    if (ok) {
+        gen->function_first = (uint32_t*)malloc(((size_t)gen->piece_count + 1) * sizeof(uint32_t));
+        gen->shard_first = (uint32_t*)malloc(((size_t)gen->piece_count + 1) * sizeof(uint32_t));
+        ok = gen->function_first && gen->shard_first;
+    }
+    if (ok) {
+        find_borrowed_values(gen);
+        place_functions(gen, position);
+        place_shards(gen);
+        find_shared_values(gen);
+        for (IrValue v = 0; v < program->instr_count && ok; ++v) ok = collect_type(gen, gen->value_types[v]);
+        for (uint32_t g = 0; g < program->global_count && ok; ++g) ok = collect_type(gen, gen->global_types[g]);
+        ok = ok && find_casts(gen);
+    }
+    free(position);
+    return ok;
+}
+
+static void release(CGen* gen) {
+    free(gen->grounded);
+    free(gen->value_types);
+    free(gen->global_types);
+    for (uint32_t t = 0; gen->ctype && t < gen->type_capacity; ++t) free(gen->ctype[t]);
+    free(gen->ctype);
+    free(gen->type_state);
+    free(gen->boxed);
+    free(gen->adts);
+    free(gen->casts);
+    free(gen->order);
+    free(gen->pieces);
+    free(gen->function_of);
+    free(gen->function_first);
+    free(gen->shard_first);
+    free(gen->shared);
+    free(gen->value_function);
+}
+
+// Compiles every translation unit, `jobs` at a time, then links them.
+static bool compile_and_link(const CBackendOptions* options, size_t unit_count, CBackendStats* stats) {
+    const char* cc = options->cc ? options->cc : "gcc";
+    const char* opt = options->opt ? options->opt : "-O2";
+    char*** commands = (char***)calloc(unit_count, sizeof(char**));
+    char** sources = (char**)calloc(unit_count, sizeof(char*));
+    char** objects = (char**)calloc(unit_count, sizeof(char*));
+    char** link = (char**)calloc(unit_count + 4, sizeof(char*));
+    bool ok = commands && sources && objects && link;
+    for (size_t u = 0; u < unit_count && ok; ++u) {
+        char* source_name = file_name(u + 1, "c");
+        char* object_name = file_name(u + 1, "o");
+        sources[u] = source_name ? path_in(options->work_dir, source_name) : NULL;
+        objects[u] = object_name ? path_in(options->work_dir, object_name) : NULL;
+        free(source_name);
+        free(object_name);
+        commands[u] = (char**)calloc(8, sizeof(char*));
+        ok = sources[u] && objects[u] && commands[u];
+        if (!ok) break;
+        // -w: generated code has unused labels and variables by design.
+        char* argv[] = {(char*)cc, (char*)opt, "-w", "-c", sources[u], "-o", objects[u], NULL};
+        memcpy(commands[u], argv, sizeof(argv));
+    }
+    if (!ok) fprintf(stderr, "Error: out of memory while running the C compiler.\n");
+
+    size_t jobs = options->jobs ? options->jobs : task_graph_default_workers();
+    double start = toolchain_now();
+    ok = ok && toolchain_run_all(commands, unit_count, jobs);
+    stats->compile_seconds = toolchain_now() - start;
+    if (ok) {
+        size_t n = 0;
+        link[n++] = (char*)cc;
+        for (size_t u = 0; u < unit_count; ++u) link[n++] = objects[u];
+        link[n++] = "-o";
+        link[n++] = (char*)options->output;
+        start = toolchain_now();
+        ok = toolchain_run(link);
+        stats->link_seconds = toolchain_now() - start;
+    }
+    for (size_t u = 0; u < unit_count; ++u) {
+        if (commands) free(commands[u]);
+        if (sources) free(sources[u]);
+        if (objects) free(objects[u]);
+    }
+    free(commands);
+    free(sources);
+    free(objects);
+    free(link);
+    return ok;
+}
+
+bool c_backend_build(const IrProgram* program, ADTInstanceCache* instances, const CBackendOptions* options,
+                     CBackendStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    double start = toolchain_now();
+    if (!toolchain_make_dir(options->work_dir)) return false;
+    CGen gen = {0};
+    gen.program = program;
+    gen.instances = instances;
+    gen.options = options;
+    if (!plan(&gen)) {
+        fprintf(stderr, "Error: out of memory while generating C.\n");
+        release(&gen);
+        return false;
+    }
+
+    // The header, the main translation unit and the shards are written in parallel.
+    size_t file_count = (size_t)gen.shard_count + 2;
+    EmitTask task = {&gen, options->work_dir, (size_t*)calloc(file_count, sizeof(size_t)),
+                     (bool*)calloc(file_count, sizeof(bool))};
+    TaskGraph* graph = task.bytes && task.failed ? task_graph_create(file_count) : NULL;
+    size_t workers = options->jobs ? options->jobs : task_graph_default_workers();
+    bool ok = graph && task_graph_run(graph, workers, emit_file, &task);
+    if (!ok) fprintf(stderr, "Error: out of memory while generating C.\n");
+    for (size_t f = 0; f < file_count && ok; ++f) ok = !task.failed[f];
+    for (size_t f = 0; f < file_count && task.bytes; ++f) stats->bytes += task.bytes[f];
+    task_graph_destroy(graph);
+    free(task.bytes);
+    free(task.failed);
+    stats->translation_units = file_count - 1;
+    stats->functions = gen.function_count;
+    release(&gen);
+    stats->emit_seconds = toolchain_now() - start;
+    if (!ok || options->emit_only) return ok;
+    return compile_and_link(options, file_count - 1, stats);
+}
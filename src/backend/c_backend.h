@@ -0,0 +1,51 @@
+#ifndef C_BACKEND_H
+#define C_BACKEND_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include "../core/adt_instance.h"
+#include "../core/ir.h"
+
+// Native code through C: writes an optimized IrProgram (see ir_opt.h) as C
+// sources, compiles them with the system C compiler and links an executable.
+//
+// ADT specializations become tagged unions (`struct { uint32_t tag; union {
+// ... } u; }`) passed by value; a field the ADT graph boxed (see adt_graph.h)
+// is a pointer to a heap copy. Each `let` becomes a C global, and each IR
+// value a C local, or a global if other code needs it (another function, or a
+// borrow, which must outlive the function).
+//
+// The program's code is cut where control passes through a single point
+// (between `let`s, outside any `match`, or anywhere in a long block), the
+// pieces are grouped into functions of a bounded size, and the functions are
+// spread over `shards` translation units that the C compiler builds in parallel. A main translation unit runs
+// them in order and prints every `let`'s value.
+//
+// Generated files, in `work_dir`: mylang.h (types and declarations),
+// mylang_main.c and mylang_<k>.c for each shard, plus their objects.
+
+typedef struct {
+    const char* output;   // Executable to link
+    const char* work_dir; // Created if missing
+    const char* cc;       // C compiler; NULL for "gcc"
+    const char* opt;      // Optimization flag; NULL for "-O2"
+    size_t shards;        // Translation units for the program's code; 0 for one per job
+    size_t jobs;          // Compiler processes (and emitting threads) at once; 0 for one per CPU
+    bool emit_only;       // Write the sources without compiling them
+} CBackendOptions;
+
+typedef struct {
+    double emit_seconds;    // Writing the C sources
+    double compile_seconds; // Wall-clock time of all C compiler processes
+    double link_seconds;
+    size_t translation_units;
+    size_t functions;
+    size_t bytes;           // Total size of the C sources
+} CBackendStats;
+
+// Returns false, after reporting on stderr, if writing the sources or running
+// the C compiler failed.
+bool c_backend_build(const IrProgram* program, ADTInstanceCache* instances, const CBackendOptions* options,
+                     CBackendStats* stats);
+
+#endif // C_BACKEND_H
@@ -0,0 +1,249 @@
+#include "elf_writer.h"
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // For memcpy, memset, strlen
+
+// Section header indices: the null section, the ELF_* sections in order, the
+// fixed sections below, then one .rela section per section with relocations.
+enum {
+    SYMTAB_INDEX = 1 + ELF_SECTION_COUNT,
+    STRTAB_INDEX,
+    SHSTRTAB_INDEX,
+    NOTE_INDEX,
+    FIRST_RELA_INDEX,
+};
+
+// Symbol table: the null symbol, one per section, then the globals.
+#define FIRST_GLOBAL (1 + ELF_SECTION_COUNT)
+
+static const char* const SECTION_NAMES[ELF_SECTION_COUNT] = {".text", ".data", ".bss", ".rodata", ".data.rel.ro"};
+static const char* const RELA_NAMES[ELF_SECTION_COUNT] = {".rela.text", ".rela.data", ".rela.bss", ".rela.rodata",
+                                                         ".rela.data.rel.ro"};
+
+static bool reserve(ElfWriter* elf, ElfBytes* bytes, size_t needed) {
+    if (elf->failed) return false;
+    if (needed <= bytes->capacity) return true;
+    size_t capacity = bytes->capacity ? bytes->capacity * 2 : 4096;
+    while (capacity < needed) capacity *= 2;
+    uint8_t* grown = (uint8_t*)realloc(bytes->bytes, capacity);
+    if (!grown) {
+        elf->failed = true;
+        return false;
+    }
+    bytes->bytes = grown;
+    bytes->capacity = capacity;
+    return true;
+}
+
+// Appends to any buffer; zero-fills if `data` is NULL.
+static size_t put(ElfWriter* elf, ElfBytes* bytes, const void* data, size_t size) {
+    size_t at = bytes->count;
+    if (!reserve(elf, bytes, at + size)) return at;
+    if (data) memcpy(bytes->bytes + at, data, size);
+    else memset(bytes->bytes + at, 0, size);
+    bytes->count += size;
+    return at;
+}
+
+void elf_writer_init(ElfWriter* elf) {
+    memset(elf, 0, sizeof(*elf));
+    for (int s = 0; s < ELF_SECTION_COUNT; ++s) elf->sections[s].alignment = 1;
+    elf->sections[ELF_TEXT].alignment = 16;
+}
+
+void elf_writer_free(ElfWriter* elf) {
+    for (int s = 0; s < ELF_SECTION_COUNT; ++s) {
+        free(elf->sections[s].bytes);
+        free(elf->relocations[s].bytes);
+    }
+    free(elf->symbols.bytes);
+    free(elf->names.bytes);
+    memset(elf, 0, sizeof(*elf));
+}
+
+void elf_align(ElfWriter* elf, ElfSection section, size_t alignment) {
+    ElfBytes* bytes = &elf->sections[section];
+    if (alignment > bytes->alignment) bytes->alignment = alignment;
+    size_t padding = (alignment - bytes->count % alignment) % alignment;
+    if (padding > 0) elf_append(elf, section, NULL, padding);
+}
+
+size_t elf_append(ElfWriter* elf, ElfSection section, const void* bytes, size_t size) {
+    ElfBytes* target = &elf->sections[section];
+    if (section != ELF_BSS) return put(elf, target, bytes, size);
+    size_t at = target->count;
+    target->count += size;
+    return at;
+}
+
+size_t elf_append64(ElfWriter* elf, ElfSection section, uint64_t value) {
+    return elf_append(elf, section, &value, sizeof(value));
+}
+
+uint32_t elf_section_symbol(ElfSection section) {
+    return 1 + (uint32_t)section;
+}
+
+uint32_t elf_symbol(ElfWriter* elf, const char* name, ElfSection section, size_t offset, size_t size, bool function) {
+    if (elf->names.count == 0) put(elf, &elf->names, NULL, 1); // The empty name
+    Elf64_Sym symbol = {0};
+    symbol.st_name = (Elf64_Word)put(elf, &elf->names, name, strlen(name) + 1);
+    if (section == ELF_UNDEFINED) {
+        symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+        symbol.st_shndx = SHN_UNDEF;
+    } else {
+        symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, function ? STT_FUNC : STT_OBJECT);
+        symbol.st_shndx = (Elf64_Section)(1 + section);
+        symbol.st_value = offset;
+        symbol.st_size = size;
+    }
+    size_t at = put(elf, &elf->symbols, &symbol, sizeof(symbol));
+    return FIRST_GLOBAL + (uint32_t)(at / sizeof(Elf64_Sym));
+}
+
+void elf_relocate(ElfWriter* elf, ElfSection section, size_t offset, uint32_t symbol, uint32_t type, int64_t addend) {
+    Elf64_Rela relocation = {offset, ELF64_R_INFO(symbol, type), addend};
+    put(elf, &elf->relocations[section], &relocation, sizeof(relocation));
+}
+
+// --- Writing ---
+
+static size_t align_up(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Lays out a section's contents at *end and fills in its header.
+static void place(Elf64_Shdr* header, size_t* end, size_t size, size_t alignment) {
+    *end = align_up(*end, alignment);
+    header->sh_offset = *end;
+    header->sh_size = size;
+    header->sh_addralign = alignment;
+    *end += size;
+}
+
+bool elf_write(const ElfWriter* elf, const char* path, size_t* bytes) {
+    *bytes = 0;
+    if (elf->failed) {
+        fprintf(stderr, "Error: out of memory while writing '%s'.\n", path);
+        return false;
+    }
+
+    // Section names
+    char shstrtab[256];
+    size_t shstrtab_size = 1;
+    shstrtab[0] = '\0';
+    Elf64_Shdr headers[FIRST_RELA_INDEX + ELF_SECTION_COUNT];
+    memset(headers, 0, sizeof(headers));
+    const char* names[FIRST_RELA_INDEX + ELF_SECTION_COUNT] = {0};
+    for (int s = 0; s < ELF_SECTION_COUNT; ++s) names[1 + s] = SECTION_NAMES[s];
+    names[SYMTAB_INDEX] = ".symtab";
+    names[STRTAB_INDEX] = ".strtab";
+    names[SHSTRTAB_INDEX] = ".shstrtab";
+    names[NOTE_INDEX] = ".note.GNU-stack"; // No executable stack
+    size_t section_count = FIRST_RELA_INDEX;
+    int rela_of[ELF_SECTION_COUNT];
+    for (int s = 0; s < ELF_SECTION_COUNT; ++s) {
+        rela_of[s] = elf->relocations[s].count > 0 ? (int)section_count++ : 0;
+        if (rela_of[s]) names[rela_of[s]] = RELA_NAMES[s];
+    }
+    for (size_t h = 1; h < section_count; ++h) {
+        size_t length = strlen(names[h]) + 1;
+        headers[h].sh_name = (Elf64_Word)shstrtab_size;
+        memcpy(shstrtab + shstrtab_size, names[h], length);
+        shstrtab_size += length;
+    }
+
+    // Symbol table: locals first, so sh_info can say where the globals start.
+    Elf64_Sym locals[FIRST_GLOBAL];
+    memset(locals, 0, sizeof(locals));
+    for (int s = 0; s < ELF_SECTION_COUNT; ++s) {
+        locals[1 + s].st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+        locals[1 + s].st_shndx = (Elf64_Section)(1 + s);
+    }
+    static const char empty_names[1] = {0};
+    const void* strtab = elf->names.count ? (const void*)elf->names.bytes : (const void*)empty_names;
+    size_t strtab_size = elf->names.count ? elf->names.count : 1;
+
+    // Layout
+    static const Elf64_Word TYPES[ELF_SECTION_COUNT] = {SHT_PROGBITS, SHT_PROGBITS, SHT_NOBITS, SHT_PROGBITS,
+                                                        SHT_PROGBITS};
+    static const Elf64_Xword FLAGS[ELF_SECTION_COUNT] = {SHF_ALLOC | SHF_EXECINSTR, SHF_ALLOC | SHF_WRITE,
+                                                         SHF_ALLOC | SHF_WRITE, SHF_ALLOC, SHF_ALLOC | SHF_WRITE};
+    size_t end = sizeof(Elf64_Ehdr);
+    for (int s = 0; s < ELF_SECTION_COUNT; ++s) {
+        Elf64_Shdr* header = &headers[1 + s];
+        header->sh_type = TYPES[s];
+        header->sh_flags = FLAGS[s];
+        size_t file_size = s == ELF_BSS ? 0 : elf->sections[s].count;
+        place(header, &end, file_size, elf->sections[s].alignment);
+        header->sh_size = elf->sections[s].count;
+    }
+    Elf64_Shdr* symtab = &headers[SYMTAB_INDEX];
+    symtab->sh_type = SHT_SYMTAB;
+    symtab->sh_link = STRTAB_INDEX;
+    symtab->sh_info = FIRST_GLOBAL;
+    symtab->sh_entsize = sizeof(Elf64_Sym);
+    place(symtab, &end, sizeof(locals) + elf->symbols.count, 8);
+    headers[STRTAB_INDEX].sh_type = SHT_STRTAB;
+    place(&headers[STRTAB_INDEX], &end, strtab_size, 1);
+    headers[SHSTRTAB_INDEX].sh_type = SHT_STRTAB;
+    place(&headers[SHSTRTAB_INDEX], &end, shstrtab_size, 1);
+    headers[NOTE_INDEX].sh_type = SHT_PROGBITS;
+    place(&headers[NOTE_INDEX], &end, 0, 1);
+    for (int s = 0; s < ELF_SECTION_COUNT; ++s) {
+        if (!rela_of[s]) continue;
+        Elf64_Shdr* header = &headers[rela_of[s]];
+        header->sh_type = SHT_RELA;
+        header->sh_flags = SHF_INFO_LINK;
+        header->sh_link = SYMTAB_INDEX;
+        header->sh_info = (Elf64_Word)(1 + s);
+        header->sh_entsize = sizeof(Elf64_Rela);
+        place(header, &end, elf->relocations[s].count, 8);
+    }
+    size_t headers_at = align_up(end, 8);
+    size_t size = headers_at + section_count * sizeof(Elf64_Shdr);
+
+    // The image, filled in and written at once
+    uint8_t* image = (uint8_t*)calloc(1, size);
+    if (!image) {
+        fprintf(stderr, "Error: out of memory while writing '%s'.\n", path);
+        return false;
+    }
+    Elf64_Ehdr header = {0};
+    memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_REL;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_shoff = headers_at;
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = (Elf64_Half)section_count;
+    header.e_shstrndx = SHSTRTAB_INDEX;
+    memcpy(image, &header, sizeof(header));
+    for (int s = 0; s < ELF_SECTION_COUNT; ++s) {
+        if (s != ELF_BSS && elf->sections[s].count) {
+            memcpy(image + headers[1 + s].sh_offset, elf->sections[s].bytes, elf->sections[s].count);
+        }
+        if (rela_of[s]) {
+            memcpy(image + headers[rela_of[s]].sh_offset, elf->relocations[s].bytes, elf->relocations[s].count);
+        }
+    }
+    memcpy(image + symtab->sh_offset, locals, sizeof(locals));
+    if (elf->symbols.count) memcpy(image + symtab->sh_offset + sizeof(locals), elf->symbols.bytes, elf->symbols.count);
+    memcpy(image + headers[STRTAB_INDEX].sh_offset, strtab, strtab_size);
+    memcpy(image + headers[SHSTRTAB_INDEX].sh_offset, shstrtab, shstrtab_size);
+    memcpy(image + headers_at, headers, section_count * sizeof(Elf64_Shdr));
+
+    FILE* file = fopen(path, "wb");
+    bool ok = file && fwrite(image, 1, size, file) == size;
+    if (file && fclose(file) != 0) ok = false;
+    if (!ok) fprintf(stderr, "Error: could not write '%s'.\n", path);
+    free(image);
+    *bytes = size;
+    return ok;
+}
@@ -0,0 +1,69 @@
+#ifndef ELF_WRITER_H
+#define ELF_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include <stdint.h>
+
+// Relocatable ELF64 objects for x86-64, built in memory and written with one
+// call, for the system linker to take instead of the assembler's output.
+//
+// An object has a fixed set of sections; code and data are appended to them,
+// and symbols and relocations refer to offsets in them. Every symbol added is
+// global; local data is reached through the section symbols (elf_section_symbol)
+// with the offset in the addend.
+
+typedef enum {
+    ELF_TEXT,        // Code
+    ELF_DATA,        // Writable data
+    ELF_BSS,         // Zero-filled: only a size
+    ELF_RODATA,      // Read-only data without relocations
+    ELF_DATA_REL_RO, // Read-only once relocated, for pointer tables
+    ELF_SECTION_COUNT,
+    ELF_UNDEFINED = ELF_SECTION_COUNT, // For symbols defined elsewhere
+} ElfSection;
+
+typedef struct {
+    uint8_t* bytes;
+    size_t count, capacity;
+    size_t alignment;
+} ElfBytes;
+
+typedef struct ElfWriter {
+    ElfBytes sections[ELF_SECTION_COUNT]; // ELF_BSS has a count but no bytes
+    ElfBytes symbols;                     // Elf64_Sym, globals only
+    ElfBytes names;                       // The string table
+    ElfBytes relocations[ELF_SECTION_COUNT]; // Elf64_Rela per section
+    bool failed;                          // Out of memory
+} ElfWriter;
+
+void elf_writer_init(ElfWriter* elf);
+void elf_writer_free(ElfWriter* elf);
+
+// Pads `section` to a multiple of `alignment`, a power of two, and raises the
+// section's alignment to it.
+void elf_align(ElfWriter* elf, ElfSection section, size_t alignment);
+
+// Appends `size` bytes (zero-filled if `bytes` is NULL, and always for
+// ELF_BSS); returns the offset they start at.
+size_t elf_append(ElfWriter* elf, ElfSection section, const void* bytes, size_t size);
+
+// Appends a little-endian 64-bit word; returns its offset.
+size_t elf_append64(ElfWriter* elf, ElfSection section, uint64_t value);
+
+// The local symbol standing for the start of `section`.
+uint32_t elf_section_symbol(ElfSection section);
+
+// Adds a global symbol, defined at `offset` in `section` or, with
+// ELF_UNDEFINED, elsewhere. Returns its index for elf_relocate.
+uint32_t elf_symbol(ElfWriter* elf, const char* name, ElfSection section, size_t offset, size_t size, bool function);
+
+// Records that the field at `offset` in `section` holds `type` (an
+// R_X86_64_* relocation) of `symbol` plus `addend`.
+void elf_relocate(ElfWriter* elf, ElfSection section, size_t offset, uint32_t symbol, uint32_t type, int64_t addend);
+
+// Writes the object to `path`. Returns false, after reporting on stderr, on
+// failure; *bytes is the object's size.
+bool elf_write(const ElfWriter* elf, const char* path, size_t* bytes);
+
+#endif // ELF_WRITER_H
@@ -0,0 +1,201 @@
+#define _DEFAULT_SOURCE // For MAP_ANONYMOUS, sysconf
+#include "jit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // For memcpy
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+#include <unistd.h> // For getpid, sysconf
+#include "x86.h"
+
+struct JitCode {
+    uint8_t* memory;
+    size_t mapped;    // Bytes mapped
+    size_t size;      // Bytes used
+    uint32_t* native; // Per code index: offset of its snippet, or UINT32_MAX within an instruction
+    uint32_t code_count;
+};
+
+// Native code is entered through the trampoline at offset 0, as
+// JitStatus entry(JitFrame* frame, const void* target).
+typedef int (*JitEntry)(JitFrame* frame, const void* target);
+
+// --- Snippets ---
+//
+// Besides the registers x86.h pins, r12 points at the frame while the program
+// runs. Holes are marked as in x86.c.
+
+// push rbx, r12, r13, r14, r15 (only so calls see a 16-byte aligned stack);
+// mov r12, rdi; mov rbx, [rdi]; mov r13, [rdi + 8]; mov r14, [rdi + 16]; jmp rsi
+static const uint8_t ENTER[] = {0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57, 0x49, 0x89, 0xFC, 0x48, 0x8B,
+                                0x1F, 0x4C, 0x8B, 0x6F, 0x08, 0x4C, 0x8B, 0x77, 0x10, 0xFF, 0xE6};
+
+// pop r15, r14, r13, r12, rbx; ret
+static const uint8_t LEAVE[] = {0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3};
+
+// mov eax, status; jmp leave
+static const uint8_t EXIT[] = {0xB8, 0, 0, 0, 0, 0xE9, 0, 0, 0, 0};
+#define EXIT_STATUS_AT 1
+#define EXIT_JUMP_AT   6
+
+// mov rdi, r12; mov rsi, pc (64); mov rax, helper (64); call rax; test al, al; jz out_of_memory
+static const uint8_t CALL[] = {0x4C, 0x89, 0xE7, 0x48, 0xBE, 0, 0, 0, 0, 0, 0, 0, 0, 0x48, 0xB8, 0, 0,
+                               0, 0, 0, 0, 0, 0, 0xFF, 0xD0, 0x84, 0xC0, 0x0F, 0x84, 0, 0, 0, 0};
+#define CALL_PC_AT     5
+#define CALL_HELPER_AT 15
+#define CALL_JUMP_AT   29
+
+// --- Assembly ---
+
+static void put_exit(X86Buffer* buffer, JitStatus status, size_t leave) {
+    size_t at = x86_put(buffer, EXIT, sizeof(EXIT));
+    x86_patch32(buffer, at + EXIT_STATUS_AT, (uint32_t)status);
+    x86_patch_label(buffer, at + EXIT_JUMP_AT, leave);
+}
+
+static void put_call(X86Buffer* buffer, const BcInstr* pc, JitHelper helper, size_t out_of_memory) {
+    size_t at = x86_put(buffer, CALL, sizeof(CALL));
+    x86_patch64(buffer, at + CALL_PC_AT, (uint64_t)(uintptr_t)pc);
+    uint64_t address;
+    memcpy(&address, &helper, sizeof(address));
+    x86_patch64(buffer, at + CALL_HELPER_AT, address);
+    x86_patch_label(buffer, at + CALL_JUMP_AT, out_of_memory);
+}
+
+// Emits the snippet for the instruction at `pc`.
+static void put_instr(X86Buffer* buffer, const BcProgram* program, uint32_t pc, const JitHelpers* helpers,
+                      size_t leave, size_t out_of_memory) {
+    if (x86_put_instr(buffer, program, pc)) return;
+    switch (BC_OP(program->code[pc])) {
+        case BC_CONSTRUCT:
+            put_call(buffer, &program->code[pc], helpers->construct, out_of_memory);
+            break;
+        case BC_BORROW:
+            put_call(buffer, &program->code[pc], helpers->borrow, out_of_memory);
+            break;
+        case BC_HALT:
+            put_exit(buffer, JIT_HALT, leave);
+            break;
+        default:
+            put_exit(buffer, JIT_UNREACHABLE, leave);
+            break;
+    }
+}
+
+// Lets `perf` name the code: lines of "start size name" in hex.
+static void write_perf_map(const JitCode* code, size_t body) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/perf-%ld.map", (long)getpid());
+    FILE* map = fopen(path, "a");
+    if (!map) return;
+    fprintf(map, "%lx %zx mylang::jit_enter\n", (unsigned long)(uintptr_t)code->memory, body);
+    fprintf(map, "%lx %zx mylang::program\n", (unsigned long)(uintptr_t)(code->memory + body), code->size - body);
+    fclose(map);
+}
+
+JitCode* jit_compile(const BcProgram* program, const JitHelpers* helpers) {
+    JitCode* code = (JitCode*)calloc(1, sizeof(JitCode));
+    if (!code) return NULL;
+    code->code_count = program->code_count;
+    code->native = (uint32_t*)malloc(((size_t)program->code_count + 1) * sizeof(uint32_t));
+    X86Buffer buffer = {0};
+    buffer.failed = code->native == NULL;
+
+    x86_put(&buffer, ENTER, sizeof(ENTER));
+    size_t leave = x86_put(&buffer, LEAVE, sizeof(LEAVE));
+    size_t out_of_memory = buffer.count;
+    put_exit(&buffer, JIT_OUT_OF_MEMORY, leave);
+    size_t body = buffer.count;
+    for (uint32_t pc = 0; pc < program->code_count && !buffer.failed; ++pc) {
+        code->native[pc] = (uint32_t)buffer.count;
+        put_instr(&buffer, program, pc, helpers, leave, out_of_memory);
+        for (uint32_t w = bc_instr_words(program, pc); w > 1 && pc + 1 < program->code_count; --w) {
+            code->native[++pc] = UINT32_MAX;
+        }
+    }
+    if (!buffer.failed && !x86_resolve(&buffer, code->native, program->code_count)) {
+        buffer.failed = true; // A jump into the middle of an instruction
+    }
+
+    if (!buffer.failed) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        code->size = buffer.count;
+        code->mapped = (buffer.count + page - 1) / page * page;
+        void* memory = mmap(NULL, code->mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            buffer.failed = true;
+        } else {
+            code->memory = (uint8_t*)memory;
+            memcpy(code->memory, buffer.bytes, buffer.count);
+            // Never writable and executable at once
+            if (mprotect(memory, code->mapped, PROT_READ | PROT_EXEC) != 0) buffer.failed = true;
+        }
+    }
+    x86_buffer_free(&buffer);
+    if (buffer.failed) {
+        jit_destroy(code);
+        return NULL;
+    }
+    write_perf_map(code, body);
+    return code;
+}
+
+void jit_destroy(JitCode* code) {
+    if (!code) return;
+    if (code->memory) munmap(code->memory, code->mapped);
+    free(code->native);
+    free(code);
+}
+
+bool jit_can_enter(const JitCode* code, uint32_t pc) {
+    return pc < code->code_count && code->native[pc] != UINT32_MAX;
+}
+
+JitStatus jit_enter(const JitCode* code, JitFrame* frame, uint32_t pc) {
+    JitEntry entry;
+    void* start = code->memory;
+    memcpy(&entry, &start, sizeof(entry));
+    return (JitStatus)entry(frame, code->memory + code->native[pc]);
+}
+
+size_t jit_code_size(const JitCode* code) {
+    return code->size;
+}
+
+#else // No JIT on this platform: the VM only interprets.
+
+struct JitCode {
+    int unused;
+};
+
+JitCode* jit_compile(const BcProgram* program, const JitHelpers* helpers) {
+    (void)program;
+    (void)helpers;
+    return NULL;
+}
+
+void jit_destroy(JitCode* code) {
+    (void)code;
+}
+
+bool jit_can_enter(const JitCode* code, uint32_t pc) {
+    (void)code;
+    (void)pc;
+    return false;
+}
+
+JitStatus jit_enter(const JitCode* code, JitFrame* frame, uint32_t pc) {
+    (void)code;
+    (void)frame;
+    (void)pc;
+    return JIT_UNREACHABLE;
+}
+
+size_t jit_code_size(const JitCode* code) {
+    (void)code;
+    return 0;
+}
+
+#endif
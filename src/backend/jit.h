@@ -0,0 +1,58 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bytecode.h"
+
+// Baseline template JIT for bytecode programs, on x86-64 Linux.
+//
+// Each instruction becomes a copy of a pre-assembled machine code snippet for
+// its opcode, with the register offsets, constants and jump displacements
+// patched in; the code lives in mmap'd memory that is made executable once it
+// is written. The VM's registers, spill slots and globals stay in memory, so
+// the native code can be entered at any instruction the VM is about to run
+// (on-stack replacement). Allocating instructions call back into the VM.
+
+// The VM's state as the native code sees it; the field order is fixed.
+typedef struct JitFrame {
+    Value* registers;
+    Value* spills;
+    Value* globals;
+    void* context; // For the helpers
+} JitFrame;
+
+// Runs the allocating instruction at `pc` on the frame, like the VM would.
+// Returns false if out of memory.
+typedef bool (*JitHelper)(JitFrame* frame, const BcInstr* pc);
+
+typedef struct {
+    JitHelper construct;
+    JitHelper borrow;
+} JitHelpers;
+
+typedef enum {
+    JIT_HALT,
+    JIT_UNREACHABLE,
+    JIT_OUT_OF_MEMORY,
+} JitStatus;
+
+typedef struct JitCode JitCode;
+
+// Compiles the whole program. Returns NULL if this platform has no JIT, or
+// the code could not be compiled or mapped; the VM keeps interpreting then.
+// Appends the code's symbols to /tmp/perf-<pid>.map for `perf`.
+JitCode* jit_compile(const BcProgram* program, const JitHelpers* helpers);
+void jit_destroy(JitCode* code);
+
+// Whether the native code can be entered at instruction `pc`.
+bool jit_can_enter(const JitCode* code, uint32_t pc);
+
+// Runs the native code from instruction `pc` (see jit_can_enter) to the end.
+JitStatus jit_enter(const JitCode* code, JitFrame* frame, uint32_t pc);
+
+// Bytes of machine code, jump tables included.
+size_t jit_code_size(const JitCode* code);
+
+#endif // JIT_H
@@ -0,0 +1,76 @@
+#define _DEFAULT_SOURCE // For clock_gettime
+#include "toolchain.h"
+#include <errno.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <string.h> // For strerror
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+
+extern char** environ;
+
+typedef struct {
+    pid_t pid;
+    size_t command;
+} Running;
+
+static void report_status(char** argv, int status) {
+    if (WIFEXITED(status)) fprintf(stderr, "Error: '%s' exited with status %d.\n", argv[0], WEXITSTATUS(status));
+    else if (WIFSIGNALED(status)) fprintf(stderr, "Error: '%s' was killed by signal %d.\n", argv[0], WTERMSIG(status));
+}
+
+bool toolchain_run_all(char** const* commands, size_t count, size_t jobs) {
+    if (jobs == 0) jobs = 1;
+    Running running[64];
+    if (jobs > sizeof(running) / sizeof(running[0])) jobs = sizeof(running) / sizeof(running[0]);
+    size_t next = 0, active = 0;
+    bool ok = true;
+    while (next < count || active > 0) {
+        // Start commands up to the limit; after a failure, only wait for the ones already running.
+        while (ok && next < count && active < jobs) {
+            pid_t pid;
+            int error = posix_spawnp(&pid, commands[next][0], NULL, NULL, commands[next], environ);
+            if (error != 0) {
+                fprintf(stderr, "Error: could not run '%s': %s.\n", commands[next][0], strerror(error));
+                ok = false;
+                break;
+            }
+            running[active++] = (Running){pid, next++};
+        }
+        if (active == 0) break;
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: waiting for child processes failed: %s.\n", strerror(errno));
+            return false;
+        }
+        for (size_t i = 0; i < active; ++i) {
+            if (running[i].pid != pid) continue;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                report_status(commands[running[i].command], status);
+                ok = false;
+            }
+            running[i] = running[--active];
+            break;
+        }
+    }
+    return ok && next == count;
+}
+
+bool toolchain_run(char** argv) {
+    return toolchain_run_all(&argv, 1, 1);
+}
+
+bool toolchain_make_dir(const char* path) {
+    if (mkdir(path, 0777) == 0 || errno == EEXIST) return true;
+    fprintf(stderr, "Error: could not create directory '%s': %s.\n", path, strerror(errno));
+    return false;
+}
+
+double toolchain_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
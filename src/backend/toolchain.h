@@ -0,0 +1,24 @@
+#ifndef TOOLCHAIN_H
+#define TOOLCHAIN_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+
+// Running the external tools a backend hands its output to (the C compiler,
+// the linker). Commands are argv arrays, NULL-terminated, run without a shell.
+
+// Runs `commands[0..count)`, at most `jobs` at a time, and waits for all of
+// them. Returns false if any could not be started or exited unsuccessfully;
+// each failure is reported on stderr.
+bool toolchain_run_all(char** const* commands, size_t count, size_t jobs);
+
+// toolchain_run_all for one command.
+bool toolchain_run(char** argv);
+
+// Creates a directory unless it exists. Returns false (and reports) on failure.
+bool toolchain_make_dir(const char* path);
+
+// Monotonic wall-clock time in seconds, for timing phases that wait on other processes.
+double toolchain_now(void);
+
+#endif // TOOLCHAIN_H
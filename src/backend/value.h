@@ -0,0 +1,100 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Run-time values of the bytecode VM (vm.h): one 64-bit word whose low 3 bits
+// are its kind, so scalars and small ADT values never touch the heap.
+//
+//   VALUE_OBJECT  8-aligned pointer to a VmObject (kind bits 0)
+//   VALUE_INT     the i32 in bits 32..63
+//   VALUE_BOOL    0 or 1 in bits 32..63
+//   VALUE_STRING  index into BcProgram.strings in bits 32..63; the strings are
+//                 deduplicated, so equal strings are equal words
+//   VALUE_SMALL   an ADT value without a heap object: the kind of its payload
+//                 in bits 3..5, its tag in bits 8..15, its BcVariant in bits
+//                 16..31 and the payload's bits 32..63 (see value_small)
+//   VALUE_REF     8-aligned pointer to the borrowed Value, plus the kind
+//   VALUE_UNDEF   a `let` without an initializer
+//
+// Scalars compare equal exactly when their words do.
+
+typedef uint64_t Value;
+
+#define VALUE_OBJECT 0
+#define VALUE_INT    1
+#define VALUE_BOOL   2
+#define VALUE_STRING 3
+#define VALUE_SMALL  4
+#define VALUE_REF    5
+#define VALUE_UNDEF  6
+
+// A variant stored in a heap object: its fields follow the header.
+typedef struct {
+    uint32_t tag;
+    uint32_t variant; // BcProgram.variants index
+    Value fields[];
+} VmObject;
+
+// Variants with at most this tag and variant index can be VALUE_SMALL.
+#define VALUE_SMALL_MAX_TAG     0xffu
+#define VALUE_SMALL_MAX_VARIANT 0xffffu
+
+static inline uint32_t value_kind(Value value) {
+    return (uint32_t)(value & 7);
+}
+
+static inline Value value_int(int32_t i) {
+    return ((uint64_t)(uint32_t)i << 32) | VALUE_INT;
+}
+
+static inline int32_t value_as_int(Value value) {
+    return (int32_t)(uint32_t)(value >> 32);
+}
+
+static inline Value value_bool(bool b) {
+    return ((uint64_t)b << 32) | VALUE_BOOL;
+}
+
+static inline Value value_string(uint32_t index) {
+    return ((uint64_t)index << 32) | VALUE_STRING;
+}
+
+// Whether `value` fits in a VALUE_SMALL payload: a scalar, all of whose
+// information is in its kind and bits 32..63.
+static inline bool value_is_payload(Value value) {
+    uint32_t kind = value_kind(value);
+    return kind == VALUE_INT || kind == VALUE_BOOL || kind == VALUE_STRING;
+}
+
+// A small ADT value of variant `variant` (tag `tag`) holding `payload`, a
+// value_is_payload scalar, or VALUE_UNDEF for a variant without fields.
+static inline Value value_small(uint32_t tag, uint32_t variant, Value payload) {
+    return (payload & 0xffffffff00000000u) | ((uint64_t)variant << 16) | ((uint64_t)tag << 8) |
+           ((payload & 7) << 3) | VALUE_SMALL;
+}
+
+static inline Value value_small_payload(Value value) {
+    return (value & 0xffffffff00000000u) | ((value >> 3) & 7);
+}
+
+static inline uint32_t value_small_variant(Value value) {
+    return (uint32_t)(value >> 16) & 0xffff;
+}
+
+static inline VmObject* value_object(Value value) {
+    return (VmObject*)(uintptr_t)value;
+}
+
+static inline Value* value_referent(Value value) {
+    return (Value*)(uintptr_t)(value & ~(uint64_t)7);
+}
+
+// Variant tag of an ADT value (VALUE_SMALL or VALUE_OBJECT).
+static inline int32_t value_tag(Value value) {
+    if (value_kind(value) == VALUE_SMALL) return (int32_t)((value >> 8) & 0xff);
+    return (int32_t)value_object(value)->tag;
+}
+
+#endif // VALUE_H
@@ -0,0 +1,359 @@
+#include "vm.h"
+#include <stdlib.h>
+#include "jit.h"
+#include "toolchain.h" // For toolchain_now
+
+#define ARENA_CHUNK_BYTES (1u << 20)
+
+// Runs of the program, and taken backward jumps to one target, after which
+// the VM compiles the program to native code. A compile costs about as much
+// as a couple of interpreted runs.
+#define VM_CALL_THRESHOLD 2
+#define VM_LOOP_THRESHOLD 1000
+
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    Value data[];
+} ArenaChunk;
+
+struct Vm {
+    const BcProgram* program;
+    Value registers[BC_REGISTERS];
+    JitFrame frame; // Points at the registers, spill slots and globals
+    // Bump allocation in the newest chunk
+    char* arena_next;
+    char* arena_end;
+    ArenaChunk* chunks;
+
+    // Tiering
+    bool jit_enabled;
+    bool jit_failed;         // Compiling failed or is unsupported here: stay interpreted
+    JitCode* jit;
+    uint32_t entries;        // Runs of the program
+    uint32_t* loop_counters; // Per code index: backward jumps taken to it; allocated on the first
+    VmStats stats;
+};
+
+Vm* vm_create(const BcProgram* program) {
+    Vm* vm = (Vm*)calloc(1, sizeof(Vm));
+    if (!vm) return NULL;
+    vm->program = program;
+    vm->jit_enabled = true;
+    vm->frame.registers = vm->registers;
+    vm->frame.spills = (Value*)calloc((size_t)program->spill_count + 1, sizeof(Value));
+    vm->frame.globals = (Value*)malloc(((size_t)program->global_count + 1) * sizeof(Value));
+    vm->frame.context = vm;
+    if (!vm->frame.spills || !vm->frame.globals) {
+        vm_destroy(vm);
+        return NULL;
+    }
+    for (uint32_t g = 0; g <= program->global_count; ++g) vm->frame.globals[g] = VALUE_UNDEF;
+    return vm;
+}
+
+void vm_destroy(Vm* vm) {
+    if (!vm) return;
+    while (vm->chunks) {
+        ArenaChunk* next = vm->chunks->next;
+        free(vm->chunks);
+        vm->chunks = next;
+    }
+    jit_destroy(vm->jit);
+    free(vm->loop_counters);
+    free(vm->frame.spills);
+    free(vm->frame.globals);
+    free(vm);
+}
+
+void vm_set_jit(Vm* vm, bool enabled) {
+    vm->jit_enabled = enabled;
+}
+
+const VmStats* vm_stats(const Vm* vm) {
+    return &vm->stats;
+}
+
+// Starts a new chunk with room for `bytes` and allocates them from it.
+static void* arena_grow(Vm* vm, size_t bytes) {
+    size_t size = bytes > ARENA_CHUNK_BYTES ? bytes : ARENA_CHUNK_BYTES;
+    ArenaChunk* chunk = (ArenaChunk*)malloc(sizeof(ArenaChunk) + size);
+    if (!chunk) return NULL;
+    chunk->next = vm->chunks;
+    vm->chunks = chunk;
+    vm->arena_next = (char*)chunk->data + bytes;
+    vm->arena_end = (char*)chunk->data + size;
+    return chunk->data;
+}
+
+// `bytes` is a multiple of 8, so allocations stay 8-aligned.
+static inline void* arena_alloc(Vm* vm, size_t bytes) {
+    if ((size_t)(vm->arena_end - vm->arena_next) < bytes) return arena_grow(vm, bytes);
+    void* memory = vm->arena_next;
+    vm->arena_next += bytes;
+    return memory;
+}
+
+// Frees what earlier runs allocated, keeping the newest chunk for reuse.
+static void arena_reset(Vm* vm) {
+    if (!vm->chunks) return;
+    while (vm->chunks->next) {
+        ArenaChunk* next = vm->chunks->next->next;
+        free(vm->chunks->next);
+        vm->chunks->next = next;
+    }
+    vm->arena_next = (char*)vm->chunks->data;
+}
+
+// BC_CONSTRUCT at `pc`, for the interpreter and the JIT alike.
+static inline bool construct(Vm* vm, const BcInstr* pc) {
+    BcInstr i = *pc++;
+    const BcVariant* variant = &vm->program->variants[BC_BX(i)];
+    uint32_t count = variant->field_count;
+    VmObject* object = (VmObject*)arena_alloc(vm, sizeof(VmObject) + count * sizeof(Value));
+    if (!object) return false;
+    object->tag = variant->tag;
+    object->variant = BC_BX(i);
+    const Value* r = vm->registers;
+    for (uint32_t f = 0; f < count; f += 4) {
+        BcInstr fields = *pc++;
+        for (uint32_t k = 0; k < 4 && f + k < count; ++k) object->fields[f + k] = r[(fields >> (8 * k)) & 0xff];
+    }
+    vm->registers[BC_A(i)] = (Value)(uintptr_t)object;
+    return true;
+}
+
+static inline bool borrow(Vm* vm, BcInstr i) {
+    Value* cell = (Value*)arena_alloc(vm, sizeof(Value));
+    if (!cell) return false;
+    *cell = vm->registers[BC_B(i)];
+    vm->registers[BC_A(i)] = (Value)(uintptr_t)cell | VALUE_REF;
+    return true;
+}
+
+static bool construct_helper(JitFrame* frame, const BcInstr* pc) {
+    return construct((Vm*)frame->context, pc);
+}
+
+static bool borrow_helper(JitFrame* frame, const BcInstr* pc) {
+    return borrow((Vm*)frame->context, *pc);
+}
+
+static bool run_error(const char* message) {
+    fprintf(stderr, "Run-time error: %s.\n", message);
+    return false;
+}
+
+// Compiles the program unless it is already; false if it stays interpreted.
+static bool tier_up(Vm* vm) {
+    if (vm->jit) return true;
+    if (!vm->jit_enabled || vm->jit_failed) return false;
+    double start = toolchain_now();
+    JitHelpers helpers = {construct_helper, borrow_helper};
+    vm->jit = jit_compile(vm->program, &helpers);
+    vm->stats.compile_seconds += toolchain_now() - start;
+    if (!vm->jit) {
+        vm->jit_failed = true;
+        return false;
+    }
+    vm->stats.native_bytes = jit_code_size(vm->jit);
+    return true;
+}
+
+static bool run_native(Vm* vm, uint32_t pc) {
+    switch (jit_enter(vm->jit, &vm->frame, pc)) {
+        case JIT_HALT: return true;
+        case JIT_OUT_OF_MEMORY: return run_error("out of memory");
+        default: return run_error("no arm of a match applied");
+    }
+}
+
+// A backward jump to `target` was taken: counts it, and once the loop is hot,
+// carries on in native code from its header (on-stack replacement). Returns
+// false to keep interpreting.
+static bool loop_is_hot(Vm* vm, uint32_t target) {
+    if (!vm->jit_enabled || vm->jit_failed) return false;
+    if (!vm->loop_counters) {
+        vm->loop_counters = (uint32_t*)calloc(vm->program->code_count, sizeof(uint32_t));
+        if (!vm->loop_counters) return false;
+    }
+    return ++vm->loop_counters[target] >= VM_LOOP_THRESHOLD && tier_up(vm) && jit_can_enter(vm->jit, target);
+}
+
+static bool interpret(Vm* vm) {
+    const BcProgram* program = vm->program;
+    const BcInstr* code = program->code;
+    const BcInstr* pc = code;
+    const Value* constants = program->constants;
+    Value* r = vm->registers;
+    Value* spills = vm->frame.spills;
+    Value* globals = vm->frame.globals;
+    BcInstr i;
+
+#if defined(__GNUC__)
+    static const void* const dispatch[BC_OPCODE_COUNT] = {
+#define VM_LABEL(name, operands) &&op_##name,
+        BC_OPCODES(VM_LABEL)
+#undef VM_LABEL
+    };
+#define CASE(name) op_##name:
+#define NEXT()                        \
+    do {                              \
+        i = *pc++;                    \
+        goto *dispatch[BC_OP(i)];     \
+    } while (0)
+    NEXT();
+#else
+#define CASE(name) case BC_##name:
+#define NEXT() continue
+    for (;;) {
+        i = *pc++;
+        switch (BC_OP(i)) {
+#endif
+
+    CASE(MOVE) {
+        r[BC_A(i)] = r[BC_B(i)];
+        NEXT();
+    }
+    CASE(LOADK) {
+        r[BC_A(i)] = constants[BC_BX(i)];
+        NEXT();
+    }
+    CASE(CONSTRUCT) {
+        if (!construct(vm, pc - 1)) goto out_of_memory;
+        pc += (program->variants[BC_BX(i)].field_count + 3) / 4;
+        NEXT();
+    }
+    CASE(CONSTRUCT_SMALL) {
+        Value payload = r[BC_B(i)];
+        r[BC_A(i)] = (payload & 0xffffffff00000000u) | ((payload & 7) << 3) | *pc++;
+        NEXT();
+    }
+    CASE(PROJECT) {
+        Value value = r[BC_B(i)];
+        r[BC_A(i)] = value_kind(value) == VALUE_SMALL ? value_small_payload(value) : value_object(value)->fields[BC_C(i)];
+        NEXT();
+    }
+    CASE(TAG) {
+        r[BC_A(i)] = value_int(value_tag(r[BC_B(i)]));
+        NEXT();
+    }
+    CASE(EQ) {
+        r[BC_A(i)] = value_bool(r[BC_B(i)] == r[BC_C(i)]);
+        NEXT();
+    }
+    CASE(BORROW) {
+        if (!borrow(vm, i)) goto out_of_memory;
+        NEXT();
+    }
+    CASE(SETGLOBAL) {
+        globals[BC_BX(i)] = r[BC_A(i)];
+        NEXT();
+    }
+    CASE(SPILL) {
+        spills[BC_BX(i)] = r[BC_A(i)];
+        NEXT();
+    }
+    CASE(RELOAD) {
+        r[BC_A(i)] = spills[BC_BX(i)];
+        NEXT();
+    }
+    CASE(JMP) {
+        pc += BC_SJ(i);
+        if (BC_SJ(i) < 0 && loop_is_hot(vm, (uint32_t)(pc - code))) {
+            vm->stats.osr_entries++;
+            return run_native(vm, (uint32_t)(pc - code));
+        }
+        NEXT();
+    }
+    CASE(TEST) {
+        if (!(r[BC_A(i)] >> 32)) pc++;
+        NEXT();
+    }
+    CASE(SWITCH) {
+        const BcSwitch* table = &program->switches[BC_BX(i)];
+        uint64_t index = (uint64_t)((int64_t)value_as_int(r[BC_A(i)]) - table->low);
+        pc = code + program->targets[index < table->count ? table->first + index : table->fallback];
+        NEXT();
+    }
+    CASE(HALT) {
+        return true;
+    }
+    CASE(UNREACHABLE) {
+        return run_error("no arm of a match applied");
+    }
+
+#if !defined(__GNUC__)
+        default:
+            return run_error("invalid instruction");
+        }
+    }
+#endif
+#undef CASE
+#undef NEXT
+
+out_of_memory:
+    return run_error("out of memory");
+}
+
+bool vm_run(Vm* vm) {
+    arena_reset(vm);
+    vm->stats.runs++;
+    if (++vm->entries >= VM_CALL_THRESHOLD && tier_up(vm)) {
+        vm->stats.native_runs++;
+        return run_native(vm, 0);
+    }
+    return interpret(vm);
+}
+
+static void print_value(const BcProgram* program, Value value, FILE* out) {
+    switch (value_kind(value)) {
+        case VALUE_INT:
+            fprintf(out, "%d", value_as_int(value));
+            break;
+        case VALUE_BOOL:
+            fputs(value >> 32 ? "true" : "false", out);
+            break;
+        case VALUE_STRING:
+            fprintf(out, "\"%s\"", program->strings[value >> 32]);
+            break;
+        case VALUE_SMALL: {
+            const BcVariant* variant = &program->variants[value_small_variant(value)];
+            fprintf(out, "%.*s", (int)variant->name.length, variant->name.lexeme);
+            Value payload = value_small_payload(value);
+            if (value_kind(payload) != VALUE_UNDEF) {
+                fputc('(', out);
+                print_value(program, payload, out);
+                fputc(')', out);
+            }
+            break;
+        }
+        case VALUE_OBJECT: {
+            const VmObject* object = value_object(value);
+            const BcVariant* variant = &program->variants[object->variant];
+            fprintf(out, "%.*s", (int)variant->name.length, variant->name.lexeme);
+            for (uint32_t f = 0; f < variant->field_count; ++f) {
+                fputs(f == 0 ? "(" : ", ", out);
+                print_value(program, object->fields[f], out);
+            }
+            if (variant->field_count > 0) fputc(')', out);
+            break;
+        }
+        case VALUE_REF:
+            fputc('&', out);
+            print_value(program, *value_referent(value), out);
+            break;
+        default:
+            fputc('?', out);
+            break;
+    }
+}
+
+void vm_print_globals(const Vm* vm, FILE* out) {
+    const BcProgram* program = vm->program;
+    for (uint32_t g = 0; g < program->global_count; ++g) {
+        const IrGlobal* global = &program->globals[g];
+        fprintf(out, "%.*s = ", (int)global->name.length, global->name.lexeme);
+        print_value(program, vm->frame.globals[g], out);
+        fputc('\n', out);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdbool.h>
+#include <stdio.h> // For FILE*
+#include "bytecode.h"
+
+// Interpreter for bytecode programs (bytecode.h), tiering up to native code.
+//
+// Dispatch is threaded through a table of label addresses (GCC's computed
+// goto), so each instruction jumps straight to the next one's handler; other
+// compilers get a switch in a loop. Values are tagged words (value.h); heap
+// objects and borrowed cells come from a bump arena, reset at each run.
+//
+// The VM counts runs of the program and backward jumps to each target. Once
+// either gets hot, it compiles the program with the template JIT (jit.h) and
+// continues there: from the start of the next run, or right at the loop
+// header it was about to jump to.
+
+typedef struct Vm Vm;
+
+typedef struct {
+    size_t runs;
+    size_t native_runs;    // Started in native code
+    size_t osr_entries;    // Runs that moved to native code at a loop
+    size_t native_bytes;   // Size of the compiled code; 0 if none
+    double compile_seconds;
+} VmStats;
+
+// The program must outlive the VM. Returns NULL if out of memory.
+Vm* vm_create(const BcProgram* program);
+void vm_destroy(Vm* vm);
+
+// Whether hot code may be compiled; on by default.
+void vm_set_jit(Vm* vm, bool enabled);
+
+// Runs the program from the start. Returns false, after reporting on stderr,
+// on a run-time error: out of memory, or a `match` no arm applied to.
+bool vm_run(Vm* vm);
+
+// Prints each `let` as `name = value`, one per line, in the format of the
+// executables the C backend builds.
+void vm_print_globals(const Vm* vm, FILE* out);
+
+const VmStats* vm_stats(const Vm* vm);
+
+#endif // VM_H
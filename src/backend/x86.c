@@ -0,0 +1,235 @@
+#include "x86.h"
+#include <stdlib.h>
+#include <string.h> // For memcpy
+
+// --- Snippets ---
+//
+// Each snippet's holes are zero, and the *_AT constants say where they are:
+// 32-bit displacements and immediates unless marked 64.
+
+// mov rax, [rbx + B]; mov [rbx + A], rax
+static const uint8_t MOVE[] = {0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x89, 0x83, 0, 0, 0, 0};
+#define MOVE_B_AT 3
+#define MOVE_A_AT 10
+
+// mov rax, K (64); mov [rbx + A], rax
+static const uint8_t LOADK[] = {0x48, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0, 0x48, 0x89, 0x83, 0, 0, 0, 0};
+#define LOADK_K_AT 2
+#define LOADK_A_AT 13
+
+// mov rax, [rbx + B]; xor ecx, ecx; cmp rax, [rbx + C]; sete cl; shl rcx, 32;
+// or rcx, VALUE_BOOL; mov [rbx + A], rcx
+static const uint8_t EQ[] = {0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x31, 0xC9, 0x48, 0x3B, 0x83, 0, 0, 0, 0, 0x0F,
+                             0x94, 0xC1, 0x48, 0xC1, 0xE1, 0x20, 0x48, 0x83, 0xC9, 0x02, 0x48, 0x89, 0x8B, 0, 0, 0, 0};
+#define EQ_B_AT 3
+#define EQ_C_AT 12
+#define EQ_A_AT 30
+
+//   mov rax, [rbx + B]; mov ecx, eax; and ecx, 7; cmp ecx, VALUE_SMALL; jne object
+//   shr rax, 8; movzx eax, al; jmp done
+// object:
+//   mov eax, [rax]
+// done:
+//   shl rax, 32; or rax, VALUE_INT; mov [rbx + A], rax
+static const uint8_t TAG[] = {0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x89, 0xC1, 0x83, 0xE1, 0x07, 0x83, 0xF9, 0x04,
+                              0x75, 0x09, 0x48, 0xC1, 0xE8, 0x08, 0x0F, 0xB6, 0xC0, 0xEB, 0x02, 0x8B, 0x00, 0x48,
+                              0xC1, 0xE0, 0x20, 0x48, 0x83, 0xC8, 0x01, 0x48, 0x89, 0x83, 0, 0, 0, 0};
+#define TAG_B_AT 3
+#define TAG_A_AT 39
+
+//   mov rax, [rbx + B]; mov ecx, eax; and ecx, 7; cmp ecx, VALUE_SMALL; jne object
+//   mov ecx, eax; shr ecx, 3; and ecx, 7; shr rax, 32; shl rax, 32; or rax, rcx; jmp done
+// object:
+//   mov rax, [rax + field]
+// done:
+//   mov [rbx + A], rax
+static const uint8_t PROJECT[] = {0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x89, 0xC1, 0x83, 0xE1, 0x07, 0x83,
+                                  0xF9, 0x04, 0x75, 0x15, 0x89, 0xC1, 0xC1, 0xE9, 0x03, 0x83, 0xE1, 0x07, 0x48,
+                                  0xC1, 0xE8, 0x20, 0x48, 0xC1, 0xE0, 0x20, 0x48, 0x09, 0xC8, 0xEB, 0x07, 0x48,
+                                  0x8B, 0x80, 0, 0, 0, 0, 0x48, 0x89, 0x83, 0, 0, 0, 0};
+#define PROJECT_B_AT     3
+#define PROJECT_FIELD_AT 41
+#define PROJECT_A_AT     48
+
+// mov rax, [rbx + B]; mov ecx, eax; and ecx, 7; shl ecx, 3; shr rax, 32; shl rax, 32;
+// or rax, rcx; mov ecx, low bits; or rax, rcx; mov [rbx + A], rax
+static const uint8_t CONSTRUCT_SMALL[] = {0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x89, 0xC1, 0x83, 0xE1, 0x07, 0xC1, 0xE1,
+                                          0x03, 0x48, 0xC1, 0xE8, 0x20, 0x48, 0xC1, 0xE0, 0x20, 0x48, 0x09, 0xC8,
+                                          0xB9, 0, 0, 0, 0, 0x48, 0x09, 0xC8, 0x48, 0x89, 0x83, 0, 0, 0, 0};
+#define CONSTRUCT_SMALL_B_AT   3
+#define CONSTRUCT_SMALL_LOW_AT 27
+#define CONSTRUCT_SMALL_A_AT   37
+
+// mov rax, [rbx + A]; mov [r14 + Bx], rax
+static const uint8_t SETGLOBAL[] = {0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x49, 0x89, 0x86, 0, 0, 0, 0};
+// mov rax, [rbx + A]; mov [r13 + Bx], rax
+static const uint8_t SPILL[] = {0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x49, 0x89, 0x85, 0, 0, 0, 0};
+#define STORE_A_AT  3
+#define STORE_BX_AT 10
+
+// mov rax, [r13 + Bx]; mov [rbx + A], rax
+static const uint8_t RELOAD[] = {0x49, 0x8B, 0x85, 0, 0, 0, 0, 0x48, 0x89, 0x83, 0, 0, 0, 0};
+#define RELOAD_BX_AT 3
+#define RELOAD_A_AT  10
+
+// jmp target
+static const uint8_t JMP[] = {0xE9, 0, 0, 0, 0};
+#define JMP_AT 1
+
+// cmp dword [rbx + A + 4], 0; je pc + 2
+static const uint8_t TEST[] = {0x83, 0xBB, 0, 0, 0, 0, 0x00, 0x0F, 0x84, 0, 0, 0, 0};
+#define TEST_A_AT    2
+#define TEST_JUMP_AT 9
+
+//   movsxd rax, dword [rbx + A + 4]; mov rcx, low (64); sub rax, rcx; mov ecx, count;
+//   cmp rax, rcx; jae fallback; lea rcx, [rip + table]; movsxd rdx, dword [rcx + rax * 4];
+//   add rdx, rcx; jmp rdx
+// table:
+//   count 32-bit offsets from the table
+static const uint8_t SWITCH[] = {0x48, 0x63, 0x83, 0, 0, 0, 0, 0x48, 0xB9, 0, 0, 0, 0, 0, 0, 0, 0,
+                                 0x48, 0x29, 0xC8, 0xB9, 0, 0, 0, 0, 0x48, 0x39, 0xC8, 0x0F, 0x83, 0, 0,
+                                 0, 0, 0x48, 0x8D, 0x0D, 0x09, 0, 0, 0, 0x48, 0x63, 0x14, 0x81, 0x48, 0x01,
+                                 0xCA, 0xFF, 0xE2};
+#define SWITCH_A_AT        3
+#define SWITCH_LOW_AT      9
+#define SWITCH_COUNT_AT    21
+#define SWITCH_FALLBACK_AT 30
+
+// --- Buffer ---
+
+static bool grow(X86Buffer* buffer, void** items, size_t* capacity, size_t needed, size_t size) {
+    if (buffer->failed) return false;
+    if (needed <= *capacity) return true;
+    size_t new_capacity = *capacity ? *capacity * 2 : 4096;
+    while (new_capacity < needed) new_capacity *= 2;
+    void* grown = realloc(*items, new_capacity * size);
+    if (!grown) {
+        buffer->failed = true;
+        return false;
+    }
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+void x86_buffer_free(X86Buffer* buffer) {
+    free(buffer->bytes);
+    free(buffer->fixups);
+    *buffer = (X86Buffer){0};
+}
+
+size_t x86_put(X86Buffer* buffer, const uint8_t* bytes, size_t size) {
+    if (!grow(buffer, (void**)&buffer->bytes, &buffer->capacity, buffer->count + size, 1)) return 0;
+    size_t at = buffer->count;
+    memcpy(buffer->bytes + at, bytes, size);
+    buffer->count += size;
+    return at;
+}
+
+void x86_patch32(X86Buffer* buffer, size_t at, uint32_t value) {
+    if (!buffer->failed) memcpy(buffer->bytes + at, &value, sizeof(value));
+}
+
+void x86_patch64(X86Buffer* buffer, size_t at, uint64_t value) {
+    if (!buffer->failed) memcpy(buffer->bytes + at, &value, sizeof(value));
+}
+
+void x86_patch_label(X86Buffer* buffer, size_t at, size_t label) {
+    x86_patch32(buffer, at, (uint32_t)(int32_t)((int64_t)label - (int64_t)(at + 4)));
+}
+
+static void add_fixup(X86Buffer* buffer, size_t at, size_t base, uint32_t pc) {
+    if (!grow(buffer, (void**)&buffer->fixups, &buffer->fixup_capacity, buffer->fixup_count + 1, sizeof(X86Fixup))) {
+        return;
+    }
+    buffer->fixups[buffer->fixup_count++] = (X86Fixup){at, base, pc};
+}
+
+// --- Instructions ---
+
+bool x86_put_instr(X86Buffer* buffer, const BcProgram* program, uint32_t pc) {
+    BcInstr i = program->code[pc];
+    size_t at;
+    switch (BC_OP(i)) {
+        case BC_MOVE:
+            at = x86_put(buffer, MOVE, sizeof(MOVE));
+            x86_patch32(buffer, at + MOVE_B_AT, x86_slot(BC_B(i)));
+            x86_patch32(buffer, at + MOVE_A_AT, x86_slot(BC_A(i)));
+            return true;
+        case BC_LOADK:
+            at = x86_put(buffer, LOADK, sizeof(LOADK));
+            x86_patch64(buffer, at + LOADK_K_AT, program->constants[BC_BX(i)]);
+            x86_patch32(buffer, at + LOADK_A_AT, x86_slot(BC_A(i)));
+            return true;
+        case BC_CONSTRUCT_SMALL:
+            at = x86_put(buffer, CONSTRUCT_SMALL, sizeof(CONSTRUCT_SMALL));
+            x86_patch32(buffer, at + CONSTRUCT_SMALL_B_AT, x86_slot(BC_B(i)));
+            x86_patch32(buffer, at + CONSTRUCT_SMALL_LOW_AT, program->code[pc + 1]);
+            x86_patch32(buffer, at + CONSTRUCT_SMALL_A_AT, x86_slot(BC_A(i)));
+            return true;
+        case BC_PROJECT:
+            at = x86_put(buffer, PROJECT, sizeof(PROJECT));
+            x86_patch32(buffer, at + PROJECT_B_AT, x86_slot(BC_B(i)));
+            x86_patch32(buffer, at + PROJECT_FIELD_AT, (uint32_t)(sizeof(VmObject) + BC_C(i) * sizeof(Value)));
+            x86_patch32(buffer, at + PROJECT_A_AT, x86_slot(BC_A(i)));
+            return true;
+        case BC_TAG:
+            at = x86_put(buffer, TAG, sizeof(TAG));
+            x86_patch32(buffer, at + TAG_B_AT, x86_slot(BC_B(i)));
+            x86_patch32(buffer, at + TAG_A_AT, x86_slot(BC_A(i)));
+            return true;
+        case BC_EQ:
+            at = x86_put(buffer, EQ, sizeof(EQ));
+            x86_patch32(buffer, at + EQ_B_AT, x86_slot(BC_B(i)));
+            x86_patch32(buffer, at + EQ_C_AT, x86_slot(BC_C(i)));
+            x86_patch32(buffer, at + EQ_A_AT, x86_slot(BC_A(i)));
+            return true;
+        case BC_SETGLOBAL:
+        case BC_SPILL:
+            at = BC_OP(i) == BC_SPILL ? x86_put(buffer, SPILL, sizeof(SPILL))
+                                      : x86_put(buffer, SETGLOBAL, sizeof(SETGLOBAL));
+            x86_patch32(buffer, at + STORE_A_AT, x86_slot(BC_A(i)));
+            x86_patch32(buffer, at + STORE_BX_AT, x86_slot(BC_BX(i)));
+            return true;
+        case BC_RELOAD:
+            at = x86_put(buffer, RELOAD, sizeof(RELOAD));
+            x86_patch32(buffer, at + RELOAD_BX_AT, x86_slot(BC_BX(i)));
+            x86_patch32(buffer, at + RELOAD_A_AT, x86_slot(BC_A(i)));
+            return true;
+        case BC_JMP:
+            at = x86_put(buffer, JMP, sizeof(JMP));
+            add_fixup(buffer, at + JMP_AT, at + JMP_AT + 4, (uint32_t)((int64_t)pc + 1 + BC_SJ(i)));
+            return true;
+        case BC_TEST:
+            at = x86_put(buffer, TEST, sizeof(TEST));
+            x86_patch32(buffer, at + TEST_A_AT, x86_slot(BC_A(i)) + 4);
+            add_fixup(buffer, at + TEST_JUMP_AT, at + TEST_JUMP_AT + 4, pc + 2);
+            return true;
+        case BC_SWITCH: {
+            const BcSwitch* table = &program->switches[BC_BX(i)];
+            at = x86_put(buffer, SWITCH, sizeof(SWITCH));
+            x86_patch32(buffer, at + SWITCH_A_AT, x86_slot(BC_A(i)) + 4);
+            x86_patch64(buffer, at + SWITCH_LOW_AT, (uint64_t)table->low);
+            x86_patch32(buffer, at + SWITCH_COUNT_AT, table->count);
+            add_fixup(buffer, at + SWITCH_FALLBACK_AT, at + SWITCH_FALLBACK_AT + 4, program->targets[table->fallback]);
+            size_t base = buffer->count;
+            for (uint32_t t = 0; t < table->count; ++t) {
+                static const uint8_t entry[4] = {0};
+                add_fixup(buffer, x86_put(buffer, entry, sizeof(entry)), base, program->targets[table->first + t]);
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool x86_resolve(X86Buffer* buffer, const uint32_t* native, uint32_t code_count) {
+    if (buffer->count > INT32_MAX) buffer->failed = true;
+    for (size_t f = 0; f < buffer->fixup_count && !buffer->failed; ++f) {
+        const X86Fixup* fixup = &buffer->fixups[f];
+        if (fixup->pc >= code_count || native[fixup->pc] == UINT32_MAX) return false;
+        x86_patch32(buffer, fixup->at, (uint32_t)(int32_t)((int64_t)native[fixup->pc] - (int64_t)fixup->base));
+    }
+    return !buffer->failed;
+}
@@ -0,0 +1,56 @@
+#ifndef X86_H
+#define X86_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bytecode.h"
+
+// x86-64 machine code for bytecode instructions, shared by the JIT (jit.h)
+// and the native backend's object writer (asm_backend.h).
+//
+// Each instruction is a copy of a pre-assembled snippet for its opcode, with
+// register offsets, constants and jump displacements patched in. The code
+// keeps rbx pointing at the bytecode registers, r13 at the spill slots and r14
+// at the globals, and clobbers only rax, rcx and rdx. Setting those up, and
+// the instructions that allocate or leave the program, are up to the user.
+
+// A 32-bit field at `at` that must hold native[pc] - base.
+typedef struct {
+    size_t at;
+    size_t base;
+    uint32_t pc;
+} X86Fixup;
+
+typedef struct {
+    uint8_t* bytes;
+    size_t count, capacity;
+    X86Fixup* fixups;
+    size_t fixup_count, fixup_capacity;
+    bool failed; // Out of memory
+} X86Buffer;
+
+void x86_buffer_free(X86Buffer* buffer);
+
+// Appends `size` bytes; returns where they start.
+size_t x86_put(X86Buffer* buffer, const uint8_t* bytes, size_t size);
+void x86_patch32(X86Buffer* buffer, size_t at, uint32_t value);
+void x86_patch64(X86Buffer* buffer, size_t at, uint64_t value);
+
+// Points the rel32 at `at` at `label`, an offset already placed.
+void x86_patch_label(X86Buffer* buffer, size_t at, size_t label);
+
+// Emits the instruction at `pc`, unless it allocates or leaves the program
+// (CONSTRUCT, BORROW, HALT, UNREACHABLE): then it emits nothing and returns false.
+bool x86_put_instr(X86Buffer* buffer, const BcProgram* program, uint32_t pc);
+
+// Patches the jumps, given each code index's offset in the buffer, UINT32_MAX
+// within an instruction. Returns false if one lands there.
+bool x86_resolve(X86Buffer* buffer, const uint32_t* native, uint32_t code_count);
+
+// Byte offset of register, spill slot or global `index` from its base register.
+static inline uint32_t x86_slot(uint32_t index) {
+    return index * (uint32_t)sizeof(Value);
+}
+
+#endif // X86_H
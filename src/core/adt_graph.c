@@ -0,0 +1,249 @@
+#include "adt_graph.h"
+#include "symbol_table.h"
+#include "types.h"
+#include "../util/hash.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Symbol* -> node index, open addressing (capacity is a power of two).
+typedef struct {
+    struct Symbol** keys;
+    int* values;
+    size_t capacity;
+} NodeMap;
+
+static bool node_map_init(NodeMap* map, size_t count) {
+    map->capacity = 16;
+    while (map->capacity < count * 2) map->capacity *= 2;
+    map->keys = (struct Symbol**)calloc(map->capacity, sizeof(struct Symbol*));
+    map->values = (int*)malloc(map->capacity * sizeof(int));
+    return map->keys && map->values;
+}
+
+static size_t node_map_probe(const NodeMap* map, const struct Symbol* key) {
+    size_t mask = map->capacity - 1;
+    size_t i = hash_combine(0, (uint64_t)(uintptr_t)key) & mask;
+    while (map->keys[i] && map->keys[i] != key) i = (i + 1) & mask;
+    return i;
+}
+
+static int node_map_get(const NodeMap* map, const struct Symbol* key) {
+    size_t i = node_map_probe(map, key);
+    return map->keys[i] ? map->values[i] : -1;
+}
+
+// Calls visit(node, ctx) for every analyzed ADT mentioned by value in `type`.
+static void for_each_mention(const NodeMap* map, Type* type, void (*visit)(int node, void* ctx), void* ctx) {
+    if (type->kind != TYPE_ADT) return; // References, parameters and primitives add no edge
+    TypeADT* adt = (TypeADT*)type;
+    int node = node_map_get(map, adt->adt_symbol);
+    if (node >= 0) visit(node, ctx);
+    for (size_t i = 0; i < adt->type_arg_count; ++i) {
+        for_each_mention(map, adt->type_args[i], visit, ctx);
+    }
+}
+
+typedef struct {
+    int* targets;   // NULL while counting
+    size_t count;
+} EdgeSink;
+
+static void add_edge(int node, void* ctx) {
+    EdgeSink* sink = (EdgeSink*)ctx;
+    if (sink->targets) sink->targets[sink->count] = node;
+    sink->count++;
+}
+
+typedef struct {
+    const int* scc_of;
+    int scc;
+    bool found;
+} SameSccCheck;
+
+static void check_same_scc(int node, void* ctx) {
+    SameSccCheck* check = (SameSccCheck*)ctx;
+    if (check->scc_of[node] == check->scc) check->found = true;
+}
+
+// Feeds every field type of an ADT to for_each_mention.
+static void for_each_field_mention(const NodeMap* map, ADTDefinition* def, void (*visit)(int node, void* ctx), void* ctx) {
+    for (size_t v = 0; v < da_count(def->variants); ++v) {
+        ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(def->variants, v);
+        for (size_t f = 0; f < da_count(variant->fields); ++f) {
+            for_each_mention(map, ((ADTFieldSymbol*)da_get(variant->fields, f))->type, visit, ctx);
+        }
+    }
+}
+
+// Whether a field type has a finite value, given what is known so far about the
+// ADTs it mentions. Type arguments are assumed inhabited.
+static bool field_inhabited(Type* type) {
+    if (type->kind != TYPE_ADT) return true;
+    ADTDefinition* def = ((TypeADT*)type)->adt_symbol->data.adt_def;
+    return !def || def->inhabited;
+}
+
+// Whether some variant has only inhabited fields.
+static bool has_finite_variant(ADTDefinition* def) {
+    for (size_t v = 0; v < da_count(def->variants); ++v) {
+        ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(def->variants, v);
+        bool all = true;
+        for (size_t f = 0; f < da_count(variant->fields) && all; ++f) {
+            all = field_inhabited(((ADTFieldSymbol*)da_get(variant->fields, f))->type);
+        }
+        if (all) return true;
+    }
+    return false;
+}
+
+ADTGraph* adt_graph_build(DynamicArray* adt_symbols) {
+    size_t n = da_count(adt_symbols);
+    ADTGraph* graph = (ADTGraph*)calloc(1, sizeof(ADTGraph));
+    if (!graph) return NULL;
+    graph->nodes = (struct Symbol**)malloc((n ? n : 1) * sizeof(struct Symbol*));
+    graph->scc_start = (size_t*)malloc((n + 1) * sizeof(size_t));
+
+    NodeMap map = {0};
+    size_t* edge_start = (size_t*)calloc(n + 1, sizeof(size_t));
+    int* index = (int*)malloc((n ? n : 1) * sizeof(int));     // Tarjan discovery index (-1 = unvisited)
+    int* lowlink = (int*)malloc((n ? n : 1) * sizeof(int));
+    int* scc_of = (int*)malloc((n ? n : 1) * sizeof(int));    // Component, -1 while on the stack
+    int* stack = (int*)malloc((n ? n : 1) * sizeof(int));     // Tarjan's node stack
+    int* call_node = (int*)malloc((n ? n : 1) * sizeof(int)); // Explicit DFS stack: node ...
+    size_t* call_edge = (size_t*)malloc((n ? n : 1) * sizeof(size_t)); // ... and next edge to follow
+    int* edges = NULL;
+    bool ok = graph->nodes && graph->scc_start && edge_start && index && lowlink && scc_of && stack &&
+              call_node && call_edge && node_map_init(&map, n);
+
+    // Nodes, then edges in compressed (CSR) form: count, prefix-sum, fill.
+    for (size_t i = 0; ok && i < n; ++i) {
+        struct Symbol* sym = (struct Symbol*)da_get(adt_symbols, i);
+        size_t slot = node_map_probe(&map, sym);
+        map.keys[slot] = sym;
+        map.values[slot] = (int)i;
+    }
+    for (size_t i = 0; ok && i < n; ++i) {
+        EdgeSink sink = {NULL, 0};
+        ADTDefinition* def = ((struct Symbol*)da_get(adt_symbols, i))->data.adt_def;
+        for_each_field_mention(&map, def, add_edge, &sink);
+        edge_start[i + 1] = edge_start[i] + sink.count;
+    }
+    if (ok) {
+        edges = (int*)malloc((edge_start[n] ? edge_start[n] : 1) * sizeof(int));
+        ok = edges != NULL;
+    }
+    for (size_t i = 0; ok && i < n; ++i) {
+        EdgeSink sink = {edges + edge_start[i], 0};
+        ADTDefinition* def = ((struct Symbol*)da_get(adt_symbols, i))->data.adt_def;
+        for_each_field_mention(&map, def, add_edge, &sink);
+    }
+
+    // Tarjan, iteratively so long chains of declarations cannot overflow the C stack.
+    // A component is emitted when its root finishes, after every component it
+    // reaches: emission order is already dependencies first.
+    if (ok) {
+        for (size_t i = 0; i < n; ++i) {
+            index[i] = -1;
+            scc_of[i] = -1;
+        }
+        int next_index = 0;
+        size_t stack_top = 0;
+        graph->node_count = 0;
+        graph->scc_count = 0;
+        for (size_t root = 0; root < n; ++root) {
+            if (index[root] >= 0) continue;
+            size_t depth = 0;
+            call_node[depth] = (int)root;
+            call_edge[depth] = edge_start[root];
+            index[root] = lowlink[root] = next_index++;
+            stack[stack_top++] = (int)root;
+            while (true) {
+                int v = call_node[depth];
+                if (call_edge[depth] < edge_start[v + 1]) {
+                    int w = edges[call_edge[depth]++];
+                    if (index[w] < 0) {
+                        index[w] = lowlink[w] = next_index++;
+                        stack[stack_top++] = w;
+                        depth++;
+                        call_node[depth] = w;
+                        call_edge[depth] = edge_start[w];
+                    } else if (scc_of[w] < 0 && index[w] < lowlink[v]) {
+                        lowlink[v] = index[w]; // w is on the stack: same component
+                    }
+                    continue;
+                }
+                if (lowlink[v] == index[v]) {
+                    graph->scc_start[graph->scc_count] = graph->node_count;
+                    int w;
+                    do {
+                        w = stack[--stack_top];
+                        scc_of[w] = (int)graph->scc_count;
+                        graph->nodes[graph->node_count++] = (struct Symbol*)da_get(adt_symbols, (size_t)w);
+                    } while (w != v);
+                    graph->scc_count++;
+                }
+                if (depth == 0) break;
+                depth--;
+                int parent = call_node[depth];
+                if (lowlink[v] < lowlink[parent]) lowlink[parent] = lowlink[v];
+            }
+        }
+        graph->scc_start[graph->scc_count] = graph->node_count;
+    }
+
+    // Per component, in topological order: box the fields that close a cycle,
+    // then find which members have finite values. Members depend only on earlier
+    // components and on each other, so the inhabitation fixpoint stays local.
+    for (size_t k = 0; ok && k < graph->scc_count; ++k) {
+        size_t first = graph->scc_start[k], last = graph->scc_start[k + 1];
+        for (size_t i = first; i < last; ++i) {
+            struct Symbol* sym = graph->nodes[i];
+            ADTDefinition* def = sym->data.adt_def;
+            def->scc = (int)k;
+            def->recursive = last - first > 1;
+            for (size_t v = 0; v < da_count(def->variants); ++v) {
+                ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(def->variants, v);
+                for (size_t f = 0; f < da_count(variant->fields); ++f) {
+                    ADTFieldSymbol* field = (ADTFieldSymbol*)da_get(variant->fields, f);
+                    SameSccCheck check = {scc_of, (int)k, false};
+                    for_each_mention(&map, field->type, check_same_scc, &check);
+                    field->boxed = check.found;
+                    if (check.found) def->recursive = true;
+                }
+            }
+            def->inhabited = false; // Least fixpoint: members earn it below
+        }
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = first; i < last; ++i) {
+                ADTDefinition* def = graph->nodes[i]->data.adt_def;
+                if (!def->inhabited && has_finite_variant(def)) def->inhabited = changed = true;
+            }
+        }
+    }
+
+    free(map.keys);
+    free(map.values);
+    free(edge_start);
+    free(edges);
+    free(index);
+    free(lowlink);
+    free(scc_of);
+    free(stack);
+    free(call_node);
+    free(call_edge);
+    if (!ok) {
+        adt_graph_destroy(graph);
+        return NULL;
+    }
+    return graph;
+}
+
+void adt_graph_destroy(ADTGraph* graph) {
+    if (!graph) return;
+    free(graph->nodes);
+    free(graph->scc_start);
+    free(graph);
+}
@@ -0,0 +1,39 @@
+#ifndef ADT_GRAPH_H
+#define ADT_GRAPH_H
+
+#include <stddef.h>
+#include "../util/dynamic_array.h"
+
+struct Symbol;
+
+// Dependency graph of `data` declarations and its strongly connected components.
+//
+// ADT A depends on ADT B when a field of A mentions B by value, directly or as a
+// type argument (`Cons(T, List<T>)`, `Node(Option<Tree<T>>)`); references don't
+// count, since `&B` is a pointer whatever B is. Components are found with
+// Tarjan's algorithm in O(ADTs + fields) and numbered in topological order,
+// dependencies first, so passes over ADTs can finish one component before the
+// next instead of iterating to a global fixpoint.
+//
+// The analysis also decides:
+//   - which fields need indirection: a field that mentions an ADT of its own
+//     component closes a cycle and is boxed (ADTFieldSymbol.boxed). Every cycle
+//     of by-value fields then goes through a box, so layouts and derived
+//     properties can be computed by plain recursion over concrete types.
+//   - which ADTs are recursive, and which have a finite value at all
+//     (ADTDefinition.recursive / .inhabited). `data Bad { B(Bad) }` has none.
+//     Type arguments are assumed inhabited, so this never rejects a valid type.
+typedef struct {
+    struct Symbol** nodes; // ADT symbols, grouped by component, components in topological order
+    size_t node_count;
+    size_t* scc_start;     // Component k is nodes[scc_start[k] .. scc_start[k + 1])
+    size_t scc_count;
+} ADTGraph;
+
+// Builds the graph over `adt_symbols` (Symbol* with an ADTDefinition whose
+// fields are resolved) and annotates their definitions and field symbols.
+// Mentions of ADTs outside the list are treated as already analyzed.
+ADTGraph* adt_graph_build(DynamicArray* adt_symbols);
+void adt_graph_destroy(ADTGraph* graph);
+
+#endif // ADT_GRAPH_H
@@ -0,0 +1,144 @@
+#include "adt_instance.h"
+#include "symbol_table.h"
+#include "type_infer.h" // For type_substitute_params
+#include <stdlib.h>
+
+ADTInstanceCache* adt_instance_cache_create(void) {
+    ADTInstanceCache* cache = (ADTInstanceCache*)malloc(sizeof(ADTInstanceCache));
+    if (!cache) return NULL;
+    cache->by_type_id = NULL;
+    cache->capacity = 0;
+    cache->count = 0;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+static void instance_destroy(ADTInstance* instance) {
+    for (size_t i = 0; i < instance->variant_count; ++i) {
+        free(instance->variants[i].field_types);
+    }
+    free(instance->variants);
+    free(instance);
+}
+
+void adt_instance_cache_destroy(ADTInstanceCache* cache) {
+    if (!cache) return;
+    for (size_t i = 0; i < cache->capacity; ++i) {
+        if (cache->by_type_id[i]) instance_destroy(cache->by_type_id[i]);
+    }
+    free(cache->by_type_id);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+static ADTInstance* instantiate(TypeADT* adt) {
+    ADTDefinition* def = adt->adt_symbol->data.adt_def;
+    ADTInstance* instance = (ADTInstance*)malloc(sizeof(ADTInstance));
+    if (!instance) return NULL;
+    instance->type = (Type*)adt;
+    instance->adt_symbol = adt->adt_symbol;
+    instance->variant_count = da_count(def->variants);
+    instance->variants = (ADTInstanceVariant*)calloc(instance->variant_count ? instance->variant_count : 1,
+                                                     sizeof(ADTInstanceVariant));
+    if (!instance->variants) {
+        free(instance);
+        return NULL;
+    }
+    for (size_t v = 0; v < instance->variant_count; ++v) {
+        ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(def->variants, v);
+        ADTInstanceVariant* out = &instance->variants[v];
+        out->variant = variant;
+        out->field_count = da_count(variant->fields);
+        if (out->field_count == 0) continue;
+        out->field_types = (Type**)malloc(out->field_count * sizeof(Type*));
+        if (!out->field_types) {
+            instance_destroy(instance);
+            return NULL;
+        }
+        for (size_t f = 0; f < out->field_count; ++f) {
+            ADTFieldSymbol* field = (ADTFieldSymbol*)da_get(variant->fields, f);
+            out->field_types[f] = type_substitute_params(field->type, adt->adt_symbol,
+                                                         adt->type_args, adt->type_arg_count);
+        }
+    }
+    return instance;
+}
+
+static const ADTInstance* get_instance(ADTInstanceCache* cache, Type* type, bool* created) {
+    if (created) *created = false;
+    if (!cache || !type || type->kind != TYPE_ADT) return NULL;
+    TypeADT* adt = (TypeADT*)type;
+    if (!adt->adt_symbol || !adt->adt_symbol->data.adt_def) return NULL;
+
+    pthread_mutex_lock(&cache->lock);
+    if (type->id >= cache->capacity) {
+        size_t new_capacity = cache->capacity ? cache->capacity : 64;
+        while (new_capacity <= type->id) new_capacity *= 2;
+        ADTInstance** grown = (ADTInstance**)realloc(cache->by_type_id, new_capacity * sizeof(ADTInstance*));
+        if (!grown) {
+            pthread_mutex_unlock(&cache->lock);
+            return NULL;
+        }
+        for (size_t i = cache->capacity; i < new_capacity; ++i) grown[i] = NULL;
+        cache->by_type_id = grown;
+        cache->capacity = new_capacity;
+    }
+    ADTInstance* instance = cache->by_type_id[type->id];
+    if (!instance) {
+        instance = instantiate(adt);
+        if (instance) {
+            cache->by_type_id[type->id] = instance;
+            cache->count++;
+            if (created) *created = true;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return instance;
+}
+
+const ADTInstance* adt_instance_get(ADTInstanceCache* cache, Type* type) {
+    return get_instance(cache, type, NULL);
+}
+
+void adt_instance_refresh(ADTInstanceCache* cache, struct Symbol* adt_symbol) {
+    if (!cache || !adt_symbol) return;
+    for (size_t i = 0; i < cache->capacity; ++i) {
+        ADTInstance* instance = cache->by_type_id[i];
+        if (!instance || instance->adt_symbol != adt_symbol) continue;
+        ADTInstance* fresh = instantiate((TypeADT*)instance->type);
+        if (!fresh) continue;
+        ADTInstance old = *instance;
+        *instance = *fresh;
+        *fresh = old;
+        instance_destroy(fresh); // Frees the old variants
+        for (size_t v = 0; v < instance->variant_count; ++v) {
+            for (size_t f = 0; f < instance->variants[v].field_count; ++f) {
+                adt_instance_require(cache, instance->variants[v].field_types[f]);
+            }
+        }
+    }
+}
+
+void adt_instance_require(ADTInstanceCache* cache, Type* type) {
+    if (!cache || !type) return;
+    DynamicArray* worklist = da_create(16, sizeof(Type*));
+    if (!worklist) return;
+    da_push(worklist, type);
+    while (da_count(worklist) > 0) {
+        Type* next = (Type*)da_pop(worklist);
+        if (next->flags & (TYPE_HAS_PARAMS | TYPE_HAS_VARS)) continue; // Not a concrete specialization
+        if (next->kind == TYPE_REFERENCE) {
+            da_push(worklist, ((TypeReference*)next)->referent);
+            continue;
+        }
+        bool created = false;
+        const ADTInstance* instance = get_instance(cache, next, &created);
+        if (!created) continue; // Already expanded (or not an ADT)
+        for (size_t v = 0; v < instance->variant_count; ++v) {
+            for (size_t f = 0; f < instance->variants[v].field_count; ++f) {
+                da_push(worklist, instance->variants[v].field_types[f]);
+            }
+        }
+    }
+    da_destroy(worklist);
+}
@@ -0,0 +1,55 @@
+#ifndef ADT_INSTANCE_H
+#define ADT_INSTANCE_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include <pthread.h>
+#include "types.h"
+
+struct Symbol;
+
+// One variant of an instantiated ADT, with its field types substituted.
+typedef struct {
+    ADTVariantSymbol* variant; // The generic variant in the ADT definition (not owned)
+    Type** field_types;        // Substituted field types, e.g. i32 for Some(T) in Option<i32>
+    size_t field_count;
+} ADTInstanceVariant;
+
+// A specialization of a `data` declaration, such as Option<i32>.
+typedef struct {
+    Type* type;                   // The interned TypeADT this instance describes
+    struct Symbol* adt_symbol;
+    ADTInstanceVariant* variants; // In tag order
+    size_t variant_count;
+} ADTInstance;
+
+// Cache of ADT specializations. An interned TypeADT already identifies the pair
+// (ADT symbol, interned argument list), so instances are indexed directly by the
+// type's interning ID: the substitution for Option<i32> is done once, on first
+// request, and every later request is an array load.
+// Thread-safe; instances stay valid until the cache is destroyed.
+typedef struct {
+    ADTInstance** by_type_id; // Indexed by Type.id; NULL = not instantiated yet
+    size_t capacity;
+    size_t count;             // Number of instances created
+    pthread_mutex_t lock;
+} ADTInstanceCache;
+
+ADTInstanceCache* adt_instance_cache_create(void);
+void adt_instance_cache_destroy(ADTInstanceCache* cache);
+
+// Returns the instance for an ADT type, computing it on first use. Returns NULL
+// if `type` is not an ADT type or its definition is not analyzed yet.
+const ADTInstance* adt_instance_get(ADTInstanceCache* cache, Type* type);
+
+// Instantiates `type` and, transitively, every concrete ADT type reachable
+// through its fields (the specializations a backend has to emit). Types that
+// still mention generic parameters are skipped.
+void adt_instance_require(ADTInstanceCache* cache, Type* type);
+
+// Re-instantiates every cached instance of `adt_symbol` after its variants were
+// replaced (incremental analysis), then requires the new field types. Instances
+// keep their addresses. Not thread-safe with respect to other callers.
+void adt_instance_refresh(ADTInstanceCache* cache, struct Symbol* adt_symbol);
+
+#endif // ADT_INSTANCE_H
@@ -10,6 +10,7 @@ Expr* ast_expr_literal_create(Token literal) {
     ExprLiteral* expr = (ExprLiteral*)malloc(sizeof(ExprLiteral));
     if (!expr) return NULL;
     expr->base.type = EXPR_LITERAL;
+    expr->base.inferred_type = NULL;
     expr->literal = literal; // Token is copied by value
     return (Expr*)expr;
 }
@@ -18,7 +19,13 @@ Expr* ast_expr_variable_create(Token name) {
     ExprVariable* expr = (ExprVariable*)malloc(sizeof(ExprVariable));
     if (!expr) return NULL;
     expr->base.type = EXPR_VARIABLE;
+    expr->base.inferred_type = NULL;
     expr->name = name; // Token is copied by value
+    expr->symbol = NULL; // Filled in by the resolver
+    expr->depth = -1;
+    expr->slot = -1;
+    expr->constructor_adt = NULL;
+    expr->constructor_tag = -1;
     return (Expr*)expr;
 }
 
@@ -26,34 +33,118 @@ Expr* ast_expr_call_create(Expr* callee, DynamicArray* arguments, Token closing_
     ExprCall* expr = (ExprCall*)malloc(sizeof(ExprCall));
     if (!expr) return NULL;
     expr->base.type = EXPR_CALL;
+    expr->base.inferred_type = NULL;
     expr->callee = callee; // Ownership assumed by ExprCall
     expr->arguments = arguments; // Ownership assumed by ExprCall
     expr->closing_paren = closing_paren;
+    expr->constructor_adt = NULL; // Filled in by the resolver
+    expr->constructor_tag = -1;
     return (Expr*)expr;
 }
 
+Expr* ast_expr_borrow_create(Token ampersand, bool is_mutable, Expr* operand) {
+    ExprBorrow* expr = (ExprBorrow*)malloc(sizeof(ExprBorrow));
+    if (!expr) return NULL;
+    expr->base.type = EXPR_BORROW;
+    expr->base.inferred_type = NULL;
+    expr->ampersand = ampersand;
+    expr->is_mutable = is_mutable;
+    expr->operand = operand; // Ownership assumed by ExprBorrow
+    return (Expr*)expr;
+}
+
+Expr* ast_expr_match_create(Token keyword, Expr* scrutinee, DynamicArray* arms) {
+    ExprMatch* expr = (ExprMatch*)malloc(sizeof(ExprMatch));
+    if (!expr) return NULL;
+    expr->base.type = EXPR_MATCH;
+    expr->base.inferred_type = NULL;
+    expr->keyword = keyword;
+    expr->scrutinee = scrutinee; // Ownership assumed by ExprMatch
+    expr->arms = arms;           // Ownership assumed by ExprMatch
+    return (Expr*)expr;
+}
+
+MatchArm* ast_match_arm_create(Pattern* pattern, Expr* body) {
+    MatchArm* arm = (MatchArm*)malloc(sizeof(MatchArm));
+    if (!arm) return NULL;
+    arm->pattern = pattern; // Ownership assumed by MatchArm
+    arm->body = body;
+    return arm;
+}
+
+Pattern* ast_pattern_create(PatternKind kind, Token token, DynamicArray* subpatterns) {
+    Pattern* pattern = (Pattern*)malloc(sizeof(Pattern));
+    if (!pattern) return NULL;
+    pattern->kind = kind;
+    pattern->token = token;
+    pattern->subpatterns = subpatterns; // Ownership assumed by Pattern
+    pattern->symbol = NULL;             // Filled in by the resolver
+    pattern->constructor_adt = NULL;
+    pattern->constructor_tag = -1;
+    pattern->inferred_type = NULL;
+    return pattern;
+}
+
 //------------------------------------------------------------------------------
 // Statement Node Constructor Functions
 //------------------------------------------------------------------------------
 
-Stmt* ast_stmt_let_create(Token name, bool is_mutable, Expr* initializer) {
+Stmt* ast_stmt_let_create(Token name, bool is_mutable, TypeAnnotation* type_annot, Expr* initializer) {
     StmtLet* stmt = (StmtLet*)malloc(sizeof(StmtLet));
     if (!stmt) return NULL;
     stmt->base.type = STMT_LET;
     stmt->name = name; // Token copied by value
     stmt->is_mutable = is_mutable;
+    stmt->type_annot = type_annot; // Ownership assumed by StmtLet
     stmt->initializer = initializer; // Ownership assumed by StmtLet
+    stmt->symbol = NULL; // Filled in by the resolver, owned by the symbol table
     return (Stmt*)stmt;
 }
 
-ADTVariantField* ast_adt_variant_field_create(Token name, Token type_name_token) {
+ADTVariantField* ast_adt_variant_field_create(Token name, TypeAnnotation* type_annot) {
     ADTVariantField* field = (ADTVariantField*)malloc(sizeof(ADTVariantField));
     if (!field) return NULL;
     field->name = name; // Optional, token copied
-    field->type_name_token = type_name_token; // Token copied
+    field->type_annot = type_annot; // Ownership assumed by the field
+    // The head name, skipping any `&` / `&mut`.
+    TypeAnnotation* head = type_annot;
+    while (head && head->referent) head = head->referent;
+    field->type_name_token = head ? head->name : (Token){0};
     return field;
 }
 
+TypeAnnotation* ast_type_annotation_create(Token name, DynamicArray* args) {
+    TypeAnnotation* annot = (TypeAnnotation*)malloc(sizeof(TypeAnnotation));
+    if (!annot) return NULL;
+    annot->name = name;
+    annot->args = args; // Ownership of DA and its TypeAnnotation* elements assumed
+    annot->referent = NULL;
+    annot->is_mutable = false;
+    return annot;
+}
+
+TypeAnnotation* ast_type_annotation_reference_create(Token ampersand, bool is_mutable, TypeAnnotation* referent) {
+    TypeAnnotation* annot = (TypeAnnotation*)malloc(sizeof(TypeAnnotation));
+    if (!annot) return NULL;
+    annot->name = ampersand;
+    annot->args = NULL;
+    annot->referent = referent; // Ownership assumed
+    annot->is_mutable = is_mutable;
+    return annot;
+}
+
+void ast_type_annotation_destroy(TypeAnnotation* annot) {
+    if (!annot) return;
+    if (annot->args) {
+        for (size_t i = 0; i < da_count(annot->args); ++i) {
+            ast_type_annotation_destroy((TypeAnnotation*)da_get(annot->args, i));
+        }
+        da_destroy(annot->args);
+    }
+    ast_type_annotation_destroy(annot->referent);
+    free(annot);
+}
+
 ADTVariant* ast_adt_variant_create(Token name, DynamicArray* fields) {
     ADTVariant* variant = (ADTVariant*)malloc(sizeof(ADTVariant));
     if (!variant) return NULL;
@@ -62,7 +153,7 @@ ADTVariant* ast_adt_variant_create(Token name, DynamicArray* fields) {
     return variant;
 }
 
-Stmt* ast_stmt_data_create(Token name, DynamicArray* type_params, DynamicArray* variants) {
+Stmt* ast_stmt_data_create(Token name, DynamicArray* type_params, DynamicArray* param_bounds, DynamicArray* variants) {
     StmtData* stmt = (StmtData*)malloc(sizeof(StmtData));
     if (!stmt) return NULL;
     stmt->base.type = STMT_DATA;
@@ -75,7 +166,30 @@ Stmt* ast_stmt_data_create(Token name, DynamicArray* type_params, DynamicArray*
                                      // Given Token is a struct, DynamicArray probably stores copies or pointers to parts of source.
                                      // Let's assume type_params stores Token (copied by value in DA if DA supports it, or pointers to source tokens).
                                      // For ADTVariant*, the variants DA owns the ADTVariant pointers.
+    stmt->param_bounds = param_bounds; // Ownership of DA, its DAs and their Token* elements assumed
     stmt->variants = variants;       // Ownership of DA and its ADTVariant* elements assumed
+    stmt->symbol = NULL;             // Filled in by the resolver, owned by the symbol table
+    return (Stmt*)stmt;
+}
+
+Stmt* ast_stmt_class_create(Token name, Token superclass, DynamicArray* methods) {
+    StmtClass* stmt = (StmtClass*)malloc(sizeof(StmtClass));
+    if (!stmt) return NULL;
+    stmt->base.type = STMT_CLASS;
+    stmt->name = name;
+    stmt->superclass = superclass;
+    stmt->methods = methods; // Ownership of DA and its Token* elements assumed
+    return (Stmt*)stmt;
+}
+
+Stmt* ast_stmt_instance_create(Token class_name, DynamicArray* type_params, DynamicArray* param_bounds, TypeAnnotation* head) {
+    StmtInstance* stmt = (StmtInstance*)malloc(sizeof(StmtInstance));
+    if (!stmt) return NULL;
+    stmt->base.type = STMT_INSTANCE;
+    stmt->class_name = class_name;
+    stmt->type_params = type_params;   // Ownership assumed, as in StmtData
+    stmt->param_bounds = param_bounds; // Ownership assumed, as in StmtData
+    stmt->head = head;                 // Ownership assumed
     return (Stmt*)stmt;
 }
 
@@ -95,10 +209,28 @@ Program* ast_program_create(DynamicArray* statements) {
 static void ast_adt_variant_field_destroy(ADTVariantField* field) {
     if (!field) return;
     // Tokens are not heap-allocated themselves (lexeme points to source).
-    // If type_name_token's lexeme were copied, it would be freed here.
+    ast_type_annotation_destroy(field->type_annot);
     free(field);
 }
 
+// Frees a DynamicArray of heap-allocated Token* (type parameters, method names).
+static void ast_token_list_destroy(DynamicArray* tokens) {
+    if (!tokens) return;
+    for (size_t i = 0; i < da_count(tokens); ++i) {
+        free(da_get(tokens, i));
+    }
+    da_destroy(tokens);
+}
+
+// Frees a param_bounds list: one token list (or NULL) per type parameter.
+static void ast_param_bounds_destroy(DynamicArray* bounds) {
+    if (!bounds) return;
+    for (size_t i = 0; i < da_count(bounds); ++i) {
+        ast_token_list_destroy((DynamicArray*)da_get(bounds, i));
+    }
+    da_destroy(bounds);
+}
+
 static void ast_adt_variant_destroy(ADTVariant* variant) {
     if (!variant) return;
     if (variant->fields) {
@@ -135,6 +267,21 @@ void ast_expr_destroy(Expr* expr) {
             }
             break;
         }
+        case EXPR_BORROW:
+            ast_expr_destroy(((ExprBorrow*)expr)->operand);
+            break;
+        case EXPR_MATCH: {
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            ast_expr_destroy(match_expr->scrutinee);
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                ast_pattern_destroy(arm->pattern);
+                ast_expr_destroy(arm->body);
+                free(arm);
+            }
+            if (match_expr->arms) da_destroy(match_expr->arms);
+            break;
+        }
         // Add other expression types
         default:
             // Should not happen if all types are handled
@@ -143,6 +290,18 @@ void ast_expr_destroy(Expr* expr) {
     free(expr);
 }
 
+// The symbols a pattern binds are owned by the symbol table.
+void ast_pattern_destroy(Pattern* pattern) {
+    if (!pattern) return;
+    if (pattern->subpatterns) {
+        for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+            ast_pattern_destroy((Pattern*)da_get(pattern->subpatterns, i));
+        }
+        da_destroy(pattern->subpatterns);
+    }
+    free(pattern);
+}
+
 void ast_stmt_destroy(Stmt* stmt) {
     if (!stmt) return;
 
@@ -152,18 +311,15 @@ void ast_stmt_destroy(Stmt* stmt) {
             if (let_stmt->initializer) {
                 ast_expr_destroy(let_stmt->initializer);
             }
+            ast_type_annotation_destroy(let_stmt->type_annot);
             // Token name is a struct.
             break;
         }
         case STMT_DATA: {
             StmtData* data_stmt = (StmtData*)stmt;
             // Type parameters (Tokens) are now stored as Token* (pointers to heap-allocated Tokens)
-            if (data_stmt->type_params) {
-                for (size_t i = 0; i < da_count(data_stmt->type_params); ++i) {
-                    free(da_get(data_stmt->type_params, i)); // Free each Token*
-                }
-                da_destroy(data_stmt->type_params);
-            }
+            ast_token_list_destroy(data_stmt->type_params);
+            ast_param_bounds_destroy(data_stmt->param_bounds);
             if (data_stmt->variants) {
                 for (size_t i = 0; i < da_count(data_stmt->variants); ++i) {
                     ast_adt_variant_destroy((ADTVariant*)da_get(data_stmt->variants, i));
@@ -172,6 +328,16 @@ void ast_stmt_destroy(Stmt* stmt) {
             }
             break;
         }
+        case STMT_CLASS:
+            ast_token_list_destroy(((StmtClass*)stmt)->methods);
+            break;
+        case STMT_INSTANCE: {
+            StmtInstance* instance_stmt = (StmtInstance*)stmt;
+            ast_token_list_destroy(instance_stmt->type_params);
+            ast_param_bounds_destroy(instance_stmt->param_bounds);
+            ast_type_annotation_destroy(instance_stmt->head);
+            break;
+        }
         case STMT_EXPRESSION: {
             // If StmtExpression has an Expr field, cast and destroy it.
             // Example: StmtExpression* expr_stmt = (StmtExpression*)stmt; ast_expr_destroy(expr_stmt->expression);
@@ -8,6 +8,8 @@
 // Forward declarations for recursive structures if needed
 struct Expr;
 struct Stmt;
+struct Symbol; // Bindings filled in by name resolution (see resolver.h)
+struct Type;   // Inferred types filled in by type inference (see type_infer.h)
 
 //------------------------------------------------------------------------------
 // Expression Node Types
@@ -20,12 +22,15 @@ typedef enum {
     EXPR_UNARY,  // e.g., -a, !b
     EXPR_GROUPING, // e.g., (a + b)
     EXPR_CALL,     // e.g., func(a, b) - For ADT instantiation like Some(T) initially
+    EXPR_BORROW,   // e.g., &a, &mut a
+    EXPR_MATCH,    // e.g., match xs { Nil => 0, Cons(x, _) => x }
     // Add more as needed: EXPR_ASSIGN, EXPR_LOGICAL, etc.
 } ExprType;
 
 // Base Expression structure (all expression nodes will start with this)
 typedef struct Expr {
     ExprType type;
+    struct Type* inferred_type; // Interned type set by type inference (NULL before, or for constructor callees)
 } Expr;
 
 // Literal Expression (e.g., 123, "hello", true, false, None)
@@ -43,6 +48,14 @@ typedef struct {
 typedef struct {
     Expr base;
     Token name; // The identifier token
+    // Binding annotated by the resolver. Later passes use these instead of
+    // looking the name up again. NULL / -1 while unresolved.
+    struct Symbol* symbol; // Symbol this use refers to (owned by the symbol table)
+    int depth;             // Depth of the scope that defines the binding (0 = global)
+    int slot;              // Dense slot index of the binding within that scope
+    // Set instead of `symbol` when the name is a nullary constructor such as `None`.
+    struct Symbol* constructor_adt; // ADT owning the variant (NULL if not a constructor)
+    int constructor_tag;            // Variant index within that ADT (-1 if not a constructor)
 } ExprVariable;
 
 // For ADT instantiation like `Some(value)` or `Color(255,0,0)`
@@ -53,8 +66,68 @@ typedef struct {
                                 // This might be an ExprVariable or ExprPath (e.g. MyModule::Type::Variant)
     DynamicArray* arguments;    // DynamicArray of Expr*
     Token closing_paren;        // For error reporting on mismatched parens
+    // Resolved constructor for ADT instantiation, filled in by the resolver.
+    struct Symbol* constructor_adt; // ADT owning the variant (NULL if unresolved)
+    int constructor_tag;            // Variant index within that ADT (-1 if unresolved)
 } ExprCall;
 
+// Borrow (e.g., `&x`, `&mut x`). Borrowing a binding is a loan the borrow
+// checker tracks; borrowing any other expression borrows a temporary.
+typedef struct {
+    Expr base;
+    Token ampersand;   // The '&' token, for error reporting
+    bool is_mutable;   // `&mut`
+    struct Expr* operand;
+} ExprBorrow;
+
+// Patterns (match arms)
+typedef enum {
+    PATTERN_WILDCARD,    // `_`
+    PATTERN_BINDING,     // `x`, or a nullary constructor such as `Nil` (see constructor_adt)
+    PATTERN_CONSTRUCTOR, // `Cons(x, _)`
+    PATTERN_LITERAL,     // `0`, `"s"`, `true`
+    PATTERN_OR,          // `Red | Green`
+} PatternKind;
+
+typedef struct Pattern {
+    PatternKind kind;
+    Token token;                // `_`, the bound name, the constructor name, the literal, or the first '|'
+    DynamicArray* subpatterns;  // Pattern*: constructor fields or or-alternatives (NULL otherwise)
+    // Filled in by the resolver, as for ExprVariable / ExprCall.
+    struct Symbol* symbol;          // PATTERN_BINDING: the variable it declares (NULL for a constructor)
+    struct Symbol* constructor_adt; // Constructor patterns and nullary constructor names
+    int constructor_tag;            // Variant index within that ADT (-1 if none)
+    struct Type* inferred_type;     // Set by type inference
+} Pattern;
+
+typedef struct {
+    Pattern* pattern;
+    struct Expr* body;
+} MatchArm;
+
+// Match (e.g., `match xs { Nil => 0, Cons(x, _) => x }`). Each arm is its own
+// scope for the variables its pattern binds. Exhaustiveness and unreachable
+// arms are checked after type inference (match_check.h).
+typedef struct {
+    Expr base;
+    Token keyword;          // The 'match' token, for error reporting
+    struct Expr* scrutinee;
+    DynamicArray* arms;     // DynamicArray of MatchArm*
+} ExprMatch;
+
+
+//------------------------------------------------------------------------------
+// Type Annotations
+//------------------------------------------------------------------------------
+
+// A written type: `i32`, `T`, `List<A>`, `&T`, `&mut Option<T>`.
+typedef struct TypeAnnotation {
+    Token name;                       // Type name; for references, the '&' token
+    DynamicArray* args;               // TypeAnnotation* for `List<A>` (NULL if none)
+    struct TypeAnnotation* referent;  // Referenced type for `&T` / `&mut T` (NULL otherwise)
+    bool is_mutable;                  // `&mut T`
+} TypeAnnotation;
+
 
 //------------------------------------------------------------------------------
 // Statement Node Types
@@ -64,6 +137,8 @@ typedef enum {
     STMT_LET,         // Variable declaration: let x = expr;
     STMT_EXPRESSION,  // Expression statement: expr; (e.g. a function call)
     STMT_DATA,        // ADT definition: data Option<T> { ... }
+    STMT_CLASS,       // Typeclass declaration: class Ord: Eq { compare }
+    STMT_INSTANCE,    // Typeclass instance: instance<T: Eq> Eq for List<T>;
     // Add more as needed: STMT_IF, STMT_WHILE, STMT_RETURN, STMT_BLOCK, etc.
 } StmtType;
 
@@ -78,7 +153,8 @@ typedef struct {
     Token name;          // Identifier token for the variable name
     bool is_mutable;
     struct Expr* initializer; // Optional initializer expression (can be NULL)
-    // TypeAnnotation* type_annot; // Optional type annotation (future)
+    TypeAnnotation* type_annot; // Optional `: type` annotation (NULL if absent)
+    struct Symbol* symbol;    // Symbol declared for this binding by the resolver (NULL if not declared)
 } StmtLet;
 
 
@@ -86,10 +162,8 @@ typedef struct {
 typedef struct {
     Token name; // Optional: field name (for struct-like variants, e.g. `Move { x: i32 }`)
                 // If NULL, it's a positional/tuple field.
-    // TypeAnnotation* type_annot; // The type of the field, e.g., T, String, i32
-    // For Phase 1, we might store the type as a Token (identifier) or a simple string.
-    Token type_name_token; // e.g., Token for "T", "String", "i32", "List<A>"
-                           // This will need to be resolved to an actual type later.
+    TypeAnnotation* type_annot; // The type of the field, e.g., T, String, i32, List<A>
+    Token type_name_token; // Head name of the type ("List" for List<A>), kept for diagnostics and indexing
 } ADTVariantField;
 
 // ADT Variant (e.g., Some(T), None, Cons(A, List<A>))
@@ -104,9 +178,33 @@ typedef struct {
     Stmt base;
     Token name;                 // Name of the ADT (e.g., Option, List)
     DynamicArray* type_params;  // Optional: DynamicArray of Token* (generic type parameters like T, A)
+    DynamicArray* param_bounds; // Parallel to type_params: DynamicArray* of Token* class names
+                                // (`Ord`, `Show` in `T: Ord + Show`), or NULL for an unbounded parameter
     DynamicArray* variants;     // DynamicArray of ADTVariant*
+    struct Symbol* symbol;      // ADT symbol declared by the resolver (NULL if not declared)
 } StmtData;
 
+// Class Statement (Typeclass Declaration)
+// `class Ord: Eq { compare, max }` declares the class Ord with superclass Eq and
+// two method names. Every instance of Ord must also be an instance of Eq.
+typedef struct {
+    Stmt base;
+    Token name;
+    Token superclass;           // Superclass name (length 0 if none)
+    DynamicArray* methods;      // DynamicArray of Token* (method names, may be empty)
+} StmtClass;
+
+// Instance Statement
+// `instance<T: Eq> Eq for List<T>;` makes List<X> an instance of Eq for every X
+// that is one. The head is a type constructor applied to distinct parameters.
+typedef struct {
+    Stmt base;
+    Token class_name;
+    DynamicArray* type_params;  // DynamicArray of Token* (may be empty)
+    DynamicArray* param_bounds; // Parallel to type_params, as in StmtData
+    TypeAnnotation* head;       // The type the instance is for
+} StmtInstance;
+
 
 // Program is a list of statements
 typedef struct {
@@ -122,13 +220,24 @@ typedef struct {
 Expr* ast_expr_literal_create(Token literal);
 Expr* ast_expr_variable_create(Token name);
 Expr* ast_expr_call_create(Expr* callee, DynamicArray* arguments, Token closing_paren);
+Expr* ast_expr_borrow_create(Token ampersand, bool is_mutable, Expr* operand);
+Expr* ast_expr_match_create(Token keyword, Expr* scrutinee, DynamicArray* arms);
+MatchArm* ast_match_arm_create(Pattern* pattern, Expr* body);
+Pattern* ast_pattern_create(PatternKind kind, Token token, DynamicArray* subpatterns);
 // More expression constructors...
 
 // Statements
-Stmt* ast_stmt_let_create(Token name, bool is_mutable, Expr* initializer);
-Stmt* ast_stmt_data_create(Token name, DynamicArray* type_params, DynamicArray* variants);
+Stmt* ast_stmt_let_create(Token name, bool is_mutable, TypeAnnotation* type_annot, Expr* initializer);
+Stmt* ast_stmt_data_create(Token name, DynamicArray* type_params, DynamicArray* param_bounds, DynamicArray* variants);
+Stmt* ast_stmt_class_create(Token name, Token superclass, DynamicArray* methods);
+Stmt* ast_stmt_instance_create(Token class_name, DynamicArray* type_params, DynamicArray* param_bounds, TypeAnnotation* head);
 ADTVariant* ast_adt_variant_create(Token name, DynamicArray* fields);
-ADTVariantField* ast_adt_variant_field_create(Token name, Token type_name_token);
+ADTVariantField* ast_adt_variant_field_create(Token name, TypeAnnotation* type_annot);
+
+// Type annotations
+TypeAnnotation* ast_type_annotation_create(Token name, DynamicArray* args);
+TypeAnnotation* ast_type_annotation_reference_create(Token ampersand, bool is_mutable, TypeAnnotation* referent);
+void ast_type_annotation_destroy(TypeAnnotation* annot);
 
 Program* ast_program_create(DynamicArray* statements);
 
@@ -136,6 +245,7 @@ Program* ast_program_create(DynamicArray* statements);
 // AST Node Destructor Functions (Prototypes) - Crucial for memory management
 //------------------------------------------------------------------------------
 void ast_expr_destroy(Expr* expr);
+void ast_pattern_destroy(Pattern* pattern);
 void ast_stmt_destroy(Stmt* stmt);
 void ast_program_destroy(Program* program);
 // Specific destructors for variants, fields etc. might be needed if they own complex data.
@@ -13,6 +13,29 @@ static void print_indent(FILE *stream, int indent_level) {
 // For now, Stmt contains Expr.
 // void ast_print_expr(Expr *expr, FILE *stream); // Already in header
 
+static void print_pattern(Pattern *pattern, FILE *stream) {
+    if (!pattern) {
+        fprintf(stream, "<null_pattern>");
+        return;
+    }
+    if (pattern->kind == PATTERN_OR) {
+        for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+            if (i > 0) fprintf(stream, " | ");
+            print_pattern((Pattern*)da_get(pattern->subpatterns, i), stream);
+        }
+        return;
+    }
+    fprintf(stream, "%.*s", (int)pattern->token.length, pattern->token.lexeme);
+    if (pattern->kind == PATTERN_CONSTRUCTOR) {
+        fprintf(stream, "(");
+        for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+            if (i > 0) fprintf(stream, ", ");
+            print_pattern((Pattern*)da_get(pattern->subpatterns, i), stream);
+        }
+        fprintf(stream, ")");
+    }
+}
+
 void ast_print_expr_internal(Expr *expr, FILE *stream, bool in_call) {
     (void)in_call; // Mark as unused for now to silence warning
     if (!expr) {
@@ -43,6 +66,27 @@ void ast_print_expr_internal(Expr *expr, FILE *stream, bool in_call) {
             fprintf(stream, ")");
             break;
         }
+        case EXPR_BORROW: {
+            ExprBorrow* borrow = (ExprBorrow*)expr;
+            fprintf(stream, borrow->is_mutable ? "&mut " : "&");
+            ast_print_expr_internal(borrow->operand, stream, false);
+            break;
+        }
+        case EXPR_MATCH: {
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            fprintf(stream, "match ");
+            ast_print_expr_internal(match_expr->scrutinee, stream, false);
+            fprintf(stream, " { ");
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                if (i > 0) fprintf(stream, ", ");
+                print_pattern(arm->pattern, stream);
+                fprintf(stream, " => ");
+                ast_print_expr_internal(arm->body, stream, false);
+            }
+            fprintf(stream, " }");
+            break;
+        }
         // Add other expression types here
         default:
             fprintf(stream, "<unknown_expr_type:%d>", expr->type);
@@ -50,6 +94,48 @@ void ast_print_expr_internal(Expr *expr, FILE *stream, bool in_call) {
     }
 }
 
+static void print_type_annotation(TypeAnnotation *annot, FILE *stream) {
+    if (!annot) {
+        fprintf(stream, "<null_type>");
+        return;
+    }
+    if (annot->referent) {
+        fprintf(stream, annot->is_mutable ? "&mut " : "&");
+        print_type_annotation(annot->referent, stream);
+        return;
+    }
+    fprintf(stream, "%.*s", (int)annot->name.length, annot->name.lexeme);
+    if (annot->args && da_count(annot->args) > 0) {
+        fprintf(stream, "<");
+        for (size_t i = 0; i < da_count(annot->args); ++i) {
+            print_type_annotation((TypeAnnotation*)da_get(annot->args, i), stream);
+            if (i < da_count(annot->args) - 1) {
+                fprintf(stream, ", ");
+            }
+        }
+        fprintf(stream, ">");
+    }
+}
+
+// Prints `<T, U: Ord + Show>`; nothing for an empty parameter list.
+static void print_type_params(DynamicArray *type_params, DynamicArray *param_bounds, FILE *stream) {
+    if (!type_params || da_count(type_params) == 0) return;
+    fprintf(stream, "<");
+    for (size_t i = 0; i < da_count(type_params); ++i) {
+        Token* param_token = (Token*)da_get(type_params, i);
+        fprintf(stream, "%.*s", (int)param_token->length, param_token->lexeme);
+        DynamicArray *bounds = (DynamicArray*)da_get(param_bounds, i);
+        for (size_t j = 0; j < da_count(bounds); ++j) {
+            Token* bound = (Token*)da_get(bounds, j);
+            fprintf(stream, "%s%.*s", j == 0 ? ": " : " + ", (int)bound->length, bound->lexeme);
+        }
+        if (i < da_count(type_params) - 1) {
+            fprintf(stream, ", ");
+        }
+    }
+    fprintf(stream, ">");
+}
+
 void ast_print_expr(Expr *expr, FILE *stream) {
     ast_print_expr_internal(expr, stream, false);
 }
@@ -70,6 +156,10 @@ void ast_print_stmt(Stmt *stmt, FILE *stream, int indent_level) {
             fprintf(stream, "LET %s %.*s",
                     let_stmt->is_mutable ? "MUT" : "",
                     (int)let_stmt->name.length, let_stmt->name.lexeme);
+            if (let_stmt->type_annot) {
+                fprintf(stream, ": ");
+                print_type_annotation(let_stmt->type_annot, stream);
+            }
             if (let_stmt->initializer) {
                 fprintf(stream, " = ");
                 ast_print_expr(let_stmt->initializer, stream);
@@ -80,17 +170,7 @@ void ast_print_stmt(Stmt *stmt, FILE *stream, int indent_level) {
         case STMT_DATA: {
             StmtData *data_stmt = (StmtData*)stmt;
             fprintf(stream, "DATA %.*s", (int)data_stmt->name.length, data_stmt->name.lexeme);
-            if (data_stmt->type_params && da_count(data_stmt->type_params) > 0) {
-                fprintf(stream, "<");
-                for (size_t i = 0; i < da_count(data_stmt->type_params); ++i) {
-                    Token* param_token = (Token*)da_get(data_stmt->type_params, i);
-                    fprintf(stream, "%.*s", (int)param_token->length, param_token->lexeme);
-                    if (i < da_count(data_stmt->type_params) - 1) {
-                        fprintf(stream, ", ");
-                    }
-                }
-                fprintf(stream, ">");
-            }
+            print_type_params(data_stmt->type_params, data_stmt->param_bounds, stream);
             fprintf(stream, " {\n");
             for (size_t i = 0; i < da_count(data_stmt->variants); ++i) {
                 ADTVariant *variant = (ADTVariant*)da_get(data_stmt->variants, i);
@@ -101,7 +181,7 @@ void ast_print_stmt(Stmt *stmt, FILE *stream, int indent_level) {
                     for (size_t j = 0; j < da_count(variant->fields); ++j) {
                         ADTVariantField *field = (ADTVariantField*)da_get(variant->fields, j);
                         // If field->name is present (struct-like variant), print it. Not for Phase 1.
-                        fprintf(stream, "%.*s", (int)field->type_name_token.length, field->type_name_token.lexeme);
+                        print_type_annotation(field->type_annot, stream);
                         if (j < da_count(variant->fields) - 1) {
                             fprintf(stream, ", ");
                         }
@@ -118,6 +198,29 @@ void ast_print_stmt(Stmt *stmt, FILE *stream, int indent_level) {
             fprintf(stream, "}\n");
             break;
         }
+        case STMT_CLASS: {
+            StmtClass *class_stmt = (StmtClass*)stmt;
+            fprintf(stream, "CLASS %.*s", (int)class_stmt->name.length, class_stmt->name.lexeme);
+            if (class_stmt->superclass.length > 0) {
+                fprintf(stream, ": %.*s", (int)class_stmt->superclass.length, class_stmt->superclass.lexeme);
+            }
+            fprintf(stream, " {");
+            for (size_t i = 0; i < da_count(class_stmt->methods); ++i) {
+                Token* method = (Token*)da_get(class_stmt->methods, i);
+                fprintf(stream, "%s%.*s", i == 0 ? " " : ", ", (int)method->length, method->lexeme);
+            }
+            fprintf(stream, " }\n");
+            break;
+        }
+        case STMT_INSTANCE: {
+            StmtInstance *instance_stmt = (StmtInstance*)stmt;
+            fprintf(stream, "INSTANCE");
+            print_type_params(instance_stmt->type_params, instance_stmt->param_bounds, stream);
+            fprintf(stream, " %.*s FOR ", (int)instance_stmt->class_name.length, instance_stmt->class_name.lexeme);
+            print_type_annotation(instance_stmt->head, stream);
+            fprintf(stream, ";\n");
+            break;
+        }
         case STMT_EXPRESSION: {
             // Assuming StmtExpression struct has an 'expression' field of type Expr*
             // StmtExpression* expr_stmt = (StmtExpression*)stmt;
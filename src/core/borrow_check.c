@@ -0,0 +1,1009 @@
+#include "borrow_check.h"
+#include "symbol_table.h"
+#include "type_caps.h"
+#include "../util/array.h"
+#include "../util/bitset.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// --- Control-Flow Graph ---
+
+typedef enum {
+    ACTION_READ,       // Copies a local's value
+    ACTION_MOVE,       // Moves a local's value out
+    ACTION_BORROW,     // `&x`: starts a shared loan on x
+    ACTION_BORROW_MUT, // `&mut x`: starts a mutable loan on x
+    ACTION_INIT,       // A `let` stores its initializer into the local
+    ACTION_BRANCH,     // Ends a block that branches (no local), so no such block is empty
+} ActionKind;
+
+typedef struct {
+    ActionKind kind;
+    int local;
+    int loan;    // BORROW / BORROW_MUT: the loan this action starts (-1 otherwise)
+    Token token; // The use, for diagnostics
+} Action;
+
+typedef struct {
+    size_t first_action; // Actions [first_action, first_action + action_count), in order
+    size_t action_count;
+} BasicBlock;
+
+typedef struct {
+    size_t from;
+    size_t to;
+} Edge;
+
+typedef struct {
+    int local;       // The borrowed local
+    bool is_mutable;
+    int holder;      // The local whose value holds the reference
+    size_t point;    // The borrow
+    size_t end;      // The end of the statement creating it (the holder's INIT)
+} Loan;
+
+// A use or borrow of `from` while computing `to`'s value: whatever references
+// `from` holds may now be held by `to` as well.
+typedef struct {
+    int from;
+    int to;
+    size_t point;
+    size_t end; // As for Loan
+} Flow;
+
+typedef struct {
+    Symbol* symbol;
+    bool is_mutable;
+} Local;
+
+typedef struct {
+    Local* locals;
+    size_t local_count;
+    int* local_of_slot; // Global slot -> local index, or -1
+    size_t slot_count;
+    Action* actions;
+    size_t action_count, action_capacity;
+    BasicBlock* blocks;
+    size_t block_count, block_capacity;
+    Edge* edges;
+    size_t edge_count, edge_capacity;
+    size_t* succ_start; // Per block: succs[succ_start[b], succ_start[b + 1]) are its successors
+    size_t* succs;
+    size_t* pred_start; // Per block: preds[pred_start[b], pred_start[b + 1]) are its predecessors
+    size_t* preds;
+    Loan* loans;
+    size_t loan_count, loan_capacity;
+    Flow* flows;
+    size_t flow_count, flow_capacity;
+    ADTInstanceCache* instances;
+    Diagnostics* diagnostics;
+    bool had_error;
+    bool out_of_memory;
+} Body;
+
+static void body_free(Body* body) {
+    free(body->locals);
+    free(body->local_of_slot);
+    free(body->actions);
+    free(body->blocks);
+    free(body->edges);
+    free(body->succ_start);
+    free(body->succs);
+    free(body->pred_start);
+    free(body->preds);
+    free(body->loans);
+    free(body->flows);
+}
+
+static void ownership_error(Body* body, Token token, const char* message) {
+    body->had_error = true;
+    diagnostics_report(body->diagnostics, DIAG_OWNERSHIP, token, message);
+}
+
+
+// --- Lowering ---
+
+// Opens a new block. Control only reaches it through the edges added to it.
+static size_t start_block(Body* body) {
+    if (!array_reserve((void**)&body->blocks, &body->block_capacity, body->block_count + 1, sizeof(BasicBlock))) {
+        body->out_of_memory = true;
+        return 0;
+    }
+    size_t index = body->block_count++;
+    body->blocks[index] = (BasicBlock){.first_action = body->action_count};
+    return index;
+}
+
+static void emit(Body* body, ActionKind kind, int local, int loan, Token token) {
+    if (!array_reserve((void**)&body->actions, &body->action_capacity, body->action_count + 1, sizeof(Action))) {
+        body->out_of_memory = true;
+        return;
+    }
+    body->actions[body->action_count++] = (Action){kind, local, loan, token};
+    body->blocks[body->block_count - 1].action_count++;
+}
+
+#define PENDING_EDGE SIZE_MAX // Target not created yet
+
+static void add_edge(Body* body, size_t from, size_t to) {
+    if (!array_reserve((void**)&body->edges, &body->edge_capacity, body->edge_count + 1, sizeof(Edge))) {
+        body->out_of_memory = true;
+        return;
+    }
+    body->edges[body->edge_count++] = (Edge){from, to};
+}
+
+static void add_flow(Body* body, int from, int to) {
+    if (to < 0) return;
+    if (!array_reserve((void**)&body->flows, &body->flow_capacity, body->flow_count + 1, sizeof(Flow))) {
+        body->out_of_memory = true;
+        return;
+    }
+    body->flows[body->flow_count++] = (Flow){from, to, body->action_count - 1, 0};
+}
+
+static int local_of(const Body* body, const ExprVariable* var) {
+    Symbol* symbol = var->symbol;
+    if (!symbol || symbol->kind != SYMBOL_VARIABLE || symbol->depth != 0) return -1;
+    if (symbol->slot < 0 || (size_t)symbol->slot >= body->slot_count) return -1;
+    return body->local_of_slot[symbol->slot];
+}
+
+static bool pattern_binds(const Pattern* pattern) {
+    if (!pattern) return false;
+    if (pattern->kind == PATTERN_BINDING && !pattern->constructor_adt) return true;
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        if (pattern_binds((Pattern*)da_get(pattern->subpatterns, i))) return true;
+    }
+    return false;
+}
+
+// Whether a match takes (part of) its scrutinee's value, rather than only inspecting it.
+static bool arms_bind(const ExprMatch* match_expr) {
+    for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+        if (pattern_binds(((MatchArm*)da_get(match_expr->arms, i))->pattern)) return true;
+    }
+    return false;
+}
+
+// Lowers `expr` in evaluation order. `holder` is the local the value ends up
+// in, which keeps any reference created here alive.
+static void lower_expr(Body* body, Expr* expr, int holder) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_VARIABLE: {
+            ExprVariable* var = (ExprVariable*)expr;
+            int local = local_of(body, var);
+            if (local < 0) break; // Constructors and declarations outside the body
+            Type* type = expr->inferred_type;
+            bool copy = !type || type_is_copy(body->instances, type);
+            emit(body, copy ? ACTION_READ : ACTION_MOVE, local, -1, var->name);
+            add_flow(body, local, holder);
+            break;
+        }
+        case EXPR_CALL: {
+            ExprCall* call = (ExprCall*)expr;
+            for (size_t i = 0; i < da_count(call->arguments); ++i) {
+                lower_expr(body, (Expr*)da_get(call->arguments, i), holder);
+            }
+            break;
+        }
+        case EXPR_BORROW: {
+            ExprBorrow* borrow = (ExprBorrow*)expr;
+            int local = borrow->operand && borrow->operand->type == EXPR_VARIABLE
+                            ? local_of(body, (ExprVariable*)borrow->operand) : -1;
+            if (local < 0) { // Borrows a temporary
+                lower_expr(body, borrow->operand, holder);
+                break;
+            }
+            if (!array_reserve((void**)&body->loans, &body->loan_capacity, body->loan_count + 1, sizeof(Loan))) {
+                body->out_of_memory = true;
+                break;
+            }
+            int loan = (int)body->loan_count++;
+            body->loans[loan] = (Loan){local, borrow->is_mutable, holder, body->action_count, 0};
+            emit(body, borrow->is_mutable ? ACTION_BORROW_MUT : ACTION_BORROW, local, loan,
+                 ((ExprVariable*)borrow->operand)->name);
+            add_flow(body, local, holder); // Reborrowing through a reference
+            break;
+        }
+        case EXPR_MATCH: {
+            // The scrutinee's block branches to one block per arm; every arm
+            // continues in a join block. Bindings are not locals (yet): what the
+            // scrutinee holds flows into the result directly.
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            Expr* scrutinee = match_expr->scrutinee;
+            int local = scrutinee && scrutinee->type == EXPR_VARIABLE ? local_of(body, (ExprVariable*)scrutinee) : -1;
+            if (local >= 0 && !arms_bind(match_expr)) {
+                emit(body, ACTION_READ, local, -1, ((ExprVariable*)scrutinee)->name); // Only inspected
+            } else {
+                lower_expr(body, scrutinee, holder);
+            }
+            emit(body, ACTION_BRANCH, -1, -1, match_expr->keyword);
+            size_t dispatch = body->block_count - 1;
+            size_t first_exit = body->edge_count;
+            for (size_t i = 0; i < da_count(match_expr->arms) && !body->out_of_memory; ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                add_edge(body, dispatch, start_block(body));
+                lower_expr(body, arm->body, holder);
+                emit(body, ACTION_BRANCH, -1, -1, match_expr->keyword);
+                add_edge(body, body->block_count - 1, PENDING_EDGE);
+            }
+            size_t join = start_block(body);
+            for (size_t e = first_exit; !body->out_of_memory && e < body->edge_count; ++e) {
+                if (body->edges[e].to == PENDING_EDGE) body->edges[e].to = join;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// The program's top-level `let`s form one straight-line body.
+static bool lower_program(Body* body, Program* program) {
+    DynamicArray* statements = program->statements;
+    size_t count = da_count(statements);
+    for (size_t i = 0; i < count; ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        Symbol* symbol = stmt->type == STMT_LET ? ((StmtLet*)stmt)->symbol : NULL;
+        if (symbol && symbol->depth == 0 && (size_t)symbol->slot >= body->slot_count) {
+            body->slot_count = (size_t)symbol->slot + 1;
+        }
+    }
+    body->locals = (Local*)malloc((count ? count : 1) * sizeof(Local));
+    body->local_of_slot = (int*)malloc((body->slot_count ? body->slot_count : 1) * sizeof(int));
+    if (!body->locals || !body->local_of_slot) return false;
+    for (size_t i = 0; i < body->slot_count; ++i) body->local_of_slot[i] = -1;
+    for (size_t i = 0; i < count; ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        Symbol* symbol = stmt->type == STMT_LET ? ((StmtLet*)stmt)->symbol : NULL;
+        if (!symbol || symbol->depth != 0) continue;
+        body->local_of_slot[symbol->slot] = (int)body->local_count;
+        body->locals[body->local_count++] = (Local){symbol, symbol->data.var_info.is_mutable};
+    }
+
+    start_block(body);
+    for (size_t i = 0; i < count && !body->out_of_memory; ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type != STMT_LET) continue;
+        StmtLet* let = (StmtLet*)stmt;
+        int local = let->symbol && let->symbol->depth == 0 ? body->local_of_slot[let->symbol->slot] : -1;
+        size_t first_loan = body->loan_count, first_flow = body->flow_count;
+        lower_expr(body, let->initializer, local);
+        if (local >= 0 && let->initializer) emit(body, ACTION_INIT, local, -1, let->name);
+        if (body->out_of_memory) break;
+        for (size_t l = first_loan; l < body->loan_count; ++l) body->loans[l].end = body->action_count - 1;
+        for (size_t f = first_flow; f < body->flow_count; ++f) body->flows[f].end = body->action_count - 1;
+    }
+    return !body->out_of_memory;
+}
+
+// Groups the edges by one end (counting sort): neighbors[start[b], start[b + 1])
+// are the other ends of b's edges.
+static bool group_edges(const Body* body, bool by_target, size_t** start_out, size_t** neighbors_out) {
+    size_t n = body->block_count;
+    size_t* start = (size_t*)calloc(n + 2, sizeof(size_t));
+    size_t* neighbors = (size_t*)malloc((body->edge_count ? body->edge_count : 1) * sizeof(size_t));
+    *start_out = start;
+    *neighbors_out = neighbors;
+    if (!start || !neighbors) return false;
+    for (size_t e = 0; e < body->edge_count; ++e) start[(by_target ? body->edges[e].to : body->edges[e].from) + 1]++;
+    for (size_t b = 0; b < n; ++b) start[b + 1] += start[b];
+    for (size_t e = 0; e < body->edge_count; ++e) {
+        const Edge* edge = &body->edges[e];
+        if (by_target) neighbors[start[edge->to]++] = edge->from;
+        else neighbors[start[edge->from]++] = edge->to;
+    }
+    for (size_t b = n; b > 0; --b) start[b] = start[b - 1];
+    start[0] = 0;
+    return true;
+}
+
+static bool build_edges(Body* body) {
+    return group_edges(body, false, &body->succ_start, &body->succs) &&
+           group_edges(body, true, &body->pred_start, &body->preds);
+}
+
+
+// --- Dataflow ---
+
+// Solves a forward "may" problem: in[entry block] = entry, in[b] = union of
+// out[p] over its predecessors, out[b] = gen[b] | (in[b] & ~kill[b]).
+static bool solve_forward(const Body* body, const uint64_t* entry, const BitMatrix* gen, const BitMatrix* kill,
+                          BitMatrix* in) {
+    size_t n = body->block_count;
+    size_t words = in->words_per_row;
+    BitMatrix out;
+    size_t* queue = (size_t*)malloc((n + 1) * sizeof(size_t));
+    bool* queued = (bool*)calloc(n ? n : 1, sizeof(bool));
+    if (!queue || !queued || !bit_matrix_init(&out, n, words * 64)) {
+        free(queue);
+        free(queued);
+        return false;
+    }
+    if (n > 0) bitset_copy(bit_matrix_row(in, 0), entry, words);
+    // Circular FIFO; each block is queued at most once at a time.
+    size_t head = 0, tail = 0, pending = 0;
+    for (size_t b = 0; b < n; ++b) {
+        queue[tail++] = b;
+        queued[b] = true;
+        pending++;
+    }
+    tail %= n + 1;
+    while (pending > 0) {
+        size_t b = queue[head];
+        head = (head + 1) % (n + 1);
+        pending--;
+        queued[b] = false;
+        uint64_t* out_b = bit_matrix_row(&out, b);
+        bitset_transfer(out_b, bit_matrix_row(in, b), bit_matrix_row(gen, b), bit_matrix_row(kill, b), words);
+        for (size_t s = body->succ_start[b]; s < body->succ_start[b + 1]; ++s) {
+            size_t succ = body->succs[s];
+            if (bitset_union(bit_matrix_row(in, succ), out_b, words) && !queued[succ]) {
+                queue[tail] = succ;
+                tail = (tail + 1) % (n + 1);
+                queued[succ] = true;
+                pending++;
+            }
+        }
+    }
+    bit_matrix_free(&out);
+    free(queue);
+    free(queued);
+    return true;
+}
+
+// Solves a backward "may" problem: out[b] = union of in[s] over its
+// successors, in[b] = gen[b] | (out[b] & ~kill[b]).
+static bool solve_backward(const Body* body, const BitMatrix* gen, const BitMatrix* kill, BitMatrix* in) {
+    size_t n = body->block_count;
+    size_t words = in->words_per_row;
+    uint64_t* out = (uint64_t*)malloc((words ? words : 1) * sizeof(uint64_t));
+    size_t* queue = (size_t*)malloc((n + 1) * sizeof(size_t));
+    bool* queued = (bool*)calloc(n ? n : 1, sizeof(bool));
+    if (!out || !queue || !queued) {
+        free(out);
+        free(queue);
+        free(queued);
+        return false;
+    }
+    // Circular FIFO seeded in reverse order, so straight-line code settles in one pass.
+    size_t head = 0, tail = 0, pending = 0;
+    for (size_t b = n; b-- > 0;) {
+        queue[tail++] = b;
+        queued[b] = true;
+        pending++;
+    }
+    tail %= n + 1;
+    while (pending > 0) {
+        size_t b = queue[head];
+        head = (head + 1) % (n + 1);
+        pending--;
+        queued[b] = false;
+        bitset_zero(out, words);
+        for (size_t s = body->succ_start[b]; s < body->succ_start[b + 1]; ++s) {
+            bitset_union(out, bit_matrix_row(in, body->succs[s]), words);
+        }
+        if (!bitset_transfer(bit_matrix_row(in, b), out, bit_matrix_row(gen, b), bit_matrix_row(kill, b), words)) {
+            continue;
+        }
+        for (size_t p = body->pred_start[b]; p < body->pred_start[b + 1]; ++p) {
+            size_t pred = body->preds[p];
+            if (queued[pred]) continue;
+            queue[tail] = pred;
+            tail = (tail + 1) % (n + 1);
+            queued[pred] = true;
+            pending++;
+        }
+    }
+    free(out);
+    free(queue);
+    free(queued);
+    return true;
+}
+
+// Bits of the maybe-uninit/moved problem: [0, n) uninitialized, [n, 2n) moved.
+static size_t uninit_bit(int local) {
+    return (size_t)local;
+}
+
+static size_t moved_bit(const Body* body, int local) {
+    return body->local_count + (size_t)local;
+}
+
+static void build_init_sets(const Body* body, BitMatrix* gen, BitMatrix* kill) {
+    for (size_t b = 0; b < body->block_count; ++b) {
+        uint64_t* g = bit_matrix_row(gen, b);
+        uint64_t* k = bit_matrix_row(kill, b);
+        const BasicBlock* block = &body->blocks[b];
+        for (size_t a = block->first_action; a < block->first_action + block->action_count; ++a) {
+            const Action* action = &body->actions[a];
+            if (action->kind == ACTION_MOVE) {
+                bitset_set(g, moved_bit(body, action->local));
+                bitset_clear(k, moved_bit(body, action->local));
+            } else if (action->kind == ACTION_INIT) {
+                bitset_clear(g, uninit_bit(action->local));
+                bitset_clear(g, moved_bit(body, action->local));
+                bitset_set(k, uninit_bit(action->local));
+                bitset_set(k, moved_bit(body, action->local));
+            }
+        }
+    }
+}
+
+
+// --- Regions ---
+//
+// Non-lexical lifetimes: a loan's region is the set of points (action indices)
+// at which the reference it created may still be used. Locals that may hold a
+// reference ("carriers") get a region too: the points where they are live. The
+// regions are the least solution of
+//
+//   loan      contains its borrow up to the end of its statement,
+//             and the region of its holder
+//   carrier x contains the points where x is live, each flow x -> h up to the
+//             end of its statement, and the region of h
+//
+// Liveness is a backward problem over dense bitsets of carriers; the outlives
+// constraints ("contains the region of") are solved with a worklist over the
+// constraint graph, so a region only propagates when it grew. A loan ends at
+// every point that leaves its region, i.e. right after the last use of any
+// reference derived from it.
+
+// A set of points stored as a window of bitset words, so a region near one end
+// of a long body doesn't cost the whole body's width.
+typedef struct {
+    uint64_t* words;
+    size_t first_word;
+    size_t word_count;
+} Region;
+
+typedef struct {
+    Region* regions;     // Loans first, then carriers
+    size_t region_count;
+    size_t point_words;  // Width of a full set of points
+    int* carrier_of;     // Per local: carrier index, or -1
+    size_t carrier_count;
+    size_t* kill_start;  // Per point: kill_loans[kill_start[p], kill_start[p + 1]) end there
+    size_t* kill_loans;
+} Regions;
+
+static void regions_free(Regions* regions) {
+    for (size_t r = 0; regions->regions && r < regions->region_count; ++r) free(regions->regions[r].words);
+    free(regions->regions);
+    free(regions->carrier_of);
+    free(regions->kill_start);
+    free(regions->kill_loans);
+}
+
+static Region* carrier_region(const Regions* regions, const Body* body, int local) {
+    return &regions->regions[body->loan_count + (size_t)regions->carrier_of[local]];
+}
+
+// Widens `region` to cover words [lo, hi], at least doubling it when it grows.
+static bool region_reserve(const Regions* regions, Region* region, size_t lo, size_t hi) {
+    size_t end = region->first_word + region->word_count;
+    if (region->word_count > 0) {
+        if (lo >= region->first_word && hi < end) return true;
+        if (region->first_word < lo) lo = region->first_word;
+        if (end - 1 > hi) hi = end - 1;
+        size_t wanted = 2 * region->word_count;
+        if (hi - lo + 1 < wanted) { // Grow toward the side being extended
+            size_t extra = wanted - (hi - lo + 1);
+            if (lo < region->first_word) lo = lo > extra ? lo - extra : 0;
+            else hi = hi + extra < regions->point_words ? hi + extra : regions->point_words - 1;
+        }
+    }
+    uint64_t* words = (uint64_t*)calloc(hi - lo + 1, sizeof(uint64_t));
+    if (!words) return false;
+    if (region->word_count) bitset_copy(words + (region->first_word - lo), region->words, region->word_count);
+    free(region->words);
+    region->words = words;
+    region->first_word = lo;
+    region->word_count = hi - lo + 1;
+    return true;
+}
+
+static bool region_contains(const Region* region, size_t point) {
+    size_t word = point / 64;
+    if (word < region->first_word || word >= region->first_word + region->word_count) return false;
+    return (region->words[word - region->first_word] >> (point % 64)) & 1;
+}
+
+static bool region_add_range(const Regions* regions, Region* region, size_t from, size_t to) {
+    if (!region_reserve(regions, region, from / 64, to / 64)) return false;
+    size_t base = region->first_word * 64;
+    bitset_set_range(region->words, from - base, to - base);
+    return true;
+}
+
+// dst |= src. Sets *changed if dst grew.
+static bool region_union(const Regions* regions, Region* dst, const Region* src, bool* changed) {
+    *changed = false;
+    if (src->word_count == 0) return true;
+    if (!region_reserve(regions, dst, src->first_word, src->first_word + src->word_count - 1)) return false;
+    *changed = bitset_union(dst->words + (src->first_word - dst->first_word), src->words, src->word_count);
+    return true;
+}
+
+// Carriers are the holders of loans and, transitively, the locals their
+// values flow into.
+static bool find_carriers(const Body* body, Regions* regions) {
+    size_t n = body->local_count;
+    int* carrier_of = (int*)malloc((n ? n : 1) * sizeof(int));
+    size_t* flow_start = (size_t*)calloc(n + 1, sizeof(size_t));
+    size_t* flows_from = (size_t*)malloc((body->flow_count ? body->flow_count : 1) * sizeof(size_t));
+    int* stack = (int*)malloc((n ? n : 1) * sizeof(int));
+    bool ok = carrier_of && flow_start && flows_from && stack;
+    if (ok) {
+        // Flows grouped by source (counting sort).
+        for (size_t f = 0; f < body->flow_count; ++f) flow_start[body->flows[f].from + 1]++;
+        for (size_t l = 0; l < n; ++l) flow_start[l + 1] += flow_start[l];
+        for (size_t f = 0; f < body->flow_count; ++f) {
+            flows_from[flow_start[body->flows[f].from]++] = f;
+        }
+        for (size_t l = n; l > 0; --l) flow_start[l] = flow_start[l - 1];
+        flow_start[0] = 0;
+
+        size_t top = 0;
+        for (size_t l = 0; l < n; ++l) carrier_of[l] = -1;
+        for (size_t l = 0; l < body->loan_count; ++l) {
+            int holder = body->loans[l].holder;
+            if (holder >= 0 && carrier_of[holder] < 0) {
+                carrier_of[holder] = 0;
+                stack[top++] = holder;
+            }
+        }
+        while (top > 0) {
+            int x = stack[--top];
+            for (size_t i = flow_start[x]; i < flow_start[x + 1]; ++i) {
+                int to = body->flows[flows_from[i]].to;
+                if (carrier_of[to] < 0) {
+                    carrier_of[to] = 0;
+                    stack[top++] = to;
+                }
+            }
+        }
+        for (size_t l = 0; l < n; ++l) {
+            if (carrier_of[l] >= 0) carrier_of[l] = (int)regions->carrier_count++;
+        }
+        regions->carrier_of = carrier_of;
+    } else {
+        free(carrier_of);
+    }
+    free(flow_start);
+    free(flows_from);
+    free(stack);
+    return ok;
+}
+
+typedef struct {
+    const Regions* regions;
+    const Body* body;
+    size_t* live_until; // Per live carrier: the last point of its current live range
+    size_t point;
+    bool ok;
+} LiveRanges;
+
+static void open_range(size_t carrier, void* ctx) {
+    LiveRanges* ranges = (LiveRanges*)ctx;
+    ranges->live_until[carrier] = ranges->point;
+}
+
+static void close_range(size_t carrier, void* ctx) {
+    LiveRanges* ranges = (LiveRanges*)ctx;
+    Region* region = &ranges->regions->regions[ranges->body->loan_count + carrier];
+    ranges->ok = ranges->ok && region_add_range(ranges->regions, region, ranges->point, ranges->live_until[carrier]);
+}
+
+// Adds to each carrier's region the points before which it is live. Each block
+// is walked backward once, adding whole live ranges as they close rather than
+// visiting every live carrier at every point.
+static bool add_liveness(const Body* body, Regions* regions) {
+    size_t n = body->block_count;
+    BitMatrix gen = {0}, kill = {0}, in = {0};
+    size_t words = bitset_words(regions->carrier_count);
+    uint64_t* live = (uint64_t*)malloc((words ? words : 1) * sizeof(uint64_t));
+    LiveRanges ranges = {regions, body, (size_t*)malloc((regions->carrier_count + 1) * sizeof(size_t)), 0, false};
+    bool ok = live && ranges.live_until && bit_matrix_init(&gen, n, regions->carrier_count) &&
+              bit_matrix_init(&kill, n, regions->carrier_count) && bit_matrix_init(&in, n, regions->carrier_count);
+    for (size_t b = 0; ok && b < n; ++b) {
+        const BasicBlock* block = &body->blocks[b];
+        uint64_t* g = bit_matrix_row(&gen, b);
+        uint64_t* k = bit_matrix_row(&kill, b);
+        for (size_t a = block->first_action + block->action_count; a-- > block->first_action;) {
+            int local = body->actions[a].local;
+            int carrier = local >= 0 ? regions->carrier_of[local] : -1;
+            if (carrier < 0) continue;
+            if (body->actions[a].kind == ACTION_INIT) {
+                bitset_clear(g, (size_t)carrier);
+                bitset_set(k, (size_t)carrier);
+            } else {
+                bitset_set(g, (size_t)carrier);
+            }
+        }
+    }
+    ranges.ok = ok && solve_backward(body, &gen, &kill, &in);
+
+    for (size_t b = 0; ranges.ok && b < n; ++b) {
+        const BasicBlock* block = &body->blocks[b];
+        if (block->action_count == 0) continue;
+        bitset_zero(live, words);
+        for (size_t s = body->succ_start[b]; s < body->succ_start[b + 1]; ++s) {
+            bitset_union(live, bit_matrix_row(&in, body->succs[s]), words);
+        }
+        ranges.point = block->first_action + block->action_count - 1;
+        bitset_for_each(live, words, open_range, &ranges);
+        for (size_t a = block->first_action + block->action_count; ranges.ok && a-- > block->first_action;) {
+            const Action* action = &body->actions[a];
+            int carrier = action->local >= 0 ? regions->carrier_of[action->local] : -1;
+            if (carrier < 0) continue;
+            bool was_live = bitset_test(live, (size_t)carrier);
+            ranges.point = a;
+            if (action->kind == ACTION_INIT) {
+                // Live from the next point on, not before this one.
+                if (was_live && a + 1 <= ranges.live_until[carrier]) {
+                    ranges.point = a + 1;
+                    close_range((size_t)carrier, &ranges);
+                }
+                bitset_clear(live, (size_t)carrier);
+            } else if (!was_live) {
+                open_range((size_t)carrier, &ranges);
+                bitset_set(live, (size_t)carrier);
+            }
+        }
+        ranges.point = block->first_action;
+        bitset_for_each(live, words, close_range, &ranges);
+    }
+    free(live);
+    free(ranges.live_until);
+    bit_matrix_free(&gen);
+    bit_matrix_free(&kill);
+    bit_matrix_free(&in);
+    return ranges.ok;
+}
+
+// Solves the outlives constraints: each edge sub -> sup means sup contains sub.
+static bool solve_outlives(const Body* body, Regions* regions) {
+    size_t n = regions->region_count;
+    size_t edge_count = 0;
+    for (size_t l = 0; l < body->loan_count; ++l) edge_count += body->loans[l].holder >= 0;
+    for (size_t f = 0; f < body->flow_count; ++f) edge_count += regions->carrier_of[body->flows[f].from] >= 0;
+
+    size_t* sub = (size_t*)malloc((edge_count ? edge_count : 1) * sizeof(size_t));
+    size_t* sup = (size_t*)malloc((edge_count ? edge_count : 1) * sizeof(size_t));
+    size_t* edge_start = (size_t*)calloc(n + 1, sizeof(size_t));
+    size_t* sups = (size_t*)malloc((edge_count ? edge_count : 1) * sizeof(size_t));
+    size_t* queue = (size_t*)malloc((n + 1) * sizeof(size_t));
+    bool* queued = (bool*)calloc(n ? n : 1, sizeof(bool));
+    bool ok = sub && sup && edge_start && sups && queue && queued;
+    if (ok) {
+        size_t e = 0;
+        for (size_t l = 0; l < body->loan_count; ++l) {
+            if (body->loans[l].holder < 0) continue;
+            sub[e] = body->loan_count + (size_t)regions->carrier_of[body->loans[l].holder];
+            sup[e++] = l;
+        }
+        for (size_t f = 0; f < body->flow_count; ++f) {
+            const Flow* flow = &body->flows[f];
+            if (regions->carrier_of[flow->from] < 0) continue;
+            sub[e] = body->loan_count + (size_t)regions->carrier_of[flow->to];
+            sup[e++] = body->loan_count + (size_t)regions->carrier_of[flow->from];
+        }
+        // Edges grouped by sub-region (counting sort).
+        for (e = 0; e < edge_count; ++e) edge_start[sub[e] + 1]++;
+        for (size_t r = 0; r < n; ++r) edge_start[r + 1] += edge_start[r];
+        for (e = 0; e < edge_count; ++e) sups[edge_start[sub[e]]++] = sup[e];
+        for (size_t r = n; r > 0; --r) edge_start[r] = edge_start[r - 1];
+        edge_start[0] = 0;
+
+        // Later carriers first: values mostly flow forward, into later bindings.
+        size_t head = 0, tail = 0, pending = 0;
+        for (size_t r = n; r-- > 0;) {
+            queue[tail++] = r;
+            queued[r] = true;
+            pending++;
+        }
+        tail %= n + 1;
+        while (ok && pending > 0) {
+            size_t r = queue[head];
+            head = (head + 1) % (n + 1);
+            pending--;
+            queued[r] = false;
+            for (size_t i = edge_start[r]; ok && i < edge_start[r + 1]; ++i) {
+                bool changed;
+                ok = region_union(regions, &regions->regions[sups[i]], &regions->regions[r], &changed);
+                if (!changed || queued[sups[i]]) continue;
+                queue[tail] = sups[i];
+                tail = (tail + 1) % (n + 1);
+                queued[sups[i]] = true;
+                pending++;
+            }
+        }
+    }
+    free(sub);
+    free(sup);
+    free(edge_start);
+    free(sups);
+    free(queue);
+    free(queued);
+    return ok;
+}
+
+typedef struct {
+    size_t point;
+    size_t loan;
+} Exit;
+
+static bool push_exit(Exit** exits, size_t* count, size_t* capacity, size_t point, size_t loan) {
+    if (!array_reserve((void**)exits, capacity, *count + 1, sizeof(Exit))) return false;
+    (*exits)[(*count)++] = (Exit){point, loan};
+    return true;
+}
+
+// Finds the points where each loan leaves its region: p with p - 1 in it and p
+// not, except at block entries, where the predecessors' last points count.
+static bool find_exits(const Body* body, Regions* regions) {
+    size_t points = body->action_count;
+    uint64_t* block_entries = (uint64_t*)calloc(regions->point_words + 1, sizeof(uint64_t));
+    Exit* exits = NULL;
+    size_t exit_count = 0, exit_capacity = 0;
+    bool ok = block_entries != NULL;
+    for (size_t b = 0; ok && b < body->block_count; ++b) {
+        if (body->blocks[b].action_count) bitset_set(block_entries, body->blocks[b].first_action);
+    }
+    for (size_t l = 0; ok && l < body->loan_count; ++l) {
+        const Region* region = &regions->regions[l];
+        for (size_t i = 0; ok && i <= region->word_count; ++i) {
+            size_t word = region->first_word + i;
+            uint64_t current = i < region->word_count ? region->words[i] : 0;
+            uint64_t carry = i > 0 ? region->words[i - 1] >> 63 : 0;
+            uint64_t leaving = ((current << 1) | carry) & ~current;
+            if (word < regions->point_words) leaving &= ~block_entries[word];
+            for (; ok && leaving; leaving &= leaving - 1) {
+                size_t point = word * 64 + (size_t)__builtin_ctzll(leaving);
+                if (point >= points) break;
+                ok = push_exit(&exits, &exit_count, &exit_capacity, point, l);
+            }
+        }
+        for (size_t b = 0; ok && b < body->block_count; ++b) {
+            const BasicBlock* block = &body->blocks[b];
+            if (block->action_count == 0 || region_contains(region, block->first_action)) continue;
+            bool live_before = false;
+            for (size_t p = body->pred_start[b]; p < body->pred_start[b + 1]; ++p) {
+                const BasicBlock* pred = &body->blocks[body->preds[p]];
+                if (pred->action_count && region_contains(region, pred->first_action + pred->action_count - 1)) {
+                    live_before = true;
+                }
+            }
+            if (live_before) ok = push_exit(&exits, &exit_count, &exit_capacity, block->first_action, l);
+        }
+    }
+    // Group by point (counting sort).
+    regions->kill_start = ok ? (size_t*)calloc(points + 2, sizeof(size_t)) : NULL;
+    regions->kill_loans = ok ? (size_t*)malloc((exit_count ? exit_count : 1) * sizeof(size_t)) : NULL;
+    ok = ok && regions->kill_start && regions->kill_loans;
+    if (ok) {
+        size_t* start = regions->kill_start;
+        for (size_t e = 0; e < exit_count; ++e) start[exits[e].point + 1]++;
+        for (size_t p = 0; p < points; ++p) start[p + 1] += start[p];
+        for (size_t e = 0; e < exit_count; ++e) regions->kill_loans[start[exits[e].point]++] = exits[e].loan;
+        for (size_t p = points; p > 0; --p) start[p] = start[p - 1];
+        start[0] = 0;
+    }
+    free(block_entries);
+    free(exits);
+    return ok;
+}
+
+static bool infer_regions(const Body* body, Regions* regions) {
+    regions->point_words = bitset_words(body->action_count);
+    if (!find_carriers(body, regions)) return false;
+    regions->region_count = body->loan_count + regions->carrier_count;
+    regions->regions = (Region*)calloc(regions->region_count + 1, sizeof(Region));
+    if (!regions->regions) return false;
+
+    for (size_t l = 0; l < body->loan_count; ++l) {
+        const Loan* loan = &body->loans[l];
+        if (!region_add_range(regions, &regions->regions[l], loan->point, loan->end)) return false;
+    }
+    for (size_t f = 0; f < body->flow_count; ++f) {
+        const Flow* flow = &body->flows[f];
+        if (regions->carrier_of[flow->from] < 0) continue;
+        if (!region_add_range(regions, carrier_region(regions, body, flow->from), flow->point, flow->end)) {
+            return false;
+        }
+    }
+    return add_liveness(body, regions) && solve_outlives(body, regions) && find_exits(body, regions);
+}
+
+// Loans start at their borrow and end where they leave their region. At each
+// point the loans ending there are killed before any loan starts.
+static void build_loan_sets(const Body* body, const Regions* regions, BitMatrix* gen, BitMatrix* kill) {
+    for (size_t b = 0; b < body->block_count; ++b) {
+        uint64_t* g = bit_matrix_row(gen, b);
+        uint64_t* k = bit_matrix_row(kill, b);
+        const BasicBlock* block = &body->blocks[b];
+        for (size_t a = block->first_action; a < block->first_action + block->action_count; ++a) {
+            for (size_t i = regions->kill_start[a]; i < regions->kill_start[a + 1]; ++i) {
+                bitset_clear(g, regions->kill_loans[i]);
+                bitset_set(k, regions->kill_loans[i]);
+            }
+            if (body->actions[a].loan >= 0) {
+                bitset_set(g, (size_t)body->actions[a].loan);
+                bitset_clear(k, (size_t)body->actions[a].loan);
+            }
+        }
+    }
+}
+
+
+// --- Checking ---
+
+typedef struct {
+    const Body* body;
+    size_t* shared; // Per local: shared loans in scope
+    size_t* mut;    // Per local: mutable loans in scope
+} LoanCounts;
+
+static void count_loan(size_t loan, void* ctx) {
+    LoanCounts* counts = (LoanCounts*)ctx;
+    const Loan* l = &counts->body->loans[loan];
+    if (l->is_mutable) counts->mut[l->local]++;
+    else counts->shared[l->local]++;
+}
+
+static void uncount_loan(LoanCounts* counts, size_t loan) {
+    const Loan* l = &counts->body->loans[loan];
+    if (l->is_mutable) counts->mut[l->local]--;
+    else counts->shared[l->local]--;
+}
+
+// Reports a use of a moved or uninitialized local.
+static bool check_initialized(Body* body, const uint64_t* init_state, const Action* action, bool borrow) {
+    if (bitset_test(init_state, moved_bit(body, action->local))) {
+        ownership_error(body, action->token, borrow ? "Borrow of moved value." : "Use of moved value.");
+        return false;
+    }
+    if (bitset_test(init_state, uninit_bit(action->local))) {
+        ownership_error(body, action->token, "Use of possibly uninitialized variable.");
+        return false;
+    }
+    return true;
+}
+
+static void check_action(Body* body, const Action* action, const uint64_t* init_state, const LoanCounts* counts) {
+    int x = action->local;
+    switch (action->kind) {
+        case ACTION_READ:
+            if (!check_initialized(body, init_state, action, false)) break;
+            if (counts->mut[x]) ownership_error(body, action->token, "Cannot use this variable while it is mutably borrowed.");
+            break;
+        case ACTION_MOVE:
+            if (!check_initialized(body, init_state, action, false)) break;
+            if (counts->mut[x] || counts->shared[x]) {
+                ownership_error(body, action->token, "Cannot move out of this variable while it is borrowed.");
+            }
+            break;
+        case ACTION_BORROW:
+            if (!check_initialized(body, init_state, action, true)) break;
+            if (counts->mut[x]) {
+                ownership_error(body, action->token, "Cannot borrow this variable as immutable because it is also borrowed as mutable.");
+            }
+            break;
+        case ACTION_BORROW_MUT:
+            if (!body->locals[x].is_mutable) {
+                ownership_error(body, action->token, "Cannot borrow an immutable variable as mutable; declare it with 'let mut'.");
+                break;
+            }
+            if (!check_initialized(body, init_state, action, true)) break;
+            if (counts->mut[x]) {
+                ownership_error(body, action->token, "Cannot borrow this variable as mutable more than once at a time.");
+            } else if (counts->shared[x]) {
+                ownership_error(body, action->token, "Cannot borrow this variable as mutable because it is also borrowed as immutable.");
+            }
+            break;
+        case ACTION_INIT:
+        case ACTION_BRANCH:
+            break;
+    }
+}
+
+// Replays each block from its entry state, checking every action before
+// applying it. Loans leaving their region at an action end before it.
+static bool check_blocks(Body* body, const Regions* regions, const BitMatrix* init_in, const BitMatrix* loans_in) {
+    size_t init_words = init_in->words_per_row;
+    size_t loan_words = loans_in->words_per_row;
+    uint64_t* init_state = (uint64_t*)malloc((init_words ? init_words : 1) * sizeof(uint64_t));
+    uint64_t* loan_state = (uint64_t*)malloc((loan_words ? loan_words : 1) * sizeof(uint64_t));
+    LoanCounts counts = {body, (size_t*)calloc(body->local_count + 1, sizeof(size_t)),
+                         (size_t*)calloc(body->local_count + 1, sizeof(size_t))};
+    bool ok = init_state && loan_state && counts.shared && counts.mut;
+    for (size_t b = 0; ok && b < body->block_count; ++b) {
+        bitset_copy(init_state, bit_matrix_row(init_in, b), init_words);
+        bitset_copy(loan_state, bit_matrix_row(loans_in, b), loan_words);
+        for (size_t l = 0; l < body->local_count; ++l) counts.shared[l] = counts.mut[l] = 0;
+        bitset_for_each(loan_state, loan_words, count_loan, &counts);
+
+        const BasicBlock* block = &body->blocks[b];
+        for (size_t a = block->first_action; a < block->first_action + block->action_count; ++a) {
+            const Action* action = &body->actions[a];
+            for (size_t i = regions->kill_start[a]; i < regions->kill_start[a + 1]; ++i) {
+                size_t loan = regions->kill_loans[i];
+                if (!bitset_test(loan_state, loan)) continue;
+                bitset_clear(loan_state, loan);
+                uncount_loan(&counts, loan);
+            }
+            check_action(body, action, init_state, &counts);
+            switch (action->kind) {
+                case ACTION_MOVE:
+                    bitset_set(init_state, moved_bit(body, action->local));
+                    break;
+                case ACTION_INIT:
+                    bitset_clear(init_state, uninit_bit(action->local));
+                    bitset_clear(init_state, moved_bit(body, action->local));
+                    break;
+                case ACTION_BORROW:
+                case ACTION_BORROW_MUT:
+                    bitset_set(loan_state, (size_t)action->loan);
+                    count_loan((size_t)action->loan, &counts);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    free(init_state);
+    free(loan_state);
+    free(counts.shared);
+    free(counts.mut);
+    return ok;
+}
+
+
+// --- Public API ---
+
+bool borrow_check_program(Program* program, ADTInstanceCache* instances, Diagnostics* diagnostics) {
+    if (!program) return false;
+    Body body = {0};
+    body.instances = instances;
+    body.diagnostics = diagnostics;
+
+    BitMatrix init_gen = {0}, init_kill = {0}, init_in = {0};
+    BitMatrix loan_gen = {0}, loan_kill = {0}, loan_in = {0};
+    Regions regions = {0};
+    bool ok = lower_program(&body, program) && build_edges(&body) && infer_regions(&body, &regions);
+    size_t blocks = body.block_count;
+    size_t init_bits = 2 * body.local_count;
+    ok = ok && bit_matrix_init(&init_gen, blocks, init_bits) && bit_matrix_init(&init_kill, blocks, init_bits) &&
+         bit_matrix_init(&init_in, blocks, init_bits) && bit_matrix_init(&loan_gen, blocks, body.loan_count) &&
+         bit_matrix_init(&loan_kill, blocks, body.loan_count) && bit_matrix_init(&loan_in, blocks, body.loan_count);
+    uint64_t* init_entry = ok ? (uint64_t*)calloc(init_in.words_per_row + 1, sizeof(uint64_t)) : NULL;
+    uint64_t* loan_entry = ok ? (uint64_t*)calloc(loan_in.words_per_row + 1, sizeof(uint64_t)) : NULL;
+    ok = ok && init_entry && loan_entry;
+    if (ok) {
+        bitset_fill(init_entry, body.local_count); // Every local starts uninitialized
+        build_init_sets(&body, &init_gen, &init_kill);
+        build_loan_sets(&body, &regions, &loan_gen, &loan_kill);
+        ok = solve_forward(&body, init_entry, &init_gen, &init_kill, &init_in) &&
+             solve_forward(&body, loan_entry, &loan_gen, &loan_kill, &loan_in) &&
+             check_blocks(&body, &regions, &init_in, &loan_in);
+    }
+    if (!ok) {
+        fprintf(stderr, "Borrow checker ran out of memory.\n");
+        body.had_error = true;
+    }
+    free(init_entry);
+    free(loan_entry);
+    bit_matrix_free(&init_gen);
+    bit_matrix_free(&init_kill);
+    bit_matrix_free(&init_in);
+    bit_matrix_free(&loan_gen);
+    bit_matrix_free(&loan_kill);
+    bit_matrix_free(&loan_in);
+    regions_free(&regions);
+    bool had_error = body.had_error;
+    body_free(&body);
+    return !had_error;
+}
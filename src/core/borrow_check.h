@@ -0,0 +1,51 @@
+#ifndef BORROW_CHECK_H
+#define BORROW_CHECK_H
+
+#include <stdbool.h>
+#include "ast.h"
+#include "adt_instance.h"
+#include "diagnostics.h"
+
+// Ownership and borrow checking of a typed program (docs/ownership_model.md).
+//
+// Each body is lowered to a control-flow graph of basic blocks whose actions
+// read, move, borrow and initialize locals, numbered densely in declaration
+// order; the actions are the body's points. Every `&x` / `&mut x` is a loan on x.
+//
+// Loans are non-lexical: each has a region, the points where a reference
+// derived from it may still be used, inferred from the liveness of the locals
+// holding it (a backward problem over dense bitsets) and outlives constraints
+// between holders (solved with a sparse worklist over the constraint graph).
+// A loan ends where control leaves its region, i.e. after its last use, not at
+// the end of its holder's scope.
+//
+// Two forward gen/kill problems over dense bitsets are then solved with a
+// worklist of blocks:
+//
+//   maybe-uninit/moved  per local: set at entry (no local is initialized yet),
+//                       set by a move, cleared by initialization
+//   loans in scope      per loan: started by its borrow, ended where it leaves
+//                       its region
+//
+// A second walk over each block then checks every action against the state
+// before it: a moved or uninitialized local can't be used or borrowed; a
+// borrowed local can't be moved; a mutably borrowed local can't be used or
+// borrowed again; a local can only be mutably borrowed once at a time, and only
+// if it is declared `let mut`. Whether a use moves or copies is decided by the
+// Copy capability of its inferred type (type_caps.h).
+//
+// Each problem needs a pass per block until the block states stop changing,
+// plus one checking walk, so a body costs O(actions + blocks x bitset words),
+// plus the size of the regions: each is stored as a window of bitset words
+// spanning its first to last point.
+//
+// For now the only body is the program itself: its top-level `let`s, in order.
+// A `match` branches from its scrutinee to a block per arm, which rejoin after
+// it; pattern bindings are not tracked as locals yet.
+
+// Checks `program`, which must have been analyzed without errors. Errors are
+// recorded in `diagnostics` (or printed to stderr if it is NULL). Returns true
+// if there were none.
+bool borrow_check_program(Program* program, ADTInstanceCache* instances, Diagnostics* diagnostics);
+
+#endif // BORROW_CHECK_H
@@ -0,0 +1,103 @@
+#include "constructor_index.h"
+#include "../util/hash.h"
+#include <stdlib.h>
+#include <string.h> // For memcmp
+
+#define CI_INITIAL_CAPACITY 64
+
+static bool names_equal(Token a, Token b) {
+    return a.length == b.length && memcmp(a.lexeme, b.lexeme, a.length) == 0;
+}
+
+// Returns the slot holding `name`, or the empty slot where it would go.
+static ConstructorEntry* find_slot(ConstructorEntry* entries, size_t capacity, Token name) {
+    size_t mask = capacity - 1;
+    size_t i = hash_bytes(name.lexeme, name.length) & mask;
+    while (entries[i].name.lexeme && !names_equal(entries[i].name, name)) {
+        i = (i + 1) & mask;
+    }
+    return &entries[i];
+}
+
+static bool grow(ConstructorIndex* index) {
+    size_t new_capacity = index->capacity * 2;
+    ConstructorEntry* new_entries = (ConstructorEntry*)calloc(new_capacity, sizeof(ConstructorEntry));
+    if (!new_entries) return false;
+    for (size_t i = 0; i < index->capacity; ++i) {
+        if (index->entries[i].name.lexeme) {
+            *find_slot(new_entries, new_capacity, index->entries[i].name) = index->entries[i];
+        }
+    }
+    free(index->entries);
+    index->entries = new_entries;
+    index->capacity = new_capacity;
+    return true;
+}
+
+ConstructorIndex* constructor_index_create(void) {
+    ConstructorIndex* index = (ConstructorIndex*)malloc(sizeof(ConstructorIndex));
+    if (!index) return NULL;
+    index->entries = (ConstructorEntry*)calloc(CI_INITIAL_CAPACITY, sizeof(ConstructorEntry));
+    if (!index->entries) {
+        free(index);
+        return NULL;
+    }
+    index->capacity = CI_INITIAL_CAPACITY;
+    index->count = 0;
+    return index;
+}
+
+void constructor_index_destroy(ConstructorIndex* index) {
+    if (!index) return;
+    free(index->entries);
+    free(index);
+}
+
+const ConstructorEntry* constructor_index_insert(ConstructorIndex* index, Token name,
+                                                 struct Symbol* adt_symbol, ADTVariantSymbol* variant,
+                                                 int tag, int arity, const ConstructorEntry** existing) {
+    if (!index || !name.lexeme) return NULL;
+    if ((index->count + 1) * 2 > index->capacity && !grow(index)) return NULL;
+
+    ConstructorEntry* slot = find_slot(index->entries, index->capacity, name);
+    if (slot->name.lexeme) {
+        if (existing) *existing = slot;
+        return NULL;
+    }
+    slot->name = name;
+    slot->adt_symbol = adt_symbol;
+    slot->variant = variant;
+    slot->tag = tag;
+    slot->arity = arity;
+    index->count++;
+    return slot;
+}
+
+bool constructor_index_remove(ConstructorIndex* index, Token name) {
+    if (!index || !name.lexeme) return false;
+    ConstructorEntry* hole = find_slot(index->entries, index->capacity, name);
+    if (!hole->name.lexeme) return false;
+    // Backward-shift deletion: move later entries of the probe run into the hole
+    // when their home slot does not lie between the hole and them.
+    size_t mask = index->capacity - 1;
+    size_t i = (size_t)(hole - index->entries);
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (!index->entries[j].name.lexeme) break;
+        size_t home = hash_bytes(index->entries[j].name.lexeme, index->entries[j].name.length) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            index->entries[i] = index->entries[j];
+            i = j;
+        }
+    }
+    memset(&index->entries[i], 0, sizeof(ConstructorEntry));
+    index->count--;
+    return true;
+}
+
+const ConstructorEntry* constructor_index_lookup(const ConstructorIndex* index, Token name) {
+    if (!index || !name.lexeme) return NULL;
+    const ConstructorEntry* slot = find_slot(index->entries, index->capacity, name);
+    return slot->name.lexeme ? slot : NULL;
+}
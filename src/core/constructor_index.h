@@ -0,0 +1,48 @@
+#ifndef CONSTRUCTOR_INDEX_H
+#define CONSTRUCTOR_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include "token.h"
+#include "types.h"  // For ADTVariantSymbol
+
+struct Symbol;
+
+// What a constructor name resolves to.
+typedef struct ConstructorEntry {
+    Token name;                  // Variant name token (from its `data` declaration)
+    struct Symbol* adt_symbol;   // SYMBOL_ADT that owns the variant (not owned)
+    ADTVariantSymbol* variant;   // The variant inside adt_symbol->data.adt_def (not owned; NULL if the
+                                 // ADT was only skimmed by lazy analysis, see semantic_analyzer.h)
+    int tag;                     // Index of the variant within its ADT
+    int arity;                   // Number of fields
+} ConstructorEntry;
+
+// Maps every variant name to its owning ADT, tag and arity, so resolving a
+// constructor at a use site (`Some(x)`, `Nil`) is a single hash probe instead of
+// a scan over every ADT's variants. Constructor names share one global namespace.
+// Open addressing with linear probing; grows at 50% load.
+typedef struct {
+    ConstructorEntry* entries; // Array of `capacity` entries; name.lexeme == NULL marks an empty slot
+    size_t capacity;           // Power of two
+    size_t count;
+} ConstructorIndex;
+
+ConstructorIndex* constructor_index_create(void);
+void constructor_index_destroy(ConstructorIndex* index);
+
+// Registers a constructor. Returns the new entry, or NULL if the name is already
+// registered; in that case *existing (if non-NULL) is set to the earlier entry.
+// Returned pointers are invalidated by later inserts.
+const ConstructorEntry* constructor_index_insert(ConstructorIndex* index, Token name,
+                                                 struct Symbol* adt_symbol, ADTVariantSymbol* variant,
+                                                 int tag, int arity, const ConstructorEntry** existing);
+
+// Removes the constructor with this name, if any. Returns whether one was removed.
+// Entries returned earlier are invalidated.
+bool constructor_index_remove(ConstructorIndex* index, Token name);
+
+// Looks up a constructor by name. Returns NULL if no variant has that name.
+const ConstructorEntry* constructor_index_lookup(const ConstructorIndex* index, Token name);
+
+#endif // CONSTRUCTOR_INDEX_H
@@ -0,0 +1,413 @@
+#include "diagnostics.h"
+#include "../util/hash.h"
+#include "../util/string_builder.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h> // For memcmp, memcpy, memchr, strlen
+
+typedef enum {
+    SPAN_SOURCE,   // `offset`/`length` locate the token in the source
+    SPAN_DETACHED, // The token is not in the source (e.g. an older revision's); its text is interned at `offset`
+    SPAN_EOF,      // End of input
+    SPAN_NONE,     // Not tied to a position
+} SpanKind;
+
+// One recorded error. Positions are resolved to lines and columns only when rendering.
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t message; // Arena offset of the NUL-terminated message
+    int line, col;    // Only for SPAN_DETACHED and SPAN_EOF
+    uint8_t kind;     // DiagnosticKind
+    uint8_t span;     // SpanKind
+} Record;
+
+// Open-addressed set of indices + 1 (0: empty slot); grows at half load.
+typedef struct {
+    uint32_t* slots;
+    size_t capacity; // Power of two
+    size_t count;
+} IndexSet;
+
+struct Diagnostics {
+    const char* source;
+    size_t source_length;
+    char* arena; // Interned messages and detached lexemes, NUL-terminated
+    size_t arena_length, arena_capacity;
+    IndexSet strings; // Arena offsets + 1 of interned strings
+    Record* records;
+    size_t record_count, record_capacity;
+    IndexSet seen; // Record indices + 1, for dropping duplicates
+    size_t limit;
+    size_t reported;   // Every report, duplicates and suppressed ones included
+    size_t suppressed; // Distinct errors past the limit
+};
+
+static const char* kind_label(DiagnosticKind kind) {
+    switch (kind) {
+        case DIAG_LEXICAL: return "Lexical Error";
+        case DIAG_SYNTAX: return "Syntax Error";
+        case DIAG_SEMANTIC: return "Semantic Error";
+        case DIAG_TYPE: return "Type Error";
+        case DIAG_OWNERSHIP: return "Ownership Error";
+        case DIAG_MATCH: return "Match Error";
+    }
+    return "Error";
+}
+
+// The unbuffered path, for a NULL sink or when recording runs out of memory.
+static void print_now(DiagnosticKind kind, const Token* at, const char* message) {
+    if (!at) {
+        fprintf(stderr, "%s: %s\n", kind_label(kind), message);
+    } else if (at->type == TOKEN_EOF) {
+        fprintf(stderr, "[L%d C%d at EOF] %s: %s\n", at->line, at->col, kind_label(kind), message);
+    } else {
+        fprintf(stderr, "[L%d C%d at '%.*s'] %s: %s\n", at->line, at->col, (int)at->length,
+                at->lexeme ? at->lexeme : "", kind_label(kind), message);
+    }
+}
+
+Diagnostics* diagnostics_create(const char* source) {
+    Diagnostics* diagnostics = (Diagnostics*)calloc(1, sizeof(Diagnostics));
+    if (!diagnostics) return NULL;
+    diagnostics->source = source;
+    diagnostics->source_length = source ? strlen(source) : 0;
+    diagnostics->limit = DIAGNOSTICS_DEFAULT_LIMIT;
+    return diagnostics;
+}
+
+void diagnostics_destroy(Diagnostics* diagnostics) {
+    if (!diagnostics) return;
+    free(diagnostics->arena);
+    free(diagnostics->strings.slots);
+    free(diagnostics->records);
+    free(diagnostics->seen.slots);
+    free(diagnostics);
+}
+
+void diagnostics_reset(Diagnostics* diagnostics, const char* source) {
+    if (!diagnostics) return;
+    diagnostics->source = source;
+    diagnostics->source_length = source ? strlen(source) : 0;
+    diagnostics->arena_length = 0;
+    diagnostics->record_count = 0;
+    diagnostics->reported = 0;
+    diagnostics->suppressed = 0;
+    if (diagnostics->strings.slots) memset(diagnostics->strings.slots, 0, diagnostics->strings.capacity * sizeof(uint32_t));
+    if (diagnostics->seen.slots) memset(diagnostics->seen.slots, 0, diagnostics->seen.capacity * sizeof(uint32_t));
+    diagnostics->strings.count = 0;
+    diagnostics->seen.count = 0;
+}
+
+const char* diagnostics_source(const Diagnostics* diagnostics) {
+    return diagnostics ? diagnostics->source : NULL;
+}
+
+void diagnostics_set_limit(Diagnostics* diagnostics, size_t limit) {
+    if (diagnostics) diagnostics->limit = limit;
+}
+
+size_t diagnostics_count(const Diagnostics* diagnostics) {
+    return diagnostics ? diagnostics->reported : 0;
+}
+
+// --- Interning ---
+
+static uint32_t hash_record(const Record* record) {
+    uint32_t hash = hash_combine(record->kind, record->span);
+    hash = hash_combine(hash, record->offset);
+    hash = hash_combine(hash, record->length);
+    hash = hash_combine(hash, record->message);
+    return hash_combine(hash, ((uint64_t)(uint32_t)record->line << 32) | (uint32_t)record->col);
+}
+
+static bool same_record(const Record* a, const Record* b) {
+    return a->kind == b->kind && a->span == b->span && a->offset == b->offset && a->length == b->length &&
+           a->message == b->message && a->line == b->line && a->col == b->col;
+}
+
+static uint32_t hash_entry(const Diagnostics* diagnostics, const IndexSet* set, uint32_t entry) {
+    if (set == &diagnostics->seen) return hash_record(&diagnostics->records[entry - 1]);
+    const char* text = diagnostics->arena + entry - 1;
+    return hash_bytes(text, strlen(text));
+}
+
+static bool grow_set(const Diagnostics* diagnostics, IndexSet* set) {
+    size_t capacity = set->capacity ? set->capacity * 2 : 64;
+    uint32_t* slots = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    if (!slots) return false;
+    for (size_t i = 0; i < set->capacity; ++i) {
+        uint32_t entry = set->slots[i];
+        if (!entry) continue;
+        size_t j = hash_entry(diagnostics, set, entry) & (capacity - 1);
+        while (slots[j]) j = (j + 1) & (capacity - 1);
+        slots[j] = entry;
+    }
+    free(set->slots);
+    set->slots = slots;
+    set->capacity = capacity;
+    return true;
+}
+
+// Returns the arena offset of `text`, copying it in on first use; UINT32_MAX if out of memory.
+static uint32_t intern(Diagnostics* diagnostics, const char* text, size_t length) {
+    IndexSet* set = &diagnostics->strings;
+    if ((set->count + 1) * 2 > set->capacity && !grow_set(diagnostics, set)) return UINT32_MAX;
+    size_t mask = set->capacity - 1;
+    size_t i = hash_bytes(text, length) & mask;
+    for (; set->slots[i]; i = (i + 1) & mask) {
+        const char* existing = diagnostics->arena + set->slots[i] - 1;
+        if (strncmp(existing, text, length) == 0 && existing[length] == '\0') return set->slots[i] - 1;
+    }
+    if (diagnostics->arena_length + length + 1 >= UINT32_MAX) return UINT32_MAX;
+    if (diagnostics->arena_length + length + 1 > diagnostics->arena_capacity) {
+        size_t capacity = diagnostics->arena_capacity ? diagnostics->arena_capacity : 1024;
+        while (capacity < diagnostics->arena_length + length + 1) capacity *= 2;
+        char* arena = (char*)realloc(diagnostics->arena, capacity);
+        if (!arena) return UINT32_MAX;
+        diagnostics->arena = arena;
+        diagnostics->arena_capacity = capacity;
+    }
+    uint32_t offset = (uint32_t)diagnostics->arena_length;
+    memcpy(diagnostics->arena + offset, text, length);
+    diagnostics->arena[offset + length] = '\0';
+    diagnostics->arena_length += length + 1;
+    set->slots[i] = offset + 1;
+    set->count++;
+    return offset;
+}
+
+// Adds `record` unless an identical one is recorded. Returns false if out of memory.
+static bool add_record(Diagnostics* diagnostics, const Record* record) {
+    IndexSet* set = &diagnostics->seen;
+    if ((set->count + 1) * 2 > set->capacity && !grow_set(diagnostics, set)) return false;
+    size_t mask = set->capacity - 1;
+    size_t i = hash_record(record) & mask;
+    for (; set->slots[i]; i = (i + 1) & mask) {
+        if (same_record(&diagnostics->records[set->slots[i] - 1], record)) return true;
+    }
+    if (diagnostics->limit && diagnostics->record_count >= diagnostics->limit) {
+        diagnostics->suppressed++;
+        return true;
+    }
+    if (diagnostics->record_count == diagnostics->record_capacity) {
+        size_t capacity = diagnostics->record_capacity ? diagnostics->record_capacity * 2 : 64;
+        Record* records = (Record*)realloc(diagnostics->records, capacity * sizeof(Record));
+        if (!records) return false;
+        diagnostics->records = records;
+        diagnostics->record_capacity = capacity;
+    }
+    diagnostics->records[diagnostics->record_count++] = *record;
+    set->slots[i] = (uint32_t)diagnostics->record_count;
+    set->count++;
+    return true;
+}
+
+static void report(Diagnostics* diagnostics, DiagnosticKind kind, const Token* at, const char* message) {
+    if (!diagnostics) {
+        print_now(kind, at, message);
+        return;
+    }
+    diagnostics->reported++;
+    Record record = {0};
+    record.kind = (uint8_t)kind;
+    record.message = intern(diagnostics, message, strlen(message));
+    bool ok = record.message != UINT32_MAX;
+    if (!at) {
+        record.span = SPAN_NONE;
+    } else if (at->type == TOKEN_EOF) {
+        record.span = SPAN_EOF;
+        record.line = at->line;
+        record.col = at->col;
+    } else {
+        uintptr_t start = (uintptr_t)diagnostics->source, lexeme = (uintptr_t)at->lexeme;
+        if (diagnostics->source && lexeme >= start && lexeme - start + at->length <= diagnostics->source_length &&
+            diagnostics->source_length < UINT32_MAX) {
+            record.span = SPAN_SOURCE;
+            record.offset = (uint32_t)(lexeme - start);
+            record.length = (uint32_t)at->length;
+        } else {
+            record.span = SPAN_DETACHED;
+            record.offset = intern(diagnostics, at->lexeme ? at->lexeme : "", at->lexeme ? at->length : 0);
+            record.length = (uint32_t)at->length;
+            record.line = at->line;
+            record.col = at->col;
+            ok = ok && record.offset != UINT32_MAX;
+        }
+    }
+    if (!ok || !add_record(diagnostics, &record)) print_now(kind, at, message);
+}
+
+void diagnostics_report(Diagnostics* diagnostics, DiagnosticKind kind, Token at, const char* message) {
+    report(diagnostics, kind, &at, message);
+}
+
+void diagnostics_report_general(Diagnostics* diagnostics, DiagnosticKind kind, const char* message) {
+    report(diagnostics, kind, NULL, message);
+}
+
+void diagnostics_append(Diagnostics* dst, const Diagnostics* src) {
+    if (!dst || !src) return;
+    for (size_t i = 0; i < src->record_count; ++i) {
+        const Record* record = &src->records[i];
+        const char* message = src->arena + record->message;
+        Token at = {0};
+        switch ((SpanKind)record->span) {
+            case SPAN_SOURCE:
+                at.lexeme = src->source + record->offset;
+                at.length = record->length;
+                at.type = TOKEN_ERROR; // Any type but EOF
+                break;
+            case SPAN_DETACHED:
+                at.lexeme = src->arena + record->offset;
+                at.length = record->length;
+                at.line = record->line;
+                at.col = record->col;
+                at.type = TOKEN_ERROR;
+                break;
+            case SPAN_EOF:
+                at.line = record->line;
+                at.col = record->col;
+                at.type = TOKEN_EOF;
+                break;
+            case SPAN_NONE:
+                report(dst, (DiagnosticKind)record->kind, NULL, message);
+                continue;
+        }
+        report(dst, (DiagnosticKind)record->kind, &at, message);
+    }
+    // Keep the counts of the duplicates and suppressed errors that `src` did not record.
+    dst->reported += src->reported - src->record_count;
+    dst->suppressed += src->suppressed;
+}
+
+// --- Rendering ---
+
+// Index of the line containing `offset`, given the sorted line start offsets.
+static size_t find_line(const size_t* starts, size_t count, size_t offset) {
+    size_t lo = 0, hi = count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (starts[mid] <= offset) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// The source line holding the span, then a caret line under it.
+static void render_snippet(StringBuilder* out, const char* source, size_t line_start, size_t line_end,
+                           size_t offset, size_t length) {
+    sb_append_str(out, "    ");
+    sb_append_buf(out, source + line_start, line_end - line_start);
+    sb_append_str(out, "\n    ");
+    for (size_t i = line_start; i < offset; ++i) sb_append_char(out, source[i] == '\t' ? '\t' : ' ');
+    sb_append_char(out, '^');
+    for (size_t i = offset + 1; i < offset + length && i < line_end; ++i) sb_append_char(out, '~');
+    sb_append_char(out, '\n');
+}
+
+// Where a record sorts in the output: its line and column, then the order it
+// was reported in, which keeps the sort stable.
+typedef struct {
+    size_t line, col;
+    size_t index;
+} RenderKey;
+
+static int compare_keys(const void* pa, const void* pb) {
+    const RenderKey* a = (const RenderKey*)pa;
+    const RenderKey* b = (const RenderKey*)pb;
+    if (a->line != b->line) return a->line < b->line ? -1 : 1;
+    if (a->col != b->col) return a->col < b->col ? -1 : 1;
+    return (a->index > b->index) - (a->index < b->index);
+}
+
+bool diagnostics_render(const Diagnostics* diagnostics, FILE* out) {
+    if (!diagnostics || (diagnostics->record_count == 0 && diagnostics->suppressed == 0)) return true;
+
+    // Line start offsets, only if some error points into the source.
+    size_t* starts = NULL;
+    size_t line_count = 0;
+    for (size_t i = 0; i < diagnostics->record_count; ++i) {
+        if (diagnostics->records[i].span != SPAN_SOURCE) continue;
+        size_t capacity = 256;
+        starts = (size_t*)malloc(capacity * sizeof(size_t));
+        if (!starts) return false;
+        starts[line_count++] = 0;
+        const char* p = diagnostics->source;
+        const char* end = diagnostics->source + diagnostics->source_length;
+        while ((p = (const char*)memchr(p, '\n', (size_t)(end - p))) != NULL) {
+            if (line_count == capacity) {
+                capacity *= 2;
+                size_t* grown = (size_t*)realloc(starts, capacity * sizeof(size_t));
+                if (!grown) {
+                    free(starts);
+                    return false;
+                }
+                starts = grown;
+            }
+            starts[line_count++] = (size_t)(++p - diagnostics->source);
+        }
+        break;
+    }
+
+    // Phases report in their own order (declarations before `let`s, borrows
+    // last); the output follows the source. Errors without a position go first.
+    RenderKey* keys = (RenderKey*)malloc((diagnostics->record_count + 1) * sizeof(RenderKey));
+    StringBuilder* text = keys ? sb_create(diagnostics->record_count * 96 + 64) : NULL;
+    if (!text) {
+        free(keys);
+        free(starts);
+        return false;
+    }
+    for (size_t i = 0; i < diagnostics->record_count; ++i) {
+        const Record* record = &diagnostics->records[i];
+        RenderKey key = {0, 0, i};
+        if (record->span == SPAN_SOURCE) {
+            size_t line = find_line(starts, line_count, record->offset);
+            key.line = line + 1;
+            key.col = record->offset - starts[line] + 1;
+        } else if (record->span != SPAN_NONE) {
+            key.line = record->line > 0 ? (size_t)record->line : 0;
+            key.col = record->col > 0 ? (size_t)record->col : 0;
+        }
+        keys[i] = key;
+    }
+    qsort(keys, diagnostics->record_count, sizeof(RenderKey), compare_keys);
+    for (size_t k = 0; k < diagnostics->record_count; ++k) {
+        const Record* record = &diagnostics->records[keys[k].index];
+        const char* label = kind_label((DiagnosticKind)record->kind);
+        const char* message = diagnostics->arena + record->message;
+        switch ((SpanKind)record->span) {
+            case SPAN_SOURCE: {
+                size_t line = find_line(starts, line_count, record->offset);
+                size_t line_end = line + 1 < line_count ? starts[line + 1] - 1 : diagnostics->source_length;
+                if (line_end > starts[line] && diagnostics->source[line_end - 1] == '\r') line_end--;
+                // A span running past its line (an unterminated string) is quoted up to the line's end.
+                size_t shown = record->offset + record->length > line_end ? line_end - record->offset : record->length;
+                sb_appendf(text, "[L%zu C%zu at '%.*s'] %s: %s\n", line + 1, record->offset - starts[line] + 1,
+                           (int)shown, diagnostics->source + record->offset, label, message);
+                render_snippet(text, diagnostics->source, starts[line], line_end, record->offset, record->length);
+                break;
+            }
+            case SPAN_DETACHED:
+                sb_appendf(text, "[L%d C%d at '%s'] %s: %s\n", record->line, record->col,
+                           diagnostics->arena + record->offset, label, message);
+                break;
+            case SPAN_EOF:
+                sb_appendf(text, "[L%d C%d at EOF] %s: %s\n", record->line, record->col, label, message);
+                break;
+            case SPAN_NONE:
+                sb_appendf(text, "%s: %s\n", label, message);
+                break;
+        }
+    }
+    if (diagnostics->suppressed) {
+        sb_appendf(text, "... %zu more error%s not shown (limit %zu).\n", diagnostics->suppressed,
+                   diagnostics->suppressed == 1 ? "" : "s", diagnostics->limit);
+    }
+    fwrite(sb_get_str(text), 1, sb_get_length(text), out);
+    sb_destroy(text);
+    free(keys);
+    free(starts);
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include <stdio.h>  // For FILE
+#include "token.h"
+
+// Error reporting for every phase, from the lexer to the borrow checker.
+//
+// Reporting an error only records it: its kind, the byte span of the token it
+// is about and its message, interned into a string arena so repeated messages
+// are stored once. Nothing is formatted or written until the driver renders the
+// whole batch at the end, computing lines and columns from a table of line
+// start offsets (built once, searched by bisection) and printing each error
+// with the source line it points into, in source order, in one write.
+//
+// Identical errors (same kind, span and message) are kept once, and at most
+// `limit` distinct errors are kept; the rest are only counted and summarized.
+// A pathological input with hundreds of thousands of errors then costs a hash
+// probe per error rather than a formatted write to stderr.
+//
+// Phases take a Diagnostics* that may be NULL, in which case each error is
+// written to stderr as soon as it is reported.
+
+typedef enum {
+    DIAG_LEXICAL,
+    DIAG_SYNTAX,
+    DIAG_SEMANTIC,
+    DIAG_TYPE,
+    DIAG_OWNERSHIP,
+    DIAG_MATCH,
+} DiagnosticKind;
+
+#define DIAGNOSTICS_DEFAULT_LIMIT 1000
+
+typedef struct Diagnostics Diagnostics;
+
+// Creates an empty sink for errors in `source` (the text tokens point into; not
+// owned, must outlive the sink's records). Returns NULL on allocation failure.
+Diagnostics* diagnostics_create(const char* source);
+void diagnostics_destroy(Diagnostics* diagnostics);
+
+// Drops every record and switches to a new source text.
+void diagnostics_reset(Diagnostics* diagnostics, const char* source);
+const char* diagnostics_source(const Diagnostics* diagnostics);
+
+// Keeps at most `limit` distinct errors (0: no limit).
+void diagnostics_set_limit(Diagnostics* diagnostics, size_t limit);
+
+// Records an error about `at`. The message is copied.
+void diagnostics_report(Diagnostics* diagnostics, DiagnosticKind kind, Token at, const char* message);
+
+// Records an error not tied to a position in the source.
+void diagnostics_report_general(Diagnostics* diagnostics, DiagnosticKind kind, const char* message);
+
+// Errors reported so far, including duplicates and those past the limit.
+// Phases compare counts to tell whether a step reported anything.
+size_t diagnostics_count(const Diagnostics* diagnostics);
+
+// Reports every error recorded in `src` to `dst`, in order (src is unchanged).
+void diagnostics_append(Diagnostics* dst, const Diagnostics* src);
+
+// Writes the recorded errors in source order: by line and column, errors not
+// tied to a position first, and errors at one position in the order they were
+// reported. Returns false on allocation failure.
+bool diagnostics_render(const Diagnostics* diagnostics, FILE* out);
+
+#endif // DIAGNOSTICS_H
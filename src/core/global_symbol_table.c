@@ -0,0 +1,304 @@
+#include "global_symbol_table.h"
+#include "symbol_table.h" // For Symbol, symbol_destroy
+#include "../util/hash.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h> // For memcmp
+
+// Number of shards (power of two). The top bits of the name hash pick the shard,
+// the low bits pick the bucket inside it, so both stay well distributed.
+#define GST_SHARD_BITS 6
+#define GST_SHARD_COUNT (1u << GST_SHARD_BITS)
+#define GST_INITIAL_BUCKETS 16
+#define GST_MAX_LOAD 2 // Average chain length that triggers a resize
+
+// One definition. Entries never move; the symbol pointer can be swapped when a
+// definition with a lower order key arrives for the same name.
+typedef struct {
+    uint32_t hash;
+    _Atomic(Symbol*) symbol;
+    uint64_t order;
+} GlobalEntry;
+
+// Chain link. Immutable once published, which is what makes lookups lock-free.
+typedef struct GlobalLink {
+    GlobalEntry* entry;
+    struct GlobalLink* next;
+} GlobalLink;
+
+typedef struct {
+    size_t mask; // bucket count - 1
+    _Atomic(GlobalLink*) heads[];
+} GlobalBucketArray;
+
+typedef struct {
+    pthread_mutex_t lock;              // Serializes inserts into this shard
+    _Atomic(GlobalBucketArray*) buckets;
+    size_t count;                      // Number of entries (guarded by lock)
+    DynamicArray* entries;             // GlobalEntry*, owned
+    DynamicArray* links;               // GlobalLink*, owned (including links of old arrays)
+    DynamicArray* retired;             // GlobalBucketArray* replaced by a resize, freed on destroy
+    DynamicArray* conflicts;           // GlobalConflict*
+} GlobalShard;
+
+struct GlobalSymbolTable {
+    GlobalShard shards[GST_SHARD_COUNT];
+    DynamicArray* slots; // Symbol* by dense slot, built by global_symbol_table_assign_slots
+    int first_slot;      // Slot of slots[0]
+};
+
+
+// --- Helpers ---
+
+static GlobalBucketArray* bucket_array_create(size_t bucket_count) {
+    GlobalBucketArray* arr = (GlobalBucketArray*)malloc(sizeof(GlobalBucketArray) +
+                                                        bucket_count * sizeof(_Atomic(GlobalLink*)));
+    if (!arr) return NULL;
+    arr->mask = bucket_count - 1;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        atomic_init(&arr->heads[i], NULL);
+    }
+    return arr;
+}
+
+static bool names_equal(Token a, Token b) {
+    return a.length == b.length && memcmp(a.lexeme, b.lexeme, a.length) == 0;
+}
+
+static GlobalShard* shard_for(const GlobalSymbolTable* table, uint32_t hash) {
+    return (GlobalShard*)&table->shards[hash >> (32 - GST_SHARD_BITS)];
+}
+
+// Rebuilds the shard's chains into a bucket array twice as large. Old links stay
+// valid (readers may still be walking them) and are freed with the table.
+// Caller holds the shard lock.
+static void shard_grow(GlobalShard* shard) {
+    GlobalBucketArray* old_arr = atomic_load_explicit(&shard->buckets, memory_order_relaxed);
+    GlobalBucketArray* new_arr = bucket_array_create((old_arr->mask + 1) * 2);
+    if (!new_arr) return; // Keep the old array; chains just get longer
+
+    for (size_t i = 0; i < da_count(shard->entries); ++i) {
+        GlobalEntry* entry = (GlobalEntry*)da_get(shard->entries, i);
+        GlobalLink* link = (GlobalLink*)malloc(sizeof(GlobalLink));
+        if (!link) continue;
+        size_t b = entry->hash & new_arr->mask;
+        link->entry = entry;
+        link->next = atomic_load_explicit(&new_arr->heads[b], memory_order_relaxed);
+        atomic_store_explicit(&new_arr->heads[b], link, memory_order_relaxed);
+        da_push(shard->links, link);
+    }
+    // Publish the fully built array.
+    atomic_store_explicit(&shard->buckets, new_arr, memory_order_release);
+    da_push(shard->retired, old_arr);
+}
+
+static void record_conflict(GlobalShard* shard, Symbol* duplicate, uint64_t order) {
+    GlobalConflict* conflict = (GlobalConflict*)malloc(sizeof(GlobalConflict));
+    if (!conflict) return;
+    conflict->duplicate = duplicate;
+    conflict->original = NULL;
+    conflict->order = order;
+    da_push(shard->conflicts, conflict);
+}
+
+
+// --- Public API ---
+
+GlobalSymbolTable* global_symbol_table_create(void) {
+    GlobalSymbolTable* table = (GlobalSymbolTable*)calloc(1, sizeof(GlobalSymbolTable));
+    if (!table) return NULL;
+    for (size_t i = 0; i < GST_SHARD_COUNT; ++i) {
+        GlobalShard* shard = &table->shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        atomic_init(&shard->buckets, bucket_array_create(GST_INITIAL_BUCKETS));
+        shard->entries = da_create(8, sizeof(GlobalEntry*));
+        shard->links = da_create(8, sizeof(GlobalLink*));
+        shard->retired = da_create(0, sizeof(GlobalBucketArray*));
+        shard->conflicts = da_create(0, sizeof(GlobalConflict*));
+        if (!atomic_load(&shard->buckets) || !shard->entries || !shard->links ||
+            !shard->retired || !shard->conflicts) {
+            global_symbol_table_destroy(table);
+            return NULL;
+        }
+    }
+    table->slots = NULL;
+    table->first_slot = 0;
+    return table;
+}
+
+void global_symbol_table_destroy(GlobalSymbolTable* table) {
+    if (!table) return;
+    for (size_t i = 0; i < GST_SHARD_COUNT; ++i) {
+        GlobalShard* shard = &table->shards[i];
+        for (size_t j = 0; j < da_count(shard->entries); ++j) {
+            GlobalEntry* entry = (GlobalEntry*)da_get(shard->entries, j);
+            symbol_destroy(atomic_load_explicit(&entry->symbol, memory_order_relaxed));
+            free(entry);
+        }
+        for (size_t j = 0; j < da_count(shard->links); ++j) {
+            free(da_get(shard->links, j));
+        }
+        for (size_t j = 0; j < da_count(shard->retired); ++j) {
+            free(da_get(shard->retired, j));
+        }
+        for (size_t j = 0; j < da_count(shard->conflicts); ++j) {
+            GlobalConflict* conflict = (GlobalConflict*)da_get(shard->conflicts, j);
+            symbol_destroy(conflict->duplicate);
+            free(conflict);
+        }
+        da_destroy(shard->entries);
+        da_destroy(shard->links);
+        da_destroy(shard->retired);
+        da_destroy(shard->conflicts);
+        free(atomic_load_explicit(&shard->buckets, memory_order_relaxed));
+        pthread_mutex_destroy(&shard->lock);
+    }
+    da_destroy(table->slots);
+    free(table);
+}
+
+bool global_symbol_table_define(GlobalSymbolTable* table, Symbol* symbol, uint64_t order) {
+    if (!table || !symbol) return false;
+    uint32_t hash = hash_bytes(symbol->name_token.lexeme, symbol->name_token.length);
+    GlobalShard* shard = shard_for(table, hash);
+
+    pthread_mutex_lock(&shard->lock);
+    GlobalBucketArray* arr = atomic_load_explicit(&shard->buckets, memory_order_relaxed);
+    size_t b = hash & arr->mask;
+
+    for (GlobalLink* link = atomic_load_explicit(&arr->heads[b], memory_order_relaxed); link; link = link->next) {
+        GlobalEntry* entry = link->entry;
+        Symbol* existing = atomic_load_explicit(&entry->symbol, memory_order_relaxed);
+        if (entry->hash != hash || !names_equal(existing->name_token, symbol->name_token)) continue;
+
+        bool wins = order < entry->order;
+        if (wins) {
+            // An earlier definition arrived late: it takes over the entry and the
+            // previous holder becomes the duplicate.
+            record_conflict(shard, existing, entry->order);
+            entry->order = order;
+            atomic_store_explicit(&entry->symbol, symbol, memory_order_release);
+        } else {
+            record_conflict(shard, symbol, order);
+        }
+        pthread_mutex_unlock(&shard->lock);
+        return wins;
+    }
+
+    GlobalEntry* entry = (GlobalEntry*)malloc(sizeof(GlobalEntry));
+    GlobalLink* link = (GlobalLink*)malloc(sizeof(GlobalLink));
+    if (!entry || !link) {
+        free(entry);
+        free(link);
+        record_conflict(shard, symbol, order); // Keeps ownership rules simple: the table frees it
+        pthread_mutex_unlock(&shard->lock);
+        return false;
+    }
+    entry->hash = hash;
+    entry->order = order;
+    atomic_init(&entry->symbol, symbol);
+    link->entry = entry;
+    link->next = atomic_load_explicit(&arr->heads[b], memory_order_relaxed);
+    da_push(shard->entries, entry);
+    da_push(shard->links, link);
+    // Publish: readers that see the new head also see the initialized link and entry.
+    atomic_store_explicit(&arr->heads[b], link, memory_order_release);
+
+    if (++shard->count > (arr->mask + 1) * GST_MAX_LOAD) {
+        shard_grow(shard);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return true;
+}
+
+Symbol* global_symbol_table_lookup(const GlobalSymbolTable* table, Token name_token) {
+    if (!table) return NULL;
+    uint32_t hash = hash_bytes(name_token.lexeme, name_token.length);
+    GlobalShard* shard = shard_for(table, hash);
+    GlobalBucketArray* arr = atomic_load_explicit(&shard->buckets, memory_order_acquire);
+
+    for (GlobalLink* link = atomic_load_explicit(&arr->heads[hash & arr->mask], memory_order_acquire);
+         link; link = link->next) {
+        if (link->entry->hash != hash) continue;
+        Symbol* symbol = atomic_load_explicit(&link->entry->symbol, memory_order_acquire);
+        if (names_equal(symbol->name_token, name_token)) return symbol;
+    }
+    return NULL;
+}
+
+static int compare_entries_by_order(const void* a, const void* b) {
+    const GlobalEntry* ea = *(GlobalEntry* const*)a;
+    const GlobalEntry* eb = *(GlobalEntry* const*)b;
+    return (ea->order > eb->order) - (ea->order < eb->order);
+}
+
+bool global_symbol_table_assign_slots(GlobalSymbolTable* table, int first_slot) {
+    if (!table) return false;
+    size_t total = global_symbol_table_count(table);
+    GlobalEntry** sorted = (GlobalEntry**)malloc((total ? total : 1) * sizeof(GlobalEntry*));
+    if (!sorted) return false;
+    size_t n = 0;
+    for (size_t i = 0; i < GST_SHARD_COUNT; ++i) {
+        DynamicArray* entries = table->shards[i].entries;
+        for (size_t j = 0; j < da_count(entries); ++j) {
+            sorted[n++] = (GlobalEntry*)da_get(entries, j);
+        }
+    }
+    qsort(sorted, n, sizeof(GlobalEntry*), compare_entries_by_order);
+
+    da_destroy(table->slots);
+    table->slots = da_create(n ? n : 1, sizeof(Symbol*));
+    table->first_slot = first_slot;
+    for (size_t i = 0; i < n && table->slots; ++i) {
+        Symbol* symbol = atomic_load_explicit(&sorted[i]->symbol, memory_order_relaxed);
+        symbol->depth = 0;
+        symbol->slot = first_slot + (int)i;
+        da_push(table->slots, symbol);
+    }
+    free(sorted);
+    return table->slots != NULL;
+}
+
+Symbol* global_symbol_table_symbol_at(const GlobalSymbolTable* table, int slot) {
+    if (!table || slot < table->first_slot) return NULL;
+    return (Symbol*)da_get(table->slots, (size_t)(slot - table->first_slot));
+}
+
+size_t global_symbol_table_count(const GlobalSymbolTable* table) {
+    if (!table) return 0;
+    size_t total = 0;
+    for (size_t i = 0; i < GST_SHARD_COUNT; ++i) {
+        total += da_count(table->shards[i].entries);
+    }
+    return total;
+}
+
+static int compare_conflicts_by_order(const void* a, const void* b) {
+    const GlobalConflict* ca = *(GlobalConflict* const*)a;
+    const GlobalConflict* cb = *(GlobalConflict* const*)b;
+    return (ca->order > cb->order) - (ca->order < cb->order);
+}
+
+DynamicArray* global_symbol_table_take_conflicts(GlobalSymbolTable* table) {
+    if (!table) return NULL;
+    DynamicArray* result = da_create(0, sizeof(GlobalConflict*));
+    if (!result) return NULL;
+    for (size_t i = 0; i < GST_SHARD_COUNT; ++i) {
+        DynamicArray* conflicts = table->shards[i].conflicts;
+        for (size_t j = 0; j < da_count(conflicts); ++j) {
+            GlobalConflict* src = (GlobalConflict*)da_get(conflicts, j);
+            GlobalConflict* copy = (GlobalConflict*)malloc(sizeof(GlobalConflict));
+            if (!copy) continue;
+            *copy = *src;
+            // Resolve against the final winner, not whichever definition was
+            // current when the conflict happened to be detected.
+            copy->original = global_symbol_table_lookup(table, src->duplicate->name_token);
+            da_push(result, copy);
+        }
+    }
+    if (da_count(result) > 1) {
+        qsort(result->items, da_count(result), sizeof(void*), compare_conflicts_by_order);
+    }
+    return result;
+}
@@ -0,0 +1,64 @@
+#ifndef GLOBAL_SYMBOL_TABLE_H
+#define GLOBAL_SYMBOL_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include <stdint.h> // For uint64_t
+#include "../util/dynamic_array.h"
+#include "token.h"
+
+struct Symbol;
+
+// Global-scope symbol table shared by analysis worker threads.
+//
+// The table is split into shards selected by the name hash. Inserts take the
+// shard's mutex; lookups take no lock at all: bucket chains are immutable once
+// published, so a lookup is a bounded walk over acquire-loaded pointers
+// (wait-free). A lookup racing with an insert of the same name may miss it.
+//
+// Every definition carries an `order` key (its position in the source). When
+// the same name is defined twice, the definition with the lowest order wins no
+// matter which thread got there first, and the others are recorded as
+// conflicts. This keeps redefinition diagnostics deterministic.
+typedef struct GlobalSymbolTable GlobalSymbolTable;
+
+// A redefinition found while inserting. `original` is filled in by
+// global_symbol_table_take_conflicts, once the winning definition is final.
+typedef struct {
+    struct Symbol* duplicate; // The losing definition (still owned by the table)
+    struct Symbol* original;  // The winning definition of the same name
+    uint64_t order;           // Order key of the duplicate
+} GlobalConflict;
+
+GlobalSymbolTable* global_symbol_table_create(void);
+
+// Frees the table, all symbols defined in it and all conflicting duplicates.
+void global_symbol_table_destroy(GlobalSymbolTable* table);
+
+// Defines a global symbol. Thread-safe. The table always takes ownership of the symbol.
+// Returns true if `symbol` is now the definition of its name, false if a definition
+// with a lower order key already exists (the symbol is then recorded as a conflict).
+bool global_symbol_table_define(GlobalSymbolTable* table, struct Symbol* symbol, uint64_t order);
+
+// Looks up a global symbol by name. Thread-safe and lock-free.
+struct Symbol* global_symbol_table_lookup(const GlobalSymbolTable* table, Token name_token);
+
+// Assigns dense slots from `first_slot` on (in order-key order) to all winning
+// definitions, so that symbols get the same (depth 0, slot) on every run
+// regardless of thread timing. Must be called once all inserting threads are
+// done. Returns false on allocation failure.
+bool global_symbol_table_assign_slots(GlobalSymbolTable* table, int first_slot);
+
+// Returns the symbol in the given slot, or NULL if no definition has it. Only
+// valid after global_symbol_table_assign_slots.
+struct Symbol* global_symbol_table_symbol_at(const GlobalSymbolTable* table, int slot);
+
+// Number of winning definitions.
+size_t global_symbol_table_count(const GlobalSymbolTable* table);
+
+// Returns a DynamicArray of GlobalConflict*, sorted by the duplicate's order key.
+// The caller owns the array and the GlobalConflict structs (not the symbols).
+// Must be called once all inserting threads are done.
+DynamicArray* global_symbol_table_take_conflicts(GlobalSymbolTable* table);
+
+#endif // GLOBAL_SYMBOL_TABLE_H
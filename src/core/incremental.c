@@ -0,0 +1,787 @@
+#include "incremental.h"
+#include "symbol_table.h"
+#include "types.h"
+#include "typeclass.h"
+#include "adt_instance.h"
+#include "constructor_index.h"
+#include <stdint.h>
+#include <stdio.h>  // For stderr
+#include <stdlib.h>
+#include <string.h> // For memcmp
+
+typedef enum {
+    QUERY_NONE,     // Classes and instances: part of the program's shape
+    QUERY_ADT_BODY,
+    QUERY_LET,
+    QUERY_ADT_GRAPH,
+} QueryKind;
+
+typedef struct {
+    QueryKind kind;
+    uint64_t input;        // Content hash of the declaration (ADT_BODY, LET)
+    uint64_t fingerprint;  // Hash of the result, compared after re-running
+    uint32_t changed_at;   // Revision in which the result last changed
+    uint32_t verified_at;  // Revision in which the result was last known to be current
+    bool had_error;
+    size_t* deps;          // Queries read by the last run
+    size_t dep_count;
+    size_t dep_capacity;
+} Query;
+
+struct AnalysisSession {
+    SemanticAnalyzer* analyzer;
+    Program* program;        // Current revision
+    DynamicArray* sources;   // char*: texts that symbols and types still point into
+    uint64_t* shapes;        // Per statement: kind, name and, for declarations, header
+    Query* queries;          // Per statement, then the ADT graph query
+    size_t statement_count;
+    int* stmt_of_slot;       // Global slot -> index of the declaring statement (-1 if none)
+    size_t slot_count;
+    uint32_t revision;
+    bool declarations_ok;    // The current revision declared every name without errors
+    Diagnostics* diagnostics;
+    SessionStats stats;
+};
+
+
+// --- Content Hashes ---
+
+// 64-bit FNV-1a: a collision would make an edited declaration look unchanged.
+#define FNV64_OFFSET 0xcbf29ce484222325ULL
+#define FNV64_PRIME 0x100000001b3ULL
+
+static uint64_t hash_mix(uint64_t hash, const void* bytes, size_t length) {
+    const unsigned char* p = (const unsigned char*)bytes;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= p[i];
+        hash *= FNV64_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t hash_u64(uint64_t hash, uint64_t value) {
+    return hash_mix(hash, &value, sizeof(value));
+}
+
+static uint64_t hash_token(uint64_t hash, Token token) {
+    hash = hash_u64(hash, ((uint64_t)token.type << 32) | token.length);
+    return hash_mix(hash, token.lexeme, token.length);
+}
+
+// DynamicArray of Token* (type parameters, class names).
+static uint64_t hash_token_list(uint64_t hash, DynamicArray* tokens) {
+    hash = hash_u64(hash, da_count(tokens));
+    for (size_t i = 0; i < da_count(tokens); ++i) hash = hash_token(hash, *(Token*)da_get(tokens, i));
+    return hash;
+}
+
+static uint64_t hash_annotation(uint64_t hash, TypeAnnotation* annot) {
+    if (!annot) return hash_u64(hash, 0);
+    hash = hash_u64(hash, annot->is_mutable ? 2 : 1);
+    hash = hash_token(hash, annot->name);
+    hash = hash_annotation(hash, annot->referent);
+    hash = hash_u64(hash, da_count(annot->args));
+    for (size_t i = 0; i < da_count(annot->args); ++i) {
+        hash = hash_annotation(hash, (TypeAnnotation*)da_get(annot->args, i));
+    }
+    return hash;
+}
+
+static uint64_t hash_pattern(uint64_t hash, Pattern* pattern) {
+    if (!pattern) return hash_u64(hash, 0);
+    hash = hash_u64(hash, (uint64_t)pattern->kind + 1);
+    hash = hash_token(hash, pattern->token);
+    hash = hash_u64(hash, da_count(pattern->subpatterns));
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        hash = hash_pattern(hash, (Pattern*)da_get(pattern->subpatterns, i));
+    }
+    return hash;
+}
+
+static uint64_t hash_expr(uint64_t hash, Expr* expr) {
+    if (!expr) return hash_u64(hash, 0);
+    hash = hash_u64(hash, (uint64_t)expr->type + 1);
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            return hash_token(hash, ((ExprLiteral*)expr)->literal);
+        case EXPR_VARIABLE:
+            return hash_token(hash, ((ExprVariable*)expr)->name);
+        case EXPR_CALL: {
+            ExprCall* call = (ExprCall*)expr;
+            hash = hash_expr(hash, call->callee);
+            hash = hash_u64(hash, da_count(call->arguments));
+            for (size_t i = 0; i < da_count(call->arguments); ++i) {
+                hash = hash_expr(hash, (Expr*)da_get(call->arguments, i));
+            }
+            return hash;
+        }
+        case EXPR_BORROW:
+            hash = hash_u64(hash, ((ExprBorrow*)expr)->is_mutable);
+            return hash_expr(hash, ((ExprBorrow*)expr)->operand);
+        case EXPR_MATCH: {
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            hash = hash_expr(hash, match_expr->scrutinee);
+            hash = hash_u64(hash, da_count(match_expr->arms));
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                hash = hash_pattern(hash, arm->pattern);
+                hash = hash_expr(hash, arm->body);
+            }
+            return hash;
+        }
+        default:
+            return hash;
+    }
+}
+
+// Parameters with their bounds: `<T: Ord + Show, U>`.
+static uint64_t hash_params(uint64_t hash, DynamicArray* params, DynamicArray* bounds) {
+    hash = hash_token_list(hash, params);
+    for (size_t i = 0; i < da_count(bounds); ++i) {
+        hash = hash_token_list(hash, (DynamicArray*)da_get(bounds, i));
+    }
+    return hash;
+}
+
+// What must stay the same for a revision to be analyzed incrementally.
+static uint64_t statement_shape(Stmt* stmt) {
+    uint64_t hash = hash_u64(FNV64_OFFSET, stmt->type);
+    switch (stmt->type) {
+        case STMT_DATA: {
+            StmtData* data = (StmtData*)stmt;
+            return hash_params(hash_token(hash, data->name), data->type_params, data->param_bounds);
+        }
+        case STMT_LET:
+            return hash_token(hash, ((StmtLet*)stmt)->name);
+        case STMT_CLASS: {
+            StmtClass* cls = (StmtClass*)stmt;
+            hash = hash_token(hash_token(hash, cls->name), cls->superclass);
+            return hash_token_list(hash, cls->methods);
+        }
+        case STMT_INSTANCE: {
+            StmtInstance* inst = (StmtInstance*)stmt;
+            hash = hash_params(hash_token(hash, inst->class_name), inst->type_params, inst->param_bounds);
+            return hash_annotation(hash, inst->head);
+        }
+        default:
+            return hash;
+    }
+}
+
+// The input of a statement's query: all of its syntax.
+static uint64_t statement_input(Stmt* stmt) {
+    uint64_t hash = statement_shape(stmt);
+    switch (stmt->type) {
+        case STMT_DATA: {
+            StmtData* data = (StmtData*)stmt;
+            hash = hash_u64(hash, da_count(data->variants));
+            for (size_t v = 0; v < da_count(data->variants); ++v) {
+                ADTVariant* variant = (ADTVariant*)da_get(data->variants, v);
+                hash = hash_token(hash, variant->name);
+                hash = hash_u64(hash, da_count(variant->fields));
+                for (size_t f = 0; f < da_count(variant->fields); ++f) {
+                    ADTVariantField* field = (ADTVariantField*)da_get(variant->fields, f);
+                    hash = hash_annotation(hash_token(hash, field->name), field->type_annot);
+                }
+            }
+            return hash;
+        }
+        case STMT_LET: {
+            StmtLet* let = (StmtLet*)stmt;
+            hash = hash_u64(hash, let->is_mutable);
+            return hash_expr(hash_annotation(hash, let->type_annot), let->initializer);
+        }
+        default:
+            return hash;
+    }
+}
+
+
+// --- Results ---
+
+static uint64_t body_fingerprint(Symbol* adt_symbol) {
+    uint64_t hash = FNV64_OFFSET;
+    ADTDefinition* def = adt_symbol ? adt_symbol->data.adt_def : NULL;
+    for (size_t v = 0; def && v < da_count(def->variants); ++v) {
+        ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(def->variants, v);
+        hash = hash_token(hash, variant->name);
+        hash = hash_u64(hash, da_count(variant->fields));
+        for (size_t f = 0; f < da_count(variant->fields); ++f) {
+            ADTFieldSymbol* field = (ADTFieldSymbol*)da_get(variant->fields, f);
+            hash = hash_u64(hash_token(hash, field->name), field->type->id);
+        }
+    }
+    return hash;
+}
+
+static uint64_t graph_fingerprint(AnalysisSession* session) {
+    uint64_t hash = FNV64_OFFSET;
+    for (size_t i = 0; i < session->statement_count; ++i) {
+        if (session->queries[i].kind != QUERY_ADT_BODY) continue;
+        Symbol* symbol = ((StmtData*)da_get(session->program->statements, i))->symbol;
+        ADTDefinition* def = symbol ? symbol->data.adt_def : NULL;
+        if (!def) continue;
+        hash = hash_u64(hash, session->queries[i].fingerprint);
+        hash = hash_u64(hash, ((uint64_t)(uint32_t)def->scc << 2) | (def->recursive << 1) | def->inhabited);
+        for (size_t v = 0; v < da_count(def->variants); ++v) {
+            ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(def->variants, v);
+            for (size_t f = 0; f < da_count(variant->fields); ++f) {
+                hash = hash_u64(hash, ((ADTFieldSymbol*)da_get(variant->fields, f))->boxed);
+            }
+        }
+    }
+    return hash;
+}
+
+
+// --- Dependencies ---
+
+static void add_dep(Query* query, size_t dep) {
+    for (size_t i = 0; i < query->dep_count; ++i) {
+        if (query->deps[i] == dep) return;
+    }
+    if (query->dep_count == query->dep_capacity) {
+        size_t new_capacity = query->dep_capacity ? query->dep_capacity * 2 : 4;
+        size_t* deps = (size_t*)realloc(query->deps, new_capacity * sizeof(size_t));
+        if (!deps) return;
+        query->deps = deps;
+        query->dep_capacity = new_capacity;
+    }
+    query->deps[query->dep_count++] = dep;
+}
+
+static void add_symbol_dep(AnalysisSession* session, Query* query, Symbol* symbol) {
+    if (!symbol || symbol->depth != 0 || (size_t)symbol->slot >= session->slot_count) return;
+    int stmt = session->stmt_of_slot[symbol->slot];
+    if (stmt >= 0) add_dep(query, (size_t)stmt);
+}
+
+static void record_pattern_deps(AnalysisSession* session, Query* query, Pattern* pattern) {
+    if (!pattern) return;
+    add_symbol_dep(session, query, pattern->constructor_adt);
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        record_pattern_deps(session, query, (Pattern*)da_get(pattern->subpatterns, i));
+    }
+}
+
+// The `let`s and ADT bodies an initializer read, from its resolved names.
+static void record_expr_deps(AnalysisSession* session, Query* query, Expr* expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_VARIABLE: {
+            ExprVariable* var = (ExprVariable*)expr;
+            add_symbol_dep(session, query, var->symbol);
+            add_symbol_dep(session, query, var->constructor_adt);
+            break;
+        }
+        case EXPR_CALL: {
+            ExprCall* call = (ExprCall*)expr;
+            add_symbol_dep(session, query, call->constructor_adt);
+            for (size_t i = 0; i < da_count(call->arguments); ++i) {
+                record_expr_deps(session, query, (Expr*)da_get(call->arguments, i));
+            }
+            break;
+        }
+        case EXPR_BORROW:
+            record_expr_deps(session, query, ((ExprBorrow*)expr)->operand);
+            break;
+        case EXPR_MATCH: {
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            record_expr_deps(session, query, match_expr->scrutinee);
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                record_pattern_deps(session, query, arm->pattern);
+                record_expr_deps(session, query, arm->body);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static bool class_is_derived(const TypeClass* cls) {
+    for (; cls; cls = cls->superclass) {
+        if (cls->derived) return true;
+    }
+    return false;
+}
+
+// Whether checking `type` against class bounds involves a derived class, whose
+// instances depend on ADT bodies through the graph.
+static bool mentions_derived_bound(TypeClassEnv* classes, Type* type) {
+    if (type->kind == TYPE_REFERENCE) return mentions_derived_bound(classes, ((TypeReference*)type)->referent);
+    if (type->kind != TYPE_ADT) return false;
+    TypeADT* adt = (TypeADT*)type;
+    for (size_t i = 0; i < adt->type_arg_count; ++i) {
+        size_t count = 0;
+        const TypeClass* const* bounds = typeclass_param_bounds(classes, adt->adt_symbol, (int)i, &count);
+        for (size_t b = 0; b < count; ++b) {
+            if (class_is_derived(bounds[b])) return true;
+        }
+        if (mentions_derived_bound(classes, adt->type_args[i])) return true;
+    }
+    return false;
+}
+
+
+// --- Running Queries ---
+
+static void begin_query(AnalysisSession* session, Query* query) {
+    query->dep_count = 0;
+    query->verified_at = session->revision;
+    session->stats.executed++;
+}
+
+// Ends a run: the result changed unless its fingerprint matches the previous one.
+static void end_query(AnalysisSession* session, Query* query, size_t diagnostics_start, uint64_t fingerprint, bool first) {
+    query->had_error = diagnostics_count(session->diagnostics) > diagnostics_start;
+    if (first || fingerprint != query->fingerprint) {
+        query->changed_at = session->revision;
+    } else {
+        session->stats.cut_off++;
+    }
+    query->fingerprint = fingerprint;
+}
+
+static void run_body(AnalysisSession* session, size_t index, bool first) {
+    Query* query = &session->queries[index];
+    StmtData* stmt = (StmtData*)da_get(session->program->statements, index);
+    size_t start = diagnostics_count(session->diagnostics);
+    begin_query(session, query);
+    semantic_analyzer_analyze_data(session->analyzer, stmt);
+    if (!first) adt_instance_refresh(session->analyzer->instances, stmt->symbol);
+    end_query(session, query, start, body_fingerprint(stmt->symbol), first);
+}
+
+static void run_graph(AnalysisSession* session, bool first) {
+    Query* query = &session->queries[session->statement_count];
+    size_t start = diagnostics_count(session->diagnostics);
+    begin_query(session, query);
+    if (!first) {
+        // Capabilities and derived instances were computed from the old bodies.
+        typeclass_forget_resolutions(session->analyzer->classes);
+        types_forget_capabilities();
+    }
+    semantic_analyzer_analyze_adt_graph(session->analyzer, session->program);
+    for (size_t i = 0; i < session->statement_count; ++i) {
+        if (session->queries[i].kind == QUERY_ADT_BODY) add_dep(query, i);
+    }
+    end_query(session, query, start, graph_fingerprint(session), first);
+}
+
+// Clears an initializer's annotations before it is resolved afresh.
+static void reset_pattern(Pattern* pattern) {
+    if (!pattern) return;
+    pattern->symbol = NULL;
+    pattern->constructor_adt = NULL;
+    pattern->constructor_tag = -1;
+    pattern->inferred_type = NULL;
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) reset_pattern((Pattern*)da_get(pattern->subpatterns, i));
+}
+
+static void reset_expr(Expr* expr) {
+    if (!expr) return;
+    expr->inferred_type = NULL;
+    if (expr->type == EXPR_VARIABLE) {
+        ExprVariable* var = (ExprVariable*)expr;
+        var->symbol = NULL;
+        var->depth = var->slot = -1;
+        var->constructor_adt = NULL;
+        var->constructor_tag = -1;
+    } else if (expr->type == EXPR_CALL) {
+        ExprCall* call = (ExprCall*)expr;
+        call->constructor_adt = NULL;
+        call->constructor_tag = -1;
+        reset_expr(call->callee);
+        for (size_t i = 0; i < da_count(call->arguments); ++i) reset_expr((Expr*)da_get(call->arguments, i));
+    } else if (expr->type == EXPR_BORROW) {
+        reset_expr(((ExprBorrow*)expr)->operand);
+    } else if (expr->type == EXPR_MATCH) {
+        ExprMatch* match_expr = (ExprMatch*)expr;
+        reset_expr(match_expr->scrutinee);
+        for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+            MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+            reset_pattern(arm->pattern);
+            reset_expr(arm->body);
+        }
+    }
+}
+
+static void run_let(AnalysisSession* session, size_t index, Symbol* symbol, bool first) {
+    Query* query = &session->queries[index];
+    StmtLet* stmt = (StmtLet*)da_get(session->program->statements, index);
+    size_t start = diagnostics_count(session->diagnostics);
+    begin_query(session, query);
+    if (first) {
+        semantic_analyzer_analyze_statement(session->analyzer, (Stmt*)stmt);
+    } else {
+        // Carried-over annotations would survive a failed lookup.
+        reset_expr(stmt->initializer);
+        symbol->name_token = stmt->name;
+        semantic_analyzer_reanalyze_let(session->analyzer, stmt, symbol);
+    }
+    record_expr_deps(session, query, stmt->initializer);
+    Type* type = stmt->symbol ? stmt->symbol->type : NULL;
+    if (type && mentions_derived_bound(session->analyzer->classes, type)) add_dep(query, session->statement_count);
+    end_query(session, query, start, type ? type->id : 0, first);
+}
+
+// Whether a query read something that changed after it last ran.
+static bool deps_changed(AnalysisSession* session, const Query* query) {
+    for (size_t i = 0; i < query->dep_count; ++i) {
+        if (session->queries[query->deps[i]].changed_at > query->verified_at) return true;
+    }
+    return false;
+}
+
+
+// --- Carrying Results Over ---
+
+static bool migrate_pattern(Pattern* from, Pattern* to) {
+    if (!from || !to) return from == to;
+    if (from->kind != to->kind || da_count(from->subpatterns) != da_count(to->subpatterns)) return false;
+    to->symbol = from->symbol;
+    to->constructor_adt = from->constructor_adt;
+    to->constructor_tag = from->constructor_tag;
+    to->inferred_type = from->inferred_type;
+    if (to->symbol) to->symbol->name_token = to->token; // The binding lives on in its arm's closed scope
+    for (size_t i = 0; i < da_count(from->subpatterns); ++i) {
+        if (!migrate_pattern((Pattern*)da_get(from->subpatterns, i), (Pattern*)da_get(to->subpatterns, i))) return false;
+    }
+    return true;
+}
+
+// Copies the resolver's and inferencer's annotations from an unchanged
+// initializer to its new AST. Returns false if the two do not match.
+static bool migrate_expr(Expr* from, Expr* to) {
+    if (!from || !to) return from == to;
+    if (from->type != to->type) return false;
+    to->inferred_type = from->inferred_type;
+    switch (from->type) {
+        case EXPR_VARIABLE: {
+            ExprVariable* a = (ExprVariable*)from;
+            ExprVariable* b = (ExprVariable*)to;
+            b->symbol = a->symbol;
+            b->depth = a->depth;
+            b->slot = a->slot;
+            b->constructor_adt = a->constructor_adt;
+            b->constructor_tag = a->constructor_tag;
+            return true;
+        }
+        case EXPR_CALL: {
+            ExprCall* a = (ExprCall*)from;
+            ExprCall* b = (ExprCall*)to;
+            if (da_count(a->arguments) != da_count(b->arguments)) return false;
+            b->constructor_adt = a->constructor_adt;
+            b->constructor_tag = a->constructor_tag;
+            if (!migrate_expr(a->callee, b->callee)) return false;
+            for (size_t i = 0; i < da_count(a->arguments); ++i) {
+                if (!migrate_expr((Expr*)da_get(a->arguments, i), (Expr*)da_get(b->arguments, i))) return false;
+            }
+            return true;
+        }
+        case EXPR_BORROW:
+            return migrate_expr(((ExprBorrow*)from)->operand, ((ExprBorrow*)to)->operand);
+        case EXPR_MATCH: {
+            ExprMatch* a = (ExprMatch*)from;
+            ExprMatch* b = (ExprMatch*)to;
+            if (da_count(a->arms) != da_count(b->arms)) return false;
+            if (!migrate_expr(a->scrutinee, b->scrutinee)) return false;
+            for (size_t i = 0; i < da_count(a->arms); ++i) {
+                MatchArm* arm_a = (MatchArm*)da_get(a->arms, i);
+                MatchArm* arm_b = (MatchArm*)da_get(b->arms, i);
+                if (!migrate_pattern(arm_a->pattern, arm_b->pattern)) return false;
+                if (!migrate_expr(arm_a->body, arm_b->body)) return false;
+            }
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+// Points an unchanged ADT's names at the new revision's tokens, so diagnostics
+// and the symbol index see current positions.
+static void migrate_data(StmtData* to, Symbol* symbol) {
+    ADTDefinition* def = symbol->data.adt_def;
+    symbol->name_token = to->name;
+    def->name = to->name;
+    for (size_t v = 0; v < da_count(def->variants) && v < da_count(to->variants); ++v) {
+        ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(def->variants, v);
+        ADTVariant* ast_variant = (ADTVariant*)da_get(to->variants, v);
+        variant->name = ast_variant->name;
+        for (size_t f = 0; f < da_count(variant->fields) && f < da_count(ast_variant->fields); ++f) {
+            ((ADTFieldSymbol*)da_get(variant->fields, f))->name = ((ADTVariantField*)da_get(ast_variant->fields, f))->name;
+        }
+    }
+}
+
+
+// --- Revisions ---
+
+static void free_sources(AnalysisSession* session) {
+    for (size_t i = 0; i < da_count(session->sources); ++i) free(da_get(session->sources, i));
+    while (da_count(session->sources) > 0) da_pop(session->sources);
+}
+
+static void free_queries(AnalysisSession* session) {
+    for (size_t i = 0; session->queries && i <= session->statement_count; ++i) free(session->queries[i].deps);
+    free(session->queries);
+    free(session->shapes);
+    free(session->stmt_of_slot);
+    session->queries = NULL;
+    session->shapes = NULL;
+    session->stmt_of_slot = NULL;
+    session->statement_count = 0;
+    session->slot_count = 0;
+}
+
+static bool analyze_from_scratch(AnalysisSession* session, Program* program, uint64_t* shapes) {
+    DynamicArray* statements = program->statements;
+    size_t n = da_count(statements);
+    semantic_analyzer_destroy(session->analyzer); // Frees every type of the old revision
+    ast_program_destroy(session->program);
+    free_sources(session);
+    free_queries(session);
+    session->program = program;
+    session->shapes = shapes;
+    session->statement_count = n;
+    session->queries = (Query*)calloc(n + 1, sizeof(Query));
+    session->analyzer = semantic_analyzer_create();
+    if (!session->queries || !session->analyzer) return false;
+    semantic_analyzer_set_diagnostics(session->analyzer, session->diagnostics);
+    session->stats.full = true;
+
+    semantic_analyzer_declare(session->analyzer, program);
+    session->declarations_ok = diagnostics_count(session->diagnostics) == 0;
+    for (size_t i = 0; i < n; ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        Query* query = &session->queries[i];
+        query->input = statement_input(stmt);
+        if (stmt->type == STMT_DATA) {
+            query->kind = QUERY_ADT_BODY;
+            run_body(session, i, true);
+        }
+    }
+    session->queries[n].kind = QUERY_ADT_GRAPH;
+    run_graph(session, true);
+
+    // Lets are declared as they are analyzed, in order.
+    for (size_t i = 0; i < n; ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type == STMT_DATA || stmt->type == STMT_CLASS || stmt->type == STMT_INSTANCE) continue;
+        Query* query = &session->queries[i];
+        query->kind = QUERY_LET;
+        size_t start = diagnostics_count(session->diagnostics);
+        begin_query(session, query);
+        semantic_analyzer_analyze_statement(session->analyzer, stmt); // Declares the binding
+        query->had_error = diagnostics_count(session->diagnostics) > start;
+        Symbol* symbol = stmt->type == STMT_LET ? ((StmtLet*)stmt)->symbol : NULL;
+        if (stmt->type != STMT_LET || !symbol) session->declarations_ok = false;
+    }
+    DynamicArray* globals = session->analyzer->sym_table->global_scope->symbols;
+    session->slot_count = da_count(globals);
+    session->stmt_of_slot = (int*)malloc((session->slot_count ? session->slot_count : 1) * sizeof(int));
+    if (!session->stmt_of_slot) return false;
+    for (size_t i = 0; i < session->slot_count; ++i) session->stmt_of_slot[i] = -1;
+    for (size_t i = 0; i < n; ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        Symbol* symbol = stmt->type == STMT_DATA ? ((StmtData*)stmt)->symbol
+                       : stmt->type == STMT_LET ? ((StmtLet*)stmt)->symbol : NULL;
+        if (symbol && symbol->depth == 0) session->stmt_of_slot[symbol->slot] = (int)i;
+    }
+    // Dependencies go through slots, known only once every let is declared.
+    for (size_t i = 0; i < n; ++i) {
+        Query* query = &session->queries[i];
+        if (query->kind != QUERY_LET) continue;
+        StmtLet* stmt = (StmtLet*)da_get(statements, i);
+        record_expr_deps(session, query, stmt->initializer);
+        Type* type = stmt->symbol ? stmt->symbol->type : NULL;
+        if (type && mentions_derived_bound(session->analyzer->classes, type)) add_dep(query, n);
+        query->changed_at = session->revision;
+        query->fingerprint = type ? type->id : 0;
+    }
+    return true;
+}
+
+static bool analyze_incrementally(AnalysisSession* session, Program* program, uint64_t* shapes) {
+    DynamicArray* statements = program->statements;
+    DynamicArray* old_statements = session->program->statements;
+    size_t n = session->statement_count;
+    session->stats.full = false;
+
+    // Which queries run again: those whose input changed, and those with errors.
+    bool* rerun = (bool*)calloc(n + 1, sizeof(bool));
+    if (!rerun) return false;
+    for (size_t i = 0; i < n; ++i) {
+        Query* query = &session->queries[i];
+        if (query->kind == QUERY_NONE) continue;
+        uint64_t input = statement_input((Stmt*)da_get(statements, i));
+        rerun[i] = input != query->input || query->had_error;
+        query->input = input;
+    }
+
+    // Constructors share one namespace, and a clash is reported on the later of
+    // the two ADTs. A re-run body taking a name from a later ADT that keeps its
+    // result would move that error: analyze from scratch instead. Nothing of the
+    // new revision has been touched yet.
+    for (size_t i = 0; i < n; ++i) {
+        if (!rerun[i] || session->queries[i].kind != QUERY_ADT_BODY) continue;
+        StmtData* stmt = (StmtData*)da_get(statements, i);
+        Symbol* symbol = ((StmtData*)da_get(old_statements, i))->symbol;
+        for (size_t v = 0; v < da_count(stmt->variants); ++v) {
+            const ConstructorEntry* entry = constructor_index_lookup(session->analyzer->constructors,
+                                                                     ((ADTVariant*)da_get(stmt->variants, v))->name);
+            if (!entry || entry->adt_symbol == symbol) continue;
+            int owner = session->stmt_of_slot[entry->adt_symbol->slot];
+            if (owner > (int)i && !rerun[owner]) {
+                free(rerun);
+                return false;
+            }
+        }
+    }
+
+    // Carry over the symbols of every declaration, and the results of unchanged ones.
+    for (size_t i = 0; i < n; ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        Stmt* old = (Stmt*)da_get(old_statements, i);
+        Query* query = &session->queries[i];
+        if (query->kind == QUERY_ADT_BODY) {
+            Symbol* symbol = ((StmtData*)old)->symbol;
+            ((StmtData*)stmt)->symbol = symbol;
+            if (rerun[i]) {
+                // The variants keep their old names until the body is forgotten.
+                symbol->name_token = ((StmtData*)stmt)->name;
+                symbol->data.adt_def->name = ((StmtData*)stmt)->name;
+            } else {
+                migrate_data((StmtData*)stmt, symbol);
+            }
+        } else if (query->kind == QUERY_LET) {
+            // A let keeps its binding either way; only unchanged ones keep their annotations.
+            StmtLet* let = (StmtLet*)stmt;
+            StmtLet* old_let = (StmtLet*)old;
+            let->symbol = old_let->symbol;
+            let->symbol->name_token = let->name;
+            if (!rerun[i] && !migrate_expr(old_let->initializer, let->initializer)) rerun[i] = true;
+        }
+    }
+
+    ast_program_destroy(session->program);
+    session->program = program;
+    free(session->shapes);
+    session->shapes = shapes;
+    // ADT bodies: drop every body that runs again first, so their constructors
+    // are registered afresh in source order.
+    for (size_t i = 0; i < n; ++i) {
+        if (rerun[i] && session->queries[i].kind == QUERY_ADT_BODY) {
+            semantic_analyzer_forget_data(session->analyzer, ((StmtData*)da_get(statements, i))->symbol);
+        }
+    }
+    bool bodies_changed = false;
+    for (size_t i = 0; i < n; ++i) {
+        Query* query = &session->queries[i];
+        if (query->kind != QUERY_ADT_BODY) continue;
+        if (rerun[i]) {
+            run_body(session, i, false);
+            if (query->changed_at == session->revision) bodies_changed = true;
+        } else {
+            query->verified_at = session->revision;
+            session->stats.reused++;
+        }
+    }
+    Query* graph = &session->queries[n];
+    if (bodies_changed || graph->had_error) {
+        run_graph(session, false);
+    } else {
+        graph->verified_at = session->revision;
+        session->stats.reused++;
+    }
+
+    // Lets, in order: everything a let reads comes before it.
+    for (size_t i = 0; i < n; ++i) {
+        Query* query = &session->queries[i];
+        if (query->kind != QUERY_LET) continue;
+        if (rerun[i] || deps_changed(session, query)) {
+            StmtLet* stmt = (StmtLet*)da_get(statements, i);
+            run_let(session, i, stmt->symbol, false);
+        } else {
+            query->verified_at = session->revision;
+            session->stats.reused++;
+        }
+    }
+    free(rerun);
+    return true;
+}
+
+
+// --- Public API ---
+
+AnalysisSession* analysis_session_create(void) {
+    AnalysisSession* session = (AnalysisSession*)calloc(1, sizeof(AnalysisSession));
+    if (!session) return NULL;
+    session->sources = da_create(4, sizeof(char*));
+    session->diagnostics = diagnostics_create(NULL);
+    if (!session->sources || !session->diagnostics) {
+        analysis_session_destroy(session);
+        return NULL;
+    }
+    return session;
+}
+
+void analysis_session_destroy(AnalysisSession* session) {
+    if (!session) return;
+    semantic_analyzer_destroy(session->analyzer);
+    ast_program_destroy(session->program);
+    if (session->sources) free_sources(session);
+    da_destroy(session->sources);
+    free_queries(session);
+    diagnostics_destroy(session->diagnostics);
+    free(session);
+}
+
+bool analysis_session_update(AnalysisSession* session, Program* program, char* source) {
+    if (!session || !program) {
+        free(source);
+        if (program) ast_program_destroy(program);
+        return false;
+    }
+    size_t n = da_count(program->statements);
+    uint64_t* shapes = (uint64_t*)malloc((n ? n : 1) * sizeof(uint64_t));
+    if (!shapes) {
+        free(source);
+        ast_program_destroy(program);
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) shapes[i] = statement_shape((Stmt*)da_get(program->statements, i));
+
+    session->revision++;
+    session->stats = (SessionStats){0};
+    diagnostics_reset(session->diagnostics, source);
+    bool same_shape = session->program && session->declarations_ok && n == session->statement_count &&
+                      memcmp(shapes, session->shapes, n * sizeof(uint64_t)) == 0;
+    bool ok = same_shape && analyze_incrementally(session, program, shapes);
+    if (!ok) {
+        session->stats = (SessionStats){0};
+        diagnostics_reset(session->diagnostics, source);
+        ok = analyze_from_scratch(session, program, shapes);
+    }
+    if (ok && diagnostics_count(session->diagnostics) == 0) {
+        semantic_analyzer_check_ownership(session->analyzer, session->program);
+    }
+    da_push(session->sources, source);
+    diagnostics_render(session->diagnostics, stderr);
+    return ok && diagnostics_count(session->diagnostics) == 0;
+}
+
+SemanticAnalyzer* analysis_session_analyzer(AnalysisSession* session) {
+    return session ? session->analyzer : NULL;
+}
+
+const SessionStats* analysis_session_stats(const AnalysisSession* session) {
+    return session ? &session->stats : NULL;
+}
+
+void analysis_session_set_error_limit(AnalysisSession* session, size_t limit) {
+    if (session) diagnostics_set_limit(session->diagnostics, limit);
+}
@@ -0,0 +1,60 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include "ast.h"
+#include "semantic_analyzer.h"
+
+// Incremental semantic analysis of successive revisions of one program.
+//
+// Analysis is split into memoized queries: the body of each ADT (its variants
+// with resolved field types), the ADT dependency graph (boxing, inhabitation,
+// field bounds) and the type of each `let`. Their inputs are the declarations,
+// identified by content hashes of their syntax; positions are not hashed, so
+// moving a declaration leaves it unchanged. While a query runs, the queries it
+// reads are recorded from what it resolved: a `let` reads the `let`s whose
+// bindings it uses, the bodies of the ADTs whose constructors it applies, and
+// the graph if its type is checked against a derived class bound (Copy).
+//
+// On a new revision, a query runs again only if its input changed or a query it
+// read changed since it last ran. A query that runs again and produces the same
+// result (the same interned type, the same variants) does not count as changed,
+// so the queries reading it keep their results: editing an initializer without
+// changing its type re-checks that one `let`. Queries that reported errors run
+// on every revision, so their diagnostics are reported again.
+//
+// The ownership check (borrow_check.h) is not a query either: it is linear in
+// the program and runs over all of it on every revision without errors.
+//
+// Classes, instances and ADT headers are not queries. If one of them changes, a
+// declaration is added, removed, renamed or moved relative to the others, or
+// the previous revision had errors in them, the revision is analyzed from scratch.
+typedef struct AnalysisSession AnalysisSession;
+
+typedef struct {
+    bool full;        // The last revision was analyzed from scratch
+    size_t executed;  // Queries run for the last revision
+    size_t reused;    // Queries whose memoized result was still valid
+    size_t cut_off;   // Queries that ran but produced an unchanged result
+} SessionStats;
+
+AnalysisSession* analysis_session_create(void);
+void analysis_session_destroy(AnalysisSession* session);
+
+// Analyzes the next revision of the program and reports its errors to stderr,
+// in the order semantic_analyzer_analyze would. Takes ownership of `program`
+// and of `source`, the text its tokens point into; sources are kept while
+// symbols and types computed from them are in use. Returns true if there were
+// no errors.
+bool analysis_session_update(AnalysisSession* session, Program* program, char* source);
+
+// Shows at most `limit` distinct errors per revision (0: all; see diagnostics.h).
+void analysis_session_set_error_limit(AnalysisSession* session, size_t limit);
+
+// The analyzer holding the current revision's symbols, types and caches.
+SemanticAnalyzer* analysis_session_analyzer(AnalysisSession* session);
+
+const SessionStats* analysis_session_stats(const AnalysisSession* session);
+
+#endif // INCREMENTAL_H
@@ -0,0 +1,533 @@
+#include "ir.h"
+#include "symbol_table.h"
+#include "../util/array.h"
+#include "../util/hash.h"
+#include <stdlib.h>
+#include <string.h> // For memcpy, memset, strlen, strncmp
+
+// Makes room for `extra` more entries in one of the program's tables; once that
+// fails, the program is out of memory and every later addition fails too.
+static bool reserve(IrProgram* program, void** items, uint32_t* capacity, uint32_t count, uint32_t extra, size_t size) {
+    if (program->out_of_memory) return false;
+    if (!array_reserve_u32(items, capacity, (size_t)count + extra, size)) program->out_of_memory = true;
+    return !program->out_of_memory;
+}
+
+IrProgram* ir_program_create(void) {
+    return (IrProgram*)calloc(1, sizeof(IrProgram));
+}
+
+void ir_program_destroy(IrProgram* program) {
+    if (!program) return;
+    for (uint32_t i = 0; i < program->string_count; ++i) free(program->strings[i]);
+    free(program->strings);
+    free(program->string_slots);
+    free(program->instrs);
+    free(program->blocks);
+    free(program->edges);
+    free(program->operands);
+    free(program->globals);
+    free(program->constants);
+    free(program);
+}
+
+
+// --- Building ---
+
+uint32_t ir_add_block(IrProgram* program) {
+    if (!reserve(program, (void**)&program->blocks, &program->block_capacity, program->block_count, 1, sizeof(IrBlock))) {
+        return UINT32_MAX;
+    }
+    IrBlock* block = &program->blocks[program->block_count];
+    memset(block, 0, sizeof(IrBlock));
+    block->first_instr = program->instr_count;
+    block->first_param = program->operand_count;
+    block->cond = IR_NO_VALUE;
+    return program->block_count++;
+}
+
+static IrValue append_instr(IrProgram* program, const IrInstr* instr) {
+    if (!reserve(program, (void**)&program->instrs, &program->instr_capacity, program->instr_count, 1, sizeof(IrInstr))) {
+        return IR_NO_VALUE;
+    }
+    program->instrs[program->instr_count] = *instr;
+    return program->instr_count++;
+}
+
+static uint32_t append_operands(IrProgram* program, const IrValue* values, uint32_t count) {
+    if (!reserve(program, (void**)&program->operands, &program->operand_capacity, program->operand_count, count,
+                 sizeof(IrValue))) {
+        return UINT32_MAX;
+    }
+    if (count) memcpy(program->operands + program->operand_count, values, count * sizeof(IrValue));
+    uint32_t first = program->operand_count;
+    program->operand_count += count;
+    return first;
+}
+
+IrValue ir_add_param(IrProgram* program, uint32_t block, Type* type) {
+    IrBlock* b = &program->blocks[block];
+    IrInstr instr = {IR_PARAM, block, 0, b->param_count, 0, 0, type};
+    IrValue value = append_instr(program, &instr);
+    if (value == IR_NO_VALUE) return IR_NO_VALUE;
+    // A block's parameter list is contiguous: it is only extended while it is the last list.
+    if (b->param_count == 0) b->first_param = program->operand_count;
+    if (b->first_param + b->param_count != program->operand_count ||
+        append_operands(program, &value, 1) == UINT32_MAX) {
+        program->out_of_memory = true;
+        return IR_NO_VALUE;
+    }
+    b->param_count++;
+    return value;
+}
+
+IrValue ir_add_instr(IrProgram* program, uint32_t block, IrOp op, Type* type, const IrValue* operands,
+                     uint32_t operand_count) {
+    IrBlock* b = &program->blocks[block];
+    uint32_t first = append_operands(program, operands, operand_count);
+    if (first == UINT32_MAX) return IR_NO_VALUE;
+    IrInstr instr = {(uint8_t)op, block, 0, 0, first, operand_count, type};
+    if (b->instr_count == 0) b->first_instr = program->instr_count;
+    if (b->first_instr + b->instr_count != program->instr_count) {
+        program->out_of_memory = true; // Misuse: another block's instructions came in between
+        return IR_NO_VALUE;
+    }
+    IrValue value = append_instr(program, &instr);
+    if (value != IR_NO_VALUE) b->instr_count++;
+    return value;
+}
+
+static bool same_string(const char* interned, const char* text, size_t length) {
+    return strncmp(interned, text, length) == 0 && interned[length] == '\0';
+}
+
+// Rehashes the string set at twice the size (grows at half load).
+static bool grow_string_slots(IrProgram* program) {
+    uint32_t capacity = program->string_slot_capacity ? program->string_slot_capacity * 2 : 64;
+    uint32_t* slots = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    if (!slots) {
+        program->out_of_memory = true;
+        return false;
+    }
+    for (uint32_t i = 0; i < program->string_count; ++i) {
+        uint32_t s = hash_bytes(program->strings[i], strlen(program->strings[i])) & (capacity - 1);
+        while (slots[s]) s = (s + 1) & (capacity - 1);
+        slots[s] = i + 1;
+    }
+    free(program->string_slots);
+    program->string_slots = slots;
+    program->string_slot_capacity = capacity;
+    return true;
+}
+
+uint32_t ir_intern_string(IrProgram* program, const char* text, size_t length) {
+    if ((program->string_count + 1) * 2 > program->string_slot_capacity && !grow_string_slots(program)) {
+        return UINT32_MAX;
+    }
+    uint32_t mask = program->string_slot_capacity - 1;
+    uint32_t slot = hash_bytes(text, length) & mask;
+    for (; program->string_slots[slot]; slot = (slot + 1) & mask) {
+        uint32_t index = program->string_slots[slot] - 1;
+        if (same_string(program->strings[index], text, length)) return index;
+    }
+    if (!reserve(program, (void**)&program->strings, &program->string_capacity, program->string_count, 1,
+                 sizeof(char*))) {
+        return UINT32_MAX;
+    }
+    char* copy = (char*)malloc(length + 1);
+    if (!copy) {
+        program->out_of_memory = true;
+        return UINT32_MAX;
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    program->strings[program->string_count] = copy;
+    program->string_slots[slot] = program->string_count + 1;
+    return program->string_count++;
+}
+
+uint32_t ir_add_global(IrProgram* program, Token name, Type* type) {
+    if (!reserve(program, (void**)&program->globals, &program->global_capacity, program->global_count, 1,
+                 sizeof(IrGlobal))) {
+        return UINT32_MAX;
+    }
+    program->globals[program->global_count] = (IrGlobal){name, type};
+    return program->global_count++;
+}
+
+IrValue ir_add_constant(IrProgram* program, IrOp op, Type* type, int64_t imm) {
+    if (!reserve(program, (void**)&program->constants, &program->constant_capacity, program->constant_count, 1,
+                 sizeof(IrValue))) {
+        return IR_NO_VALUE;
+    }
+    IrInstr instr = {(uint8_t)op, 0, 0, imm, program->operand_count, 0, type};
+    IrValue value = append_instr(program, &instr);
+    if (value != IR_NO_VALUE) program->constants[program->constant_count++] = value;
+    return value;
+}
+
+void ir_set_terminator(IrProgram* program, uint32_t block, IrTermKind kind, IrValue cond) {
+    IrBlock* b = &program->blocks[block];
+    b->term = (uint8_t)kind;
+    b->cond = cond;
+    b->first_edge = program->edge_count;
+    b->edge_count = 0;
+}
+
+void ir_add_edge(IrProgram* program, uint32_t block, uint32_t target, int64_t case_value, const IrValue* args,
+                 uint32_t arg_count) {
+    IrBlock* b = &program->blocks[block];
+    if (b->first_edge + b->edge_count != program->edge_count) {
+        program->out_of_memory = true; // Misuse: edges of a block must be added together
+        return;
+    }
+    uint32_t first = append_operands(program, args, arg_count);
+    if (first == UINT32_MAX ||
+        !reserve(program, (void**)&program->edges, &program->edge_capacity, program->edge_count, 1, sizeof(IrEdge))) {
+        return;
+    }
+    program->edges[program->edge_count++] = (IrEdge){target, case_value, first, arg_count};
+    b->edge_count++;
+}
+
+
+// --- Compaction ---
+
+// The block a block is merged into (see ir_compact), or UINT32_MAX.
+static void find_merges(const IrProgram* program, uint32_t* merged_into, uint32_t* pred_count) {
+    for (uint32_t b = 0; b < program->block_count; ++b) {
+        merged_into[b] = UINT32_MAX;
+        pred_count[b] = 0;
+    }
+    for (uint32_t b = 0; b < program->block_count; ++b) {
+        const IrBlock* block = &program->blocks[b];
+        if (block->unreachable) continue;
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+            pred_count[program->edges[e].target]++;
+        }
+    }
+    for (uint32_t b = 0; b < program->block_count; ++b) {
+        const IrBlock* block = &program->blocks[b];
+        if (block->unreachable || block->term != IR_TERM_JUMP) continue;
+        uint32_t target = program->edges[block->first_edge].target;
+        if (target != 0 && target != b && pred_count[target] == 1) merged_into[target] = b;
+    }
+}
+
+// Follows the parameter-to-argument substitutions of merged blocks.
+static IrValue unalias(const IrValue* alias, IrValue value) {
+    while (alias[value] != IR_NO_VALUE) value = alias[value];
+    return value;
+}
+
+bool ir_compact(IrProgram* program) {
+    if (program->out_of_memory) return false;
+    uint32_t* value_map = (uint32_t*)malloc((program->instr_count + 1) * sizeof(uint32_t));
+    IrValue* alias = (IrValue*)malloc((program->instr_count + 1) * sizeof(IrValue));
+    uint32_t* block_map = (uint32_t*)malloc((program->block_count + 1) * sizeof(uint32_t));
+    uint32_t* merged_into = (uint32_t*)malloc((program->block_count + 1) * sizeof(uint32_t));
+    uint32_t* next = (uint32_t*)malloc((program->block_count + 1) * sizeof(uint32_t));
+    IrInstr* instrs = (IrInstr*)malloc((program->instr_count + 1) * sizeof(IrInstr));
+    IrBlock* blocks = (IrBlock*)malloc((program->block_count + 1) * sizeof(IrBlock));
+    IrEdge* edges = (IrEdge*)malloc((program->edge_count + 1) * sizeof(IrEdge));
+    IrValue* operands = (IrValue*)malloc((program->operand_count + 1) * sizeof(IrValue));
+    if (!value_map || !alias || !block_map || !merged_into || !next || !instrs || !blocks || !edges || !operands) {
+        free(value_map);
+        free(alias);
+        free(block_map);
+        free(merged_into);
+        free(next);
+        free(instrs);
+        free(blocks);
+        free(edges);
+        free(operands);
+        program->out_of_memory = true;
+        return false;
+    }
+
+    // A block whose only predecessor jumps to it continues that predecessor: its
+    // parameters become the jump's arguments. `next` links each chain of merged blocks.
+    find_merges(program, merged_into, next);
+    memset(alias, 0xff, (program->instr_count + 1) * sizeof(IrValue));
+    for (uint32_t b = 0; b < program->block_count; ++b) next[b] = UINT32_MAX;
+    for (uint32_t b = 0; b < program->block_count; ++b) {
+        if (merged_into[b] == UINT32_MAX) continue;
+        const IrBlock* block = &program->blocks[b];
+        const IrEdge* edge = &program->edges[program->blocks[merged_into[b]].first_edge];
+        next[merged_into[b]] = b;
+        for (uint32_t p = 0; p < block->param_count; ++p) {
+            alias[program->operands[block->first_param + p]] = program->operands[edge->first_arg + p];
+        }
+    }
+
+    // New IDs: per chain of reachable blocks, the parameters of its head, then its live instructions.
+    uint32_t instr_count = 0, block_count = 0;
+    for (uint32_t b = 0; b < program->block_count; ++b) block_map[b] = UINT32_MAX;
+    for (uint32_t head = 0; head < program->block_count; ++head) {
+        const IrBlock* block = &program->blocks[head];
+        if (block->unreachable || merged_into[head] != UINT32_MAX) continue;
+        for (uint32_t p = 0; p < block->param_count; ++p) {
+            value_map[program->operands[block->first_param + p]] = instr_count++;
+        }
+        for (uint32_t i = 0; head == 0 && i < program->constant_count; ++i) {
+            if (program->instrs[program->constants[i]].op != IR_NOP) value_map[program->constants[i]] = instr_count++;
+        }
+        for (uint32_t b = head; b != UINT32_MAX; b = next[b]) {
+            block = &program->blocks[b];
+            block_map[b] = block_count;
+            for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+                if (program->instrs[i].op != IR_NOP) value_map[i] = instr_count++;
+            }
+        }
+        block_count++;
+    }
+    for (uint32_t v = 0; v < program->instr_count; ++v) {
+        if (alias[v] != IR_NO_VALUE) value_map[v] = value_map[unalias(alias, v)];
+    }
+
+    uint32_t operand_count = 0, edge_count = 0;
+    instr_count = 0;
+    for (uint32_t head = 0; head < program->block_count; ++head) {
+        const IrBlock* block = &program->blocks[head];
+        if (block->unreachable || merged_into[head] != UINT32_MAX) continue;
+        uint32_t id = block_map[head];
+        IrBlock* out = &blocks[id];
+        out->first_param = operand_count;
+        out->param_count = block->param_count;
+        for (uint32_t p = 0; p < block->param_count; ++p) {
+            IrValue old = program->operands[block->first_param + p];
+            instrs[instr_count] = program->instrs[old];
+            instrs[instr_count].block = id;
+            instrs[instr_count].imm = p;
+            operands[operand_count++] = instr_count++;
+        }
+        out->first_instr = instr_count;
+        out->instr_count = 0;
+        for (uint32_t i = 0; head == 0 && i < program->constant_count; ++i) {
+            if (program->instrs[program->constants[i]].op == IR_NOP) continue;
+            instrs[instr_count] = program->instrs[program->constants[i]];
+            instrs[instr_count].block = 0;
+            instrs[instr_count++].first_operand = operand_count;
+            out->instr_count++;
+        }
+        uint32_t tail = head;
+        for (uint32_t b = head; b != UINT32_MAX; b = next[b]) {
+            tail = b;
+            block = &program->blocks[b];
+            for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+                const IrInstr* instr = &program->instrs[i];
+                if (instr->op == IR_NOP) continue;
+                IrInstr* copy = &instrs[instr_count++];
+                *copy = *instr;
+                copy->block = id;
+                copy->first_operand = operand_count;
+                for (uint32_t o = 0; o < instr->operand_count; ++o) {
+                    operands[operand_count++] = value_map[program->operands[instr->first_operand + o]];
+                }
+                out->instr_count++;
+            }
+        }
+        block = &program->blocks[tail];
+        out->term = block->term;
+        out->cond = block->cond != IR_NO_VALUE ? value_map[block->cond] : IR_NO_VALUE;
+        out->unreachable = false;
+        out->first_edge = edge_count;
+        out->edge_count = 0;
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+            const IrEdge* edge = &program->edges[e];
+            if (block_map[edge->target] == UINT32_MAX) continue;
+            IrEdge* copy = &edges[edge_count++];
+            *copy = *edge;
+            copy->target = block_map[edge->target];
+            copy->first_arg = operand_count;
+            for (uint32_t a = 0; a < edge->arg_count; ++a) {
+                operands[operand_count++] = value_map[program->operands[edge->first_arg + a]];
+            }
+            out->edge_count++;
+        }
+    }
+
+    free(program->instrs);
+    free(program->blocks);
+    free(program->edges);
+    free(program->operands);
+    program->instrs = instrs;
+    program->blocks = blocks;
+    program->edges = edges;
+    program->operands = operands;
+    program->instr_capacity = program->instr_count + 1;
+    program->block_capacity = program->block_count + 1;
+    program->edge_capacity = program->edge_count + 1;
+    program->operand_capacity = program->operand_count + 1;
+    program->instr_count = instr_count;
+    program->block_count = block_count;
+    program->edge_count = edge_count;
+    program->operand_count = operand_count;
+    program->constant_count = 0;
+    free(value_map);
+    free(alias);
+    free(block_map);
+    free(merged_into);
+    free(next);
+    return true;
+}
+
+
+// --- Traversal ---
+
+uint32_t ir_reverse_postorder(const IrProgram* program, uint32_t* order) {
+    uint32_t count = program->block_count;
+    if (count == 0) return 0;
+    uint32_t* stack = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint32_t* next_edge = (uint32_t*)calloc(count, sizeof(uint32_t));
+    bool* seen = (bool*)calloc(count, sizeof(bool));
+    if (!stack || !next_edge || !seen) {
+        free(stack);
+        free(next_edge);
+        free(seen);
+        return UINT32_MAX;
+    }
+    uint32_t top = 0, position = count;
+    stack[top++] = 0;
+    seen[0] = true;
+    while (top > 0) {
+        uint32_t b = stack[top - 1];
+        const IrBlock* block = &program->blocks[b];
+        if (next_edge[b] < block->edge_count) {
+            uint32_t target = program->edges[block->first_edge + next_edge[b]++].target;
+            if (!seen[target]) {
+                seen[target] = true;
+                stack[top++] = target;
+            }
+            continue;
+        }
+        order[--position] = b;
+        top--;
+    }
+    memmove(order, order + position, (count - position) * sizeof(uint32_t));
+    free(stack);
+    free(next_edge);
+    free(seen);
+    return count - position;
+}
+
+
+// --- Printing ---
+
+static void print_type(FILE* out, Type* type) {
+    char* text = type_to_string(type);
+    fputs(text ? text : "?", out);
+    free(text);
+}
+
+static void print_values(FILE* out, const IrValue* values, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) fprintf(out, "%sv%u", i ? ", " : "", values[i]);
+}
+
+static void print_edge(const IrProgram* program, FILE* out, const IrEdge* edge) {
+    fprintf(out, "b%u", edge->target);
+    if (edge->arg_count == 0) return;
+    fputc('(', out);
+    print_values(out, program->operands + edge->first_arg, edge->arg_count);
+    fputc(')', out);
+}
+
+// The variant's name, from the ADT type the instruction constructs or projects from.
+static void print_variant(const IrProgram* program, FILE* out, const IrInstr* instr) {
+    Type* adt = instr->op == IR_CONSTRUCT ? instr->type : program->instrs[ir_operands(program, instr)[0]].type;
+    if (adt && adt->kind == TYPE_REFERENCE) adt = ((TypeReference*)adt)->referent;
+    ADTDefinition* def = adt && adt->kind == TYPE_ADT && ((TypeADT*)adt)->adt_symbol
+                             ? ((TypeADT*)adt)->adt_symbol->data.adt_def
+                             : NULL;
+    ADTVariantSymbol* variant = def && instr->tag < da_count(def->variants)
+                                    ? (ADTVariantSymbol*)da_get(def->variants, instr->tag)
+                                    : NULL;
+    if (variant) fprintf(out, "%.*s", (int)variant->name.length, variant->name.lexeme);
+    else fprintf(out, "#%u", instr->tag);
+}
+
+static void print_instr(const IrProgram* program, FILE* out, IrValue value) {
+    const IrInstr* instr = &program->instrs[value];
+    const IrValue* operands = ir_operands(program, instr);
+    if (instr->op == IR_EXPORT) {
+        const IrGlobal* global = &program->globals[instr->imm];
+        fprintf(out, "  export %.*s = v%u\n", (int)global->name.length, global->name.lexeme, operands[0]);
+        return;
+    }
+    fprintf(out, "  v%u: ", value);
+    print_type(out, instr->type);
+    fputs(" = ", out);
+    switch ((IrOp)instr->op) {
+        case IR_CONST_INT: fprintf(out, "const %lld", (long long)instr->imm); break;
+        case IR_CONST_BOOL: fputs(instr->imm ? "const true" : "const false", out); break;
+        case IR_CONST_STRING: fprintf(out, "const \"%s\"", program->strings[instr->imm]); break;
+        case IR_UNDEF: fputs("undef", out); break;
+        case IR_CONSTRUCT:
+            fputs("construct ", out);
+            print_variant(program, out, instr);
+            fputc('(', out);
+            print_values(out, operands, instr->operand_count);
+            fputc(')', out);
+            break;
+        case IR_PROJECT:
+            fprintf(out, "project v%u.", operands[0]);
+            print_variant(program, out, instr);
+            fprintf(out, ".%lld", (long long)instr->imm);
+            break;
+        case IR_TAG: fprintf(out, "tag v%u", operands[0]); break;
+        case IR_EQ: fprintf(out, "eq v%u, v%u", operands[0], operands[1]); break;
+        case IR_BORROW: fprintf(out, "borrow%s v%u", instr->imm ? " mut" : "", operands[0]); break;
+        default: fputs("?", out); break;
+    }
+    fputc('\n', out);
+}
+
+void ir_print(const IrProgram* program, FILE* out) {
+    for (uint32_t b = 0; b < program->block_count; ++b) {
+        const IrBlock* block = &program->blocks[b];
+        if (block->unreachable) continue;
+        fprintf(out, "b%u", b);
+        if (block->param_count > 0) {
+            fputc('(', out);
+            for (uint32_t p = 0; p < block->param_count; ++p) {
+                IrValue param = program->operands[block->first_param + p];
+                fprintf(out, "%sv%u: ", p ? ", " : "", param);
+                print_type(out, program->instrs[param].type);
+            }
+            fputc(')', out);
+        }
+        fputs(":\n", out);
+        for (uint32_t i = 0; b == 0 && i < program->constant_count; ++i) {
+            if (program->instrs[program->constants[i]].op != IR_NOP) print_instr(program, out, program->constants[i]);
+        }
+        for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+            if (program->instrs[i].op != IR_NOP) print_instr(program, out, i);
+        }
+        const IrEdge* edges = program->edges + block->first_edge;
+        switch ((IrTermKind)block->term) {
+            case IR_TERM_JUMP:
+                fputs("  jump ", out);
+                print_edge(program, out, &edges[0]);
+                break;
+            case IR_TERM_BRANCH:
+                fprintf(out, "  branch v%u, ", block->cond);
+                print_edge(program, out, &edges[0]);
+                fputs(", ", out);
+                print_edge(program, out, &edges[1]);
+                break;
+            case IR_TERM_SWITCH:
+                fprintf(out, "  switch v%u [", block->cond);
+                for (uint32_t e = 0; e < block->edge_count; ++e) {
+                    if (e + 1 < block->edge_count) fprintf(out, "%s%lld: ", e ? ", " : "", (long long)edges[e].case_value);
+                    else fputs(e ? ", default: " : "default: ", out);
+                    print_edge(program, out, &edges[e]);
+                }
+                fputc(']', out);
+                break;
+            case IR_TERM_RETURN: fputs("  return", out); break;
+            case IR_TERM_UNREACHABLE: fputs("  unreachable", out); break;
+            case IR_TERM_NONE: fputs("  <no terminator>", out); break;
+        }
+        fputc('\n', out);
+    }
+}
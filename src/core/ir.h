@@ -0,0 +1,149 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h> // For FILE*
+#include "token.h"
+#include "types.h"
+
+// Typed SSA intermediate representation of an analyzed program.
+//
+// Every instruction defines one value, and a value's ID is its instruction's
+// index: instructions, blocks, successor edges and operand lists each live in
+// one growable array (an arena), addressed by dense 32-bit IDs, so passes keep
+// per-value state in flat arrays indexed by ID. Joins take block parameters
+// instead of phi instructions: an edge passes one argument per parameter of its
+// target.
+//
+// A block's instructions are contiguous in the instruction array, since a block
+// is filled in one go while lowering; its parameters are listed separately.
+// Passes delete by marking an instruction IR_NOP (and a block unreachable) and
+// ir_compact renumbers afterwards. The only instructions a pass adds are
+// constants (ir_add_constant), which ir_compact moves to the entry block.
+//
+// For now the only body is the program itself: its top-level `let`s, in order,
+// with a `match` lowered to tag switches and literal tests that branch to a
+// block per arm and rejoin in a block whose parameter is the match's value.
+// Each `let`'s value is made observable by an IR_EXPORT.
+
+typedef uint32_t IrValue;
+#define IR_NO_VALUE UINT32_MAX
+
+typedef enum {
+    IR_NOP,          // Deleted
+    IR_CONST_INT,    // `imm`
+    IR_CONST_BOOL,   // `imm` (0 or 1)
+    IR_CONST_STRING, // `imm`: index into IrProgram.strings
+    IR_UNDEF,        // Value of a `let` without an initializer
+    IR_PARAM,        // Block parameter number `imm` of block `block`
+    IR_CONSTRUCT,    // Variant `tag` of the ADT type `type`; operands are its fields
+    IR_PROJECT,      // Field `imm` of operand 0, known to be variant `tag`
+    IR_TAG,          // Variant tag of operand 0, as an i32
+    IR_EQ,           // Operand 0 == operand 1 (i32, bool or String), as a bool
+    IR_BORROW,       // `&` (imm 0) or `&mut` (imm 1) of operand 0
+    IR_EXPORT,       // Makes operand 0 the value of global `imm`; defines nothing
+} IrOp;
+
+typedef struct {
+    uint8_t op;             // IrOp
+    uint32_t block;
+    uint32_t tag;           // IR_CONSTRUCT / IR_PROJECT
+    int64_t imm;
+    uint32_t first_operand; // Operands are IrProgram.operands[first_operand, + operand_count)
+    uint32_t operand_count;
+    Type* type;             // Interned; void for IR_EXPORT
+} IrInstr;
+
+typedef enum {
+    IR_TERM_NONE,        // Not terminated yet
+    IR_TERM_JUMP,        // To edge 0
+    IR_TERM_BRANCH,      // On bool `cond`: edge 0 if true, edge 1 if false
+    IR_TERM_SWITCH,      // On i32 `cond`: the edge whose case equals it, else the last edge (the default)
+    IR_TERM_RETURN,      // End of the program
+    IR_TERM_UNREACHABLE, // Control never gets here (after the last arm of an exhaustive match)
+} IrTermKind;
+
+typedef struct {
+    uint32_t target;
+    int64_t case_value;  // IR_TERM_SWITCH, except for the default edge
+    uint32_t first_arg;  // Arguments for the target's parameters: operands[first_arg, + arg_count)
+    uint32_t arg_count;
+} IrEdge;
+
+typedef struct {
+    uint32_t first_instr; // Instructions [first_instr, first_instr + instr_count)
+    uint32_t instr_count;
+    uint32_t first_param; // Parameter values: operands[first_param, + param_count)
+    uint32_t param_count;
+    uint8_t term;         // IrTermKind
+    IrValue cond;         // IR_TERM_BRANCH / IR_TERM_SWITCH
+    uint32_t first_edge;  // Successors: edges[first_edge, + edge_count)
+    uint32_t edge_count;
+    bool unreachable;     // Deleted
+} IrBlock;
+
+typedef struct {
+    Token name;  // The `let`'s name
+    Type* type;
+} IrGlobal;
+
+typedef struct {
+    IrInstr* instrs;
+    uint32_t instr_count, instr_capacity;
+    IrBlock* blocks; // Block 0 is the entry
+    uint32_t block_count, block_capacity;
+    IrEdge* edges;
+    uint32_t edge_count, edge_capacity;
+    IrValue* operands; // Operand lists, edge arguments and block parameter lists
+    uint32_t operand_count, operand_capacity;
+    char** strings;    // String literals, without quotes; owned, deduplicated
+    uint32_t string_count, string_capacity;
+    uint32_t* string_slots; // Open-addressed string indices + 1, for deduplication
+    uint32_t string_slot_capacity;
+    IrGlobal* globals; // Indexed by IR_EXPORT's `imm`
+    uint32_t global_count, global_capacity;
+    IrValue* constants; // Added by passes, not in any block yet
+    uint32_t constant_count, constant_capacity;
+    bool out_of_memory;
+} IrProgram;
+
+IrProgram* ir_program_create(void);
+void ir_program_destroy(IrProgram* program);
+
+// --- Building ---
+// Builders return IR_NO_VALUE (or UINT32_MAX) and set out_of_memory on failure.
+
+uint32_t ir_add_block(IrProgram* program);
+IrValue ir_add_param(IrProgram* program, uint32_t block, Type* type);
+// Appends an instruction to `block`, which must be the last block instructions were added to or empty.
+IrValue ir_add_instr(IrProgram* program, uint32_t block, IrOp op, Type* type, const IrValue* operands,
+                     uint32_t operand_count);
+uint32_t ir_intern_string(IrProgram* program, const char* text, size_t length);
+uint32_t ir_add_global(IrProgram* program, Token name, Type* type);
+// A constant (IR_CONST_*) usable anywhere, for passes that fold values.
+IrValue ir_add_constant(IrProgram* program, IrOp op, Type* type, int64_t imm);
+
+// Terminators. Each edge is added after its block's terminator kind is set.
+void ir_set_terminator(IrProgram* program, uint32_t block, IrTermKind kind, IrValue cond);
+void ir_add_edge(IrProgram* program, uint32_t block, uint32_t target, int64_t case_value, const IrValue* args,
+                 uint32_t arg_count);
+
+static inline IrValue* ir_operands(const IrProgram* program, const IrInstr* instr) {
+    return program->operands + instr->first_operand;
+}
+
+// Removes IR_NOP instructions and unreachable blocks and merges each block into
+// its predecessor when that is its only one and jumps to it, renumbering values
+// and blocks densely in block order. Constants added by passes go first in block 0.
+bool ir_compact(IrProgram* program);
+
+// Writes the blocks reachable from the entry to `order` (room for block_count)
+// in reverse postorder, which puts every block before its successors since the
+// program has no loops. Returns how many there are, or UINT32_MAX if out of memory.
+uint32_t ir_reverse_postorder(const IrProgram* program, uint32_t* order);
+
+// Writes a readable listing, one instruction per line.
+void ir_print(const IrProgram* program, FILE* out);
+
+#endif // IR_H
@@ -0,0 +1,291 @@
+#include "ir_lower.h"
+#include "symbol_table.h"
+#include <stdlib.h>
+#include <string.h> // For memcpy
+
+typedef struct {
+    Symbol* symbol;
+    IrValue value;
+} LocalBinding;
+
+typedef struct {
+    IrProgram* ir;
+    uint32_t block;         // The block being filled
+    IrValue* global_values; // Per global slot: the value of the `let` declaring it
+    size_t global_count;
+    LocalBinding* locals;   // Pattern variables in scope, innermost last
+    size_t local_count, local_capacity;
+} Lowering;
+
+static IrValue lower_expr(Lowering* lowering, Expr* expr);
+
+static IrValue emit(Lowering* lowering, IrOp op, Type* type, const IrValue* operands, uint32_t operand_count) {
+    return ir_add_instr(lowering->ir, lowering->block, op, type, operands, operand_count);
+}
+
+static IrValue emit_imm(Lowering* lowering, IrOp op, Type* type, int64_t imm) {
+    IrValue value = emit(lowering, op, type, NULL, 0);
+    if (value != IR_NO_VALUE) lowering->ir->instrs[value].imm = imm;
+    return value;
+}
+
+static IrValue emit_project(Lowering* lowering, IrValue adt, uint32_t tag, size_t field, Type* type) {
+    IrValue value = emit(lowering, IR_PROJECT, type, &adt, 1);
+    if (value != IR_NO_VALUE) {
+        lowering->ir->instrs[value].tag = tag;
+        lowering->ir->instrs[value].imm = (int64_t)field;
+    }
+    return value;
+}
+
+static void jump(Lowering* lowering, uint32_t target, const IrValue* args, uint32_t arg_count) {
+    ir_set_terminator(lowering->ir, lowering->block, IR_TERM_JUMP, IR_NO_VALUE);
+    ir_add_edge(lowering->ir, lowering->block, target, 0, args, arg_count);
+}
+
+static Type* type_or_unknown(Type* type) {
+    return type ? type : type_unknown();
+}
+
+static bool push_local(Lowering* lowering, Symbol* symbol, IrValue value) {
+    if (lowering->local_count == lowering->local_capacity) {
+        size_t capacity = lowering->local_capacity ? lowering->local_capacity * 2 : 16;
+        LocalBinding* locals = (LocalBinding*)realloc(lowering->locals, capacity * sizeof(LocalBinding));
+        if (!locals) {
+            lowering->ir->out_of_memory = true;
+            return false;
+        }
+        lowering->locals = locals;
+        lowering->local_capacity = capacity;
+    }
+    lowering->locals[lowering->local_count++] = (LocalBinding){symbol, value};
+    return true;
+}
+
+static IrValue lookup(Lowering* lowering, Symbol* symbol, Type* type) {
+    if (symbol && symbol->depth == 0 && symbol->slot >= 0 && (size_t)symbol->slot < lowering->global_count &&
+        lowering->global_values[symbol->slot] != IR_NO_VALUE) {
+        return lowering->global_values[symbol->slot];
+    }
+    for (size_t i = lowering->local_count; i-- > 0;) {
+        if (lowering->locals[i].symbol == symbol) return lowering->locals[i].value;
+    }
+    return emit(lowering, IR_UNDEF, type_or_unknown(type), NULL, 0); // Not lowered (e.g. skimmed by lazy analysis)
+}
+
+static IrValue lower_literal(Lowering* lowering, Token literal, Type* type) {
+    switch (literal.type) {
+        case TOKEN_INTEGER: {
+            int32_t value;
+            if (!token_integer_value(literal, &value)) break; // Out of range: reported by the analyzer
+            return emit_imm(lowering, IR_CONST_INT, type, value);
+        }
+        case TOKEN_STRING: {
+            size_t length = literal.length >= 2 ? literal.length - 2 : 0;
+            uint32_t index = ir_intern_string(lowering->ir, literal.lexeme + 1, length);
+            return index == UINT32_MAX ? IR_NO_VALUE : emit_imm(lowering, IR_CONST_STRING, type, index);
+        }
+        case TOKEN_TRUE: return emit_imm(lowering, IR_CONST_BOOL, type, 1);
+        case TOKEN_FALSE: return emit_imm(lowering, IR_CONST_BOOL, type, 0);
+        default: break;
+    }
+    return emit(lowering, IR_UNDEF, type_or_unknown(type), NULL, 0);
+}
+
+// Whether the ADT of a constructor pattern has other variants, i.e. its tag must be tested.
+static bool has_other_variants(const Pattern* pattern) {
+    ADTDefinition* def = pattern->constructor_adt ? pattern->constructor_adt->data.adt_def : NULL;
+    return !def || da_count(def->variants) != 1;
+}
+
+static bool is_constructor_pattern(const Pattern* pattern) {
+    return pattern->kind == PATTERN_CONSTRUCTOR || (pattern->kind == PATTERN_BINDING && pattern->constructor_adt);
+}
+
+static bool is_irrefutable(const Pattern* pattern) {
+    if (pattern->kind == PATTERN_WILDCARD) return true;
+    if (pattern->kind == PATTERN_BINDING) return !pattern->constructor_adt;
+    if (pattern->kind != PATTERN_CONSTRUCTOR || has_other_variants(pattern)) return false;
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        if (!is_irrefutable((Pattern*)da_get(pattern->subpatterns, i))) return false;
+    }
+    return true;
+}
+
+static bool binds_variables(const Pattern* pattern) {
+    if (pattern->kind == PATTERN_BINDING) return !pattern->constructor_adt;
+    if (pattern->kind != PATTERN_CONSTRUCTOR) return false; // Or-patterns can't bind
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        if (binds_variables((Pattern*)da_get(pattern->subpatterns, i))) return true;
+    }
+    return false;
+}
+
+// Emits the test of `pattern` against `value` into the current block. Control
+// continues in a new current block if it matches, or goes to `fail`.
+static void lower_pattern_test(Lowering* lowering, Pattern* pattern, IrValue value, uint32_t fail) {
+    IrProgram* ir = lowering->ir;
+    if (ir->out_of_memory || is_irrefutable(pattern)) return;
+    if (is_constructor_pattern(pattern)) {
+        uint32_t tag = (uint32_t)pattern->constructor_tag;
+        if (has_other_variants(pattern)) {
+            IrValue tag_value = emit(lowering, IR_TAG, type_i32_instance, &value, 1);
+            uint32_t next = ir_add_block(ir);
+            ir_set_terminator(ir, lowering->block, IR_TERM_SWITCH, tag_value);
+            ir_add_edge(ir, lowering->block, next, tag, NULL, 0);
+            ir_add_edge(ir, lowering->block, fail, 0, NULL, 0);
+            lowering->block = next;
+        }
+        for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+            Pattern* sub = (Pattern*)da_get(pattern->subpatterns, i);
+            if (is_irrefutable(sub)) continue;
+            IrValue field = emit_project(lowering, value, tag, i, type_or_unknown(sub->inferred_type));
+            lower_pattern_test(lowering, sub, field, fail);
+        }
+        return;
+    }
+    if (pattern->kind == PATTERN_LITERAL) {
+        IrValue operands[2] = {value, lower_literal(lowering, pattern->token, type_or_unknown(pattern->inferred_type))};
+        IrValue equal = emit(lowering, IR_EQ, type_bool_instance, operands, 2);
+        uint32_t next = ir_add_block(ir);
+        ir_set_terminator(ir, lowering->block, IR_TERM_BRANCH, equal);
+        ir_add_edge(ir, lowering->block, next, 0, NULL, 0);
+        ir_add_edge(ir, lowering->block, fail, 0, NULL, 0);
+        lowering->block = next;
+        return;
+    }
+    if (pattern->kind == PATTERN_OR) {
+        uint32_t matched = ir_add_block(ir);
+        size_t count = da_count(pattern->subpatterns);
+        for (size_t i = 0; i < count && !ir->out_of_memory; ++i) {
+            uint32_t next = i + 1 < count ? ir_add_block(ir) : fail;
+            lower_pattern_test(lowering, (Pattern*)da_get(pattern->subpatterns, i), value, next);
+            jump(lowering, matched, NULL, 0);
+            lowering->block = next;
+        }
+        lowering->block = matched;
+    }
+}
+
+// Binds the variables of a pattern known to match `value`.
+static void bind_pattern(Lowering* lowering, Pattern* pattern, IrValue value) {
+    if (!binds_variables(pattern)) return;
+    if (pattern->kind == PATTERN_BINDING) {
+        push_local(lowering, pattern->symbol, value);
+        return;
+    }
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        Pattern* sub = (Pattern*)da_get(pattern->subpatterns, i);
+        if (!binds_variables(sub)) continue;
+        IrValue field = emit_project(lowering, value, (uint32_t)pattern->constructor_tag, i,
+                                     type_or_unknown(sub->inferred_type));
+        bind_pattern(lowering, sub, field);
+    }
+}
+
+static IrValue lower_match(Lowering* lowering, ExprMatch* match_expr) {
+    IrProgram* ir = lowering->ir;
+    IrValue scrutinee = lower_expr(lowering, match_expr->scrutinee);
+    uint32_t join = ir_add_block(ir);
+    size_t arm_count = da_count(match_expr->arms);
+    for (size_t i = 0; i < arm_count && !ir->out_of_memory; ++i) {
+        MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+        uint32_t next = ir_add_block(ir);
+        lower_pattern_test(lowering, arm->pattern, scrutinee, next);
+        size_t scope = lowering->local_count;
+        bind_pattern(lowering, arm->pattern, scrutinee);
+        IrValue result = lower_expr(lowering, arm->body);
+        lowering->local_count = scope;
+        jump(lowering, join, &result, 1);
+        lowering->block = next;
+    }
+    ir_set_terminator(ir, lowering->block, IR_TERM_UNREACHABLE, IR_NO_VALUE); // The match is exhaustive
+    lowering->block = join;
+    return ir_add_param(ir, join, type_or_unknown(match_expr->base.inferred_type));
+}
+
+static IrValue lower_expr(Lowering* lowering, Expr* expr) {
+    if (lowering->ir->out_of_memory) return IR_NO_VALUE;
+    Type* type = type_or_unknown(expr->inferred_type);
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            return lower_literal(lowering, ((ExprLiteral*)expr)->literal, type);
+        case EXPR_VARIABLE: {
+            ExprVariable* var_expr = (ExprVariable*)expr;
+            if (var_expr->constructor_adt) {
+                IrValue value = emit(lowering, IR_CONSTRUCT, type, NULL, 0);
+                if (value != IR_NO_VALUE) lowering->ir->instrs[value].tag = (uint32_t)var_expr->constructor_tag;
+                return value;
+            }
+            return lookup(lowering, var_expr->symbol, type);
+        }
+        case EXPR_CALL: {
+            ExprCall* call = (ExprCall*)expr;
+            size_t count = da_count(call->arguments);
+            if (!call->constructor_adt) return emit(lowering, IR_UNDEF, type, NULL, 0);
+            IrValue stack_args[8];
+            IrValue* args = count <= 8 ? stack_args : (IrValue*)malloc(count * sizeof(IrValue));
+            if (!args) {
+                lowering->ir->out_of_memory = true;
+                return IR_NO_VALUE;
+            }
+            for (size_t i = 0; i < count; ++i) args[i] = lower_expr(lowering, (Expr*)da_get(call->arguments, i));
+            IrValue value = emit(lowering, IR_CONSTRUCT, type, args, (uint32_t)count);
+            if (value != IR_NO_VALUE) lowering->ir->instrs[value].tag = (uint32_t)call->constructor_tag;
+            if (args != stack_args) free(args);
+            return value;
+        }
+        case EXPR_BORROW: {
+            ExprBorrow* borrow = (ExprBorrow*)expr;
+            IrValue operand = lower_expr(lowering, borrow->operand);
+            IrValue value = emit(lowering, IR_BORROW, type, &operand, 1);
+            if (value != IR_NO_VALUE) lowering->ir->instrs[value].imm = borrow->is_mutable;
+            return value;
+        }
+        case EXPR_MATCH:
+            return lower_match(lowering, (ExprMatch*)expr);
+        default:
+            return emit(lowering, IR_UNDEF, type, NULL, 0);
+    }
+}
+
+IrProgram* ir_lower_program(const Program* program) {
+    IrProgram* ir = ir_program_create();
+    if (!ir) return NULL;
+    Lowering lowering = {0};
+    lowering.ir = ir;
+    DynamicArray* statements = program->statements;
+    for (size_t i = 0; i < da_count(statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        Symbol* symbol = stmt->type == STMT_LET ? ((StmtLet*)stmt)->symbol : NULL;
+        if (symbol && symbol->depth == 0 && (size_t)symbol->slot + 1 > lowering.global_count) {
+            lowering.global_count = (size_t)symbol->slot + 1;
+        }
+    }
+    lowering.global_values = (IrValue*)malloc((lowering.global_count + 1) * sizeof(IrValue));
+    if (!lowering.global_values) ir->out_of_memory = true;
+    for (size_t i = 0; i < lowering.global_count && lowering.global_values; ++i) lowering.global_values[i] = IR_NO_VALUE;
+
+    lowering.block = ir_add_block(ir);
+    for (size_t i = 0; i < da_count(statements) && !ir->out_of_memory; ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type != STMT_LET) continue;
+        StmtLet* let = (StmtLet*)stmt;
+        Symbol* symbol = let->symbol;
+        if (!symbol || symbol->depth != 0 || (let->initializer && !let->initializer->inferred_type)) continue;
+        Type* type = type_or_unknown(symbol->type);
+        IrValue value = let->initializer ? lower_expr(&lowering, let->initializer) : emit(&lowering, IR_UNDEF, type, NULL, 0);
+        lowering.global_values[symbol->slot] = value;
+        uint32_t global = ir_add_global(ir, let->name, type);
+        IrValue exported = emit(&lowering, IR_EXPORT, type_void(), &value, 1);
+        if (exported != IR_NO_VALUE) ir->instrs[exported].imm = global;
+    }
+    if (!ir->out_of_memory) ir_set_terminator(ir, lowering.block, IR_TERM_RETURN, IR_NO_VALUE);
+    free(lowering.global_values);
+    free(lowering.locals);
+    if (ir->out_of_memory) {
+        ir_program_destroy(ir);
+        return NULL;
+    }
+    return ir;
+}
@@ -0,0 +1,23 @@
+#ifndef IR_LOWER_H
+#define IR_LOWER_H
+
+#include "ast.h"
+#include "ir.h"
+
+// Lowers an analyzed program (resolved, typed and checked without errors) to
+// SSA IR (ir.h).
+//
+// Each top-level `let` becomes the value of its initializer plus an IR_EXPORT.
+// A variable use is the value of the binding it was resolved to, so the IR has
+// no loads or stores. A `match` tests its arms in order: a constructor pattern
+// switches on the scrutinee's tag (skipped for single-variant ADTs), a literal
+// pattern compares with IR_EQ, and nested patterns test projected fields. The
+// first arm whose test passes binds its variables to projections and jumps to
+// the join block with its value; after the last arm, control is unreachable.
+// The tests are straightforward and repeat projections; ir_optimize cleans up.
+//
+// `let`s without an inferred type (the ones lazy analysis skimmed) are skipped.
+// Returns NULL if out of memory.
+IrProgram* ir_lower_program(const Program* program);
+
+#endif // IR_LOWER_H
@@ -0,0 +1,935 @@
+#include "ir_opt.h"
+#include "../util/hash.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h> // For memcmp, memset
+
+#define MAX_ROUNDS 4
+
+static bool is_pure(IrOp op) {
+    return op != IR_NOP && op != IR_PARAM && op != IR_EXPORT;
+}
+
+static bool is_constant(IrOp op) {
+    return op == IR_CONST_INT || op == IR_CONST_BOOL || op == IR_CONST_STRING;
+}
+
+static IrValue* edge_args(const IrProgram* program, const IrEdge* edge) {
+    return program->operands + edge->first_arg;
+}
+
+static IrValue block_param(const IrProgram* program, const IrBlock* block, uint32_t index) {
+    return program->operands[block->first_param + index];
+}
+
+// Follows a replacement chain to the value that stands for `value`.
+static IrValue resolve(const IrValue* replacement, IrValue value) {
+    while (replacement[value] != IR_NO_VALUE) value = replacement[value];
+    return value;
+}
+
+// Rewrites every operand, condition and edge argument of reachable blocks through `replacement`.
+static void apply_replacements(IrProgram* program, const IrValue* replacement) {
+    for (uint32_t b = 0; b < program->block_count; ++b) {
+        IrBlock* block = &program->blocks[b];
+        if (block->unreachable) continue;
+        for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+            IrInstr* instr = &program->instrs[i];
+            if (instr->op == IR_NOP) continue;
+            IrValue* operands = ir_operands(program, instr);
+            for (uint32_t o = 0; o < instr->operand_count; ++o) operands[o] = resolve(replacement, operands[o]);
+        }
+        if (block->cond != IR_NO_VALUE) block->cond = resolve(replacement, block->cond);
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+            IrEdge* edge = &program->edges[e];
+            IrValue* args = edge_args(program, edge);
+            for (uint32_t a = 0; a < edge->arg_count; ++a) args[a] = resolve(replacement, args[a]);
+        }
+    }
+}
+
+// A replacement per value, IR_NO_VALUE for none, with room for `extra` values added meanwhile.
+static IrValue* new_replacements(IrProgram* program, size_t extra) {
+    size_t count = (size_t)program->instr_count + extra + 1;
+    IrValue* replacement = (IrValue*)malloc(count * sizeof(IrValue));
+    if (!replacement) {
+        program->out_of_memory = true;
+        return NULL;
+    }
+    memset(replacement, 0xff, count * sizeof(IrValue)); // IR_NO_VALUE
+    return replacement;
+}
+
+
+// --- Predecessors ---
+
+// The incoming edges of each block, from reachable blocks only.
+typedef struct {
+    uint32_t* first;  // Block b's incoming edges are edges[first[b], first[b + 1])
+    uint32_t* edges;
+    uint32_t* source; // Per edge ID: the block it leaves, or UINT32_MAX if unused
+} Preds;
+
+static void preds_free(Preds* preds) {
+    free(preds->first);
+    free(preds->edges);
+    free(preds->source);
+}
+
+static bool preds_build(IrProgram* program, Preds* preds) {
+    uint32_t block_count = program->block_count, edge_count = program->edge_count;
+    preds->first = (uint32_t*)calloc((size_t)block_count + 2, sizeof(uint32_t));
+    preds->edges = (uint32_t*)malloc(((size_t)edge_count + 1) * sizeof(uint32_t));
+    preds->source = (uint32_t*)malloc(((size_t)edge_count + 1) * sizeof(uint32_t));
+    if (!preds->first || !preds->edges || !preds->source) {
+        preds_free(preds);
+        program->out_of_memory = true;
+        return false;
+    }
+    memset(preds->source, 0xff, ((size_t)edge_count + 1) * sizeof(uint32_t));
+    for (uint32_t b = 0; b < block_count; ++b) {
+        const IrBlock* block = &program->blocks[b];
+        if (block->unreachable) continue;
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+            preds->source[e] = b;
+            preds->first[program->edges[e].target + 2]++;
+        }
+    }
+    // Counts sit one slot ahead so the fill below leaves first[] as start offsets.
+    for (uint32_t b = 0; b < block_count; ++b) preds->first[b + 2] += preds->first[b + 1];
+    for (uint32_t e = 0; e < edge_count; ++e) {
+        if (preds->source[e] != UINT32_MAX) preds->edges[preds->first[program->edges[e].target + 1]++] = e;
+    }
+    return true;
+}
+
+static uint32_t pred_count(const Preds* preds, uint32_t block) {
+    return preds->first[block + 1] - preds->first[block];
+}
+
+// Marks blocks no longer reachable from the entry as unreachable. Returns how many.
+static size_t remove_unreachable_blocks(IrProgram* program) {
+    uint32_t* stack = (uint32_t*)malloc(((size_t)program->block_count + 1) * sizeof(uint32_t));
+    bool* seen = (bool*)calloc((size_t)program->block_count + 1, sizeof(bool));
+    if (!stack || !seen) {
+        free(stack);
+        free(seen);
+        program->out_of_memory = true;
+        return 0;
+    }
+    uint32_t top = 0;
+    stack[top++] = 0;
+    seen[0] = true;
+    while (top > 0) {
+        const IrBlock* block = &program->blocks[stack[--top]];
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+            uint32_t target = program->edges[e].target;
+            if (!seen[target]) {
+                seen[target] = true;
+                stack[top++] = target;
+            }
+        }
+    }
+    size_t removed = 0;
+    for (uint32_t b = 0; b < program->block_count; ++b) {
+        if (!seen[b] && !program->blocks[b].unreachable) {
+            program->blocks[b].unreachable = true;
+            removed++;
+        }
+    }
+    free(stack);
+    free(seen);
+    return removed;
+}
+
+
+// --- Sparse conditional constant propagation ---
+
+typedef enum {
+    LATTICE_TOP,     // No value seen yet
+    LATTICE_CONST,   // `op` and `value` of an IR_CONST_* instruction
+    LATTICE_VARIANT, // Variant `tag`; built by IR_CONSTRUCT `source` if that is the only one
+    LATTICE_BOTTOM,  // Unknown
+} LatticeKind;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t op;
+    uint32_t tag;
+    IrValue source;
+    int64_t value;
+} Lattice;
+
+typedef enum { USE_INSTR, USE_COND, USE_ARG } UseKind;
+
+typedef struct {
+    uint32_t id;    // Instruction, block (USE_COND) or edge (USE_ARG)
+    uint32_t index; // USE_ARG: argument index
+    uint8_t kind;
+} Use;
+
+typedef struct {
+    IrProgram* program;
+    Preds preds;
+    Lattice* lattice;
+    uint32_t* use_first; // Value v's uses are uses[use_first[v], use_first[v + 1])
+    Use* uses;
+    IrValue* watch_head; // Projections forwarded from a field, to revisit when the field changes
+    IrValue* watch_next;
+    bool* watching;
+    bool* edge_executable;
+    bool* block_executable;
+    uint32_t* block_stack;
+    uint32_t block_top;
+    IrValue* value_stack; // A value may be queued once per lattice change
+    size_t value_top, value_capacity;
+} Sccp;
+
+static const Lattice TOP = {LATTICE_TOP, 0, 0, IR_NO_VALUE, 0};
+static const Lattice BOTTOM = {LATTICE_BOTTOM, 0, 0, IR_NO_VALUE, 0};
+
+static Lattice lattice_const(IrOp op, int64_t value) {
+    Lattice lattice = {LATTICE_CONST, (uint8_t)op, 0, IR_NO_VALUE, value};
+    return lattice;
+}
+
+static bool lattice_equal(Lattice a, Lattice b) {
+    if (a.kind != b.kind) return false;
+    if (a.kind == LATTICE_CONST) return a.op == b.op && a.value == b.value;
+    if (a.kind == LATTICE_VARIANT) return a.tag == b.tag && a.source == b.source;
+    return true;
+}
+
+static Lattice lattice_meet(Lattice a, Lattice b) {
+    if (a.kind == LATTICE_TOP) return b;
+    if (b.kind == LATTICE_TOP) return a;
+    if (a.kind != b.kind || a.kind == LATTICE_BOTTOM) return BOTTOM;
+    if (a.kind == LATTICE_CONST) return lattice_equal(a, b) ? a : BOTTOM;
+    if (a.tag != b.tag) return BOTTOM;
+    if (a.source != b.source) a.source = IR_NO_VALUE;
+    return a;
+}
+
+static bool build_uses(Sccp* sccp) {
+    IrProgram* program = sccp->program;
+    uint32_t value_count = program->instr_count;
+    sccp->use_first = (uint32_t*)calloc((size_t)value_count + 2, sizeof(uint32_t));
+    if (!sccp->use_first) return false;
+    uint32_t* first = sccp->use_first;
+    // Two passes over the same uses: count, then fill.
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t b = 0; b < program->block_count; ++b) {
+            const IrBlock* block = &program->blocks[b];
+            if (block->unreachable) continue;
+            for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+                const IrInstr* instr = &program->instrs[i];
+                if (instr->op == IR_NOP) continue;
+                const IrValue* operands = ir_operands(program, instr);
+                for (uint32_t o = 0; o < instr->operand_count; ++o) {
+                    if (pass == 0) first[operands[o] + 2]++;
+                    else sccp->uses[first[operands[o] + 1]++] = (Use){i, 0, USE_INSTR};
+                }
+            }
+            if (block->cond != IR_NO_VALUE) {
+                if (pass == 0) first[block->cond + 2]++;
+                else sccp->uses[first[block->cond + 1]++] = (Use){b, 0, USE_COND};
+            }
+            for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+                const IrEdge* edge = &program->edges[e];
+                const IrValue* args = edge_args(program, edge);
+                for (uint32_t a = 0; a < edge->arg_count; ++a) {
+                    if (pass == 0) first[args[a] + 2]++;
+                    else sccp->uses[first[args[a] + 1]++] = (Use){e, a, USE_ARG};
+                }
+            }
+        }
+        if (pass == 0) {
+            for (uint32_t v = 0; v < value_count; ++v) first[v + 2] += first[v + 1];
+            sccp->uses = (Use*)malloc(((size_t)first[value_count + 1] + 1) * sizeof(Use));
+            if (!sccp->uses) return false;
+        }
+    }
+    return true;
+}
+
+static bool push_value(Sccp* sccp, IrValue value) {
+    if (sccp->value_top == sccp->value_capacity) {
+        size_t capacity = sccp->value_capacity ? sccp->value_capacity * 2 : 256;
+        IrValue* stack = (IrValue*)realloc(sccp->value_stack, capacity * sizeof(IrValue));
+        if (!stack) {
+            sccp->program->out_of_memory = true;
+            return false;
+        }
+        sccp->value_stack = stack;
+        sccp->value_capacity = capacity;
+    }
+    sccp->value_stack[sccp->value_top++] = value;
+    return true;
+}
+
+static void set_lattice(Sccp* sccp, IrValue value, Lattice lattice) {
+    // Meeting with the old value keeps every change a step down the lattice, so the solver terminates.
+    lattice = lattice_meet(sccp->lattice[value], lattice);
+    if (lattice_equal(sccp->lattice[value], lattice)) return;
+    sccp->lattice[value] = lattice;
+    push_value(sccp, value);
+}
+
+static Lattice eval_param(Sccp* sccp, IrValue param) {
+    const IrProgram* program = sccp->program;
+    const IrInstr* instr = &program->instrs[param];
+    Lattice result = TOP;
+    for (uint32_t p = sccp->preds.first[instr->block]; p < sccp->preds.first[instr->block + 1]; ++p) {
+        uint32_t e = sccp->preds.edges[p];
+        if (!sccp->edge_executable[e]) continue;
+        result = lattice_meet(result, sccp->lattice[edge_args(program, &program->edges[e])[instr->imm]]);
+    }
+    return result;
+}
+
+static Lattice eval_instr(Sccp* sccp, IrValue value) {
+    const IrProgram* program = sccp->program;
+    const IrInstr* instr = &program->instrs[value];
+    const IrValue* operands = ir_operands(program, instr);
+    switch ((IrOp)instr->op) {
+        case IR_CONST_INT:
+        case IR_CONST_BOOL:
+        case IR_CONST_STRING:
+            return lattice_const((IrOp)instr->op, instr->imm);
+        case IR_PARAM:
+            return eval_param(sccp, value);
+        case IR_CONSTRUCT: {
+            Lattice lattice = {LATTICE_VARIANT, 0, instr->tag, value, 0};
+            return lattice;
+        }
+        case IR_PROJECT: {
+            Lattice adt = sccp->lattice[operands[0]];
+            if (adt.kind == LATTICE_TOP) return TOP;
+            if (adt.kind != LATTICE_VARIANT) return BOTTOM;
+            if (adt.tag != instr->tag) return TOP; // Only on a path the tag test rules out
+            if (adt.source == IR_NO_VALUE) return BOTTOM;
+            IrValue field = ir_operands(program, &program->instrs[adt.source])[instr->imm];
+            if (!sccp->watching[value]) {
+                sccp->watching[value] = true;
+                sccp->watch_next[value] = sccp->watch_head[field];
+                sccp->watch_head[field] = value;
+            }
+            return sccp->lattice[field];
+        }
+        case IR_TAG: {
+            Lattice adt = sccp->lattice[operands[0]];
+            if (adt.kind == LATTICE_TOP) return TOP;
+            return adt.kind == LATTICE_VARIANT ? lattice_const(IR_CONST_INT, adt.tag) : BOTTOM;
+        }
+        case IR_EQ: {
+            Lattice a = sccp->lattice[operands[0]], b = sccp->lattice[operands[1]];
+            if (a.kind == LATTICE_TOP || b.kind == LATTICE_TOP) return TOP;
+            if (a.kind != LATTICE_CONST || b.kind != LATTICE_CONST) return BOTTOM;
+            return lattice_const(IR_CONST_BOOL, a.value == b.value);
+        }
+        default:
+            return BOTTOM;
+    }
+}
+
+static void mark_edge(Sccp* sccp, uint32_t e) {
+    if (sccp->edge_executable[e]) return;
+    sccp->edge_executable[e] = true;
+    uint32_t target = sccp->program->edges[e].target;
+    if (!sccp->block_executable[target]) {
+        sccp->block_executable[target] = true;
+        sccp->block_stack[sccp->block_top++] = target;
+        return;
+    }
+    // Already visited: only its parameters see the new edge.
+    const IrBlock* block = &sccp->program->blocks[target];
+    for (uint32_t p = 0; p < block->param_count; ++p) {
+        IrValue param = block_param(sccp->program, block, p);
+        set_lattice(sccp, param, eval_param(sccp, param));
+    }
+}
+
+static void visit_terminator(Sccp* sccp, uint32_t b) {
+    const IrBlock* block = &sccp->program->blocks[b];
+    if (block->term == IR_TERM_JUMP) {
+        mark_edge(sccp, block->first_edge);
+        return;
+    }
+    if (block->term != IR_TERM_BRANCH && block->term != IR_TERM_SWITCH) return;
+    Lattice cond = sccp->lattice[block->cond];
+    if (cond.kind == LATTICE_TOP) return;
+    if (cond.kind != LATTICE_CONST) {
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) mark_edge(sccp, e);
+        return;
+    }
+    if (block->term == IR_TERM_BRANCH) {
+        mark_edge(sccp, block->first_edge + (cond.value ? 0 : 1));
+        return;
+    }
+    uint32_t taken = block->first_edge + block->edge_count - 1; // The default
+    for (uint32_t e = block->first_edge; e + 1 < block->first_edge + block->edge_count; ++e) {
+        if (sccp->program->edges[e].case_value == cond.value) {
+            taken = e;
+            break;
+        }
+    }
+    mark_edge(sccp, taken);
+}
+
+static void visit_block(Sccp* sccp, uint32_t b) {
+    const IrBlock* block = &sccp->program->blocks[b];
+    for (uint32_t p = 0; p < block->param_count; ++p) {
+        IrValue param = block_param(sccp->program, block, p);
+        set_lattice(sccp, param, eval_param(sccp, param));
+    }
+    for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+        IrOp op = (IrOp)sccp->program->instrs[i].op;
+        if (op != IR_NOP && op != IR_EXPORT) set_lattice(sccp, i, eval_instr(sccp, i));
+    }
+    visit_terminator(sccp, b);
+}
+
+static void visit_uses(Sccp* sccp, IrValue value) {
+    const IrProgram* program = sccp->program;
+    for (uint32_t u = sccp->use_first[value]; u < sccp->use_first[value + 1]; ++u) {
+        Use use = sccp->uses[u];
+        if (use.kind == USE_INSTR) {
+            const IrInstr* instr = &program->instrs[use.id];
+            if (sccp->block_executable[instr->block] && instr->op != IR_EXPORT) {
+                set_lattice(sccp, use.id, eval_instr(sccp, use.id));
+            }
+        } else if (use.kind == USE_COND) {
+            if (sccp->block_executable[use.id]) visit_terminator(sccp, use.id);
+        } else if (sccp->edge_executable[use.id]) {
+            const IrBlock* target = &program->blocks[program->edges[use.id].target];
+            IrValue param = block_param(program, target, use.index);
+            set_lattice(sccp, param, eval_param(sccp, param));
+        }
+    }
+    for (IrValue watcher = sccp->watch_head[value]; watcher != IR_NO_VALUE; watcher = sccp->watch_next[watcher]) {
+        set_lattice(sccp, watcher, eval_instr(sccp, watcher));
+    }
+}
+
+// Replaces the values, branches and blocks the solution decided.
+static size_t sccp_rewrite(Sccp* sccp, IrOptStats* stats) {
+    IrProgram* program = sccp->program;
+    size_t param_count = 0; // Each may become a new constant
+    for (uint32_t b = 0; b < program->block_count; ++b) param_count += program->blocks[b].param_count;
+    IrValue* replacement = new_replacements(program, param_count);
+    if (!replacement) return 0;
+    size_t changes = 0;
+    for (uint32_t b = 0; b < program->block_count && !program->out_of_memory; ++b) {
+        IrBlock* block = &program->blocks[b];
+        if (block->unreachable) continue;
+        if (!sccp->block_executable[b]) {
+            block->unreachable = true;
+            stats->blocks_removed++;
+            changes++;
+            continue;
+        }
+        for (uint32_t p = 0; p < block->param_count; ++p) {
+            IrValue param = block_param(program, block, p);
+            Lattice lattice = sccp->lattice[param];
+            if (lattice.kind != LATTICE_CONST) continue;
+            // The parameter stays until ir_dce finds it unused.
+            replacement[param] = ir_add_constant(program, (IrOp)lattice.op, program->instrs[param].type, lattice.value);
+            if (replacement[param] == IR_NO_VALUE) break;
+            stats->constants_folded++;
+            changes++;
+        }
+        for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+            IrInstr* instr = &program->instrs[i];
+            if (instr->op == IR_NOP || instr->op == IR_EXPORT || is_constant((IrOp)instr->op)) continue;
+            Lattice lattice = sccp->lattice[i];
+            if (lattice.kind == LATTICE_CONST) {
+                instr->op = lattice.op;
+                instr->imm = lattice.value;
+                instr->tag = 0;
+                instr->operand_count = 0;
+                stats->constants_folded++;
+                changes++;
+                continue;
+            }
+            if (instr->op != IR_PROJECT) continue;
+            Lattice adt = sccp->lattice[ir_operands(program, instr)[0]];
+            if (adt.kind == LATTICE_VARIANT && adt.source != IR_NO_VALUE && adt.tag == instr->tag) {
+                replacement[i] = ir_operands(program, &program->instrs[adt.source])[instr->imm];
+                instr->op = IR_NOP;
+                stats->projections_forwarded++;
+                changes++;
+            }
+        }
+        if (block->term != IR_TERM_BRANCH && block->term != IR_TERM_SWITCH) continue;
+        Lattice cond = sccp->lattice[block->cond];
+        if (cond.kind == LATTICE_BOTTOM) continue;
+        uint32_t taken = UINT32_MAX;
+        for (uint32_t e = block->first_edge; e < block->first_edge + block->edge_count; ++e) {
+            if (sccp->edge_executable[e]) taken = e;
+        }
+        if (taken == UINT32_MAX) {
+            // The condition never gets a value, so control never gets past it.
+            block->term = IR_TERM_UNREACHABLE;
+            block->edge_count = 0;
+        } else {
+            block->term = IR_TERM_JUMP;
+            block->first_edge = taken;
+            block->edge_count = 1;
+        }
+        block->cond = IR_NO_VALUE;
+        stats->branches_folded++;
+        changes++;
+    }
+    if (!program->out_of_memory) apply_replacements(program, replacement);
+    free(replacement);
+    return changes;
+}
+
+size_t ir_sccp(IrProgram* program, IrOptStats* stats) {
+    if (program->out_of_memory || program->block_count == 0) return 0;
+    Sccp sccp = {0};
+    sccp.program = program;
+    size_t values = (size_t)program->instr_count + 1;
+    size_t blocks = (size_t)program->block_count + 1;
+    size_t changes = 0;
+    bool ok = preds_build(program, &sccp.preds);
+    if (ok) {
+        sccp.lattice = (Lattice*)malloc(values * sizeof(Lattice));
+        sccp.watch_head = (IrValue*)malloc(values * sizeof(IrValue));
+        sccp.watch_next = (IrValue*)malloc(values * sizeof(IrValue));
+        sccp.watching = (bool*)calloc(values, sizeof(bool));
+        sccp.edge_executable = (bool*)calloc((size_t)program->edge_count + 1, sizeof(bool));
+        sccp.block_executable = (bool*)calloc(blocks, sizeof(bool));
+        sccp.block_stack = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+        ok = sccp.lattice && sccp.watch_head && sccp.watch_next && sccp.watching && sccp.edge_executable &&
+             sccp.block_executable && sccp.block_stack && build_uses(&sccp);
+        if (!ok) program->out_of_memory = true;
+    }
+    if (ok) {
+        for (size_t v = 0; v < values; ++v) sccp.lattice[v] = TOP;
+        memset(sccp.watch_head, 0xff, values * sizeof(IrValue));
+        sccp.block_executable[0] = true;
+        sccp.block_stack[sccp.block_top++] = 0;
+        while ((sccp.block_top > 0 || sccp.value_top > 0) && !program->out_of_memory) {
+            if (sccp.block_top > 0) visit_block(&sccp, sccp.block_stack[--sccp.block_top]);
+            else visit_uses(&sccp, sccp.value_stack[--sccp.value_top]);
+        }
+        if (!program->out_of_memory) changes = sccp_rewrite(&sccp, stats);
+        preds_free(&sccp.preds);
+    }
+    free(sccp.lattice);
+    free(sccp.use_first);
+    free(sccp.uses);
+    free(sccp.watch_head);
+    free(sccp.watch_next);
+    free(sccp.watching);
+    free(sccp.edge_executable);
+    free(sccp.block_executable);
+    free(sccp.block_stack);
+    free(sccp.value_stack);
+    return changes;
+}
+
+
+// --- Global value numbering ---
+
+#define SLOT_EMPTY 0
+#define SLOT_REMOVED UINT32_MAX
+
+// Reverse postorder of the reachable blocks; returns how many there are.
+static uint32_t reverse_postorder(const IrProgram* program, uint32_t* order, uint32_t* stack, uint32_t* next_edge,
+                                  bool* seen) {
+    uint32_t count = program->block_count, top = 0, position = count;
+    stack[top++] = 0;
+    seen[0] = true;
+    next_edge[0] = 0;
+    while (top > 0) {
+        uint32_t b = stack[top - 1];
+        const IrBlock* block = &program->blocks[b];
+        if (next_edge[b] < block->edge_count) {
+            uint32_t target = program->edges[block->first_edge + next_edge[b]++].target;
+            if (!seen[target]) {
+                seen[target] = true;
+                next_edge[target] = 0;
+                stack[top++] = target;
+            }
+            continue;
+        }
+        order[--position] = b;
+        top--;
+    }
+    memmove(order, order + position, (count - position) * sizeof(uint32_t));
+    return count - position;
+}
+
+// Immediate dominators by the Cooper-Harvey-Kennedy iteration; idom[entry] == entry.
+static void compute_dominators(const Preds* preds, const uint32_t* order, uint32_t count, const uint32_t* rpo_index,
+                               uint32_t* idom) {
+    idom[order[0]] = order[0];
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t i = 1; i < count; ++i) {
+            uint32_t b = order[i], new_idom = UINT32_MAX;
+            for (uint32_t p = preds->first[b]; p < preds->first[b + 1]; ++p) {
+                uint32_t pred = preds->source[preds->edges[p]];
+                if (idom[pred] == UINT32_MAX) continue;
+                if (new_idom == UINT32_MAX) {
+                    new_idom = pred;
+                    continue;
+                }
+                uint32_t x = pred, y = new_idom;
+                while (x != y) {
+                    while (rpo_index[x] > rpo_index[y]) x = idom[x];
+                    while (rpo_index[y] > rpo_index[x]) y = idom[y];
+                }
+                new_idom = x;
+            }
+            if (new_idom != idom[b]) {
+                idom[b] = new_idom;
+                changed = true;
+            }
+        }
+    }
+}
+
+static uint32_t hash_instr(const IrProgram* program, const IrInstr* instr) {
+    uint32_t hash = hash_combine(instr->op, instr->tag);
+    hash = hash_combine(hash, (uint64_t)instr->imm);
+    hash = hash_combine(hash, (uint64_t)(uintptr_t)instr->type);
+    const IrValue* operands = ir_operands(program, instr);
+    for (uint32_t o = 0; o < instr->operand_count; ++o) hash = hash_combine(hash, operands[o]);
+    return hash;
+}
+
+static bool same_instr(const IrProgram* program, const IrInstr* a, const IrInstr* b) {
+    return a->op == b->op && a->tag == b->tag && a->imm == b->imm && a->type == b->type &&
+           a->operand_count == b->operand_count &&
+           memcmp(ir_operands(program, a), ir_operands(program, b), a->operand_count * sizeof(IrValue)) == 0;
+}
+
+typedef struct {
+    IrProgram* program;
+    const Preds* preds;
+    IrValue* replacement;
+    uint32_t* slots; // Values + 1 of the leaders in the dominator tree path being visited
+    uint32_t mask;
+    uint32_t* inserted; // Slots filled by the blocks on that path, undone when leaving them
+    uint32_t inserted_count;
+} Gvn;
+
+// A parameter that receives the same value on every edge is that value, which then dominates the block.
+static size_t number_params(Gvn* gvn, uint32_t b, IrOptStats* stats) {
+    IrProgram* program = gvn->program;
+    const IrBlock* block = &program->blocks[b];
+    size_t changes = 0;
+    for (uint32_t p = 0; p < block->param_count; ++p) {
+        IrValue param = block_param(program, block, p), same = IR_NO_VALUE;
+        bool unique = pred_count(gvn->preds, b) > 0;
+        for (uint32_t i = gvn->preds->first[b]; i < gvn->preds->first[b + 1] && unique; ++i) {
+            const IrEdge* edge = &program->edges[gvn->preds->edges[i]];
+            IrValue arg = resolve(gvn->replacement, edge_args(program, edge)[p]);
+            if (arg == param) continue;
+            if (same == IR_NO_VALUE) same = arg;
+            else unique = same == arg;
+        }
+        if (unique && same != IR_NO_VALUE) {
+            gvn->replacement[param] = same;
+            stats->values_numbered++;
+            changes++;
+        }
+    }
+    return changes;
+}
+
+static size_t number_block(Gvn* gvn, uint32_t b, IrOptStats* stats) {
+    IrProgram* program = gvn->program;
+    IrBlock* block = &program->blocks[b];
+    size_t changes = number_params(gvn, b, stats);
+    for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+        IrInstr* instr = &program->instrs[i];
+        if (instr->op == IR_NOP) continue;
+        IrValue* operands = ir_operands(program, instr);
+        for (uint32_t o = 0; o < instr->operand_count; ++o) operands[o] = resolve(gvn->replacement, operands[o]);
+        if (!is_pure((IrOp)instr->op) || instr->op == IR_UNDEF) continue;
+        uint32_t slot = hash_instr(program, instr) & gvn->mask;
+        bool found = false;
+        for (; gvn->slots[slot] != SLOT_EMPTY; slot = (slot + 1) & gvn->mask) {
+            uint32_t entry = gvn->slots[slot];
+            if (entry != SLOT_REMOVED && same_instr(program, &program->instrs[entry - 1], instr)) {
+                gvn->replacement[i] = entry - 1;
+                instr->op = IR_NOP;
+                stats->values_numbered++;
+                changes++;
+                found = true;
+                break;
+            }
+        }
+        if (found) continue;
+        gvn->slots[slot] = i + 1;
+        gvn->inserted[gvn->inserted_count++] = slot;
+    }
+    if (block->cond != IR_NO_VALUE) block->cond = resolve(gvn->replacement, block->cond);
+    return changes;
+}
+
+size_t ir_gvn(IrProgram* program, IrOptStats* stats) {
+    if (program->out_of_memory || program->block_count == 0) return 0;
+    size_t blocks = (size_t)program->block_count + 1;
+    uint32_t capacity = 64;
+    while (capacity < (uint64_t)program->instr_count * 2 + 2) capacity *= 2;
+    Preds preds = {0};
+    if (!preds_build(program, &preds)) return 0;
+    uint32_t* order = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    uint32_t* rpo_index = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    uint32_t* idom = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    uint32_t* stack = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    uint32_t* scratch = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    uint32_t* child_first = (uint32_t*)calloc(blocks + 1, sizeof(uint32_t));
+    uint32_t* children = (uint32_t*)malloc(blocks * sizeof(uint32_t));
+    uint32_t* scope = (uint32_t*)malloc(blocks * sizeof(uint32_t)); // inserted_count when a block was entered
+    bool* seen = (bool*)calloc(blocks, sizeof(bool));
+    Gvn gvn = {program, &preds, new_replacements(program, 0), (uint32_t*)calloc(capacity, sizeof(uint32_t)),
+               capacity - 1, (uint32_t*)malloc(((size_t)program->instr_count + 1) * sizeof(uint32_t)), 0};
+    size_t changes = 0;
+    if (!order || !rpo_index || !idom || !stack || !scratch || !child_first || !children || !scope || !seen ||
+        !gvn.replacement || !gvn.slots || !gvn.inserted) {
+        program->out_of_memory = true;
+        goto done;
+    }
+
+    uint32_t count = reverse_postorder(program, order, stack, scratch, seen);
+    for (uint32_t b = 0; b < program->block_count; ++b) {
+        idom[b] = UINT32_MAX;
+        rpo_index[b] = UINT32_MAX;
+    }
+    for (uint32_t i = 0; i < count; ++i) rpo_index[order[i]] = i;
+    compute_dominators(&preds, order, count, rpo_index, idom);
+
+    // Dominator tree children, in reverse postorder.
+    for (uint32_t i = 1; i < count; ++i) child_first[idom[order[i]] + 1]++;
+    for (uint32_t b = 0; b < program->block_count; ++b) child_first[b + 1] += child_first[b];
+    memcpy(scratch, child_first, program->block_count * sizeof(uint32_t));
+    for (uint32_t i = 1; i < count; ++i) children[scratch[idom[order[i]]]++] = order[i];
+
+    // Preorder walk of the dominator tree; a leader is visible in the subtree of its block.
+    uint32_t top = 0;
+    stack[top++] = 0;
+    scratch[0] = child_first[0];
+    scope[0] = 0;
+    changes += number_block(&gvn, 0, stats);
+    while (top > 0) {
+        uint32_t b = stack[top - 1];
+        if (scratch[b] < child_first[b + 1]) {
+            uint32_t child = children[scratch[b]++];
+            scope[child] = gvn.inserted_count;
+            scratch[child] = child_first[child];
+            stack[top++] = child;
+            changes += number_block(&gvn, child, stats);
+            continue;
+        }
+        while (gvn.inserted_count > scope[b]) gvn.slots[gvn.inserted[--gvn.inserted_count]] = SLOT_REMOVED;
+        top--;
+    }
+    apply_replacements(program, gvn.replacement);
+
+done:
+    preds_free(&preds);
+    free(order);
+    free(rpo_index);
+    free(idom);
+    free(stack);
+    free(scratch);
+    free(child_first);
+    free(children);
+    free(scope);
+    free(seen);
+    free(gvn.replacement);
+    free(gvn.slots);
+    free(gvn.inserted);
+    return changes;
+}
+
+
+// --- Dead code elimination ---
+
+static void mark_live(bool* live, IrValue* stack, uint32_t* top, IrValue value) {
+    if (live[value]) return;
+    live[value] = true;
+    stack[(*top)++] = value;
+}
+
+// Removes the parameters of `b` that are not live, and their arguments on every incoming edge.
+static size_t remove_dead_params(IrProgram* program, const Preds* preds, const bool* live, uint32_t b) {
+    IrBlock* block = &program->blocks[b];
+    IrValue* params = program->operands + block->first_param;
+    uint32_t kept = 0;
+    for (uint32_t p = 0; p < block->param_count; ++p) kept += live[params[p]];
+    if (kept == block->param_count) return 0;
+    for (uint32_t i = preds->first[b]; i < preds->first[b + 1]; ++i) {
+        IrEdge* edge = &program->edges[preds->edges[i]];
+        IrValue* args = edge_args(program, edge);
+        uint32_t arg_kept = 0;
+        for (uint32_t p = 0; p < edge->arg_count; ++p) {
+            if (live[params[p]]) args[arg_kept++] = args[p];
+        }
+        edge->arg_count = arg_kept;
+    }
+    kept = 0;
+    for (uint32_t p = 0; p < block->param_count; ++p) {
+        if (!live[params[p]]) {
+            program->instrs[params[p]].op = IR_NOP;
+            continue;
+        }
+        program->instrs[params[p]].imm = kept;
+        params[kept++] = params[p];
+    }
+    size_t removed = block->param_count - kept;
+    block->param_count = kept;
+    return removed;
+}
+
+static bool same_edge_targets(const IrProgram* program, const IrBlock* block) {
+    const IrEdge* first = &program->edges[block->first_edge];
+    for (uint32_t e = block->first_edge + 1; e < block->first_edge + block->edge_count; ++e) {
+        const IrEdge* edge = &program->edges[e];
+        if (edge->target != first->target || edge->arg_count != first->arg_count ||
+            memcmp(edge_args(program, edge), edge_args(program, first), edge->arg_count * sizeof(IrValue)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_empty_block(const IrProgram* program, const IrBlock* block) {
+    for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+        if (program->instrs[i].op != IR_NOP) return false;
+    }
+    return true;
+}
+
+// Folds branches whose edges all agree and sends edges into empty forwarding
+// blocks straight to their destination. Returns how many changes.
+static size_t simplify_cfg(IrProgram* program, const Preds* preds, IrOptStats* stats) {
+    size_t changes = 0;
+    for (uint32_t b = 0; b < program->block_count; ++b) {
+        IrBlock* block = &program->blocks[b];
+        if (block->unreachable || (block->term != IR_TERM_BRANCH && block->term != IR_TERM_SWITCH)) continue;
+        if (!same_edge_targets(program, block)) continue;
+        block->term = IR_TERM_JUMP;
+        block->cond = IR_NO_VALUE;
+        block->edge_count = 1;
+        stats->branches_folded++;
+        changes++;
+    }
+    for (uint32_t b = 1; b < program->block_count; ++b) {
+        IrBlock* block = &program->blocks[b];
+        if (block->unreachable || block->term != IR_TERM_JUMP || block->param_count > 0 || !is_empty_block(program, block)) {
+            continue;
+        }
+        const IrEdge* out = &program->edges[block->first_edge];
+        // Arguments are moved, not copied, so only a block with one incoming edge can pass them on.
+        if (out->target == b || (out->arg_count > 0 && pred_count(preds, b) != 1)) continue;
+        for (uint32_t i = preds->first[b]; i < preds->first[b + 1]; ++i) {
+            IrEdge* edge = &program->edges[preds->edges[i]];
+            if (edge->target != b) continue; // Already threaded
+            edge->target = out->target;
+            edge->first_arg = out->first_arg;
+            edge->arg_count = out->arg_count;
+            changes++;
+        }
+    }
+    return changes;
+}
+
+size_t ir_dce(IrProgram* program, IrOptStats* stats) {
+    if (program->out_of_memory || program->block_count == 0) return 0;
+    size_t values = (size_t)program->instr_count + 1;
+    bool* live = (bool*)malloc(values * sizeof(bool));
+    IrValue* stack = (IrValue*)malloc(values * sizeof(IrValue));
+    if (!live || !stack) {
+        free(live);
+        free(stack);
+        program->out_of_memory = true;
+        return 0;
+    }
+    size_t changes = 0;
+    for (int round = 0; round < MAX_ROUNDS * 4 && !program->out_of_memory; ++round) {
+        Preds preds = {0};
+        if (!preds_build(program, &preds)) break;
+        memset(live, 0, values * sizeof(bool));
+        uint32_t top = 0;
+        for (uint32_t b = 0; b < program->block_count; ++b) {
+            const IrBlock* block = &program->blocks[b];
+            if (block->unreachable) continue;
+            if (block->cond != IR_NO_VALUE) mark_live(live, stack, &top, block->cond);
+            for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+                if (program->instrs[i].op == IR_EXPORT) mark_live(live, stack, &top, i);
+            }
+        }
+        while (top > 0) {
+            IrValue value = stack[--top];
+            const IrInstr* instr = &program->instrs[value];
+            if (instr->op == IR_PARAM) {
+                for (uint32_t i = preds.first[instr->block]; i < preds.first[instr->block + 1]; ++i) {
+                    const IrEdge* edge = &program->edges[preds.edges[i]];
+                    mark_live(live, stack, &top, edge_args(program, edge)[instr->imm]);
+                }
+                continue;
+            }
+            const IrValue* operands = ir_operands(program, instr);
+            for (uint32_t o = 0; o < instr->operand_count; ++o) mark_live(live, stack, &top, operands[o]);
+        }
+
+        size_t round_changes = 0;
+        for (uint32_t b = 0; b < program->block_count; ++b) {
+            const IrBlock* block = &program->blocks[b];
+            if (block->unreachable) continue;
+            for (uint32_t i = block->first_instr; i < block->first_instr + block->instr_count; ++i) {
+                IrInstr* instr = &program->instrs[i];
+                if (is_pure((IrOp)instr->op) && !live[i]) {
+                    instr->op = IR_NOP;
+                    stats->instrs_removed++;
+                    round_changes++;
+                }
+            }
+            size_t removed = remove_dead_params(program, &preds, live, b);
+            stats->instrs_removed += removed;
+            round_changes += removed;
+        }
+        // Constants added since the last compaction are not in any block; they go when unused.
+        for (uint32_t c = 0; c < program->constant_count; ++c) {
+            IrInstr* instr = &program->instrs[program->constants[c]];
+            if (instr->op != IR_NOP && !live[program->constants[c]]) {
+                instr->op = IR_NOP;
+                stats->instrs_removed++;
+                round_changes++;
+            }
+        }
+        round_changes += simplify_cfg(program, &preds, stats);
+        preds_free(&preds);
+        size_t removed_blocks = remove_unreachable_blocks(program);
+        stats->blocks_removed += removed_blocks;
+        round_changes += removed_blocks;
+        changes += round_changes;
+        if (round_changes == 0) break;
+    }
+    free(live);
+    free(stack);
+    return changes;
+}
+
+
+// --- Pipeline ---
+
+bool ir_optimize(IrProgram* program, IrOptStats* stats) {
+    IrOptStats local = {0};
+    if (!stats) stats = &local;
+    for (int round = 0; round < MAX_ROUNDS && !program->out_of_memory; ++round) {
+        size_t changes = ir_sccp(program, stats);
+        changes += ir_gvn(program, stats);
+        changes += ir_dce(program, stats);
+        if (!ir_compact(program) || changes == 0) break;
+    }
+    return !program->out_of_memory;
+}
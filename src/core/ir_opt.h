@@ -0,0 +1,40 @@
+#ifndef IR_OPT_H
+#define IR_OPT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "ir.h"
+
+// Optimization passes over the SSA IR (ir.h).
+//
+// - ir_sccp: sparse conditional constant propagation. Besides constants, the
+//   lattice tracks the variant a value is known to be (and the IR_CONSTRUCT it
+//   came from), so a `match` on a known constructor folds its tag switch to a
+//   jump and its projections to the constructor's fields. Blocks it never
+//   reaches are deleted.
+// - ir_gvn: dominator-scoped global value numbering of pure instructions, and
+//   block parameters that receive the same value on every edge.
+// - ir_dce: removes instructions and block parameters nothing observable uses,
+//   then simplifies the CFG (switches whose edges agree, empty forwarding blocks).
+//
+// Each pass returns how many changes it made and adds them to `stats`; passes
+// leave deleted instructions and blocks in place until ir_compact.
+
+typedef struct {
+    size_t constants_folded;
+    size_t branches_folded;
+    size_t projections_forwarded;
+    size_t values_numbered; // Replaced by an equal dominating value
+    size_t instrs_removed;
+    size_t blocks_removed;
+} IrOptStats;
+
+size_t ir_sccp(IrProgram* program, IrOptStats* stats);
+size_t ir_gvn(IrProgram* program, IrOptStats* stats);
+size_t ir_dce(IrProgram* program, IrOptStats* stats);
+
+// Runs the passes to a fixed point (a few rounds at most) and compacts.
+// `stats` may be NULL. Returns false if out of memory.
+bool ir_optimize(IrProgram* program, IrOptStats* stats);
+
+#endif // IR_OPT_H
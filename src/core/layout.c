@@ -0,0 +1,368 @@
+#include "layout.h"
+#include "symbol_table.h"
+#include "type_caps.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define POINTER_SIZE 8u
+
+enum { LAYOUT_NONE = 0, LAYOUT_IN_PROGRESS = 1, LAYOUT_DONE = 2 };
+
+static uint32_t round_up(uint32_t value, uint32_t align) {
+    return align ? (value + align - 1) / align * align : value;
+}
+
+static uint32_t tag_size_for(size_t variant_count) {
+    if (variant_count <= 1) return 0;
+    if (variant_count <= 0x100) return 1;
+    if (variant_count <= 0x10000) return 2;
+    return 4;
+}
+
+static uint64_t scalar_values(uint32_t size) {
+    return size >= 8 ? UINT64_MAX : ((uint64_t)1 << (8 * size));
+}
+
+// Layout of a non-null pointer (references and boxed fields).
+static const TypeLayout pointer_layout = {POINTER_SIZE, POINTER_SIZE, 0, POINTER_SIZE, 0, 1};
+
+
+// --- Engine ---
+
+LayoutEngine* layout_engine_create(ADTInstanceCache* instances) {
+    LayoutEngine* engine = (LayoutEngine*)malloc(sizeof(LayoutEngine));
+    if (!engine) return NULL;
+    engine->instances = instances;
+    engine->by_type_id = NULL;
+    engine->state = NULL;
+    engine->capacity = 0;
+    pthread_mutex_init(&engine->lock, NULL);
+    return engine;
+}
+
+static void adt_layout_destroy(ADTLayout* layout) {
+    for (size_t i = 0; i < layout->variant_count; ++i) {
+        free(layout->variants[i].field_offsets);
+        free(layout->variants[i].field_boxed);
+    }
+    free(layout->variants);
+    free(layout);
+}
+
+void layout_engine_destroy(LayoutEngine* engine) {
+    if (!engine) return;
+    for (size_t i = 0; i < engine->capacity; ++i) {
+        if (!engine->by_type_id[i]) continue;
+        Type* type = type_by_id((uint32_t)i);
+        if (type && type->kind == TYPE_ADT) {
+            adt_layout_destroy((ADTLayout*)engine->by_type_id[i]);
+        } else {
+            free(engine->by_type_id[i]);
+        }
+    }
+    free(engine->by_type_id);
+    free(engine->state);
+    pthread_mutex_destroy(&engine->lock);
+    free(engine);
+}
+
+static bool ensure_capacity(LayoutEngine* engine, uint32_t id) {
+    if (id < engine->capacity) return true;
+    size_t new_capacity = engine->capacity ? engine->capacity : 64;
+    while (new_capacity <= id) new_capacity *= 2;
+    TypeLayout** layouts = (TypeLayout**)realloc(engine->by_type_id, new_capacity * sizeof(TypeLayout*));
+    if (!layouts) return false;
+    engine->by_type_id = layouts;
+    uint8_t* state = (uint8_t*)realloc(engine->state, new_capacity);
+    if (!state) return false;
+    engine->state = state;
+    for (size_t i = engine->capacity; i < new_capacity; ++i) {
+        engine->by_type_id[i] = NULL;
+        engine->state[i] = LAYOUT_NONE;
+    }
+    engine->capacity = new_capacity;
+    return true;
+}
+
+
+// --- Computation (engine->lock held) ---
+
+static const TypeLayout* compute(LayoutEngine* engine, Type* type);
+
+static TypeLayout* scalar_layout(uint32_t size, uint32_t align, uint32_t niche_size, uint64_t niche_start, uint64_t niche_count) {
+    TypeLayout* layout = (TypeLayout*)malloc(sizeof(TypeLayout));
+    if (!layout) return NULL;
+    *layout = (TypeLayout){size, align, 0, niche_size, niche_start, niche_count};
+    return layout;
+}
+
+// Lays out one variant's fields at `base_offset` (which must respect the
+// variant's alignment; callers pass 0 and shift afterwards). Returns false if a
+// field type has no layout.
+static bool layout_variant(LayoutEngine* engine, const ADTInstanceVariant* variant, VariantLayout* out, TypeLayout* niche) {
+    size_t count = variant->field_count;
+    out->field_count = count;
+    out->field_offsets = count ? (uint32_t*)calloc(count, sizeof(uint32_t)) : NULL;
+    out->field_boxed = count ? (bool*)calloc(count, sizeof(bool)) : NULL;
+    out->offset = 0;
+    out->size = 0;
+    out->align = 1;
+    memset(niche, 0, sizeof(*niche));
+    if (count && (!out->field_offsets || !out->field_boxed)) return false;
+
+    const TypeLayout** fields = count ? (const TypeLayout**)malloc(count * sizeof(TypeLayout*)) : NULL;
+    size_t* order = count ? (size_t*)malloc(count * sizeof(size_t)) : NULL;
+    if (count && (!fields || !order)) {
+        free(fields);
+        free(order);
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t f = 0; f < count && ok; ++f) {
+        Type* field_type = variant->field_types[f];
+        // Fields that close a recursive cycle (`Cons(A, List<A>)`) were chosen
+        // by the ADT graph and are stored behind a pointer.
+        if (((ADTFieldSymbol*)da_get(variant->variant->fields, f))->boxed) {
+            out->field_boxed[f] = true;
+            fields[f] = &pointer_layout;
+        } else {
+            fields[f] = compute(engine, field_type);
+            ok = fields[f] != NULL;
+        }
+        order[f] = f;
+    }
+
+    if (ok) {
+        // Decreasing alignment, ties in declaration order (insertion sort: variants are short).
+        for (size_t i = 1; i < count; ++i) {
+            size_t current = order[i];
+            size_t j = i;
+            while (j > 0 && fields[order[j - 1]]->align < fields[current]->align) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = current;
+        }
+        uint32_t offset = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const TypeLayout* field = fields[order[i]];
+            offset = round_up(offset, field->align);
+            out->field_offsets[order[i]] = offset;
+            if (field->niche_size && field->niche_count > niche->niche_count) {
+                *niche = *field;
+                niche->niche_offset = offset + field->niche_offset;
+            }
+            if (field->align > out->align) out->align = field->align;
+            offset += field->size;
+        }
+        out->size = round_up(offset, out->align);
+    }
+    free(fields);
+    free(order);
+    return ok;
+}
+
+static void shift_variant(VariantLayout* variant, uint32_t by) {
+    variant->offset += by;
+    for (size_t f = 0; f < variant->field_count; ++f) variant->field_offsets[f] += by;
+}
+
+static ADTLayout* compute_adt(LayoutEngine* engine, Type* type) {
+    const ADTInstance* instance = adt_instance_get(engine->instances, type);
+    if (!instance) return NULL;
+
+    ADTLayout* layout = (ADTLayout*)calloc(1, sizeof(ADTLayout));
+    if (!layout) return NULL;
+    size_t n = instance->variant_count;
+    layout->variant_count = n;
+    layout->variants = (VariantLayout*)calloc(n ? n : 1, sizeof(VariantLayout));
+    TypeLayout* niches = (TypeLayout*)calloc(n ? n : 1, sizeof(TypeLayout));
+    if (!layout->variants || !niches) {
+        free(niches);
+        free(layout->variants);
+        free(layout);
+        return NULL;
+    }
+    layout->dataful_variant = -1;
+
+    bool ok = true;
+    size_t dataful_count = 0;
+    for (size_t v = 0; v < n && ok; ++v) {
+        ok = layout_variant(engine, &instance->variants[v], &layout->variants[v], &niches[v]);
+        if (ok && layout->variants[v].size > 0) {
+            dataful_count++;
+            layout->dataful_variant = (int)v;
+        }
+    }
+    if (!ok) {
+        free(niches);
+        adt_layout_destroy(layout);
+        return NULL;
+    }
+
+    TypeLayout* base = &layout->base;
+    base->align = 1;
+    if (n == 0) {
+        layout->kind = ADT_LAYOUT_EMPTY;
+    } else if (dataful_count == 0) {
+        // Only empty variants: a plain small integer.
+        layout->kind = ADT_LAYOUT_ENUM;
+        layout->tag_size = tag_size_for(n);
+        base->size = base->align = layout->tag_size ? layout->tag_size : 1;
+        if (!layout->tag_size) base->size = 0;
+        if (layout->tag_size && scalar_values(layout->tag_size) > n) {
+            base->niche_size = layout->tag_size;
+            base->niche_start = n;
+            base->niche_count = scalar_values(layout->tag_size) - n;
+        }
+    } else if (n == 1) {
+        layout->kind = ADT_LAYOUT_STRUCT;
+        *base = niches[0];
+        base->size = layout->variants[0].size;
+        base->align = layout->variants[0].align;
+    } else if (dataful_count == 1 && niches[layout->dataful_variant].niche_count >= n - 1) {
+        // Every other variant fits in the dataful variant's unused values.
+        int d = layout->dataful_variant;
+        layout->kind = ADT_LAYOUT_NICHE;
+        *base = niches[d];
+        base->size = layout->variants[d].size;
+        base->align = layout->variants[d].align;
+        layout->niche_tag_start = niches[d].niche_start;
+        base->niche_start += n - 1;
+        base->niche_count -= n - 1;
+        if (base->niche_count == 0) base->niche_size = 0;
+    } else {
+        layout->kind = ADT_LAYOUT_TAGGED;
+        layout->tag_size = tag_size_for(n);
+        base->align = layout->tag_size;
+        uint32_t size = layout->tag_size;
+        for (size_t v = 0; v < n; ++v) {
+            VariantLayout* variant = &layout->variants[v];
+            shift_variant(variant, round_up(layout->tag_size, variant->align));
+            if (variant->offset + variant->size > size) size = variant->offset + variant->size;
+            if (variant->align > base->align) base->align = variant->align;
+        }
+        base->size = round_up(size, base->align);
+        base->niche_size = layout->tag_size;
+        base->niche_start = n;
+        base->niche_count = scalar_values(layout->tag_size) - n;
+    }
+    free(niches);
+    return layout;
+}
+
+static const TypeLayout* compute(LayoutEngine* engine, Type* type) {
+    if (!type || (type->flags & (TYPE_HAS_PARAMS | TYPE_HAS_VARS))) return NULL;
+    if (!ensure_capacity(engine, type->id)) return NULL;
+    if (engine->state[type->id] == LAYOUT_DONE) return engine->by_type_id[type->id];
+    if (engine->state[type->id] == LAYOUT_IN_PROGRESS) return NULL; // Unboxed cycle; the ADT graph boxes them all
+
+    engine->state[type->id] = LAYOUT_IN_PROGRESS;
+    TypeLayout* layout = NULL;
+    switch (type->kind) {
+        case TYPE_PRIMITIVE:
+            if (type == type_i32_instance) layout = scalar_layout(4, 4, 0, 0, 0);
+            else if (type == type_bool_instance) layout = scalar_layout(1, 1, 1, 2, 254);
+            else if (type == type_string_instance) layout = scalar_layout(3 * POINTER_SIZE, POINTER_SIZE, POINTER_SIZE, 0, 1);
+            break;
+        case TYPE_REFERENCE:
+            layout = scalar_layout(POINTER_SIZE, POINTER_SIZE, POINTER_SIZE, 0, 1);
+            break;
+        case TYPE_VOID:
+            layout = scalar_layout(0, 1, 0, 0, 0);
+            break;
+        case TYPE_ADT:
+            layout = (TypeLayout*)compute_adt(engine, type);
+            break;
+        default:
+            break;
+    }
+    // compute_adt may have grown the tables; index them again.
+    engine->by_type_id[type->id] = layout;
+    engine->state[type->id] = layout ? LAYOUT_DONE : LAYOUT_NONE;
+    return layout;
+}
+
+
+// --- Public API ---
+
+const TypeLayout* layout_of(LayoutEngine* engine, Type* type) {
+    if (!engine || !type) return NULL;
+    pthread_mutex_lock(&engine->lock);
+    const TypeLayout* layout = compute(engine, type);
+    pthread_mutex_unlock(&engine->lock);
+    return layout;
+}
+
+const ADTLayout* layout_of_adt(LayoutEngine* engine, Type* type) {
+    if (!type || type->kind != TYPE_ADT) return NULL;
+    return (const ADTLayout*)layout_of(engine, type);
+}
+
+static const char* kind_name(ADTLayoutKind kind) {
+    switch (kind) {
+        case ADT_LAYOUT_EMPTY: return "empty";
+        case ADT_LAYOUT_ENUM: return "enum";
+        case ADT_LAYOUT_STRUCT: return "struct";
+        case ADT_LAYOUT_NICHE: return "niche";
+        case ADT_LAYOUT_TAGGED: return "tagged";
+        default: return "?";
+    }
+}
+
+typedef struct {
+    char* name;
+    ADTInstance* instance;
+} NamedInstance;
+
+static int compare_named_instances(const void* a, const void* b) {
+    return strcmp(((const NamedInstance*)a)->name, ((const NamedInstance*)b)->name);
+}
+
+void layout_print_all(LayoutEngine* engine, FILE* stream) {
+    if (!engine || !engine->instances) return;
+    ADTInstanceCache* instances = engine->instances;
+    // Sorted by name: type ids follow interning order, which depends on how
+    // analysis was scheduled across threads.
+    NamedInstance* sorted = (NamedInstance*)malloc((instances->count ? instances->count : 1) * sizeof(NamedInstance));
+    if (!sorted) return;
+    size_t count = 0;
+    for (size_t i = 0; i < instances->capacity && count < instances->count; ++i) {
+        ADTInstance* instance = instances->by_type_id[i];
+        if (!instance) continue;
+        char* name = type_to_string(instance->type);
+        if (!name) continue;
+        sorted[count++] = (NamedInstance){name, instance};
+    }
+    qsort(sorted, count, sizeof(NamedInstance), compare_named_instances);
+    for (size_t i = 0; i < count; ++i) {
+        ADTInstance* instance = sorted[i].instance;
+        char* name = sorted[i].name;
+        const ADTLayout* layout = layout_of_adt(engine, instance->type);
+        if (!layout) {
+            fprintf(stream, "%s: no layout\n", name);
+            free(name);
+            continue;
+        }
+        fprintf(stream, "%s: size %u, align %u, %s", name, layout->base.size, layout->base.align,
+                kind_name(layout->kind));
+        if (layout->tag_size) fprintf(stream, ", %u-byte tag at %u", layout->tag_size, layout->tag_offset);
+        if (layout->kind == ADT_LAYOUT_NICHE) fprintf(stream, ", tags from %llu", (unsigned long long)layout->niche_tag_start);
+        char caps[64];
+        type_capabilities_describe(type_capabilities(instances, instance->type), caps, sizeof(caps));
+        fprintf(stream, ";%s\n", caps[0] ? caps : " move-only");
+        free(name);
+        for (size_t v = 0; v < layout->variant_count; ++v) {
+            const VariantLayout* variant = &layout->variants[v];
+            if (variant->field_count == 0) continue;
+            Token variant_name = instance->variants[v].variant->name;
+            fprintf(stream, "  %.*s:", (int)variant_name.length, variant_name.lexeme);
+            for (size_t f = 0; f < variant->field_count; ++f) {
+                fprintf(stream, " %u%s", variant->field_offsets[f], variant->field_boxed[f] ? " (boxed)" : "");
+            }
+            fprintf(stream, "\n");
+        }
+    }
+    free(sorted);
+}
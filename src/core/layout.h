@@ -0,0 +1,87 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>  // For FILE*
+#include <pthread.h>
+#include "types.h"
+#include "adt_instance.h"
+
+// Memory layout of concrete types for an LP64 target (x86-64 System V).
+//
+//   i32        4 bytes, align 4
+//   bool       1 byte, values 2..255 are a niche
+//   String     {ptr, len, cap}: 24 bytes, align 8, a null ptr is a niche
+//   &T, &mut T 8 bytes, align 8, null is a niche
+//   boxed field (closes a recursive cycle, see adt_graph.h): 8-byte non-null pointer, like &T
+//
+// A niche is a range of bit patterns a type never uses. An enum whose variants
+// are all empty but one stores its tag in the dataful variant's niche, so
+// Option<&T> and Option<bool> are the size of &T and bool. Each variant's fields
+// are laid out in decreasing alignment order to minimize padding; field
+// offsets are still reported in declaration order.
+
+typedef enum {
+    ADT_LAYOUT_EMPTY,     // No variants: uninhabited, zero-sized
+    ADT_LAYOUT_ENUM,      // All variants nullary: just the tag (u8/u16/u32; nothing for one variant)
+    ADT_LAYOUT_STRUCT,    // One variant with fields: no tag
+    ADT_LAYOUT_NICHE,     // One dataful variant; the others are encoded in its niche
+    ADT_LAYOUT_TAGGED,    // Explicit tag, then each variant's payload
+} ADTLayoutKind;
+
+typedef struct {
+    uint32_t size;
+    uint32_t align;
+    // Largest niche: `niche_count` unused values starting at `niche_start`, stored
+    // in the `niche_size`-byte little-endian scalar at `niche_offset`.
+    uint32_t niche_offset;
+    uint32_t niche_size;   // 0 if the type has no niche
+    uint64_t niche_start;
+    uint64_t niche_count;
+} TypeLayout;
+
+typedef struct {
+    uint32_t size;            // Payload size, starting at `offset`
+    uint32_t align;
+    uint32_t offset;          // Where the payload starts within the ADT value
+    uint32_t* field_offsets;  // Absolute offsets, in declaration order
+    bool* field_boxed;        // Whether each field is stored behind a pointer
+    size_t field_count;
+} VariantLayout;
+
+typedef struct {
+    TypeLayout base;
+    ADTLayoutKind kind;
+    uint32_t tag_offset;       // ENUM / TAGGED: where the tag lives
+    uint32_t tag_size;         // ENUM / TAGGED: 0, 1, 2 or 4 bytes
+    int dataful_variant;       // NICHE: the variant that stores data
+    uint64_t niche_tag_start;  // NICHE: niche value encoding the first other variant
+    VariantLayout* variants;   // In tag order
+    size_t variant_count;
+} ADTLayout;
+
+// Computes layouts on demand and caches them per interned type.
+// Thread-safe; layouts stay valid until the engine is destroyed.
+typedef struct {
+    ADTInstanceCache* instances; // Not owned; supplies substituted field types
+    TypeLayout** by_type_id;     // Indexed by Type.id
+    uint8_t* state;              // Per type id: 0 = not computed, 1 = in progress, 2 = done
+    size_t capacity;
+    pthread_mutex_t lock;
+} LayoutEngine;
+
+LayoutEngine* layout_engine_create(ADTInstanceCache* instances);
+void layout_engine_destroy(LayoutEngine* engine);
+
+// Returns the layout of a concrete type, or NULL if it has none (generic
+// parameters, inference variables, error types). ADT layouts are ADTLayout*.
+const TypeLayout* layout_of(LayoutEngine* engine, Type* type);
+
+// layout_of for ADT types, or NULL.
+const ADTLayout* layout_of_adt(LayoutEngine* engine, Type* type);
+
+// Prints one line per instantiated ADT in `instances`, with its capabilities (for -print-layouts).
+void layout_print_all(LayoutEngine* engine, FILE* stream);
+
+#endif // LAYOUT_H
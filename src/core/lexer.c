@@ -1,10 +1,9 @@
 #include "lexer.h"
-#include "token.h" // For token_create, token_error_create, TokenType
+#include "token.h" // For token_create, TokenType
 #include <string.h> // For strncmp, strlen, memcmp
 #include <ctype.h>  // For isalpha, isdigit, isalnum
 #include <stdlib.h> // For NULL, malloc, free, realloc
 #include <stdbool.h>
-#include <stdio.h>  // For snprintf
 
 
 // Helper to check if a character is at the end of the source
@@ -50,10 +49,11 @@ static void add_token(Lexer *lexer, TokenType type, const char *lexeme, size_t l
     da_push(lexer->tokens, (void*)memcpy(malloc(sizeof(Token)), &token, sizeof(Token))); // Store a copy
 }
 
-static void add_error_token(Lexer *lexer, const char *message) {
-    // Error token's lexeme is the message itself.
-    Token error_token = token_error_create(message, lexer->line, lexer->col);
-     da_push(lexer->tokens, (void*)memcpy(malloc(sizeof(Token)), &error_token, sizeof(Token)));
+// An error token spans the offending text; the message goes to the diagnostics sink.
+static void add_error_token(Lexer *lexer, const char *start, size_t length, const char *message) {
+    Token error_token = token_create(TOKEN_ERROR, start, length, lexer->line, lexer->col - (int)length);
+    diagnostics_report(lexer->diagnostics, DIAG_LEXICAL, error_token, message);
+    da_push(lexer->tokens, (void*)memcpy(malloc(sizeof(Token)), &error_token, sizeof(Token)));
 }
 
 
@@ -115,7 +115,7 @@ static void scan_string(Lexer *lexer) {
     }
 
     if (is_at_end(lexer)) {
-        add_error_token(lexer, "Unterminated string.");
+        add_error_token(lexer, start, lexer->current - start, "Unterminated string.");
         return;
     }
 
@@ -159,13 +159,18 @@ static void scan_identifier_or_keyword(Lexer *lexer) {
     // Keyword checking (simple approach)
     // A more efficient way would be a hash map or a trie for keywords.
     switch (start[0]) {
+        case 'c': if (length == 5 && memcmp(start, "class", 5) == 0) type = TOKEN_CLASS; break;
         case 'd': if (length == 4 && memcmp(start, "data", 4) == 0) type = TOKEN_DATA; break;
         case 'e': if (length == 4 && memcmp(start, "else", 4) == 0) type = TOKEN_ELSE; break;
         case 'f':
             if (length == 2 && memcmp(start, "fn", 2) == 0) type = TOKEN_FN;
             else if (length == 5 && memcmp(start, "false", 5) == 0) type = TOKEN_FALSE;
+            else if (length == 3 && memcmp(start, "for", 3) == 0) type = TOKEN_FOR;
+            break;
+        case 'i':
+            if (length == 2 && memcmp(start, "if", 2) == 0) type = TOKEN_IF;
+            else if (length == 8 && memcmp(start, "instance", 8) == 0) type = TOKEN_INSTANCE;
             break;
-        case 'i': if (length == 2 && memcmp(start, "if", 2) == 0) type = TOKEN_IF; break;
         case 'l': if (length == 3 && memcmp(start, "let", 3) == 0) type = TOKEN_LET; break;
         case 'm':
             if (length == 5 && memcmp(start, "match", 5) == 0) type = TOKEN_MATCH;
@@ -276,11 +281,7 @@ static void scan_token(Lexer *lexer) {
             break;
 
         default:
-            {
-                char msg_buf[64];
-                snprintf(msg_buf, sizeof(msg_buf), "Unexpected character: '%c'", c);
-                add_error_token(lexer, msg_buf); // This message needs to be managed carefully if not static
-            }
+            add_error_token(lexer, token_start_lexeme, 1, "Unexpected character.");
             break;
     }
 }
@@ -294,6 +295,7 @@ Lexer* lexer_create(const char *source) {
     lexer->current = source;
     lexer->line = 1;
     lexer->col = 1;
+    lexer->diagnostics = NULL;
     // Using item_size = sizeof(Token) for the dynamic array, as we will store copies of Tokens.
     lexer->tokens = da_create(16, sizeof(Token));
     if (!lexer->tokens) {
@@ -335,11 +337,8 @@ bool lexer_scan_tokens(Lexer *lexer) {
         if (lexer->current == lexer->source && !is_at_end(lexer) && peek(lexer) != '\0') {
              // This case should ideally not happen if skip_whitespace and token scanning always advance.
              // If it does, it means no progress is being made.
-            char c = peek(lexer);
-            char msg_buf[100];
-            snprintf(msg_buf, sizeof(msg_buf), "Lexer stuck at char '%c' (ASCII %d) at line %d, col %d. Advancing.", c, c, lexer->line, lexer->col);
-            add_error_token(lexer, msg_buf); // This message needs careful memory management
             advance(lexer); // Force advance
+            add_error_token(lexer, lexer->current - 1, 1, "Lexer made no progress; skipping this character.");
             had_error = true;
         }
     }
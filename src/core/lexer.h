@@ -3,6 +3,7 @@
 
 #include <stdbool.h> // For bool type
 #include "token.h"
+#include "diagnostics.h"
 #include "../util/dynamic_array.h" // To store tokens
 
 // Lexer structure
@@ -12,6 +13,7 @@ typedef struct {
     int line;           // Current line number
     int col;            // Current column number (approximate, start of token)
     DynamicArray *tokens; // Dynamic array to store scanned tokens
+    Diagnostics *diagnostics; // Not owned; errors are recorded here instead of printed when set
     // Potentially add a filename field for error reporting
     // const char* filename;
 } Lexer;
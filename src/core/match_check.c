@@ -0,0 +1,670 @@
+#include "match_check.h"
+#include "symbol_table.h"
+#include "types.h"
+#include "../util/array.h"
+#include "../util/hash.h"
+#include "../util/string_builder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // For memcmp
+
+// --- Checker State ---
+
+typedef enum {
+    PAT_WILD,    // `_` or a variable
+    PAT_CTOR,    // A variant applied to field patterns
+    PAT_LITERAL, // Only `false` and `true` form a complete signature
+    PAT_OR,      // Alternatives
+} PatKind;
+
+// A hash-consed pattern: equal patterns share one index.
+typedef struct {
+    PatKind kind;
+    const Symbol* adt; // PAT_CTOR
+    int tag;           // PAT_CTOR
+    Token literal;     // PAT_LITERAL
+    uint32_t first;    // PAT_CTOR fields / PAT_OR alternatives: children[first, first + count)
+    uint32_t count;
+} Pat;
+
+// A hash-consed cons cell: a row is a list of patterns (index 0 is the empty
+// row), a matrix is a list of rows (index 0 is the empty matrix).
+typedef struct {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t length;
+} Cell;
+
+typedef struct {
+    uint32_t matrix;
+    uint32_t row;
+    bool useful;
+} Memo;
+
+// Open addressing over entry indices, with each entry's hash kept alongside so
+// growing never rehashes an entry.
+typedef struct {
+    uint32_t* slots;  // Entry index + 1, or 0 for an empty slot
+    uint32_t* hashes;
+    size_t capacity;  // Power of two
+    size_t count;
+} IdTable;
+
+typedef struct {
+    Cell* cells;
+    size_t count, capacity;
+    IdTable ids;
+} ConsList;
+
+typedef struct {
+    Pat* pats;
+    size_t pat_count, pat_capacity;
+    uint32_t* children;
+    size_t child_count, child_capacity;
+    IdTable pat_ids;
+    ConsList rows;
+    ConsList matrices;
+    Memo* memos;
+    size_t memo_count, memo_capacity;
+    IdTable memo_ids;
+    uint32_t* scratch; // Stack of pattern / row indices being assembled
+    size_t scratch_count, scratch_capacity;
+    Diagnostics* diagnostics;
+    bool had_error;
+    bool out_of_memory;
+} Checker;
+
+#define WILD 0u      // Pattern index of `_`
+#define EMPTY 0u     // Index of the empty row and of the empty matrix
+#define NOT_FOUND UINT32_MAX
+
+static void match_error(Checker* checker, Token token, const char* message) {
+    checker->had_error = true;
+    diagnostics_report(checker->diagnostics, DIAG_MATCH, token, message);
+}
+
+static bool push_scratch(Checker* checker, uint32_t value) {
+    if (!array_reserve((void**)&checker->scratch, &checker->scratch_capacity, checker->scratch_count + 1, sizeof(uint32_t))) {
+        checker->out_of_memory = true;
+        return false;
+    }
+    checker->scratch[checker->scratch_count++] = value;
+    return true;
+}
+
+
+// --- Hash-Consing ---
+
+typedef bool (*SameFn)(const Checker* checker, uint32_t index, const void* key);
+
+// Returns the slot holding the entry `same` accepts, or the empty slot where it would go.
+static size_t id_table_probe(const IdTable* table, uint32_t hash, SameFn same, const Checker* checker, const void* key) {
+    size_t mask = table->capacity - 1;
+    size_t i = hash & mask;
+    while (table->slots[i] && !(table->hashes[i] == hash && same(checker, table->slots[i] - 1, key))) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static bool id_table_grow(IdTable* table) {
+    size_t capacity = table->capacity ? table->capacity * 2 : 256;
+    uint32_t* slots = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    uint32_t* hashes = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    if (!slots || !hashes) {
+        free(slots);
+        free(hashes);
+        return false;
+    }
+    for (size_t i = 0; i < table->capacity; ++i) {
+        if (!table->slots[i]) continue;
+        size_t j = table->hashes[i] & (capacity - 1);
+        while (slots[j]) j = (j + 1) & (capacity - 1);
+        slots[j] = table->slots[i];
+        hashes[j] = table->hashes[i];
+    }
+    free(table->slots);
+    free(table->hashes);
+    table->slots = slots;
+    table->hashes = hashes;
+    table->capacity = capacity;
+    return true;
+}
+
+// Finds the entry `same` accepts, or NOT_FOUND; *slot receives where to insert it.
+static uint32_t id_table_find(Checker* checker, IdTable* table, uint32_t hash, SameFn same, const void* key, size_t* slot) {
+    if ((table->count + 1) * 2 > table->capacity && !id_table_grow(table)) {
+        checker->out_of_memory = true;
+        return NOT_FOUND;
+    }
+    *slot = id_table_probe(table, hash, same, checker, key);
+    return table->slots[*slot] ? table->slots[*slot] - 1 : NOT_FOUND;
+}
+
+static void id_table_insert(IdTable* table, size_t slot, uint32_t hash, uint32_t index) {
+    table->slots[slot] = index + 1;
+    table->hashes[slot] = hash;
+    table->count++;
+}
+
+static void id_table_free(IdTable* table) {
+    free(table->slots);
+    free(table->hashes);
+}
+
+static bool same_pat(const Checker* checker, uint32_t index, const void* key) {
+    const Pat* a = &checker->pats[index];
+    const Pat* b = (const Pat*)key; // b->first indexes the scratch stack
+    if (a->kind != b->kind || a->adt != b->adt || a->tag != b->tag || a->count != b->count) return false;
+    if (a->kind == PAT_LITERAL && (a->literal.type != b->literal.type || a->literal.length != b->literal.length ||
+                                   memcmp(a->literal.lexeme, b->literal.lexeme, a->literal.length) != 0)) {
+        return false;
+    }
+    return a->count == 0 || memcmp(&checker->children[a->first], &checker->scratch[b->first],
+                                   a->count * sizeof(uint32_t)) == 0;
+}
+
+// Interns a pattern whose children are the top `count` entries of the scratch
+// stack, and pops them.
+static uint32_t intern_pat(Checker* checker, PatKind kind, const Symbol* adt, int tag, Token literal, uint32_t count) {
+    uint32_t first = (uint32_t)(checker->scratch_count - count);
+    Pat key = {kind, adt, tag, literal, first, count};
+    uint32_t hash = hash_combine(hash_combine(0, kind), (uint64_t)(uintptr_t)adt ^ ((uint64_t)(uint32_t)tag << 32));
+    if (kind == PAT_LITERAL) hash = hash_combine(hash, hash_bytes(literal.lexeme, literal.length));
+    for (uint32_t i = 0; i < count; ++i) hash = hash_combine(hash, checker->scratch[first + i]);
+
+    size_t slot;
+    uint32_t index = id_table_find(checker, &checker->pat_ids, hash, same_pat, &key, &slot);
+    if (index == NOT_FOUND && !checker->out_of_memory) {
+        bool ok = array_reserve((void**)&checker->pats, &checker->pat_capacity, checker->pat_count + 1, sizeof(Pat));
+        for (uint32_t i = 0; ok && i < count; ++i) {
+            ok = array_reserve((void**)&checker->children, &checker->child_capacity, checker->child_count + 1, sizeof(uint32_t));
+            if (ok) checker->children[checker->child_count++] = checker->scratch[first + i];
+        }
+        if (ok) {
+            index = (uint32_t)checker->pat_count++;
+            key.first = (uint32_t)(checker->child_count - count);
+            checker->pats[index] = key;
+            id_table_insert(&checker->pat_ids, slot, hash, index);
+        } else {
+            checker->out_of_memory = true;
+        }
+    }
+    checker->scratch_count = first;
+    return index == NOT_FOUND ? WILD : index;
+}
+
+typedef struct {
+    const ConsList* list;
+    uint32_t head, tail;
+} CellKey;
+
+static bool same_cons(const Checker* checker, uint32_t index, const void* key) {
+    (void)checker;
+    const CellKey* k = (const CellKey*)key;
+    return k->list->cells[index].head == k->head && k->list->cells[index].tail == k->tail;
+}
+
+static uint32_t cons(Checker* checker, ConsList* list, uint32_t head, uint32_t tail) {
+    CellKey key = {list, head, tail};
+    uint32_t hash = hash_combine(hash_combine(0, head), tail);
+    size_t slot;
+    uint32_t index = id_table_find(checker, &list->ids, hash, same_cons, &key, &slot);
+    if (index != NOT_FOUND || checker->out_of_memory) return index == NOT_FOUND ? EMPTY : index;
+    if (!array_reserve((void**)&list->cells, &list->capacity, list->count + 1, sizeof(Cell))) {
+        checker->out_of_memory = true;
+        return EMPTY;
+    }
+    index = (uint32_t)list->count++;
+    list->cells[index] = (Cell){head, tail, list->cells[tail].length + 1};
+    id_table_insert(&list->ids, slot, hash, index);
+    return index;
+}
+
+static uint32_t wildcards(Checker* checker, uint32_t count, uint32_t tail) {
+    for (uint32_t i = 0; i < count; ++i) tail = cons(checker, &checker->rows, WILD, tail);
+    return tail;
+}
+
+// Builds a matrix from the rows on the scratch stack above `mark`, in order, and pops them.
+static uint32_t matrix_from_scratch(Checker* checker, size_t mark) {
+    uint32_t matrix = EMPTY;
+    for (size_t i = checker->scratch_count; i-- > mark;) {
+        matrix = cons(checker, &checker->matrices, checker->scratch[i], matrix);
+    }
+    checker->scratch_count = mark;
+    return matrix;
+}
+
+
+// --- Usefulness ---
+
+static uint32_t arity_of(const Symbol* adt, int tag) {
+    ADTDefinition* def = adt->data.adt_def;
+    ADTVariantSymbol* variant = def ? (ADTVariantSymbol*)da_get(def->variants, (size_t)tag) : NULL;
+    return variant ? (uint32_t)da_count(variant->fields) : 0;
+}
+
+static size_t variant_count(const Symbol* adt) {
+    return adt->data.adt_def ? da_count(adt->data.adt_def->variants) : 0;
+}
+
+// Pushes the rows `row` becomes when its first column is specialized by the
+// constructor or literal `key` (which has `arity` fields).
+static void specialize_row(Checker* checker, uint32_t row, const Pat* key, uint32_t arity) {
+    Cell cell = checker->rows.cells[row];
+    Pat head = checker->pats[cell.head];
+    switch (head.kind) {
+        case PAT_WILD:
+            push_scratch(checker, wildcards(checker, arity, cell.tail));
+            break;
+        case PAT_OR:
+            for (uint32_t i = 0; i < head.count; ++i) {
+                uint32_t alternative = checker->children[head.first + i];
+                specialize_row(checker, cons(checker, &checker->rows, alternative, cell.tail), key, arity);
+            }
+            break;
+        case PAT_CTOR: {
+            if (key->kind != PAT_CTOR || head.adt != key->adt || head.tag != key->tag) break;
+            // Fields beyond the variant's arity were reported by the analyzer.
+            uint32_t result = cell.tail;
+            for (uint32_t i = arity; i-- > 0;) {
+                uint32_t field = i < head.count ? checker->children[head.first + i] : WILD;
+                result = cons(checker, &checker->rows, field, result);
+            }
+            push_scratch(checker, result);
+            break;
+        }
+        case PAT_LITERAL:
+            if (key->kind == PAT_LITERAL && checker->pats[cell.head].literal.length == key->literal.length &&
+                memcmp(head.literal.lexeme, key->literal.lexeme, key->literal.length) == 0) {
+                push_scratch(checker, cell.tail);
+            }
+            break;
+    }
+}
+
+static uint32_t specialize(Checker* checker, uint32_t matrix, const Pat* key, uint32_t arity) {
+    size_t mark = checker->scratch_count;
+    for (uint32_t m = matrix; m != EMPTY; m = checker->matrices.cells[m].tail) {
+        specialize_row(checker, checker->matrices.cells[m].head, key, arity);
+    }
+    return matrix_from_scratch(checker, mark);
+}
+
+// Pushes the rest of `row` if its first column matches anything.
+static void default_row(Checker* checker, uint32_t row) {
+    Cell cell = checker->rows.cells[row];
+    Pat head = checker->pats[cell.head];
+    if (head.kind == PAT_WILD) {
+        push_scratch(checker, cell.tail);
+    } else if (head.kind == PAT_OR) {
+        for (uint32_t i = 0; i < head.count; ++i) {
+            default_row(checker, cons(checker, &checker->rows, checker->children[head.first + i], cell.tail));
+        }
+    }
+}
+
+static uint32_t default_matrix(Checker* checker, uint32_t matrix) {
+    size_t mark = checker->scratch_count;
+    for (uint32_t m = matrix; m != EMPTY; m = checker->matrices.cells[m].tail) {
+        default_row(checker, checker->matrices.cells[m].head);
+    }
+    return matrix_from_scratch(checker, mark);
+}
+
+// The constructors in a matrix's first column.
+typedef struct {
+    const Symbol* adt;  // ADT of the first constructor found (NULL if none)
+    bool boolean;       // Or the column holds `false` and `true`, constructors 0 and 1 of bool
+    bool complete;      // Every constructor appears
+    int missing_tag;    // Some constructor that does not (-1 if complete or none found)
+} Signature;
+
+static bool is_bool_literal(Token literal) {
+    return literal.type == TOKEN_TRUE || literal.type == TOKEN_FALSE;
+}
+
+static size_t signature_size(const Signature* sig) {
+    return sig->boolean ? 2 : sig->adt ? variant_count(sig->adt) : 0;
+}
+
+static uint32_t signature_arity(const Signature* sig, int tag) {
+    return sig->boolean ? 0 : arity_of(sig->adt, tag);
+}
+
+// The key specialize() takes for constructor `tag` of the signature.
+static Pat signature_ctor(const Signature* sig, int tag) {
+    if (!sig->boolean) return (Pat){PAT_CTOR, sig->adt, tag, {0}, 0, 0};
+    Token literal = {.type = tag ? TOKEN_TRUE : TOKEN_FALSE, .lexeme = tag ? "true" : "false", .length = tag ? 4 : 5};
+    return (Pat){PAT_LITERAL, NULL, -1, literal, 0, 0};
+}
+
+static void mark_head(Checker* checker, uint32_t pat, Signature* sig, bool* seen) {
+    Pat head = checker->pats[pat];
+    if (head.kind == PAT_OR) {
+        for (uint32_t i = 0; i < head.count; ++i) mark_head(checker, checker->children[head.first + i], sig, seen);
+    } else if (head.kind == PAT_CTOR && !sig->boolean && (!sig->adt || head.adt == sig->adt)) {
+        if (!sig->adt) sig->adt = head.adt;
+        if (seen && (size_t)head.tag < variant_count(head.adt)) seen[head.tag] = true;
+    } else if (head.kind == PAT_LITERAL && !sig->adt && is_bool_literal(head.literal)) {
+        sig->boolean = true;
+        if (seen) seen[head.literal.type == TOKEN_TRUE] = true;
+    }
+}
+
+static Signature column_signature(Checker* checker, uint32_t matrix) {
+    Signature sig = {NULL, false, false, -1};
+    for (uint32_t m = matrix; m != EMPTY && !sig.adt && !sig.boolean; m = checker->matrices.cells[m].tail) {
+        mark_head(checker, checker->rows.cells[checker->matrices.cells[m].head].head, &sig, NULL);
+    }
+    if (!sig.adt && !sig.boolean) return sig;
+    size_t count = signature_size(&sig);
+    bool stack_seen[64] = {false};
+    bool* seen = count <= 64 ? stack_seen : (bool*)calloc(count, sizeof(bool));
+    if (!seen) {
+        checker->out_of_memory = true;
+        return sig;
+    }
+    for (uint32_t m = matrix; m != EMPTY; m = checker->matrices.cells[m].tail) {
+        mark_head(checker, checker->rows.cells[checker->matrices.cells[m].head].head, &sig, seen);
+    }
+    sig.complete = true;
+    for (size_t t = 0; t < count && sig.complete; ++t) {
+        if (!seen[t]) {
+            sig.complete = false;
+            sig.missing_tag = (int)t;
+        }
+    }
+    if (seen != stack_seen) free(seen);
+    return sig;
+}
+
+static bool same_memo(const Checker* checker, uint32_t index, const void* key) {
+    const Memo* k = (const Memo*)key;
+    return checker->memos[index].matrix == k->matrix && checker->memos[index].row == k->row;
+}
+
+// Whether some value matches `row` but no row of `matrix`.
+static bool useful(Checker* checker, uint32_t matrix, uint32_t row) {
+    if (checker->out_of_memory) return true;
+    if (row == EMPTY) return matrix == EMPTY;
+    Memo key = {matrix, row, false};
+    uint32_t hash = hash_combine(hash_combine(0, matrix), row);
+    size_t slot;
+    uint32_t index = id_table_find(checker, &checker->memo_ids, hash, same_memo, &key, &slot);
+    if (index != NOT_FOUND) return checker->memos[index].useful;
+    if (checker->out_of_memory) return true;
+
+    Cell cell = checker->rows.cells[row];
+    Pat head = checker->pats[cell.head];
+    bool result = false;
+    switch (head.kind) {
+        case PAT_OR:
+            for (uint32_t i = 0; i < head.count && !result; ++i) {
+                uint32_t alternative = checker->children[head.first + i];
+                result = useful(checker, matrix, cons(checker, &checker->rows, alternative, cell.tail));
+            }
+            break;
+        case PAT_CTOR:
+        case PAT_LITERAL: {
+            uint32_t arity = head.kind == PAT_CTOR ? arity_of(head.adt, head.tag) : 0;
+            size_t mark = checker->scratch_count;
+            specialize_row(checker, row, &head, arity);
+            // The row specializes to exactly one row (its own fields).
+            uint32_t specialized = checker->scratch_count > mark ? checker->scratch[mark] : EMPTY;
+            checker->scratch_count = mark;
+            result = useful(checker, specialize(checker, matrix, &head, arity), specialized);
+            break;
+        }
+        case PAT_WILD: {
+            Signature sig = column_signature(checker, matrix);
+            if (!sig.complete) {
+                result = useful(checker, default_matrix(checker, matrix), cell.tail);
+                break;
+            }
+            size_t count = signature_size(&sig);
+            for (size_t t = 0; t < count && !result; ++t) {
+                Pat ctor = signature_ctor(&sig, (int)t);
+                uint32_t arity = signature_arity(&sig, (int)t);
+                result = useful(checker, specialize(checker, matrix, &ctor, arity), wildcards(checker, arity, cell.tail));
+            }
+            break;
+        }
+    }
+
+    // The table may have grown during the recursion.
+    index = id_table_find(checker, &checker->memo_ids, hash, same_memo, &key, &slot);
+    if (index == NOT_FOUND && !checker->out_of_memory) {
+        if (array_reserve((void**)&checker->memos, &checker->memo_capacity, checker->memo_count + 1, sizeof(Memo))) {
+            checker->memos[checker->memo_count] = (Memo){matrix, row, result};
+            id_table_insert(&checker->memo_ids, slot, hash, (uint32_t)checker->memo_count++);
+        } else {
+            checker->out_of_memory = true;
+        }
+    }
+    return result;
+}
+
+
+// --- Missing Patterns ---
+
+// Returns a row of `width` patterns matched by no row of `matrix`, which must
+// make the all-wildcard row useful. Follows the same case split as useful().
+static uint32_t witness(Checker* checker, uint32_t matrix, uint32_t width) {
+    if (width == 0 || checker->out_of_memory) return EMPTY;
+    Signature sig = column_signature(checker, matrix);
+    if (!sig.complete) {
+        uint32_t rest = witness(checker, default_matrix(checker, matrix), width - 1);
+        if (!sig.adt && !sig.boolean) return cons(checker, &checker->rows, WILD, rest);
+        Pat ctor = signature_ctor(&sig, sig.missing_tag);
+        uint32_t arity = signature_arity(&sig, sig.missing_tag);
+        for (uint32_t i = 0; i < arity; ++i) push_scratch(checker, WILD);
+        uint32_t head = intern_pat(checker, ctor.kind, ctor.adt, ctor.tag, ctor.literal, arity);
+        return cons(checker, &checker->rows, head, rest);
+    }
+    size_t count = signature_size(&sig);
+    for (size_t t = 0; t < count; ++t) {
+        Pat ctor = signature_ctor(&sig, (int)t);
+        uint32_t arity = signature_arity(&sig, (int)t);
+        uint32_t specialized = specialize(checker, matrix, &ctor, arity);
+        if (!useful(checker, specialized, wildcards(checker, width - 1 + arity, EMPTY))) continue;
+        // The first `arity` patterns of the sub-witness are the fields.
+        uint32_t rest = witness(checker, specialized, width - 1 + arity);
+        for (uint32_t i = 0; i < arity; ++i) {
+            push_scratch(checker, checker->rows.cells[rest].head);
+            rest = checker->rows.cells[rest].tail;
+        }
+        uint32_t head = intern_pat(checker, ctor.kind, ctor.adt, ctor.tag, ctor.literal, arity);
+        return cons(checker, &checker->rows, head, rest);
+    }
+    return EMPTY;
+}
+
+static void print_pat(const Checker* checker, uint32_t pat, StringBuilder* out) {
+    const Pat* p = &checker->pats[pat];
+    switch (p->kind) {
+        case PAT_CTOR: {
+            ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(p->adt->data.adt_def->variants, (size_t)p->tag);
+            sb_appendf(out, "%.*s", (int)variant->name.length, variant->name.lexeme);
+            if (p->count == 0) break;
+            sb_append_str(out, "(");
+            for (uint32_t i = 0; i < p->count; ++i) {
+                if (i > 0) sb_append_str(out, ", ");
+                print_pat(checker, checker->children[p->first + i], out);
+            }
+            sb_append_str(out, ")");
+            break;
+        }
+        case PAT_LITERAL:
+            sb_appendf(out, "%.*s", (int)p->literal.length, p->literal.lexeme);
+            break;
+        default:
+            sb_append_str(out, "_");
+            break;
+    }
+}
+
+
+// --- Checking ---
+
+// Interns an AST pattern. Sets *unresolved for a constructor the resolver
+// could not find.
+static uint32_t lower_pattern(Checker* checker, const Pattern* pattern, bool* unresolved) {
+    if (!pattern) return WILD;
+    switch (pattern->kind) {
+        case PATTERN_BINDING:
+            if (!pattern->constructor_adt) return WILD;
+            return intern_pat(checker, PAT_CTOR, pattern->constructor_adt, pattern->constructor_tag, (Token){0}, 0);
+        case PATTERN_LITERAL:
+            return intern_pat(checker, PAT_LITERAL, NULL, -1, pattern->token, 0);
+        case PATTERN_CONSTRUCTOR:
+        case PATTERN_OR: {
+            if (pattern->kind == PATTERN_CONSTRUCTOR && !pattern->constructor_adt) *unresolved = true;
+            uint32_t count = (uint32_t)da_count(pattern->subpatterns);
+            for (uint32_t i = 0; i < count; ++i) {
+                push_scratch(checker, lower_pattern(checker, (Pattern*)da_get(pattern->subpatterns, i), unresolved));
+            }
+            if (pattern->kind == PATTERN_OR) return intern_pat(checker, PAT_OR, NULL, -1, (Token){0}, count);
+            return intern_pat(checker, PAT_CTOR, pattern->constructor_adt, pattern->constructor_tag, (Token){0}, count);
+        }
+        default:
+            return WILD;
+    }
+}
+
+static void check_match(Checker* checker, ExprMatch* match_expr) {
+    size_t arm_count = da_count(match_expr->arms);
+    size_t mark = checker->scratch_count;
+    bool unresolved = false;
+    for (size_t i = 0; i < arm_count; ++i) {
+        MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+        push_scratch(checker, lower_pattern(checker, arm->pattern, &unresolved));
+    }
+    if (unresolved || checker->out_of_memory) { // Already reported
+        checker->scratch_count = mark;
+        return;
+    }
+
+    // Arms above the current one, newest first; each arm adds one cell.
+    uint32_t above = EMPTY;
+    for (size_t i = 0; i < arm_count && !checker->out_of_memory; ++i) {
+        MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+        Pat pat = checker->pats[checker->scratch[mark + i]];
+        // Alternatives at the top of an arm are checked one by one.
+        uint32_t alternatives = pat.kind == PAT_OR ? pat.count : 1;
+        bool reachable = false;
+        size_t unreachable_alternatives = 0;
+        for (uint32_t a = 0; a < alternatives; ++a) {
+            uint32_t alternative = pat.kind == PAT_OR ? checker->children[pat.first + a] : checker->scratch[mark + i];
+            uint32_t row = cons(checker, &checker->rows, alternative, EMPTY);
+            if (useful(checker, above, row)) {
+                reachable = true;
+            } else {
+                unreachable_alternatives++;
+            }
+            above = cons(checker, &checker->matrices, row, above);
+        }
+        if (checker->out_of_memory) break;
+        if (!reachable) {
+            match_error(checker, arm->pattern->kind == PATTERN_OR
+                                     ? ((Pattern*)da_get(arm->pattern->subpatterns, 0))->token : arm->pattern->token,
+                        "Unreachable match arm: every value it matches is matched by an earlier arm.");
+        } else if (unreachable_alternatives > 0) {
+            // Report each redundant alternative at its own position.
+            uint32_t prefix = above;
+            for (uint32_t a = 0; a < alternatives; ++a) prefix = checker->matrices.cells[prefix].tail;
+            for (uint32_t a = 0; a < alternatives; ++a) {
+                uint32_t row = cons(checker, &checker->rows, checker->children[pat.first + a], EMPTY);
+                if (!useful(checker, prefix, row)) {
+                    match_error(checker, ((Pattern*)da_get(arm->pattern->subpatterns, a))->token,
+                                "Unreachable pattern: every value it matches is matched earlier.");
+                }
+                prefix = cons(checker, &checker->matrices, row, prefix);
+            }
+        }
+    }
+    checker->scratch_count = mark;
+
+    uint32_t any = cons(checker, &checker->rows, WILD, EMPTY);
+    if (checker->out_of_memory || !useful(checker, above, any)) return;
+    Type* scrutinee = match_expr->scrutinee ? match_expr->scrutinee->inferred_type : NULL;
+    if (arm_count == 0 && scrutinee && scrutinee->kind == TYPE_ADT &&
+        variant_count(((TypeADT*)scrutinee)->adt_symbol) == 0) {
+        return; // An ADT without variants has no values to match
+    }
+    uint32_t missing = witness(checker, above, 1);
+    StringBuilder* message = sb_create(64);
+    if (!message || checker->out_of_memory) {
+        sb_destroy(message);
+        return;
+    }
+    sb_append_str(message, "Non-exhaustive match: pattern '");
+    print_pat(checker, checker->rows.cells[missing].head, message);
+    sb_append_str(message, "' is not covered.");
+    match_error(checker, match_expr->keyword, sb_get_str(message));
+    sb_destroy(message);
+}
+
+// Checks nested matches first (scrutinee, then arm bodies), then the match itself.
+static void check_expr(Checker* checker, Expr* expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_CALL: {
+            ExprCall* call = (ExprCall*)expr;
+            for (size_t i = 0; i < da_count(call->arguments); ++i) check_expr(checker, (Expr*)da_get(call->arguments, i));
+            break;
+        }
+        case EXPR_BORROW:
+            check_expr(checker, ((ExprBorrow*)expr)->operand);
+            break;
+        case EXPR_MATCH: {
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            check_expr(checker, match_expr->scrutinee);
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                check_expr(checker, ((MatchArm*)da_get(match_expr->arms, i))->body);
+            }
+            check_match(checker, match_expr);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+
+// --- Public API ---
+
+bool match_check_expr(Expr* expr, Diagnostics* diagnostics) {
+    Checker checker = {0};
+    checker.diagnostics = diagnostics;
+    // Index 0 of each table is reserved: the wildcard, the empty row and the empty matrix.
+    checker.pats = (Pat*)malloc(sizeof(Pat));
+    checker.rows.cells = (Cell*)malloc(sizeof(Cell));
+    checker.matrices.cells = (Cell*)malloc(sizeof(Cell));
+    if (checker.pats && checker.rows.cells && checker.matrices.cells) {
+        checker.pats[0] = (Pat){PAT_WILD, NULL, -1, {0}, 0, 0};
+        checker.pat_count = checker.pat_capacity = 1;
+        checker.rows.cells[0] = checker.matrices.cells[0] = (Cell){0, 0, 0};
+        checker.rows.count = checker.rows.capacity = 1;
+        checker.matrices.count = checker.matrices.capacity = 1;
+        check_expr(&checker, expr);
+    } else {
+        checker.out_of_memory = true;
+    }
+    if (checker.out_of_memory) {
+        fprintf(stderr, "Match checker ran out of memory.\n");
+        checker.had_error = true;
+    }
+    free(checker.pats);
+    free(checker.children);
+    id_table_free(&checker.pat_ids);
+    free(checker.rows.cells);
+    id_table_free(&checker.rows.ids);
+    free(checker.matrices.cells);
+    id_table_free(&checker.matrices.ids);
+    free(checker.memos);
+    id_table_free(&checker.memo_ids);
+    free(checker.scratch);
+    return !checker.had_error;
+}
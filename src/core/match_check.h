@@ -0,0 +1,35 @@
+#ifndef MATCH_CHECK_H
+#define MATCH_CHECK_H
+
+#include <stdbool.h>
+#include "ast.h"
+#include "diagnostics.h"
+
+// Exhaustiveness and redundancy checking of `match` expressions.
+//
+// Both questions reduce to usefulness: a pattern row q is useful with respect
+// to a matrix P (one row per earlier arm) if some value matches q but no row of
+// P. An arm is unreachable if its pattern is not useful against the arms above
+// it; a match is exhaustive if the wildcard `_` is not useful against all arms.
+// Usefulness is decided column by column: a constructor in the first column of
+// q specializes P to the rows that match that constructor (its fields become
+// new columns); a wildcard tries every variant of the column's ADT when P's
+// first column names all of them (the variant counts of ADTDefinition), and
+// otherwise only the rows of P that start with a wildcard.
+//
+// Trying every variant at every nested wildcard is exponential in the depth of
+// the patterns, but the subproblems repeat. Patterns, rows and matrices are
+// hash-consed (rows and matrices as shared cons lists), so every distinct
+// subproblem has a single (matrix, row) identity and its answer is memoized.
+// The arms' matrices share their prefixes, so checking arm i against the arms
+// above it costs one cons, not a copy of i rows.
+//
+// For a non-exhaustive match, the same memo table drives the construction of a
+// missing pattern, such as `Cons(_, Nil)`, for the error message.
+
+// Checks every match in `expr`, whose patterns must have been resolved and
+// type-checked without errors. Errors are recorded in `diagnostics` (or
+// printed to stderr if it is NULL). Returns true if there were none.
+bool match_check_expr(Expr* expr, Diagnostics* diagnostics);
+
+#endif // MATCH_CHECK_H
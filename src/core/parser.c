@@ -5,7 +5,6 @@
 #include <stdlib.h> // For malloc, free
 #include <string.h> // For strncmp (potentially)
 #include <stdarg.h> // For va_list, va_start, va_end in error reporting
-#include <ctype.h>  // For isupper
 
 //------------------------------------------------------------------------------
 // Parser Helper Functions
@@ -60,14 +59,11 @@ static bool match(Parser *parser, int count, ...) {
 
 static void parser_error_at(Parser *parser, Token *token, const char *message) {
     parser->had_error = true;
-    if (token && token->type == TOKEN_EOF) {
-        fprintf(stderr, "[L%d C%d at EOF] Error: %s\n", token->line, token->col, message);
-    } else if (token) {
-        fprintf(stderr, "[L%d C%d at '%.*s'] Error: %s\n",
-                token->line, token->col, (int)token->length, token->lexeme, message);
+    if (token) {
+        diagnostics_report(parser->diagnostics, DIAG_SYNTAX, *token, message);
     } else {
         // This case should be rare, means error is not tied to a specific token
-        fprintf(stderr, "Error: %s\n", message);
+        diagnostics_report_general(parser->diagnostics, DIAG_SYNTAX, message);
     }
 }
 
@@ -95,8 +91,17 @@ static Token* consume(Parser *parser, TokenType type, const char *message) {
 static Stmt* parse_statement(Parser *parser);
 static Stmt* parse_data_declaration(Parser *parser);
 static Stmt* parse_let_declaration(Parser *parser);
-// static Expr* parse_expression(Parser *parser); // For later
-// static Expr* parse_primary(Parser *parser);    // For later
+static Stmt* parse_class_declaration(Parser *parser);
+static Stmt* parse_instance_declaration(Parser *parser);
+static bool parse_type_params(Parser *parser, DynamicArray** params_out, DynamicArray** bounds_out);
+static void free_type_params(DynamicArray* type_params, DynamicArray* param_bounds);
+static TypeAnnotation* parse_type(Parser *parser);
+static Expr* parse_expression(Parser *parser);
+static Expr* parse_unary(Parser *parser);
+static Expr* parse_call(Parser *parser);
+static Expr* parse_primary(Parser *parser);
+static Expr* parse_match(Parser *parser);
+static Pattern* parse_pattern(Parser *parser);
 
 //------------------------------------------------------------------------------
 // Parsing Implementation
@@ -113,16 +118,24 @@ static Stmt* parse_declaration(Parser *parser) {
     if (match(parser, 1, TOKEN_LET)) {
         return parse_let_declaration(parser);
     }
+    if (match(parser, 1, TOKEN_CLASS)) {
+        return parse_class_declaration(parser);
+    }
+    if (match(parser, 1, TOKEN_INSTANCE)) {
+        return parse_instance_declaration(parser);
+    }
     // Add other declarations like fn, type, etc. here
 
     // If no declaration keyword is matched, it's an error or an expression statement (later)
     if (!is_at_end(parser) && peek(parser)->type != TOKEN_EOF) {
-         parser_error_current(parser, "Expected a declaration (e.g., 'data', 'let').");
+         parser_error_current(parser, "Expected a declaration (e.g., 'data', 'let', 'class', 'instance').");
          // Synchronize: Advance until a potential statement boundary or EOF.
          // This is a simple synchronization strategy.
          while (!is_at_end(parser) && peek(parser)->type != TOKEN_SEMICOLON &&
                                       peek(parser)->type != TOKEN_DATA &&
                                       peek(parser)->type != TOKEN_LET &&
+                                      peek(parser)->type != TOKEN_CLASS &&
+                                      peek(parser)->type != TOKEN_INSTANCE &&
                                       peek(parser)->type != TOKEN_RBRACE /* for blocks later */ ) {
              advance(parser);
          }
@@ -137,37 +150,12 @@ static Stmt* parse_data_declaration(Parser *parser) {
     if (!adt_name) return NULL;
 
     // Store Token* (pointers to heap-allocated Tokens) for params
-    DynamicArray* type_params = da_create(2, sizeof(Token*));
-
-    if (match(parser, 1, TOKEN_LESS)) { // Optional type parameters <T, U>
-        if (!check(parser, TOKEN_GREATER)) { // Must not be empty like <>
-            do {
-                Token* param_name = consume(parser, TOKEN_IDENTIFIER, "Expected type parameter name.");
-                if (!param_name) {
-                    da_destroy(type_params); // Clean up partially created list
-                    return NULL;
-                }
-                // Store a copy of the token. DynamicArray needs to be configured
-                // to copy the Token struct if item_size was sizeof(Token).
-                // If DA stores pointers, we'd need to malloc a Token copy.
-                // Assuming da_push handles copying if item_size matches.
-                Token* param_token_alloc = (Token*)malloc(sizeof(Token));
-                if (!param_token_alloc) { /* memory error */ da_destroy(type_params); return NULL; }
-                *param_token_alloc = *param_name; // Copy the token data
-                da_push(type_params, param_token_alloc); // Store pointer to copied token
-            } while (match(parser, 1, TOKEN_COMMA));
-        }
-        if (!consume(parser, TOKEN_GREATER, "Expected '>' after type parameters.")) {
-            // Cleanup type_params which stores Token*
-            for(size_t i=0; i<da_count(type_params); ++i) free(da_get(type_params, i));
-            da_destroy(type_params);
-            return NULL;
-        }
-    }
+    DynamicArray* type_params = NULL;
+    DynamicArray* param_bounds = NULL;
+    if (!parse_type_params(parser, &type_params, &param_bounds)) return NULL;
 
     if (!consume(parser, TOKEN_LBRACE, "Expected '{' before ADT variants.")) {
-        for(size_t i=0; i<da_count(type_params); ++i) free(da_get(type_params, i));
-        da_destroy(type_params);
+        free_type_params(type_params, param_bounds);
         return NULL;
     }
 
@@ -182,13 +170,11 @@ static Stmt* parse_data_declaration(Parser *parser) {
             fields = da_create(2, sizeof(ADTVariantField*));
             if (!check(parser, TOKEN_RPAREN)) { // Must not be empty like Some() unless that's allowed
                 do {
-                    // For now, assume fields are simple type identifiers.
-                    // TODO: Parse full type annotations later (e.g. List<String>, &i32)
-                    Token* field_type_name = consume(parser, TOKEN_IDENTIFIER, "Expected type name for variant field.");
-                    if (!field_type_name) { /* error */ break; }
+                    TypeAnnotation* field_type = parse_type(parser);
+                    if (!field_type) { /* error */ break; }
 
                     // For tuple-like fields, the 'name' in ADTVariantField is null.
-                    ADTVariantField* field = ast_adt_variant_field_create((Token){0}, *field_type_name);
+                    ADTVariantField* field = ast_adt_variant_field_create((Token){0}, field_type);
                     da_push(fields, field);
                 } while (match(parser, 1, TOKEN_COMMA));
             }
@@ -224,11 +210,133 @@ static Stmt* parse_data_declaration(Parser *parser) {
         // cleanup variants, type_params
         // For now, just return NULL, error already flagged
         // Proper cleanup would involve freeing allocated variants and fields.
-        ast_stmt_data_create(*adt_name, type_params, variants); // Create to destroy for cleanup
+        ast_stmt_data_create(*adt_name, type_params, param_bounds, variants); // Create to destroy for cleanup
         return NULL;
     }
 
-    return ast_stmt_data_create(*adt_name, type_params, variants);
+    return ast_stmt_data_create(*adt_name, type_params, param_bounds, variants);
+}
+
+
+// class := 'class' IDENT (':' IDENT)? '{' (IDENT (',' IDENT)* ','?)? '}'
+static Stmt* parse_class_declaration(Parser *parser) {
+    Token* class_name = consume(parser, TOKEN_IDENTIFIER, "Expected class name after 'class'.");
+    if (!class_name) return NULL;
+    Token name = *class_name;
+
+    Token superclass = {0};
+    if (match(parser, 1, TOKEN_COLON)) {
+        Token* super_name = consume(parser, TOKEN_IDENTIFIER, "Expected superclass name after ':'.");
+        if (!super_name) return NULL;
+        superclass = *super_name;
+    }
+
+    if (!consume(parser, TOKEN_LBRACE, "Expected '{' before class methods.")) return NULL;
+    DynamicArray* methods = da_create(2, sizeof(Token*));
+    while (!check(parser, TOKEN_RBRACE) && !is_at_end(parser)) {
+        Token* method = consume(parser, TOKEN_IDENTIFIER, "Expected method name.");
+        if (!method) break;
+        Token* method_alloc = (Token*)malloc(sizeof(Token));
+        if (!method_alloc) break;
+        *method_alloc = *method;
+        da_push(methods, method_alloc);
+        if (!match(parser, 1, TOKEN_COMMA)) break;
+    }
+    Stmt* stmt = ast_stmt_class_create(name, superclass, methods);
+    if (!consume(parser, TOKEN_RBRACE, "Expected '}' after class methods.")) {
+        ast_stmt_destroy(stmt);
+        return NULL;
+    }
+    return stmt;
+}
+
+
+// instance := 'instance' type_params? IDENT 'for' type ';'
+static Stmt* parse_instance_declaration(Parser *parser) {
+    DynamicArray* type_params = NULL;
+    DynamicArray* param_bounds = NULL;
+    if (!parse_type_params(parser, &type_params, &param_bounds)) return NULL;
+
+    Token* class_name = consume(parser, TOKEN_IDENTIFIER, "Expected class name in instance declaration.");
+    if (!class_name || !consume(parser, TOKEN_FOR, "Expected 'for' after class name.")) {
+        free_type_params(type_params, param_bounds);
+        return NULL;
+    }
+    Token name = *class_name;
+    TypeAnnotation* head = parse_type(parser);
+    if (!head) {
+        free_type_params(type_params, param_bounds);
+        return NULL;
+    }
+    Stmt* stmt = ast_stmt_instance_create(name, type_params, param_bounds, head);
+    if (!consume(parser, TOKEN_SEMICOLON, "Expected ';' after instance declaration.")) {
+        ast_stmt_destroy(stmt);
+        return NULL;
+    }
+    return stmt;
+}
+
+
+// type_params := ('<' param (',' param)* '>')?
+// param       := IDENT (':' IDENT ('+' IDENT)*)?
+// Fills *params_out with Token* and *bounds_out with one Token* list (or NULL)
+// per parameter. Both are empty when there is no parameter list.
+static bool parse_type_params(Parser *parser, DynamicArray** params_out, DynamicArray** bounds_out) {
+    DynamicArray* type_params = da_create(2, sizeof(Token*));
+    DynamicArray* param_bounds = da_create(2, sizeof(DynamicArray*));
+    *params_out = NULL;
+    *bounds_out = NULL;
+
+    if (match(parser, 1, TOKEN_LESS)) { // Optional type parameters <T, U: Ord>
+        if (!check(parser, TOKEN_GREATER)) { // Must not be empty like <>
+            do {
+                Token* param_name = consume(parser, TOKEN_IDENTIFIER, "Expected type parameter name.");
+                if (!param_name) {
+                    free_type_params(type_params, param_bounds); // Clean up partially created list
+                    return false;
+                }
+                Token* param_token_alloc = (Token*)malloc(sizeof(Token));
+                if (!param_token_alloc) { /* memory error */ free_type_params(type_params, param_bounds); return false; }
+                *param_token_alloc = *param_name; // Copy the token data
+                da_push(type_params, param_token_alloc); // Store pointer to copied token
+
+                DynamicArray* bounds = NULL;
+                if (match(parser, 1, TOKEN_COLON)) {
+                    bounds = da_create(1, sizeof(Token*));
+                    do {
+                        Token* bound = consume(parser, TOKEN_IDENTIFIER, "Expected class name in type parameter bound.");
+                        Token* bound_alloc = bound ? (Token*)malloc(sizeof(Token)) : NULL;
+                        if (!bound_alloc) {
+                            da_push(param_bounds, bounds);
+                            free_type_params(type_params, param_bounds);
+                            return false;
+                        }
+                        *bound_alloc = *bound;
+                        da_push(bounds, bound_alloc);
+                    } while (match(parser, 1, TOKEN_PLUS));
+                }
+                da_push(param_bounds, bounds);
+            } while (match(parser, 1, TOKEN_COMMA));
+        }
+        if (!consume(parser, TOKEN_GREATER, "Expected '>' after type parameters.")) {
+            free_type_params(type_params, param_bounds);
+            return false;
+        }
+    }
+    *params_out = type_params;
+    *bounds_out = param_bounds;
+    return true;
+}
+
+static void free_type_params(DynamicArray* type_params, DynamicArray* param_bounds) {
+    for (size_t i = 0; i < da_count(type_params); ++i) free(da_get(type_params, i));
+    da_destroy(type_params);
+    for (size_t i = 0; i < da_count(param_bounds); ++i) {
+        DynamicArray* bounds = (DynamicArray*)da_get(param_bounds, i);
+        for (size_t j = 0; j < da_count(bounds); ++j) free(da_get(bounds, j));
+        da_destroy(bounds);
+    }
+    da_destroy(param_bounds);
 }
 
 
@@ -237,46 +345,239 @@ static Stmt* parse_let_declaration(Parser *parser) {
     Token* name = consume(parser, TOKEN_IDENTIFIER, "Expected variable name after 'let' or 'let mut'.");
     if (!name) return NULL;
 
+    TypeAnnotation* type_annot = NULL;
+    if (match(parser, 1, TOKEN_COLON)) {
+        type_annot = parse_type(parser);
+        if (!type_annot) return NULL;
+    }
+
     Expr* initializer = NULL;
     if (match(parser, 1, TOKEN_ASSIGN)) {
-        // TODO: Parse actual expressions. For Phase 1, we might skip or parse only literals.
-        // initializer = parse_expression(parser);
-        // For now, let's assume it's a literal for simplicity if there's an initializer.
-        if (check(parser, TOKEN_INTEGER) || check(parser, TOKEN_STRING)) {
-            Token* literal_token = advance(parser);
-            initializer = ast_expr_literal_create(*literal_token);
-        } else if (check(parser, TOKEN_IDENTIFIER)) { // Could be an ADT constructor like None or Some(..)
-            Token* id_token = peek(parser); // Don't consume yet, might be start of a call Some(val)
-            // This is where expression parsing gets more complex.
-            // For Phase 1, `let x = Some(y)` is too complex without expression parsing.
-            // Let's just allow `let x = value_literal;` or `let x = existing_var;`
-            if (id_token->lexeme && (id_token->length > 0 && isupper(id_token->lexeme[0])) && check(parser, TOKEN_LPAREN)) {
-                 parser_error_current(parser, "ADT instantiation in 'let' initializer not yet fully supported in parser Phase 1 (basic expressions only).");
-                 // For now, we won't parse the call expression correctly.
-                 // Skip it by advancing past the identifier for now if it looks like a constructor.
-                 // This part needs proper `parse_expression()`
-                 advance(parser); // Consume the identifier
-                 // Potentially skip ( ... ) for now
-                 // This is a simplification for Phase 1.
-            } else if (id_token->lexeme) { // Treat as simple variable
-                 advance(parser);
-                 initializer = ast_expr_variable_create(*id_token);
-            } else {
-                 parser_error_current(parser, "Expected an initializer expression after '='.");
-            }
-        }
-         else {
-            parser_error_current(parser, "Expected an initializer expression after '='.");
-            // No initializer parsed if it's not a simple literal or var.
+        initializer = parse_expression(parser);
+        if (!initializer) {
+            // Error already reported; skip to the end of the declaration.
+            while (!is_at_end(parser) && !check(parser, TOKEN_SEMICOLON)) advance(parser);
         }
     }
-    // Type annotations (: type) would be parsed here if supported.
 
     if (!consume(parser, TOKEN_SEMICOLON, "Expected ';' after variable declaration.")) {
         if (initializer) ast_expr_destroy(initializer); // Clean up if semicolon is missing
+        ast_type_annotation_destroy(type_annot);
+        return NULL;
+    }
+    return ast_stmt_let_create(*name, is_mutable, type_annot, initializer);
+}
+
+
+//------------------------------------------------------------------------------
+// Types
+//------------------------------------------------------------------------------
+// type := '&' 'mut'? type | IDENT ('<' type (',' type)* '>')?
+
+static TypeAnnotation* parse_type(Parser *parser) {
+    if (match(parser, 1, TOKEN_AMPERSAND)) {
+        Token ampersand = *previous(parser);
+        bool is_mutable = match(parser, 1, TOKEN_MUT);
+        TypeAnnotation* referent = parse_type(parser);
+        if (!referent) return NULL;
+        return ast_type_annotation_reference_create(ampersand, is_mutable, referent);
+    }
+
+    Token* name = consume(parser, TOKEN_IDENTIFIER, "Expected type name.");
+    if (!name) return NULL;
+
+    DynamicArray* args = NULL;
+    if (match(parser, 1, TOKEN_LESS)) {
+        args = da_create(2, sizeof(TypeAnnotation*));
+        do {
+            TypeAnnotation* arg = parse_type(parser);
+            if (!arg) {
+                for (size_t i = 0; i < da_count(args); ++i) ast_type_annotation_destroy((TypeAnnotation*)da_get(args, i));
+                da_destroy(args);
+                return NULL;
+            }
+            da_push(args, arg);
+        } while (match(parser, 1, TOKEN_COMMA));
+        if (!consume(parser, TOKEN_GREATER, "Expected '>' after type arguments.")) {
+            for (size_t i = 0; i < da_count(args); ++i) ast_type_annotation_destroy((TypeAnnotation*)da_get(args, i));
+            da_destroy(args);
+            return NULL;
+        }
+    }
+    return ast_type_annotation_create(*name, args);
+}
+
+
+//------------------------------------------------------------------------------
+// Expressions
+//------------------------------------------------------------------------------
+// For now expressions are literals, names, constructor applications such as
+// `Some(x)` or `Cons(1, Cons(2, Nil))`, and borrows of those. Binary operators
+// will slot in above parse_unary.
+//
+// unary := '&' 'mut'? unary | call     (`&&x` is `& &x`)
+
+static Expr* parse_expression(Parser *parser) {
+    return parse_unary(parser);
+}
+
+static Expr* parse_unary(Parser *parser) {
+    if (match(parser, 2, TOKEN_AMPERSAND, TOKEN_AND)) {
+        Token ampersand = *previous(parser);
+        bool doubled = ampersand.type == TOKEN_AND;
+        Token inner = ampersand;
+        if (doubled) {
+            ampersand.length = inner.length = 1;
+            inner.lexeme++;
+            inner.col++;
+        }
+        bool is_mutable = match(parser, 1, TOKEN_MUT);
+        Expr* operand = parse_unary(parser);
+        if (!operand) return NULL;
+        Expr* borrow = ast_expr_borrow_create(doubled ? inner : ampersand, is_mutable, operand);
+        return doubled ? ast_expr_borrow_create(ampersand, false, borrow) : borrow;
+    }
+    return parse_call(parser);
+}
+
+static Expr* parse_call(Parser *parser) {
+    Expr* expr = parse_primary(parser);
+    if (!expr) return NULL;
+
+    while (match(parser, 1, TOKEN_LPAREN)) {
+        DynamicArray* arguments = da_create(2, sizeof(Expr*));
+        if (!check(parser, TOKEN_RPAREN)) {
+            do {
+                Expr* argument = parse_expression(parser);
+                if (!argument) {
+                    for (size_t i = 0; i < da_count(arguments); ++i) ast_expr_destroy((Expr*)da_get(arguments, i));
+                    da_destroy(arguments);
+                    ast_expr_destroy(expr);
+                    return NULL;
+                }
+                da_push(arguments, argument);
+            } while (match(parser, 1, TOKEN_COMMA));
+        }
+        Token* closing_paren = consume(parser, TOKEN_RPAREN, "Expected ')' after arguments.");
+        if (!closing_paren) {
+            for (size_t i = 0; i < da_count(arguments); ++i) ast_expr_destroy((Expr*)da_get(arguments, i));
+            da_destroy(arguments);
+            ast_expr_destroy(expr);
+            return NULL;
+        }
+        expr = ast_expr_call_create(expr, arguments, *closing_paren);
+    }
+    return expr;
+}
+
+static Expr* parse_primary(Parser *parser) {
+    if (match(parser, 4, TOKEN_INTEGER, TOKEN_STRING, TOKEN_TRUE, TOKEN_FALSE)) {
+        return ast_expr_literal_create(*previous(parser));
+    }
+    if (match(parser, 1, TOKEN_IDENTIFIER)) {
+        return ast_expr_variable_create(*previous(parser));
+    }
+    if (match(parser, 1, TOKEN_MATCH)) {
+        return parse_match(parser);
+    }
+    parser_error_current(parser, "Expected expression.");
+    return NULL;
+}
+
+static void destroy_patterns(DynamicArray* patterns) {
+    for (size_t i = 0; i < da_count(patterns); ++i) ast_pattern_destroy((Pattern*)da_get(patterns, i));
+    da_destroy(patterns);
+}
+
+// simple := '_' | literal | IDENT ('(' pattern (',' pattern)* ')')?
+static Pattern* parse_simple_pattern(Parser *parser) {
+    if (match(parser, 4, TOKEN_INTEGER, TOKEN_STRING, TOKEN_TRUE, TOKEN_FALSE)) {
+        return ast_pattern_create(PATTERN_LITERAL, *previous(parser), NULL);
+    }
+    Token* name = consume(parser, TOKEN_IDENTIFIER, "Expected pattern.");
+    if (!name) return NULL;
+    Token token = *name;
+    if (token.length == 1 && token.lexeme[0] == '_') return ast_pattern_create(PATTERN_WILDCARD, token, NULL);
+    if (!match(parser, 1, TOKEN_LPAREN)) return ast_pattern_create(PATTERN_BINDING, token, NULL);
+
+    DynamicArray* fields = da_create(2, sizeof(Pattern*));
+    if (!check(parser, TOKEN_RPAREN)) {
+        do {
+            Pattern* field = parse_pattern(parser);
+            if (!field) {
+                destroy_patterns(fields);
+                return NULL;
+            }
+            da_push(fields, field);
+        } while (match(parser, 1, TOKEN_COMMA));
+    }
+    if (!consume(parser, TOKEN_RPAREN, "Expected ')' after constructor pattern fields.")) {
+        destroy_patterns(fields);
+        return NULL;
+    }
+    return ast_pattern_create(PATTERN_CONSTRUCTOR, token, fields);
+}
+
+// pattern := simple ('|' simple)*
+static Pattern* parse_pattern(Parser *parser) {
+    Pattern* first = parse_simple_pattern(parser);
+    if (!first || !check(parser, TOKEN_PIPE)) return first;
+    Token pipe = *peek(parser);
+    DynamicArray* alternatives = da_create(2, sizeof(Pattern*));
+    da_push(alternatives, first);
+    while (match(parser, 1, TOKEN_PIPE)) {
+        Pattern* alternative = parse_simple_pattern(parser);
+        if (!alternative) {
+            destroy_patterns(alternatives);
+            return NULL;
+        }
+        da_push(alternatives, alternative);
+    }
+    return ast_pattern_create(PATTERN_OR, pipe, alternatives);
+}
+
+static void destroy_arms(DynamicArray* arms) {
+    for (size_t i = 0; i < da_count(arms); ++i) {
+        MatchArm* arm = (MatchArm*)da_get(arms, i);
+        ast_pattern_destroy(arm->pattern);
+        ast_expr_destroy(arm->body);
+        free(arm);
+    }
+    da_destroy(arms);
+}
+
+// match := 'match' expression '{' (arm (',' arm)* ','?)? '}'
+// arm   := pattern '=>' expression
+static Expr* parse_match(Parser *parser) {
+    Token keyword = *previous(parser);
+    Expr* scrutinee = parse_expression(parser);
+    if (!scrutinee) return NULL;
+    if (!consume(parser, TOKEN_LBRACE, "Expected '{' after match scrutinee.")) {
+        ast_expr_destroy(scrutinee);
+        return NULL;
+    }
+    DynamicArray* arms = da_create(4, sizeof(MatchArm*));
+    while (!check(parser, TOKEN_RBRACE) && !is_at_end(parser)) {
+        Pattern* pattern = parse_pattern(parser);
+        Expr* body = pattern && consume(parser, TOKEN_ARROW, "Expected '=>' after match pattern.")
+                         ? parse_expression(parser) : NULL;
+        MatchArm* arm = body ? ast_match_arm_create(pattern, body) : NULL;
+        if (!arm) {
+            ast_pattern_destroy(pattern);
+            ast_expr_destroy(body);
+            destroy_arms(arms);
+            ast_expr_destroy(scrutinee);
+            return NULL;
+        }
+        da_push(arms, arm);
+        if (!match(parser, 1, TOKEN_COMMA)) break;
+    }
+    if (!consume(parser, TOKEN_RBRACE, "Expected '}' after match arms.")) {
+        destroy_arms(arms);
+        ast_expr_destroy(scrutinee);
         return NULL;
     }
-    return ast_stmt_let_create(*name, is_mutable, initializer);
+    return ast_expr_match_create(keyword, scrutinee, arms);
 }
 
 
@@ -290,6 +591,7 @@ Parser* parser_create(DynamicArray *tokens) {
     parser->tokens = tokens;
     parser->current = 0;
     parser->had_error = false;
+    parser->diagnostics = NULL;
     return parser;
 }
 
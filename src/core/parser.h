@@ -3,6 +3,7 @@
 
 #include "token.h"    // For Token
 #include "ast.h"      // For Program, Stmt, Expr etc.
+#include "diagnostics.h"
 #include "../util/dynamic_array.h" // For Lexer's token list
 
 // Parser structure
@@ -10,8 +11,7 @@ typedef struct {
     DynamicArray *tokens; // List of tokens from the lexer (not owned by parser)
     int current;          // Index of the current token being processed
     bool had_error;       // Flag to indicate if any parsing errors occurred
-    // We can add a DynamicArray here to store error messages if needed.
-    // DynamicArray* errors;
+    Diagnostics* diagnostics; // Not owned; errors are recorded here instead of printed when set
 } Parser;
 
 // Initializes a new parser with a list of tokens.
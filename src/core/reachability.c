@@ -0,0 +1,242 @@
+#include "reachability.h"
+#include "../util/hash.h"
+#include <stdlib.h>
+#include <string.h> // For memcmp, strlen
+
+typedef enum {
+    NAME_LET,
+    NAME_ADT,
+    NAME_VARIANT, // A constructor; `stmt` is its `data` declaration
+} NameKind;
+
+// A declared name. Declarations of the same name are chained, in source order.
+typedef struct {
+    Token name;
+    NameKind kind;
+    size_t stmt;
+    size_t next; // Next declaration of this name, or NO_ENTRY
+} NameEntry;
+
+#define NO_ENTRY SIZE_MAX
+
+// Open addressing over the first declaration of each name; grows at half load.
+typedef struct {
+    NameEntry* entries;
+    size_t entry_count, entry_capacity;
+    size_t* slots;      // First entry index + 1, or 0 for an empty slot
+    size_t* last;       // Per entry: the last entry of its chain (valid for chain heads)
+    size_t capacity;    // Power of two
+    size_t name_count;
+} NameTable;
+
+typedef struct {
+    const Program* program;
+    NameTable names;
+    bool* reachable;
+    size_t* stack; // Reachable statements not scanned yet
+    size_t stack_count;
+    bool out_of_memory;
+} Marker;
+
+static bool names_equal(const char* a, size_t a_length, const char* b, size_t b_length) {
+    return a_length == b_length && memcmp(a, b, a_length) == 0;
+}
+
+// Returns the slot for `name`: its chain head, or the empty slot where it would go.
+static size_t find_slot(const NameTable* table, const char* name, size_t length) {
+    size_t mask = table->capacity - 1;
+    size_t i = hash_bytes(name, length) & mask;
+    while (table->slots[i]) {
+        const NameEntry* head = &table->entries[table->slots[i] - 1];
+        if (names_equal(head->name.lexeme, head->name.length, name, length)) break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static bool grow(NameTable* table) {
+    size_t capacity = table->capacity ? table->capacity * 2 : 64;
+    size_t* old_slots = table->slots;
+    size_t old_capacity = table->capacity;
+    table->slots = (size_t*)calloc(capacity, sizeof(size_t));
+    if (!table->slots) {
+        table->slots = old_slots;
+        return false;
+    }
+    table->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (!old_slots[i]) continue;
+        const NameEntry* head = &table->entries[old_slots[i] - 1];
+        table->slots[find_slot(table, head->name.lexeme, head->name.length)] = old_slots[i];
+    }
+    free(old_slots);
+    return true;
+}
+
+static void add_name(Marker* marker, Token name, NameKind kind, size_t stmt) {
+    NameTable* table = &marker->names;
+    if (marker->out_of_memory || !name.lexeme) return;
+    if ((table->name_count + 1) * 2 > table->capacity && !grow(table)) {
+        marker->out_of_memory = true;
+        return;
+    }
+    if (table->entry_count == table->entry_capacity) {
+        size_t capacity = table->entry_capacity ? table->entry_capacity * 2 : 64;
+        NameEntry* entries = (NameEntry*)realloc(table->entries, capacity * sizeof(NameEntry));
+        size_t* last = entries ? (size_t*)realloc(table->last, capacity * sizeof(size_t)) : NULL;
+        if (entries) table->entries = entries;
+        if (!entries || !last) {
+            marker->out_of_memory = true;
+            return;
+        }
+        table->last = last;
+        table->entry_capacity = capacity;
+    }
+    size_t index = table->entry_count++;
+    table->entries[index] = (NameEntry){name, kind, stmt, NO_ENTRY};
+    table->last[index] = index;
+    size_t slot = find_slot(table, name.lexeme, name.length);
+    if (!table->slots[slot]) {
+        table->slots[slot] = index + 1;
+        table->name_count++;
+        return;
+    }
+    size_t head = table->slots[slot] - 1;
+    table->entries[table->last[head]].next = index;
+    table->last[head] = index;
+}
+
+static size_t first_entry(const NameTable* table, const char* name, size_t length) {
+    if (!table->capacity) return NO_ENTRY;
+    size_t slot = find_slot(table, name, length);
+    return table->slots[slot] ? table->slots[slot] - 1 : NO_ENTRY;
+}
+
+static void reach(Marker* marker, size_t stmt) {
+    if (marker->reachable[stmt]) return;
+    marker->reachable[stmt] = true;
+    marker->stack[marker->stack_count++] = stmt; // Each statement is pushed at most once
+}
+
+// Marks the declarations of `name` of the given kinds; `let`s only if they come before `before`.
+static void reach_name(Marker* marker, Token name, bool lets, bool adts, bool variants, size_t before) {
+    for (size_t e = first_entry(&marker->names, name.lexeme, name.length); e != NO_ENTRY;
+         e = marker->names.entries[e].next) {
+        const NameEntry* entry = &marker->names.entries[e];
+        if ((entry->kind == NAME_LET && lets && entry->stmt < before) || (entry->kind == NAME_ADT && adts) ||
+            (entry->kind == NAME_VARIANT && variants)) {
+            reach(marker, entry->stmt);
+        }
+    }
+}
+
+static void scan_annotation(Marker* marker, const TypeAnnotation* annot) {
+    for (; annot; annot = annot->referent) {
+        if (!annot->referent) reach_name(marker, annot->name, false, true, false, 0);
+        for (size_t i = 0; i < da_count(annot->args); ++i) {
+            scan_annotation(marker, (TypeAnnotation*)da_get(annot->args, i));
+        }
+    }
+}
+
+static void scan_pattern(Marker* marker, const Pattern* pattern) {
+    if (!pattern) return;
+    if (pattern->kind == PATTERN_CONSTRUCTOR || pattern->kind == PATTERN_BINDING) {
+        reach_name(marker, pattern->token, false, false, true, 0);
+    }
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        scan_pattern(marker, (Pattern*)da_get(pattern->subpatterns, i));
+    }
+}
+
+// `stmt` is the `let` whose initializer contains `expr`.
+static void scan_expr(Marker* marker, const Expr* expr, size_t stmt) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            reach_name(marker, ((ExprVariable*)expr)->name, true, false, true, stmt);
+            break;
+        case EXPR_CALL: {
+            ExprCall* call = (ExprCall*)expr;
+            scan_expr(marker, call->callee, stmt);
+            for (size_t i = 0; i < da_count(call->arguments); ++i) {
+                scan_expr(marker, (Expr*)da_get(call->arguments, i), stmt);
+            }
+            break;
+        }
+        case EXPR_BORROW:
+            scan_expr(marker, ((ExprBorrow*)expr)->operand, stmt);
+            break;
+        case EXPR_MATCH: {
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            scan_expr(marker, match_expr->scrutinee, stmt);
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                scan_pattern(marker, arm->pattern);
+                scan_expr(marker, arm->body, stmt);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void scan_stmt(Marker* marker, size_t index) {
+    Stmt* stmt = (Stmt*)da_get(marker->program->statements, index);
+    if (stmt->type == STMT_LET) {
+        StmtLet* let = (StmtLet*)stmt;
+        scan_annotation(marker, let->type_annot);
+        scan_expr(marker, let->initializer, index);
+    } else if (stmt->type == STMT_DATA) {
+        StmtData* data = (StmtData*)stmt;
+        for (size_t v = 0; v < da_count(data->variants); ++v) {
+            ADTVariant* variant = (ADTVariant*)da_get(data->variants, v);
+            for (size_t f = 0; f < da_count(variant->fields); ++f) {
+                scan_annotation(marker, ((ADTVariantField*)da_get(variant->fields, f))->type_annot);
+            }
+        }
+    }
+}
+
+bool reachability_mark(const Program* program, DynamicArray* roots, bool* reachable, DynamicArray* unknown) {
+    size_t count = da_count(program->statements);
+    Marker marker = {0};
+    marker.program = program;
+    marker.reachable = reachable;
+    marker.stack = (size_t*)malloc((count ? count : 1) * sizeof(size_t));
+    marker.out_of_memory = marker.stack == NULL;
+    for (size_t i = 0; i < count; ++i) {
+        reachable[i] = false;
+        Stmt* stmt = (Stmt*)da_get(program->statements, i);
+        if (stmt->type == STMT_LET) {
+            add_name(&marker, ((StmtLet*)stmt)->name, NAME_LET, i);
+        } else if (stmt->type == STMT_DATA) {
+            StmtData* data = (StmtData*)stmt;
+            add_name(&marker, data->name, NAME_ADT, i);
+            for (size_t v = 0; v < da_count(data->variants); ++v) {
+                add_name(&marker, ((ADTVariant*)da_get(data->variants, v))->name, NAME_VARIANT, i);
+            }
+        }
+    }
+
+    for (size_t r = 0; !marker.out_of_memory && r < da_count(roots); ++r) {
+        const char* root = (const char*)da_get(roots, r);
+        bool found = false;
+        for (size_t e = first_entry(&marker.names, root, strlen(root)); e != NO_ENTRY; e = marker.names.entries[e].next) {
+            if (marker.names.entries[e].kind == NAME_VARIANT) continue;
+            reach(&marker, marker.names.entries[e].stmt);
+            found = true;
+        }
+        if (!found && unknown) da_push(unknown, (void*)root);
+    }
+    while (!marker.out_of_memory && marker.stack_count > 0) {
+        scan_stmt(&marker, marker.stack[--marker.stack_count]);
+    }
+
+    free(marker.names.entries);
+    free(marker.names.slots);
+    free(marker.names.last);
+    free(marker.stack);
+    return !marker.out_of_memory;
+}
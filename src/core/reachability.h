@@ -0,0 +1,27 @@
+#ifndef REACHABILITY_H
+#define REACHABILITY_H
+
+#include <stdbool.h>
+#include "ast.h"
+#include "../util/dynamic_array.h"
+
+// Which top-level declarations a build of some entry points needs.
+//
+// Starting from the `let`s and `data` declarations named as roots, a
+// declaration is reachable if a reachable one mentions its name: a `let`
+// initializer names earlier `let`s and constructors (whose `data` declaration
+// is then reachable), a type annotation or field type names ADTs. Names are
+// matched syntactically, before any resolution, so a pattern binding that
+// shadows a global `let` keeps that `let` reachable; the set can only be too
+// large, never too small.
+//
+// Each name is hashed once into a table of declarations, so marking costs
+// O(program size) and each reachable declaration is scanned once.
+
+// Sets reachable[i] for every statement i reachable from `roots` (const char*
+// names) and clears it for the others. Root names that no `let` or `data`
+// declares are pushed onto `unknown` (if non-NULL). Returns false if out of
+// memory.
+bool reachability_mark(const Program* program, DynamicArray* roots, bool* reachable, DynamicArray* unknown);
+
+#endif // REACHABILITY_H
@@ -0,0 +1,240 @@
+#include "resolver.h"
+#include "ast.h"
+#include "symbol_table.h"
+#include <stdio.h>  // For fprintf, stderr for errors
+#include <stdlib.h> // For malloc, free
+
+// --- Error Reporting ---
+static void resolver_error_at_token(Resolver* resolver, Token token, const char* message) {
+    resolver->had_error = true;
+    diagnostics_report(resolver->diagnostics, DIAG_SEMANTIC, token, message);
+}
+
+
+// --- Patterns ---
+
+// Declares the variables `pattern` binds in the current scope and resolves its
+// constructor names. A bare name is a nullary constructor if one is in scope,
+// like `Nil` in an expression; otherwise it binds a new variable.
+static void resolve_pattern(Resolver* resolver, Pattern* pattern, bool in_alternative) {
+    if (!pattern) return;
+    switch (pattern->kind) {
+        case PATTERN_BINDING: {
+            const ConstructorEntry* ctor = constructor_index_lookup(resolver->constructors, pattern->token);
+            if (ctor) {
+                pattern->constructor_adt = ctor->adt_symbol;
+                pattern->constructor_tag = ctor->tag;
+                break;
+            }
+            if (in_alternative) {
+                resolver_error_at_token(resolver, pattern->token, "Variables cannot be bound inside an or-pattern.");
+                break;
+            }
+            if (symbol_table_lookup_current(resolver->sym_table, pattern->token)) {
+                resolver_error_at_token(resolver, pattern->token, "Variable already bound in this pattern.");
+                break;
+            }
+            Symbol* var_symbol = symbol_create(SYMBOL_VARIABLE, pattern->token, NULL);
+            if (!var_symbol) break;
+            var_symbol->data.var_info.is_mutable = false;
+            if (!symbol_table_define(resolver->sym_table, var_symbol)) {
+                resolver_error_at_token(resolver, pattern->token, "Failed to define variable symbol.");
+                symbol_destroy(var_symbol);
+                break;
+            }
+            pattern->symbol = var_symbol;
+            break;
+        }
+        case PATTERN_CONSTRUCTOR: {
+            const ConstructorEntry* ctor = constructor_index_lookup(resolver->constructors, pattern->token);
+            if (ctor) {
+                pattern->constructor_adt = ctor->adt_symbol;
+                pattern->constructor_tag = ctor->tag;
+            } else {
+                resolver_error_at_token(resolver, pattern->token, "Undefined constructor.");
+            }
+            for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+                resolve_pattern(resolver, (Pattern*)da_get(pattern->subpatterns, i), in_alternative);
+            }
+            break;
+        }
+        case PATTERN_OR:
+            for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+                resolve_pattern(resolver, (Pattern*)da_get(pattern->subpatterns, i), true);
+            }
+            break;
+        default: // Wildcards and literals bind nothing
+            break;
+    }
+}
+
+
+// --- Expressions ---
+
+void resolver_resolve_expr(Resolver* resolver, Expr* expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            break;
+        case EXPR_VARIABLE: {
+            ExprVariable* var_expr = (ExprVariable*)expr;
+            Symbol* sym = symbol_table_lookup(resolver->sym_table, var_expr->name);
+            if (sym && sym->depth == 0 && resolver->visible_globals >= 0 && sym->slot >= resolver->visible_globals) {
+                sym = NULL; // Declared later in the file
+            }
+            if (!sym || sym->kind == SYMBOL_ADT) {
+                // Not a binding: it may be a nullary constructor such as `None`,
+                // possibly named like its ADT (`data Unit { Unit }`).
+                const ConstructorEntry* ctor = constructor_index_lookup(resolver->constructors, var_expr->name);
+                if (ctor) {
+                    var_expr->constructor_adt = ctor->adt_symbol;
+                    var_expr->constructor_tag = ctor->tag;
+                } else {
+                    resolver_error_at_token(resolver, var_expr->name, sym ? "Type name used as a value." : "Undefined variable.");
+                }
+                break;
+            }
+            // Record the binding once; consumers use the indices from here on.
+            var_expr->symbol = sym;
+            var_expr->depth = sym->depth;
+            var_expr->slot = sym->slot;
+            break;
+        }
+        case EXPR_CALL: {
+            ExprCall* call_expr = (ExprCall*)expr;
+            if (call_expr->callee && call_expr->callee->type == EXPR_VARIABLE) {
+                // Only constructors can be applied for now: one index probe per call site.
+                ExprVariable* callee = (ExprVariable*)call_expr->callee;
+                const ConstructorEntry* ctor = constructor_index_lookup(resolver->constructors, callee->name);
+                if (ctor) {
+                    callee->constructor_adt = ctor->adt_symbol;
+                    callee->constructor_tag = ctor->tag;
+                    call_expr->constructor_adt = ctor->adt_symbol;
+                    call_expr->constructor_tag = ctor->tag;
+                } else {
+                    resolver_error_at_token(resolver, callee->name, "Undefined constructor.");
+                }
+            } else {
+                resolver_resolve_expr(resolver, call_expr->callee);
+            }
+            for (size_t i = 0; i < da_count(call_expr->arguments); ++i) {
+                resolver_resolve_expr(resolver, (Expr*)da_get(call_expr->arguments, i));
+            }
+            break;
+        }
+        case EXPR_BORROW:
+            resolver_resolve_expr(resolver, ((ExprBorrow*)expr)->operand);
+            break;
+        case EXPR_MATCH: {
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            resolver_resolve_expr(resolver, match_expr->scrutinee);
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                // Each arm's bindings live in their own scope, kept alive for the
+                // annotations that point at them.
+                Scope* outer = resolver->sym_table->current_scope;
+                symbol_table_enter_scope(resolver->sym_table);
+                if (resolver->sym_table->current_scope == outer) { // Out of memory
+                    resolver_error_at_token(resolver, arm->pattern->token, "Failed to create a scope for this match arm.");
+                    continue;
+                }
+                resolve_pattern(resolver, arm->pattern, false);
+                resolver_resolve_expr(resolver, arm->body);
+                symbol_table_close_scope(resolver->sym_table);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+
+// --- Statements ---
+
+static void resolve_stmt_data(Resolver* resolver, StmtData* stmt) {
+    if (symbol_table_lookup_current(resolver->sym_table, stmt->name)) {
+        resolver_error_at_token(resolver, stmt->name, "ADT with this name already defined in the current scope.");
+        return;
+    }
+    // The type and ADTDefinition are filled in by the semantic analyzer.
+    Symbol* adt_symbol = symbol_create(SYMBOL_ADT, stmt->name, NULL);
+    if (!adt_symbol) return;
+    if (!symbol_table_define(resolver->sym_table, adt_symbol)) {
+        resolver_error_at_token(resolver, stmt->name, "Failed to define ADT symbol.");
+        symbol_destroy(adt_symbol);
+        return;
+    }
+    stmt->symbol = adt_symbol;
+}
+
+static void resolve_stmt_let(Resolver* resolver, StmtLet* stmt) {
+    // The initializer is resolved before the binding is declared, so `let x = x;`
+    // refers to an outer `x` (or is an error), never to itself.
+    resolver_resolve_expr(resolver, stmt->initializer);
+    resolver_declare_let(resolver, stmt);
+}
+
+void resolver_declare_let(Resolver* resolver, StmtLet* stmt) {
+    if (!resolver || !stmt) return;
+    if (symbol_table_lookup_current(resolver->sym_table, stmt->name)) {
+        resolver_error_at_token(resolver, stmt->name, "Variable with this name already defined in current scope.");
+        return;
+    }
+    // The type is filled in by the semantic analyzer.
+    Symbol* var_symbol = symbol_create(SYMBOL_VARIABLE, stmt->name, NULL);
+    if (!var_symbol) return;
+    var_symbol->data.var_info.is_mutable = stmt->is_mutable;
+    if (!symbol_table_define(resolver->sym_table, var_symbol)) {
+        resolver_error_at_token(resolver, stmt->name, "Failed to define variable symbol.");
+        symbol_destroy(var_symbol);
+        return;
+    }
+    stmt->symbol = var_symbol;
+}
+
+void resolver_rebind_let(Resolver* resolver, StmtLet* stmt, Symbol* symbol) {
+    if (!symbol) return;
+    resolver_resolve_declared_let(resolver, stmt, symbol, symbol->slot);
+}
+
+void resolver_resolve_declared_let(Resolver* resolver, StmtLet* stmt, Symbol* symbol, int visible_globals) {
+    if (!resolver || !stmt) return;
+    resolver->visible_globals = visible_globals;
+    resolver_resolve_expr(resolver, stmt->initializer);
+    resolver->visible_globals = -1;
+    if (symbol) symbol->data.var_info.is_mutable = stmt->is_mutable;
+    stmt->symbol = symbol;
+}
+
+void resolver_resolve_stmt(Resolver* resolver, Stmt* stmt) {
+    if (!resolver || !stmt) return;
+    switch (stmt->type) {
+        case STMT_DATA:
+            resolve_stmt_data(resolver, (StmtData*)stmt);
+            break;
+        case STMT_LET:
+            resolve_stmt_let(resolver, (StmtLet*)stmt);
+            break;
+        default:
+            break;
+    }
+}
+
+
+// --- Public API ---
+
+Resolver* resolver_create(SymbolTable* sym_table, const ConstructorIndex* constructors) {
+    Resolver* resolver = (Resolver*)malloc(sizeof(Resolver));
+    if (!resolver) return NULL;
+    resolver->sym_table = sym_table;
+    resolver->constructors = constructors;
+    resolver->diagnostics = NULL;
+    resolver->visible_globals = -1;
+    resolver->had_error = false;
+    return resolver;
+}
+
+void resolver_destroy(Resolver* resolver) {
+    free(resolver);
+}
@@ -0,0 +1,55 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "ast.h"
+#include "symbol_table.h"
+#include "constructor_index.h"
+#include "diagnostics.h"
+#include <stdbool.h>
+
+// Name resolution pass.
+// Declares every binding introduced by a statement in the symbol table (which
+// assigns it a dense slot in its scope) and annotates every variable use with
+// the binding it refers to: a direct Symbol* plus its (depth, slot) pair.
+// Type checking, ownership checking and code generation read these annotations
+// and never look names up again.
+// Constructor names (`Some`, `Nil`) are resolved through the constructor index
+// and recorded as (ADT symbol, variant tag) on the node.
+typedef struct {
+    SymbolTable* sym_table;               // Not owned; shared with the semantic analyzer
+    const ConstructorIndex* constructors; // Not owned; filled in by the analyzer as `data` declarations are analyzed
+    Diagnostics* diagnostics;             // Not owned; errors are recorded here instead of printed when set
+    int visible_globals;                  // Global bindings at or past this slot are not declared yet (-1: all visible)
+    bool had_error;
+} Resolver;
+
+// Creates a resolver that declares into the given symbol table and resolves
+// constructor names through the given index.
+Resolver* resolver_create(SymbolTable* sym_table, const ConstructorIndex* constructors);
+
+// Frees the resolver. Does not free the symbol table.
+void resolver_destroy(Resolver* resolver);
+
+// Resolves one top-level statement. Statements must be resolved in source order,
+// since a `let` only sees the bindings declared before it.
+void resolver_resolve_stmt(Resolver* resolver, Stmt* stmt);
+
+// Declares a `let`'s binding (reporting a redefinition) without resolving its
+// initializer, for lazy analysis skimming a declaration nothing reaches.
+void resolver_declare_let(Resolver* resolver, StmtLet* stmt);
+
+// Resolves a `let` whose binding is already declared as `symbol` (incremental
+// analysis re-checking an edited initializer): binds stmt to it and resolves
+// the initializer seeing only the global bindings declared before it.
+void resolver_rebind_let(Resolver* resolver, StmtLet* stmt, Symbol* symbol);
+
+// Resolves a `let` whose binding was declared ahead of time (parallel
+// analysis): binds stmt to `symbol` (NULL if its declaration failed) and
+// resolves the initializer seeing only the global bindings below slot
+// `visible_globals`. Safe to run concurrently on resolvers over worker tables.
+void resolver_resolve_declared_let(Resolver* resolver, StmtLet* stmt, Symbol* symbol, int visible_globals);
+
+// Resolves a single expression against the current scope chain.
+void resolver_resolve_expr(Resolver* resolver, Expr* expr);
+
+#endif // RESOLVER_H
@@ -2,7 +2,15 @@
 #include "ast.h"
 #include "symbol_table.h"
 #include "types.h"
+#include "resolver.h"
+#include "type_infer.h"
+#include "typeclass.h"
+#include "adt_graph.h"
 #include "token.h" // For TOKEN_INTEGER, TOKEN_STRING
+#include "borrow_check.h"
+#include "match_check.h"
+#include "reachability.h"
+#include "../util/task_graph.h"
 #include <stdio.h> // For fprintf, stderr for errors
 #include <stdlib.h> // For malloc, free
 #include <string.h> // For strncmp
@@ -14,154 +22,508 @@ static void analyze_expr(SemanticAnalyzer* analyzer, Expr* expr); // Basic versi
 // --- Error Reporting ---
 static void semantic_error_at_token(SemanticAnalyzer* analyzer, Token token, const char* message) {
     analyzer->had_error = true;
-    fprintf(stderr, "[L%d C%d at '%.*s'] Semantic Error: %s\n",
-            token.line, token.col, (int)token.length, token.lexeme, message);
+    diagnostics_report(analyzer->diagnostics, DIAG_SEMANTIC, token, message);
 }
 
 static void semantic_error_general(SemanticAnalyzer* analyzer, const char* message) {
     analyzer->had_error = true;
-    fprintf(stderr, "Semantic Error: %s\n", message);
+    diagnostics_report_general(analyzer->diagnostics, DIAG_SEMANTIC, message);
 }
 
 
-// --- Analysis of AST Nodes ---
+// --- Type Annotations ---
 
-static void analyze_stmt_data(SemanticAnalyzer* analyzer, StmtData* stmt) {
-    // 1. Check if ADT name is already defined in the current scope.
-    Symbol* existing_symbol = symbol_table_lookup_current(analyzer->sym_table, stmt->name);
-    if (existing_symbol) {
-        semantic_error_at_token(analyzer, stmt->name, "ADT with this name already defined in the current scope.");
-        // Potentially don't define this ADT to avoid further cascading errors related to it.
-        return;
+static bool token_equals(Token token, const char* name, size_t length) {
+    return token.length == length && strncmp(token.lexeme, name, length) == 0;
+}
+
+// Whether a type mentions parameters quantified by a `let` (its generalized type
+// variables). Their class constraints are not tracked; each use of the binding
+// is checked once it is instantiated.
+static bool mentions_let_params(Type* type) {
+    if (!(type->flags & TYPE_HAS_PARAMS)) return false;
+    switch (type->kind) {
+        case TYPE_GENERIC_PARAM: {
+            Symbol* owner = ((TypeGenericParam*)type)->owner;
+            return !owner || owner->kind != SYMBOL_ADT;
+        }
+        case TYPE_REFERENCE:
+            return mentions_let_params(((TypeReference*)type)->referent);
+        case TYPE_ADT: {
+            TypeADT* adt = (TypeADT*)type;
+            for (size_t i = 0; i < adt->type_arg_count; ++i) {
+                if (mentions_let_params(adt->type_args[i])) return true;
+            }
+            return false;
+        }
+        default:
+            return false;
     }
+}
 
-    // 2. Create Type objects for generic parameters (if any) and store them temporarily.
+// Checks the arguments of one ADT type against the class bounds of the ADT's
+// parameters (`data Set<T: Ord>` makes Set<X> require an Ord instance for X).
+// Resolutions are memoized per (class, type), so repeated uses are cheap.
+static void check_adt_bounds(SemanticAnalyzer* analyzer, Type* type, Token at) {
+    if (type->kind != TYPE_ADT) return;
+    TypeADT* adt = (TypeADT*)type;
+    for (size_t i = 0; i < adt->type_arg_count; ++i) {
+        size_t bound_count = 0;
+        const TypeClass* const* bounds = typeclass_param_bounds(analyzer->classes, adt->adt_symbol, (int)i, &bound_count);
+        if (bound_count == 0) continue;
+        Type* arg = adt->type_args[i];
+        if (arg->kind == TYPE_ERROR || mentions_let_params(arg)) continue;
+        for (size_t b = 0; b < bound_count; ++b) {
+            if (typeclass_resolve(analyzer->classes, bounds[b], arg)) continue;
+            char* arg_str = type_to_string(arg);
+            char msg[256];
+            snprintf(msg, sizeof(msg), "Type '%s' is not an instance of '%.*s', required by '%.*s'.",
+                     arg_str ? arg_str : "?", (int)bounds[b]->name.length, bounds[b]->name.lexeme,
+                     (int)adt->name.length, adt->name.lexeme);
+            free(arg_str);
+            semantic_error_at_token(analyzer, at, msg);
+        }
+    }
+}
+
+// check_adt_bounds for every ADT type inside `type`.
+static void check_bounds_deep(SemanticAnalyzer* analyzer, Type* type, Token at) {
+    if (type->kind == TYPE_REFERENCE) {
+        check_bounds_deep(analyzer, ((TypeReference*)type)->referent, at);
+    } else if (type->kind == TYPE_ADT) {
+        TypeADT* adt = (TypeADT*)type;
+        for (size_t i = 0; i < adt->type_arg_count; ++i) {
+            check_bounds_deep(analyzer, adt->type_args[i], at);
+        }
+        check_adt_bounds(analyzer, type, at);
+    }
+}
+
+// Resolves a written type to an interned type. `params` are the generic
+// parameters in scope (those of the ADT being defined), or NULL.
+// Errors are reported and yield type_error().
+static Type* resolve_type_annotation(SemanticAnalyzer* analyzer, TypeAnnotation* annot, DynamicArray* params) {
+    if (!annot) return type_error();
+    if (annot->referent) {
+        Type* referent = resolve_type_annotation(analyzer, annot->referent, params);
+        return type_intern_reference(referent, annot->is_mutable);
+    }
+    size_t arg_count = da_count(annot->args);
+
+    for (size_t i = 0; i < da_count(params); ++i) {
+        TypeGenericParam* param = (TypeGenericParam*)da_get(params, i);
+        if (token_equals(annot->name, param->name.lexeme, param->name.length)) {
+            if (arg_count > 0) {
+                semantic_error_at_token(analyzer, annot->name, "Type parameter cannot take type arguments.");
+                return type_error();
+            }
+            return (Type*)param;
+        }
+    }
+
+    Type* predefined[] = {type_i32_instance, type_string_instance, type_bool_instance};
+    for (size_t i = 0; i < sizeof(predefined) / sizeof(predefined[0]); ++i) {
+        Token name = ((TypePrimitive*)predefined[i])->name;
+        if (token_equals(annot->name, name.lexeme, name.length)) {
+            if (arg_count > 0) {
+                semantic_error_at_token(analyzer, annot->name, "Primitive type cannot take type arguments.");
+                return type_error();
+            }
+            return predefined[i];
+        }
+    }
+
+    Symbol* sym = symbol_table_lookup(analyzer->sym_table, annot->name);
+    if (!sym || sym->kind != SYMBOL_ADT) {
+        semantic_error_at_token(analyzer, annot->name, "Unknown type name.");
+        return type_error();
+    }
+    // Every ADT header is declared before any body is analyzed, so this works
+    // for forward and mutually recursive references too.
+    size_t expected = sym->data.adt_def ? da_count(sym->data.adt_def->type_params) : 0;
+    if (arg_count != expected) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Wrong number of type arguments: expected %zu but got %zu.", expected, arg_count);
+        semantic_error_at_token(analyzer, annot->name, msg);
+        return type_error();
+    }
+
+    Type* stack_args[8];
+    Type** args = arg_count <= 8 ? stack_args : (Type**)malloc(arg_count * sizeof(Type*));
+    if (!args) return type_error();
+    for (size_t i = 0; i < arg_count; ++i) {
+        args[i] = resolve_type_annotation(analyzer, (TypeAnnotation*)da_get(annot->args, i), params);
+    }
+    Type* type = type_intern_adt(sym, args, arg_count);
+    if (args != stack_args) free(args);
+    return type ? type : type_error();
+}
+
+// Resolves the class names of each parameter's bounds (`T: Ord + Show`) and
+// records them for the parameters of `owner`. Unknown names are reported.
+static void declare_param_bounds(SemanticAnalyzer* analyzer, Symbol* owner, DynamicArray* param_bounds) {
+    for (size_t i = 0; i < da_count(param_bounds); ++i) {
+        DynamicArray* names = (DynamicArray*)da_get(param_bounds, i);
+        size_t count = da_count(names);
+        if (count == 0) continue;
+        const TypeClass** classes = (const TypeClass**)malloc(count * sizeof(TypeClass*));
+        if (!classes) return;
+        size_t resolved = 0;
+        for (size_t j = 0; j < count; ++j) {
+            Token name = *(Token*)da_get(names, j);
+            const TypeClass* cls = typeclass_find(analyzer->classes, name);
+            if (!cls) {
+                semantic_error_at_token(analyzer, name, "Unknown class name.");
+                continue;
+            }
+            classes[resolved++] = cls;
+        }
+        typeclass_set_param_bounds(analyzer->classes, owner, (int)i, classes, resolved);
+        free(classes);
+    }
+}
+
+
+// --- Analysis of AST Nodes ---
+
+// Declares an ADT's header: its parameters, their class bounds and its own type,
+// with no variants yet. Headers of all ADTs are declared before any body, so
+// field types can name ADTs declared later in the file.
+static void declare_adt_header(SemanticAnalyzer* analyzer, StmtData* stmt) {
+    // 1. The resolver has already declared the ADT symbol (and reported redefinitions).
+    //    If it could not be declared, skip it to avoid cascading errors.
+    Symbol* adt_symbol = stmt->symbol;
+    if (!adt_symbol) return;
+
+    // 2. Create Type objects for generic parameters (if any).
     //    These are not added to the main symbol table here but are part of ADTDefinition.
     DynamicArray* generic_param_types = da_create(da_count(stmt->type_params), sizeof(Type*));
     if (stmt->type_params) {
         for (size_t i = 0; i < da_count(stmt->type_params); ++i) {
             Token* param_token = (Token*)da_get(stmt->type_params, i); // These are Token* from parser
             // TODO: Check for duplicate type parameter names within this ADT's definition.
-            Type* generic_type = type_generic_param_create(*param_token);
+            Type* generic_type = type_intern_generic_param(adt_symbol, (int)i, *param_token);
             da_push(generic_param_types, generic_type);
         }
     }
+    // Bounds are known before any field, so `data Set<T: Ord> { Node(T, Set<T>) }` checks.
+    declare_param_bounds(analyzer, adt_symbol, stmt->param_bounds);
 
-    // 3. Create ADTDefinition structure (for symbol table)
-    //    This involves converting AST ADTVariants/Fields to ADTVariantSymbol/FieldSymbol
-    //    and resolving field types (placeholder for now, will be more complex).
-    DynamicArray* variant_symbols = da_create(da_count(stmt->variants), sizeof(ADTVariantSymbol*));
+    // 3. The main Type for the ADT itself: its arguments are its own parameters,
+    //    so `data Option<T>` has type Option<T>.
+    ADTDefinition* adt_def = adt_definition_create(stmt->name, generic_param_types,
+                                                   da_create(da_count(stmt->variants), sizeof(ADTVariantSymbol*)));
+    Type* adt_self_type = type_intern_adt(adt_symbol, (Type**)generic_param_types->items, da_count(generic_param_types));
+
+    // The symbol (owned by the symbol table) now owns adt_def; the type is interned.
+    adt_symbol->type = adt_self_type;
+    adt_symbol->data.adt_def = adt_def;
+}
+
+// Fills in the variants of an ADT whose header is declared: converts AST
+// ADTVariants/Fields to ADTVariantSymbol/FieldSymbol and resolves field types
+// against the parameters, primitives and declared ADTs.
+static void analyze_stmt_data(SemanticAnalyzer* analyzer, StmtData* stmt) {
+    Symbol* adt_symbol = stmt->symbol;
+    ADTDefinition* adt_def = adt_symbol ? adt_symbol->data.adt_def : NULL;
+    if (!adt_def) return;
+
+    DynamicArray* variant_symbols = adt_def->variants;
     for (size_t i = 0; i < da_count(stmt->variants); ++i) {
         ADTVariant* ast_variant = (ADTVariant*)da_get(stmt->variants, i);
-        // TODO: Check for duplicate variant names within this ADT.
 
         DynamicArray* field_symbols = NULL;
         if (ast_variant->fields && da_count(ast_variant->fields) > 0) {
             field_symbols = da_create(da_count(ast_variant->fields), sizeof(ADTFieldSymbol*));
             for (size_t j = 0; j < da_count(ast_variant->fields); ++j) {
                 ADTVariantField* ast_field = (ADTVariantField*)da_get(ast_variant->fields, j);
-                // Resolve ast_field->type_name_token to a Type*.
-                // For Phase 1: This is simplified. We'd look up type_name_token in scope
-                // (including generic_param_types).
-                Type* field_type = type_unknown_create(); // Placeholder
-                // Example of basic resolution (needs much more work):
-                // If ast_field->type_name_token matches a generic param, use that TypeGenericParam.
-                // Else if it matches a known primitive (i32, String), use that.
-                // Else if it matches another defined ADT, create a TypeADT for it.
-                // Else, error: unknown type.
-                // For now, all fields are <unknown>.
-                // TODO: Implement proper type resolution for fields.
+                Type* field_type = resolve_type_annotation(analyzer, ast_field->type_annot, adt_def->type_params);
 
                 ADTFieldSymbol* field_sym = adt_field_symbol_create(ast_field->name, field_type);
                 da_push(field_symbols, field_sym);
             }
         }
         ADTVariantSymbol* var_sym = adt_variant_symbol_create(ast_variant->name, field_symbols);
+
+        // Register the constructor. The index doubles as the duplicate-variant check,
+        // both within this ADT and against the constructors of other ADTs.
+        int tag = (int)da_count(variant_symbols);
+        const ConstructorEntry* existing = NULL;
+        if (!constructor_index_insert(analyzer->constructors, ast_variant->name, adt_symbol, var_sym,
+                                      tag, (int)da_count(field_symbols), &existing)) {
+            if (existing && existing->adt_symbol == adt_symbol) {
+                semantic_error_at_token(analyzer, ast_variant->name, "Duplicate variant name in this ADT.");
+            } else if (existing) {
+                semantic_error_at_token(analyzer, ast_variant->name, "Variant name already defined by another ADT.");
+            } else {
+                semantic_error_at_token(analyzer, ast_variant->name, "Failed to register variant.");
+            }
+            adt_variant_symbol_destroy(var_sym); // Dropped so tags stay dense
+            continue;
+        }
         da_push(variant_symbols, var_sym);
     }
+}
 
-    ADTDefinition* adt_def = adt_definition_create(stmt->name, generic_param_types, variant_symbols);
+// Registers the constructors of an ADT nothing reachable uses, so their names
+// are taken (and duplicates reported) as in a full analysis, without resolving
+// any field type. The ADT keeps no variants.
+static void skim_stmt_data(SemanticAnalyzer* analyzer, StmtData* stmt) {
+    Symbol* adt_symbol = stmt->symbol;
+    if (!adt_symbol || !adt_symbol->data.adt_def) return;
+    int tag = 0;
+    for (size_t i = 0; i < da_count(stmt->variants); ++i) {
+        ADTVariant* ast_variant = (ADTVariant*)da_get(stmt->variants, i);
+        const ConstructorEntry* existing = NULL;
+        if (constructor_index_insert(analyzer->constructors, ast_variant->name, adt_symbol, NULL, tag,
+                                     (int)da_count(ast_variant->fields), &existing)) {
+            tag++;
+        } else if (existing && existing->adt_symbol == adt_symbol) {
+            semantic_error_at_token(analyzer, ast_variant->name, "Duplicate variant name in this ADT.");
+        } else if (existing) {
+            semantic_error_at_token(analyzer, ast_variant->name, "Variant name already defined by another ADT.");
+        } else {
+            semantic_error_at_token(analyzer, ast_variant->name, "Failed to register variant.");
+        }
+    }
+}
 
-    // 4. Create the main Type for the ADT itself (e.g., Option<T> becomes a TypeADT instance)
-    //    This self-referential type might be tricky. The TypeADT would have its type_args
-    //    pointing to the TypeGenericParams created in step 2.
-    //    For now, let's make a simpler TypeADT that just refers to the definition by name.
-    //    A more complete TypeADT would involve cloning generic_param_types for its type_args.
-    Type* adt_self_type = type_adt_create(stmt->name, da_create(0, sizeof(Type*)) /* no concrete args here */, NULL);
-    // The adt_symbol field in TypeADT will be set after the symbol is created.
+// Builds the ADT dependency graph once every body is analyzed: decides which
+// fields are boxed and reports recursive ADTs that have no finite value. Then
+// checks field types against class bounds.
+static void analyze_adt_graph(SemanticAnalyzer* analyzer, Program* program) {
+    DynamicArray* adt_symbols = da_create(16, sizeof(Symbol*));
+    for (size_t i = 0; i < da_count(program->statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(program->statements, i);
+        if (stmt->type == STMT_DATA && ((StmtData*)stmt)->symbol && ((StmtData*)stmt)->symbol->data.adt_def) {
+            da_push(adt_symbols, ((StmtData*)stmt)->symbol);
+        }
+    }
+    adt_graph_destroy(analyzer->adt_graph);
+    analyzer->adt_graph = adt_graph_build(adt_symbols);
 
-    Symbol* adt_symbol = symbol_create(SYMBOL_ADT, stmt->name, adt_self_type);
-    adt_symbol->data.adt_def = adt_def;
-    ((TypeADT*)adt_self_type)->adt_symbol = adt_symbol; // Link back from type to symbol
+    // In source order, so diagnostics are stable.
+    for (size_t i = 0; analyzer->adt_graph && i < da_count(adt_symbols); ++i) {
+        ADTDefinition* def = ((Symbol*)da_get(adt_symbols, i))->data.adt_def;
+        if (def->recursive && !def->inhabited) {
+            semantic_error_at_token(analyzer, def->name,
+                                    "Recursive type has infinite size: every variant refers back to it.");
+        }
+    }
+    da_destroy(adt_symbols);
 
-    if (!symbol_table_define(analyzer->sym_table, adt_symbol)) {
-        // This should have been caught by lookup_current, but as a safeguard:
-        semantic_error_at_token(analyzer, stmt->name, "Failed to define ADT symbol (should be caught earlier).");
-        symbol_destroy(adt_symbol); // adt_symbol owns its type and adt_def
-    } else {
-        // Successfully defined.
-        // The adt_def now owns generic_param_types and variant_symbols.
-        // The adt_symbol now owns adt_self_type and adt_def.
+    // Field types are checked against class bounds only now: deriving Copy looks
+    // at field types, which must all be resolved (and boxed) first.
+    for (size_t i = 0; i < da_count(program->statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(program->statements, i);
+        if (stmt->type != STMT_DATA || !((StmtData*)stmt)->symbol) continue;
+        StmtData* data_stmt = (StmtData*)stmt;
+        ADTDefinition* def = data_stmt->symbol->data.adt_def;
+        for (size_t v = 0; def && v < da_count(def->variants); ++v) {
+            ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(def->variants, v);
+            for (size_t f = 0; f < da_count(variant->fields); ++f) {
+                ADTFieldSymbol* field = (ADTFieldSymbol*)da_get(variant->fields, f);
+                check_bounds_deep(analyzer, field->type, variant->name);
+            }
+        }
     }
 }
 
 static void analyze_stmt_let(SemanticAnalyzer* analyzer, StmtLet* stmt) {
-    // 1. Check if variable name is already defined in the current scope.
-    if (symbol_table_lookup_current(analyzer->sym_table, stmt->name)) {
-        semantic_error_at_token(analyzer, stmt->name, "Variable with this name already defined in current scope.");
-        // Don't define this variable to avoid further errors.
-        // If there was an initializer, it still needs to be analyzed for its own errors/type.
-        if (stmt->initializer) analyze_expr(analyzer, stmt->initializer);
+    // 1. The resolver has already declared the binding (and reported redefinitions).
+    //    The initializer still needs to be analyzed for its own errors either way.
+    if (stmt->initializer) analyze_expr(analyzer, stmt->initializer);
+    Symbol* var_symbol = stmt->symbol;
+    if (!var_symbol) return;
+
+    Type* annotation = NULL;
+    if (stmt->type_annot) {
+        annotation = resolve_type_annotation(analyzer, stmt->type_annot, NULL);
+    }
+
+    // Hindley-Milner inference over the initializer; the result is generalized,
+    // so e.g. `let none = None;` can be used at any Option type.
+    size_t type_errors = type_inferencer_error_count(analyzer->inferencer);
+    Type* var_type = type_infer_let(analyzer->inferencer, var_symbol, stmt->initializer, annotation);
+
+    var_symbol->type = var_type;
+
+    // Exhaustiveness needs well-typed patterns; after a type error it would only add noise.
+    if (stmt->initializer && type_inferencer_error_count(analyzer->inferencer) == type_errors &&
+        !match_check_expr(stmt->initializer, analyzer->diagnostics)) {
+        analyzer->had_error = true;
+    }
+
+    // Class bounds of the ADTs in the binding's type (the annotation, if written).
+    check_bounds_deep(analyzer, annotation ? annotation : var_type, stmt->name);
+
+    // Record the specializations this binding needs (Option<i32>, List<i32>, ...).
+    adt_instance_require(analyzer->instances, var_type);
+}
+
+static void analyze_stmt_class(SemanticAnalyzer* analyzer, StmtClass* stmt) {
+    const TypeClass* superclass = NULL;
+    if (stmt->superclass.length > 0) {
+        superclass = typeclass_find(analyzer->classes, stmt->superclass);
+        if (!superclass) {
+            semantic_error_at_token(analyzer, stmt->superclass, "Unknown superclass name.");
+            return;
+        }
+    }
+    TypeClassError error;
+    if (!typeclass_declare(analyzer->classes, stmt->name, superclass, stmt->methods, &error)) {
+        semantic_error_at_token(analyzer, stmt->name,
+                                error == TYPECLASS_DUPLICATE_CLASS ? "Class already defined."
+                                : error == TYPECLASS_DUPLICATE_METHOD ? "Duplicate method name in this class or its superclasses."
+                                : "Failed to declare class.");
+    }
+}
+
+// Index of the instance parameter named `name`, or -1.
+static int find_type_param(DynamicArray* type_params, Token name) {
+    for (size_t i = 0; i < da_count(type_params); ++i) {
+        if (token_equals(name, ((Token*)da_get(type_params, i))->lexeme, ((Token*)da_get(type_params, i))->length)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// The written head argument must be one of the instance's own parameters; returns its index.
+static int instance_head_param(SemanticAnalyzer* analyzer, StmtInstance* stmt, TypeAnnotation* arg, bool* used) {
+    int param = arg->referent || da_count(arg->args) > 0 ? -1 : find_type_param(stmt->type_params, arg->name);
+    if (param < 0) {
+        semantic_error_at_token(analyzer, arg->name, "Instance head arguments must be the instance's type parameters.");
+        return -1;
+    }
+    if (used[param]) {
+        semantic_error_at_token(analyzer, arg->name, "Type parameter repeated in instance head.");
+        return -1;
+    }
+    used[param] = true;
+    return param;
+}
+
+static void analyze_stmt_instance(SemanticAnalyzer* analyzer, StmtInstance* stmt) {
+    const TypeClass* cls = typeclass_find(analyzer->classes, stmt->class_name);
+    if (!cls) {
+        semantic_error_at_token(analyzer, stmt->class_name, "Unknown class name.");
         return;
     }
+    size_t param_count = da_count(stmt->type_params);
+    bool* used = (bool*)calloc(param_count ? param_count : 1, sizeof(bool));
+    int* arg_params = NULL;
+    ClassConstraint* constraints = NULL;
+    if (!used) return;
 
-    Type* var_type = type_unknown_create(); // Default to unknown
-
-    if (stmt->initializer) {
-        analyze_expr(analyzer, stmt->initializer); // Analyze initializer first
-
-        // Infer type from initializer (very basic for Phase 1)
-        // In a full system, expr analysis would annotate the Expr node with its type.
-        // For now, directly inspect the initializer expression type.
-        if (stmt->initializer->type == EXPR_LITERAL) {
-            ExprLiteral* lit_expr = (ExprLiteral*)stmt->initializer;
-            if (lit_expr->literal.type == TOKEN_INTEGER) {
-                type_destroy(var_type); // Destroy the old unknown
-                var_type = type_i32_instance; // Use global predefined i32 type
-            } else if (lit_expr->literal.type == TOKEN_STRING) {
-                type_destroy(var_type);
-                var_type = type_string_instance; // Use global predefined String type
-            }
-            // Add other literals like bool, float later
-        } else if (stmt->initializer->type == EXPR_VARIABLE) {
-            // ExprVariable* var_expr_init = (ExprVariable*)stmt->initializer;
-            // Symbol* init_sym = symbol_table_lookup(analyzer->sym_table, var_expr_init->name);
-            // if (init_sym && init_sym->type) {
-            //     type_destroy(var_type);
-            //     var_type = type_clone(init_sym->type); // Need type_clone if types are complex and owned
-            //                                        // For shared primitives, direct assignment is fine.
-            // } else {
-            //     semantic_error_at_token(analyzer, var_expr_init->name, "Cannot infer type from undefined variable.");
-            // }
-            // For Phase 1, let's assume if it's a variable, its type is already known or this is complex.
-            // We are not doing full type inference yet, so this part is simplified.
-            // The type remains <unknown> if not a simple literal.
-        }
-        // ADT instantiation as initializer is not handled yet for type inference.
-    }
-    // TODO: Handle explicit type annotations on `let` if syntax allows.
-
-    Symbol* var_symbol = symbol_create(SYMBOL_VARIABLE, stmt->name, var_type);
-    // var_symbol->data.var_info.is_mutable = stmt->is_mutable;
-
-    if (!symbol_table_define(analyzer->sym_table, var_symbol)) {
-        // Should be caught by lookup_current, but safeguard.
-        semantic_error_at_token(analyzer, stmt->name, "Failed to define variable symbol.");
-        symbol_destroy(var_symbol); // var_symbol owns its type
+    // The head is a primitive, `&T` / `&mut T`, or an ADT applied to distinct parameters.
+    TypeAnnotation* head = stmt->head;
+    InstanceHeadKind kind = INSTANCE_HEAD_PRIMITIVE;
+    const void* head_key = NULL;
+    size_t arg_count = 0;
+    bool ok = true;
+    if (head->referent) {
+        kind = head->is_mutable ? INSTANCE_HEAD_REF_MUT : INSTANCE_HEAD_REF;
+        arg_count = 1;
+        arg_params = (int*)malloc(sizeof(int));
+        ok = arg_params && (arg_params[0] = instance_head_param(analyzer, stmt, head->referent, used)) >= 0;
+    } else if (find_type_param(stmt->type_params, head->name) >= 0) {
+        semantic_error_at_token(analyzer, head->name, "Instance head must be a type constructor, not a type parameter.");
+        ok = false;
+    } else if (!head->args) {
+        Type* head_type = resolve_type_annotation(analyzer, head, NULL);
+        if (head_type->kind == TYPE_PRIMITIVE) {
+            head_key = head_type;
+        } else if (head_type->kind == TYPE_ADT) {
+            kind = INSTANCE_HEAD_ADT;
+            head_key = ((TypeADT*)head_type)->adt_symbol;
+        } else {
+            ok = false; // Already reported
+        }
     } else {
-         // If var_type was a shared primitive, symbol_destroy won't double-free.
-         // If it was a newly allocated <unknown>, symbol_destroy will handle it.
+        Symbol* sym = symbol_table_lookup(analyzer->sym_table, head->name);
+        size_t expected = sym && sym->kind == SYMBOL_ADT && sym->data.adt_def
+                        ? da_count(sym->data.adt_def->type_params) : 0;
+        arg_count = da_count(head->args);
+        if (!sym || sym->kind != SYMBOL_ADT || !sym->data.adt_def) {
+            semantic_error_at_token(analyzer, head->name, "Unknown type name.");
+            ok = false;
+        } else if (arg_count != expected) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Wrong number of type arguments: expected %zu but got %zu.", expected, arg_count);
+            semantic_error_at_token(analyzer, head->name, msg);
+            ok = false;
+        }
+        kind = INSTANCE_HEAD_ADT;
+        head_key = sym;
+        arg_params = (int*)malloc((arg_count ? arg_count : 1) * sizeof(int));
+        ok = ok && arg_params;
+        for (size_t i = 0; ok && i < arg_count; ++i) {
+            arg_params[i] = instance_head_param(analyzer, stmt, (TypeAnnotation*)da_get(head->args, i), used);
+            ok = arg_params[i] >= 0;
+        }
+    }
+    for (size_t i = 0; ok && i < param_count; ++i) {
+        if (!used[i]) {
+            semantic_error_at_token(analyzer, *(Token*)da_get(stmt->type_params, i),
+                                    "Instance type parameter does not appear in the instance head.");
+            ok = false;
+        }
+    }
+
+    // Constraints from the parameter bounds: `instance<T: Eq> Eq for List<T>`.
+    size_t constraint_count = 0;
+    for (size_t i = 0; i < da_count(stmt->param_bounds); ++i) {
+        constraint_count += da_count((DynamicArray*)da_get(stmt->param_bounds, i));
+    }
+    constraints = (ClassConstraint*)malloc((constraint_count ? constraint_count : 1) * sizeof(ClassConstraint));
+    ok = ok && constraints;
+    size_t resolved = 0;
+    for (size_t i = 0; ok && i < da_count(stmt->param_bounds); ++i) {
+        DynamicArray* names = (DynamicArray*)da_get(stmt->param_bounds, i);
+        for (size_t j = 0; j < da_count(names); ++j) {
+            Token name = *(Token*)da_get(names, j);
+            const TypeClass* bound = typeclass_find(analyzer->classes, name);
+            if (!bound) {
+                semantic_error_at_token(analyzer, name, "Unknown class name.");
+                ok = false;
+                continue;
+            }
+            constraints[resolved].cls = bound;
+            constraints[resolved].param = (int)i;
+            resolved++;
+        }
     }
+
+    if (ok) {
+        TypeClassError error;
+        const ClassInstance* existing = NULL;
+        if (!typeclass_declare_instance(analyzer->classes, cls, head->name, kind, head_key, arg_params, arg_count,
+                                        param_count, constraints, resolved, &error, &existing)) {
+            char msg[256];
+            switch (error) {
+                case TYPECLASS_OVERLAP:
+                    snprintf(msg, sizeof(msg), "Overlapping instance: '%.*s' already has an instance for this type (L%d C%d).",
+                             (int)cls->name.length, cls->name.lexeme, existing->location.line, existing->location.col);
+                    break;
+                case TYPECLASS_MISSING_SUPERCLASS:
+                    snprintf(msg, sizeof(msg), "Missing instance of superclass '%.*s' for this type.",
+                             (int)cls->superclass->name.length, cls->superclass->name.lexeme);
+                    break;
+                case TYPECLASS_DERIVED_CLASS:
+                    snprintf(msg, sizeof(msg), "Instances of '%.*s' are derived and cannot be declared.",
+                             (int)cls->name.length, cls->name.lexeme);
+                    break;
+                default:
+                    snprintf(msg, sizeof(msg), "Failed to declare instance.");
+                    break;
+            }
+            semantic_error_at_token(analyzer, stmt->class_name, msg);
+        }
+    }
+    free(used);
+    free(arg_params);
+    free(constraints);
 }
 
 
@@ -174,6 +536,12 @@ static void analyze_stmt(SemanticAnalyzer* analyzer, Stmt* stmt) {
         case STMT_LET:
             analyze_stmt_let(analyzer, (StmtLet*)stmt);
             break;
+        case STMT_CLASS:
+            analyze_stmt_class(analyzer, (StmtClass*)stmt);
+            break;
+        case STMT_INSTANCE:
+            analyze_stmt_instance(analyzer, (StmtInstance*)stmt);
+            break;
         // Other statements like STMT_EXPRESSION, STMT_IF, etc.
         default:
             // Should not happen if parser produces valid StmtTypes
@@ -181,22 +549,82 @@ static void analyze_stmt(SemanticAnalyzer* analyzer, Stmt* stmt) {
     }
 }
 
+// Checks a constructor application against the variant's field count.
+static void check_constructor_arity(SemanticAnalyzer* analyzer, Token name, Symbol* adt_symbol, int tag, size_t arg_count) {
+    ADTDefinition* def = adt_symbol->data.adt_def;
+    ADTVariantSymbol* variant = def ? (ADTVariantSymbol*)da_get(def->variants, (size_t)tag) : NULL;
+    if (!variant) return;
+    size_t arity = da_count(variant->fields);
+    if (arity != arg_count) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Constructor expects %zu argument(s) but got %zu.", arity, arg_count);
+        semantic_error_at_token(analyzer, name, msg);
+    }
+}
+
+// Integer literals must fit in an i32; nothing wraps them.
+static void check_literal(SemanticAnalyzer* analyzer, Token literal) {
+    int32_t value;
+    if (literal.type == TOKEN_INTEGER && !token_integer_value(literal, &value)) {
+        semantic_error_at_token(analyzer, literal, "Integer literal out of range for i32.");
+    }
+}
+
+// Checks the constructor arities and literals of a match pattern.
+static void analyze_pattern(SemanticAnalyzer* analyzer, Pattern* pattern) {
+    if (!pattern) return;
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        analyze_pattern(analyzer, (Pattern*)da_get(pattern->subpatterns, i));
+    }
+    if ((pattern->kind == PATTERN_CONSTRUCTOR || pattern->kind == PATTERN_BINDING) && pattern->constructor_adt) {
+        check_constructor_arity(analyzer, pattern->token, pattern->constructor_adt, pattern->constructor_tag,
+                                da_count(pattern->subpatterns));
+    }
+    if (pattern->kind == PATTERN_LITERAL) check_literal(analyzer, pattern->token);
+}
+
 // Basic expression analysis (placeholder for Phase 1, mostly for initializers)
 static void analyze_expr(SemanticAnalyzer* analyzer, Expr* expr) {
     if (!expr) return;
     switch (expr->type) {
         case EXPR_LITERAL:
-            // No specific analysis for literals in Phase 1 beyond what `analyze_stmt_let` does.
-            // Later, could validate literal format or attach precise type.
+            check_literal(analyzer, ((ExprLiteral*)expr)->literal);
             break;
         case EXPR_VARIABLE: {
-            // ExprVariable* var_expr = (ExprVariable*)expr;
-            // Symbol* sym = symbol_table_lookup(analyzer->sym_table, var_expr->name);
-            // if (!sym) {
-            //     semantic_error_at_token(analyzer, var_expr->name, "Undefined variable.");
-            // } else {
-            //     // Annotate var_expr with sym->type or sym itself.
-            // }
+            // Already bound by the resolver (ExprVariable.symbol / depth / slot);
+            // undefined names were reported there.
+            ExprVariable* var_expr = (ExprVariable*)expr;
+            if (var_expr->constructor_adt) { // Bare constructor: must be nullary
+                check_constructor_arity(analyzer, var_expr->name, var_expr->constructor_adt,
+                                        var_expr->constructor_tag, 0);
+            }
+            break;
+        }
+        case EXPR_CALL: {
+            ExprCall* call_expr = (ExprCall*)expr;
+            for (size_t i = 0; i < da_count(call_expr->arguments); ++i) {
+                analyze_expr(analyzer, (Expr*)da_get(call_expr->arguments, i));
+            }
+            if (call_expr->constructor_adt) {
+                check_constructor_arity(analyzer, ((ExprVariable*)call_expr->callee)->name,
+                                        call_expr->constructor_adt, call_expr->constructor_tag,
+                                        da_count(call_expr->arguments));
+            }
+            break;
+        }
+        case EXPR_BORROW:
+            // Borrow rules are checked once the whole program is typed (borrow_check.h).
+            analyze_expr(analyzer, ((ExprBorrow*)expr)->operand);
+            break;
+        case EXPR_MATCH: {
+            // Exhaustiveness is checked after inference (match_check.h).
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            analyze_expr(analyzer, match_expr->scrutinee);
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                analyze_pattern(analyzer, arm->pattern);
+                analyze_expr(analyzer, arm->body);
+            }
             break;
         }
         // Other expressions
@@ -206,6 +634,255 @@ static void analyze_expr(SemanticAnalyzer* analyzer, Expr* expr) {
 }
 
 
+// --- Parallel Let Analysis ---
+
+// Below this many statements, threads cost more than they save.
+#define PARALLEL_MIN_STATEMENTS 256
+
+typedef struct {
+    Stmt* stmt;
+    Diagnostics* diagnostics; // Declaration and resolution errors, then analysis errors; NULL if none
+    Symbol* declared;         // The binding a `let` declares, NULL if its declaration failed
+    int visible_globals;      // Global bindings from this slot on are declared after the statement
+    bool done;
+} StatementTask;
+
+typedef struct {
+    StatementTask* tasks;
+    SemanticAnalyzer* workers; // Per thread: the analyzer with its own inferencer, sink, resolver and symbol table
+    GlobalSymbolTable* globals;
+} StatementSchedule;
+
+static void statement_error(StatementTask* task, const char* source, Token at, const char* message) {
+    if (!task->diagnostics) task->diagnostics = diagnostics_create(source);
+    diagnostics_report(task->diagnostics, DIAG_SEMANTIC, at, message);
+}
+
+// Moves what a worker recorded while running `task` into the task's own sink.
+static void keep_statement_errors(StatementTask* task, Diagnostics* worker_sink) {
+    if (diagnostics_count(worker_sink) == 0) return;
+    if (!task->diagnostics) task->diagnostics = diagnostics_create(diagnostics_source(worker_sink));
+    if (task->diagnostics) diagnostics_append(task->diagnostics, worker_sink);
+}
+
+// Runs `run` for every statement on the worker pool. The tasks of a phase are
+// independent: a graph without edges can only fail before running any of them,
+// and then they all run in order on this thread.
+static void run_statement_phase(size_t n, size_t jobs, void (*run)(size_t, size_t, void*), StatementSchedule* schedule) {
+    TaskGraph* graph = task_graph_create(n);
+    if (!graph || !task_graph_run(graph, jobs, run, schedule)) {
+        for (size_t i = 0; i < n; ++i) run(i, 0, schedule);
+    }
+    task_graph_destroy(graph);
+}
+
+// Declares a `let`'s binding in the shared global table, keyed by statement
+// index: whichever thread gets there first, the earliest definition of a name
+// wins and the others become conflicts.
+static void declare_statement_task(size_t task, size_t worker, void* ctx) {
+    StatementSchedule* schedule = (StatementSchedule*)ctx;
+    StatementTask* t = &schedule->tasks[task];
+    if (t->stmt->type != STMT_LET) return;
+    StmtLet* let = (StmtLet*)t->stmt;
+    SemanticAnalyzer* analyzer = &schedule->workers[worker];
+    if (scope_lookup_current(analyzer->sym_table->global_scope, let->name)) { // An ADT
+        analyzer->resolver->had_error = true;
+        statement_error(t, diagnostics_source(analyzer->diagnostics), let->name,
+                        "Variable with this name already defined in current scope.");
+        return;
+    }
+    // The type is filled in by the semantic analyzer.
+    Symbol* symbol = symbol_create(SYMBOL_VARIABLE, let->name, NULL);
+    if (!symbol) return;
+    symbol->data.var_info.is_mutable = let->is_mutable;
+    t->declared = symbol;
+    global_symbol_table_define(schedule->globals, symbol, task);
+}
+
+static void resolve_statement_task(size_t task, size_t worker, void* ctx) {
+    StatementSchedule* schedule = (StatementSchedule*)ctx;
+    SemanticAnalyzer* analyzer = &schedule->workers[worker];
+    StatementTask* t = &schedule->tasks[task];
+    diagnostics_reset(analyzer->diagnostics, diagnostics_source(analyzer->diagnostics));
+    if (t->stmt->type == STMT_LET) {
+        resolver_resolve_declared_let(analyzer->resolver, (StmtLet*)t->stmt, t->declared, t->visible_globals);
+    } else {
+        resolver_resolve_stmt(analyzer->resolver, t->stmt);
+    }
+    keep_statement_errors(t, analyzer->diagnostics);
+}
+
+// Adds an edge from the `let` that declares each global binding used in `expr` to `task`.
+// Returns false if an edge could not be added.
+static bool add_binding_dependencies(TaskGraph* graph, const int* task_of_slot, size_t slot_count, Expr* expr, size_t task) {
+    if (!expr) return true;
+    switch (expr->type) {
+        case EXPR_VARIABLE: {
+            Symbol* sym = ((ExprVariable*)expr)->symbol;
+            if (!sym || sym->kind != SYMBOL_VARIABLE || sym->depth != 0) return true;
+            if ((size_t)sym->slot < slot_count && task_of_slot[sym->slot] >= 0) {
+                return task_graph_add_edge(graph, (size_t)task_of_slot[sym->slot], task);
+            }
+            return true;
+        }
+        case EXPR_CALL: {
+            ExprCall* call = (ExprCall*)expr;
+            if (!add_binding_dependencies(graph, task_of_slot, slot_count, call->callee, task)) return false;
+            for (size_t i = 0; i < da_count(call->arguments); ++i) {
+                if (!add_binding_dependencies(graph, task_of_slot, slot_count, (Expr*)da_get(call->arguments, i), task)) return false;
+            }
+            return true;
+        }
+        case EXPR_BORROW:
+            return add_binding_dependencies(graph, task_of_slot, slot_count, ((ExprBorrow*)expr)->operand, task);
+        case EXPR_MATCH: {
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            if (!add_binding_dependencies(graph, task_of_slot, slot_count, match_expr->scrutinee, task)) return false;
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                if (!add_binding_dependencies(graph, task_of_slot, slot_count,
+                                              ((MatchArm*)da_get(match_expr->arms, i))->body, task)) return false;
+            }
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+static void run_statement_task(size_t task, size_t worker, void* ctx) {
+    StatementSchedule* schedule = (StatementSchedule*)ctx;
+    SemanticAnalyzer* analyzer = &schedule->workers[worker];
+    schedule->tasks[task].done = true;
+    diagnostics_reset(analyzer->diagnostics, diagnostics_source(analyzer->diagnostics));
+    analyze_stmt(analyzer, schedule->tasks[task].stmt);
+    keep_statement_errors(&schedule->tasks[task], analyzer->diagnostics);
+}
+
+static void destroy_workers(SemanticAnalyzer* analyzer, SemanticAnalyzer* workers, size_t jobs) {
+    for (size_t w = 0; workers && w < jobs; ++w) {
+        if (workers[w].resolver && workers[w].resolver->had_error) analyzer->resolver->had_error = true;
+        resolver_destroy(workers[w].resolver);
+        symbol_table_destroy_worker(workers[w].sym_table, analyzer->sym_table);
+        type_inferencer_destroy(workers[w].inferencer);
+        diagnostics_destroy(workers[w].diagnostics);
+    }
+    free(workers);
+}
+
+// Analyzes the statements that follow the declarations (the `let`s) on
+// analyzer->jobs threads, in three phases:
+//  1. Every `let` declares its binding concurrently in a sharded global table
+//     (global_symbol_table.h). Redefinitions are decided by statement index,
+//     so the same one is reported whatever the thread timing, and bindings get
+//     their slots in source order.
+//  2. Initializers are resolved concurrently, each thread with its own scope
+//     stack over the global scope and the shared bindings, seeing only the
+//     bindings declared before the statement.
+//  3. A `let` depends on the earlier `let`s whose bindings its initializer
+//     uses: it needs their generalized types. Independent `let`s are inferred
+//     concurrently, each thread with its own inferencer; interning, instance
+//     caches and class resolution are already thread-safe. If the dependencies
+//     cannot be recorded or the graph fails to run, whatever has not run yet is
+//     analyzed in source order on this thread, which always comes after its
+//     dependencies.
+// Errors are recorded per statement and passed on in source order, so the
+// output does not depend on scheduling. Returns false (having done nothing)
+// if the parallel setup fails.
+static bool analyze_statements_parallel(SemanticAnalyzer* analyzer, DynamicArray* statements) {
+    size_t n = da_count(statements);
+    size_t jobs = analyzer->jobs;
+    if (analyzer->sym_table->shared_globals) return false; // Already analyzed once
+    StatementTask* tasks = (StatementTask*)calloc(n, sizeof(StatementTask));
+    SemanticAnalyzer* workers = (SemanticAnalyzer*)calloc(jobs, sizeof(SemanticAnalyzer));
+    GlobalSymbolTable* globals = global_symbol_table_create();
+    const char* source = diagnostics_source(analyzer->diagnostics);
+    bool ok = tasks && workers && globals;
+    if (ok) symbol_table_attach_globals(analyzer->sym_table, globals);
+    for (size_t w = 0; ok && w < jobs; ++w) {
+        workers[w] = *analyzer;
+        workers[w].had_error = false;
+        workers[w].inferencer = type_inferencer_create();
+        workers[w].diagnostics = diagnostics_create(source);
+        workers[w].sym_table = symbol_table_create_worker(analyzer->sym_table);
+        workers[w].resolver = workers[w].sym_table ? resolver_create(workers[w].sym_table, analyzer->constructors) : NULL;
+        ok = workers[w].inferencer && workers[w].diagnostics && workers[w].resolver;
+        if (!ok) break;
+        type_inferencer_set_diagnostics(workers[w].inferencer, workers[w].diagnostics);
+        workers[w].resolver->diagnostics = workers[w].diagnostics;
+    }
+    if (!ok) {
+        destroy_workers(analyzer, workers, jobs);
+        free(tasks);
+        if (analyzer->sym_table->shared_globals == globals) symbol_table_attach_globals(analyzer->sym_table, NULL);
+        else global_symbol_table_destroy(globals);
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) tasks[i].stmt = (Stmt*)da_get(statements, i);
+    StatementSchedule schedule = {tasks, workers, globals};
+
+    // 1. Declare. Later definitions of a name lose to the earliest one.
+    run_statement_phase(n, jobs, declare_statement_task, &schedule);
+    DynamicArray* conflicts = global_symbol_table_take_conflicts(globals);
+    for (size_t c = 0; c < da_count(conflicts); ++c) {
+        GlobalConflict* conflict = (GlobalConflict*)da_get(conflicts, c);
+        StatementTask* t = &tasks[conflict->order];
+        t->declared = NULL; // Owned by the global table
+        statement_error(t, source, conflict->duplicate->name_token,
+                        "Variable with this name already defined in current scope.");
+        analyzer->resolver->had_error = true;
+        free(conflict);
+    }
+    if (conflicts) da_destroy(conflicts);
+    int first_slot = (int)da_count(analyzer->sym_table->global_scope->symbols);
+    bool slotted = global_symbol_table_assign_slots(globals, first_slot);
+    if (!slotted) semantic_error_general(analyzer, "Out of memory while declaring global bindings.");
+    int visible = first_slot;
+    for (size_t i = 0; slotted && i < n; ++i) {
+        if (tasks[i].declared) visible = tasks[i].declared->slot;
+        tasks[i].visible_globals = visible;
+        if (tasks[i].declared) visible++;
+    }
+
+    // 2. Resolve.
+    if (slotted) run_statement_phase(n, jobs, resolve_statement_task, &schedule);
+
+    // 3. Analyze, after the `let`s whose bindings each one uses.
+    size_t slot_count = (size_t)first_slot + global_symbol_table_count(globals);
+    int* task_of_slot = slotted ? (int*)malloc((slot_count ? slot_count : 1) * sizeof(int)) : NULL;
+    TaskGraph* graph = slotted ? task_graph_create(n) : NULL;
+    bool linked = task_of_slot && graph;
+    if (linked) {
+        for (size_t i = 0; i < slot_count; ++i) task_of_slot[i] = -1;
+        for (size_t i = 0; linked && i < n; ++i) {
+            if (tasks[i].stmt->type != STMT_LET) continue;
+            StmtLet* let = (StmtLet*)tasks[i].stmt;
+            linked = add_binding_dependencies(graph, task_of_slot, slot_count, let->initializer, i);
+            if (let->symbol && let->symbol->depth == 0) task_of_slot[let->symbol->slot] = (int)i;
+        }
+    }
+    if (slotted && (!linked || !task_graph_run(graph, jobs, run_statement_task, &schedule))) {
+        for (size_t i = 0; i < n; ++i) {
+            if (!tasks[i].done) run_statement_task(i, 0, &schedule);
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (!tasks[i].diagnostics) continue;
+        if (analyzer->diagnostics) diagnostics_append(analyzer->diagnostics, tasks[i].diagnostics);
+        else diagnostics_render(tasks[i].diagnostics, stderr);
+        diagnostics_destroy(tasks[i].diagnostics);
+    }
+    for (size_t w = 0; w < jobs; ++w) {
+        if (workers[w].had_error || type_inferencer_had_error(workers[w].inferencer)) analyzer->had_error = true;
+    }
+    destroy_workers(analyzer, workers, jobs);
+    free(task_of_slot);
+    free(tasks);
+    task_graph_destroy(graph);
+    return true;
+}
+
+
 // --- Public API ---
 
 SemanticAnalyzer* semantic_analyzer_create() {
@@ -216,13 +893,38 @@ SemanticAnalyzer* semantic_analyzer_create() {
         free(analyzer);
         return NULL;
     }
+    analyzer->constructors = constructor_index_create();
+    analyzer->resolver = resolver_create(analyzer->sym_table, analyzer->constructors);
+    if (!analyzer->constructors || !analyzer->resolver) {
+        resolver_destroy(analyzer->resolver);
+        constructor_index_destroy(analyzer->constructors);
+        symbol_table_destroy(analyzer->sym_table);
+        free(analyzer);
+        return NULL;
+    }
     analyzer->had_error = false;
+    analyzer->adt_graph = NULL;
+    analyzer->jobs = task_graph_default_workers();
+    analyzer->diagnostics = NULL;
     types_init_predefined(); // Initialize global predefined types
+    analyzer->inferencer = type_inferencer_create();
+    analyzer->instances = adt_instance_cache_create();
+    analyzer->classes = typeclass_env_create(analyzer->instances);
+    if (!analyzer->inferencer || !analyzer->instances || !analyzer->classes) {
+        semantic_analyzer_destroy(analyzer);
+        return NULL;
+    }
     return analyzer;
 }
 
 void semantic_analyzer_destroy(SemanticAnalyzer* analyzer) {
     if (!analyzer) return;
+    type_inferencer_destroy(analyzer->inferencer);
+    typeclass_env_destroy(analyzer->classes);
+    adt_graph_destroy(analyzer->adt_graph);
+    adt_instance_cache_destroy(analyzer->instances);
+    resolver_destroy(analyzer->resolver);
+    constructor_index_destroy(analyzer->constructors);
     symbol_table_destroy(analyzer->sym_table);
     types_cleanup_predefined(); // Cleanup global predefined types
     free(analyzer);
@@ -234,14 +936,160 @@ bool semantic_analyzer_analyze(SemanticAnalyzer* analyzer, Program* program) {
         return false;
     }
     analyzer->had_error = false; // Reset error state for this run
+    analyzer->resolver->had_error = false;
 
-    for (size_t i = 0; i < da_count(program->statements); ++i) {
-        analyze_stmt(analyzer, (Stmt*)da_get(program->statements, i));
+    // Declarations don't depend on their order in the file. They are processed in
+    // groups, each in source order: classes; ADT headers (names, parameters,
+    // bounds); instances, which only need headers; ADT bodies, which can then
+    // refer to any ADT; and the ADT dependency graph over the finished bodies.
+    DynamicArray* statements = program->statements;
+    semantic_analyzer_declare(analyzer, program);
+    for (size_t i = 0; i < da_count(statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type == STMT_DATA) analyze_stmt(analyzer, stmt);
     }
+    analyze_adt_graph(analyzer, program);
 
+    // The remaining statements are name-resolved (declaring their bindings and
+    // binding their uses), then analyzed. Analysis only consumes the resolver's
+    // annotations. Large programs are analyzed in parallel; small ones in order.
+    DynamicArray* rest = da_create(16, sizeof(Stmt*));
+    for (size_t i = 0; rest && i < da_count(statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type == STMT_CLASS || stmt->type == STMT_DATA || stmt->type == STMT_INSTANCE) continue;
+        da_push(rest, stmt);
+    }
+    bool parallel = rest && analyzer->jobs > 1 && da_count(rest) >= PARALLEL_MIN_STATEMENTS &&
+                    analyze_statements_parallel(analyzer, rest);
+    for (size_t i = 0; !parallel && i < da_count(statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type == STMT_CLASS || stmt->type == STMT_DATA || stmt->type == STMT_INSTANCE) continue;
+        resolver_resolve_stmt(analyzer->resolver, stmt);
+        analyze_stmt(analyzer, stmt);
+    }
+    da_destroy(rest);
+
+    if (analyzer->resolver->had_error) analyzer->had_error = true;
+    if (type_inferencer_had_error(analyzer->inferencer)) analyzer->had_error = true;
+
+    // Ownership rules need every use typed (to tell moves from copies).
+    if (!analyzer->had_error) semantic_analyzer_check_ownership(analyzer, program);
     return !analyzer->had_error;
 }
 
+bool semantic_analyzer_analyze_roots(SemanticAnalyzer* analyzer, Program* program, DynamicArray* roots) {
+    if (!analyzer || !program) {
+        if (analyzer) analyzer->had_error = true;
+        return false;
+    }
+    analyzer->had_error = false;
+    analyzer->resolver->had_error = false;
+
+    DynamicArray* statements = program->statements;
+    bool* reachable = (bool*)malloc((da_count(statements) + 1) * sizeof(bool));
+    DynamicArray* unknown = da_create(4, sizeof(char*));
+    if (!reachable || !unknown || !reachability_mark(program, roots, reachable, unknown)) {
+        fprintf(stderr, "Reachability analysis ran out of memory.\n");
+        free(reachable);
+        if (unknown) da_destroy(unknown);
+        analyzer->had_error = true;
+        return false;
+    }
+    for (size_t i = 0; i < da_count(unknown); ++i) {
+        char msg[160];
+        snprintf(msg, sizeof(msg), "Root '%.100s' is not a top-level 'let' or 'data' declaration.",
+                 (const char*)da_get(unknown, i));
+        semantic_error_general(analyzer, msg);
+    }
+    da_destroy(unknown);
+
+    // The same steps as semantic_analyzer_analyze, in the same order, but only
+    // reachable bodies and initializers are analyzed. Every other declaration
+    // still takes its names, so redefinitions are reported as usual.
+    semantic_analyzer_declare(analyzer, program);
+    for (size_t i = 0; i < da_count(statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type != STMT_DATA) continue;
+        if (reachable[i]) analyze_stmt(analyzer, stmt);
+        else skim_stmt_data(analyzer, (StmtData*)stmt);
+    }
+    analyze_adt_graph(analyzer, program);
+    for (size_t i = 0; i < da_count(statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type == STMT_CLASS || stmt->type == STMT_DATA || stmt->type == STMT_INSTANCE) continue;
+        if (reachable[i]) {
+            resolver_resolve_stmt(analyzer->resolver, stmt);
+            analyze_stmt(analyzer, stmt);
+        } else if (stmt->type == STMT_LET) {
+            resolver_declare_let(analyzer->resolver, (StmtLet*)stmt);
+        }
+    }
+    free(reachable);
+
+    if (analyzer->resolver->had_error) analyzer->had_error = true;
+    if (type_inferencer_had_error(analyzer->inferencer)) analyzer->had_error = true;
+    if (!analyzer->had_error) semantic_analyzer_check_ownership(analyzer, program);
+    return !analyzer->had_error;
+}
+
+void semantic_analyzer_check_ownership(SemanticAnalyzer* analyzer, Program* program) {
+    if (!borrow_check_program(program, analyzer->instances, analyzer->diagnostics)) analyzer->had_error = true;
+}
+
+void semantic_analyzer_declare(SemanticAnalyzer* analyzer, Program* program) {
+    DynamicArray* statements = program->statements;
+    for (size_t i = 0; i < da_count(statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type == STMT_CLASS) analyze_stmt(analyzer, stmt);
+    }
+    for (size_t i = 0; i < da_count(statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type != STMT_DATA) continue;
+        resolver_resolve_stmt(analyzer->resolver, stmt);
+        declare_adt_header(analyzer, (StmtData*)stmt);
+    }
+    for (size_t i = 0; i < da_count(statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(statements, i);
+        if (stmt->type == STMT_INSTANCE) analyze_stmt(analyzer, stmt);
+    }
+}
+
+void semantic_analyzer_analyze_data(SemanticAnalyzer* analyzer, StmtData* stmt) {
+    analyze_stmt_data(analyzer, stmt);
+}
+
+void semantic_analyzer_analyze_adt_graph(SemanticAnalyzer* analyzer, Program* program) {
+    analyze_adt_graph(analyzer, program);
+}
+
+void semantic_analyzer_analyze_statement(SemanticAnalyzer* analyzer, Stmt* stmt) {
+    resolver_resolve_stmt(analyzer->resolver, stmt);
+    analyze_stmt(analyzer, stmt);
+}
+
+void semantic_analyzer_forget_data(SemanticAnalyzer* analyzer, Symbol* adt_symbol) {
+    ADTDefinition* def = adt_symbol ? adt_symbol->data.adt_def : NULL;
+    if (!def) return;
+    while (da_count(def->variants) > 0) {
+        ADTVariantSymbol* variant = (ADTVariantSymbol*)da_pop(def->variants);
+        const ConstructorEntry* entry = constructor_index_lookup(analyzer->constructors, variant->name);
+        if (entry && entry->variant == variant) constructor_index_remove(analyzer->constructors, variant->name);
+        adt_variant_symbol_destroy(variant);
+    }
+}
+
+void semantic_analyzer_reanalyze_let(SemanticAnalyzer* analyzer, StmtLet* stmt, Symbol* symbol) {
+    resolver_rebind_let(analyzer->resolver, stmt, symbol);
+    analyze_stmt_let(analyzer, stmt);
+}
+
+void semantic_analyzer_set_diagnostics(SemanticAnalyzer* analyzer, Diagnostics* diagnostics) {
+    if (!analyzer) return;
+    analyzer->diagnostics = diagnostics;
+    analyzer->resolver->diagnostics = diagnostics;
+    type_inferencer_set_diagnostics(analyzer->inferencer, diagnostics);
+}
+
 bool semantic_analyzer_had_error(const SemanticAnalyzer* analyzer) {
     return analyzer ? analyzer->had_error : true;
 }
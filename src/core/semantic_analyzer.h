@@ -4,14 +4,29 @@
 #include "ast.h"
 #include "symbol_table.h"
 #include "types.h"
+#include "resolver.h"
+#include "constructor_index.h"
+#include "type_infer.h"
+#include "adt_instance.h"
+#include "typeclass.h"
+#include "adt_graph.h"
+#include "diagnostics.h"
 #include <stdbool.h>
 
 // Semantic Analyzer structure
 // It will hold the state needed for semantic analysis, primarily the symbol table.
 typedef struct {
     SymbolTable* sym_table;
+    Resolver* resolver;     // Name resolution pass, declares into sym_table
+    ConstructorIndex* constructors; // Variant name -> (ADT, tag, arity), filled by `data` declarations
+    TypeInferencer* inferencer;     // Infers and generalizes `let` types
+    ADTInstanceCache* instances;    // Concrete ADT specializations used by the program
+    TypeClassEnv* classes;          // Typeclasses, instances and memoized instance resolution
+    ADTGraph* adt_graph;            // ADT dependency components, in topological order (NULL before analysis)
     // We might add a reference to a list of predefined types (e.g., i32, String, bool)
     // Scope* predefined_types_scope;
+    size_t jobs;                    // Threads for analyzing `let` declarations (default: online CPUs)
+    Diagnostics* diagnostics;       // Not owned; errors are recorded here instead of printed when set
     bool had_error;
     // DynamicArray* errors; // To store detailed error messages
 } SemanticAnalyzer;
@@ -28,6 +43,36 @@ void semantic_analyzer_destroy(SemanticAnalyzer* analyzer);
 // The AST nodes might be annotated with type information or symbol table references during this phase.
 bool semantic_analyzer_analyze(SemanticAnalyzer* analyzer, Program* program);
 
+// Lazy analysis for building some entry points of a larger program: only the
+// `let`s and `data` declarations reachable from `roots` (const char* names of
+// top-level declarations; see reachability.h) are analyzed. The others are
+// only skimmed: they declare their names, including constructors, so
+// redefinitions are still reported, but no initializer or field type is
+// resolved, inferred or checked. Runs sequentially.
+bool semantic_analyzer_analyze_roots(SemanticAnalyzer* analyzer, Program* program, DynamicArray* roots);
+
+// The steps of semantic_analyzer_analyze, for drivers that analyze declarations
+// one at a time (incremental.h). A full analysis runs `declare` (classes, ADT
+// headers, instances), `analyze_data` for every ADT body, `analyze_adt_graph`,
+// then `analyze_statement` for every other statement, each group in source order,
+// and finally `check_ownership` if there were no errors.
+void semantic_analyzer_declare(SemanticAnalyzer* analyzer, Program* program);
+void semantic_analyzer_analyze_data(SemanticAnalyzer* analyzer, StmtData* stmt);
+void semantic_analyzer_analyze_adt_graph(SemanticAnalyzer* analyzer, Program* program);
+void semantic_analyzer_analyze_statement(SemanticAnalyzer* analyzer, Stmt* stmt);
+void semantic_analyzer_check_ownership(SemanticAnalyzer* analyzer, Program* program);
+
+// Drops an ADT's variants and their constructors, keeping its header, so an
+// edited body can be analyzed again with semantic_analyzer_analyze_data.
+void semantic_analyzer_forget_data(SemanticAnalyzer* analyzer, Symbol* adt_symbol);
+
+// Analyzes an edited `let` whose binding is already declared as `symbol`.
+void semantic_analyzer_reanalyze_let(SemanticAnalyzer* analyzer, StmtLet* stmt, Symbol* symbol);
+
+// Sends the errors of the analyzer, its resolver and its inferencer to
+// `diagnostics` (NULL: stderr).
+void semantic_analyzer_set_diagnostics(SemanticAnalyzer* analyzer, Diagnostics* diagnostics);
+
 // Helper function to get error status
 bool semantic_analyzer_had_error(const SemanticAnalyzer* analyzer);
 
@@ -0,0 +1,514 @@
+#define _DEFAULT_SOURCE // For mmap, fstat
+#include "symbol_index.h"
+#include "../util/dynamic_array.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// One definition or use, before it is laid out on disk. Names and paths are
+// views: into the analyzed source for new records, or into the old mapped index
+// for records carried over from other files.
+typedef struct {
+    const char* name;
+    uint32_t name_length;
+    uint32_t kind;
+    bool is_def;
+    uint32_t file_id;
+    uint32_t line;
+    uint32_t col;
+} IndexRecord;
+
+struct SymbolIndexBuilder {
+    char* file_path;
+    DynamicArray* records; // IndexRecord*; file_id is assigned when written
+};
+
+struct SymbolIndex {
+    const unsigned char* base;
+    size_t size;
+    const SymbolIndexHeader* header;
+};
+
+
+// --- Building ---
+
+SymbolIndexBuilder* symbol_index_builder_create(const char* file_path) {
+    SymbolIndexBuilder* builder = (SymbolIndexBuilder*)malloc(sizeof(SymbolIndexBuilder));
+    if (!builder) return NULL;
+    size_t len = strlen(file_path);
+    builder->file_path = (char*)malloc(len + 1);
+    builder->records = da_create(64, sizeof(IndexRecord*));
+    if (!builder->file_path || !builder->records) {
+        free(builder->file_path);
+        da_destroy(builder->records);
+        free(builder);
+        return NULL;
+    }
+    memcpy(builder->file_path, file_path, len + 1);
+    return builder;
+}
+
+void symbol_index_builder_destroy(SymbolIndexBuilder* builder) {
+    if (!builder) return;
+    for (size_t i = 0; i < da_count(builder->records); ++i) {
+        free(da_get(builder->records, i));
+    }
+    da_destroy(builder->records);
+    free(builder->file_path);
+    free(builder);
+}
+
+static void add_record(DynamicArray* records, Token at, SymbolIndexKind kind, bool is_def, uint32_t file_id) {
+    IndexRecord* record = (IndexRecord*)malloc(sizeof(IndexRecord));
+    if (!record) return;
+    record->name = at.lexeme;
+    record->name_length = (uint32_t)at.length;
+    record->kind = kind;
+    record->is_def = is_def;
+    record->file_id = file_id;
+    record->line = (uint32_t)at.line;
+    record->col = (uint32_t)at.col;
+    da_push(records, record);
+}
+
+// Constructor patterns are uses of their variants; bindings are local.
+static void collect_pattern(SymbolIndexBuilder* builder, Pattern* pattern) {
+    if (!pattern) return;
+    if (pattern->constructor_adt) add_record(builder->records, pattern->token, SYMBOL_INDEX_VARIANT, false, 0);
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        collect_pattern(builder, (Pattern*)da_get(pattern->subpatterns, i));
+    }
+}
+
+static void collect_expr(SymbolIndexBuilder* builder, Expr* expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_VARIABLE: {
+            ExprVariable* var_expr = (ExprVariable*)expr;
+            if (var_expr->constructor_adt) {
+                add_record(builder->records, var_expr->name, SYMBOL_INDEX_VARIANT, false, 0);
+            } else if (var_expr->symbol && var_expr->symbol->kind == SYMBOL_VARIABLE && var_expr->depth == 0) {
+                add_record(builder->records, var_expr->name, SYMBOL_INDEX_LET, false, 0);
+            }
+            break;
+        }
+        case EXPR_CALL: {
+            ExprCall* call_expr = (ExprCall*)expr;
+            collect_expr(builder, call_expr->callee); // The callee carries the constructor annotation
+            for (size_t i = 0; i < da_count(call_expr->arguments); ++i) {
+                collect_expr(builder, (Expr*)da_get(call_expr->arguments, i));
+            }
+            break;
+        }
+        case EXPR_BORROW:
+            collect_expr(builder, ((ExprBorrow*)expr)->operand);
+            break;
+        case EXPR_MATCH: {
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            collect_expr(builder, match_expr->scrutinee);
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                collect_pattern(builder, arm->pattern);
+                collect_expr(builder, arm->body);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void symbol_index_collect(SymbolIndexBuilder* builder, Program* program, SymbolTable* sym_table) {
+    if (!builder || !program) return;
+    for (size_t i = 0; i < da_count(program->statements); ++i) {
+        Stmt* stmt = (Stmt*)da_get(program->statements, i);
+        if (stmt->type == STMT_DATA) {
+            StmtData* data_stmt = (StmtData*)stmt;
+            if (!data_stmt->symbol) continue; // Redefinition, reported by the resolver
+            add_record(builder->records, data_stmt->name, SYMBOL_INDEX_ADT, true, 0);
+            ADTDefinition* def = data_stmt->symbol->data.adt_def;
+            for (size_t v = 0; def && v < da_count(def->variants); ++v) {
+                ADTVariantSymbol* variant = (ADTVariantSymbol*)da_get(def->variants, v);
+                add_record(builder->records, variant->name, SYMBOL_INDEX_VARIANT, true, 0);
+            }
+            // Field types naming an ADT count as uses of it.
+            for (size_t v = 0; v < da_count(data_stmt->variants); ++v) {
+                ADTVariant* ast_variant = (ADTVariant*)da_get(data_stmt->variants, v);
+                for (size_t f = 0; f < da_count(ast_variant->fields); ++f) {
+                    ADTVariantField* field = (ADTVariantField*)da_get(ast_variant->fields, f);
+                    Symbol* type_sym = sym_table ? scope_lookup_current(sym_table->global_scope, field->type_name_token) : NULL;
+                    if (type_sym && type_sym->kind == SYMBOL_ADT) {
+                        add_record(builder->records, field->type_name_token, SYMBOL_INDEX_ADT, false, 0);
+                    }
+                }
+            }
+        } else if (stmt->type == STMT_LET) {
+            StmtLet* let_stmt = (StmtLet*)stmt;
+            collect_expr(builder, let_stmt->initializer);
+            if (let_stmt->symbol) {
+                add_record(builder->records, let_stmt->name, SYMBOL_INDEX_LET, true, 0);
+            }
+        }
+    }
+}
+
+
+// --- Writing ---
+
+static int compare_names(const char* a, uint32_t a_len, const char* b, uint32_t b_len) {
+    int c = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (c != 0) return c;
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+static int compare_records(const void* pa, const void* pb) {
+    const IndexRecord* a = *(IndexRecord* const*)pa;
+    const IndexRecord* b = *(IndexRecord* const*)pb;
+    int c = compare_names(a->name, a->name_length, b->name, b->name_length);
+    if (c != 0) return c;
+    if (a->kind != b->kind) return a->kind < b->kind ? -1 : 1;
+    if (a->is_def != b->is_def) return a->is_def ? -1 : 1; // Definitions first
+    if (a->file_id != b->file_id) return a->file_id < b->file_id ? -1 : 1;
+    if (a->line != b->line) return a->line < b->line ? -1 : 1;
+    return (a->col > b->col) - (a->col < b->col);
+}
+
+static bool same_symbol(const IndexRecord* a, const IndexRecord* b) {
+    return a->kind == b->kind && compare_names(a->name, a->name_length, b->name, b->name_length) == 0;
+}
+
+typedef struct {
+    const char* path;
+    uint32_t length;
+} PathView;
+
+bool symbol_index_write(const char* index_path, const SymbolIndexBuilder* builder) {
+    if (!index_path || !builder) return false;
+
+    // 1. Carry over everything the old index knows about other files.
+    SymbolIndex* old = NULL;
+    if (access(index_path, F_OK) == 0) {
+        old = symbol_index_open(index_path);
+        if (!old) fprintf(stderr, "Rebuilding symbol index '%s' from scratch.\n", index_path);
+    }
+
+    DynamicArray* files = da_create(8, sizeof(PathView*));
+    DynamicArray* records = da_create(da_count(builder->records) + 64, sizeof(IndexRecord*));
+    DynamicArray* carried = da_create(64, sizeof(IndexRecord*)); // Records we allocate here
+    uint32_t target_id = UINT32_MAX;
+    bool ok = files && records && carried;
+
+    if (ok && old) {
+        for (uint32_t f = 0; f < old->header->file_count; ++f) {
+            PathView* view = (PathView*)malloc(sizeof(PathView));
+            if (!view) { ok = false; break; }
+            size_t len = 0;
+            view->path = symbol_index_file_path(old, f, &len);
+            view->length = (uint32_t)len;
+            if (strlen(builder->file_path) == len && memcmp(view->path, builder->file_path, len) == 0) {
+                target_id = f;
+            }
+            da_push(files, view);
+        }
+        const SymbolIndexSymbol* symbols = (const SymbolIndexSymbol*)(old->base + old->header->symbols_offset);
+        const SymbolIndexPosting* postings = symbol_index_postings(old);
+        const char* strings = (const char*)(old->base + old->header->strings_offset);
+        for (uint32_t s = 0; ok && s < old->header->symbol_count; ++s) {
+            for (int pass = 0; pass < 2; ++pass) {
+                uint32_t start = pass == 0 ? symbols[s].def_start : symbols[s].use_start;
+                uint32_t count = pass == 0 ? symbols[s].def_count : symbols[s].use_count;
+                for (uint32_t p = start; p < start + count; ++p) {
+                    if (postings[p].file_id == target_id) continue; // Replaced below
+                    IndexRecord* record = (IndexRecord*)malloc(sizeof(IndexRecord));
+                    if (!record) { ok = false; break; }
+                    record->name = strings + symbols[s].name_offset;
+                    record->name_length = symbols[s].name_length;
+                    record->kind = symbols[s].kind;
+                    record->is_def = pass == 0;
+                    record->file_id = postings[p].file_id;
+                    record->line = postings[p].line;
+                    record->col = postings[p].col;
+                    da_push(carried, record);
+                    da_push(records, record);
+                }
+            }
+        }
+    }
+    if (ok && target_id == UINT32_MAX) {
+        PathView* view = (PathView*)malloc(sizeof(PathView));
+        if (view) {
+            view->path = builder->file_path;
+            view->length = (uint32_t)strlen(builder->file_path);
+            target_id = (uint32_t)da_count(files);
+            da_push(files, view);
+        } else {
+            ok = false;
+        }
+    }
+
+    // 2. Add this file's records and sort everything into posting order.
+    for (size_t i = 0; ok && i < da_count(builder->records); ++i) {
+        IndexRecord* record = (IndexRecord*)da_get(builder->records, i);
+        record->file_id = target_id;
+        da_push(records, record);
+    }
+    size_t record_count = da_count(records);
+    if (ok && record_count > 1) {
+        qsort(records->items, record_count, sizeof(void*), compare_records);
+    }
+
+    // 3. Lay out and write the image: header, files, symbols, postings, strings.
+    char tmp_path[4096];
+    FILE* out = NULL;
+    if (ok) {
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", index_path);
+        out = fopen(tmp_path, "wb");
+        if (!out) {
+            fprintf(stderr, "Cannot write symbol index '%s': %s\n", tmp_path, strerror(errno));
+            ok = false;
+        }
+    }
+    if (ok) {
+        uint32_t symbol_count = 0;
+        uint32_t string_bytes = 0;
+        for (size_t f = 0; f < da_count(files); ++f) {
+            string_bytes += ((PathView*)da_get(files, f))->length;
+        }
+        for (size_t i = 0; i < record_count; ++i) {
+            IndexRecord* r = (IndexRecord*)da_get(records, i);
+            if (i == 0 || !same_symbol(r, (IndexRecord*)da_get(records, i - 1))) {
+                symbol_count++;
+                string_bytes += r->name_length;
+            }
+        }
+
+        SymbolIndexHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = SYMBOL_INDEX_MAGIC;
+        header.version = SYMBOL_INDEX_VERSION;
+        header.file_count = (uint32_t)da_count(files);
+        header.symbol_count = symbol_count;
+        header.posting_count = (uint32_t)record_count;
+        header.string_bytes = string_bytes;
+        header.files_offset = sizeof(SymbolIndexHeader);
+        header.symbols_offset = header.files_offset + (uint64_t)header.file_count * sizeof(SymbolIndexFile);
+        header.postings_offset = header.symbols_offset + (uint64_t)symbol_count * sizeof(SymbolIndexSymbol);
+        header.strings_offset = header.postings_offset + (uint64_t)record_count * sizeof(SymbolIndexPosting);
+        fwrite(&header, sizeof(header), 1, out);
+
+        uint32_t string_offset = 0;
+        for (size_t f = 0; f < da_count(files); ++f) {
+            PathView* view = (PathView*)da_get(files, f);
+            SymbolIndexFile entry = {string_offset, view->length};
+            fwrite(&entry, sizeof(entry), 1, out);
+            string_offset += view->length;
+        }
+
+        // Postings are in record order, so each symbol's runs are contiguous.
+        for (size_t i = 0; i < record_count;) {
+            IndexRecord* first = (IndexRecord*)da_get(records, i);
+            SymbolIndexSymbol entry = {string_offset, first->name_length, first->kind, (uint32_t)i, 0, 0, 0};
+            size_t j = i;
+            while (j < record_count && same_symbol((IndexRecord*)da_get(records, j), first) &&
+                   ((IndexRecord*)da_get(records, j))->is_def) {
+                j++;
+            }
+            entry.def_count = (uint32_t)(j - i);
+            entry.use_start = (uint32_t)j;
+            while (j < record_count && same_symbol((IndexRecord*)da_get(records, j), first)) {
+                j++;
+            }
+            entry.use_count = (uint32_t)(j - entry.use_start);
+            fwrite(&entry, sizeof(entry), 1, out);
+            string_offset += first->name_length;
+            i = j;
+        }
+
+        for (size_t i = 0; i < record_count; ++i) {
+            IndexRecord* r = (IndexRecord*)da_get(records, i);
+            SymbolIndexPosting posting = {r->file_id, r->line, r->col};
+            fwrite(&posting, sizeof(posting), 1, out);
+        }
+
+        for (size_t f = 0; f < da_count(files); ++f) {
+            PathView* view = (PathView*)da_get(files, f);
+            fwrite(view->path, 1, view->length, out);
+        }
+        for (size_t i = 0; i < record_count; ++i) {
+            IndexRecord* r = (IndexRecord*)da_get(records, i);
+            if (i == 0 || !same_symbol(r, (IndexRecord*)da_get(records, i - 1))) {
+                fwrite(r->name, 1, r->name_length, out);
+            }
+        }
+
+        if (ferror(out)) {
+            fprintf(stderr, "Error writing symbol index '%s'.\n", tmp_path);
+            ok = false;
+        }
+    }
+    if (out && fclose(out) != 0) ok = false;
+
+    // The old image must stay mapped until the new one is fully written.
+    for (size_t i = 0; i < da_count(carried); ++i) free(da_get(carried, i));
+    for (size_t f = 0; f < da_count(files); ++f) free(da_get(files, f));
+    da_destroy(carried);
+    da_destroy(records);
+    da_destroy(files);
+    symbol_index_close(old);
+
+    if (ok && rename(tmp_path, index_path) != 0) {
+        fprintf(stderr, "Cannot replace symbol index '%s': %s\n", index_path, strerror(errno));
+        ok = false;
+    }
+    return ok;
+}
+
+
+// --- Querying ---
+
+// Whether every entry stays inside the image: file paths and symbol names in
+// the string section, posting runs in the posting table, and file ids in the
+// file table. Queries index by these fields without further checks.
+static bool entries_valid(const unsigned char* base, const SymbolIndexHeader* header) {
+    const SymbolIndexFile* files = (const SymbolIndexFile*)(base + header->files_offset);
+    for (uint32_t f = 0; f < header->file_count; ++f) {
+        if ((uint64_t)files[f].path_offset + files[f].path_length > header->string_bytes) return false;
+    }
+    const SymbolIndexSymbol* symbols = (const SymbolIndexSymbol*)(base + header->symbols_offset);
+    for (uint32_t s = 0; s < header->symbol_count; ++s) {
+        const SymbolIndexSymbol* symbol = &symbols[s];
+        if ((uint64_t)symbol->name_offset + symbol->name_length > header->string_bytes ||
+            (uint64_t)symbol->def_start + symbol->def_count > header->posting_count ||
+            (uint64_t)symbol->use_start + symbol->use_count > header->posting_count) {
+            return false;
+        }
+    }
+    const SymbolIndexPosting* postings = (const SymbolIndexPosting*)(base + header->postings_offset);
+    for (uint32_t p = 0; p < header->posting_count; ++p) {
+        if (postings[p].file_id >= header->file_count) return false;
+    }
+    return true;
+}
+
+SymbolIndex* symbol_index_open(const char* index_path) {
+    int fd = open(index_path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open symbol index '%s': %s\n", index_path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SymbolIndexHeader)) {
+        fprintf(stderr, "Symbol index '%s' is truncated.\n", index_path);
+        close(fd);
+        return NULL;
+    }
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping stays valid
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Cannot map symbol index '%s': %s\n", index_path, strerror(errno));
+        return NULL;
+    }
+
+    const SymbolIndexHeader* header = (const SymbolIndexHeader*)base;
+    size_t size = (size_t)st.st_size;
+    bool valid = header->magic == SYMBOL_INDEX_MAGIC && header->version == SYMBOL_INDEX_VERSION &&
+                 header->files_offset == sizeof(SymbolIndexHeader) &&
+                 header->symbols_offset == header->files_offset + (uint64_t)header->file_count * sizeof(SymbolIndexFile) &&
+                 header->postings_offset == header->symbols_offset + (uint64_t)header->symbol_count * sizeof(SymbolIndexSymbol) &&
+                 header->strings_offset == header->postings_offset + (uint64_t)header->posting_count * sizeof(SymbolIndexPosting) &&
+                 header->strings_offset + header->string_bytes <= size &&
+                 entries_valid((const unsigned char*)base, header);
+    if (!valid) {
+        fprintf(stderr, "Symbol index '%s' is malformed or from another compiler version.\n", index_path);
+        munmap(base, size);
+        return NULL;
+    }
+
+    SymbolIndex* index = (SymbolIndex*)malloc(sizeof(SymbolIndex));
+    if (!index) {
+        munmap(base, size);
+        return NULL;
+    }
+    index->base = (const unsigned char*)base;
+    index->size = size;
+    index->header = header;
+    return index;
+}
+
+void symbol_index_close(SymbolIndex* index) {
+    if (!index) return;
+    munmap((void*)index->base, index->size);
+    free(index);
+}
+
+const SymbolIndexSymbol* symbol_index_find(const SymbolIndex* index, const char* name, size_t name_length, size_t* count) {
+    if (count) *count = 0;
+    if (!index || !name) return NULL;
+    const SymbolIndexSymbol* symbols = (const SymbolIndexSymbol*)(index->base + index->header->symbols_offset);
+    const char* strings = (const char*)(index->base + index->header->strings_offset);
+
+    // Lower bound on the name; all kinds of one name are adjacent.
+    size_t lo = 0, hi = index->header->symbol_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_names(strings + symbols[mid].name_offset, symbols[mid].name_length, name, (uint32_t)name_length) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t end = lo;
+    while (end < index->header->symbol_count &&
+           compare_names(strings + symbols[end].name_offset, symbols[end].name_length, name, (uint32_t)name_length) == 0) {
+        end++;
+    }
+    if (end == lo) return NULL;
+    if (count) *count = end - lo;
+    return &symbols[lo];
+}
+
+const SymbolIndexPosting* symbol_index_postings(const SymbolIndex* index) {
+    return index ? (const SymbolIndexPosting*)(index->base + index->header->postings_offset) : NULL;
+}
+
+const char* symbol_index_file_path(const SymbolIndex* index, uint32_t file_id, size_t* length) {
+    if (!index || file_id >= index->header->file_count) return NULL;
+    const SymbolIndexFile* files = (const SymbolIndexFile*)(index->base + index->header->files_offset);
+    if (length) *length = files[file_id].path_length;
+    return (const char*)(index->base + index->header->strings_offset + files[file_id].path_offset);
+}
+
+const char* symbol_index_kind_name(uint32_t kind) {
+    switch (kind) {
+        case SYMBOL_INDEX_ADT: return "data";
+        case SYMBOL_INDEX_VARIANT: return "variant";
+        case SYMBOL_INDEX_LET: return "let";
+        default: return "unknown";
+    }
+}
+
+static void print_postings(const SymbolIndex* index, const char* label, uint32_t start, uint32_t count, FILE* stream) {
+    const SymbolIndexPosting* postings = symbol_index_postings(index);
+    for (uint32_t p = start; p < start + count; ++p) {
+        size_t len = 0;
+        const char* path = symbol_index_file_path(index, postings[p].file_id, &len);
+        fprintf(stream, "  %s %.*s:%u:%u\n", label, (int)len, path ? path : "?", postings[p].line, postings[p].col);
+    }
+}
+
+bool symbol_index_print(const SymbolIndex* index, const char* name, FILE* stream) {
+    size_t count = 0;
+    const SymbolIndexSymbol* found = symbol_index_find(index, name, strlen(name), &count);
+    if (!found) return false;
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(stream, "%s %s: %u definition(s), %u use(s)\n", symbol_index_kind_name(found[i].kind), name,
+                found[i].def_count, found[i].use_count);
+        print_postings(index, "def", found[i].def_start, found[i].def_count, stream);
+        print_postings(index, "use", found[i].use_start, found[i].use_count, stream);
+    }
+    return true;
+}
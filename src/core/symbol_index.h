@@ -0,0 +1,112 @@
+#ifndef SYMBOL_INDEX_H
+#define SYMBOL_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include <stdint.h> // For fixed-width on-disk fields
+#include <stdio.h>  // For FILE*
+#include "ast.h"
+#include "symbol_table.h"
+
+// Persistent cross-file symbol index (go-to-definition / find-references).
+//
+// The compiler records, as a side effect of semantic analysis, where every ADT,
+// variant and top-level `let` is defined and used. The index file is a single
+// flat image meant to be mmap'd and queried without parsing anything:
+//
+//   SymbolIndexHeader
+//   SymbolIndexFile[file_count]        source paths, by file id
+//   SymbolIndexSymbol[symbol_count]    sorted by (name bytes, kind) -> binary search
+//   SymbolIndexPosting[posting_count]  per symbol: definitions, then uses; each run
+//                                      sorted by (file id, line, col)
+//   string bytes                       names and paths, referenced by offset
+//
+// All integers are in host byte order; the magic and version guard against
+// reading an index written by another build. Updating the index for one file
+// replaces exactly that file's postings and keeps everything else.
+
+#define SYMBOL_INDEX_MAGIC 0x58494c4du // "MLIX"
+#define SYMBOL_INDEX_VERSION 1u
+
+typedef enum {
+    SYMBOL_INDEX_ADT = 1,
+    SYMBOL_INDEX_VARIANT = 2,
+    SYMBOL_INDEX_LET = 3,
+} SymbolIndexKind;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t file_count;
+    uint32_t symbol_count;
+    uint32_t posting_count;
+    uint32_t string_bytes;
+    uint64_t files_offset;    // Byte offsets from the start of the file
+    uint64_t symbols_offset;
+    uint64_t postings_offset;
+    uint64_t strings_offset;
+} SymbolIndexHeader;
+
+typedef struct {
+    uint32_t path_offset; // Into the string section
+    uint32_t path_length;
+} SymbolIndexFile;
+
+typedef struct {
+    uint32_t name_offset; // Into the string section
+    uint32_t name_length;
+    uint32_t kind;        // SymbolIndexKind
+    uint32_t def_start;   // Index of the first definition posting
+    uint32_t def_count;
+    uint32_t use_start;   // Index of the first use posting
+    uint32_t use_count;
+} SymbolIndexSymbol;
+
+typedef struct {
+    uint32_t file_id;
+    uint32_t line;
+    uint32_t col;
+} SymbolIndexPosting;
+
+
+// --- Building (one source file at a time) ---
+
+typedef struct SymbolIndexBuilder SymbolIndexBuilder;
+
+// The path is copied and stored as given.
+SymbolIndexBuilder* symbol_index_builder_create(const char* file_path);
+void symbol_index_builder_destroy(SymbolIndexBuilder* builder);
+
+// Records definitions and uses from an analyzed program. Relies on the resolver's
+// annotations (ExprVariable.symbol, constructor tags) and the analyzer's ADT definitions.
+void symbol_index_collect(SymbolIndexBuilder* builder, Program* program, SymbolTable* sym_table);
+
+// Creates or updates the index at `index_path`: all postings previously recorded
+// for the builder's file are replaced by the builder's. Written to a temporary
+// file and renamed into place, so concurrent readers never see a partial index.
+// Returns false (after printing a message) on I/O errors.
+bool symbol_index_write(const char* index_path, const SymbolIndexBuilder* builder);
+
+
+// --- Querying ---
+
+typedef struct SymbolIndex SymbolIndex;
+
+// Maps an index file read-only. Returns NULL (after printing a message) if it
+// is missing or malformed; every entry is checked to stay inside the image.
+SymbolIndex* symbol_index_open(const char* index_path);
+void symbol_index_close(SymbolIndex* index);
+
+// Finds all symbols (of any kind) with the given name. Returns a pointer to the
+// first of *count contiguous entries, or NULL if none. O(log n), no allocation.
+const SymbolIndexSymbol* symbol_index_find(const SymbolIndex* index, const char* name, size_t name_length, size_t* count);
+
+// Accessors into the mapped image.
+const SymbolIndexPosting* symbol_index_postings(const SymbolIndex* index);
+const char* symbol_index_file_path(const SymbolIndex* index, uint32_t file_id, size_t* length);
+const char* symbol_index_kind_name(uint32_t kind);
+
+// Prints definitions and uses of `name` as "path:line:col" lines. Returns false if unknown.
+bool symbol_index_print(const SymbolIndex* index, const char* name, FILE* stream);
+
+#endif // SYMBOL_INDEX_H
@@ -1,8 +1,11 @@
 #include "symbol_table.h"
-#include "types.h" // For ADTDefinition, Type destruction
+#include "types.h" // For ADTDefinition
+#include "../util/hash.h" // For hash_bytes
 #include <stdlib.h>
 #include <string.h> // For strncmp
 #include <stdbool.h> // For bool, true, false
+#include <stdatomic.h> // For HAMT node reference counts
+#include <stdint.h>
 
 // --- Symbol Functions ---
 
@@ -11,13 +14,16 @@ Symbol* symbol_create(SymbolKind kind, Token name_token, Type* type) {
     if (!symbol) return NULL;
     symbol->kind = kind;
     symbol->name_token = name_token; // Token struct copied
-    symbol->type = type; // Assumes ownership of type if this symbol is its primary definition point
-                         // Or type might be shared (e.g. primitive types). Careful with type_destroy.
+    symbol->type = type; // Interned, not owned.
                          // For SYMBOL_ADT, type would be the ADT's self-referential type, adt_def holds structure.
+    symbol->depth = -1; // Assigned by scope_define
+    symbol->slot = -1;
 
     // Initialize union data based on kind if necessary (e.g., set pointers to NULL)
     if (kind == SYMBOL_ADT) {
         symbol->data.adt_def = NULL; // To be filled later
+    } else {
+        symbol->data.var_info.is_mutable = false;
     }
     // Other kinds might need similar initialization for their specific data.
     return symbol;
@@ -26,27 +32,7 @@ Symbol* symbol_create(SymbolKind kind, Token name_token, Type* type) {
 void symbol_destroy(Symbol* symbol) {
     if (!symbol) return;
 
-    // Important: Decide on Type ownership.
-    // If a symbol uniquely "owns" its Type definition (e.g. a complex ADT type constructed for it),
-    // then type_destroy(symbol->type) should be called here.
-    // If types are interned or shared (like primitives), then don't free here.
-    // For now, let's assume types associated with symbols are owned if complex, or managed globally if simple.
-    // A common pattern: type_destroy is called by whatever allocated the Type.
-    // If symbol_create also creates a new Type for the symbol, it should destroy it.
-    // If type is passed in and potentially shared, don't destroy here.
-    // Let's assume for now `symbol->type` is owned by the symbol, UNLESS it's a predefined type.
-
-    // Access predefined types (needs to be visible here, e.g. via extern or passed in)
-    // For now, this is a simplification. A better way would be to have a type_is_singleton() check.
-    // This requires types.c to expose these or a helper function.
-    // Hacky direct comparison for now, assuming these are accessible (they are not directly from here).
-    // If a symbol's type is one of the global predefined types, we should not destroy it here,
-    // as their lifecycle is managed by types_init_predefined and types_cleanup_predefined.
-    if (!type_is_predefined(symbol->type)) {
-        type_destroy(symbol->type);
-    }
-    // else: it's a predefined type, types_cleanup_predefined() will handle it.
-
+    // symbol->type is interned in the type arena and is never owned by the symbol.
 
     if (symbol->kind == SYMBOL_ADT) {
         adt_definition_destroy(symbol->data.adt_def); // This will free type_params and variants.
@@ -56,6 +42,190 @@ void symbol_destroy(Symbol* symbol) {
     free(symbol);
 }
 
+// --- Persistent Name Map (HAMT) ---
+// Each node covers 5 bits of the 32-bit name hash and stores only its occupied
+// positions (bitmap + dense slot array), so lookups are O(log32 n).
+// Nodes are never modified after they are published; an insert copies the path
+// from the root to the changed node and shares everything else. Nodes are
+// reference counted (atomically, so snapshots can be released from any thread).
+// Below the last hash level, names with identical hashes go into a collision
+// node that is searched linearly.
+
+#define HAMT_BITS 5
+#define HAMT_MASK ((1u << HAMT_BITS) - 1)
+#define HAMT_HASH_BITS 32
+
+typedef struct {
+    uint32_t hash;           // Name hash (leaf only)
+    Symbol* symbol;          // Leaf: the symbol (not owned)
+    struct HamtNode* child;  // Non-NULL for a sub-node (owned reference)
+} HamtSlot;
+
+typedef struct HamtNode {
+    atomic_uint refcount;
+    uint32_t bitmap; // Occupied positions; unused in collision nodes
+    uint32_t count;  // Number of slots
+    HamtSlot slots[];
+} HamtNode;
+
+static bool names_equal(Token a, Token b) {
+    return a.length == b.length && strncmp(a.lexeme, b.lexeme, a.length) == 0;
+}
+
+static HamtNode* hamt_node_alloc(uint32_t bitmap, uint32_t count) {
+    HamtNode* node = (HamtNode*)malloc(sizeof(HamtNode) + count * sizeof(HamtSlot));
+    if (!node) return NULL;
+    atomic_init(&node->refcount, 1);
+    node->bitmap = bitmap;
+    node->count = count;
+    return node;
+}
+
+static HamtNode* hamt_retain(HamtNode* node) {
+    if (node) atomic_fetch_add_explicit(&node->refcount, 1, memory_order_relaxed);
+    return node;
+}
+
+static void hamt_release(HamtNode* node) {
+    if (!node) return;
+    if (atomic_fetch_sub_explicit(&node->refcount, 1, memory_order_acq_rel) != 1) return;
+    for (uint32_t i = 0; i < node->count; ++i) {
+        hamt_release(node->slots[i].child);
+    }
+    free(node);
+}
+
+// Copies the first `count` slots of `node` into a node with `count` slots; children are shared (retained).
+static HamtNode* hamt_node_copy(const HamtNode* node, uint32_t count) {
+    HamtNode* copy = hamt_node_alloc(node->bitmap, count);
+    if (!copy) return NULL;
+    uint32_t n = node->count < count ? node->count : count;
+    memcpy(copy->slots, node->slots, n * sizeof(HamtSlot));
+    for (uint32_t i = 0; i < n; ++i) {
+        hamt_retain(copy->slots[i].child);
+    }
+    return copy;
+}
+
+static uint32_t hamt_position(uint32_t bitmap, uint32_t bit) {
+    return (uint32_t)__builtin_popcount(bitmap & (bit - 1));
+}
+
+// Builds the smallest subtree holding two leaves with different names.
+static HamtNode* hamt_pair(unsigned shift, HamtSlot a, HamtSlot b) {
+    if (shift >= HAMT_HASH_BITS) { // Full hash collision
+        HamtNode* node = hamt_node_alloc(0, 2);
+        if (!node) return NULL;
+        node->slots[0] = a;
+        node->slots[1] = b;
+        return node;
+    }
+    uint32_t idx_a = (a.hash >> shift) & HAMT_MASK;
+    uint32_t idx_b = (b.hash >> shift) & HAMT_MASK;
+    if (idx_a == idx_b) {
+        HamtNode* node = hamt_node_alloc(1u << idx_a, 1);
+        if (!node) return NULL;
+        node->slots[0] = (HamtSlot){0, NULL, hamt_pair(shift + HAMT_BITS, a, b)};
+        if (!node->slots[0].child) { free(node); return NULL; }
+        return node;
+    }
+    HamtNode* node = hamt_node_alloc((1u << idx_a) | (1u << idx_b), 2);
+    if (!node) return NULL;
+    node->slots[idx_a < idx_b ? 0 : 1] = a;
+    node->slots[idx_a < idx_b ? 1 : 0] = b;
+    return node;
+}
+
+// Returns a new version of `node` (which may be NULL) with `leaf` inserted,
+// replacing a leaf with the same name. `node` itself is left untouched.
+static HamtNode* hamt_insert(const HamtNode* node, unsigned shift, HamtSlot leaf) {
+    if (!node) {
+        HamtNode* fresh = hamt_node_alloc(1u << ((leaf.hash >> shift) & HAMT_MASK), 1);
+        if (fresh) fresh->slots[0] = leaf;
+        return fresh;
+    }
+
+    if (shift >= HAMT_HASH_BITS) { // Collision node: linear
+        for (uint32_t i = 0; i < node->count; ++i) {
+            if (names_equal(node->slots[i].symbol->name_token, leaf.symbol->name_token)) {
+                HamtNode* copy = hamt_node_copy(node, node->count);
+                if (copy) copy->slots[i] = leaf;
+                return copy;
+            }
+        }
+        HamtNode* copy = hamt_node_copy(node, node->count + 1);
+        if (copy) copy->slots[node->count] = leaf;
+        return copy;
+    }
+
+    uint32_t bit = 1u << ((leaf.hash >> shift) & HAMT_MASK);
+    uint32_t pos = hamt_position(node->bitmap, bit);
+
+    if (!(node->bitmap & bit)) { // Empty position: widen the node by one slot
+        HamtNode* copy = hamt_node_alloc(node->bitmap | bit, node->count + 1);
+        if (!copy) return NULL;
+        memcpy(copy->slots, node->slots, pos * sizeof(HamtSlot));
+        copy->slots[pos] = leaf;
+        memcpy(copy->slots + pos + 1, node->slots + pos, (node->count - pos) * sizeof(HamtSlot));
+        for (uint32_t i = 0; i < copy->count; ++i) {
+            if (i != pos) hamt_retain(copy->slots[i].child);
+        }
+        return copy;
+    }
+
+    const HamtSlot* existing = &node->slots[pos];
+    HamtSlot replacement;
+    if (existing->child) {
+        replacement = (HamtSlot){0, NULL, hamt_insert(existing->child, shift + HAMT_BITS, leaf)};
+        if (!replacement.child) return NULL;
+    } else if (existing->hash == leaf.hash &&
+               names_equal(existing->symbol->name_token, leaf.symbol->name_token)) {
+        replacement = leaf;
+    } else {
+        replacement = (HamtSlot){0, NULL, hamt_pair(shift + HAMT_BITS, *existing, leaf)};
+        if (!replacement.child) return NULL;
+    }
+
+    HamtNode* copy = hamt_node_copy(node, node->count);
+    if (!copy) {
+        hamt_release(replacement.child);
+        return NULL;
+    }
+    hamt_release(copy->slots[pos].child); // Drop the reference the copy took on the replaced child
+    copy->slots[pos] = replacement;
+    return copy;
+}
+
+static Symbol* hamt_lookup(const HamtNode* node, uint32_t hash, Token name_token) {
+    unsigned shift = 0;
+    while (node) {
+        if (shift >= HAMT_HASH_BITS) {
+            for (uint32_t i = 0; i < node->count; ++i) {
+                if (names_equal(node->slots[i].symbol->name_token, name_token)) return node->slots[i].symbol;
+            }
+            return NULL;
+        }
+        uint32_t bit = 1u << ((hash >> shift) & HAMT_MASK);
+        if (!(node->bitmap & bit)) return NULL;
+        const HamtSlot* slot = &node->slots[hamt_position(node->bitmap, bit)];
+        if (!slot->child) {
+            return (slot->hash == hash && names_equal(slot->symbol->name_token, name_token)) ? slot->symbol : NULL;
+        }
+        node = slot->child;
+        shift += HAMT_BITS;
+    }
+    return NULL;
+}
+
+static void hamt_foreach(const HamtNode* node, void (*visit)(Symbol* symbol, void* ctx), void* ctx) {
+    if (!node) return;
+    for (uint32_t i = 0; i < node->count; ++i) {
+        if (node->slots[i].child) hamt_foreach(node->slots[i].child, visit, ctx);
+        else visit(node->slots[i].symbol, ctx);
+    }
+}
+
+
 // --- Scope Functions ---
 
 Scope* scope_create(Scope* parent) {
@@ -67,6 +237,9 @@ Scope* scope_create(Scope* parent) {
         free(scope);
         return NULL;
     }
+    scope->map = NULL;
+    scope->map_count = 0;
+    scope->retired = NULL;
     scope->depth = parent ? parent->depth + 1 : 0;
     return scope;
 }
@@ -79,21 +252,37 @@ void scope_destroy(Scope* scope) {
         }
         da_destroy(scope->symbols);
     }
+    for (size_t i = 0; i < da_count(scope->retired); ++i) {
+        symbol_destroy((Symbol*)da_get(scope->retired, i));
+    }
+    if (scope->retired) da_destroy(scope->retired);
+    hamt_release(scope->map);
     free(scope);
 }
 
 bool scope_define(Scope* scope, Symbol* symbol) {
     if (!scope || !symbol) return false;
     // Check for redefinition in the current scope only
-    for (size_t i = 0; i < da_count(scope->symbols); ++i) {
-        Symbol* existing = (Symbol*)da_get(scope->symbols, i);
-        if (existing->name_token.length == symbol->name_token.length &&
-            strncmp(existing->name_token.lexeme, symbol->name_token.lexeme, symbol->name_token.length) == 0) {
-            // Symbol already defined in this scope
-            return false;
-        }
+    uint32_t hash = hash_bytes(symbol->name_token.lexeme, symbol->name_token.length);
+    if (hamt_lookup(scope->map, hash, symbol->name_token)) {
+        // Symbol already defined in this scope
+        return false;
+    }
+    HamtNode* new_map = hamt_insert(scope->map, 0, (HamtSlot){hash, symbol, NULL});
+    if (!new_map) return false;
+    // Slots are dense: the next slot is simply the current number of symbols.
+    int slot = (int)da_count(scope->symbols);
+    if (da_push(scope->symbols, symbol) != 0) {
+        hamt_release(new_map);
+        return false;
     }
-    return da_push(scope->symbols, symbol) == 0;
+    // Older versions stay alive for as long as snapshots reference them.
+    hamt_release(scope->map);
+    scope->map = new_map;
+    scope->map_count++;
+    symbol->depth = scope->depth;
+    symbol->slot = slot;
+    return true;
 }
 
 Symbol* scope_lookup(Scope* scope, Token name_token) {
@@ -108,14 +297,68 @@ Symbol* scope_lookup(Scope* scope, Token name_token) {
 
 Symbol* scope_lookup_current(Scope* scope, Token name_token) {
     if (!scope) return NULL;
-    for (size_t i = 0; i < da_count(scope->symbols); ++i) {
-        Symbol* symbol = (Symbol*)da_get(scope->symbols, i);
-        if (symbol->name_token.length == name_token.length &&
-            strncmp(symbol->name_token.lexeme, name_token.lexeme, name_token.length) == 0) {
-            return symbol;
+    return hamt_lookup(scope->map, hash_bytes(name_token.lexeme, name_token.length), name_token);
+}
+
+Symbol* scope_symbol_at(Scope* scope, int slot) {
+    if (!scope || slot < 0) return NULL;
+    return (Symbol*)da_get(scope->symbols, (size_t)slot);
+}
+
+// --- Snapshot Functions ---
+
+ScopeSnapshot scope_snapshot(Scope* scope) {
+    ScopeSnapshot snapshot = {NULL, 0, 0, NULL};
+    if (!scope) return snapshot;
+    snapshot.root = hamt_retain(scope->map);
+    snapshot.count = scope->map_count;
+    snapshot.symbol_count = da_count(scope->symbols);
+    snapshot.last = snapshot.symbol_count ? (Symbol*)da_get(scope->symbols, snapshot.symbol_count - 1) : NULL;
+    return snapshot;
+}
+
+void scope_snapshot_release(ScopeSnapshot* snapshot) {
+    if (!snapshot) return;
+    hamt_release(snapshot->root);
+    *snapshot = (ScopeSnapshot){NULL, 0, 0, NULL};
+}
+
+Symbol* scope_snapshot_lookup(const ScopeSnapshot* snapshot, Token name_token) {
+    if (!snapshot) return NULL;
+    return hamt_lookup(snapshot->root, hash_bytes(name_token.lexeme, name_token.length), name_token);
+}
+
+void scope_snapshot_foreach(const ScopeSnapshot* snapshot, void (*visit)(Symbol* symbol, void* ctx), void* ctx) {
+    if (!snapshot || !visit) return;
+    hamt_foreach(snapshot->root, visit, ctx);
+}
+
+bool scope_restore(Scope* scope, const ScopeSnapshot* snapshot) {
+    if (!scope || !snapshot) return false;
+    // The snapshot must still describe a prefix of the slots: a symbol is never
+    // freed before its scope, so a slot refilled after an earlier rollback
+    // holds a different pointer.
+    size_t count = da_count(scope->symbols);
+    if (snapshot->symbol_count > count) return false;
+    if (snapshot->symbol_count > 0 && da_get(scope->symbols, snapshot->symbol_count - 1) != snapshot->last) return false;
+    if (count > snapshot->symbol_count && !scope->retired) {
+        scope->retired = da_create(count - snapshot->symbol_count, sizeof(Symbol*));
+        if (!scope->retired) return false;
+    }
+    // Symbols defined since stay alive (newer snapshots and the AST may still
+    // point to them) but leave the slot view, so their slots are reused.
+    for (size_t i = snapshot->symbol_count; i < count; ++i) {
+        if (da_push(scope->retired, da_get(scope->symbols, i)) != 0) {
+            while (i-- > snapshot->symbol_count) da_pop(scope->retired);
+            return false;
         }
     }
-    return NULL;
+    while (da_count(scope->symbols) > snapshot->symbol_count) da_pop(scope->symbols);
+    HamtNode* old_map = scope->map;
+    scope->map = hamt_retain(snapshot->root);
+    scope->map_count = snapshot->count;
+    hamt_release(old_map);
+    return true;
 }
 
 
@@ -130,17 +373,59 @@ SymbolTable* symbol_table_create() {
         return NULL;
     }
     table->current_scope = table->global_scope;
+    table->shared_globals = NULL;
+    table->is_worker = false;
+    table->closed_scopes = NULL;
+    return table;
+}
+
+void symbol_table_attach_globals(SymbolTable* table, GlobalSymbolTable* shared_globals) {
+    if (!table || table->is_worker) return;
+    global_symbol_table_destroy(table->shared_globals);
+    table->shared_globals = shared_globals;
+}
+
+SymbolTable* symbol_table_create_worker(SymbolTable* base) {
+    if (!base) return NULL;
+    SymbolTable* table = (SymbolTable*)malloc(sizeof(SymbolTable));
+    if (!table) return NULL;
+    table->global_scope = base->global_scope;
+    table->current_scope = base->global_scope;
+    table->shared_globals = base->shared_globals;
+    table->is_worker = true;
+    table->closed_scopes = NULL;
     return table;
 }
 
+void symbol_table_destroy_worker(SymbolTable* worker, SymbolTable* base) {
+    if (!worker) return;
+    while (worker->current_scope != worker->global_scope) symbol_table_exit_scope(worker);
+    for (size_t i = 0; i < da_count(worker->closed_scopes); ++i) {
+        Scope* scope = (Scope*)da_get(worker->closed_scopes, i);
+        if (base && !base->closed_scopes) base->closed_scopes = da_create(da_count(worker->closed_scopes), sizeof(Scope*));
+        if (!base || !base->closed_scopes || da_push(base->closed_scopes, scope) != 0) scope_destroy(scope);
+    }
+    if (worker->closed_scopes) da_destroy(worker->closed_scopes);
+    free(worker);
+}
+
 void symbol_table_destroy(SymbolTable* table) {
     if (!table) return;
+    if (table->is_worker) {
+        symbol_table_destroy_worker(table, NULL);
+        return;
+    }
     // Destroying global_scope will recursively destroy child scopes if that logic is added,
     // or we need to manage the scope stack carefully.
     // For now, SymbolTable only directly owns global_scope.
     // If scopes are pushed/popped, current_scope should point to a scope that will be
     // part of the global_scope's parent chain or global_scope itself.
     scope_destroy(table->global_scope); // This will free all symbols defined within.
+    for (size_t i = 0; i < da_count(table->closed_scopes); ++i) {
+        scope_destroy((Scope*)da_get(table->closed_scopes, i));
+    }
+    if (table->closed_scopes) da_destroy(table->closed_scopes);
+    global_symbol_table_destroy(table->shared_globals);
     free(table);
 }
 
@@ -163,17 +448,58 @@ void symbol_table_exit_scope(SymbolTable* table) {
     // Else: error or trying to exit global scope, handle as appropriate.
 }
 
+void symbol_table_close_scope(SymbolTable* table) {
+    if (!table || !table->current_scope || !table->current_scope->parent) return;
+    Scope* old_scope = table->current_scope;
+    table->current_scope = old_scope->parent;
+    if (!table->closed_scopes) table->closed_scopes = da_create(8, sizeof(Scope*));
+    if (table->closed_scopes) {
+        da_push(table->closed_scopes, old_scope);
+    } else {
+        scope_destroy(old_scope);
+    }
+}
+
 bool symbol_table_define(SymbolTable* table, Symbol* symbol) {
     if (!table || !table->current_scope) return false;
+    if (table->is_worker && table->current_scope == table->global_scope) return false;
     return scope_define(table->current_scope, symbol);
 }
 
 Symbol* symbol_table_lookup(SymbolTable* table, Token name_token) {
     if (!table || !table->current_scope) return NULL;
-    return scope_lookup(table->current_scope, name_token);
+    Symbol* symbol = scope_lookup(table->current_scope, name_token);
+    if (!symbol && table->shared_globals) symbol = global_symbol_table_lookup(table->shared_globals, name_token);
+    return symbol;
 }
 
 Symbol* symbol_table_lookup_current(SymbolTable* table, Token name_token) {
     if (!table || !table->current_scope) return NULL;
-    return scope_lookup_current(table->current_scope, name_token);
+    Symbol* symbol = scope_lookup_current(table->current_scope, name_token);
+    if (!symbol && table->shared_globals && table->current_scope == table->global_scope) {
+        symbol = global_symbol_table_lookup(table->shared_globals, name_token);
+    }
+    return symbol;
+}
+
+ScopeSnapshot symbol_table_snapshot_globals(SymbolTable* table) {
+    return scope_snapshot(table ? table->global_scope : NULL);
+}
+
+bool symbol_table_restore_globals(SymbolTable* table, const ScopeSnapshot* snapshot) {
+    if (!table || table->is_worker) return false;
+    return scope_restore(table->global_scope, snapshot);
+}
+
+Symbol* symbol_table_symbol_at(SymbolTable* table, int depth, int slot) {
+    if (!table) return NULL;
+    Scope* scope = table->current_scope;
+    while (scope && scope->depth > depth) {
+        scope = scope->parent;
+    }
+    if (!scope || scope->depth != depth) return NULL;
+    if (depth == 0 && table->shared_globals && slot >= (int)da_count(scope->symbols)) {
+        return global_symbol_table_symbol_at(table->shared_globals, slot);
+    }
+    return scope_symbol_at(scope, slot);
 }
@@ -5,9 +5,11 @@
 #include "../util/dynamic_array.h" // For managing scopes or symbol lists
 #include "token.h"   // For symbol names (Tokens)
 #include "types.h"   // For Type* and ADTDefinition*
+#include "global_symbol_table.h" // For top-level bindings declared by worker threads
 
 // Forward declaration for recursive type (Scope contains Symbols, Symbol might point to Scope for functions/modules)
 struct Scope;
+struct HamtNode; // Persistent name -> Symbol* map node (see symbol_table.c)
 
 // Kind of symbol (variable, function, type, etc.)
 typedef enum {
@@ -26,11 +28,13 @@ typedef struct Symbol {
     Token name_token; // The token that defines this symbol's name
     Type* type;       // Resolved type of the symbol (e.g., type of a variable, or the ADT's own type)
     // struct Scope* defined_in_scope; // Pointer to the scope where this symbol is defined
+    int depth;        // Depth of the defining scope, set by scope_define (-1 until defined)
+    int slot;         // Dense index of this symbol within its defining scope, set by scope_define
 
     union {
         // For SYMBOL_VARIABLE, SYMBOL_PARAMETER:
         struct {
-            // bool is_mutable;
+            bool is_mutable; // `let mut`: may be borrowed as `&mut`
             // bool is_used;
             // For ownership:
             // OwnershipState ownership_state; // e.g., OWNED, BORROWED_IMM, BORROWED_MUT
@@ -59,15 +63,32 @@ typedef struct Symbol {
 
 
 // Scope structure (for lexical scoping)
-// A simple approach for now: each scope has a list of symbols and a pointer to its parent.
-// A hash map would be more efficient for symbol lookup.
+// Each scope owns the symbols defined in it and maps names to them through a
+// persistent hash array mapped trie (HAMT): inserts copy only the path to the
+// changed node, so every previous version of the map stays valid and can be
+// kept as an O(1) snapshot (see ScopeSnapshot below).
 typedef struct Scope {
     struct Scope* parent;
-    DynamicArray* symbols; // DynamicArray of Symbol*
-    // We might use a hash map here for faster lookups: HashMap* symbol_map; (string name -> Symbol*)
+    DynamicArray* symbols; // DynamicArray of Symbol*, indexed by slot (symbols[i]->slot == i). Owns the symbols.
+    struct HamtNode* map;  // Current version of the name -> Symbol* map (NULL when empty)
+    size_t map_count;      // Number of names visible in the current version
+    DynamicArray* retired; // Symbol* rolled back by scope_restore, owned until the scope is destroyed (NULL if none)
     int depth; // Scope depth (0 for global, 1 for first level, etc.)
 } Scope;
 
+// An immutable version of a scope, e.g. the global scope after each REPL input
+// or editor change. Taking one is O(1) and shares all structure with the live
+// scope. Snapshots can be queried from other threads while the analyzer keeps
+// defining symbols in the scope.
+// The symbols themselves stay owned by the scope: a snapshot must be released
+// before its scope is destroyed.
+typedef struct {
+    struct HamtNode* root;
+    size_t count;          // Names visible in this version
+    size_t symbol_count;   // Slots in use when it was taken
+    struct Symbol* last;   // The symbol in the last of those slots (NULL if none)
+} ScopeSnapshot;
+
 
 // --- Symbol Table API ---
 
@@ -91,11 +112,40 @@ Symbol* scope_lookup(Scope* scope, Token name_token);
 // Returns NULL if not found.
 Symbol* scope_lookup_current(Scope* scope, Token name_token);
 
+// Returns the symbol occupying the given slot of this scope, or NULL if out of range.
+Symbol* scope_symbol_at(Scope* scope, int slot);
+
+// Snapshot functions
+// Captures the current version of the scope. O(1).
+ScopeSnapshot scope_snapshot(Scope* scope);
+// Releases a snapshot. Safe to call on an already released (zeroed) snapshot.
+void scope_snapshot_release(ScopeSnapshot* snapshot);
+// Looks up a name in a snapshot. O(log32 n). Thread-safe.
+Symbol* scope_snapshot_lookup(const ScopeSnapshot* snapshot, Token name_token);
+// Calls `visit` for every symbol visible in the snapshot (e.g. for completion). Order is unspecified.
+void scope_snapshot_foreach(const ScopeSnapshot* snapshot, void (*visit)(Symbol* symbol, void* ctx), void* ctx);
+// Rolls the scope back to a snapshot taken from it: names defined since become
+// invisible and their slots free again (the symbols stay alive, owned by the
+// scope). Returns false, changing nothing, if the snapshot is not an earlier
+// version of the current scope (e.g. it was taken after a version that has
+// since been rolled back), or on allocation failure.
+bool scope_restore(Scope* scope, const ScopeSnapshot* snapshot);
+
 
 // SymbolTable structure (manages all scopes, could be part of Analyzer state)
 typedef struct {
     Scope* global_scope;
     Scope* current_scope;
+    // Top-level bindings declared concurrently (parallel analysis), with slots
+    // after the global scope's own. Lookups that miss the scope chain fall
+    // through to them. NULL until attached with symbol_table_attach_globals.
+    GlobalSymbolTable* shared_globals;
+    // Worker tables (symbol_table_create_worker) borrow global_scope and
+    // shared_globals and own only the scopes opened above them.
+    bool is_worker;
+    // Scopes left with symbol_table_close_scope, kept alive until the table is
+    // destroyed (DynamicArray of Scope*, NULL until the first one).
+    DynamicArray* closed_scopes;
     // Potentially a list of all allocated types for easier cleanup, or type interning table.
     // DynamicArray* all_types;
 } SymbolTable;
@@ -103,8 +153,24 @@ typedef struct {
 SymbolTable* symbol_table_create();
 void symbol_table_destroy(SymbolTable* table);
 
+// Hands `shared_globals` to the table, which frees it on destruction.
+void symbol_table_attach_globals(SymbolTable* table, GlobalSymbolTable* shared_globals);
+
+// Creates a per-thread table whose own scope stack sits on `base`'s global
+// scope and shared globals, which must not change while the worker is in use.
+// Top-level symbols cannot be defined through it.
+SymbolTable* symbol_table_create_worker(SymbolTable* base);
+
+// Frees a worker table. The scopes it closed, whose symbols the AST still
+// points to, are handed to `base`.
+void symbol_table_destroy_worker(SymbolTable* worker, SymbolTable* base);
+
 void symbol_table_enter_scope(SymbolTable* table);
 void symbol_table_exit_scope(SymbolTable* table);
+// Leaves the current scope like symbol_table_exit_scope, but keeps its symbols
+// alive until the table is destroyed: for scopes whose bindings stay annotated
+// on the AST, such as the variables bound by match arms.
+void symbol_table_close_scope(SymbolTable* table);
 
 // Defines a symbol in the current scope of the table.
 bool symbol_table_define(SymbolTable* table, Symbol* symbol);
@@ -115,5 +181,14 @@ Symbol* symbol_table_lookup(SymbolTable* table, Token name_token);
 // Looks up a symbol only in the immediate current scope of the table.
 Symbol* symbol_table_lookup_current(SymbolTable* table, Token name_token);
 
+// Snapshot / rollback of the global scope, e.g. one version per REPL input.
+// Bindings in shared_globals (parallel analysis) are not part of it.
+ScopeSnapshot symbol_table_snapshot_globals(SymbolTable* table);
+bool symbol_table_restore_globals(SymbolTable* table, const ScopeSnapshot* snapshot);
+
+// Returns the symbol bound at (depth, slot) as seen from the current scope,
+// i.e. the binding recorded on an ExprVariable by the resolver. No name comparison.
+Symbol* symbol_table_symbol_at(SymbolTable* table, int depth, int slot);
+
 
 #endif // SYMBOL_TABLE_H
@@ -26,6 +26,9 @@ const char* token_type_to_string(TokenType type) {
         case TOKEN_TRUE: return "TRUE";
         case TOKEN_FALSE: return "FALSE";
         case TOKEN_TYPE: return "TYPE";
+        case TOKEN_CLASS: return "CLASS";
+        case TOKEN_INSTANCE: return "INSTANCE";
+        case TOKEN_FOR: return "FOR";
         case TOKEN_PLUS: return "PLUS";
         case TOKEN_MINUS: return "MINUS";
         case TOKEN_ASTERISK: return "ASTERISK";
@@ -68,20 +71,15 @@ Token token_create(TokenType type, const char* lexeme, size_t length, int line,
     return token;
 }
 
-// For error tokens, the 'lexeme' field will point to the error message.
-// The 'length' will be the length of this message.
-Token token_error_create(const char* message, int line, int col) {
-    Token token;
-    token.type = TOKEN_ERROR;
-    // It's better if `message` is a string literal or comes from a buffer
-    // that outlives the token's usage, or is copied. For now, direct assignment.
-    // If `message` needs to be dynamic and unique per token, it must be allocated
-    // and freed appropriately. For now, assume `message` is static or managed elsewhere.
-    token.lexeme = message;
-    token.length = strlen(message); // Calculate length of the message
-    token.line = line;
-    token.col = col;
-    return token;
+bool token_integer_value(Token token, int32_t* value) {
+    int32_t result = 0;
+    for (size_t i = 0; i < token.length; ++i) {
+        int digit = token.lexeme[i] - '0';
+        if (result > (INT32_MAX - digit) / 10) return false;
+        result = result * 10 + digit;
+    }
+    *value = result;
+    return true;
 }
 
 // Example of how tokens might be printed (for debugging)
@@ -99,7 +97,4 @@ void token_print(Token token) {
                (int)token.length, token.lexeme,
                token.length, token.line, token.col);
     }
-     if (token.type == TOKEN_ERROR) {
-        printf("  ERROR MESSAGE: %.*s\n", (int)token.length, token.lexeme);
-    }
 }
@@ -1,7 +1,9 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include <stdbool.h>
 #include <stddef.h> // For size_t
+#include <stdint.h> // For int32_t
 
 // Enum for all possible token types
 typedef enum {
@@ -27,6 +29,9 @@ typedef enum {
     TOKEN_TRUE,       // `true`
     TOKEN_FALSE,      // `false`
     TOKEN_TYPE,       // `type` (for type aliases, future)
+    TOKEN_CLASS,      // `class` (typeclass declaration)
+    TOKEN_INSTANCE,   // `instance` (typeclass instance)
+    TOKEN_FOR,        // `for` (in `instance C for T`; loops later)
     // Add more keywords as language evolves (e.g., for, while, struct, enum (if different from data), pub, etc.)
 
     // Operators
@@ -93,8 +98,10 @@ const char* token_type_to_string(TokenType type);
 // Lexeme is NOT copied by this function, it assumes lexeme points to source or a stable buffer.
 Token token_create(TokenType type, const char* lexeme, size_t length, int line, int col);
 
-// Function to create an error token
-Token token_error_create(const char* message, int line, int col);
+// Value of a TOKEN_INTEGER literal. Returns false if it does not fit in an i32,
+// the only integer type.
+bool token_integer_value(Token token, int32_t* value);
+
 
 
 #endif // TOKEN_H
@@ -0,0 +1,117 @@
+#include "type_caps.h"
+#include "symbol_table.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CAPS_ALL (TYPE_CAP_COPY | TYPE_CAP_TRIVIAL_DROP | TYPE_CAP_ZERO_SIZED | TYPE_CAP_POD)
+#define CAPS_VISITING 0x100u // Scratch: type belongs to the component being solved
+
+// Serializes derivations; reads of already-known bits never take it.
+static pthread_mutex_t caps_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t leaf_capabilities(Type* type) {
+    if (type->flags & (TYPE_HAS_PARAMS | TYPE_HAS_VARS)) return 0;
+    switch (type->kind) {
+        case TYPE_PRIMITIVE:
+            if (type == type_i32_instance || type == type_bool_instance) {
+                return TYPE_CAP_COPY | TYPE_CAP_TRIVIAL_DROP | TYPE_CAP_POD;
+            }
+            return 0; // String owns a heap buffer
+        case TYPE_REFERENCE:
+            // Shared references are freely copied; `&mut` is unique. Neither owns anything.
+            return ((TypeReference*)type)->is_mutable ? TYPE_CAP_TRIVIAL_DROP : TYPE_CAP_COPY | TYPE_CAP_TRIVIAL_DROP;
+        case TYPE_VOID:
+            return CAPS_ALL;
+        default:
+            return 0;
+    }
+}
+
+// Capabilities of a field type while its parent is being derived. A type still
+// marked VISITING would be an unboxed cycle, which the ADT graph rules out.
+static uint32_t field_capabilities(Type* type) {
+    uint32_t caps = atomic_load(&type->capabilities);
+    if (caps & TYPE_CAP_KNOWN) return caps & CAPS_ALL;
+    if (caps & CAPS_VISITING) return 0;
+    return leaf_capabilities(type);
+}
+
+static bool field_is_boxed(const ADTInstanceVariant* variant, size_t field) {
+    return ((ADTFieldSymbol*)da_get(variant->variant->fields, field))->boxed;
+}
+
+// An ADT has a capability when all its fields have it. Boxed fields are owning
+// pointers and have none.
+static uint32_t derive(ADTInstanceCache* instances, Type* type) {
+    const ADTInstance* instance = adt_instance_get(instances, type);
+    if (!instance) return 0; // Definition not analyzed
+    uint32_t caps = CAPS_ALL;
+    if (instance->variant_count > 1) caps &= ~TYPE_CAP_ZERO_SIZED;
+    for (size_t v = 0; v < instance->variant_count; ++v) {
+        const ADTInstanceVariant* variant = &instance->variants[v];
+        for (size_t f = 0; f < variant->field_count; ++f) {
+            caps &= field_is_boxed(variant, f) ? 0 : field_capabilities(variant->field_types[f]);
+        }
+    }
+    if (!(caps & TYPE_CAP_COPY)) caps &= ~TYPE_CAP_POD;
+    return caps;
+}
+
+uint32_t type_capabilities(ADTInstanceCache* instances, Type* type) {
+    if (!type) return 0;
+    uint32_t caps = atomic_load(&type->capabilities);
+    if (caps & TYPE_CAP_KNOWN) return caps & CAPS_ALL;
+    if (type->kind != TYPE_ADT || (type->flags & (TYPE_HAS_PARAMS | TYPE_HAS_VARS))) {
+        caps = leaf_capabilities(type);
+        atomic_store(&type->capabilities, caps | TYPE_CAP_KNOWN);
+        return caps;
+    }
+
+    pthread_mutex_lock(&caps_lock);
+    // Post-order over unboxed fields: every field type is known before its parent.
+    // Boxing breaks every cycle (see adt_graph.h), so this is a walk over a DAG
+    // and each type is derived exactly once.
+    DynamicArray* stack = da_create(16, sizeof(Type*));
+    if (stack) da_push(stack, type);
+    while (stack && da_count(stack) > 0) {
+        Type* top = (Type*)da_get(stack, da_count(stack) - 1);
+        uint32_t state = atomic_load(&top->capabilities);
+        if (state & TYPE_CAP_KNOWN) {
+            da_pop(stack);
+            continue;
+        }
+        if (state & CAPS_VISITING) { // Fields done
+            da_pop(stack);
+            atomic_store(&top->capabilities, derive(instances, top) | TYPE_CAP_KNOWN);
+            continue;
+        }
+        atomic_store(&top->capabilities, CAPS_VISITING);
+        const ADTInstance* instance = adt_instance_get(instances, top);
+        for (size_t v = 0; instance && v < instance->variant_count; ++v) {
+            const ADTInstanceVariant* variant = &instance->variants[v];
+            for (size_t f = 0; f < variant->field_count; ++f) {
+                Type* field = variant->field_types[f];
+                if (field_is_boxed(variant, f) || field->kind != TYPE_ADT) continue;
+                if (atomic_load(&field->capabilities) & (TYPE_CAP_KNOWN | CAPS_VISITING)) continue;
+                da_push(stack, field);
+            }
+        }
+    }
+    da_destroy(stack);
+    // Allocation failure: publish "nothing known" rather than leave the type half-derived.
+    if (!(atomic_load(&type->capabilities) & TYPE_CAP_KNOWN)) atomic_store(&type->capabilities, TYPE_CAP_KNOWN);
+    caps = atomic_load(&type->capabilities) & CAPS_ALL;
+    pthread_mutex_unlock(&caps_lock);
+    return caps;
+}
+
+void type_capabilities_describe(uint32_t caps, char* buf, size_t size) {
+    if (!buf || size == 0) return;
+    snprintf(buf, size, "%s%s%s%s",
+             caps & TYPE_CAP_COPY ? " copy" : "",
+             caps & TYPE_CAP_TRIVIAL_DROP ? " trivial-drop" : "",
+             caps & TYPE_CAP_ZERO_SIZED ? " zero-sized" : "",
+             caps & TYPE_CAP_POD ? " pod" : "");
+}
@@ -0,0 +1,32 @@
+#ifndef TYPE_CAPS_H
+#define TYPE_CAPS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+#include "adt_instance.h"
+
+// Capability bits of concrete types (TYPE_CAP_* in types.h).
+//
+// Primitives and references have fixed capabilities. An ADT has a capability
+// when every field of every variant has it; it is Copy exactly when it is made
+// only of Copy types, as docs/ownership_model.md describes. Fields that close a
+// recursive cycle are boxed (see adt_graph.h); a box is an owning pointer, so
+// an ADT that contains itself by value is never Copy, trivially droppable, POD
+// or zero-sized. References don't propagate, so `data Node { N(i32, &Node) }`
+// is still Copy. Since boxes break every cycle, capabilities are derived by one
+// post-order walk, fields before the types containing them.
+//
+// The result is computed once per interned type and cached in Type.capabilities.
+// Types that mention generic parameters or inference variables have no
+// capabilities. Thread-safe.
+uint32_t type_capabilities(ADTInstanceCache* instances, Type* type);
+
+static inline bool type_is_copy(ADTInstanceCache* instances, Type* type) {
+    return (type_capabilities(instances, type) & TYPE_CAP_COPY) != 0;
+}
+
+// Writes the names of the set bits ("copy pod ...") into buf.
+void type_capabilities_describe(uint32_t caps, char* buf, size_t size);
+
+#endif // TYPE_CAPS_H
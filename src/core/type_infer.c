@@ -0,0 +1,607 @@
+#include "type_infer.h"
+#include "token.h"
+#include "../util/string_builder.h"
+#include <stdio.h>  // For fprintf, stderr for errors
+#include <stdlib.h> // For malloc, realloc, free
+#include <string.h> // For strlen
+
+// One union-find entry per inference variable.
+typedef struct {
+    uint32_t parent;  // Union-find parent (itself for a root)
+    uint32_t rank;    // Union by rank
+    int level;        // Let-nesting level; variables above the current level generalize
+    Type* bound;      // Non-variable type bound to this class (roots only, NULL if unbound)
+    Type* var_type;   // The interned TYPE_VAR for this slot
+    Type* generalized;// Generic parameter replacing this root while generalizing a `let`
+} TypeVarEntry;
+
+struct TypeInferencer {
+    TypeVarEntry* vars;
+    size_t var_count;
+    size_t var_capacity;
+    int level;
+    Diagnostics* diagnostics; // Not owned; NULL reports to stderr
+    bool had_error;
+    size_t error_count;
+};
+
+// Parameter names for generalized `let` types, in order of appearance.
+static const char* const generalized_names[] = {
+    "'a", "'b", "'c", "'d", "'e", "'f", "'g", "'h", "'i", "'j", "'k", "'l", "'m",
+    "'n", "'o", "'p", "'q", "'r", "'s", "'t", "'u", "'v", "'w", "'x", "'y", "'z",
+};
+
+
+// --- Error Reporting ---
+
+static Token expr_token(Expr* expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL: return ((ExprLiteral*)expr)->literal;
+        case EXPR_VARIABLE: return ((ExprVariable*)expr)->name;
+        case EXPR_CALL: return expr_token(((ExprCall*)expr)->callee);
+        case EXPR_BORROW: return ((ExprBorrow*)expr)->ampersand;
+        case EXPR_MATCH: return ((ExprMatch*)expr)->keyword;
+        default: return (Token){0};
+    }
+}
+
+static void type_mismatch_at(TypeInferencer* inferencer, Token token, const char* what, Type* expected, Type* actual) {
+    inferencer->had_error = true;
+    inferencer->error_count++;
+    char* expected_str = type_to_string(expected);
+    char* actual_str = type_to_string(actual);
+    StringBuilder* message = sb_create(0);
+    if (message && sb_appendf(message, "%s: expected %s but got %s.", what, expected_str ? expected_str : "?",
+                              actual_str ? actual_str : "?") == 0) {
+        diagnostics_report(inferencer->diagnostics, DIAG_TYPE, token, sb_get_str(message));
+    } else {
+        diagnostics_report(inferencer->diagnostics, DIAG_TYPE, token, what);
+    }
+    sb_destroy(message);
+    free(expected_str);
+    free(actual_str);
+}
+
+
+// --- Union-Find ---
+
+static Type* fresh_var(TypeInferencer* inferencer) {
+    if (inferencer->var_count == inferencer->var_capacity) {
+        size_t new_capacity = inferencer->var_capacity ? inferencer->var_capacity * 2 : 64;
+        TypeVarEntry* new_vars = (TypeVarEntry*)realloc(inferencer->vars, new_capacity * sizeof(TypeVarEntry));
+        if (!new_vars) return type_error();
+        inferencer->vars = new_vars;
+        inferencer->var_capacity = new_capacity;
+    }
+    uint32_t index = (uint32_t)inferencer->var_count;
+    Type* var_type = type_intern_var(inferencer, index);
+    if (!var_type) return type_error();
+    inferencer->var_count++;
+    inferencer->vars[index] = (TypeVarEntry){index, 0, inferencer->level, NULL, var_type, NULL};
+    return var_type;
+}
+
+static bool is_own_var(const TypeInferencer* inferencer, const Type* type) {
+    return type->kind == TYPE_VAR && ((const TypeVar*)type)->owner == inferencer;
+}
+
+static uint32_t find(TypeInferencer* inferencer, uint32_t index) {
+    uint32_t root = index;
+    while (inferencer->vars[root].parent != root) root = inferencer->vars[root].parent;
+    while (inferencer->vars[index].parent != root) { // Path compression
+        uint32_t next = inferencer->vars[index].parent;
+        inferencer->vars[index].parent = root;
+        index = next;
+    }
+    return root;
+}
+
+// Follows variable bindings at the top of `type`: returns the bound type, or the
+// representative variable of an unbound class.
+static Type* shorten(TypeInferencer* inferencer, Type* type) {
+    if (!is_own_var(inferencer, type)) return type;
+    uint32_t root = find(inferencer, ((TypeVar*)type)->index);
+    return inferencer->vars[root].bound ? inferencer->vars[root].bound : inferencer->vars[root].var_type;
+}
+
+// Occurs check for binding `root` to `type`, lowering the levels of the variables
+// in `type` to `level` so they are not generalized past the binding's scope.
+static bool occurs_adjust(TypeInferencer* inferencer, uint32_t root, int level, Type* type) {
+    if (!(type->flags & TYPE_HAS_VARS)) return true;
+    type = shorten(inferencer, type);
+    switch (type->kind) {
+        case TYPE_VAR: {
+            if (!is_own_var(inferencer, type)) return true;
+            uint32_t other = find(inferencer, ((TypeVar*)type)->index);
+            if (other == root) return false;
+            if (inferencer->vars[other].level > level) inferencer->vars[other].level = level;
+            return true;
+        }
+        case TYPE_ADT: {
+            TypeADT* adt = (TypeADT*)type;
+            for (size_t i = 0; i < adt->type_arg_count; ++i) {
+                if (!occurs_adjust(inferencer, root, level, adt->type_args[i])) return false;
+            }
+            return true;
+        }
+        case TYPE_REFERENCE:
+            return occurs_adjust(inferencer, root, level, ((TypeReference*)type)->referent);
+        default:
+            return true;
+    }
+}
+
+static bool bind_var(TypeInferencer* inferencer, Type* var, Type* type) {
+    uint32_t root = find(inferencer, ((TypeVar*)var)->index);
+    if (is_own_var(inferencer, type)) {
+        uint32_t other = find(inferencer, ((TypeVar*)type)->index);
+        if (root == other) return true;
+        TypeVarEntry* a = &inferencer->vars[root];
+        TypeVarEntry* b = &inferencer->vars[other];
+        int level = a->level < b->level ? a->level : b->level;
+        if (a->rank < b->rank) {
+            a->parent = other;
+            b->level = level;
+        } else {
+            b->parent = root;
+            a->level = level;
+            if (a->rank == b->rank) a->rank++;
+        }
+        return true;
+    }
+    if (!occurs_adjust(inferencer, root, inferencer->vars[root].level, type)) return false;
+    inferencer->vars[root].bound = type;
+    return true;
+}
+
+static bool unify(TypeInferencer* inferencer, Type* a, Type* b) {
+    a = shorten(inferencer, a);
+    b = shorten(inferencer, b);
+    if (a == b) return true; // Interned: structurally equal types are the same pointer
+    // Errors and unresolved placeholders have already been reported; don't cascade.
+    if (a->kind == TYPE_ERROR || b->kind == TYPE_ERROR || a->kind == TYPE_UNKNOWN || b->kind == TYPE_UNKNOWN) {
+        return true;
+    }
+    if (is_own_var(inferencer, a)) return bind_var(inferencer, a, b);
+    if (is_own_var(inferencer, b)) return bind_var(inferencer, b, a);
+    if (a->kind != b->kind) return false;
+    switch (a->kind) {
+        case TYPE_ADT: {
+            TypeADT* x = (TypeADT*)a;
+            TypeADT* y = (TypeADT*)b;
+            if (x->adt_symbol != y->adt_symbol || x->type_arg_count != y->type_arg_count) return false;
+            for (size_t i = 0; i < x->type_arg_count; ++i) {
+                if (!unify(inferencer, x->type_args[i], y->type_args[i])) return false;
+            }
+            return true;
+        }
+        case TYPE_REFERENCE: {
+            TypeReference* x = (TypeReference*)a;
+            TypeReference* y = (TypeReference*)b;
+            return x->is_mutable == y->is_mutable && unify(inferencer, x->referent, y->referent);
+        }
+        default:
+            return false; // Distinct primitives, or different generic parameters
+    }
+}
+
+
+// --- Substitution ---
+
+typedef Type* (*ParamMapper)(void* ctx, const TypeGenericParam* param);
+
+// Rebuilds `type` with every parameter owned by `owner` replaced by map(ctx, param)
+// (a NULL result keeps the parameter). Shares every subtree that does not change.
+static Type* map_params(Type* type, const Symbol* owner, ParamMapper map, void* ctx) {
+    if (!type || !(type->flags & TYPE_HAS_PARAMS)) return type;
+    switch (type->kind) {
+        case TYPE_GENERIC_PARAM: {
+            TypeGenericParam* param = (TypeGenericParam*)type;
+            if (param->owner != owner) return type;
+            Type* replacement = map(ctx, param);
+            return replacement ? replacement : type;
+        }
+        case TYPE_ADT: {
+            TypeADT* adt = (TypeADT*)type;
+            Type* stack_args[8];
+            Type** args = adt->type_arg_count <= 8 ? stack_args : (Type**)malloc(adt->type_arg_count * sizeof(Type*));
+            if (!args) return type_error();
+            bool changed = false;
+            for (size_t i = 0; i < adt->type_arg_count; ++i) {
+                args[i] = map_params(adt->type_args[i], owner, map, ctx);
+                changed |= args[i] != adt->type_args[i];
+            }
+            Type* result = changed ? type_intern_adt(adt->adt_symbol, args, adt->type_arg_count) : type;
+            if (args != stack_args) free(args);
+            return result ? result : type_error();
+        }
+        case TYPE_REFERENCE: {
+            TypeReference* ref = (TypeReference*)type;
+            Type* referent = map_params(ref->referent, owner, map, ctx);
+            return referent == ref->referent ? type : type_intern_reference(referent, ref->is_mutable);
+        }
+        default:
+            return type;
+    }
+}
+
+typedef struct {
+    Type* const* args;
+    size_t arg_count;
+} ArgsMap;
+
+static Type* map_to_args(void* ctx, const TypeGenericParam* param) {
+    ArgsMap* map = (ArgsMap*)ctx;
+    return param->index >= 0 && (size_t)param->index < map->arg_count ? map->args[param->index] : NULL;
+}
+
+Type* type_substitute_params(Type* type, const Symbol* owner, Type* const* args, size_t arg_count) {
+    ArgsMap map = {args, arg_count};
+    return map_params(type, owner, map_to_args, &map);
+}
+
+// Fresh variables for one instantiation, created on first mention of each parameter.
+typedef struct {
+    TypeInferencer* inferencer;
+    Type* fresh[16];
+    Type** overflow; // For owners with more than 16 parameters
+    size_t overflow_count;
+} Instantiation;
+
+static Type* map_to_fresh(void* ctx, const TypeGenericParam* param) {
+    Instantiation* inst = (Instantiation*)ctx;
+    if (param->index < 0) return NULL;
+    size_t index = (size_t)param->index;
+    Type** slot;
+    if (index < 16) {
+        slot = &inst->fresh[index];
+    } else {
+        size_t needed = index - 16 + 1;
+        if (needed > inst->overflow_count) {
+            Type** grown = (Type**)realloc(inst->overflow, needed * sizeof(Type*));
+            if (!grown) return type_error();
+            for (size_t i = inst->overflow_count; i < needed; ++i) grown[i] = NULL;
+            inst->overflow = grown;
+            inst->overflow_count = needed;
+        }
+        slot = &inst->overflow[index - 16];
+    }
+    if (!*slot) *slot = fresh_var(inst->inferencer);
+    return *slot;
+}
+
+static void instantiation_begin(Instantiation* inst, TypeInferencer* inferencer) {
+    inst->inferencer = inferencer;
+    for (size_t i = 0; i < 16; ++i) inst->fresh[i] = NULL;
+    inst->overflow = NULL;
+    inst->overflow_count = 0;
+}
+
+static void instantiation_end(Instantiation* inst) {
+    free(inst->overflow);
+}
+
+
+// --- Zonking and Generalization ---
+
+typedef struct {
+    TypeInferencer* inferencer;
+    Symbol* owner;     // Symbol that owns the generalized parameters (NULL: don't generalize)
+    int next_index;
+} Generalization;
+
+// Fully resolves `type`, replacing unbound variables above the current level with
+// generic parameters owned by gen->owner.
+static Type* zonk(Generalization* gen, Type* type) {
+    if (!type || !(type->flags & TYPE_HAS_VARS)) return type;
+    TypeInferencer* inferencer = gen->inferencer;
+    type = shorten(inferencer, type);
+    switch (type->kind) {
+        case TYPE_VAR: {
+            if (!is_own_var(inferencer, type)) return type;
+            TypeVarEntry* entry = &inferencer->vars[find(inferencer, ((TypeVar*)type)->index)];
+            if (!gen->owner || entry->level <= inferencer->level) return type;
+            if (!entry->generalized) {
+                int index = gen->next_index++;
+                char name[16]; // Copied when interned
+                if (index < 26) snprintf(name, sizeof(name), "%s", generalized_names[index]);
+                else snprintf(name, sizeof(name), "'t%d", index + 1);
+                Token name_token = {.type = TOKEN_IDENTIFIER, .lexeme = name, .length = strlen(name), .line = 0, .col = 0};
+                entry->generalized = type_intern_generic_param(gen->owner, index, name_token);
+                if (!entry->generalized) entry->generalized = type_error();
+            }
+            return entry->generalized;
+        }
+        case TYPE_ADT: {
+            TypeADT* adt = (TypeADT*)type;
+            Type* stack_args[8];
+            Type** args = adt->type_arg_count <= 8 ? stack_args : (Type**)malloc(adt->type_arg_count * sizeof(Type*));
+            if (!args) return type_error();
+            bool changed = false;
+            for (size_t i = 0; i < adt->type_arg_count; ++i) {
+                args[i] = zonk(gen, adt->type_args[i]);
+                changed |= args[i] != adt->type_args[i];
+            }
+            Type* result = changed ? type_intern_adt(adt->adt_symbol, args, adt->type_arg_count) : type;
+            if (args != stack_args) free(args);
+            return result ? result : type_error();
+        }
+        case TYPE_REFERENCE: {
+            TypeReference* ref = (TypeReference*)type;
+            Type* referent = zonk(gen, ref->referent);
+            return referent == ref->referent ? type : type_intern_reference(referent, ref->is_mutable);
+        }
+        default:
+            return type;
+    }
+}
+
+static void zonk_pattern(Generalization* gen, Pattern* pattern) {
+    if (!pattern) return;
+    if (pattern->inferred_type) pattern->inferred_type = zonk(gen, pattern->inferred_type);
+    if (pattern->symbol && pattern->symbol->type) pattern->symbol->type = zonk(gen, pattern->symbol->type);
+    for (size_t i = 0; i < da_count(pattern->subpatterns); ++i) {
+        zonk_pattern(gen, (Pattern*)da_get(pattern->subpatterns, i));
+    }
+}
+
+static void zonk_expr(Generalization* gen, Expr* expr) {
+    if (!expr) return;
+    expr->inferred_type = zonk(gen, expr->inferred_type);
+    if (expr->type == EXPR_CALL) {
+        ExprCall* call_expr = (ExprCall*)expr;
+        for (size_t i = 0; i < da_count(call_expr->arguments); ++i) {
+            zonk_expr(gen, (Expr*)da_get(call_expr->arguments, i));
+        }
+    } else if (expr->type == EXPR_BORROW) {
+        zonk_expr(gen, ((ExprBorrow*)expr)->operand);
+    } else if (expr->type == EXPR_MATCH) {
+        ExprMatch* match_expr = (ExprMatch*)expr;
+        zonk_expr(gen, match_expr->scrutinee);
+        for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+            MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+            zonk_pattern(gen, arm->pattern);
+            zonk_expr(gen, arm->body);
+        }
+    }
+}
+
+
+// --- Inference ---
+
+// Instantiates the constructor `tag` of `adt_symbol`: returns the constructed type
+// and, if `field_types` is given, stores the instantiated field types there.
+static Type* instantiate_constructor(TypeInferencer* inferencer, Symbol* adt_symbol, int tag,
+                                     Type** field_types, size_t field_count) {
+    ADTDefinition* def = adt_symbol->data.adt_def;
+    ADTVariantSymbol* variant = def ? (ADTVariantSymbol*)da_get(def->variants, (size_t)tag) : NULL;
+    if (!variant || !adt_symbol->type) return type_error();
+
+    if (da_count(def->type_params) == 0) { // Monomorphic: no copying at all
+        for (size_t i = 0; i < field_count; ++i) {
+            ADTFieldSymbol* field = (ADTFieldSymbol*)da_get(variant->fields, i);
+            field_types[i] = field ? field->type : type_error();
+        }
+        return adt_symbol->type;
+    }
+
+    Instantiation inst;
+    instantiation_begin(&inst, inferencer);
+    Type* result = map_params(adt_symbol->type, adt_symbol, map_to_fresh, &inst);
+    for (size_t i = 0; i < field_count; ++i) {
+        ADTFieldSymbol* field = (ADTFieldSymbol*)da_get(variant->fields, i);
+        field_types[i] = field ? map_params(field->type, adt_symbol, map_to_fresh, &inst) : type_error();
+    }
+    instantiation_end(&inst);
+    return result;
+}
+
+static Type* literal_type(Token literal) {
+    switch (literal.type) {
+        case TOKEN_INTEGER: return type_i32_instance;
+        case TOKEN_STRING: return type_string_instance;
+        case TOKEN_TRUE:
+        case TOKEN_FALSE: return type_bool_instance;
+        default: return type_unknown();
+    }
+}
+
+// Checks `pattern` against `expected` (the scrutinee's type, or a field's),
+// giving every variable it binds that type. Pattern variables are monomorphic.
+static void infer_pattern(TypeInferencer* inferencer, Pattern* pattern, Type* expected) {
+    if (!pattern) return;
+    Type* type = expected;
+    size_t sub_count = da_count(pattern->subpatterns);
+    switch (pattern->kind) {
+        case PATTERN_BINDING:
+            if (pattern->constructor_adt) { // Nullary constructor, e.g. `Nil`
+                type = instantiate_constructor(inferencer, pattern->constructor_adt, pattern->constructor_tag, NULL, 0);
+            } else if (pattern->symbol) {
+                pattern->symbol->type = expected;
+            }
+            break;
+        case PATTERN_LITERAL:
+            type = literal_type(pattern->token);
+            break;
+        case PATTERN_CONSTRUCTOR: {
+            if (!pattern->constructor_adt) {
+                for (size_t i = 0; i < sub_count; ++i) {
+                    infer_pattern(inferencer, (Pattern*)da_get(pattern->subpatterns, i), fresh_var(inferencer));
+                }
+                break;
+            }
+            ADTDefinition* def = pattern->constructor_adt->data.adt_def;
+            ADTVariantSymbol* variant = def ? (ADTVariantSymbol*)da_get(def->variants, (size_t)pattern->constructor_tag) : NULL;
+            size_t field_count = variant ? da_count(variant->fields) : 0;
+            size_t checked = field_count < sub_count ? field_count : sub_count; // Arity is reported by the analyzer
+
+            Type* stack_fields[8];
+            Type** field_types = checked <= 8 ? stack_fields : (Type**)malloc(checked * sizeof(Type*));
+            if (!field_types) break;
+            type = instantiate_constructor(inferencer, pattern->constructor_adt, pattern->constructor_tag,
+                                           field_types, checked);
+            for (size_t i = 0; i < sub_count; ++i) {
+                infer_pattern(inferencer, (Pattern*)da_get(pattern->subpatterns, i),
+                              i < checked ? field_types[i] : fresh_var(inferencer));
+            }
+            if (field_types != stack_fields) free(field_types);
+            break;
+        }
+        case PATTERN_OR:
+            for (size_t i = 0; i < sub_count; ++i) {
+                infer_pattern(inferencer, (Pattern*)da_get(pattern->subpatterns, i), expected);
+            }
+            break;
+        default:
+            break;
+    }
+    pattern->inferred_type = type;
+    if (type != expected && !unify(inferencer, expected, type)) {
+        Generalization show = {inferencer, NULL, 0};
+        type_mismatch_at(inferencer, pattern->token, "Mismatched pattern", zonk(&show, expected), zonk(&show, type));
+        pattern->inferred_type = type_error();
+    }
+}
+
+static Type* infer_expr(TypeInferencer* inferencer, Expr* expr) {
+    if (!expr) return type_error();
+    Type* type = type_error();
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            type = literal_type(((ExprLiteral*)expr)->literal);
+            break;
+        case EXPR_VARIABLE: {
+            ExprVariable* var_expr = (ExprVariable*)expr;
+            if (var_expr->constructor_adt) { // Bare nullary constructor, e.g. `None`
+                type = instantiate_constructor(inferencer, var_expr->constructor_adt, var_expr->constructor_tag, NULL, 0);
+            } else if (var_expr->symbol && var_expr->symbol->kind == SYMBOL_VARIABLE && var_expr->symbol->type) {
+                Symbol* sym = var_expr->symbol;
+                Instantiation inst;
+                instantiation_begin(&inst, inferencer);
+                type = map_params(sym->type, sym, map_to_fresh, &inst); // Shared as-is if monomorphic
+                instantiation_end(&inst);
+            }
+            break;
+        }
+        case EXPR_CALL: {
+            ExprCall* call_expr = (ExprCall*)expr;
+            size_t arg_count = da_count(call_expr->arguments);
+            if (!call_expr->constructor_adt) {
+                for (size_t i = 0; i < arg_count; ++i) infer_expr(inferencer, (Expr*)da_get(call_expr->arguments, i));
+                break;
+            }
+            ADTDefinition* def = call_expr->constructor_adt->data.adt_def;
+            ADTVariantSymbol* variant = def ? (ADTVariantSymbol*)da_get(def->variants, (size_t)call_expr->constructor_tag) : NULL;
+            size_t field_count = variant ? da_count(variant->fields) : 0;
+            size_t checked = field_count < arg_count ? field_count : arg_count; // Arity is reported by the analyzer
+
+            Type* stack_fields[8];
+            Type** field_types = checked <= 8 ? stack_fields : (Type**)malloc(checked * sizeof(Type*));
+            if (!field_types) break;
+            type = instantiate_constructor(inferencer, call_expr->constructor_adt, call_expr->constructor_tag,
+                                           field_types, checked);
+            for (size_t i = 0; i < arg_count; ++i) {
+                Expr* arg = (Expr*)da_get(call_expr->arguments, i);
+                Type* arg_type = infer_expr(inferencer, arg);
+                if (i < checked && !unify(inferencer, field_types[i], arg_type)) {
+                    Generalization show = {inferencer, NULL, 0};
+                    type_mismatch_at(inferencer, expr_token(arg), "Mismatched constructor argument",
+                                     zonk(&show, field_types[i]), zonk(&show, arg_type));
+                    arg->inferred_type = type_error();
+                }
+            }
+            if (field_types != stack_fields) free(field_types);
+            break;
+        }
+        case EXPR_BORROW: {
+            ExprBorrow* borrow_expr = (ExprBorrow*)expr;
+            type = type_intern_reference(infer_expr(inferencer, borrow_expr->operand), borrow_expr->is_mutable);
+            break;
+        }
+        case EXPR_MATCH: {
+            // Every pattern has the scrutinee's type; every arm has the match's type.
+            ExprMatch* match_expr = (ExprMatch*)expr;
+            Type* scrutinee = infer_expr(inferencer, match_expr->scrutinee);
+            type = fresh_var(inferencer);
+            for (size_t i = 0; i < da_count(match_expr->arms); ++i) {
+                MatchArm* arm = (MatchArm*)da_get(match_expr->arms, i);
+                infer_pattern(inferencer, arm->pattern, scrutinee);
+                Type* arm_type = infer_expr(inferencer, arm->body);
+                if (!unify(inferencer, type, arm_type)) {
+                    Generalization show = {inferencer, NULL, 0};
+                    type_mismatch_at(inferencer, expr_token(arm->body), "Mismatched match arm",
+                                     zonk(&show, type), zonk(&show, arm_type));
+                    arm->body->inferred_type = type_error();
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    if (!expr->inferred_type) expr->inferred_type = type;
+    return type;
+}
+
+Type* type_infer_let(TypeInferencer* inferencer, Symbol* let_symbol, Expr* initializer, Type* annotation) {
+    if (!inferencer) return type_unknown();
+
+    // Variables created for this `let` live one level deeper than the binding.
+    inferencer->level++;
+    Type* type = annotation;
+    if (initializer) {
+        Type* init_type = infer_expr(inferencer, initializer);
+        if (!annotation) {
+            type = init_type;
+        } else if (!unify(inferencer, annotation, init_type)) {
+            Generalization show = {inferencer, NULL, 0};
+            Token name = let_symbol ? let_symbol->name_token : expr_token(initializer);
+            type_mismatch_at(inferencer, name, "Initializer does not match the declared type",
+                             annotation, zonk(&show, init_type));
+        }
+    }
+    inferencer->level--;
+    if (!type) type = type_unknown(); // `let x;` with neither annotation nor initializer
+
+    Generalization gen = {inferencer, let_symbol, 0};
+    type = zonk(&gen, type);
+    zonk_expr(&gen, initializer);
+
+    // Every variable is now resolved or generalized; recycle the table.
+    inferencer->var_count = 0;
+    return type;
+}
+
+
+// --- Public API ---
+
+TypeInferencer* type_inferencer_create(void) {
+    TypeInferencer* inferencer = (TypeInferencer*)malloc(sizeof(TypeInferencer));
+    if (!inferencer) return NULL;
+    inferencer->vars = NULL;
+    inferencer->var_count = 0;
+    inferencer->var_capacity = 0;
+    inferencer->level = 0;
+    inferencer->diagnostics = NULL;
+    inferencer->had_error = false;
+    inferencer->error_count = 0;
+    return inferencer;
+}
+
+void type_inferencer_destroy(TypeInferencer* inferencer) {
+    if (!inferencer) return;
+    free(inferencer->vars);
+    free(inferencer);
+}
+
+void type_inferencer_set_diagnostics(TypeInferencer* inferencer, Diagnostics* diagnostics) {
+    if (inferencer) inferencer->diagnostics = diagnostics;
+}
+
+bool type_inferencer_had_error(const TypeInferencer* inferencer) {
+    return inferencer ? inferencer->had_error : false;
+}
+
+size_t type_inferencer_error_count(const TypeInferencer* inferencer) {
+    return inferencer ? inferencer->error_count : 0;
+}
@@ -0,0 +1,51 @@
+#ifndef TYPE_INFER_H
+#define TYPE_INFER_H
+
+#include "ast.h"
+#include "types.h"
+#include "symbol_table.h"
+#include "diagnostics.h"
+#include <stdbool.h>
+
+// Hindley-Milner type inference for `let` initializers, constructor applications
+// and matches (each pattern is checked against the scrutinee's type).
+//
+// Type variables are interned TYPE_VAR types whose bindings live in a union-find
+// table (path compression, union by rank), so unification is near-linear in the
+// size of the program. Each variable carries a let-level; binding a variable
+// lowers the levels of the variables it captures, and generalizing a `let` only
+// has to compare levels instead of scanning the environment.
+//
+// Polymorphic types are stored on symbols as ordinary interned types whose
+// quantified variables are TypeGenericParams owned by the symbol itself: the
+// constructors of `data Option<T>` are polymorphic in Option's `T`, and after
+// `let none = None;` the binding has type Option<'a> with 'a owned by `none`.
+// Every use site instantiates those parameters with fresh variables; types with
+// no parameters of their owner are shared as-is without any copying.
+typedef struct TypeInferencer TypeInferencer;
+
+TypeInferencer* type_inferencer_create(void);
+void type_inferencer_destroy(TypeInferencer* inferencer);
+
+// Infers the type of `let_symbol` from its initializer and optional annotation
+// (either may be NULL), generalizes it and returns the resulting type scheme.
+// Sets Expr.inferred_type on every node of the initializer. Type errors are
+// reported to stderr (or the diagnostics sink, if set); the offending
+// subexpression gets type_error().
+Type* type_infer_let(TypeInferencer* inferencer, Symbol* let_symbol, Expr* initializer, Type* annotation);
+
+// Records type errors in `diagnostics` instead of printing them (NULL: stderr).
+// An inferencer is single-threaded; parallel analysis uses one per thread.
+void type_inferencer_set_diagnostics(TypeInferencer* inferencer, Diagnostics* diagnostics);
+
+// Whether any type error has been reported so far.
+bool type_inferencer_had_error(const TypeInferencer* inferencer);
+
+// Number of type errors reported so far, e.g. to tell whether one `let` had any.
+size_t type_inferencer_error_count(const TypeInferencer* inferencer);
+
+// Replaces the parameters owned by `owner` in `type` with the given types
+// (args[i] for parameter index i). Returns `type` itself when nothing changes.
+Type* type_substitute_params(Type* type, const Symbol* owner, Type* const* args, size_t arg_count);
+
+#endif // TYPE_INFER_H
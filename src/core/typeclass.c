@@ -0,0 +1,666 @@
+#include "typeclass.h"
+#include "type_caps.h"
+#include "symbol_table.h"
+#include "../util/hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct InstanceSlot {
+    uint32_t class_id;
+    const void* head_key;
+    ClassInstance* instance; // NULL = empty slot
+};
+
+struct MemoSlot {
+    uint64_t key;                         // class id << 32 | type id
+    const ClassResolution* resolution;    // NULL = the type is not an instance
+    bool used;
+};
+
+struct BoundSlot {
+    const struct Symbol* owner; // NULL = empty slot
+    int index;
+    const TypeClass** classes;
+    size_t count;
+};
+
+// Head keys of reference types, which have no symbol or interned head of their own.
+static const char ref_head_key = 0;
+static const char ref_mut_head_key = 0;
+
+static bool token_same(Token a, Token b) {
+    return a.length == b.length && memcmp(a.lexeme, b.lexeme, a.length) == 0;
+}
+
+static Token copy_class_name(void) {
+    Token name = {0};
+    name.type = TOKEN_IDENTIFIER;
+    name.lexeme = "Copy";
+    name.length = 4;
+    return name;
+}
+
+
+// --- Lifetime ---
+
+TypeClassEnv* typeclass_env_create(ADTInstanceCache* instances) {
+    TypeClassEnv* env = (TypeClassEnv*)calloc(1, sizeof(TypeClassEnv));
+    if (!env) return NULL;
+    env->instances = instances;
+    env->classes = da_create(8, sizeof(TypeClass*));
+    env->all_instances = da_create(8, sizeof(ClassInstance*));
+    pthread_mutex_init(&env->lock, NULL);
+
+    TypeClassError error;
+    env->copy_class = typeclass_declare(env, copy_class_name(), NULL, NULL, &error);
+    if (!env->classes || !env->all_instances || !env->copy_class) {
+        typeclass_env_destroy(env);
+        return NULL;
+    }
+    ((TypeClass*)env->copy_class)->derived = true;
+    return env;
+}
+
+static void resolution_destroy(const ClassResolution* resolution) {
+    free((void*)resolution->context);
+    free((void*)resolution);
+}
+
+void typeclass_env_destroy(TypeClassEnv* env) {
+    if (!env) return;
+    for (size_t i = 0; i < da_count(env->classes); ++i) {
+        TypeClass* cls = (TypeClass*)da_get(env->classes, i);
+        free(cls->slots);
+        free(cls);
+    }
+    da_destroy(env->classes);
+    for (size_t i = 0; i < da_count(env->all_instances); ++i) {
+        ClassInstance* instance = (ClassInstance*)da_get(env->all_instances, i);
+        free(instance->arg_params);
+        free(instance->constraints);
+        free((void*)instance->dispatch);
+        free(instance);
+    }
+    da_destroy(env->all_instances);
+    for (size_t i = 0; i < env->memo_capacity; ++i) {
+        if (env->memo[i].used && env->memo[i].resolution) resolution_destroy(env->memo[i].resolution);
+    }
+    free(env->memo);
+    for (size_t i = 0; i < env->bounds_capacity; ++i) {
+        free(env->bounds[i].classes);
+    }
+    free(env->bounds);
+    free(env->instance_table);
+    pthread_mutex_destroy(&env->lock);
+    free(env);
+}
+
+
+// --- Classes ---
+
+const TypeClass* typeclass_find(const TypeClassEnv* env, Token name) {
+    if (!env) return NULL;
+    for (size_t i = 0; i < da_count(env->classes); ++i) {
+        TypeClass* cls = (TypeClass*)da_get(env->classes, i);
+        if (token_same(cls->name, name)) return cls;
+    }
+    return NULL;
+}
+
+const TypeClass* typeclass_declare(TypeClassEnv* env, Token name, const TypeClass* superclass,
+                                   DynamicArray* methods, TypeClassError* error) {
+    *error = TYPECLASS_OK;
+    if (typeclass_find(env, name)) {
+        *error = TYPECLASS_DUPLICATE_CLASS;
+        return NULL;
+    }
+    size_t inherited = superclass ? superclass->slot_count : 0;
+    size_t slot_count = inherited + da_count(methods);
+    TypeClass* cls = (TypeClass*)calloc(1, sizeof(TypeClass));
+    Token* slots = (Token*)malloc((slot_count ? slot_count : 1) * sizeof(Token));
+    if (!cls || !slots) {
+        free(cls);
+        free(slots);
+        *error = TYPECLASS_NO_MEMORY;
+        return NULL;
+    }
+    if (inherited) memcpy(slots, superclass->slots, inherited * sizeof(Token));
+    for (size_t i = 0; i < da_count(methods); ++i) {
+        Token method = *(Token*)da_get(methods, i);
+        for (size_t j = 0; j < inherited + i; ++j) {
+            if (token_same(slots[j], method)) {
+                free(cls);
+                free(slots);
+                *error = TYPECLASS_DUPLICATE_METHOD;
+                return NULL;
+            }
+        }
+        slots[inherited + i] = method;
+    }
+    cls->name = name;
+    cls->id = (uint32_t)da_count(env->classes);
+    cls->superclass = superclass;
+    cls->slots = slots;
+    cls->slot_count = slot_count;
+    cls->own_slot_start = inherited;
+    da_push(env->classes, cls);
+    return cls;
+}
+
+int typeclass_method_slot(const TypeClass* cls, Token method) {
+    for (size_t i = 0; cls && i < cls->slot_count; ++i) {
+        if (token_same(cls->slots[i], method)) return (int)i;
+    }
+    return -1;
+}
+
+bool typeclass_implies(const TypeClass* sub, const TypeClass* super) {
+    for (const TypeClass* cls = sub; cls; cls = cls->superclass) {
+        if (cls == super) return true;
+    }
+    return false;
+}
+
+
+// --- Instance table: (class id, head key) -> instance ---
+
+static uint32_t instance_hash(uint32_t class_id, const void* head_key) {
+    return hash_combine(hash_combine(0, class_id), (uint64_t)(uintptr_t)head_key);
+}
+
+// Caller holds env->lock.
+static ClassInstance* instance_lookup_locked(TypeClassEnv* env, uint32_t class_id, const void* head_key) {
+    if (env->instance_capacity == 0) return NULL;
+    size_t mask = env->instance_capacity - 1;
+    for (size_t i = instance_hash(class_id, head_key) & mask;; i = (i + 1) & mask) {
+        struct InstanceSlot* slot = &env->instance_table[i];
+        if (!slot->instance) return NULL;
+        if (slot->class_id == class_id && slot->head_key == head_key) return slot->instance;
+    }
+}
+
+// Caller holds env->lock.
+static bool instance_insert_locked(TypeClassEnv* env, ClassInstance* instance) {
+    size_t count = da_count(env->all_instances);
+    if ((count + 1) * 2 > env->instance_capacity) {
+        size_t new_capacity = env->instance_capacity ? env->instance_capacity * 2 : 32;
+        struct InstanceSlot* table = (struct InstanceSlot*)calloc(new_capacity, sizeof(struct InstanceSlot));
+        if (!table) return false;
+        for (size_t i = 0; i < env->instance_capacity; ++i) {
+            struct InstanceSlot old = env->instance_table[i];
+            if (!old.instance) continue;
+            size_t j = instance_hash(old.class_id, old.head_key) & (new_capacity - 1);
+            while (table[j].instance) j = (j + 1) & (new_capacity - 1);
+            table[j] = old;
+        }
+        free(env->instance_table);
+        env->instance_table = table;
+        env->instance_capacity = new_capacity;
+    }
+    size_t mask = env->instance_capacity - 1;
+    size_t i = instance_hash(instance->cls->id, instance->head_key) & mask;
+    while (env->instance_table[i].instance) i = (i + 1) & mask;
+    env->instance_table[i].class_id = instance->cls->id;
+    env->instance_table[i].head_key = instance->head_key;
+    env->instance_table[i].instance = instance;
+    return da_push(env->all_instances, instance) == 0;
+}
+
+// A new instance can make earlier failed resolutions succeed; successes stay
+// valid because instances are never removed and never overlap. Caller holds env->lock.
+static void memo_forget_failures_locked(TypeClassEnv* env) {
+    size_t failures = 0;
+    for (size_t i = 0; i < env->memo_capacity; ++i) {
+        if (env->memo[i].used && !env->memo[i].resolution) failures++;
+    }
+    if (failures == 0) return;
+    struct MemoSlot* table = (struct MemoSlot*)calloc(env->memo_capacity, sizeof(struct MemoSlot));
+    if (!table) return;
+    size_t mask = env->memo_capacity - 1;
+    for (size_t i = 0; i < env->memo_capacity; ++i) {
+        struct MemoSlot old = env->memo[i];
+        if (!old.used || !old.resolution) continue;
+        size_t j = hash_combine(0, old.key) & mask;
+        while (table[j].used) j = (j + 1) & mask;
+        table[j] = old;
+    }
+    free(env->memo);
+    env->memo = table;
+    env->memo_count -= failures;
+}
+
+static const void* head_key_of_kind(InstanceHeadKind kind, const void* head) {
+    switch (kind) {
+        case INSTANCE_HEAD_REF: return &ref_head_key;
+        case INSTANCE_HEAD_REF_MUT: return &ref_mut_head_key;
+        default: return head;
+    }
+}
+
+const ClassInstance* typeclass_declare_instance(TypeClassEnv* env, const TypeClass* cls, Token location,
+                                                InstanceHeadKind kind, const void* head,
+                                                const int* arg_params, size_t arg_count, size_t param_count,
+                                                const ClassConstraint* constraints, size_t constraint_count,
+                                                TypeClassError* error, const ClassInstance** existing) {
+    *error = TYPECLASS_OK;
+    *existing = NULL;
+    if (cls->derived) {
+        *error = TYPECLASS_DERIVED_CLASS;
+        return NULL;
+    }
+    const void* head_key = head_key_of_kind(kind, head);
+
+    pthread_mutex_lock(&env->lock);
+    ClassInstance* previous = instance_lookup_locked(env, cls->id, head_key);
+    ClassInstance* super_instance = NULL;
+    if (cls->superclass && !cls->superclass->derived) {
+        super_instance = instance_lookup_locked(env, cls->superclass->id, head_key);
+    }
+    pthread_mutex_unlock(&env->lock);
+    if (previous) {
+        *error = TYPECLASS_OVERLAP;
+        *existing = previous;
+        return NULL;
+    }
+    if (cls->superclass && !cls->superclass->derived && !super_instance) {
+        *error = TYPECLASS_MISSING_SUPERCLASS;
+        return NULL;
+    }
+
+    ClassInstance* instance = (ClassInstance*)calloc(1, sizeof(ClassInstance));
+    if (!instance) {
+        *error = TYPECLASS_NO_MEMORY;
+        return NULL;
+    }
+    instance->cls = cls;
+    instance->location = location;
+    instance->head_key = head_key;
+    instance->arg_count = arg_count;
+    instance->param_count = param_count;
+    instance->constraint_count = constraint_count;
+    instance->arg_params = (int*)malloc((arg_count ? arg_count : 1) * sizeof(int));
+    instance->constraints = (ClassConstraint*)malloc((constraint_count ? constraint_count : 1) * sizeof(ClassConstraint));
+    const ClassInstance** dispatch = (const ClassInstance**)malloc((cls->slot_count ? cls->slot_count : 1) * sizeof(ClassInstance*));
+    instance->dispatch = dispatch;
+    if (!instance->arg_params || !instance->constraints || !dispatch) {
+        free(instance->arg_params);
+        free(instance->constraints);
+        free(dispatch);
+        free(instance);
+        *error = TYPECLASS_NO_MEMORY;
+        return NULL;
+    }
+    if (arg_count) memcpy(instance->arg_params, arg_params, arg_count * sizeof(int));
+    if (constraint_count) memcpy(instance->constraints, constraints, constraint_count * sizeof(ClassConstraint));
+
+    // Inherited slots are served by whoever serves them for the superclass instance
+    // (already flattened), so a lookup never walks the class hierarchy.
+    for (size_t slot = 0; slot < cls->slot_count; ++slot) {
+        dispatch[slot] = slot < cls->own_slot_start ? super_instance->dispatch[slot] : instance;
+    }
+
+    pthread_mutex_lock(&env->lock);
+    bool inserted = instance_insert_locked(env, instance);
+    if (inserted) memo_forget_failures_locked(env);
+    pthread_mutex_unlock(&env->lock);
+    if (!inserted) {
+        free(instance->arg_params);
+        free(instance->constraints);
+        free(dispatch);
+        free(instance);
+        *error = TYPECLASS_NO_MEMORY;
+        return NULL;
+    }
+    return instance;
+}
+
+
+// --- Parameter bounds: (owner, index) -> classes ---
+
+static uint32_t bound_hash(const struct Symbol* owner, int index) {
+    return hash_combine(hash_combine(0, (uint64_t)(uintptr_t)owner), (uint64_t)index);
+}
+
+void typeclass_set_param_bounds(TypeClassEnv* env, const struct Symbol* owner, int index,
+                                const TypeClass* const* classes, size_t count) {
+    if (!env || !owner || count == 0) return;
+    const TypeClass** copy = (const TypeClass**)malloc(count * sizeof(TypeClass*));
+    if (!copy) return;
+    memcpy(copy, classes, count * sizeof(TypeClass*));
+
+    pthread_mutex_lock(&env->lock);
+    if ((env->bounds_count + 1) * 2 > env->bounds_capacity) {
+        size_t new_capacity = env->bounds_capacity ? env->bounds_capacity * 2 : 32;
+        struct BoundSlot* table = (struct BoundSlot*)calloc(new_capacity, sizeof(struct BoundSlot));
+        if (!table) {
+            pthread_mutex_unlock(&env->lock);
+            free(copy);
+            return;
+        }
+        for (size_t i = 0; i < env->bounds_capacity; ++i) {
+            struct BoundSlot old = env->bounds[i];
+            if (!old.owner) continue;
+            size_t j = bound_hash(old.owner, old.index) & (new_capacity - 1);
+            while (table[j].owner) j = (j + 1) & (new_capacity - 1);
+            table[j] = old;
+        }
+        free(env->bounds);
+        env->bounds = table;
+        env->bounds_capacity = new_capacity;
+    }
+    size_t mask = env->bounds_capacity - 1;
+    size_t i = bound_hash(owner, index) & mask;
+    while (env->bounds[i].owner && !(env->bounds[i].owner == owner && env->bounds[i].index == index)) {
+        i = (i + 1) & mask;
+    }
+    if (env->bounds[i].owner) {
+        free(env->bounds[i].classes); // Redeclared: the latest bounds win
+    } else {
+        env->bounds_count++;
+    }
+    env->bounds[i].owner = owner;
+    env->bounds[i].index = index;
+    env->bounds[i].classes = copy;
+    env->bounds[i].count = count;
+    pthread_mutex_unlock(&env->lock);
+}
+
+const TypeClass* const* typeclass_param_bounds(TypeClassEnv* env, const struct Symbol* owner, int index,
+                                               size_t* count) {
+    *count = 0;
+    if (!env) return NULL;
+    const TypeClass* const* classes = NULL;
+    pthread_mutex_lock(&env->lock);
+    if (env->bounds_capacity) {
+        size_t mask = env->bounds_capacity - 1;
+        for (size_t i = bound_hash(owner, index) & mask; env->bounds[i].owner; i = (i + 1) & mask) {
+            if (env->bounds[i].owner == owner && env->bounds[i].index == index) {
+                classes = env->bounds[i].classes;
+                *count = env->bounds[i].count;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&env->lock);
+    return classes;
+}
+
+
+// --- Resolution ---
+
+static uint64_t memo_key(const TypeClass* cls, const Type* type) {
+    return ((uint64_t)cls->id << 32) | type->id;
+}
+
+static bool memo_lookup(TypeClassEnv* env, uint64_t key, const ClassResolution** out) {
+    bool found = false;
+    pthread_mutex_lock(&env->lock);
+    if (env->memo_capacity) {
+        size_t mask = env->memo_capacity - 1;
+        for (size_t i = hash_combine(0, key) & mask; env->memo[i].used; i = (i + 1) & mask) {
+            if (env->memo[i].key == key) {
+                *out = env->memo[i].resolution;
+                found = true;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&env->lock);
+    return found;
+}
+
+// Records a result. If another thread got there first, its result is kept and
+// returned, and `resolution` is freed.
+static const ClassResolution* memo_insert(TypeClassEnv* env, uint64_t key, const ClassResolution* resolution) {
+    pthread_mutex_lock(&env->lock);
+    if ((env->memo_count + 1) * 2 > env->memo_capacity) {
+        size_t new_capacity = env->memo_capacity ? env->memo_capacity * 2 : 64;
+        struct MemoSlot* table = (struct MemoSlot*)calloc(new_capacity, sizeof(struct MemoSlot));
+        if (!table) {
+            pthread_mutex_unlock(&env->lock);
+            return resolution; // Still correct, just not memoized (and leaked until exit)
+        }
+        for (size_t i = 0; i < env->memo_capacity; ++i) {
+            struct MemoSlot old = env->memo[i];
+            if (!old.used) continue;
+            size_t j = hash_combine(0, old.key) & (new_capacity - 1);
+            while (table[j].used) j = (j + 1) & (new_capacity - 1);
+            table[j] = old;
+        }
+        free(env->memo);
+        env->memo = table;
+        env->memo_capacity = new_capacity;
+    }
+    size_t mask = env->memo_capacity - 1;
+    size_t i = hash_combine(0, key) & mask;
+    for (; env->memo[i].used; i = (i + 1) & mask) {
+        if (env->memo[i].key == key) {
+            const ClassResolution* winner = env->memo[i].resolution;
+            pthread_mutex_unlock(&env->lock);
+            if (resolution) resolution_destroy(resolution);
+            return winner;
+        }
+    }
+    env->memo[i].used = true;
+    env->memo[i].key = key;
+    env->memo[i].resolution = resolution;
+    env->memo_count++;
+    pthread_mutex_unlock(&env->lock);
+    return resolution;
+}
+
+// Whether a type that may mention generic parameters is Copy: concrete types
+// by their capabilities, parameters by their bounds, and ADTs over parameters
+// when all their fields are. `visiting` holds the ADT types being checked; a
+// type that contains itself by value is boxed, so it is not Copy.
+static bool derived_copy(TypeClassEnv* env, Type* type, DynamicArray* visiting) {
+    if (!(type->flags & TYPE_HAS_PARAMS)) {
+        return (type_capabilities(env->instances, type) & TYPE_CAP_COPY) != 0;
+    }
+    switch (type->kind) {
+        case TYPE_GENERIC_PARAM: {
+            TypeGenericParam* param = (TypeGenericParam*)type;
+            size_t count = 0;
+            const TypeClass* const* bounds = typeclass_param_bounds(env, param->owner, param->index, &count);
+            for (size_t i = 0; i < count; ++i) {
+                if (typeclass_implies(bounds[i], env->copy_class)) return true;
+            }
+            return false;
+        }
+        case TYPE_REFERENCE:
+            return !((TypeReference*)type)->is_mutable;
+        case TYPE_ADT: {
+            for (size_t i = 0; i < da_count(visiting); ++i) {
+                if (da_get(visiting, i) == type) return false;
+            }
+            const ADTInstance* instance = adt_instance_get(env->instances, type);
+            if (!instance) return false;
+            da_push(visiting, type);
+            bool copy = true;
+            for (size_t v = 0; copy && v < instance->variant_count; ++v) {
+                for (size_t f = 0; copy && f < instance->variants[v].field_count; ++f) {
+                    copy = derived_copy(env, instance->variants[v].field_types[f], visiting);
+                }
+            }
+            da_pop(visiting);
+            return copy;
+        }
+        default:
+            return false;
+    }
+}
+
+// Head key and argument list of a type, as instance heads are keyed.
+static const void* head_key_of_type(Type* type, Type* const** args, size_t* arg_count) {
+    *args = NULL;
+    *arg_count = 0;
+    switch (type->kind) {
+        case TYPE_PRIMITIVE:
+            return type;
+        case TYPE_ADT: {
+            TypeADT* adt = (TypeADT*)type;
+            *args = adt->type_args;
+            *arg_count = adt->type_arg_count;
+            return adt->adt_symbol;
+        }
+        case TYPE_REFERENCE: {
+            TypeReference* ref = (TypeReference*)type;
+            *args = &ref->referent;
+            *arg_count = 1;
+            return ref->is_mutable ? &ref_mut_head_key : &ref_head_key;
+        }
+        default:
+            return NULL;
+    }
+}
+
+static const ClassResolution* resolve_uncached(TypeClassEnv* env, const TypeClass* cls, Type* type) {
+    const ClassResolution* superclass = NULL;
+    if (cls->superclass) {
+        superclass = typeclass_resolve(env, cls->superclass, type);
+        if (!superclass) return NULL;
+    }
+
+    const ClassInstance* instance = NULL;
+    const ClassResolution** context = NULL;
+    if (type->kind == TYPE_GENERIC_PARAM) {
+        // Satisfied by a bound on the parameter itself, e.g. `T: Ord` gives both Ord and Eq.
+        TypeGenericParam* param = (TypeGenericParam*)type;
+        size_t count = 0;
+        const TypeClass* const* bounds = typeclass_param_bounds(env, param->owner, param->index, &count);
+        bool bounded = false;
+        for (size_t i = 0; i < count && !bounded; ++i) {
+            bounded = typeclass_implies(bounds[i], cls);
+        }
+        if (!bounded) return NULL;
+    } else if (cls->derived) {
+        DynamicArray* visiting = da_create(4, sizeof(Type*));
+        bool copy = visiting && derived_copy(env, type, visiting);
+        da_destroy(visiting);
+        if (!copy) return NULL;
+    } else {
+        Type* const* args = NULL;
+        size_t arg_count = 0;
+        const void* head_key = head_key_of_type(type, &args, &arg_count);
+        if (!head_key) return NULL;
+        pthread_mutex_lock(&env->lock);
+        instance = instance_lookup_locked(env, cls->id, head_key);
+        pthread_mutex_unlock(&env->lock);
+        if (!instance || instance->arg_count != arg_count) return NULL;
+
+        // The head's arguments are distinct parameters, so matching is just binding.
+        Type* stack_bindings[8];
+        Type** bindings = instance->param_count <= 8 ? stack_bindings
+                        : (Type**)calloc(instance->param_count, sizeof(Type*));
+        if (!bindings) return NULL;
+        for (size_t i = 0; i < arg_count; ++i) bindings[instance->arg_params[i]] = args[i];
+
+        if (instance->constraint_count) {
+            context = (const ClassResolution**)malloc(instance->constraint_count * sizeof(ClassResolution*));
+        }
+        bool satisfied = instance->constraint_count == 0 || context;
+        // Each constraint is on a strict subterm of `type`, so this recursion terminates.
+        for (size_t i = 0; satisfied && i < instance->constraint_count; ++i) {
+            const ClassConstraint* constraint = &instance->constraints[i];
+            context[i] = typeclass_resolve(env, constraint->cls, bindings[constraint->param]);
+            satisfied = context[i] != NULL;
+        }
+        if (bindings != stack_bindings) free(bindings);
+        if (!satisfied) {
+            free((void*)context);
+            return NULL;
+        }
+    }
+
+    ClassResolution* resolution = (ClassResolution*)malloc(sizeof(ClassResolution));
+    if (!resolution) {
+        free((void*)context);
+        return NULL;
+    }
+    resolution->cls = cls;
+    resolution->type = type;
+    resolution->instance = instance;
+    resolution->context = context;
+    resolution->superclass = superclass;
+    return resolution;
+}
+
+const ClassResolution* typeclass_resolve(TypeClassEnv* env, const TypeClass* cls, Type* type) {
+    if (!env || !cls || !type) return NULL;
+    // Inference variables and error types have no instances yet; don't memoize them.
+    if ((type->flags & TYPE_HAS_VARS) || type->kind == TYPE_ERROR || type->kind == TYPE_UNKNOWN) return NULL;
+
+    uint64_t key = memo_key(cls, type);
+    const ClassResolution* resolution = NULL;
+    if (memo_lookup(env, key, &resolution)) return resolution;
+    return memo_insert(env, key, resolve_uncached(env, cls, type));
+}
+
+void typeclass_forget_resolutions(TypeClassEnv* env) {
+    if (!env) return;
+    pthread_mutex_lock(&env->lock);
+    for (size_t i = 0; i < env->memo_capacity; ++i) {
+        if (env->memo[i].used && env->memo[i].resolution) resolution_destroy(env->memo[i].resolution);
+        env->memo[i] = (struct MemoSlot){0};
+    }
+    env->memo_count = 0;
+    pthread_mutex_unlock(&env->lock);
+}
+
+
+// --- Debug output ---
+
+static void print_head(FILE* stream, const ClassInstance* instance) {
+    fprintf(stream, "%.*s", (int)instance->location.length, instance->location.lexeme);
+    if (instance->arg_count == 0) return;
+    if (instance->head_key == &ref_head_key || instance->head_key == &ref_mut_head_key) {
+        fprintf(stream, "%s#%d", instance->head_key == &ref_mut_head_key ? "mut " : "", instance->arg_params[0]);
+        return;
+    }
+    fprintf(stream, "<");
+    for (size_t i = 0; i < instance->arg_count; ++i) {
+        fprintf(stream, "%s#%d", i ? ", " : "", instance->arg_params[i]);
+    }
+    fprintf(stream, ">");
+}
+
+void typeclass_print(TypeClassEnv* env, FILE* stream) {
+    if (!env) return;
+    for (size_t i = 0; i < da_count(env->classes); ++i) {
+        const TypeClass* cls = (const TypeClass*)da_get(env->classes, i);
+        fprintf(stream, "class %.*s", (int)cls->name.length, cls->name.lexeme);
+        if (cls->superclass) fprintf(stream, ": %.*s", (int)cls->superclass->name.length, cls->superclass->name.lexeme);
+        fprintf(stream, "%s {", cls->derived ? " (derived)" : "");
+        for (size_t s = 0; s < cls->slot_count; ++s) {
+            fprintf(stream, "%s%zu:%.*s", s ? ", " : " ", s, (int)cls->slots[s].length, cls->slots[s].lexeme);
+        }
+        fprintf(stream, " }\n");
+    }
+    for (size_t i = 0; i < da_count(env->all_instances); ++i) {
+        const ClassInstance* instance = (const ClassInstance*)da_get(env->all_instances, i);
+        const TypeClass* cls = instance->cls;
+        fprintf(stream, "instance %.*s for ", (int)cls->name.length, cls->name.lexeme);
+        print_head(stream, instance);
+        for (size_t c = 0; c < instance->constraint_count; ++c) {
+            const TypeClass* bound = instance->constraints[c].cls;
+            fprintf(stream, "%s#%d: %.*s", c ? ", " : " where ", instance->constraints[c].param,
+                    (int)bound->name.length, bound->name.lexeme);
+        }
+        fprintf(stream, "\n");
+        for (size_t s = 0; s < cls->slot_count; ++s) {
+            const ClassInstance* provider = instance->dispatch[s];
+            fprintf(stream, "  %zu:%.*s -> %.*s for ", s, (int)cls->slots[s].length, cls->slots[s].lexeme,
+                    (int)provider->cls->name.length, provider->cls->name.lexeme);
+            print_head(stream, provider);
+            fprintf(stream, "\n");
+        }
+    }
+    pthread_mutex_lock(&env->lock);
+    size_t resolved = 0;
+    for (size_t i = 0; i < env->memo_capacity; ++i) {
+        if (env->memo[i].used && env->memo[i].resolution) resolved++;
+    }
+    size_t total = env->memo_count;
+    pthread_mutex_unlock(&env->lock);
+    fprintf(stream, "%zu memoized resolution(s), %zu failed\n", resolved, total - resolved);
+}
@@ -0,0 +1,156 @@
+#ifndef TYPECLASS_H
+#define TYPECLASS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>  // For FILE*
+#include <pthread.h>
+#include "types.h"
+#include "adt_instance.h"
+
+struct Symbol;
+
+// Typeclasses, instances and instance resolution.
+//
+// A class has a name, an optional superclass and a list of method names. Its
+// methods are numbered into dispatch slots: the superclass's slots first, then
+// its own, so a slot number means the same method in a class and every subclass.
+//
+// An instance is declared for a type constructor applied to distinct parameters
+// (`instance<T: Eq> Eq for List<T>;`), so at most one instance can match a type:
+// coherence reduces to one instance per (class, type constructor), which is
+// checked when the instance is declared. Each instance gets a dispatch table
+// listing, for every slot of its class, the instance that provides the method;
+// superclass slots point at the superclass instance for the same constructor.
+//
+// `Copy` is built in. Its instances are derived from type capabilities
+// (type_caps.h) and cannot be declared.
+//
+// Resolving (class, type) finds the matching instance and resolves its
+// constraints on the type's arguments. Results, failures included, are memoized
+// per (class, interned type) pair, so each use site after the first is a single
+// hash lookup and the total work is bounded by the number of distinct pairs.
+
+typedef struct TypeClass {
+    Token name;
+    uint32_t id;                       // Dense, in declaration order
+    const struct TypeClass* superclass; // NULL if none
+    Token* slots;                      // Method names in slot order (superclass slots first)
+    size_t slot_count;
+    size_t own_slot_start;             // First slot declared by this class
+    bool derived;                      // Instances come from type capabilities (Copy)
+} TypeClass;
+
+// `param` must satisfy `cls` for the instance to apply.
+typedef struct {
+    const TypeClass* cls;
+    int param;
+} ClassConstraint;
+
+typedef struct ClassInstance {
+    const TypeClass* cls;
+    Token location;                    // Head type name, for diagnostics
+    const void* head_key;              // ADT symbol, primitive Type*, or a reference marker
+    int* arg_params;                   // Instance parameter bound at each head argument position
+    size_t arg_count;
+    size_t param_count;
+    ClassConstraint* constraints;
+    size_t constraint_count;
+    const struct ClassInstance** dispatch; // Provider of each of cls's slots (slot_count entries)
+} ClassInstance;
+
+// Evidence that a type is an instance of a class.
+typedef struct ClassResolution {
+    const TypeClass* cls;
+    Type* type;
+    const ClassInstance* instance;            // NULL for derived classes and bounded parameters
+    const struct ClassResolution** context;   // Evidence for each of instance->constraints
+    const struct ClassResolution* superclass; // Evidence for (cls->superclass, type), or NULL
+} ClassResolution;
+
+typedef struct {
+    ADTInstanceCache* instances; // Not owned; field types for derived classes
+    DynamicArray* classes;       // TypeClass*, indexed by id
+    DynamicArray* all_instances; // ClassInstance*, in declaration order
+    // Open-addressed tables: (class id, head key) -> instance, (class id, type id) -> resolution,
+    // (parameter owner, index) -> bound classes.
+    struct InstanceSlot* instance_table;
+    size_t instance_capacity;
+    struct MemoSlot* memo;
+    size_t memo_capacity;
+    size_t memo_count;
+    struct BoundSlot* bounds;
+    size_t bounds_capacity;
+    size_t bounds_count;
+    const TypeClass* copy_class;
+    pthread_mutex_t lock;        // Guards the tables; never held while resolving
+} TypeClassEnv;
+
+typedef enum {
+    TYPECLASS_OK,
+    TYPECLASS_DUPLICATE_CLASS,     // A class with this name exists
+    TYPECLASS_DUPLICATE_METHOD,    // A method name repeats (own or inherited)
+    TYPECLASS_DERIVED_CLASS,       // Instances of this class cannot be declared
+    TYPECLASS_OVERLAP,             // The class already has an instance for this type constructor
+    TYPECLASS_MISSING_SUPERCLASS,  // The superclass has no instance for this type constructor
+    TYPECLASS_NO_MEMORY,
+} TypeClassError;
+
+TypeClassEnv* typeclass_env_create(ADTInstanceCache* instances);
+void typeclass_env_destroy(TypeClassEnv* env);
+
+// Looks a class up by name; NULL if it is not declared.
+const TypeClass* typeclass_find(const TypeClassEnv* env, Token name);
+
+// Declares a class with the given method names (Token*). Returns NULL and sets
+// *error if the name is taken or a method name repeats, including inherited ones.
+const TypeClass* typeclass_declare(TypeClassEnv* env, Token name, const TypeClass* superclass,
+                                   DynamicArray* methods, TypeClassError* error);
+
+// Head of an instance declaration, as written.
+typedef enum {
+    INSTANCE_HEAD_PRIMITIVE, // i32, String, bool
+    INSTANCE_HEAD_ADT,       // List<T>
+    INSTANCE_HEAD_REF,       // &T
+    INSTANCE_HEAD_REF_MUT,   // &mut T
+} InstanceHeadKind;
+
+// Declares an instance of `cls`. `head` is the primitive Type* or the ADT symbol
+// (NULL for references); arg_params[i] is the instance parameter written at
+// argument position i. Returns NULL and sets *error on an overlapping instance
+// (*existing is then the earlier one), a missing superclass instance or a
+// derived class.
+const ClassInstance* typeclass_declare_instance(TypeClassEnv* env, const TypeClass* cls, Token location,
+                                                InstanceHeadKind kind, const void* head,
+                                                const int* arg_params, size_t arg_count, size_t param_count,
+                                                const ClassConstraint* constraints, size_t constraint_count,
+                                                TypeClassError* error, const ClassInstance** existing);
+
+// Records the classes a generic parameter is bounded by (`T: Ord` in `data Set<T: Ord>`).
+void typeclass_set_param_bounds(TypeClassEnv* env, const struct Symbol* owner, int index,
+                                const TypeClass* const* classes, size_t count);
+
+// Bound classes of a parameter (count 0 if unbounded).
+const TypeClass* const* typeclass_param_bounds(TypeClassEnv* env, const struct Symbol* owner, int index,
+                                               size_t* count);
+
+// Resolves `type` as an instance of `cls`; NULL if it is not one. Generic
+// parameters are instances of their bound classes and those classes'
+// superclasses. Memoized; thread-safe.
+const ClassResolution* typeclass_resolve(TypeClassEnv* env, const TypeClass* cls, Type* type);
+
+// Forgets every memoized resolution, freeing those returned earlier. Derived
+// instances follow ADT bodies, which incremental analysis can change.
+void typeclass_forget_resolutions(TypeClassEnv* env);
+
+// Dispatch slot of a method of `cls` (or one of its superclasses), or -1.
+int typeclass_method_slot(const TypeClass* cls, Token method);
+
+// Whether `sub` is `super` or inherits from it.
+bool typeclass_implies(const TypeClass* sub, const TypeClass* super);
+
+// Prints the classes, the instances with their dispatch tables, and the number
+// of memoized resolutions (for -print-classes).
+void typeclass_print(TypeClassEnv* env, FILE* stream);
+
+#endif // TYPECLASS_H
@@ -4,137 +4,317 @@
 #include "../util/string_builder.h" // For type_to_string
 #include <stdlib.h>
 #include <stdio.h> // For snprintf in type_to_string
-#include <string.h> // For strcmp in types_are_equal, and strdup
+#include <string.h> // For memcmp, memcpy and strdup
+#include <pthread.h> // The interner is shared by analysis workers
+#include "../util/hash.h" // For interner keys
 
-// --- Type Creation Functions ---
+// --- Type Arena and Interner ---
+// Types live in bump-allocated blocks and are found again through an
+// open-addressing table keyed by their structure. Components are interned
+// first, so a structural key only needs their IDs: hashing and comparing a
+// type is O(number of direct components), never a deep walk.
 
-Type* type_primitive_create(Token name) {
-    TypePrimitive* type = (TypePrimitive*)malloc(sizeof(TypePrimitive));
-    if (!type) return NULL;
-    type->base.kind = TYPE_PRIMITIVE;
-    type->name = name; // Token struct copied
-    return (Type*)type;
-}
+#define TYPE_ARENA_BLOCK_SIZE 16384
+#define TYPE_TABLE_INITIAL_CAPACITY 256
 
-Type* type_adt_create(Token name, DynamicArray* type_args, struct Symbol* adt_symbol) {
-    TypeADT* type = (TypeADT*)malloc(sizeof(TypeADT));
-    if (!type) return NULL;
-    type->base.kind = TYPE_ADT;
-    type->name = name; // Token struct copied
-    type->type_args = type_args; // Ownership of DA and its Type* elements assumed
-    type->adt_symbol = adt_symbol;
-    return (Type*)type;
-}
+typedef struct TypeArenaBlock {
+    struct TypeArenaBlock* next;
+    size_t used;
+    size_t size;
+    max_align_t data[]; // Payload, suitably aligned for any type node
+} TypeArenaBlock;
 
-Type* type_generic_param_create(Token name) {
-    TypeGenericParam* type = (TypeGenericParam*)malloc(sizeof(TypeGenericParam));
-    if (!type) return NULL;
-    type->base.kind = TYPE_GENERIC_PARAM;
-    type->name = name; // Token struct copied
-    return (Type*)type;
-}
+// Everything that identifies a type. Unused fields stay zero.
+typedef struct {
+    TypeKind kind;
+    const char* name;        // TYPE_PRIMITIVE; TYPE_GENERIC_PARAM (its display name, not part of the identity)
+    size_t name_length;
+    struct Symbol* symbol;   // TYPE_ADT (the ADT), TYPE_GENERIC_PARAM (the owner)
+    const void* owner;       // TYPE_VAR
+    int index;               // TYPE_GENERIC_PARAM, TYPE_VAR
+    Type* const* args;       // TYPE_ADT arguments; TYPE_REFERENCE referent is args[0]
+    size_t arg_count;
+    bool is_mutable;         // TYPE_REFERENCE
+} TypeKey;
 
-Type* type_void_create() {
-    TypeVoid* type = (TypeVoid*)malloc(sizeof(TypeVoid));
-    if (!type) return NULL;
-    type->base.kind = TYPE_VOID;
-    return (Type*)type;
-}
+typedef struct {
+    TypeArenaBlock* blocks;
+    Type** table;           // Open addressing, NULL = empty
+    uint32_t* table_hashes; // Cached key hash per slot
+    size_t capacity;
+    DynamicArray* by_id;    // Type*, indexed by Type.id
+    pthread_mutex_t lock;
+    int users;              // Nesting depth of types_init_predefined
+    Type* void_type;
+    Type* error_type;
+    Type* unknown_type;
+} TypeInterner;
 
-Type* type_error_create() {
-    TypeError* type = (TypeError*)malloc(sizeof(TypeError));
-    if (!type) return NULL;
-    type->base.kind = TYPE_ERROR;
-    return (Type*)type;
-}
+static TypeInterner interner = { .lock = PTHREAD_MUTEX_INITIALIZER };
 
-Type* type_unknown_create() {
-    Type* type = (Type*)malloc(sizeof(Type)); // Base Type struct is enough
-    if (!type) return NULL;
-    type->kind = TYPE_UNKNOWN; // Corrected: directly access kind
-    return type;
+static void* arena_alloc(size_t size) {
+    size = (size + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1);
+    TypeArenaBlock* block = interner.blocks;
+    if (!block || block->size - block->used < size) {
+        size_t block_size = size > TYPE_ARENA_BLOCK_SIZE ? size : TYPE_ARENA_BLOCK_SIZE;
+        block = (TypeArenaBlock*)malloc(sizeof(TypeArenaBlock) + block_size);
+        if (!block) return NULL;
+        block->next = interner.blocks;
+        block->used = 0;
+        block->size = block_size;
+        interner.blocks = block;
+    }
+    void* p = (char*)block->data + block->used;
+    block->used += size;
+    return p;
 }
 
-// --- Type Destruction ---
-
-void type_destroy(Type* type) {
-    if (!type) return;
-
-    switch (type->kind) {
+static uint32_t key_hash(const TypeKey* key) {
+    uint32_t h = hash_combine(2166136261u, (uint64_t)key->kind);
+    switch (key->kind) {
         case TYPE_PRIMITIVE:
-            // TypePrimitive* prim = (TypePrimitive*)type;
-            // Token name is a struct, its lexeme points to source, no specific free needed for name.
-            break;
-        case TYPE_ADT: {
-            TypeADT* adt_type = (TypeADT*)type;
-            // adt_symbol is not owned by TypeADT, it's a pointer to symbol table entry.
-            if (adt_type->type_args) {
-                for (size_t i = 0; i < da_count(adt_type->type_args); ++i) {
-                    type_destroy((Type*)da_get(adt_type->type_args, i));
-                }
-                da_destroy(adt_type->type_args);
-            }
+            h = hash_combine(h, hash_bytes(key->name, key->name_length));
             break;
-        }
         case TYPE_GENERIC_PARAM:
-            // TypeGenericParam* gp = (TypeGenericParam*)type;
-            // Token name is a struct.
+            h = hash_combine(h, (uint64_t)(uintptr_t)key->symbol);
+            h = hash_combine(h, (uint64_t)key->index);
+            break;
+        case TYPE_ADT:
+            h = hash_combine(h, (uint64_t)(uintptr_t)key->symbol);
+            for (size_t i = 0; i < key->arg_count; ++i) h = hash_combine(h, key->args[i]->id);
             break;
-        case TYPE_VOID:
-        case TYPE_ERROR:
-        case TYPE_UNKNOWN:
-            // No specific fields to free for these simple types beyond the base struct.
+        case TYPE_REFERENCE:
+            h = hash_combine(h, key->args[0]->id);
+            h = hash_combine(h, key->is_mutable);
+            break;
+        case TYPE_VAR:
+            h = hash_combine(h, (uint64_t)(uintptr_t)key->owner);
+            h = hash_combine(h, (uint64_t)key->index);
             break;
         default:
-            // Handle other types like TYPE_FUNCTION, TYPE_REFERENCE later
             break;
     }
-    free(type);
+    return h;
 }
 
-// --- Type Comparison (Simplified for Phase 1) ---
-bool types_are_equal(Type* type1, Type* type2) {
-    if (!type1 || !type2) return false; // Or true if both NULL? Depends on semantics.
-    if (type1 == type2) return true; // Same instance
-    if (type1->kind != type2->kind) return false;
-
-    switch (type1->kind) {
+static bool key_matches(const Type* type, const TypeKey* key) {
+    if (type->kind != key->kind) return false;
+    switch (key->kind) {
         case TYPE_PRIMITIVE: {
-            TypePrimitive* p1 = (TypePrimitive*)type1;
-            TypePrimitive* p2 = (TypePrimitive*)type2;
-            // Compare by name token (assuming lexemes are comparable, e.g. from source or interned)
-            return p1->name.length == p2->name.length &&
-                   strncmp(p1->name.lexeme, p2->name.lexeme, p1->name.length) == 0;
+            const TypePrimitive* p = (const TypePrimitive*)type;
+            return p->name.length == key->name_length && memcmp(p->name.lexeme, key->name, key->name_length) == 0;
+        }
+        case TYPE_GENERIC_PARAM: {
+            const TypeGenericParam* gp = (const TypeGenericParam*)type;
+            return gp->owner == key->symbol && gp->index == key->index;
         }
         case TYPE_ADT: {
-            TypeADT* adt1 = (TypeADT*)type1;
-            TypeADT* adt2 = (TypeADT*)type2;
-            // Compare by underlying ADT definition (symbol) and type arguments
-            if (adt1->adt_symbol != adt2->adt_symbol) return false; // Must be same ADT base
-            if (da_count(adt1->type_args) != da_count(adt2->type_args)) return false;
-            for (size_t i = 0; i < da_count(adt1->type_args); ++i) {
-                if (!types_are_equal((Type*)da_get(adt1->type_args, i), (Type*)da_get(adt2->type_args, i))) {
-                    return false;
-                }
+            const TypeADT* adt = (const TypeADT*)type;
+            if (adt->adt_symbol != key->symbol || adt->type_arg_count != key->arg_count) return false;
+            for (size_t i = 0; i < key->arg_count; ++i) {
+                if (adt->type_args[i] != key->args[i]) return false;
             }
             return true;
         }
+        case TYPE_REFERENCE: {
+            const TypeReference* ref = (const TypeReference*)type;
+            return ref->referent == key->args[0] && ref->is_mutable == key->is_mutable;
+        }
+        case TYPE_VAR: {
+            const TypeVar* var = (const TypeVar*)type;
+            return var->owner == key->owner && var->index == (uint32_t)key->index;
+        }
+        default:
+            return true; // VOID, ERROR, UNKNOWN are singletons per kind
+    }
+}
+
+static size_t table_find(Type** table, uint32_t* hashes, size_t capacity, const TypeKey* key, uint32_t hash) {
+    size_t mask = capacity - 1;
+    size_t i = hash & mask;
+    while (table[i] && !(hashes[i] == hash && key_matches(table[i], key))) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static bool table_grow(void) {
+    size_t new_capacity = interner.capacity ? interner.capacity * 2 : TYPE_TABLE_INITIAL_CAPACITY;
+    Type** new_table = (Type**)calloc(new_capacity, sizeof(Type*));
+    uint32_t* new_hashes = (uint32_t*)calloc(new_capacity, sizeof(uint32_t));
+    if (!new_table || !new_hashes) {
+        free(new_table);
+        free(new_hashes);
+        return false;
+    }
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < interner.capacity; ++i) {
+        if (!interner.table[i]) continue;
+        size_t j = interner.table_hashes[i] & mask;
+        while (new_table[j]) j = (j + 1) & mask;
+        new_table[j] = interner.table[i];
+        new_hashes[j] = interner.table_hashes[i];
+    }
+    free(interner.table);
+    free(interner.table_hashes);
+    interner.table = new_table;
+    interner.table_hashes = new_hashes;
+    interner.capacity = new_capacity;
+    return true;
+}
+
+// Builds the arena node for a key that is not interned yet.
+static Type* make_type(const TypeKey* key) {
+    Type* type = NULL;
+    switch (key->kind) {
+        case TYPE_PRIMITIVE: {
+            TypePrimitive* p = (TypePrimitive*)arena_alloc(sizeof(TypePrimitive));
+            char* name = (char*)arena_alloc(key->name_length + 1);
+            if (!p || !name) return NULL;
+            memcpy(name, key->name, key->name_length);
+            name[key->name_length] = '\0';
+            p->name = (Token){.type = TOKEN_IDENTIFIER, .lexeme = name, .length = key->name_length, .line = 0, .col = 0};
+            type = (Type*)p;
+            break;
+        }
         case TYPE_GENERIC_PARAM: {
-            TypeGenericParam* gp1 = (TypeGenericParam*)type1;
-            TypeGenericParam* gp2 = (TypeGenericParam*)type2;
-            // Generic parameters are typically only equal if they are the exact same instance/definition.
-            // Comparing by name might be okay within the same scope, but risky across different generic contexts.
-            // For now, simple name comparison. This needs refinement for a full type system.
-            return gp1->name.length == gp2->name.length &&
-                   strncmp(gp1->name.lexeme, gp2->name.lexeme, gp1->name.length) == 0;
+            TypeGenericParam* gp = (TypeGenericParam*)arena_alloc(sizeof(TypeGenericParam));
+            char* name = (char*)arena_alloc(key->name_length + 1);
+            if (!gp || !name) return NULL;
+            gp->owner = key->symbol;
+            gp->index = key->index;
+            memcpy(name, key->name, key->name_length);
+            name[key->name_length] = '\0';
+            gp->name = (Token){.type = TOKEN_IDENTIFIER, .lexeme = name, .length = key->name_length, .line = 0, .col = 0};
+            type = (Type*)gp; // The caller fills in the rest of the name token
+            break;
+        }
+        case TYPE_ADT: {
+            TypeADT* adt = (TypeADT*)arena_alloc(sizeof(TypeADT));
+            Type** args = key->arg_count ? (Type**)arena_alloc(key->arg_count * sizeof(Type*)) : NULL;
+            if (!adt || (key->arg_count && !args)) return NULL;
+            if (key->arg_count) memcpy(args, key->args, key->arg_count * sizeof(Type*));
+            adt->name = key->symbol->name_token;
+            adt->type_args = args;
+            adt->type_arg_count = key->arg_count;
+            adt->adt_symbol = key->symbol;
+            type = (Type*)adt;
+            break;
+        }
+        case TYPE_REFERENCE: {
+            TypeReference* ref = (TypeReference*)arena_alloc(sizeof(TypeReference));
+            if (!ref) return NULL;
+            ref->referent = key->args[0];
+            ref->is_mutable = key->is_mutable;
+            type = (Type*)ref;
+            break;
+        }
+        case TYPE_VAR: {
+            TypeVar* var = (TypeVar*)arena_alloc(sizeof(TypeVar));
+            if (!var) return NULL;
+            var->owner = key->owner;
+            var->index = (uint32_t)key->index;
+            type = (Type*)var;
+            break;
         }
-        case TYPE_VOID:
-        case TYPE_ERROR: // Should error types be considered equal? Usually not.
-        case TYPE_UNKNOWN: // Two unknown types are not necessarily equal.
-            return type1->kind == type2->kind; // Only equal if both are VOID. Error/Unknown are distinct.
         default:
-            return false; // Unhandled or different complex types
+            type = (Type*)arena_alloc(sizeof(Type));
+            break;
+    }
+    if (!type) return NULL;
+    type->kind = key->kind;
+    type->id = (uint32_t)da_count(interner.by_id);
+    type->flags = 0;
+    atomic_init(&type->capabilities, 0);
+    if (key->kind == TYPE_GENERIC_PARAM) type->flags = TYPE_HAS_PARAMS;
+    if (key->kind == TYPE_VAR) type->flags = TYPE_HAS_VARS;
+    if (key->kind == TYPE_ADT || key->kind == TYPE_REFERENCE) {
+        for (size_t i = 0; i < key->arg_count; ++i) type->flags |= key->args[i]->flags;
     }
+    return type;
+}
+
+// Returns the unique type for `key`, creating it if needed. `created` (optional)
+// reports whether this call made it. The caller holds interner.lock.
+static Type* intern_locked(const TypeKey* key, bool* created) {
+    if (created) *created = false;
+    if (!interner.by_id) return NULL; // types_init_predefined() not called
+    if ((da_count(interner.by_id) + 1) * 2 > interner.capacity && !table_grow()) return NULL;
+    uint32_t hash = key_hash(key);
+    size_t slot = table_find(interner.table, interner.table_hashes, interner.capacity, key, hash);
+    if (interner.table[slot]) return interner.table[slot];
+
+    Type* type = make_type(key);
+    if (!type) return NULL;
+    da_push(interner.by_id, type);
+    interner.table[slot] = type;
+    interner.table_hashes[slot] = hash;
+    if (created) *created = true;
+    return type;
+}
+
+static Type* intern(const TypeKey* key) {
+    pthread_mutex_lock(&interner.lock);
+    Type* type = intern_locked(key, NULL);
+    pthread_mutex_unlock(&interner.lock);
+    return type;
+}
+
+Type* type_intern_primitive(Token name) {
+    TypeKey key = {.kind = TYPE_PRIMITIVE, .name = name.lexeme, .name_length = name.length};
+    return intern(&key);
+}
+
+Type* type_intern_adt(struct Symbol* adt_symbol, Type** type_args, size_t type_arg_count) {
+    if (!adt_symbol) return NULL;
+    for (size_t i = 0; i < type_arg_count; ++i) {
+        if (!type_args[i]) return NULL;
+    }
+    TypeKey key = {.kind = TYPE_ADT, .symbol = adt_symbol, .args = type_args, .arg_count = type_arg_count};
+    return intern(&key);
+}
+
+Type* type_intern_generic_param(struct Symbol* owner, int index, Token name) {
+    TypeKey key = {.kind = TYPE_GENERIC_PARAM, .symbol = owner, .index = index, .name = name.lexeme,
+                   .name_length = name.length};
+    pthread_mutex_lock(&interner.lock);
+    bool created = false;
+    Type* type = intern_locked(&key, &created);
+    if (created) { // The first declaration names it, with a copy of its lexeme
+        name.lexeme = ((TypeGenericParam*)type)->name.lexeme;
+        ((TypeGenericParam*)type)->name = name;
+    }
+    pthread_mutex_unlock(&interner.lock);
+    return type;
+}
+
+Type* type_intern_reference(Type* referent, bool is_mutable) {
+    if (!referent) return NULL;
+    TypeKey key = {.kind = TYPE_REFERENCE, .args = &referent, .arg_count = 1, .is_mutable = is_mutable};
+    return intern(&key);
+}
+
+Type* type_intern_var(const void* owner, uint32_t index) {
+    TypeKey key = {.kind = TYPE_VAR, .owner = owner, .index = (int)index};
+    return intern(&key);
+}
+
+Type* type_void(void) { return interner.void_type; }
+Type* type_error(void) { return interner.error_type; }
+Type* type_unknown(void) { return interner.unknown_type; }
+
+Type* type_by_id(uint32_t id) {
+    pthread_mutex_lock(&interner.lock);
+    Type* type = (Type*)da_get(interner.by_id, id);
+    pthread_mutex_unlock(&interner.lock);
+    return type;
+}
+
+size_t type_count(void) {
+    pthread_mutex_lock(&interner.lock);
+    size_t count = da_count(interner.by_id);
+    pthread_mutex_unlock(&interner.lock);
+    return count;
 }
 
 // --- Type to String Conversion ---
@@ -153,17 +333,17 @@ char* type_to_string(Type* type) {
         case TYPE_ADT: {
             TypeADT* adt = (TypeADT*)type;
             sb_append_buf(sb, adt->name.lexeme, adt->name.length);
-            if (adt->type_args && da_count(adt->type_args) > 0) {
+            if (adt->type_arg_count > 0) {
                 sb_append_char(sb, '<');
-                for (size_t i = 0; i < da_count(adt->type_args); ++i) {
-                    char* arg_str = type_to_string((Type*)da_get(adt->type_args, i));
+                for (size_t i = 0; i < adt->type_arg_count; ++i) {
+                    char* arg_str = type_to_string(adt->type_args[i]);
                     if (arg_str) {
                         sb_append_str(sb, arg_str);
                         free(arg_str);
                     } else {
                         sb_append_str(sb, "?");
                     }
-                    if (i < da_count(adt->type_args) - 1) {
+                    if (i < adt->type_arg_count - 1) {
                         sb_append_str(sb, ", ");
                     }
                 }
@@ -176,6 +356,20 @@ char* type_to_string(Type* type) {
             sb_append_buf(sb, gp->name.lexeme, gp->name.length);
             break;
         }
+        case TYPE_REFERENCE: {
+            TypeReference* ref = (TypeReference*)type;
+            sb_append_str(sb, ref->is_mutable ? "&mut " : "&");
+            char* referent_str = type_to_string(ref->referent);
+            sb_append_str(sb, referent_str ? referent_str : "?");
+            free(referent_str);
+            break;
+        }
+        case TYPE_VAR: {
+            char buf[24];
+            snprintf(buf, sizeof(buf), "?%u", ((TypeVar*)type)->index);
+            sb_append_str(sb, buf);
+            break;
+        }
         case TYPE_VOID: sb_append_str(sb, "void"); break;
         case TYPE_ERROR: sb_append_str(sb, "<type_error>"); break;
         case TYPE_UNKNOWN: sb_append_str(sb, "<unknown>"); break;
@@ -194,19 +388,17 @@ ADTDefinition* adt_definition_create(Token name, DynamicArray* type_params, Dyna
     ADTDefinition* def = (ADTDefinition*)malloc(sizeof(ADTDefinition));
     if (!def) return NULL;
     def->name = name;
-    def->type_params = type_params; // Assumes ownership of DA and its TypeGenericParam*
+    def->type_params = type_params; // Assumes ownership of the DA; its (interned) types are not owned
     def->variants = variants;       // Assumes ownership of DA and its ADTVariantSymbol*
+    def->scc = -1;
+    def->recursive = false;
+    def->inhabited = true;
     return def;
 }
 
 void adt_definition_destroy(ADTDefinition* def) {
     if (!def) return;
-    if (def->type_params) {
-        for (size_t i = 0; i < da_count(def->type_params); ++i) {
-            type_destroy((Type*)da_get(def->type_params, i)); // Assuming type_params stores Type* (specifically TypeGenericParam*)
-        }
-        da_destroy(def->type_params);
-    }
+    da_destroy(def->type_params); // The parameter types themselves live in the type arena
     if (def->variants) {
         for (size_t i = 0; i < da_count(def->variants); ++i) {
             adt_variant_symbol_destroy((ADTVariantSymbol*)da_get(def->variants, i));
@@ -239,13 +431,13 @@ ADTFieldSymbol* adt_field_symbol_create(Token name, Type* type) {
     ADTFieldSymbol* field_sym = (ADTFieldSymbol*)malloc(sizeof(ADTFieldSymbol));
     if (!field_sym) return NULL;
     field_sym->name = name; // Copied (Token is a struct)
-    field_sym->type = type; // Assumes ownership of the type
+    field_sym->type = type; // Interned; not owned
+    field_sym->boxed = false;
     return field_sym;
 }
 
 void adt_field_symbol_destroy(ADTFieldSymbol* field_sym) {
     if (!field_sym) return;
-    type_destroy(field_sym->type); // Destroy the type owned by the field
     free(field_sym);
 }
 
@@ -255,40 +447,58 @@ Type* type_string_instance = NULL;
 Type* type_bool_instance = NULL;
 Type* type_void_instance_ptr = NULL;
 
+static Token builtin_name(const char* name) {
+    return (Token){.type = TOKEN_IDENTIFIER, .lexeme = name, .length = strlen(name), .line = 0, .col = 0};
+}
+
 void types_init_predefined(void) {
-    // Ensure these are singletons. These tokens are literals, their lexemes are string literals.
-    // The line/col numbers are not critical here as these are for internal predefined types.
-    if (!type_i32_instance) {
-        type_i32_instance = type_primitive_create((Token){.type=TOKEN_IDENTIFIER, .lexeme="i32", .length=3, .line=0, .col=0});
-    }
-    if (!type_string_instance) {
-        type_string_instance = type_primitive_create((Token){.type=TOKEN_IDENTIFIER, .lexeme="String", .length=6, .line=0, .col=0});
-    }
-    if (!type_bool_instance) {
-        type_bool_instance = type_primitive_create((Token){.type=TOKEN_IDENTIFIER, .lexeme="bool", .length=4, .line=0, .col=0});
-    }
-    if (!type_void_instance_ptr) {
-        type_void_instance_ptr = type_void_create(); // Void doesn't need a name token
+    pthread_mutex_lock(&interner.lock);
+    bool first = interner.users++ == 0;
+    if (first) {
+        interner.by_id = da_create(256, sizeof(Type*));
+        TypeKey void_key = {.kind = TYPE_VOID};
+        TypeKey error_key = {.kind = TYPE_ERROR};
+        TypeKey unknown_key = {.kind = TYPE_UNKNOWN};
+        interner.void_type = intern_locked(&void_key, NULL);
+        interner.error_type = intern_locked(&error_key, NULL);
+        interner.unknown_type = intern_locked(&unknown_key, NULL);
     }
+    pthread_mutex_unlock(&interner.lock);
+    if (!first) return;
+
+    type_i32_instance = type_intern_primitive(builtin_name("i32"));
+    type_string_instance = type_intern_primitive(builtin_name("String"));
+    type_bool_instance = type_intern_primitive(builtin_name("bool"));
+    type_void_instance_ptr = type_void();
 }
 
-void types_cleanup_predefined(void) {
-    // These are shared, so destroy them only once at the end.
-    // The type_destroy function itself is safe for NULL.
-    type_destroy(type_i32_instance);
-    type_i32_instance = NULL;
-    type_destroy(type_string_instance);
-    type_string_instance = NULL;
-    type_destroy(type_bool_instance);
-    type_bool_instance = NULL;
-    type_destroy(type_void_instance_ptr);
-    type_void_instance_ptr = NULL;
+void types_forget_capabilities(void) {
+    pthread_mutex_lock(&interner.lock);
+    for (size_t i = 0; i < da_count(interner.by_id); ++i) {
+        atomic_store(&((Type*)da_get(interner.by_id, i))->capabilities, 0);
+    }
+    pthread_mutex_unlock(&interner.lock);
 }
 
-bool type_is_predefined(Type* type) {
-    if (!type) return false;
-    return type == type_i32_instance ||
-           type == type_string_instance ||
-           type == type_bool_instance ||
-           type == type_void_instance_ptr;
+void types_cleanup_predefined(void) {
+    pthread_mutex_lock(&interner.lock);
+    if (interner.users == 0 || --interner.users > 0) {
+        pthread_mutex_unlock(&interner.lock);
+        return;
+    }
+    while (interner.blocks) {
+        TypeArenaBlock* next = interner.blocks->next;
+        free(interner.blocks);
+        interner.blocks = next;
+    }
+    free(interner.table);
+    free(interner.table_hashes);
+    da_destroy(interner.by_id);
+    interner.table = NULL;
+    interner.table_hashes = NULL;
+    interner.capacity = 0;
+    interner.by_id = NULL;
+    interner.void_type = interner.error_type = interner.unknown_type = NULL;
+    type_i32_instance = type_string_instance = type_bool_instance = type_void_instance_ptr = NULL;
+    pthread_mutex_unlock(&interner.lock);
 }
@@ -2,6 +2,9 @@
 #define TYPES_H
 
 #include <stdbool.h> // For bool
+#include <stddef.h>  // For size_t
+#include <stdint.h>  // For uint32_t
+#include <stdatomic.h> // For lazily cached capability bits
 #include "../util/dynamic_array.h" // For fields in ADTs, type parameters
 #include "token.h" // For names
 
@@ -23,20 +26,39 @@ typedef enum {
     TYPE_VOID,       // Represents no type, e.g. for functions not returning a value
     TYPE_ERROR,      // Represents an error in type resolution or a problematic type
     TYPE_UNKNOWN,    // Placeholder until type is inferred or resolved
+    TYPE_VAR,        // Inference variable, only live inside a TypeInferencer (see type_infer.h)
 } TypeKind;
 
 // Base Type structure
+// Types are hash-consed: every structurally distinct type exists exactly once,
+// in a process-wide type arena, so two types are equal iff their pointers are.
+// Types are never freed individually; the arena releases them all at once.
 typedef struct Type {
     TypeKind kind;
+    uint32_t id;    // Dense interning ID (0, 1, 2, ...), usable as a hash or array index
+    uint32_t flags; // TYPE_HAS_* bits, computed once when the type is interned
+    atomic_uint capabilities; // TYPE_CAP_* bits, derived on first query (see type_caps.h)
     // Add common properties if any, e.g., size, alignment (for later stages)
     // For ownership, we might add flags or pointers to lifetime info here or in Symbol.
     // bool is_copyable; // Based on Copy trait/typeclass
 } Type;
 
+// Structural flags: whether a type mentions generic parameters or inference
+// variables anywhere inside it. Substitution and zonking skip subtrees without them.
+#define TYPE_HAS_PARAMS 0x1u
+#define TYPE_HAS_VARS   0x2u
+
+// Capabilities derived from a type's structure (see type_caps.h).
+#define TYPE_CAP_COPY         0x01u // Duplicating is a bitwise copy; the source stays usable
+#define TYPE_CAP_TRIVIAL_DROP 0x02u // Dropping a value does nothing
+#define TYPE_CAP_ZERO_SIZED   0x04u // Values carry no data
+#define TYPE_CAP_POD          0x08u // Copy and free of references: moves and drops lower to memcpy / nothing
+#define TYPE_CAP_KNOWN        0x80u // The bits above have been computed
+
 // Primitive Types
 typedef struct {
     Type base;
-    Token name; // e.g., "i32", "bool", "String" token
+    Token name; // e.g., "i32", "bool", "String"; lexeme is owned by the type arena
 } TypePrimitive;
 
 // ADT Types (a reference to a defined ADT)
@@ -44,20 +66,40 @@ typedef struct {
 typedef struct {
     Type base;
     Token name;                 // Name of the ADT (e.g., Option, List)
-    DynamicArray* type_args;    // DynamicArray of Type* (resolved actual types for generic parameters)
-                                // e.g., for Option<i32>, type_args would contain a Type* for i32.
-                                // This points to the ADT's *definition* or declaration symbol.
+    struct Type** type_args;    // Interned actual types for generic parameters, in the arena
+                                // e.g., for Option<i32>, type_args[0] is the i32 type.
+    size_t type_arg_count;
     struct Symbol* adt_symbol;  // Pointer to the Symbol table entry for the ADT's definition
                                 // This allows access to variants, fields, original type params etc.
+                                // Together with type_args, this is the type's identity.
 } TypeADT;
 
 // Generic Type Parameter (e.g., T within the definition of Option<T>)
+// Identified by its declaring ADT and position, so `T` in Option<T> and `T` in
+// List<T> are different types.
 typedef struct {
     Type base;
-    Token name; // The token for 'T'
+    Token name;            // The token for 'T'
+    struct Symbol* owner;  // ADT symbol that declares the parameter
+    int index;             // Position in the owner's parameter list
     // We might need constraints here later (e.g. T: Display)
 } TypeGenericParam;
 
+// Reference Types (&T, &mut T)
+typedef struct {
+    Type base;
+    Type* referent;
+    bool is_mutable;
+} TypeReference;
+
+// Inference variable. Its binding lives in the owning inferencer's union-find
+// table; inferred types never keep variables once a `let` has been generalized.
+typedef struct {
+    Type base;
+    const void* owner; // The TypeInferencer that created it
+    uint32_t index;    // Slot in the owner's variable table
+} TypeVar;
+
 // Type for "void" or unit type
 typedef struct {
     Type base;
@@ -75,10 +117,14 @@ typedef struct {
 // A TypeADT above would point to a Symbol containing this.
 typedef struct {
     Token name;                 // Name of the ADT (e.g., Option, List)
-    DynamicArray* type_params;  // DynamicArray of TypeGenericParam* (defined generic parameters like T, A)
+    DynamicArray* type_params;  // DynamicArray of TypeGenericParam* (defined generic parameters like T, A; interned, not owned)
     DynamicArray* variants;     // DynamicArray of ADTVariantSymbol* (defined variants)
                                 // These are not AST ADTVariant nodes, but symbol table representations.
     // Scope* own_scope;        // Each ADT might define its own scope for variants if they are not global.
+    // Filled in by the ADT dependency analysis (see adt_graph.h):
+    int scc;                    // Strongly connected component, numbered dependencies first (-1 before analysis)
+    bool recursive;             // Part of a cycle of by-value field references (including a self-reference)
+    bool inhabited;             // Has a finite value (false for `data Bad { B(Bad) }` and for `data Void {}`)
 } ADTDefinition;
 
 // Represents a variant's definition within an ADTDefinition
@@ -91,27 +137,36 @@ typedef struct {
 // Represents a field's definition within an ADTVariantSymbol
 typedef struct {
     Token name; // Optional field name
-    Type* type; // Resolved type of the field
+    Type* type; // Resolved (interned) type of the field
+    bool boxed; // Stored behind an owning pointer because it closes a recursive cycle (see adt_graph.h)
 } ADTFieldSymbol;
 
 
 // --- Type System API ---
 
-// Create basic types
-Type* type_primitive_create(Token name);
-Type* type_adt_create(Token name, DynamicArray* type_args, struct Symbol* adt_symbol);
-Type* type_generic_param_create(Token name);
-Type* type_void_create();
-Type* type_error_create();
-Type* type_unknown_create(); // Useful as a placeholder
-
-// Destroy types
-void type_destroy(Type* type); // Should handle all kinds
-
-// Compare types (for type checking)
-// Returns true if types are considered equivalent.
-// This will get complex with generics, subtyping (if any), etc.
-bool types_are_equal(Type* type1, Type* type2);
+// Interning constructors: each returns the unique instance of the requested type,
+// creating it on first use. Components must themselves be interned types.
+// Safe to call from several threads. Return NULL only on allocation failure.
+Type* type_intern_primitive(Token name);
+Type* type_intern_adt(struct Symbol* adt_symbol, Type** type_args, size_t type_arg_count);
+// The name of a generic parameter is copied, so `name` may be a temporary.
+Type* type_intern_generic_param(struct Symbol* owner, int index, Token name);
+Type* type_intern_reference(Type* referent, bool is_mutable);
+Type* type_intern_var(const void* owner, uint32_t index);
+Type* type_void(void);
+Type* type_error(void);
+Type* type_unknown(void); // Placeholder until the type is inferred or resolved
+
+// Compare types (for type checking): pointer equality, since types are interned.
+static inline bool types_are_equal(Type* type1, Type* type2) {
+    return type1 && type1 == type2;
+}
+
+// Returns the type with the given interning ID, or NULL. O(1).
+Type* type_by_id(uint32_t id);
+
+// Number of distinct types interned so far (one past the largest ID).
+size_t type_count(void);
 
 // Get a string representation of a type (for error messages, debugging)
 // Caller should free the returned string.
@@ -126,23 +181,24 @@ ADTVariantSymbol* adt_variant_symbol_create(Token name, DynamicArray* fields);
 void adt_variant_symbol_destroy(ADTVariantSymbol* var_sym);
 
 ADTFieldSymbol* adt_field_symbol_create(Token name, Type* type);
-void adt_field_symbol_destroy(ADTFieldSymbol* field_sym);
+void adt_field_symbol_destroy(ADTFieldSymbol* field_sym); // Does not free the (interned) type
 
 // --- Predefined Types ---
-// Globally accessible singleton instances for predefined types.
-// These are initialized by types_init_predefined() and cleaned up by types_cleanup_predefined().
+// Interned instances of the built-in types, set up by types_init_predefined().
 extern Type* type_i32_instance;
 extern Type* type_string_instance;
 extern Type* type_bool_instance;
-extern Type* type_void_instance_ptr; // Renamed to avoid conflict with type_void_create
+extern Type* type_void_instance_ptr;
 
-// Initialize and cleanup predefined types.
-// These should be called once, typically at the start and end of the semantic analysis phase.
+// Set up and release the type arena (including the predefined types above).
+// Calls nest: the arena is created by the first init and freed, with every type
+// in it, by the matching last cleanup. No Type* may be used after that.
 void types_init_predefined(void);
 void types_cleanup_predefined(void);
 
-// Helper to check if a type is one of the predefined singletons.
-bool type_is_predefined(Type* type);
+// Clears the capability bits cached on every interned type, so they are derived
+// again on next use (after an ADT's variants change).
+void types_forget_capabilities(void);
 
 
 #endif // TYPES_H
@@ -1,14 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h> // Added for free()
 #include <string.h> // Added for strcmp
+#include <time.h>   // For clock, timing -recheck
 #include "util/dynamic_array.h"
 #include "util/string_builder.h"
+#include "util/task_graph.h"
 #include "core/lexer.h"
 #include "core/token.h"
 #include "core/parser.h"
 #include "core/ast.h"
 #include "core/ast_printer.h"
 #include "core/semantic_analyzer.h" // Added
+#include "core/symbol_index.h"
+#include "core/layout.h"
+#include "core/incremental.h"
+#include "core/ir_lower.h"
+#include "core/ir_opt.h"
+#include "backend/c_backend.h"
+#include "backend/asm_backend.h"
+#include "backend/bytecode.h"
+#include "backend/vm.h"
+#include "backend/toolchain.h"
 
 // Function to read entire file into a string (allocates memory)
 char* read_file_to_string(const char* filepath) {
@@ -41,6 +53,225 @@ char* read_file_to_string(const char* filepath) {
 }
 
 
+// Reads, lexes and parses a file for -recheck. On success *source_out owns the
+// text the program's tokens point into; on failure the reason is reported.
+static Program* parse_file(const char* path, char** source_out, size_t max_errors) {
+    char* source = read_file_to_string(path);
+    if (!source) return NULL;
+    Diagnostics* diagnostics = diagnostics_create(source);
+    diagnostics_set_limit(diagnostics, max_errors);
+    Lexer* lexer = lexer_create(source);
+    Parser* parser = NULL;
+    Program* program = NULL;
+    if (lexer) lexer->diagnostics = diagnostics;
+    if (lexer && lexer_scan_tokens(lexer)) {
+        parser = parser_create(lexer_get_tokens(lexer));
+        if (parser) {
+            parser->diagnostics = diagnostics;
+            program = parser_parse(parser);
+        }
+        if (program && parser_had_error(parser)) {
+            ast_program_destroy(program);
+            program = NULL;
+        }
+    }
+    diagnostics_render(diagnostics, stderr);
+    if (!program) fprintf(stderr, "%s: lexing or parsing failed.\n", path);
+    diagnostics_destroy(diagnostics);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    if (!program) {
+        free(source);
+        return NULL;
+    }
+    *source_out = source;
+    return program;
+}
+
+// -recheck: analyzes `first`, then each later file as an edited revision of it,
+// reporting how much of the analysis each revision had to redo.
+static bool run_rechecks(const char* first, DynamicArray* paths, size_t max_errors) {
+    AnalysisSession* session = analysis_session_create();
+    if (!session) return false;
+    analysis_session_set_error_limit(session, max_errors);
+    bool all_ok = true;
+    for (size_t i = 0; i <= da_count(paths); ++i) {
+        const char* path = i == 0 ? first : (const char*)da_get(paths, i - 1);
+        printf("\n--- Recheck %zu: %s ---\n", i, path);
+        char* source = NULL;
+        Program* program = parse_file(path, &source, max_errors);
+        if (!program) {
+            all_ok = false;
+            continue;
+        }
+        clock_t start = clock();
+        bool ok = analysis_session_update(session, program, source);
+        double ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+        const SessionStats* stats = analysis_session_stats(session);
+        printf("%s (%s): %zu queries run, %zu reused, %zu cut off, %.2f ms\n",
+               ok ? "Semantic analysis successful" : "Semantic analysis failed",
+               stats->full ? "from scratch" : "incremental", stats->executed, stats->reused, stats->cut_off, ms);
+        if (!ok) all_ok = false;
+    }
+    analysis_session_destroy(session);
+    return all_ok;
+}
+
+static char* work_dir_for(const char* output) {
+    size_t length = strlen(output) + sizeof(".build");
+    char* work_dir = (char*)malloc(length);
+    if (work_dir) snprintf(work_dir, length, "%s.build", output);
+    return work_dir;
+}
+
+// The C backend: an executable at `output`, or with `emit_dir` just the C sources there.
+static bool build_with_c(const IrProgram* ir, SemanticAnalyzer* analyzer, const char* output, const char* emit_dir,
+                         size_t shards, size_t jobs) {
+    char* work_dir = emit_dir ? NULL : work_dir_for(output);
+    if (!emit_dir && !work_dir) return false;
+    CBackendOptions options = {0};
+    options.output = output;
+    options.work_dir = emit_dir ? emit_dir : work_dir;
+    options.shards = shards;
+    options.jobs = jobs;
+    options.emit_only = emit_dir != NULL;
+    CBackendStats stats;
+    bool ok = c_backend_build(ir, analyzer->instances, &options, &stats);
+    if (ok) {
+        printf("C emission %.2f ms (%zu translation units, %zu functions, %zu bytes)\n", stats.emit_seconds * 1000.0,
+               stats.translation_units, stats.functions, stats.bytes);
+        if (emit_dir) {
+            printf("C sources written to %s/\n", emit_dir);
+        } else {
+            printf("C compiler %.2f ms (%zu jobs), link %.2f ms\n", stats.compile_seconds * 1000.0,
+                   jobs ? jobs : task_graph_default_workers(), stats.link_seconds * 1000.0);
+            printf("Executable written to %s\n", output);
+        }
+    }
+    free(work_dir);
+    return ok;
+}
+
+// The native backend: an executable at `output`, or with `emit_dir` just the
+// assembly and the runtime's source there. `write_object` skips the assembler.
+static bool build_with_asm(const IrProgram* ir, const char* output, const char* emit_dir, bool write_object) {
+    double start = toolchain_now();
+    BcProgram* bytecode = bc_compile(ir);
+    if (!bytecode) return false;
+    double bytecode_seconds = toolchain_now() - start;
+    char* work_dir = emit_dir ? NULL : work_dir_for(output);
+    bool ok = emit_dir || work_dir;
+    AsmBackendOptions options = {0};
+    options.output = output;
+    options.work_dir = emit_dir ? emit_dir : work_dir;
+    options.write_object = write_object && !emit_dir;
+    options.emit_only = emit_dir != NULL;
+    AsmBackendStats stats;
+    ok = ok && asm_backend_build(bytecode, &options, &stats);
+    if (ok) {
+        printf("Bytecode %.2f ms, %s emission %.2f ms (%zu bytes)\n", bytecode_seconds * 1000.0,
+               options.write_object ? "object" : "assembly", stats.emit_seconds * 1000.0, stats.bytes);
+        if (emit_dir) {
+            printf("Assembly written to %s/\n", emit_dir);
+        } else if (options.write_object) {
+            if (stats.runtime_compiled) printf("Runtime compiled %.2f ms, ", stats.assemble_seconds * 1000.0);
+            else printf("Runtime up to date, ");
+            printf("link %.2f ms\n", stats.link_seconds * 1000.0);
+            printf("Executable written to %s\n", output);
+        } else {
+            printf("Assembler %.2f ms (%s), link %.2f ms\n", stats.assemble_seconds * 1000.0,
+                   stats.runtime_compiled ? "runtime compiled" : "runtime up to date", stats.link_seconds * 1000.0);
+            printf("Executable written to %s\n", output);
+        }
+    }
+    free(work_dir);
+    bc_program_destroy(bytecode);
+    return ok;
+}
+
+// Lowers the analyzed program, optimizes it and builds it with `backend`
+// ("obj", "asm" or "c"). An -emit-* directory picks its backend and skips the build.
+static bool build_program(const Program* program, SemanticAnalyzer* analyzer, const char* backend,
+                          const char* output, const char* emit_c_dir, const char* emit_asm_dir, size_t shards,
+                          size_t jobs, double frontend_start) {
+    double frontend_seconds = toolchain_now() - frontend_start;
+    double start = toolchain_now();
+    IrProgram* ir = ir_lower_program(program);
+    if (!ir || !ir_optimize(ir, NULL)) {
+        fprintf(stderr, "Out of memory while building the IR.\n");
+        ir_program_destroy(ir);
+        return false;
+    }
+    double ir_seconds = toolchain_now() - start;
+    bool use_c = emit_c_dir || (!emit_asm_dir && strcmp(backend, "c") == 0);
+    bool use_obj = !use_c && !emit_asm_dir && strcmp(backend, "obj") == 0;
+    printf("\n--- %s Backend ---\n", use_c ? "C" : use_obj ? "Object" : "Assembly");
+    printf("Frontend %.2f ms, IR %.2f ms\n", frontend_seconds * 1000.0, ir_seconds * 1000.0);
+    bool ok = use_c ? build_with_c(ir, analyzer, output, emit_c_dir, shards, jobs)
+                    : build_with_asm(ir, output, emit_asm_dir, use_obj);
+    ir_program_destroy(ir);
+    return ok;
+}
+
+// `run` mode: analyzes the file, compiles it to bytecode and interprets it,
+// printing each `let` like the executables the C backend builds. Only errors,
+// and with `repeat` > 1 the timing of the runs, go to stderr, so stdout is
+// just the program's output.
+static int run_file(const char* path, size_t jobs, size_t max_errors, size_t repeat, bool jit) {
+    char* source = NULL;
+    Program* program = parse_file(path, &source, max_errors);
+    if (!program) return 1;
+    bool ok = false;
+    Diagnostics* diagnostics = diagnostics_create(source);
+    SemanticAnalyzer* analyzer = semantic_analyzer_create();
+    if (diagnostics && analyzer) {
+        diagnostics_set_limit(diagnostics, max_errors);
+        if (jobs > 0) analyzer->jobs = jobs;
+        semantic_analyzer_set_diagnostics(analyzer, diagnostics);
+        ok = semantic_analyzer_analyze(analyzer, program);
+        diagnostics_render(diagnostics, stderr);
+        if (!ok) fprintf(stderr, "%s: semantic analysis failed.\n", path);
+    } else {
+        fprintf(stderr, "Failed to create semantic analyzer.\n");
+    }
+
+    BcProgram* bytecode = NULL;
+    if (ok) {
+        IrProgram* ir = ir_lower_program(program);
+        if (!ir || !ir_optimize(ir, NULL)) {
+            fprintf(stderr, "Out of memory while building the IR.\n");
+        } else {
+            bytecode = bc_compile(ir);
+        }
+        ir_program_destroy(ir);
+        ok = bytecode != NULL;
+    }
+    if (ok) {
+        Vm* vm = vm_create(bytecode);
+        if (!vm) fprintf(stderr, "Out of memory while starting the VM.\n");
+        if (vm) vm_set_jit(vm, jit);
+        double start = toolchain_now();
+        for (size_t run = 0; run < repeat && vm && ok; ++run) ok = vm_run(vm);
+        double seconds = toolchain_now() - start;
+        ok = ok && vm;
+        if (ok) vm_print_globals(vm, stdout);
+        if (ok && repeat > 1) {
+            const VmStats* stats = vm_stats(vm);
+            fprintf(stderr, "%zu runs in %.2f ms: %zu interpreted, %zu native (%zu bytes compiled in %.2f ms)\n",
+                    stats->runs, seconds * 1000.0, stats->runs - stats->native_runs - stats->osr_entries,
+                    stats->native_runs + stats->osr_entries, stats->native_bytes, stats->compile_seconds * 1000.0);
+        }
+        vm_destroy(vm);
+    }
+
+    bc_program_destroy(bytecode);
+    semantic_analyzer_destroy(analyzer);
+    diagnostics_destroy(diagnostics);
+    ast_program_destroy(program);
+    free(source);
+    return ok ? 0 : 1;
+}
+
 void run_utility_tests() {
     printf("\n--- Testing Utilities ---\n");
     // Test DynamicArray
@@ -88,18 +319,76 @@ void run_utility_tests() {
 
 
 int main(int argc, char *argv[]) {
+    double frontend_start = toolchain_now(); // Wall clock, for the -o time split
     // run_utility_tests(); // Optional: run tests if needed
 
     if (argc < 2) {
         printf("Mylang Compiler (mylangc)\n");
-        printf("Usage: %s <source_file> [-test-lexer]\n", argv[0]);
+        printf("Usage: %s <source_file> [-test-lexer] [-index <index_file>] [-print-layouts] [-print-classes] [-print-ir] [-print-bytecode] [-o <executable>] [-backend <obj|asm|c>] [-emit-asm <dir>] [-emit-c <dir>] [-shards <n>] [-jobs <n>] [-recheck <edited_file>]... [-root <name>]... [-max-errors <n>]\n", argv[0]);
         printf("       %s -test-lexer \"<source_string>\"\n", argv[0]);
+        printf("       %s -query-index <index_file> <name>\n", argv[0]);
+        printf("       %s run <source_file> [-repeat <n>] [-no-jit] [-jobs <n>] [-max-errors <n>]\n", argv[0]);
         return 1;
     }
 
+    // Run mode: interpret the program with the bytecode VM, compiling hot code.
+    if (strcmp(argv[1], "run") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "Error: run requires a source file.\n");
+            return 1;
+        }
+        size_t run_jobs = 0;
+        size_t run_max_errors = DIAGNOSTICS_DEFAULT_LIMIT;
+        size_t repeat = 1; // Runs of the program (-repeat), so hot code gets compiled
+        bool jit = true;   // Whether hot code may be compiled (-no-jit turns it off)
+        for (int i = 3; i < argc; ++i) {
+            if (strcmp(argv[i], "-jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+                run_jobs = (size_t)atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-repeat") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+                repeat = (size_t)atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-no-jit") == 0) {
+                jit = false;
+            } else if (strcmp(argv[i], "-max-errors") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+                run_max_errors = (size_t)atoi(argv[++i]);
+            } else {
+                fprintf(stderr, "Error: unknown or incomplete option '%s'.\n", argv[i]);
+                return 1;
+            }
+        }
+        return run_file(argv[2], run_jobs, run_max_errors, repeat, jit);
+    }
+
+    // Query mode: look a name up in a symbol index written by `-index`.
+    if (strcmp(argv[1], "-query-index") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Error: -query-index requires an index file and a name.\n");
+            return 1;
+        }
+        SymbolIndex *index = symbol_index_open(argv[2]);
+        if (!index) return 1;
+        bool found = symbol_index_print(index, argv[3], stdout);
+        if (!found) printf("No symbol named '%s' in the index.\n", argv[3]);
+        symbol_index_close(index);
+        return found ? 0 : 1;
+    }
+
     const char *mode_or_file = argv[1];
     const char *source_to_lex = NULL;
     char *file_content_buffer = NULL; // To hold content read from file
+    const char *index_path = NULL;    // Symbol index to update after analysis (-index)
+    bool print_layouts = false;       // Print the memory layout of every ADT specialization
+    bool print_classes = false;       // Print typeclasses, instances and their dispatch tables
+    bool print_ir = false;            // Print the optimized SSA IR of the program
+    bool print_bytecode = false;      // Print the VM bytecode compiled from that IR
+    int jobs = 0;                     // Analysis threads and C compiler processes (-jobs); 0 = one per online CPU
+    const char *output_path = NULL;   // Executable to build (-o)
+    const char *backend = "obj";      // How -o builds it (-backend): "obj" for native code written as an object directly, "asm" through the assembler, "c" through C
+    const char *emit_c_dir = NULL;    // Directory to write the generated C to, without compiling it (-emit-c)
+    const char *emit_asm_dir = NULL;  // Directory to write the generated assembly to, without assembling it (-emit-asm)
+    int shards = 0;                   // C translation units (-shards); 0 = one per job
+    DynamicArray *recheck_paths = da_create(4, sizeof(char*)); // Revisions to re-analyze incrementally (-recheck)
+    DynamicArray *roots = da_create(4, sizeof(char*)); // Declarations to analyze lazily from (-root); empty = all
+    size_t max_errors = DIAGNOSTICS_DEFAULT_LIMIT;     // Distinct errors to show (-max-errors); 0 = all
 
     bool test_lexer_mode_string = false;
     if (strcmp(mode_or_file, "-test-lexer") == 0) {
@@ -119,10 +408,48 @@ int main(int argc, char *argv[]) {
             return 1; // Error reading file
         }
         source_to_lex = file_content_buffer;
-        // Check if -test-lexer is an optional trailing arg for file mode
-        if (argc > 2 && strcmp(argv[2], "-test-lexer") == 0) {
-            test_lexer_mode_string = true; // Treat as test mode for printing tokens
-             printf("Lexer test mode for file input (will print tokens).\n");
+        // Optional trailing args for file mode
+        for (int i = 2; i < argc; ++i) {
+            if (strcmp(argv[i], "-test-lexer") == 0) {
+                test_lexer_mode_string = true; // Treat as test mode for printing tokens
+                printf("Lexer test mode for file input (will print tokens).\n");
+            } else if (strcmp(argv[i], "-index") == 0 && i + 1 < argc) {
+                index_path = argv[++i];
+            } else if (strcmp(argv[i], "-print-layouts") == 0) {
+                print_layouts = true;
+            } else if (strcmp(argv[i], "-print-classes") == 0) {
+                print_classes = true;
+            } else if (strcmp(argv[i], "-print-ir") == 0) {
+                print_ir = true;
+            } else if (strcmp(argv[i], "-print-bytecode") == 0) {
+                print_bytecode = true;
+            } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+                output_path = argv[++i];
+            } else if (strcmp(argv[i], "-emit-c") == 0 && i + 1 < argc) {
+                emit_c_dir = argv[++i];
+            } else if (strcmp(argv[i], "-emit-asm") == 0 && i + 1 < argc) {
+                emit_asm_dir = argv[++i];
+            } else if (strcmp(argv[i], "-backend") == 0 && i + 1 < argc &&
+                       (strcmp(argv[i + 1], "obj") == 0 || strcmp(argv[i + 1], "asm") == 0 ||
+                        strcmp(argv[i + 1], "c") == 0)) {
+                backend = argv[++i];
+            } else if (strcmp(argv[i], "-shards") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+                shards = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+                jobs = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-recheck") == 0 && i + 1 < argc) {
+                da_push(recheck_paths, argv[++i]);
+            } else if (strcmp(argv[i], "-root") == 0 && i + 1 < argc) {
+                da_push(roots, argv[++i]);
+            } else if (strcmp(argv[i], "-max-errors") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+                max_errors = (size_t)atoi(argv[++i]);
+            } else {
+                fprintf(stderr, "Error: unknown or incomplete option '%s'.\n", argv[i]);
+                free(file_content_buffer);
+                da_destroy(recheck_paths);
+                da_destroy(roots);
+                return 1;
+            }
         }
     }
 
@@ -138,12 +465,19 @@ int main(int argc, char *argv[]) {
         printf("Source:\n%s\n\nTokens:\n", source_to_lex);
     }
 
-    Lexer *lexer = lexer_create(source_to_lex);
+    // Errors of every phase are recorded here and printed once the phase is done.
+    Diagnostics *diagnostics = diagnostics_create(source_to_lex);
+    Lexer *lexer = diagnostics ? lexer_create(source_to_lex) : NULL;
     if (!lexer) {
         fprintf(stderr, "Failed to create lexer.\n");
+        diagnostics_destroy(diagnostics);
+        da_destroy(recheck_paths);
+        da_destroy(roots);
         if (file_content_buffer) free(file_content_buffer);
         return 1;
     }
+    diagnostics_set_limit(diagnostics, max_errors);
+    lexer->diagnostics = diagnostics;
 
     bool lex_success = lexer_scan_tokens(lexer);
 
@@ -164,23 +498,17 @@ int main(int argc, char *argv[]) {
                    token->lexeme,
                    token->line,
                    token->col);
-            if (token->type == TOKEN_ERROR) {
-                 // The lexeme of an error token IS the error message
-                 printf("  ERROR DETAILS: %.*s\n", (int)token->length, token->lexeme);
-            }
         }
+        diagnostics_render(diagnostics, stdout); // Error tokens span the offending text; the messages are here
         printf("--- End Lexer Test Output ---\n");
     } else if (!lex_success) {
         // In normal compilation mode, if lexing fails, print errors and exit.
         fprintf(stderr, "Lexical analysis failed. Errors:\n");
-        DynamicArray *tokens = lexer_get_tokens(lexer);
-        for (size_t i = 0; i < da_count(tokens); ++i) {
-            Token *token = (Token*)da_get(tokens, i);
-            if (token->type == TOKEN_ERROR) {
-                 fprintf(stderr, "L%d C%d: %.*s\n", token->line, token->col, (int)token->length, token->lexeme);
-            }
-        }
+        diagnostics_render(diagnostics, stderr);
         lexer_destroy(lexer);
+        diagnostics_destroy(diagnostics);
+        da_destroy(recheck_paths);
+        da_destroy(roots);
         if (file_content_buffer) free(file_content_buffer);
         return 1; // Indicate failure
     }
@@ -188,6 +516,7 @@ int main(int argc, char *argv[]) {
     Program *program = NULL;
     bool parse_errors = false;
     bool semantic_errors = false;
+    bool build_errors = false; // The C backend or the C compiler failed (-o, -emit-c)
 
     if (lex_success) {
         Parser *parser = parser_create(lexer_get_tokens(lexer));
@@ -195,13 +524,18 @@ int main(int argc, char *argv[]) {
         if (!parser) {
             fprintf(stderr, "Failed to create parser.\n");
             lexer_destroy(lexer);
+            diagnostics_destroy(diagnostics);
+            da_destroy(recheck_paths);
+            da_destroy(roots);
             if (file_content_buffer) free(file_content_buffer);
             return 1;
         }
+        parser->diagnostics = diagnostics;
         printf("\n--- Parsing ---\n");
         program = parser_parse(parser);
 
         if (parser_had_error(parser) || !program) {
+            diagnostics_render(diagnostics, stderr);
             fprintf(stderr, "Parsing failed with errors.\n");
             parse_errors = true;
         } else {
@@ -218,8 +552,67 @@ int main(int argc, char *argv[]) {
                 fprintf(stderr, "Failed to create semantic analyzer.\n");
                 semantic_errors = true; // Critical failure
             } else {
-                if (semantic_analyzer_analyze(analyzer, program)) {
+                if (jobs > 0) analyzer->jobs = (size_t)jobs;
+                semantic_analyzer_set_diagnostics(analyzer, diagnostics);
+                bool analyzed = da_count(roots) > 0 ? semantic_analyzer_analyze_roots(analyzer, program, roots)
+                                                    : semantic_analyzer_analyze(analyzer, program);
+                diagnostics_render(diagnostics, stderr);
+                if (analyzed) {
                     printf("Semantic analysis successful.\n");
+                    if (index_path) {
+                        // Token lexemes point into file_content_buffer, which is still alive here.
+                        SymbolIndexBuilder *builder = symbol_index_builder_create(mode_or_file);
+                        if (builder) {
+                            symbol_index_collect(builder, program, analyzer->sym_table);
+                            if (symbol_index_write(index_path, builder)) {
+                                printf("Symbol index updated: %s\n", index_path);
+                            }
+                            symbol_index_builder_destroy(builder);
+                        }
+                    }
+                    if (print_layouts) {
+                        printf("\n--- ADT Layouts ---\n");
+                        LayoutEngine *layouts = layout_engine_create(analyzer->instances);
+                        layout_print_all(layouts, stdout);
+                        layout_engine_destroy(layouts);
+                    }
+                    if (print_classes) {
+                        printf("\n--- Typeclasses ---\n");
+                        typeclass_print(analyzer->classes, stdout);
+                    }
+                    if (print_ir) {
+                        printf("\n--- IR ---\n");
+                        IrProgram *ir = ir_lower_program(program);
+                        IrOptStats stats = {0};
+                        if (ir && ir_optimize(ir, &stats)) {
+                            ir_print(ir, stdout);
+                            printf("(%zu constants folded, %zu branches folded, %zu projections forwarded, "
+                                   "%zu values numbered, %zu instructions and %zu blocks removed)\n",
+                                   stats.constants_folded, stats.branches_folded, stats.projections_forwarded,
+                                   stats.values_numbered, stats.instrs_removed, stats.blocks_removed);
+                        } else {
+                            fprintf(stderr, "Out of memory while building the IR.\n");
+                        }
+                        ir_program_destroy(ir);
+                    }
+                    if (print_bytecode) {
+                        printf("\n--- Bytecode ---\n");
+                        IrProgram *ir = ir_lower_program(program);
+                        BcProgram *bytecode = NULL;
+                        if (ir && ir_optimize(ir, NULL)) {
+                            bytecode = bc_compile(ir);
+                        } else {
+                            fprintf(stderr, "Out of memory while building the IR.\n");
+                        }
+                        if (bytecode) bc_print(bytecode, stdout);
+                        bc_program_destroy(bytecode);
+                        ir_program_destroy(ir);
+                    }
+                    if ((output_path || emit_c_dir || emit_asm_dir) &&
+                        !build_program(program, analyzer, backend, output_path, emit_c_dir, emit_asm_dir,
+                                       (size_t)shards, (size_t)jobs, frontend_start)) {
+                        build_errors = true;
+                    }
                 } else {
                     fprintf(stderr, "Semantic analysis failed with errors.\n");
                     semantic_errors = true;
@@ -232,19 +625,28 @@ int main(int argc, char *argv[]) {
         parse_errors = true;
     }
 
+    if (da_count(recheck_paths) > 0 && lex_success && !parse_errors && !run_rechecks(mode_or_file, recheck_paths, max_errors)) {
+        semantic_errors = true;
+    }
     if (!test_lexer_mode_string && lex_success && !parse_errors && !semantic_errors) {
          printf("\nCompilation pipeline (Lexer + Parser + Semantic Analyzer) successful.\n");
          // Next steps: More Semantic Analysis (type checking, ownership), Code Generation
     } else if (!test_lexer_mode_string && (parse_errors || !lex_success || semantic_errors)) {
         fprintf(stderr, "\nCompilation failed during lexing, parsing, or semantic analysis.\n");
     }
+    if (build_errors) {
+        fprintf(stderr, "Building the executable failed.\n");
+    }
 
     // Cleanup
+    da_destroy(recheck_paths);
+    da_destroy(roots);
     if (program) {
         ast_program_destroy(program);
     }
     lexer_destroy(lexer);
+    diagnostics_destroy(diagnostics);
     if (file_content_buffer) free(file_content_buffer);
 
-    return 0;
+    return parse_errors || semantic_errors || build_errors ? 1 : 0;
 }
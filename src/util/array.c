@@ -0,0 +1,25 @@
+#include "array.h"
+#include <stdlib.h>
+
+static bool grow(void** items, size_t* capacity, size_t needed, size_t size, size_t limit) {
+    if (needed <= *capacity) return true;
+    size_t new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed && new_capacity <= limit / 2) new_capacity *= 2;
+    if (new_capacity < needed || new_capacity > SIZE_MAX / size) return false;
+    void* grown = realloc(*items, new_capacity * size);
+    if (!grown) return false;
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+bool array_reserve(void** items, size_t* capacity, size_t needed, size_t size) {
+    return grow(items, capacity, needed, size, SIZE_MAX);
+}
+
+bool array_reserve_u32(void** items, uint32_t* capacity, size_t needed, size_t size) {
+    size_t wide = *capacity;
+    if (!grow(items, &wide, needed, size, UINT32_MAX - 1)) return false;
+    *capacity = (uint32_t)wide;
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include <stdint.h> // For uint32_t
+
+// Growth for plain arrays of structs kept as a pointer, a count and a capacity:
+// the tables of the borrow checker, the match checker, the IR and the bytecode,
+// which DynamicArray (an array of pointers) would scatter across the heap.
+
+// Grows `*items`, an array of `*capacity` elements of `size` bytes, to hold at
+// least `needed` elements, doubling the capacity so appends are amortized O(1).
+// Returns false on allocation failure, leaving the array as it was.
+bool array_reserve(void** items, size_t* capacity, size_t needed, size_t size);
+
+// The same for arrays indexed by uint32_t: the capacity stays below UINT32_MAX.
+bool array_reserve_u32(void** items, uint32_t* capacity, size_t needed, size_t size);
+
+#endif // ARRAY_H
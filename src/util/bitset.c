@@ -0,0 +1,66 @@
+#include "bitset.h"
+#include <stdlib.h>
+#include <string.h>
+
+void bitset_set_range(uint64_t* set, size_t from, size_t to) {
+    for (; from <= to && from % 64; ++from) bitset_set(set, from);
+    for (; from + 63 <= to; from += 64) set[from / 64] = ~(uint64_t)0;
+    for (; from <= to; ++from) bitset_set(set, from);
+}
+
+void bitset_fill(uint64_t* set, size_t bits) {
+    size_t words = bitset_words(bits);
+    if (words == 0) return;
+    memset(set, 0xff, words * sizeof(uint64_t));
+    if (bits % 64) set[words - 1] = ((uint64_t)1 << (bits % 64)) - 1;
+}
+
+void bitset_zero(uint64_t* set, size_t words) {
+    if (words) memset(set, 0, words * sizeof(uint64_t));
+}
+
+void bitset_copy(uint64_t* dst, const uint64_t* src, size_t words) {
+    if (words) memcpy(dst, src, words * sizeof(uint64_t));
+}
+
+bool bitset_union(uint64_t* dst, const uint64_t* src, size_t words) {
+    uint64_t changed = 0;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t next = dst[i] | src[i];
+        changed |= next ^ dst[i];
+        dst[i] = next;
+    }
+    return changed != 0;
+}
+
+bool bitset_transfer(uint64_t* out, const uint64_t* in, const uint64_t* gen, const uint64_t* kill, size_t words) {
+    uint64_t changed = 0;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t next = gen[i] | (in[i] & ~kill[i]);
+        changed |= next ^ out[i];
+        out[i] = next;
+    }
+    return changed != 0;
+}
+
+void bitset_for_each(const uint64_t* set, size_t words, void (*visit)(size_t bit, void* ctx), void* ctx) {
+    for (size_t i = 0; i < words; ++i) {
+        for (uint64_t word = set[i]; word; word &= word - 1) {
+            visit(i * 64 + (size_t)__builtin_ctzll(word), ctx);
+        }
+    }
+}
+
+bool bit_matrix_init(BitMatrix* matrix, size_t rows, size_t bits) {
+    matrix->rows = rows;
+    matrix->words_per_row = bitset_words(bits);
+    size_t total = rows * matrix->words_per_row;
+    matrix->words = (uint64_t*)calloc(total ? total : 1, sizeof(uint64_t));
+    return matrix->words != NULL;
+}
+
+void bit_matrix_free(BitMatrix* matrix) {
+    free(matrix->words);
+    matrix->words = NULL;
+    matrix->rows = matrix->words_per_row = 0;
+}
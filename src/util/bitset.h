@@ -0,0 +1,61 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+#include <stdint.h> // For uint64_t
+
+// Dense bitsets over small integer indices (locals, loans, program points),
+// stored as arrays of 64-bit words. A BitMatrix holds one equally sized set per
+// row in a single allocation, e.g. the entry state of every basic block, so a
+// dataflow solver allocates once per body rather than once per block.
+
+static inline size_t bitset_words(size_t bits) {
+    return (bits + 63) / 64;
+}
+
+static inline void bitset_set(uint64_t* set, size_t bit) {
+    set[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+static inline void bitset_clear(uint64_t* set, size_t bit) {
+    set[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+}
+
+static inline bool bitset_test(const uint64_t* set, size_t bit) {
+    return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+// Sets bits [from, to].
+void bitset_set_range(uint64_t* set, size_t from, size_t to);
+
+// Sets bits [0, bits) and clears the padding bits of the last word.
+void bitset_fill(uint64_t* set, size_t bits);
+void bitset_zero(uint64_t* set, size_t words);
+void bitset_copy(uint64_t* dst, const uint64_t* src, size_t words);
+
+// dst |= src. Returns true if dst changed.
+bool bitset_union(uint64_t* dst, const uint64_t* src, size_t words);
+
+// out = gen | (in & ~kill): the transfer function of a gen/kill dataflow problem.
+// Returns true if out changed.
+bool bitset_transfer(uint64_t* out, const uint64_t* in, const uint64_t* gen, const uint64_t* kill, size_t words);
+
+// Calls visit(bit, ctx) for every set bit, in increasing order.
+void bitset_for_each(const uint64_t* set, size_t words, void (*visit)(size_t bit, void* ctx), void* ctx);
+
+typedef struct {
+    uint64_t* words;
+    size_t rows;
+    size_t words_per_row;
+} BitMatrix;
+
+// Allocates rows x bits, all clear. Returns false on allocation failure.
+bool bit_matrix_init(BitMatrix* matrix, size_t rows, size_t bits);
+void bit_matrix_free(BitMatrix* matrix);
+
+static inline uint64_t* bit_matrix_row(const BitMatrix* matrix, size_t row) {
+    return matrix->words + row * matrix->words_per_row;
+}
+
+#endif // BITSET_H
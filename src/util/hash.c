@@ -0,0 +1,25 @@
+#include "hash.h"
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+uint32_t hash_bytes(const char *bytes, size_t length) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint32_t hash_combine(uint32_t seed, uint64_t value) {
+    // Feed the value through FNV-1a one byte at a time so the result does not
+    // depend on host endianness.
+    uint32_t hash = seed ? seed : FNV_OFFSET_BASIS;
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (uint32_t)(value & 0xff);
+        hash *= FNV_PRIME;
+        value >>= 8;
+    }
+    return hash;
+}
@@ -0,0 +1,14 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h> // For size_t
+#include <stdint.h> // For uint32_t, uint64_t
+
+// Hashes a byte buffer (e.g. an identifier lexeme, which is not null-terminated).
+// 32-bit FNV-1a: cheap, and good enough for the short names a compiler hashes.
+uint32_t hash_bytes(const char *bytes, size_t length);
+
+// Mixes an integer into a running hash (e.g. hashing a list of type IDs).
+uint32_t hash_combine(uint32_t seed, uint64_t value);
+
+#endif // HASH_H
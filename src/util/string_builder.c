@@ -1,7 +1,7 @@
 #include "string_builder.h"
 #include <stdlib.h>
 #include <string.h> // For strlen, strcpy, strcat, memcpy
-#include <stdio.h>  // For vsnprintf if we add formatted append
+#include <stdio.h>  // For vsnprintf
 
 #define SB_DEFAULT_INITIAL_CAPACITY 16 // Includes null terminator
 #define SB_GROWTH_FACTOR 2
@@ -92,6 +92,28 @@ int sb_append_buf(StringBuilder *sb, const char *buf, size_t len) {
     return 0;
 }
 
+int sb_appendf(StringBuilder *sb, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int result = sb_vappendf(sb, format, args);
+    va_end(args);
+    return result;
+}
+
+int sb_vappendf(StringBuilder *sb, const char *format, va_list args) {
+    if (!sb || !format) return -1;
+    va_list measure;
+    va_copy(measure, args);
+    int len = vsnprintf(NULL, 0, format, measure);
+    va_end(measure);
+    if (len < 0 || sb_ensure_capacity(sb, (size_t)len) != 0) {
+        return -1;
+    }
+    vsnprintf(sb->buffer + sb->length, (size_t)len + 1, format, args);
+    sb->length += (size_t)len;
+    return 0;
+}
+
 const char* sb_get_str(const StringBuilder *sb) {
     if (!sb || !sb->buffer) {
         // Should ideally return a static empty string "" to avoid NULL issues
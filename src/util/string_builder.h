@@ -3,6 +3,7 @@
 
 #include <stddef.h> // For size_t
 #include <stdbool.h> // For bool
+#include <stdarg.h>  // For va_list
 
 // StringBuilder structure for creating and manipulating strings dynamically.
 typedef struct {
@@ -30,6 +31,11 @@ int sb_append_str(StringBuilder *sb, const char *str);
 // Returns 0 on success, -1 on failure.
 int sb_append_buf(StringBuilder *sb, const char *buf, size_t len);
 
+// Appends printf-style formatted text to the StringBuilder.
+// Returns 0 on success, -1 on failure.
+int sb_appendf(StringBuilder *sb, const char *format, ...);
+int sb_vappendf(StringBuilder *sb, const char *format, va_list args);
+
 // Returns a pointer to the internal C string.
 // The returned string is null-terminated.
 // The pointer is valid until the StringBuilder is modified or destroyed.
@@ -0,0 +1,173 @@
+#define _DEFAULT_SOURCE // For sysconf
+#include "task_graph.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h> // For sysconf
+
+struct TaskGraph {
+    size_t task_count;
+    size_t* edge_from;
+    size_t* edge_to;
+    size_t edge_count;
+    size_t edge_capacity;
+};
+
+TaskGraph* task_graph_create(size_t task_count) {
+    TaskGraph* graph = (TaskGraph*)calloc(1, sizeof(TaskGraph));
+    if (!graph) return NULL;
+    graph->task_count = task_count;
+    return graph;
+}
+
+void task_graph_destroy(TaskGraph* graph) {
+    if (!graph) return;
+    free(graph->edge_from);
+    free(graph->edge_to);
+    free(graph);
+}
+
+bool task_graph_add_edge(TaskGraph* graph, size_t before, size_t after) {
+    if (!graph || before >= graph->task_count || after >= graph->task_count) return false;
+    if (graph->edge_count == graph->edge_capacity) {
+        size_t new_capacity = graph->edge_capacity ? graph->edge_capacity * 2 : 64;
+        size_t* from = (size_t*)realloc(graph->edge_from, new_capacity * sizeof(size_t));
+        if (!from) return false;
+        graph->edge_from = from;
+        size_t* to = (size_t*)realloc(graph->edge_to, new_capacity * sizeof(size_t));
+        if (!to) return false;
+        graph->edge_to = to;
+        graph->edge_capacity = new_capacity;
+    }
+    graph->edge_from[graph->edge_count] = before;
+    graph->edge_to[graph->edge_count] = after;
+    graph->edge_count++;
+    return true;
+}
+
+// Scheduling state shared by the workers; everything but the dependents lists is
+// guarded by `lock`.
+typedef struct {
+    size_t task_count;
+    const size_t* dependent_start; // Dependents of task t: dependents[dependent_start[t] .. dependent_start[t + 1])
+    const size_t* dependents;
+    size_t* pending;               // Unfinished dependencies per task
+    size_t* queue;                 // Ready tasks; every task is enqueued at most once
+    size_t head, tail;
+    size_t running;
+    size_t finished;
+    void (*run)(size_t task, size_t worker, void* ctx);
+    void* ctx;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} Schedule;
+
+typedef struct {
+    Schedule* schedule;
+    size_t worker;
+} WorkerArgs;
+
+static void* worker_main(void* arg) {
+    WorkerArgs* args = (WorkerArgs*)arg;
+    Schedule* s = args->schedule;
+    pthread_mutex_lock(&s->lock);
+    while (true) {
+        while (s->head == s->tail && s->finished < s->task_count && s->running > 0) {
+            pthread_cond_wait(&s->changed, &s->lock);
+        }
+        // Nothing ready and nothing running: either all done, or the rest is a cycle.
+        if (s->head == s->tail) break;
+        size_t task = s->queue[s->head++];
+        s->running++;
+        pthread_mutex_unlock(&s->lock);
+
+        s->run(task, args->worker, s->ctx);
+
+        pthread_mutex_lock(&s->lock);
+        s->running--;
+        s->finished++;
+        for (size_t e = s->dependent_start[task]; e < s->dependent_start[task + 1]; ++e) {
+            size_t next = s->dependents[e];
+            if (--s->pending[next] == 0) s->queue[s->tail++] = next;
+        }
+        pthread_cond_broadcast(&s->changed);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+bool task_graph_run(TaskGraph* graph, size_t workers, void (*run)(size_t task, size_t worker, void* ctx), void* ctx) {
+    if (!graph || !run) return false;
+    size_t n = graph->task_count;
+    if (n == 0) return true;
+    if (workers == 0) workers = 1;
+    if (workers > n) workers = n;
+
+    size_t* dependent_start = (size_t*)calloc(n + 1, sizeof(size_t));
+    size_t* dependents = (size_t*)malloc((graph->edge_count ? graph->edge_count : 1) * sizeof(size_t));
+    size_t* pending = (size_t*)calloc(n, sizeof(size_t));
+    size_t* queue = (size_t*)malloc(n * sizeof(size_t));
+    pthread_t* threads = (pthread_t*)malloc(workers * sizeof(pthread_t));
+    WorkerArgs* args = (WorkerArgs*)malloc(workers * sizeof(WorkerArgs));
+    if (!dependent_start || !dependents || !pending || !queue || !threads || !args) {
+        free(dependent_start);
+        free(dependents);
+        free(pending);
+        free(queue);
+        free(threads);
+        free(args);
+        return false;
+    }
+
+    // Dependents in compressed (CSR) form: count, prefix-sum, fill.
+    for (size_t e = 0; e < graph->edge_count; ++e) {
+        dependent_start[graph->edge_from[e] + 1]++;
+        pending[graph->edge_to[e]]++;
+    }
+    for (size_t t = 0; t < n; ++t) dependent_start[t + 1] += dependent_start[t];
+    size_t* fill = queue; // Borrowed as the fill cursor until the queue is seeded
+    for (size_t t = 0; t < n; ++t) fill[t] = dependent_start[t];
+    for (size_t e = 0; e < graph->edge_count; ++e) {
+        dependents[fill[graph->edge_from[e]]++] = graph->edge_to[e];
+    }
+
+    Schedule s = {0};
+    s.task_count = n;
+    s.dependent_start = dependent_start;
+    s.dependents = dependents;
+    s.pending = pending;
+    s.queue = queue;
+    s.run = run;
+    s.ctx = ctx;
+    for (size_t t = 0; t < n; ++t) {
+        if (pending[t] == 0) queue[s.tail++] = t;
+    }
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.changed, NULL);
+
+    // Threads that fail to start just leave their share to the others.
+    size_t started = 0;
+    for (size_t w = 1; w < workers; ++w) {
+        args[started + 1] = (WorkerArgs){&s, started + 1};
+        if (pthread_create(&threads[started + 1], NULL, worker_main, &args[started + 1]) != 0) break;
+        started++;
+    }
+    args[0] = (WorkerArgs){&s, 0};
+    worker_main(&args[0]);
+    for (size_t w = 1; w <= started; ++w) pthread_join(threads[w], NULL);
+
+    bool complete = s.finished == n;
+    pthread_cond_destroy(&s.changed);
+    pthread_mutex_destroy(&s.lock);
+    free(dependent_start);
+    free(dependents);
+    free(pending);
+    free(queue);
+    free(threads);
+    free(args);
+    return complete;
+}
+
+size_t task_graph_default_workers(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t)count : 1;
+}
@@ -0,0 +1,29 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <stdbool.h>
+#include <stddef.h> // For size_t
+
+// A set of tasks numbered 0..n-1 with "runs after" edges between them, run on a
+// pool of worker threads. A task becomes ready once every task it depends on has
+// finished; ready tasks are handed out in the order they became ready (initially
+// in index order). Finishing a task happens-before starting any task that
+// depends on it, so a task may read whatever its dependencies wrote.
+typedef struct TaskGraph TaskGraph;
+
+TaskGraph* task_graph_create(size_t task_count);
+void task_graph_destroy(TaskGraph* graph);
+
+// Makes `after` wait for `before`. Repeated edges are allowed.
+// Returns false on allocation failure or an out-of-range task.
+bool task_graph_add_edge(TaskGraph* graph, size_t before, size_t after);
+
+// Runs every task as run(task, worker, ctx), on up to `workers` threads
+// (the calling thread is worker 0). Returns false if some tasks could not run
+// because the edges form a cycle, or on allocation failure.
+bool task_graph_run(TaskGraph* graph, size_t workers, void (*run)(size_t task, size_t worker, void* ctx), void* ctx);
+
+// Number of online processors, at least 1.
+size_t task_graph_default_workers(void);
+
+#endif // TASK_GRAPH_H
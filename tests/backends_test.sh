@@ -0,0 +1,58 @@
+#!/bin/sh
+# Every way of running a program must print what the VM prints: the
+# executables of the C, assembly and ELF object backends, and the VM with the
+# JIT compiling the hot program (`run -repeat`).
+
+compiler="$1"
+[ "$(uname -m)" = x86_64 ] || exit 0 # The asm and obj backends and the JIT emit x86-64
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir" || exit 1
+
+cat > a.ml <<'SOURCE'
+data Option<T> { None, Some(T) }
+data List<T> { Nil, Cons(T, List<T>) }
+data Pair<A, B> { P(A, B) }
+// Generic values, used at other types than the ones they are defined at
+let a = Nil;
+let b = Cons(Some(1), a);
+let n = None;
+let p = P(n, 1);
+let q = P(Some("x"), 2);
+let pairs = Cons(p, Cons(q, Nil));
+let empties = Cons(Nil, Cons(Nil, Nil));
+let k = match empties { Cons(x, rest) => Cons(Some(5), x), Nil => Nil };
+let a2 = Nil;
+let r = &a2;
+let refs = Cons(r, Cons(&Cons(7, Nil), Nil));
+// Matches on literals, bools and nested constructors
+let t = true;
+let flag = match t { true => 1, false => 0 };
+let nested = match Some(false) { Some(true) => 1, Some(false) => 2, None => 3 };
+let s = "two";
+let word = match s { "one" => 1, "two" => 2, _ => 0 };
+let num = match 41 { 41 => Some(42), _ => None };
+SOURCE
+"$compiler" run a.ml -no-jit > vm.txt 2>&1 || { echo "the VM failed:"; cat vm.txt; exit 1; }
+
+status=0
+for backend in c asm obj; do
+    if ! "$compiler" a.ml -backend "$backend" -o "$backend.exe" > build.txt 2>&1; then
+        echo "-backend $backend failed to build:"
+        tail -20 build.txt
+        status=1
+    elif ! ./"$backend.exe" > out.txt 2>&1 || ! diff vm.txt out.txt; then
+        echo "-backend $backend differs from the VM"
+        status=1
+    fi
+done
+
+"$compiler" run a.ml -repeat 20 > out.txt 2> timing.txt
+if ! diff vm.txt out.txt; then
+    echo "run -repeat differs from the VM"
+    status=1
+elif grep -q " 0 native" timing.txt; then
+    echo "run -repeat never ran native code: $(cat timing.txt)"
+    status=1
+fi
+exit $status
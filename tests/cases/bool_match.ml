@@ -0,0 +1,9 @@
+// `true` and `false` cover a bool, alone or nested in a constructor.
+data Option<T> { None, Some(T) }
+let e = true;
+let t = match e { true => 1, false => 0 };
+let n = match Some(true) { Some(true) => 1, Some(false) => 2, None => 3 };
+let o = match e { false | true => 4 };
+let partial = match e { true => 1 };
+let nested = match Some(false) { Some(true) => 1, None => 3 };
+let dead = match e { true => 1, false => 0, _ => 2 };
@@ -0,0 +1,20 @@
+// Borrows: one `&mut`, or any number of `&`, while the reference is used.
+data Pair<A, B> { P(A, B) }
+let mut a = 1;
+let m = &mut a;
+let s = &a;
+let use_m = P(m, s);
+let mut b = 2;
+let m1 = &mut b;
+let m2 = &mut b;
+let use_m1 = P(m1, m2);
+let mut c = 3;
+let shared = &c;
+let exclusive = &mut c;
+let use_shared = P(shared, exclusive);
+let d = 4;
+let not_mut = &mut d;
+let mut e = 5;
+let me = &mut e;
+let read = e;
+let use_me = me;
@@ -0,0 +1,5 @@
+// Declaration errors are found before any `let` is analyzed but print in source order.
+let a = q;
+data D { A(Foo) }
+let b = r;
+data E { B(Bar) }
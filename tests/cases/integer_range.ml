@@ -0,0 +1,5 @@
+// Integer literals must fit in an i32: the largest is accepted, the rest are rejected.
+let big = 99999999999;
+let max = 2147483647;
+let over = 2147483648;
+let m = match max { 4294967296 => 1, _ => 0 };
@@ -0,0 +1,15 @@
+// A borrow ends at the last use of its reference, not at the end of the scope.
+data List<T> { Nil, Cons(T, List<T>) }
+data Pair<A, B> { P(A, B) }
+let mut a = 1;
+let r = &mut a;
+let b = &a;
+let c = a;
+let mut d = 2;
+let first = &mut d;
+let used = P(first, 0);
+let second = &mut d;
+let xs = Cons(3, Nil);
+let shared = &xs;
+let kept = P(shared, 1);
+let moved = xs;
@@ -0,0 +1,7 @@
+// Nullary constructors are values, not undefined names.
+data Option<T> { None, Some(T) }
+data Unit { Unit }
+let z = None;
+let s = Some(z);
+let u = Unit;
+let m = match s { Some(None) => 1, _ => 2 };
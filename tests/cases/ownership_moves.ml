@@ -0,0 +1,16 @@
+// Moves: a non-Copy value has one owner at a time.
+data List<T> { Nil, Cons(T, List<T>) }
+data Pair<A, B> { P(A, B) }
+let xs = Cons(1, Nil);
+let ys = xs;
+let again = xs;
+let zs = Cons(2, Nil);
+let r = &zs;
+let moved = zs;
+let keep = P(r, 0);
+let ws = Cons(3, Nil);
+let gone = ws;
+let late = &ws;
+let n = 4;
+let m = n;
+let copied = n;
@@ -0,0 +1,67 @@
+#!/bin/sh
+# Programs with enough `let`s to be analyzed in parallel must give the same
+# output on any number of threads as on one: values, and redefinition and
+# resolution errors, which the concurrent declaration phase decides by
+# statement position.
+
+compiler="$1"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir" || exit 1
+
+# lets <count>: a chain of lets using earlier ones, with match arms binding variables
+lets() {
+    echo 'data Option<T> { None, Some(T) }'
+    echo 'data Pair { P(i32, i32) }'
+    echo 'let v0 = 0;'
+    i=1
+    while [ "$i" -lt "$1" ]; do
+        case $((i % 4)) in
+            0) echo "let v$i = match Some(v$((i - 1))) { Some(x) => x, None => $i };" ;;
+            1) echo "let v$i = P(v$((i - 1)), $i);" ;;
+            2) echo "let v$i = Some(v0);" ;;
+            *) echo "let v$i = $i;" ;;
+        esac
+        i=$((i + 1))
+    done
+}
+
+lets 400 > good.ml
+{
+    lets 400
+    echo 'let v5 = 1;'
+    echo 'let early = later;'
+    echo 'let later = 2;'
+    echo 'let self = self;'
+    echo 'let Pair = 3;'
+    echo 'let v7 = v7;'
+} > bad.ml
+
+status=0
+for program in good bad; do
+    "$compiler" run "$program.ml" -jobs 1 > "$program.1" 2>&1
+    for jobs in 2 8; do
+        "$compiler" run "$program.ml" -jobs "$jobs" > "$program.$jobs" 2>&1
+        if ! cmp -s "$program.1" "$program.$jobs"; then
+            echo "$program.ml: -jobs $jobs differs from -jobs 1"
+            diff "$program.1" "$program.$jobs" | head -10
+            status=1
+        fi
+    done
+done
+
+grep -q '^v397 = P(395, 397)$' good.1 || { echo "good.ml: wrong v397"; status=1; }
+grep '^\[' bad.8 > errors.txt
+cat > expected.txt <<'ERRORS'
+[L403 C5 at 'v5'] Semantic Error: Variable with this name already defined in current scope.
+[L404 C13 at 'later'] Semantic Error: Undefined variable.
+[L406 C12 at 'self'] Semantic Error: Undefined variable.
+[L407 C5 at 'Pair'] Semantic Error: Variable with this name already defined in current scope.
+[L408 C5 at 'v7'] Semantic Error: Variable with this name already defined in current scope.
+ERRORS
+if ! cmp -s expected.txt errors.txt; then
+    echo "bad.ml: unexpected errors"
+    diff expected.txt errors.txt
+    status=1
+fi
+exit $status
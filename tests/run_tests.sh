@@ -0,0 +1,37 @@
+#!/bin/sh
+# Regression tests for mylangc; run from the repository root (`make test`).
+#
+# Every tests/cases/<name>.ml is run with `mylangc run`, and its output, stdout
+# and stderr together, must match tests/cases/<name>.out. Every
+# tests/<name>_test.sh is run as a script with the compiler's path as its
+# argument and must exit with status 0.
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+compiler="$root/mylangc"
+failed=0
+passed=0
+
+for source in "$root"/tests/cases/*.ml; do
+    name=$(basename "$source" .ml)
+    actual=$(cd "$root/tests/cases" && "$compiler" run "$name.ml" 2>&1)
+    if [ "$actual" = "$(cat "$root/tests/cases/$name.out")" ]; then
+        passed=$((passed + 1))
+    else
+        echo "FAIL: cases/$name.ml"
+        printf '%s\n' "$actual" | diff "$root/tests/cases/$name.out" - | head -20
+        failed=$((failed + 1))
+    fi
+done
+
+for script in "$root"/tests/*_test.sh; do
+    [ -e "$script" ] || continue
+    if sh "$script" "$compiler"; then
+        passed=$((passed + 1))
+    else
+        echo "FAIL: $(basename "$script")"
+        failed=$((failed + 1))
+    fi
+done
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
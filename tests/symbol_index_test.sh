@@ -0,0 +1,53 @@
+#!/bin/sh
+# A truncated or corrupted symbol index must be rejected, not read: querying
+# it fails cleanly, and compiling with -index rebuilds it.
+
+compiler="$1"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir" || exit 1
+
+cat > a.ml <<'SOURCE'
+data Option<T> { None, Some(T) }
+let x = Some(1);
+let y = match x { None => 0, Some(v) => v };
+SOURCE
+"$compiler" a.ml -index good.idx > /dev/null 2>&1 || { echo "could not build the index"; exit 1; }
+"$compiler" -query-index good.idx Some > /dev/null 2>&1 || { echo "could not query the index"; exit 1; }
+
+# Header: six 32-bit fields, then four 64-bit offsets.
+u32() { od -An -tu4 -j "$2" -N4 "$1" | tr -d ' '; }
+u64() { od -An -tu8 -j "$2" -N8 "$1" | tr -d ' '; }
+symbols=$(u64 good.idx 32)
+postings=$(u64 good.idx 40)
+files=$(u64 good.idx 24)
+
+# corrupt <name> <offset>: a copy of the index with 0xffffffff at <offset>
+corrupt() {
+    cp good.idx "$1.idx"
+    printf '\377\377\377\377' | dd of="$1.idx" bs=1 seek="$2" conv=notrunc 2> /dev/null
+}
+head -c 100 good.idx > truncated.idx
+corrupt name_offset "$symbols"
+corrupt name_length $((symbols + 4))
+corrupt def_count $((symbols + 16))
+corrupt use_start $((symbols + 20))
+corrupt file_id "$postings"
+corrupt path_offset "$files"
+
+status=0
+for index in truncated name_offset name_length def_count use_start file_id path_offset; do
+    "$compiler" -query-index "$index.idx" Some > out.txt 2>&1
+    code=$?
+    if [ "$code" -ne 1 ] || ! grep -q "malformed\|truncated" out.txt; then
+        echo "$index: query exited with $code"
+        status=1
+    fi
+    "$compiler" a.ml -index "$index.idx" > out.txt 2>&1
+    code=$?
+    if [ "$code" -ne 0 ] || ! "$compiler" -query-index "$index.idx" Some > /dev/null 2>&1; then
+        echo "$index: compiling with the index exited with $code"
+        status=1
+    fi
+done
+exit $status
@@ -0,0 +1,102 @@
+// Snapshots and rollback of a scope (symbol_table.h), built against the
+// compiler's objects by symbol_table_test.sh.
+#include "core/symbol_table.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                   \
+    do {                                                              \
+        if (!(cond)) {                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                               \
+        }                                                             \
+    } while (0)
+
+static Token name(const char* text) {
+    return token_create(TOKEN_IDENTIFIER, text, strlen(text), 1, 1);
+}
+
+static Symbol* define(SymbolTable* table, const char* text) {
+    Symbol* symbol = symbol_create(SYMBOL_VARIABLE, name(text), NULL);
+    if (!symbol_table_define(table, symbol)) {
+        symbol_destroy(symbol);
+        return NULL;
+    }
+    return symbol;
+}
+
+static void count_symbol(Symbol* symbol, void* ctx) {
+    (void)symbol;
+    ++*(size_t*)ctx;
+}
+
+// Looks names up in a snapshot while the main thread keeps defining.
+static void* read_snapshot(void* arg) {
+    const ScopeSnapshot* snapshot = (const ScopeSnapshot*)arg;
+    size_t found = 0;
+    for (int round = 0; round < 200; ++round) {
+        found += scope_snapshot_lookup(snapshot, name("a")) != NULL;
+        found += scope_snapshot_lookup(snapshot, name("n500")) != NULL;
+    }
+    return (void*)found;
+}
+
+int main(void) {
+    SymbolTable* table = symbol_table_create();
+    Symbol* a = define(table, "a");
+    Symbol* b = define(table, "b");
+    CHECK(a && b && b->slot == 1);
+
+    ScopeSnapshot first = symbol_table_snapshot_globals(table);
+    Symbol* c = define(table, "c");
+    CHECK(c && c->slot == 2);
+    ScopeSnapshot second = symbol_table_snapshot_globals(table);
+
+    // Snapshots are stable versions.
+    CHECK(scope_snapshot_lookup(&first, name("c")) == NULL);
+    CHECK(scope_snapshot_lookup(&second, name("c")) == c);
+    size_t visible = 0;
+    scope_snapshot_foreach(&second, count_symbol, &visible);
+    CHECK(visible == 3);
+
+    // Rolling back hides `c` from lookups and from its slot, which is reused.
+    CHECK(symbol_table_restore_globals(table, &first));
+    CHECK(symbol_table_lookup(table, name("c")) == NULL);
+    CHECK(symbol_table_symbol_at(table, 0, 2) == NULL);
+    CHECK(symbol_table_lookup(table, name("b")) == b);
+    Symbol* d = define(table, "d");
+    CHECK(d && d->slot == 2 && symbol_table_symbol_at(table, 0, 2) == d);
+    CHECK(scope_snapshot_lookup(&second, name("c")) == c); // Still alive for the old version
+
+    // `second` is no longer an earlier version of the scope.
+    CHECK(!symbol_table_restore_globals(table, &second));
+    CHECK(symbol_table_lookup(table, name("d")) == d);
+    CHECK(symbol_table_restore_globals(table, &first));
+    CHECK(symbol_table_lookup(table, name("d")) == NULL);
+    CHECK(define(table, "c") != NULL); // The name is free again
+
+    // Readers of a snapshot run alongside inserts into the live scope.
+    ScopeSnapshot third = symbol_table_snapshot_globals(table);
+    pthread_t reader;
+    CHECK(pthread_create(&reader, NULL, read_snapshot, &third) == 0);
+    static char names[1000][8];
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(names[i], sizeof(names[i]), "n%d", i);
+        define(table, names[i]);
+    }
+    void* found = NULL;
+    pthread_join(reader, &found);
+    CHECK((size_t)found == 200); // `a` every round, `n500` never
+    CHECK(symbol_table_lookup(table, name("n500")) != NULL);
+
+    scope_snapshot_release(&first);
+    scope_snapshot_release(&second);
+    scope_snapshot_release(&third);
+    scope_snapshot_release(&third); // Released snapshots are zeroed
+    symbol_table_destroy(table);
+    if (failures) fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+# Builds tests/symbol_table_test.c against the compiler's objects (left by the
+# build `make test` depends on) and runs it.
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+objects=$(ls "$root"/src/core/*.o "$root"/src/util/*.o "$root"/src/backend/*.o)
+${CC:-gcc} -std=c11 -g -pthread -I"$root/src" "$root/tests/symbol_table_test.c" $objects -o "$dir/symbol_table_test" \
+    || { echo "could not build symbol_table_test"; exit 1; }
+"$dir/symbol_table_test"